@@ -17,9 +17,14 @@ namespace CodeGen
         // based on an input name, so the same name always produces the same UUID.
         public static Guid GetVersion5Uuid(Guid namespaceId, string name)
         {
-            // Convert inputs to byte arrays.
+            return GetVersion5Uuid(namespaceId, Encoding.UTF8.GetBytes(name));
+        }
+
+
+        public static Guid GetVersion5Uuid(Guid namespaceId, byte[] nameBytes)
+        {
+            // Convert namespace to a byte array.
             var namespaceBytes = namespaceId.ToByteArray();
-            var nameBytes = Encoding.UTF8.GetBytes(name);
 
             // Convert to network byte ordering.
             SwapByteOrder(namespaceBytes);
@@ -0,0 +1,24 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+using Shared;
+using System.Collections.Generic;
+
+namespace ShaderPackage
+{
+    public class CommandLineOptions
+    {
+        // Package file to write.
+        [CommandLineParser.Required]
+        public string OutputFile;
+
+        // Compiled shader files (eg. the output of fxc /Fo) to include. Each shader
+        // is named after its file, without the extension.
+        [CommandLineParser.Required]
+        public List<string> ShaderFiles = new List<string>();
+
+        // Other options.
+        public bool Verbose;
+    }
+}
@@ -0,0 +1,392 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+
+namespace ShaderPackage
+{
+    // Matches D3D_SHADER_VARIABLE_CLASS.
+    public enum ShaderVariableClass
+    {
+        Scalar = 0,
+        Vector = 1,
+        MatrixRows = 2,
+        MatrixColumns = 3,
+    }
+
+
+    // Matches D3D_SHADER_VARIABLE_TYPE.
+    public enum ShaderVariableType
+    {
+        Bool = 1,
+        Int = 2,
+        Float = 3,
+    }
+
+
+    public class ShaderVariable
+    {
+        public string Name;
+        public ShaderVariableClass Class;
+        public ShaderVariableType Type;
+        public int Rows;
+        public int Columns;
+        public int Elements;
+        public int Size;
+        public int Offset;
+    }
+
+
+    //
+    // Extracts the same metadata from compiled shader bytecode that Win2D's
+    // SharedShaderState gets from D3D reflection, by reading the DXBC container
+    // directly. This lets packages be built without the D3D compiler runtime.
+    // Shaders that Win2D would reject are rejected here with the same messages.
+    //
+    public class DxbcShader
+    {
+        // Salt used by SharedShaderState to hash shader code.
+        static readonly Guid hashSalt = new Guid("489257f6-6544-4277-8982-ead169391f3d");
+
+        const int maxShaderInputs = 8;
+
+        // Matches D3D_SHADER_INPUT_TYPE.
+        const int inputTypeConstantBuffer = 0;
+        const int inputTypeTexture = 2;
+
+        // Matches D3D_FEATURE_LEVEL.
+        const int featureLevel9_3 = 0x9300;
+        const int featureLevel10_0 = 0xa000;
+        const int featureLevel10_1 = 0xa100;
+
+        const string badShaderMessage = "Unable to load the specified shader. This should be a Direct3D pixel shader compiled for shader model 4.";
+
+        public byte[] Code { get; private set; }
+        public Guid Hash { get; private set; }
+
+        public int InputCount { get; private set; }
+        public int InstructionCount { get; private set; }
+        public int MinFeatureLevel { get; private set; }
+
+        // False if the shader has a linking function, which must be reflected at load time.
+        public bool HasLinkingInfo { get; private set; }
+        public int SimpleInputs { get; private set; }
+
+        // Sorted by name, using the same ordinal comparison as Win2D.
+        public List<ShaderVariable> Variables { get; private set; }
+
+        public byte[] DefaultConstants { get; private set; }
+
+
+        public DxbcShader(byte[] code)
+        {
+            Code = code;
+            Hash = CodeGen.UuidHelper.GetVersion5Uuid(hashSalt, code);
+            Variables = new List<ShaderVariable>();
+            DefaultConstants = new byte[0];
+
+            var chunks = ReadChunks(code);
+
+            ReadShaderVersion(chunks);
+
+            byte[] rdef;
+
+            if (!chunks.TryGetValue("RDEF", out rdef))
+                throw new InvalidDataException("Shader has no reflection data. It should not be compiled with /Qstrip_reflect.");
+
+            ReadResourceDefinitions(rdef);
+
+            // The first value in the statistics chunk is the instruction count.
+            byte[] stat;
+
+            if (chunks.TryGetValue("STAT", out stat) && stat.Length >= 4)
+            {
+                InstructionCount = BitConverter.ToInt32(stat, 0);
+            }
+
+            // Private data holds the shader linking function, if there is one. Reflecting over that
+            // needs the D3D compiler, so leave it for Win2D to do when the package is loaded.
+            HasLinkingInfo = !chunks.ContainsKey("PRIV");
+            SimpleInputs = 0;
+        }
+
+
+        static Dictionary<string, byte[]> ReadChunks(byte[] code)
+        {
+            if (code.Length < 32 || ReadFourCC(code, 0) != "DXBC")
+                throw new InvalidDataException("Not a compiled Direct3D shader.");
+
+            int chunkCount = BitConverter.ToInt32(code, 28);
+
+            if (chunkCount < 0 || chunkCount > (code.Length - 32) / 4)
+                throw new InvalidDataException("Corrupt shader container.");
+
+            var chunks = new Dictionary<string, byte[]>();
+
+            for (int i = 0; i < chunkCount; i++)
+            {
+                int chunkOffset = BitConverter.ToInt32(code, 32 + i * 4);
+
+                if (chunkOffset < 0 || chunkOffset > code.Length - 8)
+                    throw new InvalidDataException("Corrupt shader container.");
+
+                string fourCC = ReadFourCC(code, chunkOffset);
+                int chunkSize = BitConverter.ToInt32(code, chunkOffset + 4);
+
+                if (chunkSize < 0 || chunkSize > code.Length - chunkOffset - 8)
+                    throw new InvalidDataException("Corrupt shader container.");
+
+                if (!chunks.ContainsKey(fourCC))
+                {
+                    chunks.Add(fourCC, code.Skip(chunkOffset + 8).Take(chunkSize).ToArray());
+                }
+            }
+
+            return chunks;
+        }
+
+
+        void ReadShaderVersion(Dictionary<string, byte[]> chunks)
+        {
+            byte[] program;
+
+            if ((!chunks.TryGetValue("SHDR", out program) && !chunks.TryGetValue("SHEX", out program)) || program.Length < 4)
+                throw new InvalidDataException(badShaderMessage);
+
+            // Decode the version token the same way as the D3D11_SHVER_GET_* macros.
+            int version = BitConverter.ToInt32(program, 0);
+
+            int programType = (version >> 16) & 0xFFFF;
+            int majorVersion = (version >> 4) & 0xF;
+            int minorVersion = version & 0xF;
+
+            const int pixelShaderType = 0;
+
+            if (programType != pixelShaderType || majorVersion != 4)
+                throw new InvalidDataException(badShaderMessage);
+
+            if (chunks.ContainsKey("Aon9"))
+            {
+                // Shaders compiled for ps_4_0_level_9_x include a downlevel version. Telling 9_1
+                // from 9_3 means decoding that, so conservatively report the higher of the two.
+                MinFeatureLevel = featureLevel9_3;
+            }
+            else
+            {
+                MinFeatureLevel = (minorVersion == 0) ? featureLevel10_0 : featureLevel10_1;
+            }
+        }
+
+
+        void ReadResourceDefinitions(byte[] rdef)
+        {
+            int constantBufferCount = ReadInt(rdef, 0);
+            int constantBufferOffset = ReadInt(rdef, 4);
+            int boundResourceCount = ReadInt(rdef, 8);
+            int boundResourceOffset = ReadInt(rdef, 12);
+            int majorVersion = ReadByte(rdef, 17);
+
+            // Shader model 5 adds extra fields to variable descriptions.
+            int variableStride = (majorVersion >= 5) ? 40 : 24;
+
+            // Examine the input bindings.
+            for (int i = 0; i < boundResourceCount; i++)
+            {
+                int offset = boundResourceOffset + i * 32;
+
+                int inputType = ReadInt(rdef, offset + 4);
+                int bindPoint = ReadInt(rdef, offset + 20);
+
+                switch (inputType)
+                {
+                    case inputTypeTexture:
+                        if (bindPoint >= maxShaderInputs)
+                            throw new InvalidDataException("Shader has too many input textures.");
+
+                        // Record how many input textures this shader uses.
+                        InputCount = Math.Max(InputCount, bindPoint + 1);
+                        break;
+
+                    case inputTypeConstantBuffer:
+                        if (bindPoint > 0)
+                            throw new InvalidDataException("Unsupported constant buffer layout. There should be a single constant buffer bound to b0.");
+                        break;
+                }
+            }
+
+            // Store the mapping from named constants to buffer locations.
+            if (constantBufferCount > 0)
+            {
+                int variableCount = ReadInt(rdef, constantBufferOffset + 4);
+                int variableOffset = ReadInt(rdef, constantBufferOffset + 8);
+                int bufferSize = ReadInt(rdef, constantBufferOffset + 12);
+
+                DefaultConstants = new byte[bufferSize];
+
+                for (int i = 0; i < variableCount; i++)
+                {
+                    Variables.Add(ReadVariable(rdef, variableOffset + i * variableStride));
+                }
+
+                Variables.Sort((a, b) => string.CompareOrdinal(a.Name, b.Name));
+            }
+        }
+
+
+        ShaderVariable ReadVariable(byte[] rdef, int offset)
+        {
+            string name = ReadString(rdef, ReadInt(rdef, offset));
+            int startOffset = ReadInt(rdef, offset + 4);
+            int size = ReadInt(rdef, offset + 8);
+            int typeOffset = ReadInt(rdef, offset + 16);
+            int defaultValueOffset = ReadInt(rdef, offset + 20);
+
+            int variableClass = ReadShort(rdef, typeOffset);
+            int variableType = ReadShort(rdef, typeOffset + 2);
+            int rows = ReadShort(rdef, typeOffset + 4);
+            int columns = ReadShort(rdef, typeOffset + 6);
+            int elements = ReadShort(rdef, typeOffset + 8);
+            int members = ReadShort(rdef, typeOffset + 10);
+
+            // Make sure Win2D supports this variable type.
+            if (!Enum.IsDefined(typeof(ShaderVariableClass), variableClass) ||
+                !Enum.IsDefined(typeof(ShaderVariableType), variableType) ||
+                members != 0)
+            {
+                throw new InvalidDataException(string.Format("Shader property '{0}' is an unsupported type.", name));
+            }
+
+            // Sanity check that the variable lies inside the constant buffer.
+            if (startOffset < 0 || size < 0 || startOffset + size > DefaultConstants.Length)
+                throw new InvalidDataException("Corrupt shader reflection data.");
+
+            var variable = new ShaderVariable
+            {
+                Name = name,
+                Class = (ShaderVariableClass)variableClass,
+                Type = (ShaderVariableType)variableType,
+                Rows = rows,
+                Columns = columns,
+                Elements = elements,
+                Size = size,
+                Offset = startOffset,
+            };
+
+            // Initialize the constant buffer with the default value of the variable.
+            if (defaultValueOffset != 0)
+            {
+                CopyDefaultValue(variable, rdef, defaultValueOffset);
+            }
+
+            return variable;
+        }
+
+
+        void CopyDefaultValue(ShaderVariable variable, byte[] rdef, int defaultValueOffset)
+        {
+            if (defaultValueOffset < 0 || defaultValueOffset + variable.Size > rdef.Length)
+                throw new InvalidDataException("Corrupt shader reflection data.");
+
+            if (variable.Class == ShaderVariableClass.MatrixRows || variable.Class == ShaderVariableClass.MatrixColumns)
+            {
+                // The HLSL compiler writes out default matrix values with their rows and columns swapped.
+                // This code flips them back into the correct layout, matching SharedShaderState.
+                bool isColumnMajor = (variable.Class == ShaderVariableClass.MatrixColumns);
+
+                int elementSize = (isColumnMajor ? variable.Columns : variable.Rows) * 4;
+
+                for (int element = 0; element < Math.Max(variable.Elements, 1); element++)
+                {
+                    for (int i = 0; i < variable.Rows * variable.Columns; i++)
+                    {
+                        int srcX = i / variable.Rows;
+                        int srcY = i % variable.Rows;
+
+                        int destX = i % variable.Columns;
+                        int destY = i / variable.Columns;
+
+                        if (isColumnMajor)
+                        {
+                            Swap(ref srcX, ref srcY);
+                            Swap(ref destX, ref destY);
+                        }
+
+                        int srcIndex = (element * elementSize) + (srcY * 4) + srcX;
+                        int destIndex = (element * elementSize) + (destY * 4) + destX;
+
+                        if (Math.Max(srcIndex, destIndex) >= variable.Size / 4)
+                            throw new InvalidDataException("Corrupt shader reflection data.");
+
+                        Array.Copy(rdef, defaultValueOffset + srcIndex * 4, DefaultConstants, variable.Offset + destIndex * 4, 4);
+                    }
+                }
+            }
+            else
+            {
+                // Other types can be copied directly.
+                Array.Copy(rdef, defaultValueOffset, DefaultConstants, variable.Offset, variable.Size);
+            }
+        }
+
+
+        static string ReadFourCC(byte[] data, int offset)
+        {
+            return Encoding.ASCII.GetString(data, offset, 4);
+        }
+
+
+        static int ReadInt(byte[] data, int offset)
+        {
+            CheckRange(data, offset, 4);
+            return BitConverter.ToInt32(data, offset);
+        }
+
+
+        static int ReadShort(byte[] data, int offset)
+        {
+            CheckRange(data, offset, 2);
+            return BitConverter.ToUInt16(data, offset);
+        }
+
+
+        static int ReadByte(byte[] data, int offset)
+        {
+            CheckRange(data, offset, 1);
+            return data[offset];
+        }
+
+
+        // Win2D widens each byte of reflected names to a wchar_t, so this does the same rather than decoding UTF-8.
+        static string ReadString(byte[] data, int offset)
+        {
+            var result = new StringBuilder();
+
+            for (int i = offset; ReadByte(data, i) != 0; i++)
+            {
+                result.Append((char)data[i]);
+            }
+
+            return result.ToString();
+        }
+
+
+        static void CheckRange(byte[] data, int offset, int size)
+        {
+            if (offset < 0 || offset > data.Length - size)
+                throw new InvalidDataException("Corrupt shader reflection data.");
+        }
+
+
+        static void Swap(ref int a, ref int b)
+        {
+            int temp = a;
+            a = b;
+            b = temp;
+        }
+    }
+}
@@ -0,0 +1,79 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+using Shared;
+using System;
+using System.IO;
+
+namespace ShaderPackage
+{
+    //
+    // Build-time tool that bundles compiled pixel shaders into a package, along with
+    // the metadata Win2D would otherwise compute by hashing and reflecting over each
+    // shader when a PixelShaderEffect is created.
+    //
+    class Program
+    {
+        static int Main(string[] args)
+        {
+            // Parse commandline options.
+            var options = new CommandLineOptions();
+            var parser = new CommandLineParser(options);
+
+            if (!parser.ParseCommandLine(args))
+            {
+                return 1;
+            }
+
+            // Run the program logic.
+            try
+            {
+                Run(options);
+            }
+            catch (Exception e)
+            {
+                Console.Error.WriteLine("Error: {0}", e.Message);
+                return 1;
+            }
+
+            return 0;
+        }
+
+
+        static void Run(CommandLineOptions options)
+        {
+            var writer = new ShaderPackageWriter();
+
+            foreach (var filename in options.ShaderFiles)
+            {
+                DxbcShader shader;
+
+                try
+                {
+                    shader = new DxbcShader(File.ReadAllBytes(filename));
+                }
+                catch (InvalidDataException e)
+                {
+                    throw new Exception(string.Format("{0}: {1}", filename, e.Message));
+                }
+
+                var name = Path.GetFileNameWithoutExtension(filename);
+
+                writer.AddShader(name, shader);
+
+                if (options.Verbose)
+                {
+                    Console.WriteLine("{0}: {1} inputs, {2} properties, {3} instructions{4}",
+                                      name,
+                                      shader.InputCount,
+                                      shader.Variables.Count,
+                                      shader.InstructionCount,
+                                      shader.HasLinkingInfo ? "" : ", linking function reflected at load time");
+                }
+            }
+
+            File.WriteAllBytes(options.OutputFile, writer.GetPackage());
+        }
+    }
+}
@@ -0,0 +1,119 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+
+namespace ShaderPackage
+{
+    //
+    // Writes the shader package format read by Win2D's ShaderPackage class.
+    // See winrt/lib/effects/shader/ShaderPackage.h for the layout, which this must be kept in sync with.
+    //
+    public class ShaderPackageWriter
+    {
+        public const uint Magic = 0x50533257;  // "W2SP"
+        public const uint Version = 1;
+
+        public const int HeaderSize = 16;
+        public const int ShaderSize = 68;
+        public const int VariableSize = 36;
+
+        public const uint HasLinkingInfoFlag = 1;
+
+        List<KeyValuePair<string, DxbcShader>> shaders = new List<KeyValuePair<string, DxbcShader>>();
+
+
+        public void AddShader(string name, DxbcShader shader)
+        {
+            if (shaders.Any(existing => existing.Key == name))
+                throw new ArgumentException(string.Format("Duplicate shader name '{0}'.", name));
+
+            shaders.Add(new KeyValuePair<string, DxbcShader>(name, shader));
+        }
+
+
+        public byte[] GetPackage()
+        {
+            // Fixed size tables come first, followed by variable length data (strings, shader code, and constants).
+            int tableSize = HeaderSize + shaders.Count * ShaderSize + shaders.Sum(shader => shader.Value.Variables.Count) * VariableSize;
+
+            var data = new MemoryStream();
+            var tables = new MemoryStream();
+
+            using (var dataWriter = new BinaryWriter(data))
+            using (var writer = new BinaryWriter(tables))
+            {
+                Func<byte[], uint> addData = bytes =>
+                {
+                    // Keep everything 4 byte aligned.
+                    while (data.Length % 4 != 0)
+                    {
+                        dataWriter.Write((byte)0);
+                    }
+
+                    uint offset = (uint)(tableSize + data.Length);
+                    dataWriter.Write(bytes);
+                    return offset;
+                };
+
+                // Header.
+                writer.Write(Magic);
+                writer.Write(Version);
+                writer.Write((uint)shaders.Count);
+                writer.Write((uint)HeaderSize);
+
+                // Shader table.
+                uint variableTableOffset = (uint)(HeaderSize + shaders.Count * ShaderSize);
+
+                foreach (var entry in shaders)
+                {
+                    var shader = entry.Value;
+
+                    writer.Write(shader.Hash.ToByteArray());
+                    writer.Write(addData(Encoding.Unicode.GetBytes(entry.Key)));
+                    writer.Write((uint)entry.Key.Length);
+                    writer.Write(addData(shader.Code));
+                    writer.Write((uint)shader.Code.Length);
+                    writer.Write(addData(shader.DefaultConstants));
+                    writer.Write((uint)shader.DefaultConstants.Length);
+                    writer.Write(variableTableOffset);
+                    writer.Write((uint)shader.Variables.Count);
+                    writer.Write((uint)shader.InputCount);
+                    writer.Write((uint)shader.InstructionCount);
+                    writer.Write((uint)shader.MinFeatureLevel);
+                    writer.Write(shader.HasLinkingInfo ? HasLinkingInfoFlag : 0);
+                    writer.Write((uint)shader.SimpleInputs);
+
+                    variableTableOffset += (uint)(shader.Variables.Count * VariableSize);
+                }
+
+                // Variable tables.
+                foreach (var variable in shaders.SelectMany(entry => entry.Value.Variables))
+                {
+                    writer.Write(addData(Encoding.Unicode.GetBytes(variable.Name)));
+                    writer.Write((uint)variable.Name.Length);
+                    writer.Write((uint)variable.Class);
+                    writer.Write((uint)variable.Type);
+                    writer.Write((uint)variable.Rows);
+                    writer.Write((uint)variable.Columns);
+                    writer.Write((uint)variable.Elements);
+                    writer.Write((uint)variable.Size);
+                    writer.Write((uint)variable.Offset);
+                }
+
+                writer.Flush();
+                dataWriter.Flush();
+
+                if (tables.Length != tableSize)
+                    throw new InvalidOperationException("Shader package layout mismatch.");
+
+                return tables.ToArray().Concat(data.ToArray()).ToArray();
+            }
+        }
+    }
+}
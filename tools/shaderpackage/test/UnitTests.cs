@@ -0,0 +1,439 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+
+namespace ShaderPackage.Test
+{
+    // Builds fixture DXBC bytecode with the same layout as the HLSL compiler emits for ps_4_0.
+    class TestShaderBuilder
+    {
+        public class Variable
+        {
+            public string Name;
+            public int Class;
+            public int Type;
+            public int Rows = 1;
+            public int Columns = 1;
+            public int Elements;
+            public int Members;
+            public int Size = 4;
+            public int Offset;
+            public float[] DefaultValue;
+        }
+
+        public int Version = 0x40;              // ps_4_0
+        public int ConstantBufferSize = 16;
+        public int ConstantBufferBindPoint = 0;
+        public int InstructionCount = 7;
+        public List<int> TextureBindPoints = new List<int>();
+        public List<Variable> Variables = new List<Variable>();
+        public List<string> ExtraChunks = new List<string>();
+
+
+        public byte[] Build()
+        {
+            var chunks = new List<KeyValuePair<string, byte[]>>();
+
+            chunks.Add(new KeyValuePair<string, byte[]>("RDEF", BuildResourceDefinitions()));
+            chunks.Add(new KeyValuePair<string, byte[]>("SHDR", BitConverter.GetBytes(Version).Concat(new byte[4]).ToArray()));
+            chunks.Add(new KeyValuePair<string, byte[]>("STAT", BitConverter.GetBytes(InstructionCount).Concat(new byte[112]).ToArray()));
+
+            foreach (var extraChunk in ExtraChunks)
+            {
+                chunks.Add(new KeyValuePair<string, byte[]>(extraChunk, new byte[8]));
+            }
+
+            var stream = new MemoryStream();
+
+            using (var writer = new BinaryWriter(stream))
+            {
+                int offset = 32 + chunks.Count * 4;
+
+                writer.Write(Encoding.ASCII.GetBytes("DXBC"));
+                writer.Write(new byte[16]);
+                writer.Write(1);
+                writer.Write(offset + chunks.Sum(chunk => chunk.Value.Length + 8));
+                writer.Write(chunks.Count);
+
+                foreach (var chunk in chunks)
+                {
+                    writer.Write(offset);
+                    offset += chunk.Value.Length + 8;
+                }
+
+                foreach (var chunk in chunks)
+                {
+                    writer.Write(Encoding.ASCII.GetBytes(chunk.Key));
+                    writer.Write(chunk.Value.Length);
+                    writer.Write(chunk.Value);
+                }
+
+                writer.Flush();
+                return stream.ToArray();
+            }
+        }
+
+
+        byte[] BuildResourceDefinitions()
+        {
+            const int headerSize = 28;
+            const int bindingSize = 32;
+            const int constantBufferSize = 24;
+            const int variableSize = 24;
+            const int typeSize = 16;
+
+            int bindingCount = TextureBindPoints.Count + 1;
+
+            int bindingOffset = headerSize;
+            int constantBufferOffset = bindingOffset + bindingCount * bindingSize;
+            int variableOffset = constantBufferOffset + constantBufferSize;
+            int typeOffset = variableOffset + Variables.Count * variableSize;
+            int dataOffset = typeOffset + Variables.Count * typeSize;
+
+            var data = new MemoryStream();
+            var dataWriter = new BinaryWriter(data);
+
+            Func<byte[], int> addData = bytes =>
+            {
+                int result = dataOffset + (int)data.Length;
+                dataWriter.Write(bytes);
+                return result;
+            };
+
+            Func<string, int> addString = value => addData(Encoding.ASCII.GetBytes(value + "\0"));
+
+            var stream = new MemoryStream();
+
+            using (var writer = new BinaryWriter(stream))
+            {
+                // Header.
+                writer.Write(1);
+                writer.Write(constantBufferOffset);
+                writer.Write(bindingCount);
+                writer.Write(bindingOffset);
+                writer.Write((byte)(Version & 0xF));
+                writer.Write((byte)((Version >> 4) & 0xF));
+                writer.Write((ushort)0xFFFF);
+                writer.Write(0);
+                writer.Write(addString("Microsoft (R) HLSL Shader Compiler"));
+
+                // Bindings.
+                foreach (var bindPoint in TextureBindPoints)
+                {
+                    WriteBinding(writer, addString("t" + bindPoint), 2, bindPoint);
+                }
+
+                WriteBinding(writer, addString("$Globals"), 0, ConstantBufferBindPoint);
+
+                // Constant buffer.
+                writer.Write(addString("$Globals"));
+                writer.Write(Variables.Count);
+                writer.Write(variableOffset);
+                writer.Write(ConstantBufferSize);
+                writer.Write(0);
+                writer.Write(0);
+
+                // Variables.
+                for (int i = 0; i < Variables.Count; i++)
+                {
+                    var variable = Variables[i];
+
+                    writer.Write(addString(variable.Name));
+                    writer.Write(variable.Offset);
+                    writer.Write(variable.Size);
+                    writer.Write(2);
+                    writer.Write(typeOffset + i * typeSize);
+                    writer.Write(variable.DefaultValue == null ? 0 : addData(variable.DefaultValue.SelectMany(value => BitConverter.GetBytes(value)).ToArray()));
+                }
+
+                // Types.
+                foreach (var variable in Variables)
+                {
+                    writer.Write((ushort)variable.Class);
+                    writer.Write((ushort)variable.Type);
+                    writer.Write((ushort)variable.Rows);
+                    writer.Write((ushort)variable.Columns);
+                    writer.Write((ushort)variable.Elements);
+                    writer.Write((ushort)variable.Members);
+                    writer.Write(0);
+                }
+
+                dataWriter.Flush();
+                writer.Write(data.ToArray());
+                writer.Flush();
+
+                return stream.ToArray();
+            }
+        }
+
+
+        static void WriteBinding(BinaryWriter writer, int nameOffset, int type, int bindPoint)
+        {
+            writer.Write(nameOffset);
+            writer.Write(type);
+            writer.Write(0);
+            writer.Write(0);
+            writer.Write(0);
+            writer.Write(bindPoint);
+            writer.Write(1);
+            writer.Write(0);
+        }
+    }
+
+
+    [TestClass]
+    public class DxbcShaderTests
+    {
+        static TestShaderBuilder MakeBuilder()
+        {
+            var builder = new TestShaderBuilder();
+
+            builder.ConstantBufferSize = 96;
+            builder.TextureBindPoints.Add(0);
+            builder.TextureBindPoints.Add(2);
+
+            builder.Variables.Add(new TestShaderBuilder.Variable { Name = "f", Class = 0, Type = 3, Offset = 0, DefaultValue = new float[] { 23 } });
+            builder.Variables.Add(new TestShaderBuilder.Variable { Name = "b", Class = 0, Type = 1, Offset = 4 });
+            builder.Variables.Add(new TestShaderBuilder.Variable { Name = "v", Class = 1, Type = 3, Columns = 2, Size = 8, Offset = 8 });
+            builder.Variables.Add(new TestShaderBuilder.Variable { Name = "Z", Class = 0, Type = 2, Offset = 16 });
+            builder.Variables.Add(new TestShaderBuilder.Variable { Name = "m", Class = 2, Type = 3, Rows = 4, Columns = 4, Size = 64, Offset = 32, DefaultValue = Enumerable.Range(0, 16).Select(i => (float)i).ToArray() });
+
+            return builder;
+        }
+
+
+        [TestMethod]
+        public void ReadsShaderMetadata()
+        {
+            var code = MakeBuilder().Build();
+            var shader = new DxbcShader(code);
+
+            CollectionAssert.AreEqual(code, shader.Code);
+            Assert.AreEqual(CodeGen.UuidHelper.GetVersion5Uuid(new Guid("489257f6-6544-4277-8982-ead169391f3d"), code), shader.Hash);
+            Assert.AreEqual(3, shader.InputCount);
+            Assert.AreEqual(7, shader.InstructionCount);
+            Assert.AreEqual(0xa000, shader.MinFeatureLevel);
+            Assert.IsTrue(shader.HasLinkingInfo);
+            Assert.AreEqual(0, shader.SimpleInputs);
+
+            // Variables are sorted ordinally, so uppercase comes first.
+            CollectionAssert.AreEqual(new string[] { "Z", "b", "f", "m", "v" }, shader.Variables.Select(variable => variable.Name).ToArray());
+
+            var v = shader.Variables[4];
+
+            Assert.AreEqual(ShaderVariableClass.Vector, v.Class);
+            Assert.AreEqual(ShaderVariableType.Float, v.Type);
+            Assert.AreEqual(1, v.Rows);
+            Assert.AreEqual(2, v.Columns);
+            Assert.AreEqual(0, v.Elements);
+            Assert.AreEqual(8, v.Size);
+            Assert.AreEqual(8, v.Offset);
+        }
+
+
+        [TestMethod]
+        public void ReadsDefaultValues()
+        {
+            var shader = new DxbcShader(MakeBuilder().Build());
+
+            Assert.AreEqual(96, shader.DefaultConstants.Length);
+
+            Func<int, float> constant = index => BitConverter.ToSingle(shader.DefaultConstants, index * 4);
+
+            Assert.AreEqual(23.0f, constant(0));
+            Assert.AreEqual(0.0f, constant(1));
+
+            // Matrix defaults are written by the compiler with rows and columns swapped.
+            for (int i = 0; i < 16; i++)
+            {
+                Assert.AreEqual((float)((i % 4) * 4 + i / 4), constant(8 + i));
+            }
+        }
+
+
+        [TestMethod]
+        public void ReadsFeatureLevelAndLinkingInfo()
+        {
+            var builder = MakeBuilder();
+
+            builder.Version = 0x41;
+            Assert.AreEqual(0xa100, new DxbcShader(builder.Build()).MinFeatureLevel);
+
+            builder.Version = 0x40;
+            builder.ExtraChunks.Add("Aon9");
+            Assert.AreEqual(0x9300, new DxbcShader(builder.Build()).MinFeatureLevel);
+
+            builder.ExtraChunks.Add("PRIV");
+            Assert.IsFalse(new DxbcShader(builder.Build()).HasLinkingInfo);
+        }
+
+
+        [TestMethod]
+        public void RejectsUnsupportedShaders()
+        {
+            // Not DXBC.
+            ExpectInvalidData(new byte[64]);
+
+            // Vertex shader.
+            var builder = MakeBuilder();
+            builder.Version = 0x10040;
+            ExpectInvalidData(builder.Build());
+
+            // Shader model 5.
+            builder = MakeBuilder();
+            builder.Version = 0x50;
+            ExpectInvalidData(builder.Build());
+
+            // Too many textures.
+            builder = MakeBuilder();
+            builder.TextureBindPoints.Add(8);
+            ExpectInvalidData(builder.Build());
+
+            // Constant buffer not in b0.
+            builder = MakeBuilder();
+            builder.ConstantBufferBindPoint = 1;
+            ExpectInvalidData(builder.Build());
+
+            // Struct property.
+            builder = MakeBuilder();
+            builder.Variables[0].Members = 1;
+            ExpectInvalidData(builder.Build());
+
+            // Unsupported property type.
+            builder = MakeBuilder();
+            builder.Variables[0].Type = 5;
+            ExpectInvalidData(builder.Build());
+
+            // Property outside the constant buffer.
+            builder = MakeBuilder();
+            builder.Variables[0].Offset = 96;
+            ExpectInvalidData(builder.Build());
+
+            // Truncated.
+            var code = MakeBuilder().Build();
+            ExpectInvalidData(code.Take(code.Length - 16).ToArray());
+        }
+
+
+        static void ExpectInvalidData(byte[] code)
+        {
+            try
+            {
+                new DxbcShader(code);
+                Assert.Fail("Expected InvalidDataException");
+            }
+            catch (InvalidDataException)
+            {
+            }
+        }
+    }
+
+
+    [TestClass]
+    public class ShaderPackageWriterTests
+    {
+        [TestMethod]
+        public void WritesPackageLayout()
+        {
+            var builder = new TestShaderBuilder();
+            builder.Variables.Add(new TestShaderBuilder.Variable { Name = "value", Class = 0, Type = 3, DefaultValue = new float[] { 42 } });
+
+            var shader1 = new DxbcShader(builder.Build());
+
+            builder.ExtraChunks.Add("PRIV");
+            builder.TextureBindPoints.Add(1);
+
+            var shader2 = new DxbcShader(builder.Build());
+
+            var writer = new ShaderPackageWriter();
+
+            writer.AddShader("First", shader1);
+            writer.AddShader("Second", shader2);
+
+            var package = writer.GetPackage();
+            Func<int, uint> readUInt = offset => BitConverter.ToUInt32(package, offset);
+
+            Func<int, int, string> readString = (offset, length) =>
+            {
+                Assert.AreEqual(0, offset % 4);
+                return Encoding.Unicode.GetString(package, offset, length * 2);
+            };
+
+            Func<int, int, byte[]> readBytes = (offset, length) =>
+            {
+                Assert.AreEqual(0, offset % 4);
+                return package.Skip(offset).Take(length).ToArray();
+            };
+
+            // Header.
+            Assert.AreEqual(ShaderPackageWriter.Magic, readUInt(0));
+            Assert.AreEqual(ShaderPackageWriter.Version, readUInt(4));
+            Assert.AreEqual(2u, readUInt(8));
+            Assert.AreEqual(16u, readUInt(12));
+
+            // Shader table.
+            var shaders = new DxbcShader[] { shader1, shader2 };
+            var names = new string[] { "First", "Second" };
+
+            for (int i = 0; i < 2; i++)
+            {
+                int entry = 16 + i * ShaderPackageWriter.ShaderSize;
+
+                CollectionAssert.AreEqual(shaders[i].Hash.ToByteArray(), readBytes(entry, 16));
+                Assert.AreEqual(names[i], readString((int)readUInt(entry + 16), (int)readUInt(entry + 20)));
+                CollectionAssert.AreEqual(shaders[i].Code, readBytes((int)readUInt(entry + 24), (int)readUInt(entry + 28)));
+                CollectionAssert.AreEqual(shaders[i].DefaultConstants, readBytes((int)readUInt(entry + 32), (int)readUInt(entry + 36)));
+                Assert.AreEqual(1u, readUInt(entry + 44));
+                Assert.AreEqual((uint)shaders[i].InputCount, readUInt(entry + 48));
+                Assert.AreEqual(7u, readUInt(entry + 52));
+                Assert.AreEqual(0xa000u, readUInt(entry + 56));
+                Assert.AreEqual(shaders[i].HasLinkingInfo ? 1u : 0u, readUInt(entry + 60));
+                Assert.AreEqual(0u, readUInt(entry + 64));
+
+                // Variable table.
+                int variable = (int)readUInt(entry + 40);
+
+                Assert.AreEqual(16 + 2 * ShaderPackageWriter.ShaderSize + i * ShaderPackageWriter.VariableSize, variable);
+                Assert.AreEqual("value", readString((int)readUInt(variable), (int)readUInt(variable + 4)));
+                Assert.AreEqual(0u, readUInt(variable + 8));
+                Assert.AreEqual(3u, readUInt(variable + 12));
+                Assert.AreEqual(1u, readUInt(variable + 16));
+                Assert.AreEqual(1u, readUInt(variable + 20));
+                Assert.AreEqual(0u, readUInt(variable + 24));
+                Assert.AreEqual(4u, readUInt(variable + 28));
+                Assert.AreEqual(0u, readUInt(variable + 32));
+            }
+
+            Assert.AreEqual(0u, readUInt(16 + 48));
+            Assert.AreEqual(2u, readUInt(16 + ShaderPackageWriter.ShaderSize + 48));
+            Assert.AreEqual(42.0f, BitConverter.ToSingle(package, (int)readUInt(16 + 32)));
+        }
+
+
+        [TestMethod]
+        public void RejectsDuplicateNames()
+        {
+            var shader = new DxbcShader(new TestShaderBuilder().Build());
+
+            var writer = new ShaderPackageWriter();
+
+            writer.AddShader("Shader", shader);
+
+            try
+            {
+                writer.AddShader("Shader", shader);
+                Assert.Fail("Expected ArgumentException");
+            }
+            catch (ArgumentException)
+            {
+            }
+        }
+    }
+}
@@ -323,6 +323,47 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         return !!m_isID2D1Factory5Supported;
     }
 
+    static std::atomic<uint32_t>& DeviceContextPoolSizeSetting()
+    {
+        static std::atomic<uint32_t> value(DeviceContextPool::GetDefaultMaximumSize());
+
+        return value;
+    }
+
+    uint32_t SharedDeviceState::GetDeviceContextPoolSize()
+    {
+        return DeviceContextPoolSizeSetting();
+    }
+
+    void SharedDeviceState::SetDeviceContextPoolSize(uint32_t value)
+    {
+        if (value > DeviceContextPool::MaximumSizeLimit)
+            ThrowHR(E_INVALIDARG);
+
+        DeviceContextPoolSizeSetting() = value;
+    }
+
+    static std::atomic<uint32_t>& DeviceContextPoolPrewarmCountSetting()
+    {
+        static std::atomic<uint32_t> value(0);
+
+        return value;
+    }
+
+    uint32_t SharedDeviceState::GetDeviceContextPoolPrewarmCount()
+    {
+        return DeviceContextPoolPrewarmCountSetting();
+    }
+
+    void SharedDeviceState::SetDeviceContextPoolPrewarmCount(uint32_t value)
+    {
+        // The pool never holds more than its size, so larger counts cannot be honored.
+        if (value > DeviceContextPool::MaximumSizeLimit)
+            ThrowHR(E_INVALIDARG);
+
+        DeviceContextPoolPrewarmCountSetting() = value;
+    }
+
 
     //
     // CanvasDeviceFactory
@@ -415,6 +456,46 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             });
     }
 
+    IFACEMETHODIMP CanvasDeviceFactory::put_DeviceContextPoolSize(uint32_t value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                SharedDeviceState::SetDeviceContextPoolSize(value);
+            });
+    }
+
+    IFACEMETHODIMP CanvasDeviceFactory::get_DeviceContextPoolSize(uint32_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                *value = SharedDeviceState::GetDeviceContextPoolSize();
+            });
+    }
+
+    IFACEMETHODIMP CanvasDeviceFactory::put_DeviceContextPoolPrewarmCount(uint32_t value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                SharedDeviceState::SetDeviceContextPoolPrewarmCount(value);
+            });
+    }
+
+    IFACEMETHODIMP CanvasDeviceFactory::get_DeviceContextPoolPrewarmCount(uint32_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                *value = SharedDeviceState::GetDeviceContextPoolPrewarmCount();
+            });
+    }
+
 
     //
     // ICanvasFactoryNative.
@@ -450,7 +531,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         , m_forceSoftwareRenderer(forceSoftwareRenderer)
         , m_dxgiDevice(dxgiDevice)
         , m_sharedState(SharedDeviceState::GetInstance())
-        , m_deviceContextPool(d2dDevice)
+        , m_deviceContextPool(d2dDevice, SharedDeviceState::GetDeviceContextPoolSize())
 #if WINVER > _WIN32_WINNT_WINBLUE
         , m_spriteBatchQuirk(SpriteBatchQuirk::NeedsCheck)
 #endif
@@ -462,6 +543,18 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         }
 
         InitializePrimaryOutput(dxgiDevice);
+
+        // Creating contexts now means the first wave of work on other threads
+        // does not all queue up waiting to create one. If the device is lost
+        // already, the app finds out from its first use of the device, as usual:
+        // leases create contexts on demand and report the error at that point.
+        try
+        {
+            m_deviceContextPool.Prewarm(SharedDeviceState::GetDeviceContextPoolPrewarmCount());
+        }
+        catch (DeviceLostException const&)
+        {
+        }
     }
 
     ComPtr<CanvasDevice> CanvasDevice::CreateNew(
@@ -633,6 +726,24 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             });
     }
 
+    IFACEMETHODIMP CanvasDevice::get_DeviceContextPoolStatistics(CanvasDeviceContextPoolStatistics* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                auto statistics = m_deviceContextPool.GetStatistics();
+
+                value->LeasesTaken = statistics.LeasesTaken;
+                value->DeviceContextsCreated = statistics.DeviceContextsCreated;
+                value->DeviceContextsDiscarded = statistics.DeviceContextsDiscarded;
+                value->ActiveLeaseCount = statistics.ActiveLeaseCount;
+                value->PeakActiveLeaseCount = statistics.PeakActiveLeaseCount;
+                value->AverageLeaseMicroseconds = statistics.AverageLeaseMicroseconds;
+            });
+    }
+
     IFACEMETHODIMP CanvasDevice::add_DeviceLost(
         DeviceLostHandlerType* value, 
         EventRegistrationToken* token)
@@ -718,6 +829,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             [&]
             {
                 m_deviceContextPool.Close();
+                m_effectPool.Close();
+                m_pixelReadbackQueue.Close();
+                m_stagingBitmapPool.Close();
+                m_decodedBitmapCache.Close();
+                m_transientRenderTargetPool.Close();
                 ThrowIfFailed(this->ResourceWrapper::Close()); // 'this->' is workaround for VS2013 calling with bad 'this' pointer
 
                 m_dxgiDevice.Close();
@@ -1016,6 +1132,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
                 auto& d2dDevice = GetResource();
                 auto& dxgiDevice = m_dxgiDevice.EnsureNotClosed();
 
+                m_decodedBitmapCache.Clear();
+                m_transientRenderTargetPool.Trim();
+                m_stagingBitmapPool.Trim();
+
                 D2DResourceLock lock(d2dDevice.Get());
 
                 d2dDevice->ClearResources();
@@ -1412,6 +1532,154 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         InterlockedExchangeComPtr(m_atlasEffect, std::move(effects.AtlasEffect));
     }
 
+    ComPtr<ID2D1Effect> CanvasDevice::LeaseEffect(ID2D1DeviceContext* d2dContext, IID const& effectId)
+    {
+        if (auto effect = m_effectPool.TryTakeEffect(effectId))
+            return effect;
+
+        // Only look up a resource creation device context if we actually need to create something.
+        DeviceContextLease contextLease;
+
+        if (!d2dContext)
+        {
+            contextLease = m_deviceContextPool.TakeLease();
+            d2dContext = contextLease.Get();
+        }
+
+        return m_effectPool.CreateEffect(d2dContext, effectId);
+    }
+
+    void CanvasDevice::ReleaseEffect(IID const& effectId, ComPtr<ID2D1Effect>&& effect, bool isShared)
+    {
+        m_effectPool.ReturnEffect(effectId, std::move(effect), isShared);
+    }
+
+    uint32_t CanvasDevice::GetMaximumEffectPoolSize()
+    {
+        return m_effectPool.GetMaximumSize();
+    }
+
+    void CanvasDevice::SetMaximumEffectPoolSize(uint32_t value)
+    {
+        m_effectPool.SetMaximumSize(value);
+    }
+
+    EffectPoolStatistics CanvasDevice::GetEffectPoolStatistics()
+    {
+        return m_effectPool.GetStatistics();
+    }
+
+    DeviceContextPoolStatistics CanvasDevice::GetDeviceContextPoolStatistics()
+    {
+        return m_deviceContextPool.GetStatistics();
+    }
+
+    StagingBitmapLease CanvasDevice::LeaseStagingBitmap(D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format)
+    {
+        auto deviceContext = m_deviceContextPool.TakeLease();
+
+        return m_stagingBitmapPool.TakeLease(deviceContext.Get(), size, format);
+    }
+
+    StagingBitmapPoolStatistics CanvasDevice::GetStagingBitmapPoolStatistics()
+    {
+        return m_stagingBitmapPool.GetStatistics();
+    }
+
+    PixelReadbackFuture CanvasDevice::EnqueuePixelReadback(ICanvasBitmap* bitmap, D2D1_RECT_U const& subRectangle)
+    {
+        return m_pixelReadbackQueue.Enqueue(bitmap, subRectangle);
+    }
+
+    ComPtr<ID2D1Bitmap1> CanvasDevice::FindDecodedBitmap(std::wstring const& key)
+    {
+        return m_decodedBitmapCache.Find(key);
+    }
+
+    ComPtr<ID2D1Bitmap1> CanvasDevice::AddDecodedBitmap(std::wstring const& key, ID2D1Bitmap1* bitmap)
+    {
+        return m_decodedBitmapCache.Add(key, bitmap);
+    }
+
+    uint64_t CanvasDevice::GetMaximumDecodedBitmapCacheBytes()
+    {
+        return m_decodedBitmapCache.GetMaximumBytes();
+    }
+
+    void CanvasDevice::SetMaximumDecodedBitmapCacheBytes(uint64_t value)
+    {
+        m_decodedBitmapCache.SetMaximumBytes(value);
+    }
+
+    DecodedBitmapCacheStatistics CanvasDevice::GetDecodedBitmapCacheStatistics()
+    {
+        return m_decodedBitmapCache.GetStatistics();
+    }
+
+    TransientRenderTargetLease CanvasDevice::LeaseTransientRenderTarget(
+        float width,
+        float height,
+        float dpi,
+        DirectXPixelFormat format,
+        CanvasAlphaMode alpha)
+    {
+        auto pixelWidth = static_cast<uint32_t>(SizeDipsToPixels(width, dpi));
+        auto pixelHeight = static_cast<uint32_t>(SizeDipsToPixels(height, dpi));
+
+        auto pixelFormat = D2D1::PixelFormat(static_cast<DXGI_FORMAT>(format), ToD2DAlphaMode(alpha));
+
+        D2D1_SIZE_U pixelSize{ pixelWidth, pixelHeight };
+
+        try
+        {
+            // Only take a device context if a new bitmap has to be created.
+            auto lease = m_transientRenderTargetPool.TryTakePooledLease(pixelSize, pixelFormat, dpi);
+
+            if (lease.Get())
+                return lease;
+
+            auto deviceContext = GetResourceCreationDeviceContext();
+
+            return m_transientRenderTargetPool.TakeLease(deviceContext.Get(), pixelSize, pixelFormat, dpi);
+        }
+        catch (HResultException const& e)
+        {
+            // Report oversized render targets the same way as CreateRenderTargetBitmap.
+            ThrowIfCreateSurfaceFailed(e.GetHr(), L"CanvasRenderTarget", pixelWidth, pixelHeight);
+            throw;
+        }
+    }
+
+    void CanvasDevice::EndTransientRenderTargetFrame()
+    {
+        m_transientRenderTargetPool.EndFrame();
+    }
+
+    uint64_t CanvasDevice::GetMaximumTransientRenderTargetBytes()
+    {
+        return m_transientRenderTargetPool.GetMaximumBytes();
+    }
+
+    void CanvasDevice::SetMaximumTransientRenderTargetBytes(uint64_t value)
+    {
+        m_transientRenderTargetPool.SetMaximumBytes(value);
+    }
+
+    uint32_t CanvasDevice::GetMaximumTransientRenderTargetIdleFrames()
+    {
+        return m_transientRenderTargetPool.GetMaximumIdleFrames();
+    }
+
+    void CanvasDevice::SetMaximumTransientRenderTargetIdleFrames(uint32_t value)
+    {
+        m_transientRenderTargetPool.SetMaximumIdleFrames(value);
+    }
+
+    TransientRenderTargetPoolStatistics CanvasDevice::GetTransientRenderTargetPoolStatistics()
+    {
+        return m_transientRenderTargetPool.GetStatistics();
+    }
+
 #if WINVER > _WIN32_WINNT_WINBLUE
 
     ComPtr<ID2D1GradientMesh> CanvasDevice::CreateGradientMesh(
@@ -5,6 +5,11 @@
 #pragma once
 
 #include "DeviceContextPool.h"
+#include "EffectPool.h"
+#include "StagingBitmapPool.h"
+#include "DecodedBitmapCache.h"
+#include "TransientRenderTargetPool.h"
+#include "images/PixelReadbackQueue.h"
 
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 {
@@ -172,6 +177,51 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         virtual HistogramAndAtlasEffects LeaseHistogramEffect(ID2D1DeviceContext* d2dContext) = 0;
         virtual void ReleaseHistogramEffect(HistogramAndAtlasEffects&& effects) = 0;
 
+        // Pooled D2D effect instances. If d2dContext is null and there is no pooled
+        // instance of the requested effect, a resource creation context is used.
+        // Released effects are only pooled if the caller is their last holder.
+        virtual ComPtr<ID2D1Effect> LeaseEffect(ID2D1DeviceContext* d2dContext, IID const& effectId) = 0;
+        virtual void ReleaseEffect(IID const& effectId, ComPtr<ID2D1Effect>&& effect, bool isShared) = 0;
+
+        virtual uint32_t GetMaximumEffectPoolSize() = 0;
+        virtual void SetMaximumEffectPoolSize(uint32_t value) = 0;
+
+        virtual EffectPoolStatistics GetEffectPoolStatistics() = 0;
+
+        virtual DeviceContextPoolStatistics GetDeviceContextPoolStatistics() = 0;
+
+        // Pooled CPU readable bitmaps, used as the destination when reading back pixels.
+        virtual StagingBitmapLease LeaseStagingBitmap(D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format) = 0;
+
+        virtual StagingBitmapPoolStatistics GetStagingBitmapPoolStatistics() = 0;
+
+        // Starts copying pixels to a staging bitmap, on a queue shared by every
+        // readback from this device. See PixelReadbackQueue.
+        virtual PixelReadbackFuture EnqueuePixelReadback(ICanvasBitmap* bitmap, D2D1_RECT_U const& subRectangle) = 0;
+
+        // Bitmaps that have already been decoded, shared by loads of the same image.
+        virtual ComPtr<ID2D1Bitmap1> FindDecodedBitmap(std::wstring const& key) = 0;
+        virtual ComPtr<ID2D1Bitmap1> AddDecodedBitmap(std::wstring const& key, ID2D1Bitmap1* bitmap) = 0;
+
+        virtual uint64_t GetMaximumDecodedBitmapCacheBytes() = 0;
+        virtual void SetMaximumDecodedBitmapCacheBytes(uint64_t value) = 0;
+
+        virtual DecodedBitmapCacheStatistics GetDecodedBitmapCacheStatistics() = 0;
+
+        // Pooled render target bitmaps, for intermediate passes that are
+        // recreated every frame. EndTransientRenderTargetFrame should be
+        // called once per frame so that unused sizes are released.
+        virtual TransientRenderTargetLease LeaseTransientRenderTarget(float width, float height, float dpi, DirectXPixelFormat format, CanvasAlphaMode alpha) = 0;
+        virtual void EndTransientRenderTargetFrame() = 0;
+
+        virtual uint64_t GetMaximumTransientRenderTargetBytes() = 0;
+        virtual void SetMaximumTransientRenderTargetBytes(uint64_t value) = 0;
+
+        virtual uint32_t GetMaximumTransientRenderTargetIdleFrames() = 0;
+        virtual void SetMaximumTransientRenderTargetIdleFrames(uint32_t value) = 0;
+
+        virtual TransientRenderTargetPoolStatistics GetTransientRenderTargetPoolStatistics() = 0;
+
 #if WINVER > _WIN32_WINNT_WINBLUE
         virtual ComPtr<ID2D1GradientMesh> CreateGradientMesh(D2D1_GRADIENT_MESH_PATCH const* patches, uint32_t patchCount) = 0;
 
@@ -214,6 +264,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         std::shared_ptr<SharedDeviceState> m_sharedState;
 
         DeviceContextPool m_deviceContextPool;
+        EffectPool m_effectPool;
+        StagingBitmapPool m_stagingBitmapPool;
+        PixelReadbackQueue m_pixelReadbackQueue;
+        DecodedBitmapCache m_decodedBitmapCache;
+        TransientRenderTargetPool m_transientRenderTargetPool;
 
         ComPtr<ID2D1Effect> m_histogramEffect;
         ComPtr<ID2D1Effect> m_atlasEffect;
@@ -258,6 +313,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         IFACEMETHOD(get_LowPriority)(boolean* value) override;
         IFACEMETHOD(put_LowPriority)(boolean value) override;
 
+        IFACEMETHOD(get_DeviceContextPoolStatistics)(CanvasDeviceContextPoolStatistics* value) override;
+
         IFACEMETHOD(add_DeviceLost)(DeviceLostHandlerType* value, EventRegistrationToken* token) override;
 
         IFACEMETHOD(remove_DeviceLost)(EventRegistrationToken token) override;
@@ -378,6 +435,41 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         virtual HistogramAndAtlasEffects LeaseHistogramEffect(ID2D1DeviceContext* d2dContext) override;
         virtual void ReleaseHistogramEffect(HistogramAndAtlasEffects&& effects) override;
 
+        virtual ComPtr<ID2D1Effect> LeaseEffect(ID2D1DeviceContext* d2dContext, IID const& effectId) override;
+        virtual void ReleaseEffect(IID const& effectId, ComPtr<ID2D1Effect>&& effect, bool isShared) override;
+
+        virtual uint32_t GetMaximumEffectPoolSize() override;
+        virtual void SetMaximumEffectPoolSize(uint32_t value) override;
+
+        virtual EffectPoolStatistics GetEffectPoolStatistics() override;
+
+        virtual DeviceContextPoolStatistics GetDeviceContextPoolStatistics() override;
+
+        virtual StagingBitmapLease LeaseStagingBitmap(D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format) override;
+
+        virtual StagingBitmapPoolStatistics GetStagingBitmapPoolStatistics() override;
+
+        virtual PixelReadbackFuture EnqueuePixelReadback(ICanvasBitmap* bitmap, D2D1_RECT_U const& subRectangle) override;
+
+        virtual ComPtr<ID2D1Bitmap1> FindDecodedBitmap(std::wstring const& key) override;
+        virtual ComPtr<ID2D1Bitmap1> AddDecodedBitmap(std::wstring const& key, ID2D1Bitmap1* bitmap) override;
+
+        virtual uint64_t GetMaximumDecodedBitmapCacheBytes() override;
+        virtual void SetMaximumDecodedBitmapCacheBytes(uint64_t value) override;
+
+        virtual DecodedBitmapCacheStatistics GetDecodedBitmapCacheStatistics() override;
+
+        virtual TransientRenderTargetLease LeaseTransientRenderTarget(float width, float height, float dpi, DirectXPixelFormat format, CanvasAlphaMode alpha) override;
+        virtual void EndTransientRenderTargetFrame() override;
+
+        virtual uint64_t GetMaximumTransientRenderTargetBytes() override;
+        virtual void SetMaximumTransientRenderTargetBytes(uint64_t value) override;
+
+        virtual uint32_t GetMaximumTransientRenderTargetIdleFrames() override;
+        virtual void SetMaximumTransientRenderTargetIdleFrames(uint32_t value) override;
+
+        virtual TransientRenderTargetPoolStatistics GetTransientRenderTargetPoolStatistics() override;
+
 #if WINVER > _WIN32_WINNT_WINBLUE
         virtual ComPtr<ID2D1GradientMesh> CreateGradientMesh(D2D1_GRADIENT_MESH_PATCH const* patches, uint32_t patchCount) override;
 
@@ -455,6 +547,16 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
         bool IsID2D1Factory5Supported();
 
+        // Settings for the device context pool of each new CanvasDevice. Unlike the rest
+        // of this class, they are kept for the life of the process, since they must be
+        // remembered even while no device (and so no SharedDeviceState) exists.
+        static uint32_t GetDeviceContextPoolSize();
+        static void SetDeviceContextPoolSize(uint32_t value);
+
+        // How many resource creation device contexts are created up front.
+        static uint32_t GetDeviceContextPoolPrewarmCount();
+        static void SetDeviceContextPoolPrewarmCount(uint32_t value);
+
         CanvasDeviceAdapter* GetAdapter() const { return m_adapter.get(); }
 
     private:
@@ -515,6 +617,12 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         IFACEMETHOD(put_DebugLevel)(CanvasDebugLevel debugLevel);
         IFACEMETHOD(get_DebugLevel)(CanvasDebugLevel* debugLevel);
 
+        IFACEMETHOD(put_DeviceContextPoolSize)(uint32_t value);
+        IFACEMETHOD(get_DeviceContextPoolSize)(uint32_t* value);
+
+        IFACEMETHOD(put_DeviceContextPoolPrewarmCount)(uint32_t value);
+        IFACEMETHOD(get_DeviceContextPoolPrewarmCount)(uint32_t* value);
+
         //
         // ICanvasFactoryNative.
         //
@@ -451,6 +451,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
                 DXGI_PRESENT_PARAMETERS presentParameters = { 0 };
                 ThrowIfFailed(resource->Present1(syncInterval, 0, &presentParameters));
+
+                // Presenting marks the end of a frame, after which transient
+                // render targets that have not been reused for a while are
+                // released.
+                As<ICanvasDeviceInternal>(m_device.EnsureNotClosed())->EndTransientRenderTargetFrame();
             });
     }
 
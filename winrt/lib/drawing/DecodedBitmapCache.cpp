@@ -0,0 +1,155 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "DecodedBitmapCache.h"
+
+
+//
+// DecodedBitmapCache implementation
+//
+
+
+DecodedBitmapCache::DecodedBitmapCache(uint64_t maximumBytes)
+    : m_closed(false)
+    , m_maximumBytes(maximumBytes)
+    , m_cachedBytes(0)
+    , m_statistics{}
+{
+}
+
+
+ComPtr<ID2D1Bitmap1> DecodedBitmapCache::Find(std::wstring const& key)
+{
+    Lock lock(m_mutex);
+
+    auto it = m_index.find(key);
+
+    if (it == m_index.end())
+    {
+        m_statistics.Misses++;
+        return nullptr;
+    }
+
+    // Move to the most recently used end.
+    m_cachedBitmaps.splice(m_cachedBitmaps.end(), m_cachedBitmaps, it->second);
+
+    m_statistics.Hits++;
+    m_statistics.BytesSaved += it->second->Bytes;
+
+    return it->second->Bitmap;
+}
+
+
+ComPtr<ID2D1Bitmap1> DecodedBitmapCache::Add(std::wstring const& key, ID2D1Bitmap1* bitmap)
+{
+    assert(bitmap);
+
+    auto bytes = GetBitmapBytes(bitmap);
+
+    Lock lock(m_mutex);
+
+    auto it = m_index.find(key);
+
+    if (it != m_index.end())
+    {
+        m_cachedBitmaps.splice(m_cachedBitmaps.end(), m_cachedBitmaps, it->second);
+        return it->second->Bitmap;
+    }
+
+    if (m_closed || bytes > m_maximumBytes)
+        return bitmap;
+
+    // Make room by evicting the least recently used bitmaps.
+    TrimToSize(m_maximumBytes - bytes);
+
+    m_cachedBitmaps.push_back(CachedBitmap{ key, bytes, bitmap });
+    m_index[key] = std::prev(m_cachedBitmaps.end());
+    m_cachedBytes += bytes;
+
+    return bitmap;
+}
+
+
+uint64_t DecodedBitmapCache::GetMaximumBytes()
+{
+    Lock lock(m_mutex);
+
+    return m_maximumBytes;
+}
+
+
+void DecodedBitmapCache::SetMaximumBytes(uint64_t value)
+{
+    Lock lock(m_mutex);
+
+    m_maximumBytes = value;
+
+    TrimToSize(m_maximumBytes);
+}
+
+
+DecodedBitmapCacheStatistics DecodedBitmapCache::GetStatistics()
+{
+    Lock lock(m_mutex);
+
+    auto statistics = m_statistics;
+    statistics.CachedBitmapCount = static_cast<uint32_t>(m_cachedBitmaps.size());
+    statistics.CachedBytes = m_cachedBytes;
+    return statistics;
+}
+
+
+void DecodedBitmapCache::Clear()
+{
+    Lock lock(m_mutex);
+
+    m_cachedBitmaps.clear();
+    m_index.clear();
+    m_cachedBytes = 0;
+}
+
+
+void DecodedBitmapCache::Close()
+{
+    Lock lock(m_mutex);
+
+    m_cachedBitmaps.clear();
+    m_index.clear();
+    m_cachedBytes = 0;
+    m_closed = true;
+}
+
+
+uint64_t DecodedBitmapCache::GetBitmapBytes(ID2D1Bitmap1* bitmap)
+{
+    auto size = bitmap->GetPixelSize();
+    auto format = bitmap->GetPixelFormat().format;
+
+    auto blockSize = ABI::Microsoft::Graphics::Canvas::GetBlockSize(format);
+    auto bytesPerBlock = ABI::Microsoft::Graphics::Canvas::GetBytesPerBlock(format);
+
+    auto blocksWide = (static_cast<uint64_t>(size.width) + blockSize - 1) / blockSize;
+    auto blocksHigh = (static_cast<uint64_t>(size.height) + blockSize - 1) / blockSize;
+
+    return blocksWide * blocksHigh * bytesPerBlock;
+}
+
+
+void DecodedBitmapCache::TrimToSize(uint64_t bytes)
+{
+    while (m_cachedBytes > bytes)
+    {
+        assert(!m_cachedBitmaps.empty());
+
+        auto& oldest = m_cachedBitmaps.front();
+
+        m_cachedBytes -= oldest.Bytes;
+        m_index.erase(oldest.Key);
+        m_cachedBitmaps.pop_front();
+
+        m_statistics.BitmapsEvicted++;
+    }
+}
@@ -0,0 +1,88 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "utils/LockUtilities.h"
+
+using namespace Microsoft::WRL;
+
+struct DecodedBitmapCacheStatistics
+{
+    uint64_t Hits;
+    uint64_t Misses;
+    uint64_t BitmapsEvicted;
+
+    // Total size of the decoded pixels that hits did not have to decode and upload again.
+    uint64_t BytesSaved;
+
+    uint32_t CachedBitmapCount;
+    uint64_t CachedBytes;
+};
+
+
+//
+// Per-device cache of bitmaps that have already been decoded and uploaded, so
+// that loading the same image again from another code path returns the
+// existing bitmap rather than reading, decoding and uploading it all over.
+//
+// The cache doesn't know how images are identified. Callers look bitmaps up by
+// a key that must change whenever the image content does, such as a file path
+// plus its modification time, or a hash of a stream's contents, combined with
+// anything else that affects the decoded bitmap (DPI, alpha mode).
+//
+// Cached bitmaps are kept in least recently used order, and the oldest are
+// evicted once their total size exceeds the maximum.
+//
+class DecodedBitmapCache
+{
+    struct CachedBitmap
+    {
+        std::wstring Key;
+        uint64_t Bytes;
+        ComPtr<ID2D1Bitmap1> Bitmap;
+    };
+
+    typedef std::list<CachedBitmap> CachedBitmapList;
+
+    std::mutex m_mutex;
+    bool m_closed;
+    uint64_t m_maximumBytes;
+    uint64_t m_cachedBytes;
+
+    // Ordered from least to most recently used.
+    CachedBitmapList m_cachedBitmaps;
+    std::unordered_map<std::wstring, CachedBitmapList::iterator> m_index;
+
+    DecodedBitmapCacheStatistics m_statistics;
+
+public:
+    static const uint64_t DefaultMaximumBytes = 128 * 1024 * 1024;
+
+    DecodedBitmapCache(uint64_t maximumBytes = DefaultMaximumBytes);
+
+    DecodedBitmapCache(DecodedBitmapCache const&) = delete;
+    DecodedBitmapCache& operator=(DecodedBitmapCache const&) = delete;
+
+    // Returns null, and counts a miss, if nothing is cached under key.
+    ComPtr<ID2D1Bitmap1> Find(std::wstring const& key);
+
+    // Returns the bitmap that is now cached under key. If another caller
+    // raced to add the same key first, this is their bitmap rather than
+    // the one passed in, so that everybody shares a single copy.
+    ComPtr<ID2D1Bitmap1> Add(std::wstring const& key, ID2D1Bitmap1* bitmap);
+
+    uint64_t GetMaximumBytes();
+    void SetMaximumBytes(uint64_t value);
+
+    DecodedBitmapCacheStatistics GetStatistics();
+
+    void Clear();
+    void Close();
+
+    static uint64_t GetBitmapBytes(ID2D1Bitmap1* bitmap);
+
+private:
+    void TrimToSize(uint64_t bytes);
+};
@@ -12,70 +12,260 @@
 //
 
 
-DeviceContextPool::DeviceContextPool(ID2D1Device1* d2dDevice)
+static int64_t GetTimestamp()
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+
+DeviceContextPool::DeviceContextPool(ID2D1Device1* d2dDevice, unsigned maximumSize)
     : m_d2dDevice(d2dDevice)
+    , m_closed(false)
+    , m_slots(new std::atomic<ID2D1DeviceContext1*>[maximumSize])
+    , m_maximumSize(maximumSize)
+    , m_leasesTaken(0)
+    , m_deviceContextsCreated(0)
+    , m_deviceContextsDiscarded(0)
+    , m_leasesReturned(0)
+    , m_totalLeaseTicks(0)
+    , m_activeLeaseCount(0)
+    , m_peakActiveLeaseCount(0)
 {
+    for (unsigned i = 0; i < m_maximumSize; i++)
+    {
+        m_slots[i] = nullptr;
+    }
 }
 
 
-DeviceContextLease DeviceContextPool::TakeLease()
+DeviceContextPool::~DeviceContextPool()
 {
-    Lock lock(m_mutex);
+    ReleasePooledDeviceContexts();
+}
 
-    if (!m_d2dDevice)
+
+//
+// When a leased device context is returned it is added back to the pool,
+// unless the pool has reached its maximum size, in which the context is
+// destroyed.  This is to give the pool a chance to shrink back down to a
+// reasonable size if there is ever any large scale concurrency going on.
+//
+// Default max pool size is picked from number of CPUs - reasoning being that
+// you should expect to be able to have that many threads running and reusing
+// contexts without recreating them.
+//
+unsigned DeviceContextPool::GetDefaultMaximumSize()
+{
+    static auto defaultMaximumSize = std::max(std::thread::hardware_concurrency(), 1U);
+
+    return defaultMaximumSize;
+}
+
+
+DeviceContextLease DeviceContextPool::TakeLease()
+{
+    if (m_closed)
         ThrowHR(RO_E_CLOSED);
-    
-    if (m_deviceContexts.empty())
+
+    //
+    // Fast path: reuse a pooled context, starting with this thread's home slot.
+    //
+    auto homeSlot = GetHomeSlot();
+
+    for (unsigned i = 0; i < m_maximumSize; i++)
     {
-        ComPtr<ID2D1DeviceContext1> deviceContext;
-        ThrowIfFailed(m_d2dDevice->CreateDeviceContext(
-            D2D1_DEVICE_CONTEXT_OPTIONS_NONE,
-            &deviceContext));
-        return DeviceContextLease(this, std::move(deviceContext));
+        auto& slot = m_slots[(homeSlot + i) % m_maximumSize];
+
+        if (!slot.load(std::memory_order_relaxed))
+            continue;
+
+        if (auto pooledContext = slot.exchange(nullptr))
+        {
+            ComPtr<ID2D1DeviceContext1> deviceContext;
+            deviceContext.Attach(pooledContext);
+            return MakeLease(std::move(deviceContext));
+        }
     }
-    else
+
+    //
+    // Slow path: the pool is empty, so create a new context.
+    //
+    return MakeLease(CreateDeviceContext());
+}
+
+
+DeviceContextLease DeviceContextPool::MakeLease(ComPtr<ID2D1DeviceContext1>&& deviceContext)
+{
+    m_leasesTaken++;
+
+    auto activeLeaseCount = ++m_activeLeaseCount;
+    auto peakActiveLeaseCount = m_peakActiveLeaseCount.load();
+
+    while (activeLeaseCount > peakActiveLeaseCount &&
+           !m_peakActiveLeaseCount.compare_exchange_weak(peakActiveLeaseCount, activeLeaseCount))
     {
-        DeviceContextLease newLease(this, std::move(m_deviceContexts.back()));
-        m_deviceContexts.pop_back();
-        return newLease;
     }
+
+    return DeviceContextLease(this, std::move(deviceContext), GetTimestamp());
 }
 
 
-void DeviceContextPool::ReturnLease(ComPtr<ID2D1DeviceContext1>&& deviceContext)
+ComPtr<ID2D1DeviceContext1> DeviceContextPool::CreateDeviceContext()
+{
+    Lock lock(m_mutex);
+
+    if (!m_d2dDevice)
+        ThrowHR(RO_E_CLOSED);
+    
+    ComPtr<ID2D1DeviceContext1> deviceContext;
+    ThrowIfFailed(m_d2dDevice->CreateDeviceContext(
+        D2D1_DEVICE_CONTEXT_OPTIONS_NONE,
+        &deviceContext));
+
+    m_deviceContextsCreated++;
+
+    return deviceContext;
+}
+
+
+void DeviceContextPool::ReturnLease(ComPtr<ID2D1DeviceContext1>&& deviceContext, int64_t leaseStartTime)
 {
     if (!deviceContext)
         return;
-        
-    Lock lock(m_mutex);
 
+    m_activeLeaseCount--;
+    m_leasesReturned++;
+    m_totalLeaseTicks += GetTimestamp() - leaseStartTime;
+        
     //
     // If the pool has been closed we just discard the context
     //
-    if (!m_d2dDevice)
+    if (m_closed)
         return;
 
-    //
-    // When a leased device context is returned it is added back to the pool,
-    // unless the pool has reached its maximum size, in which the context is
-    // destroyed.  This is to give the pool a chance to shrink back down to a
-    // reasonable size if there is ever any large scale concurrency going on.
-    //
-    // Max pool size is picked from number of CPUs - reasoning being that you
-    // should expect to be able to have that many threads running and reusing
-    // contexts without recreating them.
-    //
-    static auto maxPoolSize = std::max(std::thread::hardware_concurrency(), 1U);
+    auto homeSlot = GetHomeSlot();
+
+    for (unsigned i = 0; i < m_maximumSize; i++)
+    {
+        auto& slot = m_slots[(homeSlot + i) % m_maximumSize];
+
+        ID2D1DeviceContext1* expected = nullptr;
+
+        if (slot.compare_exchange_strong(expected, deviceContext.Get()))
+        {
+            deviceContext.Detach();
+
+            //
+            // If Close() raced with us it may have emptied the pool before we
+            // stored this context, in which case it is our job to release it.
+            //
+            if (m_closed)
+            {
+                ReleasePooledDeviceContexts();
+            }
+
+            return;
+        }
+    }
+
+    // Every slot is full, so the context is destroyed.
+    m_deviceContextsDiscarded++;
+}
+
+
+void DeviceContextPool::Prewarm(unsigned count)
+{
+    unsigned pooledCount = 0;
 
-    if (m_deviceContexts.size() < maxPoolSize)
-        m_deviceContexts.emplace_back(std::move(deviceContext));
+    for (unsigned i = 0; i < m_maximumSize; i++)
+    {
+        if (m_slots[i])
+            pooledCount++;
+    }
+
+    for (unsigned i = 0; i < m_maximumSize && pooledCount < count; i++)
+    {
+        auto& slot = m_slots[i];
+
+        if (slot)
+            continue;
+
+        auto deviceContext = CreateDeviceContext();
+
+        ID2D1DeviceContext1* expected = nullptr;
+
+        // If another thread filled this slot in the meantime, our new context is simply released.
+        if (slot.compare_exchange_strong(expected, deviceContext.Get()))
+        {
+            deviceContext.Detach();
+        }
+
+        pooledCount++;
+    }
+
+    if (m_closed)
+    {
+        ReleasePooledDeviceContexts();
+    }
+}
+
+
+DeviceContextPoolStatistics DeviceContextPool::GetStatistics()
+{
+    DeviceContextPoolStatistics statistics{};
+
+    statistics.LeasesTaken = m_leasesTaken;
+    statistics.DeviceContextsCreated = m_deviceContextsCreated;
+    statistics.DeviceContextsDiscarded = m_deviceContextsDiscarded;
+    statistics.ActiveLeaseCount = m_activeLeaseCount;
+    statistics.PeakActiveLeaseCount = m_peakActiveLeaseCount;
+
+    uint64_t leasesReturned = m_leasesReturned;
+
+    if (leasesReturned)
+    {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+
+        statistics.AverageLeaseMicroseconds = static_cast<double>(m_totalLeaseTicks) * 1000000.0 / frequency.QuadPart / leasesReturned;
+    }
+
+    return statistics;
+}
+
+
+unsigned DeviceContextPool::GetHomeSlot() const
+{
+    if (!m_maximumSize)
+        return 0;
+
+    // Thread IDs are multiples of four, so discard the low bits before picking a slot.
+    return (GetCurrentThreadId() >> 2) % m_maximumSize;
+}
+
+
+void DeviceContextPool::ReleasePooledDeviceContexts()
+{
+    for (unsigned i = 0; i < m_maximumSize; i++)
+    {
+        if (auto pooledContext = m_slots[i].exchange(nullptr))
+        {
+            pooledContext->Release();
+        }
+    }
 }
 
 
 void DeviceContextPool::Close()
 {
-    Lock lock(m_mutex);
+    {
+        Lock lock(m_mutex);
+
+        m_closed = true;
+        m_d2dDevice = nullptr;
+    }
 
-    m_deviceContexts.clear();
-    m_d2dDevice = nullptr;
+    ReleasePooledDeviceContexts();
 }
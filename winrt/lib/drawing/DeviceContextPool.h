@@ -11,25 +11,81 @@ using namespace ABI::Microsoft::Graphics::Canvas;
 
 class DeviceContextLease;
 
+struct DeviceContextPoolStatistics
+{
+    uint64_t LeasesTaken;
+    uint64_t DeviceContextsCreated;
+    uint64_t DeviceContextsDiscarded;   // Returned while the pool was already at its maximum size.
+    uint32_t ActiveLeaseCount;
+    uint32_t PeakActiveLeaseCount;
+    double AverageLeaseMicroseconds;    // How long returned leases were held for.
+};
+
+//
+// Pooled device contexts are kept in a fixed array of slots, each holding at
+// most one context. Taking and returning leases swaps contexts in and out of
+// these slots with atomic exchanges, so the common case never takes a lock.
+//
+// Each thread starts searching from its own home slot. A thread that takes
+// and returns leases repeatedly therefore tends to get back the same context
+// it used last time, while different threads mostly touch different slots.
+// The mutex is only used when creating new contexts, and by Close().
+//
 class DeviceContextPool
 {
     ID2D1Device1* m_d2dDevice;
+    std::atomic<bool> m_closed;
 
     std::mutex m_mutex;
-    std::vector<ComPtr<ID2D1DeviceContext1>> m_deviceContexts;
+
+    // Each non-null slot owns a reference to its device context.
+    std::unique_ptr<std::atomic<ID2D1DeviceContext1*>[]> m_slots;
+    unsigned m_maximumSize;
+
+    // Statistics are updated without locking, so they are only approximately
+    // consistent with each other while leases are being taken and returned.
+    std::atomic<uint64_t> m_leasesTaken;
+    std::atomic<uint64_t> m_deviceContextsCreated;
+    std::atomic<uint64_t> m_deviceContextsDiscarded;
+    std::atomic<uint64_t> m_leasesReturned;
+    std::atomic<uint64_t> m_totalLeaseTicks;
+    std::atomic<uint32_t> m_activeLeaseCount;
+    std::atomic<uint32_t> m_peakActiveLeaseCount;
     
 public:
-    DeviceContextPool(ID2D1Device1* d2dDevice);
+    // The maximum size is how many unused device contexts are retained.
+    DeviceContextPool(ID2D1Device1* d2dDevice, unsigned maximumSize = GetDefaultMaximumSize());
+
+    // Each slot costs a pointer even when empty, so app supplied sizes are capped.
+    static const unsigned MaximumSizeLimit = 1024;
 
     DeviceContextPool(DeviceContextPool const&) = delete;
     DeviceContextPool& operator=(DeviceContextPool const&) = delete;
 
+    ~DeviceContextPool();
+
     DeviceContextLease TakeLease();
 
+    // Creates device contexts up front, so the pool holds at least this many
+    // (limited by its maximum size) and the first leases do not have to.
+    void Prewarm(unsigned count);
+
     void Close();
 
+    unsigned GetMaximumSize() const { return m_maximumSize; }
+
+    static unsigned GetDefaultMaximumSize();
+
+    DeviceContextPoolStatistics GetStatistics();
+
 private:
-    void ReturnLease(ComPtr<ID2D1DeviceContext1>&& deviceContext);
+    DeviceContextLease MakeLease(ComPtr<ID2D1DeviceContext1>&& deviceContext);
+    ComPtr<ID2D1DeviceContext1> CreateDeviceContext();
+
+    void ReturnLease(ComPtr<ID2D1DeviceContext1>&& deviceContext, int64_t leaseStartTime);
+
+    unsigned GetHomeSlot() const;
+    void ReleasePooledDeviceContexts();
 
     friend class DeviceContextLease;
 };
@@ -39,23 +95,28 @@ class DeviceContextLease
 {
     DeviceContextPool* m_owner;
     ComPtr<ID2D1DeviceContext1> m_deviceContext;
+    int64_t m_startTime;
     
 public:
     DeviceContextLease()
         : m_owner(nullptr)
+        , m_startTime(0)
     {
     }
     
     explicit DeviceContextLease(ComPtr<ID2D1DeviceContext1>&& deviceContext)
         : m_owner(nullptr)
         , m_deviceContext(std::move(deviceContext))
+        , m_startTime(0)
     {
     }
 
     DeviceContextLease(DeviceContextLease&& other)
         : m_owner(other.m_owner)
         , m_deviceContext(std::move(other.m_deviceContext))
+        , m_startTime(other.m_startTime)
     {
+        other.m_owner = nullptr;
     }
     
     DeviceContextLease& operator=(DeviceContextLease&& other)
@@ -63,6 +124,8 @@ public:
         ReturnLease();
         m_owner = other.m_owner;
         m_deviceContext = std::move(other.m_deviceContext);
+        m_startTime = other.m_startTime;
+        other.m_owner = nullptr;
         return *this;
     }
 
@@ -85,9 +148,10 @@ public:
     }
 
 private:
-    DeviceContextLease(DeviceContextPool* owner, ComPtr<ID2D1DeviceContext1>&& deviceContext)
+    DeviceContextLease(DeviceContextPool* owner, ComPtr<ID2D1DeviceContext1>&& deviceContext, int64_t startTime)
         : m_owner(owner)
         , m_deviceContext(std::move(deviceContext))
+        , m_startTime(startTime)
     {
         assert(m_owner);
     }
@@ -96,7 +160,7 @@ private:
     {
         if (m_owner)
         {
-            m_owner->ReturnLease(std::move(m_deviceContext));
+            m_owner->ReturnLease(std::move(m_deviceContext), m_startTime);
             m_owner = nullptr;
         }
         else
@@ -0,0 +1,241 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "EffectPool.h"
+
+
+//
+// EffectPool implementation
+//
+
+
+EffectPool::EffectPool(uint32_t maximumSize)
+    : m_closed(false)
+    , m_maximumSize(maximumSize)
+    , m_statistics{}
+{
+}
+
+
+ComPtr<ID2D1Effect> EffectPool::TryTakeEffect(IID const& effectId)
+{
+    Lock lock(m_mutex);
+
+    if (m_closed)
+        return nullptr;
+
+    // Search from the most recently returned end, as those are the most likely to still be warm.
+    auto it = std::find_if(m_pooledEffects.rbegin(), m_pooledEffects.rend(),
+        [&](PooledEffect const& pooledEffect)
+        {
+            return IsEqualGUID(pooledEffect.EffectId, effectId);
+        });
+
+    if (it == m_pooledEffects.rend())
+        return nullptr;
+
+    auto effect = std::move(it->Effect);
+    m_pooledEffects.erase(std::next(it).base());
+
+    m_statistics.EffectsReused++;
+
+    return effect;
+}
+
+
+ComPtr<ID2D1Effect> EffectPool::CreateEffect(ID2D1DeviceContext* deviceContext, IID const& effectId)
+{
+    ComPtr<ID2D1Effect> effect;
+    ThrowIfFailed(deviceContext->CreateEffect(effectId, &effect));
+
+    Lock lock(m_mutex);
+
+    m_statistics.EffectsCreated++;
+
+    //
+    // The first time we see each CLSID, capture the default property values of
+    // the freshly created instance. These are what ReturnEffect resets to, so
+    // that a reused effect is indistinguishable from a newly created one. A null
+    // entry records that this type of effect cannot be reset, so is not pooled.
+    //
+    if (!m_closed && m_propertyDefaults.find(effectId) == m_propertyDefaults.end())
+    {
+        m_propertyDefaults.emplace(effectId, ReadPropertyDefaults(effect.Get()));
+    }
+
+    return effect;
+}
+
+
+void EffectPool::ReturnEffect(IID const& effectId, ComPtr<ID2D1Effect>&& effect, bool isShared)
+{
+    if (!effect)
+        return;
+
+    auto returnedEffect = std::move(effect);
+
+    std::shared_ptr<PropertyDefaults const> propertyDefaults;
+
+    {
+        Lock lock(m_mutex);
+
+        auto it = m_propertyDefaults.find(effectId);
+
+        if (it != m_propertyDefaults.end())
+            propertyDefaults = it->second;
+
+        //
+        // We can only reuse effects that nobody else is holding on to, whose
+        // defaults we know (ie. they were created by this pool rather than
+        // passed in via interop, and can be reset), and only while we have
+        // room for them.
+        //
+        if (m_closed || m_maximumSize == 0 || !propertyDefaults || isShared)
+        {
+            m_statistics.EffectsDiscarded++;
+            return;
+        }
+    }
+
+    // Resetting the effect calls into D2D, so is done without holding our lock.
+    bool wasReset = ResetEffect(returnedEffect.Get(), *propertyDefaults);
+
+    Lock lock(m_mutex);
+
+    if (m_closed || !wasReset || m_maximumSize == 0)
+    {
+        m_statistics.EffectsDiscarded++;
+        return;
+    }
+
+    // Make room by evicting the least recently returned effect.
+    TrimToSize(m_maximumSize - 1);
+
+    m_pooledEffects.push_back(PooledEffect{ effectId, std::move(returnedEffect) });
+}
+
+
+uint32_t EffectPool::GetMaximumSize()
+{
+    Lock lock(m_mutex);
+
+    return m_maximumSize;
+}
+
+
+void EffectPool::SetMaximumSize(uint32_t value)
+{
+    Lock lock(m_mutex);
+
+    m_maximumSize = value;
+
+    TrimToSize(m_maximumSize);
+}
+
+
+EffectPoolStatistics EffectPool::GetStatistics()
+{
+    Lock lock(m_mutex);
+
+    auto statistics = m_statistics;
+    statistics.PooledEffectCount = static_cast<uint32_t>(m_pooledEffects.size());
+    return statistics;
+}
+
+
+void EffectPool::Close()
+{
+    Lock lock(m_mutex);
+
+    m_pooledEffects.clear();
+    m_propertyDefaults.clear();
+    m_closed = true;
+}
+
+
+void EffectPool::TrimToSize(uint32_t size)
+{
+    if (m_pooledEffects.size() <= size)
+        return;
+
+    auto excess = m_pooledEffects.size() - size;
+
+    m_pooledEffects.erase(m_pooledEffects.begin(), m_pooledEffects.begin() + excess);
+
+    m_statistics.EffectsDiscarded += excess;
+}
+
+
+std::shared_ptr<EffectPool::PropertyDefaults const> EffectPool::ReadPropertyDefaults(ID2D1Effect* effect)
+{
+    auto propertyDefaults = std::make_shared<PropertyDefaults>();
+
+    auto propertyCount = effect->GetPropertyCount();
+
+    for (uint32_t i = 0; i < propertyCount; i++)
+    {
+        auto type = effect->GetType(i);
+
+        switch (type)
+        {
+        case D2D1_PROPERTY_TYPE_UNKNOWN:
+        case D2D1_PROPERTY_TYPE_IUNKNOWN:
+        case D2D1_PROPERTY_TYPE_COLOR_CONTEXT:
+            // Object valued properties cannot be captured as plain bytes, and some are
+            // write-once (eg. the shared state of PixelShaderEffect), so effects that
+            // have them are never pooled.
+            return nullptr;
+        }
+
+        // Skip read-only properties such as the histogram output.
+        ComPtr<ID2D1Properties> subProperties;
+
+        if (SUCCEEDED(effect->GetSubProperties(i, &subProperties)) && subProperties)
+        {
+            BOOL isReadOnly = FALSE;
+
+            if (SUCCEEDED(subProperties->GetValue(D2D1_SUBPROPERTY_ISREADONLY, &isReadOnly)) && isReadOnly)
+                continue;
+        }
+
+        std::vector<BYTE> value(effect->GetValueSize(i));
+
+        if (FAILED(effect->GetValue(i, type, value.data(), static_cast<uint32_t>(value.size()))))
+            continue;
+
+        propertyDefaults->push_back(PropertyDefault{ i, type, std::move(value) });
+    }
+
+    return propertyDefaults;
+}
+
+
+bool EffectPool::ResetEffect(ID2D1Effect* effect, PropertyDefaults const& propertyDefaults)
+{
+    // Detach input images, so a pooled effect does not keep them alive.
+    auto inputCount = effect->GetInputCount();
+
+    for (uint32_t i = 0; i < inputCount; i++)
+    {
+        effect->SetInput(i, nullptr, FALSE);
+    }
+
+    // Restore the properties that are common to all effects.
+    if (FAILED(effect->SetValue(D2D1_PROPERTY_CACHED, static_cast<BOOL>(false))) ||
+        FAILED(effect->SetValue(D2D1_PROPERTY_PRECISION, D2D1_BUFFER_PRECISION_UNKNOWN)))
+    {
+        return false;
+    }
+
+    // Restore the effect specific properties.
+    for (auto& property : propertyDefaults)
+    {
+        if (FAILED(effect->SetValue(property.Index, property.Type, property.Value.data(), static_cast<uint32_t>(property.Value.size()))))
+            return false;
+    }
+
+    return true;
+}
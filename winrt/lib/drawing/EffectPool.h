@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "utils/LockUtilities.h"
+
+using namespace Microsoft::WRL;
+
+struct EffectPoolStatistics
+{
+    uint64_t EffectsCreated;
+    uint64_t EffectsReused;
+    uint64_t EffectsDiscarded;
+    uint32_t PooledEffectCount;
+};
+
+
+//
+// Per-device free list of D2D effect instances, keyed by effect CLSID.
+//
+// CanvasEffect hands its ID2D1Effect back here when it is unrealized or
+// closed, so rebuilding an effect graph (eg. after a device change, or for
+// short-lived effects that are recreated every frame) can reuse an existing
+// instance rather than paying for another ID2D1DeviceContext::CreateEffect.
+//
+// Returned effects have their inputs detached and their properties restored
+// to the default values that were captured when the CLSID was first created.
+//
+// The pool never inspects reference counts to decide whether an effect is still
+// in use, as D2D holds internal references of its own. Callers track that
+// themselves, and tell ReturnEffect whether anyone else may still hold it.
+//
+class EffectPool
+{
+    struct PropertyDefault
+    {
+        uint32_t Index;
+        D2D1_PROPERTY_TYPE Type;
+        std::vector<BYTE> Value;
+    };
+
+    typedef std::vector<PropertyDefault> PropertyDefaults;
+
+    struct PooledEffect
+    {
+        IID EffectId;
+        ComPtr<ID2D1Effect> Effect;
+    };
+
+    struct IidLess
+    {
+        bool operator()(IID const& a, IID const& b) const
+        {
+            return memcmp(&a, &b, sizeof(IID)) < 0;
+        }
+    };
+
+    std::mutex m_mutex;
+    bool m_closed;
+    uint32_t m_maximumSize;
+
+    // Ordered from least to most recently returned.
+    std::vector<PooledEffect> m_pooledEffects;
+
+    std::map<IID, std::shared_ptr<PropertyDefaults const>, IidLess> m_propertyDefaults;
+
+    EffectPoolStatistics m_statistics;
+
+public:
+    static const uint32_t DefaultMaximumSize = 64;
+
+    EffectPool(uint32_t maximumSize = DefaultMaximumSize);
+
+    EffectPool(EffectPool const&) = delete;
+    EffectPool& operator=(EffectPool const&) = delete;
+
+    // Returns a pooled instance of the specified effect, or null if there are none.
+    ComPtr<ID2D1Effect> TryTakeEffect(IID const& effectId);
+
+    // Creates a new effect instance that is eligible to be returned to the pool later.
+    ComPtr<ID2D1Effect> CreateEffect(ID2D1DeviceContext* deviceContext, IID const& effectId);
+
+    // Effects that are shared (eg. still the input of another effect, or handed
+    // out to an interop caller) are discarded rather than pooled.
+    void ReturnEffect(IID const& effectId, ComPtr<ID2D1Effect>&& effect, bool isShared);
+
+    uint32_t GetMaximumSize();
+    void SetMaximumSize(uint32_t value);
+
+    EffectPoolStatistics GetStatistics();
+
+    void Close();
+
+private:
+    void TrimToSize(uint32_t size);
+
+    static std::shared_ptr<PropertyDefaults const> ReadPropertyDefaults(ID2D1Effect* effect);
+    static bool ResetEffect(ID2D1Effect* effect, PropertyDefaults const& propertyDefaults);
+};
@@ -0,0 +1,208 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "StagingBitmapPool.h"
+
+
+//
+// StagingBitmapPool implementation
+//
+
+
+StagingBitmapPool::StagingBitmapPool(uint64_t maximumBytes)
+    : m_closed(false)
+    , m_maximumBytes(maximumBytes)
+    , m_pooledBytes(0)
+    , m_statistics{}
+{
+}
+
+
+static bool IsSameFormat(D2D1_PIXEL_FORMAT const& a, D2D1_PIXEL_FORMAT const& b)
+{
+    return a.format == b.format && a.alphaMode == b.alphaMode;
+}
+
+
+static uint64_t GetBitmapBytes(D2D1_SIZE_U size, DXGI_FORMAT format)
+{
+    auto blockSize = ABI::Microsoft::Graphics::Canvas::GetBlockSize(format);
+    auto bytesPerBlock = ABI::Microsoft::Graphics::Canvas::GetBytesPerBlock(format);
+
+    return static_cast<uint64_t>(size.width / blockSize) * (size.height / blockSize) * bytesPerBlock;
+}
+
+
+StagingBitmapLease StagingBitmapPool::TakeLease(ID2D1DeviceContext* deviceContext, D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format)
+{
+    auto sizeClass = GetSizeClass(size, deviceContext->GetMaximumBitmapSize());
+
+    // This also validates the format, so that returning the bitmap later cannot fail.
+    GetBitmapBytes(sizeClass, format.format);
+
+    {
+        Lock lock(m_mutex);
+
+        if (!m_closed)
+        {
+            // Search from the most recently returned end, as those are the most likely to still be warm.
+            auto it = std::find_if(m_pooledBitmaps.rbegin(), m_pooledBitmaps.rend(),
+                [&](PooledBitmap const& pooledBitmap)
+                {
+                    return pooledBitmap.Size.width == sizeClass.width &&
+                           pooledBitmap.Size.height == sizeClass.height &&
+                           IsSameFormat(pooledBitmap.Format, format);
+                });
+
+            if (it != m_pooledBitmaps.rend())
+            {
+                auto bitmap = std::move(it->Bitmap);
+                m_pooledBytes -= it->Bytes;
+                m_pooledBitmaps.erase(std::next(it).base());
+
+                m_statistics.Hits++;
+
+                return StagingBitmapLease(this, sizeClass, format, std::move(bitmap));
+            }
+        }
+
+        m_statistics.Misses++;
+    }
+
+    auto bitmapProperties = D2D1::BitmapProperties1(
+        D2D1_BITMAP_OPTIONS_CPU_READ | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
+        format);
+
+    ComPtr<ID2D1Bitmap1> bitmap;
+    ThrowIfFailed(deviceContext->CreateBitmap(sizeClass, nullptr, 0, &bitmapProperties, &bitmap));
+
+    return StagingBitmapLease(this, sizeClass, format, std::move(bitmap));
+}
+
+
+void StagingBitmapPool::ReturnBitmap(D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format, ComPtr<ID2D1Bitmap1>&& bitmap)
+{
+    if (!bitmap)
+        return;
+
+    auto returnedBitmap = std::move(bitmap);
+    auto bytes = GetBitmapBytes(size, format.format);
+
+    Lock lock(m_mutex);
+
+    if (m_closed || bytes > m_maximumBytes)
+    {
+        m_statistics.BitmapsDiscarded++;
+        return;
+    }
+
+    // Make room by evicting the least recently returned bitmaps.
+    TrimToSize(m_maximumBytes - bytes);
+
+    m_pooledBitmaps.push_back(PooledBitmap{ size, format, bytes, std::move(returnedBitmap) });
+    m_pooledBytes += bytes;
+}
+
+
+void StagingBitmapPool::Trim()
+{
+    Lock lock(m_mutex);
+
+    TrimToSize(0);
+}
+
+
+uint64_t StagingBitmapPool::GetMaximumBytes()
+{
+    Lock lock(m_mutex);
+
+    return m_maximumBytes;
+}
+
+
+void StagingBitmapPool::SetMaximumBytes(uint64_t value)
+{
+    Lock lock(m_mutex);
+
+    m_maximumBytes = value;
+
+    TrimToSize(m_maximumBytes);
+}
+
+
+StagingBitmapPoolStatistics StagingBitmapPool::GetStatistics()
+{
+    Lock lock(m_mutex);
+
+    auto statistics = m_statistics;
+    statistics.PooledBitmapCount = static_cast<uint32_t>(m_pooledBitmaps.size());
+    statistics.PooledBytes = m_pooledBytes;
+    return statistics;
+}
+
+
+void StagingBitmapPool::Close()
+{
+    Lock lock(m_mutex);
+
+    m_pooledBitmaps.clear();
+    m_pooledBytes = 0;
+    m_closed = true;
+}
+
+
+void StagingBitmapPool::TrimToSize(uint64_t bytes)
+{
+    auto it = m_pooledBitmaps.begin();
+
+    while (m_pooledBytes > bytes)
+    {
+        assert(it != m_pooledBitmaps.end());
+
+        m_pooledBytes -= it->Bytes;
+        ++it;
+    }
+
+    auto excess = it - m_pooledBitmaps.begin();
+
+    m_pooledBitmaps.erase(m_pooledBitmaps.begin(), it);
+
+    m_statistics.BitmapsDiscarded += excess;
+}
+
+
+static uint32_t RoundUpToSizeClass(uint32_t value, uint32_t maximumValue)
+{
+    const uint32_t minimumSizeClass = 64;
+
+    if (value <= minimumSizeClass)
+        return std::min(minimumSizeClass, std::max(value, maximumValue));
+
+    // Find the power of two range that contains the value, then round up to a
+    // multiple of a quarter of the bottom of that range.
+    uint64_t rangeStart = minimumSizeClass;
+
+    while (rangeStart * 2 < value)
+    {
+        rangeStart *= 2;
+    }
+
+    auto step = rangeStart / 4;
+    auto sizeClass = (value + step - 1) / step * step;
+
+    // Don't exceed what the device can create, unless the request itself does.
+    return static_cast<uint32_t>(std::min<uint64_t>(sizeClass, std::max(value, maximumValue)));
+}
+
+
+D2D1_SIZE_U StagingBitmapPool::GetSizeClass(D2D1_SIZE_U size, uint32_t maximumBitmapSize)
+{
+    return D2D1_SIZE_U
+    {
+        RoundUpToSizeClass(size.width, maximumBitmapSize),
+        RoundUpToSizeClass(size.height, maximumBitmapSize)
+    };
+}
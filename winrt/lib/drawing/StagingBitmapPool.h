@@ -0,0 +1,178 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "utils/LockUtilities.h"
+
+using namespace Microsoft::WRL;
+
+class StagingBitmapLease;
+
+struct StagingBitmapPoolStatistics
+{
+    uint64_t Hits;
+    uint64_t Misses;
+    uint64_t BitmapsDiscarded;
+    uint32_t PooledBitmapCount;
+    uint64_t PooledBytes;
+};
+
+
+//
+// Per-device free list of the CPU readable staging bitmaps that pixel readback
+// (CanvasBitmap.GetPixelBytes, GetPixelColors, etc.) copies into before
+// mapping, so repeated readbacks don't create a new bitmap every time.
+//
+// Requested sizes are rounded up to a size class, which wastes at most 25% in
+// each dimension, so that similar sized readbacks can share bitmaps. Pooled
+// bitmaps are matched on size class and pixel format.
+//
+// A bitmap belongs to whoever holds its lease, so concurrent readbacks never
+// share one. Returned bitmaps are kept in least recently used order, and the
+// oldest are discarded once their total size exceeds the maximum.
+//
+class StagingBitmapPool
+{
+    struct PooledBitmap
+    {
+        D2D1_SIZE_U Size;
+        D2D1_PIXEL_FORMAT Format;
+        uint64_t Bytes;
+        ComPtr<ID2D1Bitmap1> Bitmap;
+    };
+
+    std::mutex m_mutex;
+    bool m_closed;
+    uint64_t m_maximumBytes;
+    uint64_t m_pooledBytes;
+
+    // Ordered from least to most recently returned.
+    std::vector<PooledBitmap> m_pooledBitmaps;
+
+    StagingBitmapPoolStatistics m_statistics;
+
+public:
+    // Enough for a few full screen readbacks. Pooled bitmaps are only reused by
+    // readbacks of similar size, so a larger pool mostly just holds memory.
+    static const uint64_t DefaultMaximumBytes = 16 * 1024 * 1024;
+
+    StagingBitmapPool(uint64_t maximumBytes = DefaultMaximumBytes);
+
+    StagingBitmapPool(StagingBitmapPool const&) = delete;
+    StagingBitmapPool& operator=(StagingBitmapPool const&) = delete;
+
+    // Returns a staging bitmap that is at least the requested size. deviceContext
+    // is only used to create a new bitmap if there is no suitable pooled one.
+    StagingBitmapLease TakeLease(ID2D1DeviceContext* deviceContext, D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format);
+
+    // Releases every pooled bitmap. Outstanding leases are still pooled
+    // when they are returned.
+    void Trim();
+
+    uint64_t GetMaximumBytes();
+    void SetMaximumBytes(uint64_t value);
+
+    StagingBitmapPoolStatistics GetStatistics();
+
+    void Close();
+
+    static D2D1_SIZE_U GetSizeClass(D2D1_SIZE_U size, uint32_t maximumBitmapSize);
+
+private:
+    void ReturnBitmap(D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format, ComPtr<ID2D1Bitmap1>&& bitmap);
+
+    void TrimToSize(uint64_t bytes);
+
+    friend class StagingBitmapLease;
+};
+
+
+class StagingBitmapLease
+{
+    StagingBitmapPool* m_owner;
+    D2D1_SIZE_U m_size;
+    D2D1_PIXEL_FORMAT m_format;
+    ComPtr<ID2D1Bitmap1> m_bitmap;
+
+public:
+    StagingBitmapLease()
+        : m_owner(nullptr)
+        , m_size{}
+        , m_format{}
+    {
+    }
+
+    // Leases an unpooled bitmap, which is simply released when the lease ends.
+    explicit StagingBitmapLease(ComPtr<ID2D1Bitmap1>&& bitmap)
+        : m_owner(nullptr)
+        , m_size{}
+        , m_format{}
+        , m_bitmap(std::move(bitmap))
+    {
+    }
+
+    StagingBitmapLease(StagingBitmapLease&& other)
+        : m_owner(other.m_owner)
+        , m_size(other.m_size)
+        , m_format(other.m_format)
+        , m_bitmap(std::move(other.m_bitmap))
+    {
+        other.m_owner = nullptr;
+    }
+
+    StagingBitmapLease& operator=(StagingBitmapLease&& other)
+    {
+        ReturnLease();
+        m_owner = other.m_owner;
+        m_size = other.m_size;
+        m_format = other.m_format;
+        m_bitmap = std::move(other.m_bitmap);
+        other.m_owner = nullptr;
+        return *this;
+    }
+
+    StagingBitmapLease(StagingBitmapLease const&) = delete;
+    StagingBitmapLease& operator=(StagingBitmapLease const&) = delete;
+
+    ~StagingBitmapLease()
+    {
+        ReturnLease();
+    }
+
+    ID2D1Bitmap1* Get()
+    {
+        return m_bitmap.Get();
+    }
+
+    ID2D1Bitmap1* operator->()
+    {
+        return m_bitmap.Get();
+    }
+
+private:
+    StagingBitmapLease(StagingBitmapPool* owner, D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format, ComPtr<ID2D1Bitmap1>&& bitmap)
+        : m_owner(owner)
+        , m_size(size)
+        , m_format(format)
+        , m_bitmap(std::move(bitmap))
+    {
+        assert(m_owner);
+    }
+
+    void ReturnLease()
+    {
+        if (m_owner)
+        {
+            m_owner->ReturnBitmap(m_size, m_format, std::move(m_bitmap));
+            m_owner = nullptr;
+        }
+        else
+        {
+            m_bitmap.Reset();
+        }
+    }
+
+    friend class StagingBitmapPool;
+};
@@ -0,0 +1,255 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "TransientRenderTargetPool.h"
+
+
+//
+// TransientRenderTargetPool implementation
+//
+
+
+TransientRenderTargetPool::TransientRenderTargetPool(uint64_t maximumBytes, uint32_t maximumIdleFrames)
+    : m_closed(false)
+    , m_maximumBytes(maximumBytes)
+    , m_maximumIdleFrames(maximumIdleFrames)
+    , m_frame(0)
+    , m_pooledBytes(0)
+    , m_leasedCount(0)
+    , m_leasedBytes(0)
+    , m_statistics{}
+{
+}
+
+
+static bool IsSameFormat(D2D1_PIXEL_FORMAT const& a, D2D1_PIXEL_FORMAT const& b)
+{
+    return a.format == b.format && a.alphaMode == b.alphaMode;
+}
+
+
+static uint64_t GetBitmapBytes(D2D1_SIZE_U size, DXGI_FORMAT format)
+{
+    auto blockSize = ABI::Microsoft::Graphics::Canvas::GetBlockSize(format);
+    auto bytesPerBlock = ABI::Microsoft::Graphics::Canvas::GetBytesPerBlock(format);
+
+    return static_cast<uint64_t>(size.width / blockSize) * (size.height / blockSize) * bytesPerBlock;
+}
+
+
+TransientRenderTargetLease TransientRenderTargetPool::TakeLease(ID2D1DeviceContext* deviceContext, D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format, float dpi)
+{
+    auto lease = TryTakePooledLease(size, format, dpi);
+
+    if (lease.Get())
+        return lease;
+
+    auto bytes = GetBitmapBytes(size, format.format);
+
+    auto bitmapProperties = D2D1::BitmapProperties1(
+        D2D1_BITMAP_OPTIONS_TARGET,
+        format,
+        dpi,
+        dpi);
+
+    ComPtr<ID2D1Bitmap1> bitmap;
+    ThrowIfFailed(deviceContext->CreateBitmap(size, nullptr, 0, &bitmapProperties, &bitmap));
+
+    Lock lock(m_mutex);
+
+    m_leasedCount++;
+    m_leasedBytes += bytes;
+
+    m_statistics.Creations++;
+    m_statistics.PeakBytes = std::max(m_statistics.PeakBytes, m_pooledBytes + m_leasedBytes);
+
+    return TransientRenderTargetLease(this, size, format, dpi, bytes, std::move(bitmap));
+}
+
+
+TransientRenderTargetLease TransientRenderTargetPool::TryTakePooledLease(D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format, float dpi)
+{
+    // This also validates the format, so that returning the bitmap later cannot fail.
+    auto bytes = GetBitmapBytes(size, format.format);
+
+    Lock lock(m_mutex);
+
+    if (m_closed)
+        return TransientRenderTargetLease();
+
+    // Search from the most recently returned end, as those are the most likely to still be warm.
+    auto it = std::find_if(m_pooledTargets.rbegin(), m_pooledTargets.rend(),
+        [&](PooledTarget const& pooledTarget)
+        {
+            return pooledTarget.Size.width == size.width &&
+                   pooledTarget.Size.height == size.height &&
+                   IsSameFormat(pooledTarget.Format, format) &&
+                   pooledTarget.Dpi == dpi;
+        });
+
+    if (it == m_pooledTargets.rend())
+        return TransientRenderTargetLease();
+
+    auto bitmap = std::move(it->Bitmap);
+    m_pooledBytes -= it->Bytes;
+    m_pooledTargets.erase(std::next(it).base());
+
+    m_leasedCount++;
+    m_leasedBytes += bytes;
+
+    m_statistics.Reuses++;
+
+    return TransientRenderTargetLease(this, size, format, dpi, bytes, std::move(bitmap));
+}
+
+
+void TransientRenderTargetPool::ReturnBitmap(D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format, float dpi, uint64_t bytes, ComPtr<ID2D1Bitmap1>&& bitmap)
+{
+    auto returnedBitmap = std::move(bitmap);
+
+    Lock lock(m_mutex);
+
+    m_leasedCount--;
+    m_leasedBytes -= bytes;
+
+    if (m_closed || bytes > m_maximumBytes)
+    {
+        m_statistics.TargetsDiscarded++;
+        return;
+    }
+
+    // Make room by evicting the least recently returned bitmaps.
+    TrimToSize(m_maximumBytes - bytes);
+
+    m_pooledTargets.push_back(PooledTarget{ size, format, dpi, bytes, m_frame, std::move(returnedBitmap) });
+    m_pooledBytes += bytes;
+}
+
+
+void TransientRenderTargetPool::DiscardBitmap(uint64_t bytes)
+{
+    Lock lock(m_mutex);
+
+    m_leasedCount--;
+    m_leasedBytes -= bytes;
+
+    m_statistics.TargetsDiscarded++;
+}
+
+
+void TransientRenderTargetPool::EndFrame()
+{
+    Lock lock(m_mutex);
+
+    // Targets are in the order they were returned, so the ones that have
+    // been idle for too long are all at the front.
+    auto it = std::find_if(m_pooledTargets.begin(), m_pooledTargets.end(),
+        [&](PooledTarget const& pooledTarget)
+        {
+            return m_frame - pooledTarget.LastUsedFrame <= m_maximumIdleFrames;
+        });
+
+    for (auto discarded = m_pooledTargets.begin(); discarded != it; ++discarded)
+    {
+        m_pooledBytes -= discarded->Bytes;
+    }
+
+    m_statistics.TargetsDiscarded += it - m_pooledTargets.begin();
+
+    m_pooledTargets.erase(m_pooledTargets.begin(), it);
+
+    m_frame++;
+}
+
+
+uint64_t TransientRenderTargetPool::GetMaximumBytes()
+{
+    Lock lock(m_mutex);
+
+    return m_maximumBytes;
+}
+
+
+void TransientRenderTargetPool::SetMaximumBytes(uint64_t value)
+{
+    Lock lock(m_mutex);
+
+    m_maximumBytes = value;
+
+    TrimToSize(m_maximumBytes);
+}
+
+
+uint32_t TransientRenderTargetPool::GetMaximumIdleFrames()
+{
+    Lock lock(m_mutex);
+
+    return m_maximumIdleFrames;
+}
+
+
+void TransientRenderTargetPool::SetMaximumIdleFrames(uint32_t value)
+{
+    Lock lock(m_mutex);
+
+    m_maximumIdleFrames = value;
+}
+
+
+TransientRenderTargetPoolStatistics TransientRenderTargetPool::GetStatistics()
+{
+    Lock lock(m_mutex);
+
+    auto statistics = m_statistics;
+
+    auto leases = statistics.Reuses + statistics.Creations;
+    statistics.ReuseRate = leases ? static_cast<double>(statistics.Reuses) / leases : 0;
+
+    statistics.PooledTargetCount = static_cast<uint32_t>(m_pooledTargets.size());
+    statistics.PooledBytes = m_pooledBytes;
+    statistics.LeasedTargetCount = m_leasedCount;
+    statistics.LeasedBytes = m_leasedBytes;
+
+    return statistics;
+}
+
+
+void TransientRenderTargetPool::Trim()
+{
+    Lock lock(m_mutex);
+
+    TrimToSize(0);
+}
+
+
+void TransientRenderTargetPool::Close()
+{
+    Lock lock(m_mutex);
+
+    m_pooledTargets.clear();
+    m_pooledBytes = 0;
+    m_closed = true;
+}
+
+
+void TransientRenderTargetPool::TrimToSize(uint64_t bytes)
+{
+    auto it = m_pooledTargets.begin();
+
+    while (m_pooledBytes > bytes)
+    {
+        assert(it != m_pooledTargets.end());
+
+        m_pooledBytes -= it->Bytes;
+        ++it;
+    }
+
+    auto excess = it - m_pooledTargets.begin();
+
+    m_pooledTargets.erase(m_pooledTargets.begin(), it);
+
+    m_statistics.TargetsDiscarded += excess;
+}
@@ -0,0 +1,219 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "utils/LockUtilities.h"
+
+using namespace Microsoft::WRL;
+
+class TransientRenderTargetLease;
+
+struct TransientRenderTargetPoolStatistics
+{
+    uint64_t Reuses;
+    uint64_t Creations;
+    uint64_t TargetsDiscarded;
+
+    // Reuses as a fraction of all leases, or zero if there have been none.
+    double ReuseRate;
+
+    uint32_t PooledTargetCount;
+    uint64_t PooledBytes;
+    uint32_t LeasedTargetCount;
+    uint64_t LeasedBytes;
+
+    // The most that pooled and leased targets together have ever held.
+    uint64_t PeakBytes;
+};
+
+
+//
+// Per-device free list of render target bitmaps, for intermediate passes
+// that need the same few sizes of render target every frame.
+//
+// Unlike StagingBitmapPool, sizes are not rounded up, since the size of a
+// render target is visible to whoever draws with it. Pooled bitmaps are
+// matched on exact pixel size, pixel format, alpha mode and DPI.
+//
+// Returned bitmaps are kept in least recently returned order. The oldest are
+// discarded once their total size exceeds the maximum, and EndFrame discards
+// any that have not been leased for more than the maximum number of idle
+// frames, so that sizes which are no longer used don't hold on to memory.
+//
+class TransientRenderTargetPool
+{
+    struct PooledTarget
+    {
+        D2D1_SIZE_U Size;
+        D2D1_PIXEL_FORMAT Format;
+        float Dpi;
+        uint64_t Bytes;
+        uint64_t LastUsedFrame;
+        ComPtr<ID2D1Bitmap1> Bitmap;
+    };
+
+    std::mutex m_mutex;
+    bool m_closed;
+    uint64_t m_maximumBytes;
+    uint32_t m_maximumIdleFrames;
+    uint64_t m_frame;
+
+    // Ordered from least to most recently returned.
+    std::vector<PooledTarget> m_pooledTargets;
+    uint64_t m_pooledBytes;
+
+    uint32_t m_leasedCount;
+    uint64_t m_leasedBytes;
+
+    TransientRenderTargetPoolStatistics m_statistics;
+
+public:
+    static const uint64_t DefaultMaximumBytes = 128 * 1024 * 1024;
+    static const uint32_t DefaultMaximumIdleFrames = 3;
+
+    TransientRenderTargetPool(uint64_t maximumBytes = DefaultMaximumBytes, uint32_t maximumIdleFrames = DefaultMaximumIdleFrames);
+
+    TransientRenderTargetPool(TransientRenderTargetPool const&) = delete;
+    TransientRenderTargetPool& operator=(TransientRenderTargetPool const&) = delete;
+
+    // Returns a render target bitmap of exactly the requested size and
+    // format. deviceContext is only used to create a new bitmap if there is
+    // no suitable pooled one. The contents of a reused bitmap are whatever
+    // was last drawn to it.
+    TransientRenderTargetLease TakeLease(ID2D1DeviceContext* deviceContext, D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format, float dpi);
+
+    // As TakeLease, but returns an empty lease instead of creating a bitmap,
+    // so callers can avoid getting hold of a device context on a hit.
+    TransientRenderTargetLease TryTakePooledLease(D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format, float dpi);
+
+    // Call once per frame, after the frame's leases have been returned.
+    void EndFrame();
+
+    // Releases every pooled bitmap. Outstanding leases are still pooled
+    // when they are returned.
+    void Trim();
+
+    uint64_t GetMaximumBytes();
+    void SetMaximumBytes(uint64_t value);
+
+    uint32_t GetMaximumIdleFrames();
+    void SetMaximumIdleFrames(uint32_t value);
+
+    TransientRenderTargetPoolStatistics GetStatistics();
+
+    void Close();
+
+private:
+    void ReturnBitmap(D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format, float dpi, uint64_t bytes, ComPtr<ID2D1Bitmap1>&& bitmap);
+    void DiscardBitmap(uint64_t bytes);
+
+    void TrimToSize(uint64_t bytes);
+
+    friend class TransientRenderTargetLease;
+};
+
+
+class TransientRenderTargetLease
+{
+    TransientRenderTargetPool* m_owner;
+    D2D1_SIZE_U m_size;
+    D2D1_PIXEL_FORMAT m_format;
+    float m_dpi;
+    uint64_t m_bytes;
+    ComPtr<ID2D1Bitmap1> m_bitmap;
+
+public:
+    TransientRenderTargetLease()
+        : m_owner(nullptr)
+        , m_size{}
+        , m_format{}
+        , m_dpi(0)
+        , m_bytes(0)
+    {
+    }
+
+    TransientRenderTargetLease(TransientRenderTargetLease&& other)
+        : m_owner(other.m_owner)
+        , m_size(other.m_size)
+        , m_format(other.m_format)
+        , m_dpi(other.m_dpi)
+        , m_bytes(other.m_bytes)
+        , m_bitmap(std::move(other.m_bitmap))
+    {
+        other.m_owner = nullptr;
+    }
+
+    TransientRenderTargetLease& operator=(TransientRenderTargetLease&& other)
+    {
+        Close();
+        m_owner = other.m_owner;
+        m_size = other.m_size;
+        m_format = other.m_format;
+        m_dpi = other.m_dpi;
+        m_bytes = other.m_bytes;
+        m_bitmap = std::move(other.m_bitmap);
+        other.m_owner = nullptr;
+        return *this;
+    }
+
+    TransientRenderTargetLease(TransientRenderTargetLease const&) = delete;
+    TransientRenderTargetLease& operator=(TransientRenderTargetLease const&) = delete;
+
+    ~TransientRenderTargetLease()
+    {
+        Close();
+    }
+
+    ID2D1Bitmap1* Get()
+    {
+        return m_bitmap.Get();
+    }
+
+    ID2D1Bitmap1* operator->()
+    {
+        return m_bitmap.Get();
+    }
+
+    // Returns the bitmap to the pool, after which it may be leased again.
+    void Close()
+    {
+        if (m_owner)
+        {
+            m_owner->ReturnBitmap(m_size, m_format, m_dpi, m_bytes, std::move(m_bitmap));
+            m_owner = nullptr;
+        }
+        else
+        {
+            m_bitmap.Reset();
+        }
+    }
+
+    // Releases the bitmap without returning it to the pool, for when
+    // something else may still be drawing to it.
+    void Discard()
+    {
+        m_bitmap.Reset();
+
+        if (m_owner)
+        {
+            m_owner->DiscardBitmap(m_bytes);
+            m_owner = nullptr;
+        }
+    }
+
+private:
+    TransientRenderTargetLease(TransientRenderTargetPool* owner, D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format, float dpi, uint64_t bytes, ComPtr<ID2D1Bitmap1>&& bitmap)
+        : m_owner(owner)
+        , m_size(size)
+        , m_format(format)
+        , m_dpi(dpi)
+        , m_bytes(bytes)
+        , m_bitmap(std::move(bitmap))
+    {
+        assert(m_owner);
+    }
+
+    friend class TransientRenderTargetPool;
+};
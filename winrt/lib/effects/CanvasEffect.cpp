@@ -5,6 +5,7 @@
 #include "pch.h"
 #include "effects/shader/PixelShaderEffect.h"
 #include "effects/shader/PixelShaderEffectImpl.h"
+#include "effects/cpu/CpuEffectRenderer.h"
 
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects 
 {
@@ -17,6 +18,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         , m_sources(sourcesSize)
         , m_cacheOutput(false)
         , m_bufferPrecision(D2D1_BUFFER_PRECISION_UNKNOWN)
+        , m_renderOnCpu(false)
+        , m_realization(1)
+        , m_d2dEffectReferenceCount(0)
+        , m_d2dEffectIsShared(effect != nullptr)
     {
         // If this effect has a variable number of inputs, expose them as an IVector<>.
         if (!isSourcesSizeFixed)
@@ -122,6 +127,22 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         m_insideGetImage = true;
         auto clearFlagWarden = MakeScopeWarden([&] { m_insideGetImage = false; });
 
+        bool renderOnCpu;
+
+        {
+            auto lock = Lock(m_mutex);
+            renderOnCpu = m_renderOnCpu;
+        }
+
+        // This must not hold our lock, as the CPU renderer reads our properties and sources.
+        if (renderOnCpu)
+        {
+            if (realizedDpi)
+                *realizedDpi = 0;
+
+            return RenderGraphOnCpu(device, deviceContext);
+        }
+
         // Lock after the cycle detection, because m_mutex is not recursive.
         // Cycle checks don't need to be threadsafe because that's just a developer error.
         auto lock = Lock(m_mutex);
@@ -134,6 +155,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                 // Command lists are DPI independent, so we always
                 // need to insert DPI compensation when drawing to them.
                 flags |= GetImageFlags::AlwaysInsertDpiCompensation;
+
+                // They also keep a reference to everything drawn into them.
+                flags &= ~GetImageFlags::NoLastingReference;
             }
             else
             {
@@ -174,6 +198,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             RefreshInputs(flags, targetDpi, deviceContext);
         }
 
+        // A caller that keeps the image could hold our D2D effect indefinitely,
+        // so it can no longer go back to the effect pool when we release it.
+        if ((flags & GetImageFlags::NoLastingReference) == GetImageFlags::None)
+            m_d2dEffectIsShared = true;
+
         if (realizedDpi)
             *realizedDpi = 0;
 
@@ -212,13 +241,40 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
+    //
+    // ICanvasEffectInternal
+    //
+
+    uint64_t CanvasEffect::AddD2DEffectReference()
+    {
+        auto lock = Lock(m_mutex);
+
+        if (!HasResource())
+            return 0;
+
+        m_d2dEffectReferenceCount++;
+
+        return m_realization;
+    }
+
+
+    void CanvasEffect::ReleaseD2DEffectReference(uint64_t realization)
+    {
+        auto lock = Lock(m_mutex);
+
+        // References to a previous realization were already accounted for when it was released.
+        if (realization == m_realization && m_d2dEffectReferenceCount > 0)
+            m_d2dEffectReferenceCount--;
+    }
+
+
     //
     // IClosable
     //
 
     IFACEMETHODIMP CanvasEffect::Close()
     {
-        ReleaseResource();
+        ReleaseD2DEffect();
 
         m_realizationDevice.Reset();
         m_workaround6146411.Reset();
@@ -406,6 +462,38 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
+    IFACEMETHODIMP CanvasEffect::get_RenderOnCpu(boolean* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                auto lock = Lock(m_mutex);
+
+                *value = m_renderOnCpu;
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasEffect::put_RenderOnCpu(boolean value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                auto lock = Lock(m_mutex);
+
+                m_renderOnCpu = !!value;
+
+                // The D2D effect is no longer needed, so give it back to the device.
+                if (m_renderOnCpu)
+                {
+                    Unrealize();
+                }
+            });
+    }
+
+
     IFACEMETHODIMP CanvasEffect::get_BufferPrecision(IReference<CanvasBufferPrecision>** value)
     {
         return ExceptionBoundary(
@@ -475,7 +563,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
     public:
         EffectRealizationContext(ICanvasResourceCreatorWithDpi* resourceCreator)
-            : m_flags(GetImageFlags::AllowNullEffectInputs)
+            : m_flags(GetImageFlags::AllowNullEffectInputs | GetImageFlags::NoLastingReference)
         {
             CheckInPointer(resourceCreator);
 
@@ -815,6 +903,13 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                 }
 
                 ThrowIfFailed(d2dEffect->SetInputCount(inputCount - 1));
+
+                // The removed input no longer uses its source or DPI compensator.
+                if (index < m_sources.size())
+                {
+                    ResetDpiCompensation(m_sources[index], IsD2DEffectShared());
+                    ReleaseSourceReference(m_sources[index]);
+                }
             }
 
             // This vector is not authoritative while realized, but we still do our best to keep it in sync.
@@ -892,28 +987,164 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
     ComPtr<ID2D1Effect> CanvasEffect::CreateD2DEffect(ID2D1DeviceContext* deviceContext, IID const& effectId)
     {
-        // If the caller provided a device context, we can use that.
-        // Otherwise, we must look up a resource creation device context.
+        // Reuse a pooled instance if the device has one, otherwise create the effect using
+        // the provided device context (or a resource creation context, if none was provided).
+        return As<ICanvasDeviceInternal>(RealizationDevice())->LeaseEffect(deviceContext, effectId);
+    }
+
+
+    void CanvasEffect::ReturnD2DEffect(IID const& effectId, ComPtr<ID2D1Effect>&& effect, bool isShared)
+    {
+        // Hand the effect back to the device, which pools it for reuse unless someone else still holds it.
+        if (RealizationDevice())
+        {
+            As<ICanvasDeviceInternal>(RealizationDevice())->ReleaseEffect(effectId, std::move(effect), isShared);
+        }
+    }
+
+
+    void CanvasEffect::ReleaseD2DEffect()
+    {
+        ComPtr<ID2D1Effect> d2dEffect = MaybeGetResource();
+
+        ReleaseResource();
+
+        bool isShared = IsD2DEffectShared();
+
+        // Start a new realization, so late releases from effects that used this one are ignored.
+        m_realization++;
+        m_d2dEffectReferenceCount = 0;
+        m_d2dEffectIsShared = false;
+
+        if (d2dEffect)
+        {
+            ReturnD2DEffect(m_effectId, std::move(d2dEffect), isShared);
+        }
+
+        // Whoever still holds our D2D effect can reach the rest of the graph behind it, so the
+        // DPI compensators share its fate, and our references to source effects are never released.
+        for (auto& sourceInfo : m_sources)
+        {
+            ResetDpiCompensation(sourceInfo, isShared);
+
+            if (isShared)
+            {
+                sourceInfo.ReferencedEffect.Reset();
+                sourceInfo.ReferencedRealization = 0;
+            }
+            else
+            {
+                ReleaseSourceReference(sourceInfo);
+            }
+        }
+    }
+
+
+    bool CanvasEffect::IsD2DEffectShared()
+    {
+        return m_d2dEffectIsShared || m_d2dEffectReferenceCount > 0;
+    }
+
+
+    void CanvasEffect::ResetDpiCompensation(SourceReference& sourceInfo, bool isShared)
+    {
+        if (sourceInfo.DpiCompensator)
+        {
+            ReturnD2DEffect(CLSID_D2D1DpiCompensation, std::move(sourceInfo.DpiCompensator), isShared);
+        }
+
+        sourceInfo.DpiCompensator.Reset();
+        sourceInfo.DpiCompensatorInput.Reset();
+        sourceInfo.DpiCompensatorInputDpi = 0;
+        sourceInfo.IsDpiCompensated = false;
+    }
+
+
+    void CanvasEffect::UpdateSourceReference(SourceReference& sourceInfo, IGraphicsEffectSource* source)
+    {
+        // Take the new reference before releasing the old one, in case they are the same effect.
+        auto sourceEffect = source ? MaybeAs<ICanvasEffectInternal>(source) : nullptr;
+        uint64_t realization = sourceEffect ? sourceEffect->AddD2DEffectReference() : 0;
+
+        ReleaseSourceReference(sourceInfo);
+
+        if (realization)
+        {
+            sourceInfo.ReferencedEffect = sourceEffect;
+            sourceInfo.ReferencedRealization = realization;
+        }
+    }
+
+
+    void CanvasEffect::ReleaseSourceReference(SourceReference& sourceInfo)
+    {
+        if (sourceInfo.ReferencedEffect)
+        {
+            sourceInfo.ReferencedEffect->ReleaseD2DEffectReference(sourceInfo.ReferencedRealization);
+        }
+
+        sourceInfo.ReferencedEffect.Reset();
+        sourceInfo.ReferencedRealization = 0;
+    }
+
+
+    ComPtr<ID2D1Image> CanvasEffect::RenderGraphOnCpu(ICanvasDevice* device, ID2D1DeviceContext* deviceContext)
+    {
+        // Bitmap sources are read back from the GPU as needed, one pixel per DIP.
+        CpuEffectRenderer renderer;
+
+        auto graph = As<IGraphicsEffectSource>(this);
+        auto bounds = renderer.GetBounds(graph.Get());
+
+        if (bounds.IsInfinite())
+            ThrowHR(E_INVALIDARG, Strings::CpuEffectRenderOnCpuInfiniteBounds);
+
+        auto pixels = CpuEffectKernels::ToBgra8(renderer.Render(graph.Get(), bounds));
+
         DeviceContextLease contextLease;
 
         if (!deviceContext)
         {
-            contextLease = As<ICanvasDeviceInternal>(RealizationDevice())->GetResourceCreationDeviceContext();
+            contextLease = As<ICanvasDeviceInternal>(device)->GetResourceCreationDeviceContext();
             deviceContext = contextLease.Get();
         }
 
-        // Create the effect.
-        ComPtr<ID2D1Effect> effect;
-        ThrowIfFailed(deviceContext->CreateEffect(effectId, &effect));
-        return effect;
+        // D2D cannot create empty bitmaps, so an empty result becomes a single transparent pixel.
+        auto width = static_cast<uint32_t>(std::max(bounds.Width(), 1));
+        auto height = static_cast<uint32_t>(std::max(bounds.Height(), 1));
+
+        pixels.resize(width * height * 4);
+
+        auto bitmapProperties = D2D1::BitmapProperties1(
+            D2D1_BITMAP_OPTIONS_NONE,
+            D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
+            DEFAULT_DPI,
+            DEFAULT_DPI);
+
+        ComPtr<ID2D1Bitmap1> bitmap;
+        ThrowIfFailed(deviceContext->CreateBitmap(D2D1::SizeU(width, height), pixels.data(), width * 4, &bitmapProperties, &bitmap));
+
+        if (bounds.IsEmpty() || (bounds.Left == 0 && bounds.Top == 0))
+            return bitmap;
+
+        // Bitmaps always start at the origin, so move the result to where the graph put it.
+        ComPtr<ID2D1Effect> offset;
+        ThrowIfFailed(deviceContext->CreateEffect(CLSID_D2D12DAffineTransform, &offset));
+
+        SetEffectInput(offset.Get(), 0, bitmap.Get());
+
+        ThrowIfFailed(offset->SetValue(D2D1_2DAFFINETRANSFORM_PROP_TRANSFORM_MATRIX,
+            D2D1::Matrix3x2F::Translation(static_cast<float>(bounds.Left), static_cast<float>(bounds.Top))));
+
+        return As<ID2D1Image>(offset);
     }
 
 
     bool CanvasEffect::ApplyDpiCompensation(unsigned int index, ComPtr<ID2D1Image>& inputImage, float inputDpi, GetImageFlags flags, float targetDpi, ID2D1DeviceContext* deviceContext)
     {
-        auto& dpiCompensator = m_sources[index].DpiCompensator;
+        auto& sourceInfo = m_sources[index];
 
-        bool hasDpiCompensation = (dpiCompensator != nullptr);
+        bool hasDpiCompensation = sourceInfo.IsDpiCompensated;
         bool needsDpiCompensation;
 
         if ((flags & GetImageFlags::MinimalRealization) != GetImageFlags::None)
@@ -938,15 +1169,13 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             needsDpiCompensation = (inputDpi != 0) &&
                                    !neverCompensate &&
                                    (alwaysCompensate || (inputDpi != targetDpi));
-
-            // Early out if we are already in the right state.
-            if (needsDpiCompensation == hasDpiCompensation)
-                return false;
         }
 
         if (needsDpiCompensation)
         {
-            // Create the D2D1DpiCompensation effect, if we don't have one already.
+            auto& dpiCompensator = sourceInfo.DpiCompensator;
+
+            // Create the D2D1DpiCompensation effect, if we don't have one cached already.
             if (!dpiCompensator)
             {
                 dpiCompensator = CreateD2DEffect(deviceContext, CLSID_D2D1DpiCompensation);
@@ -955,21 +1184,27 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                 ThrowIfFailed(dpiCompensator->SetValue(D2D1_DPICOMPENSATION_PROP_INTERPOLATION_MODE, D2D1_DPICOMPENSATION_INTERPOLATION_MODE_LINEAR));
             }
 
-            // Set our input image as source for the DPI compensation.
-            SetEffectInput(dpiCompensator.Get(), 0, inputImage.Get());
+            // Set our input image as source for the DPI compensation, if it has changed.
+            if (!IsSameInstance(sourceInfo.DpiCompensatorInput.Get(), inputImage.Get()))
+            {
+                SetEffectInput(dpiCompensator.Get(), 0, inputImage.Get());
+                sourceInfo.DpiCompensatorInput = inputImage;
+            }
 
-            // Set the DPI.
-            ThrowIfFailed(dpiCompensator->SetValue(D2D1_DPICOMPENSATION_PROP_INPUT_DPI, D2D1_VECTOR_2F{ inputDpi, inputDpi }));
+            // Set the DPI, if it has changed.
+            if (sourceInfo.DpiCompensatorInputDpi != inputDpi)
+            {
+                ThrowIfFailed(dpiCompensator->SetValue(D2D1_DPICOMPENSATION_PROP_INPUT_DPI, D2D1_VECTOR_2F{ inputDpi, inputDpi }));
+                sourceInfo.DpiCompensatorInputDpi = inputDpi;
+            }
 
             // Substitute our DPI compensation wrapper for the original input image.
             inputImage = As<ID2D1Image>(dpiCompensator);
         }
-        else
-        {
-            dpiCompensator.Reset();
-        }
 
-        return true;
+        sourceInfo.IsDpiCompensated = needsDpiCompensation;
+
+        return needsDpiCompensation != hasDpiCompensation;
     }
 
     
@@ -994,8 +1229,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             else
             {
                 // Get the underlying D2D interface. This call recurses through the effect graph.
+                // Source effects don't count this as a lasting reference, as we track our use of them.
                 float realizedDpi;
-                auto realizedSource = As<ICanvasImageInternal>(source)->GetD2DImage(RealizationDevice(), deviceContext, flags, targetDpi, &realizedDpi);
+                auto realizedSource = As<ICanvasImageInternal>(source)->GetD2DImage(RealizationDevice(), deviceContext, flags | GetImageFlags::NoLastingReference, targetDpi, &realizedDpi);
 
                 bool resourceChanged = sourceInfo.UpdateResource(realizedSource.Get());
 
@@ -1006,6 +1242,18 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                 {
                     SetEffectInput(d2dEffect.Get(), i, realizedSource.Get());
                 }
+
+                if (resourceChanged)
+                {
+                    UpdateSourceReference(sourceInfo, source.Get());
+                }
+
+                // Inputs without a fixed DPI never need compensation, so there is no point caching it.
+                // This waits until the compensator is out of the graph, so it can go back to the pool.
+                if (realizedDpi == 0 && sourceInfo.DpiCompensator)
+                {
+                    ResetDpiCompensation(sourceInfo, IsD2DEffectShared());
+                }
             }
         }
     }
@@ -1057,7 +1305,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             }
 
             // Get the underlying D2D interface. This call recurses through the effect graph.
-            realizedSource = internalSource->GetD2DImage(RealizationDevice(), deviceContext, flags, targetDpi, &realizedDpi);
+            // Source effects don't count this as a lasting reference, as we track our use of them.
+            realizedSource = internalSource->GetD2DImage(RealizationDevice(), deviceContext, flags | GetImageFlags::NoLastingReference, targetDpi, &realizedDpi);
 
             if (!realizedSource)
             {
@@ -1077,13 +1326,23 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         if (m_sources.size() <= index)
             m_sources.resize(index + 1);
 
-        m_sources[index].Set(realizedSource.Get(), source);
+        auto& sourceInfo = m_sources[index];
+
+        sourceInfo.Set(realizedSource.Get(), source);
 
         // Update the underlying D2D effect state.
         ApplyDpiCompensation(index, realizedSource, realizedDpi, flags, targetDpi, deviceContext);
 
         SetEffectInput(d2dEffect, index, realizedSource.Get());
 
+        UpdateSourceReference(sourceInfo, source);
+
+        // Inputs without a fixed DPI never need compensation, so there is no point caching it.
+        if (realizedDpi == 0 && sourceInfo.DpiCompensator)
+        {
+            ResetDpiCompensation(sourceInfo, IsD2DEffectShared());
+        }
+
         return true;
     }
 
@@ -1099,7 +1358,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             m_sources.resize(index + 1);
 
         // If this input had DPI compensation added, skip past that to report the real input image.
-        if (m_sources[index].DpiCompensator)
+        if (m_sources[index].IsDpiCompensated)
         {
             if (IsSameInstance(input.Get(), m_sources[index].DpiCompensator.Get()))
             {
@@ -1107,7 +1366,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             }
             else
             {
-                m_sources[index].DpiCompensator.Reset();
+                ResetDpiCompensation(m_sources[index], IsD2DEffectShared());
             }
         }
 
@@ -1137,6 +1396,166 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
+    void CanvasEffect::SetPropertyComponents(EffectPropertyComponent const* values, size_t count)
+    {
+        if (count && !values)
+            ThrowHR(E_INVALIDARG);
+
+        auto lock = Lock(m_mutex);
+
+        auto& d2dEffect = MaybeGetResource();
+
+        std::vector<float> floats;
+
+        for (size_t begin = 0; begin < count;)
+        {
+            auto index = values[begin].Index;
+
+            if (index >= m_properties.size())
+                ThrowHR(E_BOUNDS);
+
+            auto end = begin + 1;
+
+            while (end < count && values[end].Index == index)
+            {
+                end++;
+            }
+
+            // Read the current value, unless every element of it is about to be overwritten.
+            bool isArray;
+
+            if (d2dEffect)
+            {
+                switch (d2dEffect->GetType(index))
+                {
+                case D2D1_PROPERTY_TYPE_FLOAT:
+                    isArray = false;
+                    break;
+
+                case D2D1_PROPERTY_TYPE_VECTOR2:
+                case D2D1_PROPERTY_TYPE_VECTOR3:
+                case D2D1_PROPERTY_TYPE_VECTOR4:
+                case D2D1_PROPERTY_TYPE_MATRIX_3X2:
+                case D2D1_PROPERTY_TYPE_MATRIX_4X4:
+                case D2D1_PROPERTY_TYPE_MATRIX_5X4:
+                    isArray = true;
+                    break;
+
+                default:
+                    ThrowHR(E_INVALIDARG);
+                }
+
+                floats.resize(d2dEffect->GetValueSize(index) / sizeof(float));
+
+                if (isArray && end - begin < floats.size())
+                    ThrowIfFailed(d2dEffect->GetValue(index, reinterpret_cast<BYTE*>(floats.data()), static_cast<UINT32>(floats.size() * sizeof(float))));
+            }
+            else
+            {
+                auto& propertyValue = m_properties[index];
+
+                if (!propertyValue)
+                    ThrowHR(E_INVALIDARG);
+
+                PropertyType propertyType;
+                ThrowIfFailed(propertyValue->get_Type(&propertyType));
+
+                if (propertyType == PropertyType_Single)
+                {
+                    isArray = false;
+                    floats.resize(1);
+                }
+                else if (propertyType == PropertyType_SingleArray)
+                {
+                    isArray = true;
+
+                    ComArray<float> value;
+                    ThrowIfFailed(propertyValue->GetSingleArray(value.GetAddressOfSize(), value.GetAddressOfData()));
+
+                    floats.assign(value.GetData(), value.GetData() + value.GetSize());
+                }
+                else
+                {
+                    ThrowHR(E_INVALIDARG);
+                }
+            }
+
+            for (auto i = begin; i < end; i++)
+            {
+                if (values[i].Component >= floats.size())
+                    ThrowHR(E_BOUNDS);
+
+                floats[values[i].Component] = values[i].Value;
+            }
+
+            if (d2dEffect)
+            {
+                ThrowIfFailed(d2dEffect->SetValue(index, reinterpret_cast<BYTE*>(floats.data()), static_cast<UINT32>(floats.size() * sizeof(float))));
+            }
+            else if (isArray)
+            {
+                m_properties[index] = CreateProperty(m_propertyValueFactory.Get(), static_cast<uint32_t>(floats.size()), floats.data());
+            }
+            else
+            {
+                m_properties[index] = CreateProperty(m_propertyValueFactory.Get(), floats[0]);
+            }
+
+            begin = end;
+        }
+    }
+
+
+    unsigned int CanvasEffect::GetPropertyComponentCount(unsigned int index)
+    {
+        auto lock = Lock(m_mutex);
+
+        if (index >= m_properties.size())
+            ThrowHR(E_BOUNDS);
+
+        auto& d2dEffect = MaybeGetResource();
+
+        if (d2dEffect)
+        {
+            switch (d2dEffect->GetType(index))
+            {
+            case D2D1_PROPERTY_TYPE_FLOAT:
+            case D2D1_PROPERTY_TYPE_VECTOR2:
+            case D2D1_PROPERTY_TYPE_VECTOR3:
+            case D2D1_PROPERTY_TYPE_VECTOR4:
+            case D2D1_PROPERTY_TYPE_MATRIX_3X2:
+            case D2D1_PROPERTY_TYPE_MATRIX_4X4:
+            case D2D1_PROPERTY_TYPE_MATRIX_5X4:
+                break;
+
+            default:
+                ThrowHR(E_INVALIDARG);
+            }
+
+            return d2dEffect->GetValueSize(index) / sizeof(float);
+        }
+
+        auto& propertyValue = m_properties[index];
+
+        if (!propertyValue)
+            ThrowHR(E_INVALIDARG);
+
+        PropertyType propertyType;
+        ThrowIfFailed(propertyValue->get_Type(&propertyType));
+
+        if (propertyType == PropertyType_Single)
+            return 1;
+
+        if (propertyType != PropertyType_SingleArray)
+            ThrowHR(E_INVALIDARG);
+
+        ComArray<float> value;
+        ThrowIfFailed(propertyValue->GetSingleArray(value.GetAddressOfSize(), value.GetAddressOfData()));
+
+        return value.GetSize();
+    }
+
+
     void CanvasEffect::SetD2DProperty(ID2D1Effect* d2dEffect, unsigned int index, IPropertyValue* propertyValue)
     {
         PropertyType propertyType;
@@ -1370,26 +1789,39 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             m_cacheOutput = !!d2dEffect->GetValue<BOOL>(D2D1_PROPERTY_CACHED);
             m_bufferPrecision = d2dEffect->GetValue<D2D1_BUFFER_PRECISION>(D2D1_PROPERTY_PRECISION);
 
-            // Read back the list of source images from the D2D effect.
+            // Read back the list of source images from the D2D effect. This must happen before
+            // releasing it, but the new source state is only stored afterwards, as releasing
+            // needs the old state to return DPI compensators and source effect references.
+            std::vector<ComPtr<IGraphicsEffectSource>> sources;
+
             if (!skipAllSources)
             {
-                m_sources.resize(d2dEffect->GetInputCount());
+                sources.resize(d2dEffect->GetInputCount());
 
-                for (unsigned i = 0; i < m_sources.size(); ++i)
+                for (unsigned i = 0; i < sources.size(); ++i)
                 {
                     if (i != skipSourceIndex)
                     {
-                        m_sources[i] = GetD2DInput(d2dEffect.Get(), i).Get();
-                    }
-                    else
-                    {
-                        m_sources[i] = SourceReference();
+                        sources[i] = GetD2DInput(d2dEffect.Get(), i);
                     }
                 }
             }
 
             // Clear the effect resource.
-            ReleaseResource();
+            ReleaseD2DEffect();
+
+            if (!skipAllSources)
+            {
+                m_sources.resize(sources.size());
+
+                for (unsigned i = 0; i < sources.size(); ++i)
+                {
+                    if (sources[i])
+                        m_sources[i] = sources[i].Get();
+                    else
+                        m_sources[i] = SourceReference();
+                }
+            }
 
             m_workaround6146411.Reset();
         }
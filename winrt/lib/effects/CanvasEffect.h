@@ -29,6 +29,32 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     };
 
 
+    // A single float within an effect property, used by CanvasEffect::SetPropertyComponents.
+    // Index is the D2D property index, and Component selects an element of array valued
+    // properties (vectors, matrices, etc.) or must be zero for scalar float properties.
+    struct EffectPropertyComponent
+    {
+        unsigned int Index;
+        unsigned int Component;
+        float Value;
+    };
+
+
+    //
+    // Lets an effect tell the CanvasEffects it uses as inputs when it stops referencing
+    // their D2D effects. Each effect can then tell whether it is the last holder of its
+    // own D2D effect, and so whether it can be returned to the device's effect pool.
+    //
+    class __declspec(uuid("92BE7EEF-0ABC-4945-BE55-55EC8F41280B"))
+    ICanvasEffectInternal : public IUnknown
+    {
+    public:
+        // Returns a token identifying the current realization, to pass to ReleaseD2DEffectReference.
+        virtual uint64_t AddD2DEffectReference() = 0;
+        virtual void ReleaseD2DEffectReference(uint64_t realization) = 0;
+    };
+
+
     class CanvasEffect
         : public Implements<
             RuntimeClassFlags<WinRtClassicComMix>,
@@ -38,6 +64,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             ICanvasEffect,
             ICanvasImage,
             CloakedIid<ICanvasImageInternal>,
+            CloakedIid<ICanvasEffectInternal>,
             ChainInterfaces<
                 MixIn<CanvasEffect, ResourceWrapper<ID2D1Effect, CanvasEffect, IGraphicsEffect>>,
                 IClosable,
@@ -62,9 +89,22 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         boolean m_cacheOutput;
         D2D1_BUFFER_PRECISION m_bufferPrecision;
 
+        // When set, the graph rooted at this effect is evaluated by CpuEffectRenderer
+        // instead of being realized as D2D effects.
+        bool m_renderOnCpu;
+
         // Workaround Windows bug 6146411 (crash when reading back DESTINATION_COLOR_CONTEXT from a CLSID_D2D1ColorManagement effect).
         ComPtr<IUnknown> m_workaround6146411;
 
+        // Who else holds our D2D effect, which decides whether it can go back to the device's
+        // effect pool. Other CanvasEffects using it as an input are counted, and tell us when
+        // they let go. Anything else it is handed to might keep it indefinitely, so marks it
+        // as shared until the next realization. m_realization identifies which realization
+        // the counted references belong to.
+        uint64_t m_realization;
+        uint32_t m_d2dEffectReferenceCount;
+        bool m_d2dEffectIsShared;
+
 
         // State tracking the effect source images. This data is authoritative when
         // the effect is not realized - otherwise just a cache to speed reverse lookups.
@@ -76,14 +116,32 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         struct SourceReference : public CachedResourceReference<ID2D1Image, IGraphicsEffectSource>
         {
             SourceReference()
+                : DpiCompensatorInputDpi(0)
+                , IsDpiCompensated(false)
+                , ReferencedRealization(0)
             { }
 
             SourceReference(IGraphicsEffectSource* source)
+                : DpiCompensatorInputDpi(0)
+                , IsDpiCompensated(false)
+                , ReferencedRealization(0)
             {
                 Set(nullptr, source);
             }
 
+            // The DPI compensation effect is kept even while it is not inserted into the graph,
+            // so drawing alternately to targets that do and don't need compensation (eg. a command
+            // list and a render target) reuses the same instance rather than recreating it.
+            // CanvasEffect::ResetDpiCompensation returns it to the device's effect pool.
             ComPtr<ID2D1Effect> DpiCompensator;
+            ComPtr<ID2D1Image> DpiCompensatorInput;
+            float DpiCompensatorInputDpi;
+            bool IsDpiCompensated;
+
+            // When the source is a CanvasEffect, the reference we hold on its current
+            // realization, released by CanvasEffect::ReleaseSourceReference.
+            ComPtr<ICanvasEffectInternal> ReferencedEffect;
+            uint64_t ReferencedRealization;
         };
 
         std::vector<SourceReference> m_sources;
@@ -163,6 +221,13 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
         IFACEMETHOD(GetNativeResource)(ICanvasDevice* device, float dpi, REFIID iid, void** resource) override;
 
+        //
+        // ICanvasEffectInternal
+        //
+
+        virtual uint64_t AddD2DEffectReference() override;
+        virtual void ReleaseD2DEffectReference(uint64_t realization) override;
+
         //
         // IClosable
         //
@@ -195,11 +260,28 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         IFACEMETHOD(put_CacheOutput)(boolean value) override;
         IFACEMETHOD(get_BufferPrecision)(IReference<CanvasBufferPrecision>** value) override;
         IFACEMETHOD(put_BufferPrecision)(IReference<CanvasBufferPrecision>* value) override;
+        IFACEMETHOD(get_RenderOnCpu)(boolean* value) override;
+        IFACEMETHOD(put_RenderOnCpu)(boolean value) override;
         IFACEMETHOD(InvalidateSourceRectangle)(ICanvasResourceCreatorWithDpi* resourceCreator, uint32_t sourceIndex, Rect invalidRectangle) override;
         IFACEMETHOD(GetInvalidRectangles)(ICanvasResourceCreatorWithDpi* resourceCreator, uint32_t* valueCount, Rect** valueElements) override;
         IFACEMETHOD(GetRequiredSourceRectangle)(ICanvasResourceCreatorWithDpi* resourceCreator, Rect outputRectangle, ICanvasEffect* sourceEffect, uint32_t sourceIndex, Rect sourceBounds, Rect* value) override;
         IFACEMETHOD(GetRequiredSourceRectangles)(ICanvasResourceCreatorWithDpi* resourceCreator, Rect outputRectangle, uint32_t sourceEffectCount, ICanvasEffect** sourceEffects, uint32_t sourceIndexCount, uint32_t* sourceIndices, uint32_t sourceBoundsCount, Rect* sourceBounds, uint32_t* valueCount, Rect** valueElements) override;
 
+        //
+        // Internal
+        //
+
+        // Sets a batch of float property values while taking the lock only once. Values are
+        // in D2D form (as exposed by IGraphicsEffectD2D1Interop::GetProperty), and updates to
+        // the same property should be adjacent so it is only read and written once. When the
+        // effect is realized, values are written straight through without being boxed.
+        void SetPropertyComponents(EffectPropertyComponent const* values, size_t count);
+
+        // Returns how many floats make up the specified property, for use as the bound of
+        // EffectPropertyComponent::Component. Throws E_INVALIDARG if the property is not
+        // float valued, so callers can reject it before calling SetPropertyComponents.
+        unsigned int GetPropertyComponentCount(unsigned int index);
+
 
     protected:
         //
@@ -275,6 +357,13 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
     private:
         ComPtr<ID2D1Effect> CreateD2DEffect(ID2D1DeviceContext* deviceContext, IID const& effectId);
+        void ReturnD2DEffect(IID const& effectId, ComPtr<ID2D1Effect>&& effect, bool isShared);
+        void ReleaseD2DEffect();
+        bool IsD2DEffectShared();
+        void ResetDpiCompensation(SourceReference& sourceInfo, bool isShared);
+        void UpdateSourceReference(SourceReference& sourceInfo, IGraphicsEffectSource* source);
+        void ReleaseSourceReference(SourceReference& sourceInfo);
+        ComPtr<ID2D1Image> RenderGraphOnCpu(ICanvasDevice* device, ID2D1DeviceContext* deviceContext);
         bool ApplyDpiCompensation(unsigned int index, ComPtr<ID2D1Image>& inputImage, float inputDpi, GetImageFlags flags, float targetDpi, ID2D1DeviceContext* deviceContext);
         void RefreshInputs(GetImageFlags flags, float targetDpi, ID2D1DeviceContext* deviceContext);
         
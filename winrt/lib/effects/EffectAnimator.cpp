@@ -0,0 +1,607 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "EffectAnimator.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    //
+    // Easing functions. These are written to be inlined into the batch loops in
+    // EffectAnimator::Update, as well as used by EffectAnimationCurve::Evaluate.
+    //
+
+    static inline float EaseCubicBezier(float progress, float x1, float y1, float x2, float y2)
+    {
+        // Solve x(s) = progress by bisection. A fixed iteration count (rather than
+        // Newton's method with an early out) keeps this branch free, and is accurate
+        // to well below what a float property can show.
+        float lo = 0;
+        float hi = 1;
+
+        for (int i = 0; i < 20; i++)
+        {
+            float s = (lo + hi) * 0.5f;
+            float t = 1 - s;
+            float x = 3 * t * t * s * x1 + 3 * t * s * s * x2 + s * s * s;
+
+            bool isBelow = x < progress;
+
+            lo = isBelow ? s : lo;
+            hi = isBelow ? hi : s;
+        }
+
+        float s = (lo + hi) * 0.5f;
+        float t = 1 - s;
+
+        return 3 * t * t * s * y1 + 3 * t * s * s * y2 + s * s * s;
+    }
+
+
+    static inline float EaseSpring(float elapsedSeconds, float angularFrequency, float dampingRatio)
+    {
+        // Displacement of a damped harmonic oscillator released at rest from 0, settling at 1.
+        float w = angularFrequency;
+        float z = dampingRatio;
+        float t = elapsedSeconds;
+
+        if (z < 1)
+        {
+            float wd = w * sqrtf(1 - z * z);
+
+            return 1 - expf(-z * w * t) * (cosf(wd * t) + (z * w / wd) * sinf(wd * t));
+        }
+        else if (z == 1)
+        {
+            return 1 - expf(-w * t) * (1 + w * t);
+        }
+        else
+        {
+            float root = sqrtf(z * z - 1);
+            float r1 = -w * (z - root);
+            float r2 = -w * (z + root);
+
+            return 1 - (r2 * expf(r1 * t) - r1 * expf(r2 * t)) / (r2 - r1);
+        }
+    }
+
+
+    //
+    // Keyframes and curves
+    //
+
+    static float Saturate(float value)
+    {
+        return std::min(std::max(value, 0.0f), 1.0f);
+    }
+
+
+    static EffectAnimationKeyframe MakeKeyframe(float time, float value, EffectAnimationEasing easing, float p0 = 0, float p1 = 0, float p2 = 0, float p3 = 0)
+    {
+        return EffectAnimationKeyframe{ time, value, easing, { p0, p1, p2, p3 } };
+    }
+
+
+    EffectAnimationKeyframe EffectAnimationKeyframe::Step(float time, float value)
+    {
+        return MakeKeyframe(time, value, EffectAnimationEasing::Step);
+    }
+
+
+    EffectAnimationKeyframe EffectAnimationKeyframe::Linear(float time, float value)
+    {
+        return MakeKeyframe(time, value, EffectAnimationEasing::Linear);
+    }
+
+
+    EffectAnimationKeyframe EffectAnimationKeyframe::CubicBezier(float time, float value, float x1, float y1, float x2, float y2)
+    {
+        // As in CSS, the x coordinates must stay within [0, 1] so the curve is a function of time.
+        return MakeKeyframe(time, value, EffectAnimationEasing::CubicBezier, Saturate(x1), y1, Saturate(x2), y2);
+    }
+
+
+    EffectAnimationKeyframe EffectAnimationKeyframe::Spring(float time, float value, float angularFrequency, float dampingRatio)
+    {
+        if (angularFrequency <= 0 || dampingRatio <= 0)
+            ThrowHR(E_INVALIDARG);
+
+        return MakeKeyframe(time, value, EffectAnimationEasing::Spring, angularFrequency, dampingRatio);
+    }
+
+
+    // Locates the keyframe segment that contains the specified time. Returns false if
+    // the curve is holding a constant value, which is stored in *from.
+    static bool FindSegment(EffectAnimationCurve const& curve, float time, EffectAnimationKeyframe const** from, EffectAnimationKeyframe const** to, float* elapsed)
+    {
+        auto& keyframes = curve.Keyframes;
+
+        auto& first = keyframes.front();
+        auto& last = keyframes.back();
+
+        float duration = last.Time - first.Time;
+
+        if (curve.IsLooped && duration > 0 && time > last.Time)
+        {
+            time = first.Time + fmodf(time - first.Time, duration);
+        }
+
+        if (time <= first.Time)
+        {
+            *from = &first;
+            return false;
+        }
+
+        if (time >= last.Time)
+        {
+            *from = &last;
+            return false;
+        }
+
+        auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+            [](float t, EffectAnimationKeyframe const& keyframe) { return t < keyframe.Time; });
+
+        *to = &*next;
+        *from = &*(next - 1);
+        *elapsed = time - (*from)->Time;
+
+        return true;
+    }
+
+
+    float EffectAnimationCurve::Evaluate(float time) const
+    {
+        if (Keyframes.empty())
+            ThrowHR(E_INVALIDARG);
+
+        EffectAnimationKeyframe const* from;
+        EffectAnimationKeyframe const* to;
+        float elapsed;
+
+        if (!FindSegment(*this, time, &from, &to, &elapsed))
+            return from->Value;
+
+        float progress = elapsed / (to->Time - from->Time);
+        float eased;
+
+        switch (from->Easing)
+        {
+        case EffectAnimationEasing::Linear:
+            eased = progress;
+            break;
+
+        case EffectAnimationEasing::CubicBezier:
+            eased = EaseCubicBezier(progress, from->Parameters[0], from->Parameters[1], from->Parameters[2], from->Parameters[3]);
+            break;
+
+        case EffectAnimationEasing::Spring:
+            eased = EaseSpring(elapsed, from->Parameters[0], from->Parameters[1]);
+            break;
+
+        default:
+            eased = 0;
+            break;
+        }
+
+        return from->Value + (to->Value - from->Value) * eased;
+    }
+
+
+    //
+    // EffectAnimator
+    //
+
+    static CanvasEffect* GetCanvasEffect(IGraphicsEffect* effect)
+    {
+        // Only Win2D effects implement both of these, and they all derive from CanvasEffect.
+        auto canvasEffect = MaybeAs<ICanvasEffect>(effect);
+
+        if (!canvasEffect || !MaybeAs<ICanvasImageInternal>(effect))
+            ThrowHR(E_INVALIDARG);
+
+        return static_cast<CanvasEffect*>(canvasEffect.Get());
+    }
+
+
+    void EffectAnimator::SegmentBatch::Clear()
+    {
+        Bindings.clear();
+        Progress.clear();
+        From.clear();
+        To.clear();
+
+        for (auto& parameter : Parameters)
+        {
+            parameter.clear();
+        }
+    }
+
+
+    void EffectAnimator::SegmentBatch::Add(uint32_t binding, float progress, float from, float to, float const (&parameters)[4])
+    {
+        Bindings.push_back(binding);
+        Progress.push_back(progress);
+        From.push_back(from);
+        To.push_back(to);
+
+        for (int i = 0; i < 4; i++)
+        {
+            Parameters[i].push_back(parameters[i]);
+        }
+    }
+
+
+    EffectAnimator::EffectAnimator()
+        : m_nextId(1)
+        , m_isSorted(true)
+    {
+    }
+
+
+    EffectAnimator::BindingId EffectAnimator::AddBinding(IGraphicsEffect* effect, unsigned int propertyIndex, unsigned int component, EffectAnimationCurve curve)
+    {
+        CheckInPointer(effect);
+
+        if (curve.Keyframes.empty())
+            ThrowHR(E_INVALIDARG);
+
+        auto target = GetCanvasEffect(effect);
+
+        // Validate the target here, so a bad binding cannot make every subsequent Update throw.
+        if (component >= target->GetPropertyComponentCount(propertyIndex))
+            ThrowHR(E_BOUNDS);
+
+        std::stable_sort(curve.Keyframes.begin(), curve.Keyframes.end(),
+            [](EffectAnimationKeyframe const& a, EffectAnimationKeyframe const& b) { return a.Time < b.Time; });
+
+        Lock lock(m_mutex);
+
+        auto id = m_nextId++;
+
+        m_bindings.push_back(Binding{ id, effect, target, propertyIndex, component, std::move(curve) });
+        m_isSorted = false;
+
+        return id;
+    }
+
+
+    void EffectAnimator::RemoveBinding(BindingId id)
+    {
+        Lock lock(m_mutex);
+
+        m_bindings.erase(std::remove_if(m_bindings.begin(), m_bindings.end(),
+            [=](Binding const& binding) { return binding.Id == id; }),
+            m_bindings.end());
+    }
+
+
+    void EffectAnimator::RemoveBindings(IGraphicsEffect* effect)
+    {
+        Lock lock(m_mutex);
+
+        m_bindings.erase(std::remove_if(m_bindings.begin(), m_bindings.end(),
+            [=](Binding const& binding) { return IsSameInstance(binding.Effect.Get(), effect); }),
+            m_bindings.end());
+    }
+
+
+    void EffectAnimator::Clear()
+    {
+        Lock lock(m_mutex);
+
+        m_bindings.clear();
+    }
+
+
+    size_t EffectAnimator::GetBindingCount()
+    {
+        Lock lock(m_mutex);
+
+        return m_bindings.size();
+    }
+
+
+    void EffectAnimator::Update(TimeSpan totalTime)
+    {
+        Update(static_cast<float>(totalTime.Duration / 10000000.0));
+    }
+
+
+    void EffectAnimator::Update(float totalSeconds)
+    {
+        Lock lock(m_mutex);
+
+        if (m_bindings.empty())
+            return;
+
+        if (!m_isSorted)
+            SortBindings();
+
+        // Sort the active segment of each curve into batches by easing type.
+        for (auto& batch : m_batches)
+        {
+            batch.Clear();
+        }
+
+        static const float noParameters[4] = {};
+
+        auto& holds = m_batches[static_cast<int>(EffectAnimationEasing::Step)];
+
+        for (uint32_t i = 0; i < m_bindings.size(); i++)
+        {
+            EffectAnimationKeyframe const* from;
+            EffectAnimationKeyframe const* to;
+            float elapsed;
+
+            if (!FindSegment(m_bindings[i].Curve, totalSeconds, &from, &to, &elapsed))
+            {
+                holds.Add(i, 0, from->Value, from->Value, noParameters);
+            }
+            else
+            {
+                // Springs work in seconds, while other easings use normalized progress.
+                float progress = (from->Easing == EffectAnimationEasing::Spring) ? elapsed : elapsed / (to->Time - from->Time);
+
+                m_batches[static_cast<int>(from->Easing)].Add(i, progress, from->Value, to->Value, from->Parameters);
+            }
+        }
+
+        // Evaluate each batch with a tight loop over contiguous arrays.
+        for (size_t easing = 0; easing < _countof(m_batches); easing++)
+        {
+            auto& batch = m_batches[easing];
+            auto count = batch.Bindings.size();
+
+            auto progress = batch.Progress.data();
+            auto p0 = batch.Parameters[0].data();
+            auto p1 = batch.Parameters[1].data();
+            auto p2 = batch.Parameters[2].data();
+            auto p3 = batch.Parameters[3].data();
+
+            switch (static_cast<EffectAnimationEasing>(easing))
+            {
+            case EffectAnimationEasing::Step:
+                for (size_t i = 0; i < count; i++)
+                {
+                    progress[i] = 0;
+                }
+                break;
+
+            case EffectAnimationEasing::Linear:
+                break;
+
+            case EffectAnimationEasing::CubicBezier:
+                for (size_t i = 0; i < count; i++)
+                {
+                    progress[i] = EaseCubicBezier(progress[i], p0[i], p1[i], p2[i], p3[i]);
+                }
+                break;
+
+            case EffectAnimationEasing::Spring:
+                for (size_t i = 0; i < count; i++)
+                {
+                    progress[i] = EaseSpring(progress[i], p0[i], p1[i]);
+                }
+                break;
+            }
+
+            auto from = batch.From.data();
+            auto to = batch.To.data();
+
+            for (size_t i = 0; i < count; i++)
+            {
+                progress[i] = from[i] + (to[i] - from[i]) * progress[i];
+            }
+        }
+
+        // Scatter the results back into binding order.
+        m_results.resize(m_bindings.size());
+
+        for (auto& batch : m_batches)
+        {
+            for (size_t i = 0; i < batch.Bindings.size(); i++)
+            {
+                m_results[batch.Bindings[i]] = batch.Progress[i];
+            }
+        }
+
+        // Bindings are sorted by effect, so commit each run of them with a single call.
+        for (size_t begin = 0; begin < m_bindings.size();)
+        {
+            auto target = m_bindings[begin].Target;
+
+            m_commits.clear();
+
+            auto end = begin;
+
+            for (; end < m_bindings.size() && m_bindings[end].Target == target; end++)
+            {
+                m_commits.push_back(EffectPropertyComponent{ m_bindings[end].PropertyIndex, m_bindings[end].Component, m_results[end] });
+            }
+
+            target->SetPropertyComponents(m_commits.data(), m_commits.size());
+
+            begin = end;
+        }
+    }
+
+
+    void EffectAnimator::SortBindings()
+    {
+        // Group by effect, then by property, as expected by CanvasEffect::SetPropertyComponents.
+        // Ties keep the order they were added in, so when two bindings target the same value
+        // the most recently added one wins.
+        std::stable_sort(m_bindings.begin(), m_bindings.end(),
+            [](Binding const& a, Binding const& b)
+            {
+                if (a.Target != b.Target)
+                    return std::less<CanvasEffect*>()(a.Target, b.Target);
+
+                if (a.PropertyIndex != b.PropertyIndex)
+                    return a.PropertyIndex < b.PropertyIndex;
+
+                return a.Component < b.Component;
+            });
+
+        m_isSorted = true;
+    }
+
+
+    //
+    // CanvasEffectAnimator
+    //
+
+    IFACEMETHODIMP CanvasEffectAnimatorFactory::ActivateInstance(IInspectable** object)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckAndClearOutPointer(object);
+
+                auto animator = Make<CanvasEffectAnimator>();
+                CheckMakeResult(animator);
+
+                ThrowIfFailed(animator.CopyTo(object));
+            });
+    }
+
+
+    static EffectAnimationKeyframe ToEffectAnimationKeyframe(CanvasEffectKeyframe const& keyframe, float valueScale)
+    {
+        auto value = keyframe.Value * valueScale;
+        auto& parameters = keyframe.EasingParameters;
+
+        switch (keyframe.Easing)
+        {
+        case CanvasEffectEasing::Step:
+            return EffectAnimationKeyframe::Step(keyframe.Time, value);
+
+        case CanvasEffectEasing::Linear:
+            return EffectAnimationKeyframe::Linear(keyframe.Time, value);
+
+        case CanvasEffectEasing::CubicBezier:
+            return EffectAnimationKeyframe::CubicBezier(keyframe.Time, value, parameters.X, parameters.Y, parameters.Z, parameters.W);
+
+        case CanvasEffectEasing::Spring:
+            return EffectAnimationKeyframe::Spring(keyframe.Time, value, parameters.X, parameters.Y);
+
+        default:
+            ThrowHR(E_INVALIDARG);
+        }
+    }
+
+
+    IFACEMETHODIMP CanvasEffectAnimator::AddAnimation(
+        IGraphicsEffect* effect,
+        HSTRING propertyName,
+        uint32_t component,
+        uint32_t keyframeCount,
+        CanvasEffectKeyframe* keyframes,
+        boolean isLooped,
+        uint32_t* animationId)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(effect);
+                CheckInPointer(keyframes);
+                CheckInPointer(animationId);
+
+                UINT propertyIndex;
+                GRAPHICS_EFFECT_PROPERTY_MAPPING mapping;
+
+                ThrowIfFailed(As<IGraphicsEffectD2D1Interop>(effect)->GetNamedPropertyMapping(WindowsGetStringRawBuffer(propertyName, nullptr), &propertyIndex, &mapping));
+
+                float valueScale = 1;
+
+                // Only mappings that turn each public float into one D2D float can be animated.
+                switch (mapping)
+                {
+                case GRAPHICS_EFFECT_PROPERTY_MAPPING_DIRECT:
+                    break;
+
+                case GRAPHICS_EFFECT_PROPERTY_MAPPING_RADIANS_TO_DEGREES:
+                    valueScale = ::DirectX::XMConvertToDegrees(1);
+                    break;
+
+                case GRAPHICS_EFFECT_PROPERTY_MAPPING_VECTORX:
+                case GRAPHICS_EFFECT_PROPERTY_MAPPING_VECTORY:
+                case GRAPHICS_EFFECT_PROPERTY_MAPPING_VECTORZ:
+                case GRAPHICS_EFFECT_PROPERTY_MAPPING_VECTORW:
+                    if (component != 0)
+                        ThrowHR(E_BOUNDS);
+
+                    component = static_cast<uint32_t>(mapping - GRAPHICS_EFFECT_PROPERTY_MAPPING_VECTORX);
+                    break;
+
+                default:
+                    ThrowHR(E_INVALIDARG);
+                }
+
+                EffectAnimationCurve curve{ {}, !!isLooped };
+
+                std::transform(keyframes, keyframes + keyframeCount, std::back_inserter(curve.Keyframes),
+                    [=](CanvasEffectKeyframe const& keyframe) { return ToEffectAnimationKeyframe(keyframe, valueScale); });
+
+                *animationId = m_animator.AddBinding(effect, propertyIndex, component, std::move(curve));
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasEffectAnimator::RemoveAnimation(uint32_t animationId)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                m_animator.RemoveBinding(animationId);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasEffectAnimator::RemoveAnimations(IGraphicsEffect* effect)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(effect);
+
+                m_animator.RemoveBindings(effect);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasEffectAnimator::Clear()
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                m_animator.Clear();
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasEffectAnimator::get_AnimationCount(int32_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                *value = static_cast<int32_t>(m_animator.GetBindingCount());
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasEffectAnimator::Update(TimeSpan totalTime)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                m_animator.Update(totalTime);
+            });
+    }
+
+
+    ActivatableClassWithFactory(CanvasEffectAnimator, CanvasEffectAnimatorFactory);
+}}}}}
@@ -0,0 +1,183 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    using namespace ::Microsoft::WRL;
+    using namespace ABI::Windows::Foundation;
+
+    class CanvasEffect;
+
+
+    enum class EffectAnimationEasing
+    {
+        // Holds the keyframe value until the next keyframe.
+        Step,
+
+        // Interpolates linearly to the next keyframe.
+        Linear,
+
+        // CSS style cubic Bezier timing function, with control points
+        // (Parameters[0], Parameters[1]) and (Parameters[2], Parameters[3]).
+        CubicBezier,
+
+        // Damped spring pulling towards the next keyframe value, with angular frequency
+        // Parameters[0] (radians per second) and damping ratio Parameters[1]. Values below
+        // one overshoot and oscillate. The spring jumps to the next keyframe when it is reached.
+        Spring,
+    };
+
+
+    // Keyframe times are in seconds. Easing controls how the value moves from this keyframe to the next.
+    struct EffectAnimationKeyframe
+    {
+        float Time;
+        float Value;
+        EffectAnimationEasing Easing;
+        float Parameters[4];
+
+        static EffectAnimationKeyframe Step(float time, float value);
+        static EffectAnimationKeyframe Linear(float time, float value);
+        static EffectAnimationKeyframe CubicBezier(float time, float value, float x1, float y1, float x2, float y2);
+        static EffectAnimationKeyframe Spring(float time, float value, float angularFrequency, float dampingRatio);
+    };
+
+
+    // A keyframe timeline for a single float. Before the first keyframe the curve holds the first
+    // value, and after the last it either holds the last value or, if IsLooped, repeats from the start.
+    struct EffectAnimationCurve
+    {
+        std::vector<EffectAnimationKeyframe> Keyframes;
+        bool IsLooped;
+
+        // Reference implementation used for one-off evaluation. EffectAnimator evaluates
+        // all of its curves together, but produces the same results as this.
+        float Evaluate(float time) const;
+    };
+
+
+    //
+    // Drives effect properties from keyframe curves.
+    //
+    // Each binding connects a curve to one float of an effect property (a scalar
+    // float, or an element of a vector or matrix property). Update evaluates every
+    // binding, then commits the results to each effect with a single call to
+    // CanvasEffect::SetPropertyComponents, rather than one boxed, locked property
+    // set per value.
+    //
+    // Curves are evaluated in batches: bindings are first sorted into structure of
+    // arrays form grouped by easing type, so the per-easing math runs as tight loops
+    // over contiguous floats that the compiler can vectorize.
+    //
+    // Bindings hold a reference to their effect until they are removed.
+    // Apps reach this through CanvasEffectAnimator. Methods may be called from any thread.
+    //
+    class EffectAnimator
+    {
+    public:
+        typedef uint32_t BindingId;
+
+        EffectAnimator();
+
+        // Property indices and values are in D2D form, as exposed by IGraphicsEffectD2D1Interop.
+        // Throws E_INVALIDARG if the property is not float valued, or E_BOUNDS if propertyIndex
+        // or component is out of range.
+        BindingId AddBinding(IGraphicsEffect* effect, unsigned int propertyIndex, unsigned int component, EffectAnimationCurve curve);
+
+        void RemoveBinding(BindingId id);
+        void RemoveBindings(IGraphicsEffect* effect);
+        void Clear();
+
+        size_t GetBindingCount();
+
+        void Update(TimeSpan totalTime);
+        void Update(float totalSeconds);
+
+    private:
+        struct Binding
+        {
+            BindingId Id;
+            ComPtr<IGraphicsEffect> Effect;
+            CanvasEffect* Target;
+            unsigned int PropertyIndex;
+            unsigned int Component;
+            EffectAnimationCurve Curve;
+        };
+
+        // Per-update scratch state, kept around to avoid reallocating every frame.
+        struct SegmentBatch
+        {
+            std::vector<uint32_t> Bindings;
+            std::vector<float> Progress;
+            std::vector<float> From;
+            std::vector<float> To;
+            std::vector<float> Parameters[4];
+
+            void Clear();
+            void Add(uint32_t binding, float progress, float from, float to, float const (&parameters)[4]);
+        };
+
+        std::mutex m_mutex;
+        std::vector<Binding> m_bindings;
+        BindingId m_nextId;
+        bool m_isSorted;
+
+        SegmentBatch m_batches[4];
+        std::vector<float> m_results;
+        std::vector<EffectPropertyComponent> m_commits;
+
+        void SortBindings();
+    };
+
+
+    class CanvasEffectAnimatorFactory
+        : public AgileActivationFactory<>
+        , private LifespanTracker<CanvasEffectAnimatorFactory>
+    {
+    public:
+        IFACEMETHOD(ActivateInstance)(IInspectable** object) override;
+    };
+
+
+    //
+    // The WinRT face of EffectAnimator. Properties are identified by the names
+    // used by IGraphicsEffectD2D1Interop::GetNamedPropertyMapping, and keyframe
+    // values use the units of the effect's public property, so angles are in
+    // radians even though D2D stores them in degrees.
+    //
+    // Apps can update an animator themselves, or use the one owned by a
+    // CanvasAnimatedControl, which updates it before each Update event.
+    //
+    class CanvasEffectAnimator : public RuntimeClass<ICanvasEffectAnimator>
+                               , private LifespanTracker<CanvasEffectAnimator>
+    {
+        InspectableClass(RuntimeClass_Microsoft_Graphics_Canvas_Effects_CanvasEffectAnimator, BaseTrust);
+
+        EffectAnimator m_animator;
+
+    public:
+        IFACEMETHOD(AddAnimation)(
+            IGraphicsEffect* effect,
+            HSTRING propertyName,
+            uint32_t component,
+            uint32_t keyframeCount,
+            CanvasEffectKeyframe* keyframes,
+            boolean isLooped,
+            uint32_t* animationId) override;
+
+        IFACEMETHOD(RemoveAnimation)(uint32_t animationId) override;
+
+        IFACEMETHOD(RemoveAnimations)(IGraphicsEffect* effect) override;
+
+        IFACEMETHOD(Clear)() override;
+
+        IFACEMETHOD(get_AnimationCount)(int32_t* value) override;
+
+        IFACEMETHOD(Update)(TimeSpan totalTime) override;
+
+        EffectAnimator& GetAnimator() { return m_animator; }
+    };
+}}}}}
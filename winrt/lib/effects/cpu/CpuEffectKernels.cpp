@@ -0,0 +1,1067 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+// This file deliberately does not use the precompiled header, as it must not
+// depend on anything beyond the C++ standard library.
+
+#include <algorithm>
+#include <cmath>
+
+#include "CpuEffectKernels.h"
+
+namespace CpuEffectKernels
+{
+    static_assert(sizeof(CpuColor) == sizeof(float) * 4, "Kernels treat rows of CpuColor as contiguous float arrays");
+
+
+    //
+    // Helpers
+    //
+
+    static float Clamp01(float value)
+    {
+        return std::min(std::max(value, 0.0f), 1.0f);
+    }
+
+
+    static CpuColor Clamp01(CpuColor const& color)
+    {
+        return CpuColor{ Clamp01(color.R), Clamp01(color.G), Clamp01(color.B), Clamp01(color.A) };
+    }
+
+
+    static int ClampToExtent(float value)
+    {
+        const float extent = static_cast<float>(CpuRect::InfiniteExtent);
+
+        if (!(value > -extent))
+            return -CpuRect::InfiniteExtent;
+
+        if (!(value < extent))
+            return CpuRect::InfiniteExtent;
+
+        return static_cast<int>(value);
+    }
+
+
+    static int FloorToInt(float value)
+    {
+        return ClampToExtent(std::floor(value));
+    }
+
+
+    static int CeilToInt(float value)
+    {
+        return ClampToExtent(std::ceil(value));
+    }
+
+
+    static int ClampCoordinate(int value, int low, int high)
+    {
+        return std::min(std::max(value, low), high - 1);
+    }
+
+
+    // dest[i] += weight * source[i], written so compilers can vectorize it.
+    static void MultiplyAdd(float* dest, float const* source, float weight, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            dest[i] += weight * source[i];
+        }
+    }
+
+
+    static void ScaleRow(CpuColor* row, int count, float scale)
+    {
+        float* values = &row->R;
+
+        for (size_t i = 0; i < static_cast<size_t>(count) * 4; i++)
+        {
+            values[i] *= scale;
+        }
+    }
+
+
+    //
+    // GaussianBlur
+    //
+
+    int GetGaussianBlurRadius(float standardDeviation)
+    {
+        if (!(standardDeviation > 0))
+            return 0;
+
+        // Beyond three standard deviations the weights no longer contribute a visible amount.
+        return CeilToInt(standardDeviation * 3.0f);
+    }
+
+
+    CpuRect GetGaussianBlurBounds(CpuRect const& inputBounds, float standardDeviation, BorderMode borderMode)
+    {
+        if (borderMode == BorderMode::Hard)
+            return inputBounds;
+
+        auto radius = GetGaussianBlurRadius(standardDeviation);
+
+        return inputBounds.Inflate(radius, radius);
+    }
+
+
+    CpuRect GetGaussianBlurSourceRect(CpuRect const& outputRect, CpuRect const& inputBounds, float standardDeviation, BorderMode)
+    {
+        auto radius = GetGaussianBlurRadius(standardDeviation);
+
+        return Intersect(outputRect.Inflate(radius, radius), inputBounds);
+    }
+
+
+    static std::vector<float> GetGaussianWeights(float standardDeviation, int radius)
+    {
+        std::vector<float> weights(radius * 2 + 1, 1.0f);
+
+        if (radius == 0)
+            return weights;
+
+        float sum = 0;
+
+        for (int i = -radius; i <= radius; i++)
+        {
+            float weight = std::exp(-static_cast<float>(i * i) / (2 * standardDeviation * standardDeviation));
+
+            weights[i + radius] = weight;
+            sum += weight;
+        }
+
+        for (auto& weight : weights)
+        {
+            weight /= sum;
+        }
+
+        return weights;
+    }
+
+
+    CpuImage GaussianBlur(CpuImage const& input, CpuRect const& inputBounds, float standardDeviation, BorderMode borderMode, CpuRect const& outputRect)
+    {
+        CpuImage output(outputRect);
+
+        // With a hard border the blur is clipped to the input, and samples past its edges are clamped.
+        bool isHard = (borderMode == BorderMode::Hard);
+
+        auto blurRect = isHard ? Intersect(outputRect, inputBounds) : outputRect;
+
+        if (blurRect.IsEmpty())
+            return output;
+
+        auto sampleRect = isHard ? inputBounds : CpuRect::Infinite();
+
+        int radius = GetGaussianBlurRadius(standardDeviation);
+        auto weights = GetGaussianWeights(standardDeviation, radius);
+
+        int width = blurRect.Width();
+        int rowCount = blurRect.Height() + radius * 2;
+        size_t floatsPerRow = static_cast<size_t>(width) * 4;
+
+        // Horizontal pass, covering enough rows above and below the output for the vertical pass.
+        std::vector<CpuColor> horizontal(static_cast<size_t>(width) * rowCount, CpuColor{ 0, 0, 0, 0 });
+        std::vector<CpuColor> paddedRow(width + radius * 2);
+
+        for (int row = 0; row < rowCount; row++)
+        {
+            int y = ClampCoordinate(blurRect.Top - radius + row, sampleRect.Top, sampleRect.Bottom);
+
+            for (int i = 0; i < static_cast<int>(paddedRow.size()); i++)
+            {
+                int x = ClampCoordinate(blurRect.Left - radius + i, sampleRect.Left, sampleRect.Right);
+
+                paddedRow[i] = input.GetPixel(x, y);
+            }
+
+            float* dest = &horizontal[static_cast<size_t>(row) * width].R;
+
+            for (size_t k = 0; k < weights.size(); k++)
+            {
+                MultiplyAdd(dest, &paddedRow[k].R, weights[k], floatsPerRow);
+            }
+        }
+
+        // Vertical pass.
+        for (int y = blurRect.Top; y < blurRect.Bottom; y++)
+        {
+            float* dest = &output.GetRow(y)[blurRect.Left - outputRect.Left].R;
+
+            for (size_t k = 0; k < weights.size(); k++)
+            {
+                MultiplyAdd(dest, &horizontal[(y - blurRect.Top + k) * width].R, weights[k], floatsPerRow);
+            }
+        }
+
+        return output;
+    }
+
+
+    //
+    // ColorMatrix
+    //
+
+    void ColorMatrix(CpuImage& image, float const (&m)[20], ColorMatrixAlphaMode alphaMode, bool clampOutput)
+    {
+        // In premultiplied mode the matrix applies to straight colors, so we
+        // unpremultiply first and premultiply the result. Straight mode applies
+        // the matrix directly to the stored values.
+        bool isPremultiplied = (alphaMode == ColorMatrixAlphaMode::Premultiplied);
+
+        auto& bounds = image.GetBounds();
+
+        for (int y = bounds.Top; y < bounds.Bottom; y++)
+        {
+            auto row = image.GetRow(y);
+
+            for (int x = 0; x < bounds.Width(); x++)
+            {
+                auto in = row[x];
+
+                if (isPremultiplied)
+                {
+                    float scale = (in.A > 0) ? 1.0f / in.A : 0.0f;
+
+                    in.R *= scale;
+                    in.G *= scale;
+                    in.B *= scale;
+                }
+
+                CpuColor out
+                {
+                    in.R * m[0] + in.G * m[4] + in.B * m[8]  + in.A * m[12] + m[16],
+                    in.R * m[1] + in.G * m[5] + in.B * m[9]  + in.A * m[13] + m[17],
+                    in.R * m[2] + in.G * m[6] + in.B * m[10] + in.A * m[14] + m[18],
+                    in.R * m[3] + in.G * m[7] + in.B * m[11] + in.A * m[15] + m[19],
+                };
+
+                if (clampOutput)
+                    out = Clamp01(out);
+
+                if (isPremultiplied)
+                {
+                    out.R *= out.A;
+                    out.G *= out.A;
+                    out.B *= out.A;
+                }
+
+                row[x] = out;
+            }
+        }
+    }
+
+
+    //
+    // Blend, using the separable and non-separable blend mode formulas from the
+    // W3C compositing specification, applied to straight (unpremultiplied) colors.
+    //
+
+    struct Rgb
+    {
+        float R;
+        float G;
+        float B;
+    };
+
+
+    static float Luminance(Rgb const& c)
+    {
+        return 0.3f * c.R + 0.59f * c.G + 0.11f * c.B;
+    }
+
+
+    static float Saturation(Rgb const& c)
+    {
+        return std::max(std::max(c.R, c.G), c.B) - std::min(std::min(c.R, c.G), c.B);
+    }
+
+
+    static Rgb ClipColor(Rgb c)
+    {
+        float l = Luminance(c);
+        float n = std::min(std::min(c.R, c.G), c.B);
+        float x = std::max(std::max(c.R, c.G), c.B);
+
+        if (n < 0)
+        {
+            c.R = l + (c.R - l) * l / (l - n);
+            c.G = l + (c.G - l) * l / (l - n);
+            c.B = l + (c.B - l) * l / (l - n);
+        }
+
+        if (x > 1)
+        {
+            c.R = l + (c.R - l) * (1 - l) / (x - l);
+            c.G = l + (c.G - l) * (1 - l) / (x - l);
+            c.B = l + (c.B - l) * (1 - l) / (x - l);
+        }
+
+        return c;
+    }
+
+
+    static Rgb SetLuminance(Rgb const& c, float l)
+    {
+        float d = l - Luminance(c);
+
+        return ClipColor(Rgb{ c.R + d, c.G + d, c.B + d });
+    }
+
+
+    static Rgb SetSaturation(Rgb c, float s)
+    {
+        float* channels[3] = { &c.R, &c.G, &c.B };
+
+        std::sort(std::begin(channels), std::end(channels), [](float* a, float* b) { return *a < *b; });
+
+        float& cMin = *channels[0];
+        float& cMid = *channels[1];
+        float& cMax = *channels[2];
+
+        if (cMax > cMin)
+        {
+            cMid = (cMid - cMin) * s / (cMax - cMin);
+            cMax = s;
+        }
+        else
+        {
+            cMid = 0;
+            cMax = 0;
+        }
+
+        cMin = 0;
+
+        return c;
+    }
+
+
+    static float ColorBurn(float b, float s)
+    {
+        if (b >= 1)
+            return 1;
+
+        if (s <= 0)
+            return 0;
+
+        return 1 - std::min(1.0f, (1 - b) / s);
+    }
+
+
+    static float ColorDodge(float b, float s)
+    {
+        if (b <= 0)
+            return 0;
+
+        if (s >= 1)
+            return 1;
+
+        return std::min(1.0f, b / (1 - s));
+    }
+
+
+    static float Screen(float b, float s)
+    {
+        return b + s - b * s;
+    }
+
+
+    static float HardLight(float b, float s)
+    {
+        return (s <= 0.5f) ? b * 2 * s : Screen(b, 2 * s - 1);
+    }
+
+
+    static float BlendChannel(BlendMode mode, float b, float s)
+    {
+        switch (mode)
+        {
+        case BlendMode::Multiply:       return b * s;
+        case BlendMode::Screen:         return Screen(b, s);
+        case BlendMode::Darken:         return std::min(b, s);
+        case BlendMode::Lighten:        return std::max(b, s);
+        case BlendMode::ColorBurn:      return ColorBurn(b, s);
+        case BlendMode::LinearBurn:     return std::max(b + s - 1, 0.0f);
+        case BlendMode::ColorDodge:     return ColorDodge(b, s);
+        case BlendMode::LinearDodge:    return std::min(b + s, 1.0f);
+        case BlendMode::Overlay:        return HardLight(s, b);
+        case BlendMode::HardLight:      return HardLight(b, s);
+        case BlendMode::LinearLight:    return Clamp01(b + 2 * s - 1);
+        case BlendMode::HardMix:        return (b + s >= 1) ? 1.0f : 0.0f;
+        case BlendMode::Difference:     return std::abs(b - s);
+        case BlendMode::Exclusion:      return b + s - 2 * b * s;
+        case BlendMode::Subtract:       return std::max(b - s, 0.0f);
+
+        case BlendMode::SoftLight:
+            if (s <= 0.5f)
+            {
+                return b - (1 - 2 * s) * b * (1 - b);
+            }
+            else
+            {
+                float d = (b <= 0.25f) ? ((16 * b - 12) * b + 4) * b : std::sqrt(b);
+                return b + (2 * s - 1) * (d - b);
+            }
+
+        case BlendMode::VividLight:
+            return (s <= 0.5f) ? ColorBurn(b, 2 * s) : ColorDodge(b, 2 * s - 1);
+
+        case BlendMode::PinLight:
+            return (s <= 0.5f) ? std::min(b, 2 * s) : std::max(b, 2 * s - 1);
+
+        case BlendMode::Division:
+            if (s <= 0)
+                return (b > 0) ? 1.0f : 0.0f;
+            return std::min(b / s, 1.0f);
+
+        default:
+            assert(false);
+            return b;
+        }
+    }
+
+
+    static Rgb BlendColor(BlendMode mode, Rgb const& b, Rgb const& s)
+    {
+        switch (mode)
+        {
+        case BlendMode::DarkerColor:    return (Luminance(s) < Luminance(b)) ? s : b;
+        case BlendMode::LighterColor:   return (Luminance(s) > Luminance(b)) ? s : b;
+        case BlendMode::Hue:            return SetLuminance(SetSaturation(s, Saturation(b)), Luminance(b));
+        case BlendMode::Saturation:     return SetLuminance(SetSaturation(b, Saturation(s)), Luminance(b));
+        case BlendMode::Color:          return SetLuminance(s, Luminance(b));
+        case BlendMode::Luminosity:     return SetLuminance(b, Luminance(s));
+
+        default:
+            return Rgb
+            {
+                BlendChannel(mode, b.R, s.R),
+                BlendChannel(mode, b.G, s.G),
+                BlendChannel(mode, b.B, s.B),
+            };
+        }
+    }
+
+
+    bool IsBlendModeSupported(BlendMode mode)
+    {
+        // Dissolve is defined in terms of a random noise pattern, so has no deterministic reference output.
+        return mode != BlendMode::Dissolve &&
+               static_cast<uint32_t>(mode) <= static_cast<uint32_t>(BlendMode::Division);
+    }
+
+
+    CpuImage Blend(CpuImage const& background, CpuImage const& foreground, BlendMode mode, CpuRect const& outputRect)
+    {
+        assert(IsBlendModeSupported(mode));
+
+        CpuImage output(outputRect);
+
+        for (int y = outputRect.Top; y < outputRect.Bottom; y++)
+        {
+            auto row = output.GetRow(y);
+
+            for (int x = outputRect.Left; x < outputRect.Right; x++)
+            {
+                auto b = background.GetPixel(x, y);
+                auto s = foreground.GetPixel(x, y);
+
+                CpuColor result;
+
+                if (s.A <= 0)
+                {
+                    result = b;
+                }
+                else if (b.A <= 0)
+                {
+                    result = s;
+                }
+                else
+                {
+                    Rgb cb{ b.R / b.A, b.G / b.A, b.B / b.A };
+                    Rgb cs{ s.R / s.A, s.G / s.A, s.B / s.A };
+
+                    auto mixed = BlendColor(mode, cb, cs);
+
+                    float both = s.A * b.A;
+
+                    result = CpuColor
+                    {
+                        s.R * (1 - b.A) + b.R * (1 - s.A) + both * mixed.R,
+                        s.G * (1 - b.A) + b.G * (1 - s.A) + both * mixed.G,
+                        s.B * (1 - b.A) + b.B * (1 - s.A) + both * mixed.B,
+                        s.A + b.A - both,
+                    };
+                }
+
+                row[x - outputRect.Left] = result;
+            }
+        }
+
+        return output;
+    }
+
+
+    //
+    // Composite
+    //
+
+    bool IsCompositeModeSupported(CompositeMode mode)
+    {
+        return static_cast<uint32_t>(mode) <= static_cast<uint32_t>(CompositeMode::MaskInvert);
+    }
+
+
+    // Porter-Duff weights for the source and destination.
+    static void GetCompositeFactors(CompositeMode mode, float sourceAlpha, float destAlpha, float* sourceFactor, float* destFactor)
+    {
+        switch (mode)
+        {
+        case CompositeMode::SourceOver:         *sourceFactor = 1;              *destFactor = 1 - sourceAlpha;  break;
+        case CompositeMode::DestinationOver:    *sourceFactor = 1 - destAlpha;  *destFactor = 1;                break;
+        case CompositeMode::SourceIn:           *sourceFactor = destAlpha;      *destFactor = 0;                break;
+        case CompositeMode::DestinationIn:      *sourceFactor = 0;              *destFactor = sourceAlpha;      break;
+        case CompositeMode::SourceOut:          *sourceFactor = 1 - destAlpha;  *destFactor = 0;                break;
+        case CompositeMode::DestinationOut:     *sourceFactor = 0;              *destFactor = 1 - sourceAlpha;  break;
+        case CompositeMode::SourceAtop:         *sourceFactor = destAlpha;      *destFactor = 1 - sourceAlpha;  break;
+        case CompositeMode::DestinationAtop:    *sourceFactor = 1 - destAlpha;  *destFactor = sourceAlpha;      break;
+        case CompositeMode::Xor:                *sourceFactor = 1 - destAlpha;  *destFactor = 1 - sourceAlpha;  break;
+        case CompositeMode::Plus:               *sourceFactor = 1;              *destFactor = 1;                break;
+        case CompositeMode::SourceCopy:         *sourceFactor = 1;              *destFactor = 0;                break;
+
+        default:
+            assert(false);
+            *sourceFactor = 1;
+            *destFactor = 0;
+            break;
+        }
+    }
+
+
+    void Composite(CpuImage& destination, CpuImage const& source, CpuRect const& sourceBounds, CompositeMode mode)
+    {
+        assert(IsCompositeModeSupported(mode));
+
+        auto& bounds = destination.GetBounds();
+
+        for (int y = bounds.Top; y < bounds.Bottom; y++)
+        {
+            auto row = destination.GetRow(y);
+
+            for (int x = bounds.Left; x < bounds.Right; x++)
+            {
+                auto s = source.GetPixel(x, y);
+                auto& d = row[x - bounds.Left];
+
+                switch (mode)
+                {
+                case CompositeMode::BoundedSourceCopy:
+                    // Like SourceCopy, but leaves the destination alone outside the source bounds.
+                    if (sourceBounds.Contains(x, y))
+                        d = s;
+                    break;
+
+                case CompositeMode::MaskInvert:
+                    // Inverts the destination where the source is opaque.
+                    d = CpuColor
+                    {
+                        (1 - d.R) * s.A + d.R * (1 - s.A),
+                        (1 - d.G) * s.A + d.G * (1 - s.A),
+                        (1 - d.B) * s.A + d.B * (1 - s.A),
+                        s.A + d.A - s.A * d.A,
+                    };
+                    break;
+
+                default:
+                    {
+                        float sourceFactor, destFactor;
+                        GetCompositeFactors(mode, s.A, d.A, &sourceFactor, &destFactor);
+
+                        d = CpuColor
+                        {
+                            s.R * sourceFactor + d.R * destFactor,
+                            s.G * sourceFactor + d.G * destFactor,
+                            s.B * sourceFactor + d.B * destFactor,
+                            s.A * sourceFactor + d.A * destFactor,
+                        };
+
+                        if (mode == CompositeMode::Plus)
+                            d = Clamp01(d);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+
+    //
+    // ArithmeticComposite
+    //
+
+    CpuImage ArithmeticComposite(CpuImage const& source1, CpuImage const& source2, float const (&c)[4], bool clampOutput, CpuRect const& outputRect)
+    {
+        CpuImage output(outputRect);
+
+        for (int y = outputRect.Top; y < outputRect.Bottom; y++)
+        {
+            auto row = output.GetRow(y);
+
+            for (int x = outputRect.Left; x < outputRect.Right; x++)
+            {
+                auto a = source1.GetPixel(x, y);
+                auto b = source2.GetPixel(x, y);
+
+                CpuColor result
+                {
+                    c[0] * a.R * b.R + c[1] * a.R + c[2] * b.R + c[3],
+                    c[0] * a.G * b.G + c[1] * a.G + c[2] * b.G + c[3],
+                    c[0] * a.B * b.B + c[1] * a.B + c[2] * b.B + c[3],
+                    c[0] * a.A * b.A + c[1] * a.A + c[2] * b.A + c[3],
+                };
+
+                row[x - outputRect.Left] = clampOutput ? Clamp01(result) : result;
+            }
+        }
+
+        return output;
+    }
+
+
+    //
+    // Crop
+    //
+
+    CpuRect GetCropBounds(CpuRect const& inputBounds, float const (&rect)[4])
+    {
+        CpuRect cropBounds{ FloorToInt(rect[0]), FloorToInt(rect[1]), CeilToInt(rect[2]), CeilToInt(rect[3]) };
+
+        return Intersect(inputBounds, cropBounds);
+    }
+
+
+    // How much of the pixel spanning [position, position + 1) lies within [low, high).
+    static float GetCoverage(int position, float low, float high, BorderMode borderMode)
+    {
+        if (borderMode == BorderMode::Hard)
+        {
+            float center = position + 0.5f;
+            return (center >= low && center < high) ? 1.0f : 0.0f;
+        }
+
+        return Clamp01(std::min(position + 1.0f, high) - std::max(static_cast<float>(position), low));
+    }
+
+
+    void Crop(CpuImage& image, float const (&rect)[4], BorderMode borderMode)
+    {
+        auto& bounds = image.GetBounds();
+
+        std::vector<float> columnCoverage(bounds.Width());
+
+        for (int x = bounds.Left; x < bounds.Right; x++)
+        {
+            columnCoverage[x - bounds.Left] = GetCoverage(x, rect[0], rect[2], borderMode);
+        }
+
+        for (int y = bounds.Top; y < bounds.Bottom; y++)
+        {
+            auto row = image.GetRow(y);
+            float rowCoverage = GetCoverage(y, rect[1], rect[3], borderMode);
+
+            for (int x = 0; x < bounds.Width(); x++)
+            {
+                float coverage = rowCoverage * columnCoverage[x];
+
+                row[x].R *= coverage;
+                row[x].G *= coverage;
+                row[x].B *= coverage;
+                row[x].A *= coverage;
+            }
+        }
+    }
+
+
+    //
+    // Transform
+    //
+
+    static bool InvertMatrix(float const (&m)[6], float (&result)[6])
+    {
+        float determinant = m[0] * m[3] - m[1] * m[2];
+
+        if (determinant == 0 || !std::isfinite(determinant))
+            return false;
+
+        result[0] =  m[3] / determinant;
+        result[1] = -m[1] / determinant;
+        result[2] = -m[2] / determinant;
+        result[3] =  m[0] / determinant;
+        result[4] = (m[2] * m[5] - m[3] * m[4]) / determinant;
+        result[5] = (m[1] * m[4] - m[0] * m[5]) / determinant;
+
+        return true;
+    }
+
+
+    static CpuRect TransformRect(CpuRect const& rect, float const (&m)[6])
+    {
+        if (rect.IsEmpty())
+            return CpuRect::Empty();
+
+        if (rect.IsInfinite())
+            return CpuRect::Infinite();
+
+        float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+
+        for (int corner = 0; corner < 4; corner++)
+        {
+            float x = static_cast<float>((corner & 1) ? rect.Right : rect.Left);
+            float y = static_cast<float>((corner & 2) ? rect.Bottom : rect.Top);
+
+            float tx = x * m[0] + y * m[2] + m[4];
+            float ty = x * m[1] + y * m[3] + m[5];
+
+            minX = std::min(minX, tx);
+            minY = std::min(minY, ty);
+            maxX = std::max(maxX, tx);
+            maxY = std::max(maxY, ty);
+        }
+
+        CpuRect result{ FloorToInt(minX), FloorToInt(minY), CeilToInt(maxX), CeilToInt(maxY) };
+
+        return result.IsEmpty() ? CpuRect::Empty() : result;
+    }
+
+
+    CpuRect GetTransformBounds(CpuRect const& inputBounds, float const (&matrix)[6])
+    {
+        float inverse[6];
+
+        if (!InvertMatrix(matrix, inverse))
+            return CpuRect::Empty();
+
+        return TransformRect(inputBounds, matrix);
+    }
+
+
+    CpuRect GetTransformSourceRect(CpuRect const& outputRect, CpuRect const& inputBounds, float const (&matrix)[6])
+    {
+        float inverse[6];
+
+        if (!InvertMatrix(matrix, inverse))
+            return CpuRect::Empty();
+
+        // Linear filtering reads one pixel beyond the mapped area.
+        return Intersect(TransformRect(outputRect, inverse).Inflate(1, 1), inputBounds);
+    }
+
+
+    CpuImage Transform(CpuImage const& input, CpuRect const& inputBounds, float const (&matrix)[6], InterpolationMode interpolationMode, BorderMode borderMode, CpuRect const& outputRect)
+    {
+        CpuImage output(outputRect);
+
+        float inverse[6];
+
+        if (!InvertMatrix(matrix, inverse))
+            return output;
+
+        auto drawRect = Intersect(outputRect, TransformRect(inputBounds, matrix));
+
+        // Soft borders fade to transparent past the edge of the input, while hard borders clamp.
+        auto sampleRect = (borderMode == BorderMode::Hard) ? inputBounds : CpuRect::Infinite();
+
+        auto sample = [&](int x, int y)
+        {
+            return input.GetPixel(ClampCoordinate(x, sampleRect.Left, sampleRect.Right),
+                                  ClampCoordinate(y, sampleRect.Top, sampleRect.Bottom));
+        };
+
+        for (int y = drawRect.Top; y < drawRect.Bottom; y++)
+        {
+            auto row = output.GetRow(y);
+
+            for (int x = drawRect.Left; x < drawRect.Right; x++)
+            {
+                // Map the center of the output pixel back into the input.
+                float px = x + 0.5f;
+                float py = y + 0.5f;
+
+                float sx = px * inverse[0] + py * inverse[2] + inverse[4];
+                float sy = px * inverse[1] + py * inverse[3] + inverse[5];
+
+                CpuColor result;
+
+                if (interpolationMode == InterpolationMode::NearestNeighbor)
+                {
+                    result = sample(FloorToInt(sx), FloorToInt(sy));
+                }
+                else
+                {
+                    float fx = sx - 0.5f;
+                    float fy = sy - 0.5f;
+
+                    int x0 = FloorToInt(fx);
+                    int y0 = FloorToInt(fy);
+
+                    float tx = fx - x0;
+                    float ty = fy - y0;
+
+                    auto c00 = sample(x0, y0);
+                    auto c10 = sample(x0 + 1, y0);
+                    auto c01 = sample(x0, y0 + 1);
+                    auto c11 = sample(x0 + 1, y0 + 1);
+
+                    float w00 = (1 - tx) * (1 - ty);
+                    float w10 = tx * (1 - ty);
+                    float w01 = (1 - tx) * ty;
+                    float w11 = tx * ty;
+
+                    result = CpuColor
+                    {
+                        c00.R * w00 + c10.R * w10 + c01.R * w01 + c11.R * w11,
+                        c00.G * w00 + c10.G * w10 + c01.G * w01 + c11.G * w11,
+                        c00.B * w00 + c10.B * w10 + c01.B * w01 + c11.B * w11,
+                        c00.A * w00 + c10.A * w10 + c01.A * w01 + c11.A * w11,
+                    };
+                }
+
+                row[x - outputRect.Left] = result;
+            }
+        }
+
+        return output;
+    }
+
+
+    //
+    // Border
+    //
+
+    static int MapEdge(int value, int low, int high, EdgeMode edgeMode)
+    {
+        int size = high - low;
+
+        switch (edgeMode)
+        {
+        case EdgeMode::Wrap:
+            {
+                int offset = (value - low) % size;
+                return low + ((offset < 0) ? offset + size : offset);
+            }
+
+        case EdgeMode::Mirror:
+            {
+                int period = size * 2;
+                int offset = (value - low) % period;
+
+                if (offset < 0)
+                    offset += period;
+
+                return low + ((offset < size) ? offset : period - 1 - offset);
+            }
+
+        default:
+            return ClampCoordinate(value, low, high);
+        }
+    }
+
+
+    // Returns the spans of [low, high) that MapEdge reads for positions in [outputLow, outputHigh), in increasing order.
+    static std::vector<std::pair<int, int>> GetBorderSourceSpans(int outputLow, int outputHigh, int low, int high, EdgeMode edgeMode)
+    {
+        std::vector<std::pair<int, int>> spans;
+
+        if (outputHigh <= outputLow)
+            return spans;
+
+        if (edgeMode != EdgeMode::Wrap && edgeMode != EdgeMode::Mirror)
+        {
+            // Clamping is monotonic, so the ends of the output map to the ends of a single span.
+            spans.emplace_back(ClampCoordinate(outputLow, low, high), ClampCoordinate(outputHigh - 1, low, high) + 1);
+            return spans;
+        }
+
+        // Once the output covers a whole period, every source position is read.
+        int64_t period = static_cast<int64_t>(high - low) * ((edgeMode == EdgeMode::Mirror) ? 2 : 1);
+
+        if (outputHigh - outputLow >= period)
+        {
+            spans.emplace_back(low, high);
+            return spans;
+        }
+
+        std::vector<int> positions;
+        positions.reserve(outputHigh - outputLow);
+
+        for (int i = outputLow; i < outputHigh; i++)
+        {
+            positions.push_back(MapEdge(i, low, high, edgeMode));
+        }
+
+        std::sort(positions.begin(), positions.end());
+
+        for (auto position : positions)
+        {
+            if (spans.empty() || position > spans.back().second)
+                spans.emplace_back(position, position + 1);
+            else
+                spans.back().second = std::max(spans.back().second, position + 1);
+        }
+
+        return spans;
+    }
+
+
+    std::vector<CpuRect> GetBorderSourceRects(CpuRect const& outputRect, CpuRect const& inputBounds, EdgeMode edgeModeX, EdgeMode edgeModeY)
+    {
+        std::vector<CpuRect> rects;
+
+        if (outputRect.IsEmpty() || inputBounds.IsEmpty())
+            return rects;
+
+        // An infinite input has no edges to extend.
+        if (inputBounds.IsInfinite())
+        {
+            rects.push_back(outputRect);
+            return rects;
+        }
+
+        auto columns = GetBorderSourceSpans(outputRect.Left, outputRect.Right, inputBounds.Left, inputBounds.Right, edgeModeX);
+        auto rows = GetBorderSourceSpans(outputRect.Top, outputRect.Bottom, inputBounds.Top, inputBounds.Bottom, edgeModeY);
+
+        for (auto& row : rows)
+        {
+            for (auto& column : columns)
+            {
+                rects.push_back(CpuRect{ column.first, row.first, column.second, row.second });
+            }
+        }
+
+        return rects;
+    }
+
+
+    CpuImage Border(CpuImage const& input, CpuRect const& inputBounds, EdgeMode edgeModeX, EdgeMode edgeModeY, CpuRect const& outputRect)
+    {
+        CpuImage output(outputRect);
+
+        Border(output, input, inputBounds, edgeModeX, edgeModeY);
+
+        return output;
+    }
+
+
+    void Border(CpuImage& output, CpuImage const& input, CpuRect const& inputBounds, EdgeMode edgeModeX, EdgeMode edgeModeY)
+    {
+        auto& outputRect = output.GetBounds();
+        auto& inputRect = input.GetBounds();
+
+        if (inputBounds.IsEmpty() || inputRect.IsEmpty())
+            return;
+
+        // An infinite input has no edges to extend.
+        bool passThrough = inputBounds.IsInfinite();
+
+        for (int y = outputRect.Top; y < outputRect.Bottom; y++)
+        {
+            int sy = passThrough ? y : MapEdge(y, inputBounds.Top, inputBounds.Bottom, edgeModeY);
+
+            if (sy < inputRect.Top || sy >= inputRect.Bottom)
+                continue;
+
+            auto row = output.GetRow(y);
+            auto inputRow = input.GetRow(sy);
+
+            for (int x = outputRect.Left; x < outputRect.Right; x++)
+            {
+                int sx = passThrough ? x : MapEdge(x, inputBounds.Left, inputBounds.Right, edgeModeX);
+
+                if (sx >= inputRect.Left && sx < inputRect.Right)
+                    row[x - outputRect.Left] = inputRow[sx - inputRect.Left];
+            }
+        }
+    }
+
+
+    //
+    // Opacity
+    //
+
+    void Opacity(CpuImage& image, float opacity)
+    {
+        auto& bounds = image.GetBounds();
+
+        for (int y = bounds.Top; y < bounds.Bottom; y++)
+        {
+            ScaleRow(image.GetRow(y), bounds.Width(), opacity);
+        }
+    }
+
+
+    //
+    // Format conversion
+    //
+
+    CpuImage FromBgra8(uint8_t const* data, int width, int height, int stride, bool isPremultiplied)
+    {
+        CpuImage image(CpuRect{ 0, 0, width, height });
+
+        for (int y = 0; y < height; y++)
+        {
+            auto source = data + static_cast<size_t>(y) * stride;
+            auto row = image.GetRow(y);
+
+            for (int x = 0; x < width; x++)
+            {
+                float a = source[x * 4 + 3] / 255.0f;
+                float scale = isPremultiplied ? (1 / 255.0f) : (a / 255.0f);
+
+                row[x] = CpuColor
+                {
+                    source[x * 4 + 2] * scale,
+                    source[x * 4 + 1] * scale,
+                    source[x * 4 + 0] * scale,
+                    a,
+                };
+            }
+        }
+
+        return image;
+    }
+
+
+    static uint8_t ToUnorm8(float value)
+    {
+        return static_cast<uint8_t>(Clamp01(value) * 255.0f + 0.5f);
+    }
+
+
+    std::vector<uint8_t> ToBgra8(CpuImage const& image)
+    {
+        auto& bounds = image.GetBounds();
+
+        std::vector<uint8_t> result(static_cast<size_t>(bounds.Width()) * bounds.Height() * 4);
+
+        auto dest = result.data();
+
+        for (int y = bounds.Top; y < bounds.Bottom; y++)
+        {
+            auto row = image.GetRow(y);
+
+            for (int x = 0; x < bounds.Width(); x++)
+            {
+                *dest++ = ToUnorm8(row[x].B);
+                *dest++ = ToUnorm8(row[x].G);
+                *dest++ = ToUnorm8(row[x].R);
+                *dest++ = ToUnorm8(row[x].A);
+            }
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,141 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "CpuImage.h"
+
+//
+// Software implementations of a core subset of the D2D built-in effects.
+//
+// These are reference implementations: they aim to be deterministic and to
+// match the documented D2D formulas, rather than to reproduce GPU output bit
+// for bit. Inner loops are written as multiply-adds over contiguous float
+// arrays so that compilers can auto-vectorize them without needing any
+// platform specific intrinsics.
+//
+// Enum values match their D2D equivalents, so CpuEffectRenderer can pass
+// boxed effect properties straight through.
+//
+namespace CpuEffectKernels
+{
+    enum class BorderMode : uint32_t
+    {
+        Soft = 0,
+        Hard = 1,
+    };
+
+    enum class EdgeMode : uint32_t
+    {
+        Clamp = 0,
+        Wrap = 1,
+        Mirror = 2,
+    };
+
+    enum class ColorMatrixAlphaMode : uint32_t
+    {
+        Premultiplied = 1,
+        Straight = 2,
+    };
+
+    enum class BlendMode : uint32_t
+    {
+        Multiply = 0,
+        Screen = 1,
+        Darken = 2,
+        Lighten = 3,
+        Dissolve = 4,
+        ColorBurn = 5,
+        LinearBurn = 6,
+        DarkerColor = 7,
+        LighterColor = 8,
+        ColorDodge = 9,
+        LinearDodge = 10,
+        Overlay = 11,
+        SoftLight = 12,
+        HardLight = 13,
+        VividLight = 14,
+        LinearLight = 15,
+        PinLight = 16,
+        HardMix = 17,
+        Difference = 18,
+        Exclusion = 19,
+        Hue = 20,
+        Saturation = 21,
+        Color = 22,
+        Luminosity = 23,
+        Subtract = 24,
+        Division = 25,
+    };
+
+    enum class CompositeMode : uint32_t
+    {
+        SourceOver = 0,
+        DestinationOver = 1,
+        SourceIn = 2,
+        DestinationIn = 3,
+        SourceOut = 4,
+        DestinationOut = 5,
+        SourceAtop = 6,
+        DestinationAtop = 7,
+        Xor = 8,
+        Plus = 9,
+        SourceCopy = 10,
+        BoundedSourceCopy = 11,
+        MaskInvert = 12,
+    };
+
+    enum class InterpolationMode : uint32_t
+    {
+        NearestNeighbor = 0,
+        Linear = 1,
+    };
+
+
+    // GaussianBlur. The input must cover GetGaussianBlurSourceRect(outputRect).
+    int GetGaussianBlurRadius(float standardDeviation);
+    CpuRect GetGaussianBlurBounds(CpuRect const& inputBounds, float standardDeviation, BorderMode borderMode);
+    CpuRect GetGaussianBlurSourceRect(CpuRect const& outputRect, CpuRect const& inputBounds, float standardDeviation, BorderMode borderMode);
+    CpuImage GaussianBlur(CpuImage const& input, CpuRect const& inputBounds, float standardDeviation, BorderMode borderMode, CpuRect const& outputRect);
+
+    // ColorMatrix. The matrix is a row major Matrix5x4, applied as [r g b a 1] * matrix.
+    void ColorMatrix(CpuImage& image, float const (&matrix)[20], ColorMatrixAlphaMode alphaMode, bool clampOutput);
+
+    // Blend. Both inputs must cover outputRect.
+    bool IsBlendModeSupported(BlendMode mode);
+    CpuImage Blend(CpuImage const& background, CpuImage const& foreground, BlendMode mode, CpuRect const& outputRect);
+
+    // Composite draws source over destination in place. The source must cover
+    // the destination bounds; sourceBounds is only used by BoundedSourceCopy.
+    bool IsCompositeModeSupported(CompositeMode mode);
+    void Composite(CpuImage& destination, CpuImage const& source, CpuRect const& sourceBounds, CompositeMode mode);
+
+    // ArithmeticComposite: coefficients[0] * source1 * source2 + coefficients[1] * source1 + coefficients[2] * source2 + coefficients[3].
+    CpuImage ArithmeticComposite(CpuImage const& source1, CpuImage const& source2, float const (&coefficients)[4], bool clampOutput, CpuRect const& outputRect);
+
+    // Crop, with a rectangle in left/top/right/bottom form that may be infinite or fractional.
+    CpuRect GetCropBounds(CpuRect const& inputBounds, float const (&rect)[4]);
+    void Crop(CpuImage& image, float const (&rect)[4], BorderMode borderMode);
+
+    // Transform2D, with a Matrix3x2 in D2D row vector form. The input must cover GetTransformSourceRect(outputRect).
+    CpuRect GetTransformBounds(CpuRect const& inputBounds, float const (&matrix)[6]);
+    CpuRect GetTransformSourceRect(CpuRect const& outputRect, CpuRect const& inputBounds, float const (&matrix)[6]);
+    CpuImage Transform(CpuImage const& input, CpuRect const& inputBounds, float const (&matrix)[6], InterpolationMode interpolationMode, BorderMode borderMode, CpuRect const& outputRect);
+
+    // Border extends a finite input to infinity. The input must cover each of GetBorderSourceRects(outputRect),
+    // which for a region near an edge are the part of the input it overlaps plus the strips it wraps or mirrors.
+    std::vector<CpuRect> GetBorderSourceRects(CpuRect const& outputRect, CpuRect const& inputBounds, EdgeMode edgeModeX, EdgeMode edgeModeY);
+    CpuImage Border(CpuImage const& input, CpuRect const& inputBounds, EdgeMode edgeModeX, EdgeMode edgeModeY, CpuRect const& outputRect);
+
+    // Fills just the pixels of output that read from within the bounds of input, so the
+    // output can be assembled from one GetBorderSourceRects region at a time.
+    void Border(CpuImage& output, CpuImage const& input, CpuRect const& inputBounds, EdgeMode edgeModeX, EdgeMode edgeModeY);
+
+    // Opacity.
+    void Opacity(CpuImage& image, float opacity);
+
+    // Conversion to and from 8 bit per channel BGRA, as used by DXGI_FORMAT_B8G8R8A8_UNORM.
+    CpuImage FromBgra8(uint8_t const* data, int width, int height, int stride, bool isPremultiplied);
+    std::vector<uint8_t> ToBgra8(CpuImage const& image);
+}
@@ -0,0 +1,655 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "CpuEffectRenderer.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    using namespace CpuEffectKernels;
+
+    static_assert(static_cast<uint32_t>(BorderMode::Hard) == D2D1_BORDER_MODE_HARD, "Enum values should match");
+    static_assert(static_cast<uint32_t>(EdgeMode::Mirror) == D2D1_BORDER_EDGE_MODE_MIRROR, "Enum values should match");
+    static_assert(static_cast<uint32_t>(ColorMatrixAlphaMode::Straight) == D2D1_COLORMATRIX_ALPHA_MODE_STRAIGHT, "Enum values should match");
+    static_assert(static_cast<uint32_t>(BlendMode::Hue) == D2D1_BLEND_MODE_HUE, "Enum values should match");
+    static_assert(static_cast<uint32_t>(CompositeMode::MaskInvert) == D2D1_COMPOSITE_MODE_MASK_INVERT, "Enum values should match");
+    static_assert(static_cast<uint32_t>(InterpolationMode::Linear) == D2D1_2DAFFINETRANSFORM_INTERPOLATION_MODE_LINEAR, "Enum values should match");
+
+
+    //
+    // Helpers for reading D2D formatted property values.
+    //
+
+    static IPropertyValue* GetPropertyValue(std::vector<ComPtr<IPropertyValue>> const& properties, unsigned int index)
+    {
+        if (index >= properties.size())
+            ThrowHR(E_BOUNDS);
+
+        if (!properties[index])
+            ThrowHR(E_INVALIDARG);
+
+        return properties[index].Get();
+    }
+
+
+    static float GetFloat(std::vector<ComPtr<IPropertyValue>> const& properties, unsigned int index)
+    {
+        float value;
+        ThrowIfFailed(GetPropertyValue(properties, index)->GetSingle(&value));
+        return value;
+    }
+
+
+    static uint32_t GetUInt32(std::vector<ComPtr<IPropertyValue>> const& properties, unsigned int index)
+    {
+        uint32_t value;
+        ThrowIfFailed(GetPropertyValue(properties, index)->GetUInt32(&value));
+        return value;
+    }
+
+
+    static bool GetBoolean(std::vector<ComPtr<IPropertyValue>> const& properties, unsigned int index)
+    {
+        boolean value;
+        ThrowIfFailed(GetPropertyValue(properties, index)->GetBoolean(&value));
+        return !!value;
+    }
+
+
+    template<int N>
+    static void GetFloatArray(std::vector<ComPtr<IPropertyValue>> const& properties, unsigned int index, float (&result)[N])
+    {
+        ComArray<float> value;
+        ThrowIfFailed(GetPropertyValue(properties, index)->GetSingleArray(value.GetAddressOfSize(), value.GetAddressOfData()));
+
+        if (value.GetSize() != N)
+            ThrowHR(E_BOUNDS);
+
+        memcpy(result, value.GetData(), sizeof(result));
+    }
+
+
+    static std::vector<ComPtr<IPropertyValue>> ReadProperties(IGraphicsEffectD2D1Interop* effect)
+    {
+        UINT count;
+        ThrowIfFailed(effect->GetPropertyCount(&count));
+
+        std::vector<ComPtr<IPropertyValue>> properties(count);
+
+        for (UINT i = 0; i < count; i++)
+        {
+            ThrowIfFailed(effect->GetProperty(i, &properties[i]));
+        }
+
+        return properties;
+    }
+
+
+    static bool IsEffectSupported(IID const& effectId, std::vector<ComPtr<IPropertyValue>> const& properties)
+    {
+        if (IsEqualGUID(effectId, CLSID_D2D1Blend))
+            return IsBlendModeSupported(static_cast<BlendMode>(GetUInt32(properties, D2D1_BLEND_PROP_MODE)));
+
+        if (IsEqualGUID(effectId, CLSID_D2D1Composite))
+            return IsCompositeModeSupported(static_cast<CompositeMode>(GetUInt32(properties, D2D1_COMPOSITE_PROP_MODE)));
+
+        return IsEqualGUID(effectId, CLSID_D2D1GaussianBlur) ||
+               IsEqualGUID(effectId, CLSID_D2D1ColorMatrix) ||
+               IsEqualGUID(effectId, CLSID_D2D1ArithmeticComposite) ||
+               IsEqualGUID(effectId, CLSID_D2D1Crop) ||
+               IsEqualGUID(effectId, CLSID_D2D12DAffineTransform) ||
+#if WINVER > _WIN32_WINNT_WINBLUE
+               IsEqualGUID(effectId, CLSID_D2D1Opacity) ||
+#endif
+               IsEqualGUID(effectId, CLSID_D2D1Border);
+    }
+
+
+    static bool IsSupportedImpl(IGraphicsEffectSource* source, std::set<IUnknown*>& visiting)
+    {
+        if (!source)
+            return false;
+
+        auto effect = MaybeAs<IGraphicsEffectD2D1Interop>(source);
+
+        if (!effect)
+            return true;
+
+        auto identity = AsUnknown(source);
+
+        if (!visiting.insert(identity.Get()).second)
+            return false;
+
+        GUID effectId;
+        ThrowIfFailed(effect->GetEffectId(&effectId));
+
+        if (!IsEffectSupported(effectId, ReadProperties(effect.Get())))
+            return false;
+
+        UINT sourceCount;
+        ThrowIfFailed(effect->GetSourceCount(&sourceCount));
+
+        for (UINT i = 0; i < sourceCount; i++)
+        {
+            ComPtr<IGraphicsEffectSource> input;
+            ThrowIfFailed(effect->GetSource(i, &input));
+
+            if (!IsSupportedImpl(input.Get(), visiting))
+                return false;
+        }
+
+        visiting.erase(identity.Get());
+
+        return true;
+    }
+
+
+    //
+    // CpuEffectRenderer implementation
+    //
+
+    CpuEffectRenderer::SourceReader CpuEffectRenderer::SourceReader::FromImage(CpuImage image)
+    {
+        auto sharedImage = std::make_shared<CpuImage const>(std::move(image));
+
+        SourceReader reader;
+
+        reader.Bounds = sharedImage->GetBounds();
+
+        reader.Read = [sharedImage](CpuRect const& region)
+        {
+            return sharedImage->Copy(region);
+        };
+
+        return reader;
+    }
+
+
+    CpuEffectRenderer::CpuEffectRenderer(SourceResolver sourceResolver)
+        : m_sourceResolver(sourceResolver)
+    {
+    }
+
+
+    bool CpuEffectRenderer::IsSupported(IGraphicsEffectSource* graph)
+    {
+        std::set<IUnknown*> visiting;
+
+        return IsSupportedImpl(graph, visiting);
+    }
+
+
+    CpuRect CpuEffectRenderer::GetBounds(IGraphicsEffectSource* graph)
+    {
+        return BuildGraph(graph)->Bounds;
+    }
+
+
+    CpuImage CpuEffectRenderer::Render(IGraphicsEffectSource* graph, CpuRect const& rect)
+    {
+        if (rect.IsInfinite())
+            ThrowHR(E_INVALIDARG);
+
+        RenderPass pass;
+
+        return RenderNode(*BuildGraph(graph), rect, pass);
+    }
+
+
+    CpuImage CpuEffectRenderer::Render(IGraphicsEffectSource* graph)
+    {
+        auto root = BuildGraph(graph);
+
+        if (root->Bounds.IsInfinite())
+            ThrowHR(E_INVALIDARG, Strings::CpuEffectInfiniteBounds);
+
+        RenderPass pass;
+
+        return RenderNode(*root, root->Bounds, pass);
+    }
+
+
+    void CpuEffectRenderer::RenderTiles(IGraphicsEffectSource* graph, CpuRect const& rect, int tileWidth, int tileHeight, TileSink const& sink)
+    {
+        if (rect.IsInfinite() || tileWidth <= 0 || tileHeight <= 0 || !sink)
+            ThrowHR(E_INVALIDARG);
+
+        auto root = BuildGraph(graph);
+
+        std::vector<CpuRect> tiles;
+
+        for (int y = rect.Top; y < rect.Bottom; y += tileHeight)
+        {
+            for (int x = rect.Left; x < rect.Right; x += tileWidth)
+            {
+                tiles.push_back(CpuRect{ x, y, std::min(x + tileWidth, rect.Right), std::min(y + tileHeight, rect.Bottom) });
+            }
+        }
+
+        // The graph is immutable once built, so tiles can be evaluated
+        // concurrently. We work through them in batches of one tile per core,
+        // which keeps the sink in raster order and bounds peak memory use.
+        size_t batchSize = std::max(std::thread::hardware_concurrency(), 1U);
+
+        for (size_t batchStart = 0; batchStart < tiles.size(); batchStart += batchSize)
+        {
+            auto batchEnd = std::min(batchStart + batchSize, tiles.size());
+
+            std::vector<std::future<CpuImage>> results;
+
+            for (size_t i = batchStart + 1; i < batchEnd; i++)
+            {
+                results.push_back(std::async(std::launch::async,
+                    [&root, &tiles, i]
+                    {
+                        RenderPass pass;
+                        return RenderNode(*root, tiles[i], pass);
+                    }));
+            }
+
+            // The calling thread renders the first tile of each batch itself.
+            RenderPass pass;
+            auto firstTile = RenderNode(*root, tiles[batchStart], pass);
+
+            sink(firstTile);
+
+            for (auto& result : results)
+            {
+                sink(result.get());
+            }
+        }
+    }
+
+
+    std::shared_ptr<CpuEffectRenderer::Node> CpuEffectRenderer::BuildGraph(IGraphicsEffectSource* graph)
+    {
+        CheckInPointer(graph);
+
+        NodeMap nodes;
+        std::set<IUnknown*> visiting;
+
+        return BuildNode(graph, nodes, visiting);
+    }
+
+
+    std::shared_ptr<CpuEffectRenderer::Node> CpuEffectRenderer::BuildNode(IGraphicsEffectSource* source, NodeMap& nodes, std::set<IUnknown*>& visiting)
+    {
+        // Sources that are used more than once in the graph share a single node.
+        auto identity = AsUnknown(source);
+
+        auto it = nodes.find(identity.Get());
+
+        if (it != nodes.end())
+        {
+            it->second->ConsumerCount++;
+            return it->second;
+        }
+
+        auto node = std::make_shared<Node>();
+
+        node->ConsumerCount = 1;
+
+        auto effect = MaybeAs<IGraphicsEffectD2D1Interop>(source);
+
+        if (!effect)
+        {
+            node->EffectId = GUID_NULL;
+            node->Reader = GetSourceReader(source);
+            node->Bounds = node->Reader.Bounds;
+        }
+        else
+        {
+            if (!visiting.insert(identity.Get()).second)
+                ThrowHR(D2DERR_CYCLIC_GRAPH);
+
+            ThrowIfFailed(effect->GetEffectId(&node->EffectId));
+
+            node->Properties = ReadProperties(effect.Get());
+
+            if (!IsEffectSupported(node->EffectId, node->Properties))
+                ThrowHR(E_NOTIMPL, Strings::CpuEffectUnsupportedEffect);
+
+            UINT sourceCount;
+            ThrowIfFailed(effect->GetSourceCount(&sourceCount));
+
+            for (UINT i = 0; i < sourceCount; i++)
+            {
+                ComPtr<IGraphicsEffectSource> input;
+                ThrowIfFailed(effect->GetSource(i, &input));
+
+                if (!input)
+                    ThrowFormattedMessage(E_INVALIDARG, Strings::EffectNullSource, i);
+
+                node->Sources.push_back(BuildNode(input.Get(), nodes, visiting));
+            }
+
+            visiting.erase(identity.Get());
+
+            node->Bounds = GetNodeBounds(*node);
+        }
+
+        nodes.emplace(identity.Get(), node);
+
+        return node;
+    }
+
+
+    CpuEffectRenderer::SourceReader CpuEffectRenderer::GetSourceReader(IGraphicsEffectSource* source)
+    {
+        SourceReader reader;
+
+        if (m_sourceResolver && m_sourceResolver(source, &reader))
+        {
+            if (!reader.Read)
+                ThrowHR(E_UNEXPECTED);
+
+            return reader;
+        }
+
+        auto bitmap = MaybeAs<ICanvasBitmap>(source);
+
+        if (!bitmap)
+            ThrowHR(E_NOTIMPL, Strings::CpuEffectUnsupportedSource);
+
+        DirectXPixelFormat format;
+        ThrowIfFailed(bitmap->get_Format(&format));
+
+        bool hasAlpha = (format == PIXEL_FORMAT(B8G8R8A8UIntNormalized));
+
+        if (!hasAlpha && format != PIXEL_FORMAT(B8G8R8X8UIntNormalized))
+            ThrowHR(E_NOTIMPL, Strings::CpuEffectUnsupportedSource);
+
+        CanvasAlphaMode alphaMode;
+        ThrowIfFailed(bitmap->get_AlphaMode(&alphaMode));
+
+        BitmapSize size;
+        ThrowIfFailed(bitmap->get_SizeInPixels(&size));
+
+        reader.Bounds = CpuRect{ 0, 0, static_cast<int>(size.Width), static_cast<int>(size.Height) };
+
+        // Formats without alpha, or with alpha that should be ignored, are treated as opaque.
+        bool forceOpaque = !hasAlpha || alphaMode == CanvasAlphaMode::Ignore;
+        bool isPremultiplied = alphaMode != CanvasAlphaMode::Straight;
+
+        // Pixels are only read back when needed, one region at a time, so
+        // tiled rendering never holds more than a tile's worth of the bitmap.
+        reader.Read = [bitmap, forceOpaque, isPremultiplied](CpuRect const& region)
+        {
+            ComArray<BYTE> pixels;
+            ThrowIfFailed(bitmap->GetPixelBytesWithSubrectangle(region.Left, region.Top, region.Width(), region.Height(), pixels.GetAddressOfSize(), pixels.GetAddressOfData()));
+
+            auto stride = region.Width() * 4;
+
+            if (pixels.GetSize() < static_cast<uint32_t>(stride * region.Height()))
+                ThrowHR(E_UNEXPECTED);
+
+            if (forceOpaque)
+            {
+                for (uint32_t i = 3; i < pixels.GetSize(); i += 4)
+                {
+                    pixels[i] = 255;
+                }
+            }
+
+            auto image = FromBgra8(pixels.GetData(), region.Width(), region.Height(), stride, isPremultiplied);
+
+            // FromBgra8 places the pixels at the origin, so move them to where they belong.
+            CpuImage result(region);
+
+            for (int y = 0; y < region.Height(); y++)
+            {
+                memcpy(result.GetRow(region.Top + y), image.GetRow(y), region.Width() * sizeof(CpuColor));
+            }
+
+            return result;
+        };
+
+        return reader;
+    }
+
+
+    CpuRect CpuEffectRenderer::GetNodeBounds(Node const& node)
+    {
+        auto& effectId = node.EffectId;
+        auto& properties = node.Properties;
+
+        auto sourceBounds = [&](unsigned int index)
+        {
+            if (index >= node.Sources.size())
+                ThrowHR(E_BOUNDS);
+
+            return node.Sources[index]->Bounds;
+        };
+
+        auto unionOfSources = [&]
+        {
+            auto bounds = CpuRect::Empty();
+
+            for (auto& source : node.Sources)
+            {
+                bounds = Union(bounds, source->Bounds);
+            }
+
+            return bounds;
+        };
+
+        if (IsEqualGUID(effectId, CLSID_D2D1GaussianBlur))
+        {
+            return GetGaussianBlurBounds(sourceBounds(0),
+                                         GetFloat(properties, D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION),
+                                         static_cast<BorderMode>(GetUInt32(properties, D2D1_GAUSSIANBLUR_PROP_BORDER_MODE)));
+        }
+        else if (IsEqualGUID(effectId, CLSID_D2D1ArithmeticComposite))
+        {
+            float coefficients[4];
+            GetFloatArray(properties, D2D1_ARITHMETICCOMPOSITE_PROP_COEFFICIENTS, coefficients);
+
+            // A constant offset makes even transparent areas visible.
+            return (coefficients[3] != 0) ? CpuRect::Infinite() : unionOfSources();
+        }
+        else if (IsEqualGUID(effectId, CLSID_D2D1Blend) ||
+                 IsEqualGUID(effectId, CLSID_D2D1Composite))
+        {
+            return unionOfSources();
+        }
+        else if (IsEqualGUID(effectId, CLSID_D2D1Crop))
+        {
+            float rect[4];
+            GetFloatArray(properties, D2D1_CROP_PROP_RECT, rect);
+
+            return GetCropBounds(sourceBounds(0), rect);
+        }
+        else if (IsEqualGUID(effectId, CLSID_D2D12DAffineTransform))
+        {
+            float matrix[6];
+            GetFloatArray(properties, D2D1_2DAFFINETRANSFORM_PROP_TRANSFORM_MATRIX, matrix);
+
+            return GetTransformBounds(sourceBounds(0), matrix);
+        }
+        else if (IsEqualGUID(effectId, CLSID_D2D1Border))
+        {
+            return sourceBounds(0).IsEmpty() ? CpuRect::Empty() : CpuRect::Infinite();
+        }
+        else
+        {
+            // ColorMatrix and Opacity do not change the bounds of their input.
+            return sourceBounds(0);
+        }
+    }
+
+
+    CpuImage CpuEffectRenderer::RenderNode(Node const& node, CpuRect const& rect, RenderPass& pass)
+    {
+        if (rect.IsEmpty())
+            return CpuImage();
+
+        if (node.ConsumerCount < 2)
+            return EvaluateNode(node, rect, pass);
+
+        // Shared nodes are only evaluated once for each region that is asked of them.
+        auto key = RenderPass::Key(&node, rect.Left, rect.Top, rect.Right, rect.Bottom);
+
+        auto it = pass.SharedResults.find(key);
+
+        if (it == pass.SharedResults.end())
+        {
+            auto image = EvaluateNode(node, rect, pass);
+            it = pass.SharedResults.emplace(key, std::move(image)).first;
+        }
+
+        // Consumers may modify the image they are given, so each gets its own copy.
+        return it->second;
+    }
+
+
+    CpuImage CpuEffectRenderer::EvaluateNode(Node const& node, CpuRect const& rect, RenderPass& pass)
+    {
+        // Only evaluate the part of the request that can contain visible pixels.
+        auto visibleRect = Intersect(rect, node.Bounds);
+
+        if (visibleRect.IsEmpty())
+            return CpuImage(rect);
+
+        auto image = node.Reader.Read ? node.Reader.Read(visibleRect)
+                                      : RenderEffect(node, visibleRect, pass);
+
+        // Callers expect an image covering exactly the requested rectangle.
+        if (image.GetBounds() == rect)
+            return image;
+
+        return image.Copy(rect);
+    }
+
+
+    CpuImage CpuEffectRenderer::RenderEffect(Node const& node, CpuRect const& rect, RenderPass& pass)
+    {
+        auto& effectId = node.EffectId;
+        auto& properties = node.Properties;
+        auto& sources = node.Sources;
+
+        if (IsEqualGUID(effectId, CLSID_D2D1GaussianBlur))
+        {
+            auto standardDeviation = GetFloat(properties, D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION);
+            auto borderMode = static_cast<BorderMode>(GetUInt32(properties, D2D1_GAUSSIANBLUR_PROP_BORDER_MODE));
+
+            auto& source = *sources[0];
+            auto sourceRect = GetGaussianBlurSourceRect(rect, source.Bounds, standardDeviation, borderMode);
+
+            return GaussianBlur(RenderNode(source, sourceRect, pass), source.Bounds, standardDeviation, borderMode, rect);
+        }
+        else if (IsEqualGUID(effectId, CLSID_D2D1ColorMatrix))
+        {
+            float matrix[20];
+            GetFloatArray(properties, D2D1_COLORMATRIX_PROP_COLOR_MATRIX, matrix);
+
+            auto image = RenderNode(*sources[0], rect, pass);
+
+            ColorMatrix(image,
+                        matrix,
+                        static_cast<ColorMatrixAlphaMode>(GetUInt32(properties, D2D1_COLORMATRIX_PROP_ALPHA_MODE)),
+                        GetBoolean(properties, D2D1_COLORMATRIX_PROP_CLAMP_OUTPUT));
+
+            return image;
+        }
+        else if (IsEqualGUID(effectId, CLSID_D2D1Blend))
+        {
+            if (sources.size() < 2)
+                ThrowHR(E_BOUNDS);
+
+            return Blend(RenderNode(*sources[0], rect, pass),
+                         RenderNode(*sources[1], rect, pass),
+                         static_cast<BlendMode>(GetUInt32(properties, D2D1_BLEND_PROP_MODE)),
+                         rect);
+        }
+        else if (IsEqualGUID(effectId, CLSID_D2D1Composite))
+        {
+            auto mode = static_cast<CompositeMode>(GetUInt32(properties, D2D1_COMPOSITE_PROP_MODE));
+
+            // The first source is the destination, which each subsequent source is drawn over in turn.
+            auto image = RenderNode(*sources[0], rect, pass);
+
+            for (size_t i = 1; i < sources.size(); i++)
+            {
+                Composite(image, RenderNode(*sources[i], rect, pass), sources[i]->Bounds, mode);
+            }
+
+            return image;
+        }
+        else if (IsEqualGUID(effectId, CLSID_D2D1ArithmeticComposite))
+        {
+            if (sources.size() < 2)
+                ThrowHR(E_BOUNDS);
+
+            float coefficients[4];
+            GetFloatArray(properties, D2D1_ARITHMETICCOMPOSITE_PROP_COEFFICIENTS, coefficients);
+
+            return ArithmeticComposite(RenderNode(*sources[0], rect, pass),
+                                       RenderNode(*sources[1], rect, pass),
+                                       coefficients,
+                                       GetBoolean(properties, D2D1_ARITHMETICCOMPOSITE_PROP_CLAMP_OUTPUT),
+                                       rect);
+        }
+        else if (IsEqualGUID(effectId, CLSID_D2D1Crop))
+        {
+            float cropRect[4];
+            GetFloatArray(properties, D2D1_CROP_PROP_RECT, cropRect);
+
+            auto image = RenderNode(*sources[0], rect, pass);
+
+            Crop(image, cropRect, static_cast<BorderMode>(GetUInt32(properties, D2D1_CROP_PROP_BORDER_MODE)));
+
+            return image;
+        }
+        else if (IsEqualGUID(effectId, CLSID_D2D12DAffineTransform))
+        {
+            float matrix[6];
+            GetFloatArray(properties, D2D1_2DAFFINETRANSFORM_PROP_TRANSFORM_MATRIX, matrix);
+
+            // Higher quality interpolation modes fall back to linear filtering.
+            auto interpolationMode = (GetUInt32(properties, D2D1_2DAFFINETRANSFORM_PROP_INTERPOLATION_MODE) == D2D1_2DAFFINETRANSFORM_INTERPOLATION_MODE_NEAREST_NEIGHBOR)
+                ? InterpolationMode::NearestNeighbor
+                : InterpolationMode::Linear;
+
+            auto borderMode = static_cast<BorderMode>(GetUInt32(properties, D2D1_2DAFFINETRANSFORM_PROP_BORDER_MODE));
+
+            auto& source = *sources[0];
+            auto sourceRect = GetTransformSourceRect(rect, source.Bounds, matrix);
+
+            return Transform(RenderNode(source, sourceRect, pass), source.Bounds, matrix, interpolationMode, borderMode, rect);
+        }
+        else if (IsEqualGUID(effectId, CLSID_D2D1Border))
+        {
+            auto& source = *sources[0];
+
+            auto edgeModeX = static_cast<EdgeMode>(GetUInt32(properties, D2D1_BORDER_PROP_EDGE_MODE_X));
+            auto edgeModeY = static_cast<EdgeMode>(GetUInt32(properties, D2D1_BORDER_PROP_EDGE_MODE_Y));
+
+            // Only render the parts of the source this region actually samples:
+            // the part it overlaps, plus any strips it wraps or mirrors from
+            // the far edges. These stay small however large the source is.
+            CpuImage image(rect);
+
+            for (auto& sourceRect : GetBorderSourceRects(rect, source.Bounds, edgeModeX, edgeModeY))
+            {
+                Border(image, RenderNode(source, sourceRect, pass), source.Bounds, edgeModeX, edgeModeY);
+            }
+
+            return image;
+        }
+#if WINVER > _WIN32_WINNT_WINBLUE
+        else if (IsEqualGUID(effectId, CLSID_D2D1Opacity))
+        {
+            auto image = RenderNode(*sources[0], rect, pass);
+
+            Opacity(image, GetFloat(properties, D2D1_OPACITY_PROP_OPACITY));
+
+            return image;
+        }
+#endif
+        else
+        {
+            ThrowHR(E_NOTIMPL, Strings::CpuEffectUnsupportedEffect);
+        }
+    }
+}}}}}
@@ -0,0 +1,107 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "CpuEffectKernels.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    using namespace ::Microsoft::WRL;
+    using namespace ABI::Windows::Foundation;
+
+    //
+    // Evaluates an effect graph in software, using CpuEffectKernels.
+    //
+    // The graph is walked through IGraphicsEffectD2D1Interop, the same way
+    // CanvasEffect walks it when realizing D2D effects, so the renderer sees
+    // the same sources and the same D2D formatted property values. This lets
+    // a graph be rendered without a GPU (eg. for server side thumbnailing or
+    // headless test runs), and gives deterministic reference output.
+    //
+    // Coordinates are in pixels. Leaf images are placed at the origin: by
+    // default these must be CanvasBitmaps, which are read back a region at a
+    // time using GetPixelBytes, but a SourceResolver can supply pixels for any
+    // other type of source.
+    //
+    // Each output region is evaluated by mapping it back through the graph to
+    // the region of each source that it depends on (including any halo needed
+    // by blurs or transforms), so only pixels that contribute to the result
+    // are read or computed. RenderTiles uses this to process images that are
+    // too large to render in one go. Nodes with more than one consumer are
+    // evaluated once per region within each Render call or tile.
+    //
+    class CpuEffectRenderer
+    {
+    public:
+        // Describes a leaf image. Read may be called concurrently from several
+        // threads, and must return an image covering the requested region.
+        struct SourceReader
+        {
+            CpuRect Bounds;
+            std::function<CpuImage(CpuRect const& region)> Read;
+
+            static SourceReader FromImage(CpuImage image);
+        };
+
+        // Returns false if the source is not recognized, in which case the default rules apply.
+        typedef std::function<bool(IGraphicsEffectSource* source, SourceReader* reader)> SourceResolver;
+
+        // Receives the tiles produced by RenderTiles.
+        typedef std::function<void(CpuImage const& tile)> TileSink;
+
+        explicit CpuEffectRenderer(SourceResolver sourceResolver = nullptr);
+
+        // Reports whether every effect in the graph has a CPU implementation.
+        static bool IsSupported(IGraphicsEffectSource* graph);
+
+        CpuRect GetBounds(IGraphicsEffectSource* graph);
+
+        // Renders the specified region of the graph.
+        CpuImage Render(IGraphicsEffectSource* graph, CpuRect const& rect);
+
+        // Renders the whole graph, which must have finite bounds.
+        CpuImage Render(IGraphicsEffectSource* graph);
+
+        // Renders the specified region as a grid of tiles, which are evaluated
+        // in parallel but passed to the sink one at a time in raster order.
+        // At most one tile per worker thread is held in memory at once. Set
+        // tileWidth to the width of the region to produce horizontal bands,
+        // as expected by streaming encoders.
+        void RenderTiles(IGraphicsEffectSource* graph, CpuRect const& rect, int tileWidth, int tileHeight, TileSink const& sink);
+
+    private:
+        struct Node
+        {
+            IID EffectId;
+            std::vector<ComPtr<IPropertyValue>> Properties;
+            std::vector<std::shared_ptr<Node>> Sources;
+            SourceReader Reader;
+            CpuRect Bounds;
+            unsigned ConsumerCount;
+        };
+
+        typedef std::map<IUnknown*, std::shared_ptr<Node>> NodeMap;
+
+        // Results for nodes with more than one consumer, kept for the
+        // duration of one Render call or one tile.
+        struct RenderPass
+        {
+            typedef std::tuple<Node const*, int, int, int, int> Key;
+
+            std::map<Key, CpuImage> SharedResults;
+        };
+
+        SourceResolver m_sourceResolver;
+
+        std::shared_ptr<Node> BuildGraph(IGraphicsEffectSource* graph);
+        std::shared_ptr<Node> BuildNode(IGraphicsEffectSource* source, NodeMap& nodes, std::set<IUnknown*>& visiting);
+        SourceReader GetSourceReader(IGraphicsEffectSource* source);
+
+        static CpuRect GetNodeBounds(Node const& node);
+        static CpuImage RenderNode(Node const& node, CpuRect const& rect, RenderPass& pass);
+        static CpuImage EvaluateNode(Node const& node, CpuRect const& rect, RenderPass& pass);
+        static CpuImage RenderEffect(Node const& node, CpuRect const& rect, RenderPass& pass);
+    };
+}}}}}
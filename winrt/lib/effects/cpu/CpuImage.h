@@ -0,0 +1,208 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+//
+// Image types used by the CPU reference implementation of effects.
+//
+// Everything in effects\cpu apart from CpuEffectRenderer depends only on the
+// C++ standard library, so the kernels can be compiled and validated on
+// machines (or platforms) that have no D2D or GPU available.
+//
+
+
+// Premultiplied RGBA color, with one float per channel.
+struct CpuColor
+{
+    float R;
+    float G;
+    float B;
+    float A;
+};
+
+
+// Integer pixel rectangle, with exclusive right and bottom edges.
+struct CpuRect
+{
+    int Left;
+    int Top;
+    int Right;
+    int Bottom;
+
+    // Coordinates at or beyond this magnitude are treated as infinite. This is
+    // far larger than any image we could allocate, but small enough that
+    // inflating a rectangle by a kernel radius cannot overflow.
+    static const int InfiniteExtent = 1 << 24;
+
+    static CpuRect Infinite()
+    {
+        return CpuRect{ -InfiniteExtent, -InfiniteExtent, InfiniteExtent, InfiniteExtent };
+    }
+
+    static CpuRect Empty()
+    {
+        return CpuRect{ 0, 0, 0, 0 };
+    }
+
+    int Width() const  { return std::max(Right - Left, 0); }
+    int Height() const { return std::max(Bottom - Top, 0); }
+
+    bool IsEmpty() const
+    {
+        return Right <= Left || Bottom <= Top;
+    }
+
+    bool IsInfinite() const
+    {
+        return Left <= -InfiniteExtent || Top <= -InfiniteExtent || Right >= InfiniteExtent || Bottom >= InfiniteExtent;
+    }
+
+    bool Contains(int x, int y) const
+    {
+        return x >= Left && x < Right && y >= Top && y < Bottom;
+    }
+
+    CpuRect Inflate(int dx, int dy) const
+    {
+        if (IsEmpty())
+            return *this;
+
+        const int extent = InfiniteExtent;
+
+        return CpuRect
+        {
+            std::max(Left - dx, -extent),
+            std::max(Top - dy, -extent),
+            std::min(Right + dx, extent),
+            std::min(Bottom + dy, extent)
+        };
+    }
+};
+
+
+inline bool operator==(CpuRect const& a, CpuRect const& b)
+{
+    return a.Left == b.Left && a.Top == b.Top && a.Right == b.Right && a.Bottom == b.Bottom;
+}
+
+
+inline bool operator!=(CpuRect const& a, CpuRect const& b)
+{
+    return !(a == b);
+}
+
+
+inline CpuRect Intersect(CpuRect const& a, CpuRect const& b)
+{
+    CpuRect result
+    {
+        std::max(a.Left, b.Left),
+        std::max(a.Top, b.Top),
+        std::min(a.Right, b.Right),
+        std::min(a.Bottom, b.Bottom)
+    };
+
+    return result.IsEmpty() ? CpuRect::Empty() : result;
+}
+
+
+inline CpuRect Union(CpuRect const& a, CpuRect const& b)
+{
+    if (a.IsEmpty())
+        return b;
+
+    if (b.IsEmpty())
+        return a;
+
+    return CpuRect
+    {
+        std::min(a.Left, b.Left),
+        std::min(a.Top, b.Top),
+        std::max(a.Right, b.Right),
+        std::max(a.Bottom, b.Bottom)
+    };
+}
+
+
+//
+// A finite block of premultiplied pixels. Pixels outside the bounds read as
+// transparent black, matching how D2D treats the area outside an image.
+//
+class CpuImage
+{
+    CpuRect m_bounds;
+    std::vector<CpuColor> m_pixels;
+
+public:
+    CpuImage()
+        : m_bounds(CpuRect::Empty())
+    { }
+
+    explicit CpuImage(CpuRect const& bounds)
+        : m_bounds(bounds.IsEmpty() ? CpuRect::Empty() : bounds)
+    {
+        assert(!m_bounds.IsInfinite());
+
+        m_pixels.resize(static_cast<size_t>(m_bounds.Width()) * m_bounds.Height(), CpuColor{ 0, 0, 0, 0 });
+    }
+
+    CpuRect const& GetBounds() const
+    {
+        return m_bounds;
+    }
+
+    // Returns the first pixel of row y, which corresponds to x = GetBounds().Left.
+    CpuColor* GetRow(int y)
+    {
+        assert(y >= m_bounds.Top && y < m_bounds.Bottom);
+
+        return m_pixels.data() + static_cast<size_t>(y - m_bounds.Top) * m_bounds.Width();
+    }
+
+    CpuColor const* GetRow(int y) const
+    {
+        return const_cast<CpuImage*>(this)->GetRow(y);
+    }
+
+    CpuColor GetPixel(int x, int y) const
+    {
+        if (!m_bounds.Contains(x, y))
+            return CpuColor{ 0, 0, 0, 0 };
+
+        return GetRow(y)[x - m_bounds.Left];
+    }
+
+    void SetPixel(int x, int y, CpuColor const& color)
+    {
+        assert(m_bounds.Contains(x, y));
+
+        GetRow(y)[x - m_bounds.Left] = color;
+    }
+
+    // Returns an image covering exactly the specified rectangle, which may
+    // extend outside the bounds of this one.
+    CpuImage Copy(CpuRect const& rect) const
+    {
+        CpuImage result(rect);
+
+        auto copyRect = Intersect(rect, m_bounds);
+
+        for (int y = copyRect.Top; y < copyRect.Bottom; y++)
+        {
+            auto source = GetRow(y) + (copyRect.Left - m_bounds.Left);
+            auto dest = result.GetRow(y) + (copyRect.Left - result.m_bounds.Left);
+
+            memcpy(dest, source, copyRect.Width() * sizeof(CpuColor));
+        }
+
+        return result;
+    }
+};
@@ -5,6 +5,7 @@
 #include "pch.h"
 #include "ClipTransform.h"
 #include "SharedShaderState.h"
+#include "ShaderRectMapping.h"
 
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
 {
@@ -30,84 +31,12 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
         return ExceptionBoundary([&]
         {
-            D2D_RECT_L accumulatedRect = { INT_MIN, INT_MIN, INT_MAX, INT_MAX };
-            bool gotRect = false;
-            bool gotOffset = false;
+            // Skip the output from PixelShaderTransform - we only care about its original input images.
+            unsigned inputCount = inputRectCount ? inputRectCount - 1 : 0;
 
-            // Start at 1 to skip the output from PixelShaderTransform - we only care about its original input images.
-            for (unsigned i = 1; i < inputRectCount; i++)
-            {
-                unsigned inputIndex = i - 1;
-
-                if (inputIndex >= MaxShaderInputs)
-                    ThrowHR(E_INVALIDARG);
-
-                D2D_RECT_L rect;
-
-                switch (m_coordinateMapping->Mapping[inputIndex])
-                {
-                    case SamplerCoordinateMapping::Unknown:
-                        // Due to unknown coordinate mapping, this input does not contribute to the output rectangle.
-                        continue;
-
-                    case SamplerCoordinateMapping::OneToOne:
-                        // This input rectangle maps directly to the output.
-                        rect = inputRects[i];
-                        break;
-
-                    case SamplerCoordinateMapping::Offset:
-                        // This rectangle may need to be expanded due to the use of offset texture coordinates.
-                        if (!m_coordinateMapping->MaxOffset)
-                        {
-                            WinStringBuilder message;
-                            message.Format(Strings::CustomEffectOffsetMappingWithoutMaxOffset, i);
-                            ThrowHR(E_INVALIDARG, message.Get());
-                        }
-
-                        switch (m_coordinateMapping->BorderMode[inputIndex])
-                        {
-                            case EffectBorderMode::Soft:
-                                // In soft border mode, expand the input rectangle.
-                                rect = ExpandRectangle(inputRects[i], m_coordinateMapping->MaxOffset);
-                                break;
-
-                            case EffectBorderMode::Hard:
-                                // For hard borders, pass the input through unchanged.
-                                rect = inputRects[i];
-                                break;
-
-                            default:
-                                ThrowHR(E_INVALIDARG);
-                        }
-
-                        gotOffset = true;
-                        break;
-
-                    default:
-                        ThrowHR(E_INVALIDARG);
-                }
-
-                if (!gotRect)
-                {
-                    // This is the first output rectangle we have seen, so store it directly.
-                    accumulatedRect = rect;
-                    gotRect = true;
-                }
-                else
-                {
-                    // Subsequent rectangles are combined with the existing region.
-                    accumulatedRect = RectangleUnion(accumulatedRect, rect);
-                }
-            }
-
-            // Validate that if MaxOffset is set, at least one input should be using SamplerCoordinateMapping::Offset.
-            if (m_coordinateMapping->MaxOffset && !gotOffset)
-            {
-                ThrowHR(E_INVALIDARG, Strings::CustomEffectMaxOffsetWithoutOffsetMapping);
-            }
+            ShaderRectMapping mapping(*m_coordinateMapping, inputCount);
 
-            // Return the accumulated output rectangle.
-            *outputRect = accumulatedRect;
+            *outputRect = mapping.MapInputRectsToOutputRect(inputRects + 1);
 
             // We don't know how this shader handles opacity, so always just report an empty opaque subrect.
             *outputOpaqueSubRect = D2D1_RECT_L{ 0, 0, 0, 0 };
@@ -83,6 +83,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     PixelShaderEffect::PixelShaderEffect(ICanvasDevice* device, ID2D1Effect* effect, ISharedShaderState* sharedState)
         : CanvasEffect(CLSID_PixelShaderEffect, 0, sharedState->Shader().InputCount, true, device, effect, static_cast<IPixelShaderEffect*>(this))
         , m_sharedState(sharedState)
+        , m_updateDepth(0)
     {
         m_propertyMap = Make<PropertyMap>(true, this);
         CheckMakeResult(m_propertyMap);
@@ -305,11 +306,118 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         // Store the new property value into our shared state object.
         m_sharedState->SetProperty(name, boxedValue);
 
-        // If we are realized, pass the updated constant buffer on to Direct2D.
-        SetD2DConstants();
+        // If we are realized and the value changed, pass the updated constant buffer on to Direct2D.
+        UpdateD2DConstants();
+    }
+
+
+    void PixelShaderEffect::SetProperties(std::vector<StringObjectPair> const& values)
+    {
+        auto lock = Lock(m_mutex);
+
+        // If any value is invalid, none of them are applied.
+        m_sharedState->SetProperties(values);
+
+        UpdateD2DConstants();
+    }
+
+
+    IFACEMETHODIMP PixelShaderEffect::SetProperties(IIterable<IKeyValuePair<HSTRING, IInspectable*>*>* values)
+    {
+        return ExceptionBoundary([&]
+        {
+            CheckInPointer(values);
+
+            std::vector<StringObjectPair> pairs;
+
+            ComPtr<IIterator<IKeyValuePair<HSTRING, IInspectable*>*>> iterator;
+            ThrowIfFailed(values->First(&iterator));
+
+            boolean hasCurrent;
+            ThrowIfFailed(iterator->get_HasCurrent(&hasCurrent));
+
+            while (hasCurrent)
+            {
+                ComPtr<IKeyValuePair<HSTRING, IInspectable*>> pair;
+                ThrowIfFailed(iterator->get_Current(&pair));
+
+                WinString name;
+                ComPtr<IInspectable> value;
+
+                ThrowIfFailed(pair->get_Key(name.GetAddressOf()));
+                ThrowIfFailed(pair->get_Value(&value));
+
+                pairs.emplace_back(std::move(name), std::move(value));
+
+                ThrowIfFailed(iterator->MoveNext(&hasCurrent));
+            }
+
+            SetProperties(pairs);
+        });
+    }
+
+
+    IFACEMETHODIMP PixelShaderEffect::BeginUpdate(IPixelShaderEffectUpdateScope** updateScope)
+    {
+        return ExceptionBoundary([&]
+        {
+            CheckAndClearOutPointer(updateScope);
+
+            auto newScope = Make<PixelShaderEffectUpdateScope>(this);
+            CheckMakeResult(newScope);
+
+            ThrowIfFailed(newScope.CopyTo(updateScope));
+        });
+    }
+
+
+    void PixelShaderEffect::EndUpdate()
+    {
+        auto lock = Lock(m_mutex);
+
+        assert(m_updateDepth > 0);
+
+        m_updateDepth--;
+
+        UpdateD2DConstants();
+    }
+
+
+    IFACEMETHODIMP PixelShaderEffect::GetPropertyHandle(HSTRING name, uint32_t* handle)
+    {
+        return ExceptionBoundary([&]
+        {
+            CheckInPointer(handle);
+
+            auto lock = Lock(m_mutex);
+
+            *handle = m_sharedState->GetPropertyHandle(name);
+        });
+    }
+
+
+    template<typename T>
+    HRESULT PixelShaderEffect::SetPropertyByHandle(unsigned handle, T const& value)
+    {
+        return ExceptionBoundary([&]
+        {
+            auto lock = Lock(m_mutex);
+
+            m_sharedState->SetPropertyByHandle(handle, value);
+
+            UpdateD2DConstants();
+        });
     }
 
 
+    IFACEMETHODIMP PixelShaderEffect::SetFloat(uint32_t handle, float value)            { return SetPropertyByHandle(handle, value); }
+    IFACEMETHODIMP PixelShaderEffect::SetVector2(uint32_t handle, Vector2 value)        { return SetPropertyByHandle(handle, value); }
+    IFACEMETHODIMP PixelShaderEffect::SetVector3(uint32_t handle, Vector3 value)        { return SetPropertyByHandle(handle, value); }
+    IFACEMETHODIMP PixelShaderEffect::SetVector4(uint32_t handle, Vector4 value)        { return SetPropertyByHandle(handle, value); }
+    IFACEMETHODIMP PixelShaderEffect::SetMatrix3x2(uint32_t handle, Matrix3x2 value)    { return SetPropertyByHandle(handle, value); }
+    IFACEMETHODIMP PixelShaderEffect::SetMatrix4x4(uint32_t handle, Matrix4x4 value)    { return SetPropertyByHandle(handle, value); }
+
+
     HRESULT PixelShaderEffect::GetCoordinateMapping(unsigned index, SamplerCoordinateMapping* value)
     {
         assert(index < MaxShaderInputs);
@@ -443,6 +551,19 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                                               constants.data(),
                                               static_cast<UINT32>(constants.size())));
         }
+
+        // If we are not realized, Realize will pass along the whole buffer later.
+        m_sharedState->ClearDirtyConstants();
+    }
+
+
+    void PixelShaderEffect::UpdateD2DConstants()
+    {
+        // Only pass constants on to Direct2D when they have changed, and not in the middle of a batch update.
+        if (m_updateDepth == 0 && m_sharedState->AreConstantsDirty())
+        {
+            SetD2DConstants();
+        }
     }
 
 
@@ -471,4 +592,39 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         }
     }
 
+
+
+    PixelShaderEffectUpdateScope::PixelShaderEffectUpdateScope(PixelShaderEffect* effect)
+        : m_effect(effect)
+    {
+        auto lock = Lock(effect->m_mutex);
+
+        effect->m_updateDepth++;
+    }
+
+
+    PixelShaderEffectUpdateScope::~PixelShaderEffectUpdateScope()
+    {
+        (void)Close();
+    }
+
+
+    IFACEMETHODIMP PixelShaderEffectUpdateScope::Close()
+    {
+        return ExceptionBoundary([&]
+        {
+            ComPtr<PixelShaderEffect> effect;
+
+            {
+                auto lock = Lock(m_mutex);
+                std::swap(effect, m_effect);
+            }
+
+            // Closing a second time does nothing.
+            if (effect)
+            {
+                effect->EndUpdate();
+            }
+        });
+    }
 }}}}}
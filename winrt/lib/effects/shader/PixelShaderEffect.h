@@ -4,10 +4,10 @@
 
 #pragma once
 
+#include "SharedShaderState.h"
+
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects 
 {
-    class ISharedShaderState;
-
     template<typename TKey, typename TValue> struct PixelShaderEffectPropertyMapTraits;
 
 
@@ -30,6 +30,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
         ComPtr<ISharedShaderState> m_sharedState;
 
+        // While an update scope is open, property changes are not passed on to D2D.
+        unsigned m_updateDepth;
+
         // Traits describe how to expose a view of our constant buffer as an IMap<> collection.
         friend PixelShaderEffectPropertyMapTraits<HSTRING, IInspectable*>;
         typedef Map<HSTRING, IInspectable*, PixelShaderEffectPropertyMapTraits> PropertyMap;
@@ -85,6 +88,23 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
         IFACEMETHOD(IsSupported)(ICanvasDevice* device, boolean* result) override;
 
+        IFACEMETHOD(GetPropertyHandle)(HSTRING name, uint32_t* handle) override;
+
+        IFACEMETHOD(SetFloat)(uint32_t handle, float value) override;
+        IFACEMETHOD(SetVector2)(uint32_t handle, Vector2 value) override;
+        IFACEMETHOD(SetVector3)(uint32_t handle, Vector3 value) override;
+        IFACEMETHOD(SetVector4)(uint32_t handle, Vector4 value) override;
+        IFACEMETHOD(SetMatrix3x2)(uint32_t handle, Matrix3x2 value) override;
+        IFACEMETHOD(SetMatrix4x4)(uint32_t handle, Matrix4x4 value) override;
+
+        IFACEMETHOD(SetProperties)(IIterable<IKeyValuePair<HSTRING, IInspectable*>*>* values) override;
+
+        IFACEMETHOD(BeginUpdate)(IPixelShaderEffectUpdateScope** updateScope) override;
+
+        // Names are resolved together with a single merge against the sorted shader
+        // variables, and the updated constant buffer is passed to D2D once at the end.
+        void SetProperties(std::vector<StringObjectPair> const& values);
+
     protected:
         bool IsSupported(ICanvasDevice* device);
 
@@ -96,6 +116,13 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
         void SetProperty(HSTRING name, IInspectable* boxedValue);
 
+        template<typename T>
+        HRESULT SetPropertyByHandle(unsigned handle, T const& value);
+
+        // Only called by PixelShaderEffectUpdateScope, exactly once per BeginUpdate.
+        friend class PixelShaderEffectUpdateScope;
+        void EndUpdate();
+
         HRESULT GetCoordinateMapping(unsigned index, SamplerCoordinateMapping* value);
         HRESULT SetCoordinateMapping(unsigned index, SamplerCoordinateMapping value);
 
@@ -106,8 +133,28 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         HRESULT SetSourceInterpolation(unsigned index, CanvasImageInterpolation value);
 
         void SetD2DConstants();
+        void UpdateD2DConstants();
         void SetD2DCoordinateMapping();
         void SetD2DSourceInterpolation();
     };
 
+
+    // Returned by PixelShaderEffect::BeginUpdate. The update ends when this is closed or
+    // destroyed, so an exception part way through a batch cannot leave it open forever.
+    class PixelShaderEffectUpdateScope : public RuntimeClass<IPixelShaderEffectUpdateScope, IClosable>
+                                       , private LifespanTracker<PixelShaderEffectUpdateScope>
+    {
+        InspectableClass(RuntimeClass_Microsoft_Graphics_Canvas_Effects_PixelShaderEffectUpdateScope, BaseTrust);
+
+        std::mutex m_mutex;
+        ComPtr<PixelShaderEffect> m_effect;
+
+    public:
+        PixelShaderEffectUpdateScope(PixelShaderEffect* effect);
+
+        virtual ~PixelShaderEffectUpdateScope();
+
+        IFACEMETHOD(Close)() override;
+    };
+
 }}}}}
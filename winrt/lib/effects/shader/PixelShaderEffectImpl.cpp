@@ -256,6 +256,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     {
         return ExceptionBoundary([&]
         {
+            // PixelShaderEffect only sets this property when SharedShaderState has
+            // seen a value change, so there is no point comparing the buffers again.
             m_constants.assign(data, data + dataSize);
             m_constantsDirty = true;
         });
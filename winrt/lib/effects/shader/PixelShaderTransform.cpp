@@ -5,6 +5,7 @@
 #include "pch.h"
 #include "PixelShaderTransform.h"
 #include "SharedShaderState.h"
+#include "ShaderRectMapping.h"
 
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
 {
@@ -38,29 +39,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     {
         return ExceptionBoundary([&]
         {
-            for (unsigned i = 0; i < inputRectsCount; i++)
-            {
-                switch (m_coordinateMapping->Mapping[i])
-                {
-                case SamplerCoordinateMapping::Unknown:
-                    // Due to unknown coordinate mapping, we must request access to an infinite input area.
-                    inputRects[i] = D2D_RECT_L{ INT_MIN, INT_MIN, INT_MAX, INT_MAX };
-                    break;
-
-                case SamplerCoordinateMapping::OneToOne:
-                    // This output rectangle maps directly to the input.
-                    inputRects[i] = *outputRect;
-                    break;
-
-                case SamplerCoordinateMapping::Offset:
-                    // This rectangle must be expanded due to the use of offset texture coordinates.
-                    inputRects[i] = ExpandRectangle(*outputRect, m_coordinateMapping->MaxOffset);
-                    break;
-
-                default:
-                    ThrowHR(E_INVALIDARG);
-                }
-            }
+            ShaderRectMapping mapping(*m_coordinateMapping, inputRectsCount);
+
+            mapping.MapOutputRectToInputRects(*outputRect, inputRects);
         });
     }
 
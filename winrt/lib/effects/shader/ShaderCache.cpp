@@ -0,0 +1,179 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "ShaderCache.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    ShaderCache::ShaderCache(uint32_t maximumRetainedCount)
+        : m_maximumRetainedCount(maximumRetainedCount)
+        , m_statistics{}
+    {
+    }
+
+
+    ShaderCache& ShaderCache::Instance()
+    {
+        static ShaderCache instance;
+
+        return instance;
+    }
+
+
+    CachedShader ShaderCache::Lookup(IID const& hash, BYTE const* shaderCode, uint32_t shaderCodeSize)
+    {
+        Lock lock(m_mutex);
+
+        auto result = Find(hash, shaderCode, shaderCodeSize);
+
+        if (result.Shader)
+        {
+            m_statistics.Hits++;
+            Retain(result.Shader);
+        }
+        else
+        {
+            m_statistics.Misses++;
+        }
+
+        return result;
+    }
+
+
+    CachedShader ShaderCache::Insert(CachedShader const& shader)
+    {
+        assert(shader.Shader && shader.Constants);
+
+        auto& code = shader.Shader->Code;
+
+        Lock lock(m_mutex);
+
+        // If two threads reflected the same shader at once, the first one to finish wins.
+        auto existing = Find(shader.Shader->Hash, code.data(), static_cast<uint32_t>(code.size()));
+
+        if (existing.Shader)
+        {
+            Retain(existing.Shader);
+            return existing;
+        }
+
+        RemoveExpiredEntries();
+
+        m_entries[shader.Shader->Hash] = Entry{ shader.Shader, shader.Constants };
+
+        Retain(shader.Shader);
+
+        return shader;
+    }
+
+
+    uint32_t ShaderCache::GetMaximumRetainedCount()
+    {
+        Lock lock(m_mutex);
+
+        return m_maximumRetainedCount;
+    }
+
+
+    void ShaderCache::SetMaximumRetainedCount(uint32_t value)
+    {
+        Lock lock(m_mutex);
+
+        m_maximumRetainedCount = value;
+
+        TrimRetainedShaders(value);
+    }
+
+
+    ShaderCacheStatistics ShaderCache::GetStatistics()
+    {
+        Lock lock(m_mutex);
+
+        RemoveExpiredEntries();
+
+        auto statistics = m_statistics;
+
+        statistics.CachedShaderCount = static_cast<uint32_t>(m_entries.size());
+        statistics.RetainedShaderCount = static_cast<uint32_t>(m_retainedShaders.size());
+
+        return statistics;
+    }
+
+
+    void ShaderCache::Clear()
+    {
+        Lock lock(m_mutex);
+
+        m_entries.clear();
+        m_retainedShaders.clear();
+    }
+
+
+    CachedShader ShaderCache::Find(IID const& hash, BYTE const* shaderCode, uint32_t shaderCodeSize)
+    {
+        auto it = m_entries.find(hash);
+
+        if (it == m_entries.end())
+            return CachedShader{};
+
+        auto shader = it->second.Shader.lock();
+
+        if (!shader)
+        {
+            m_entries.erase(it);
+            return CachedShader{};
+        }
+
+        // Guard against hash collisions by also comparing the code itself, which is much cheaper than reflecting over it.
+        if (shader->Code.size() != shaderCodeSize || memcmp(shader->Code.data(), shaderCode, shaderCodeSize) != 0)
+            return CachedShader{};
+
+        return CachedShader{ shader, it->second.Constants };
+    }
+
+
+    void ShaderCache::Retain(std::shared_ptr<ShaderDescription> const& shader)
+    {
+        auto it = std::find(m_retainedShaders.begin(), m_retainedShaders.end(), shader);
+
+        if (it != m_retainedShaders.end())
+        {
+            // Move to the most recently used end.
+            std::rotate(it, it + 1, m_retainedShaders.end());
+        }
+        else
+        {
+            m_retainedShaders.push_back(shader);
+
+            TrimRetainedShaders(m_maximumRetainedCount);
+        }
+    }
+
+
+    void ShaderCache::TrimRetainedShaders(uint32_t count)
+    {
+        if (m_retainedShaders.size() <= count)
+            return;
+
+        auto evictCount = m_retainedShaders.size() - count;
+
+        m_retainedShaders.erase(m_retainedShaders.begin(), m_retainedShaders.begin() + evictCount);
+
+        m_statistics.Evictions += evictCount;
+    }
+
+
+    void ShaderCache::RemoveExpiredEntries()
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end();)
+        {
+            if (it->second.Shader.expired())
+                it = m_entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+}}}}}
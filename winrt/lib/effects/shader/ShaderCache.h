@@ -0,0 +1,100 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "ShaderDescription.h"
+#include "utils/LockUtilities.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    struct ShaderCacheStatistics
+    {
+        uint64_t Hits;
+        uint64_t Misses;
+        uint64_t Evictions;
+        uint32_t CachedShaderCount;
+        uint32_t RetainedShaderCount;
+    };
+
+
+    // Reflection results for a shader, plus the default constant buffer values.
+    struct CachedShader
+    {
+        std::shared_ptr<ShaderDescription> Shader;
+        std::shared_ptr<std::vector<BYTE> const> Constants;
+    };
+
+
+    //
+    // Process-wide cache of shader reflection results, keyed by ShaderDescription::Hash.
+    //
+    // SharedShaderState consults this before reflecting over shader code, so
+    // creating many PixelShaderEffect instances from the same bytecode only runs
+    // D3D reflection once. Instances share the (immutable) ShaderDescription, and
+    // initialize their constant buffer from the cached default values.
+    //
+    // Entries are held weakly, so a shader stays cached for as long as any
+    // SharedShaderState is using it. In addition, the most recently used shaders
+    // are kept alive even when nothing references them, so apps that repeatedly
+    // create and release effects do not reflect each time.
+    //
+    class ShaderCache
+    {
+        struct Entry
+        {
+            std::weak_ptr<ShaderDescription> Shader;
+            std::shared_ptr<std::vector<BYTE> const> Constants;
+        };
+
+        struct IidLess
+        {
+            bool operator()(IID const& a, IID const& b) const
+            {
+                return memcmp(&a, &b, sizeof(IID)) < 0;
+            }
+        };
+
+        std::mutex m_mutex;
+        uint32_t m_maximumRetainedCount;
+
+        std::map<IID, Entry, IidLess> m_entries;
+
+        // Ordered from least to most recently used.
+        std::vector<std::shared_ptr<ShaderDescription>> m_retainedShaders;
+
+        ShaderCacheStatistics m_statistics;
+
+    public:
+        static const uint32_t DefaultMaximumRetainedCount = 16;
+
+        ShaderCache(uint32_t maximumRetainedCount = DefaultMaximumRetainedCount);
+
+        ShaderCache(ShaderCache const&) = delete;
+        ShaderCache& operator=(ShaderCache const&) = delete;
+
+        static ShaderCache& Instance();
+
+        // Returns the cached reflection results for this shader code, or nulls if there are none.
+        CachedShader Lookup(IID const& hash, BYTE const* shaderCode, uint32_t shaderCodeSize);
+
+        // Adds newly reflected shader state to the cache. If another thread got there
+        // first, returns the existing cached state, otherwise returns the state passed in.
+        CachedShader Insert(CachedShader const& shader);
+
+        uint32_t GetMaximumRetainedCount();
+        void SetMaximumRetainedCount(uint32_t value);
+
+        ShaderCacheStatistics GetStatistics();
+
+        void Clear();
+
+    private:
+        CachedShader Find(IID const& hash, BYTE const* shaderCode, uint32_t shaderCodeSize);
+        void Retain(std::shared_ptr<ShaderDescription> const& shader);
+        void TrimRetainedShaders(uint32_t count);
+        void RemoveExpiredEntries();
+    };
+
+}}}}}
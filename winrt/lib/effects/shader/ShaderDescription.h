@@ -21,6 +21,18 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         { }
 
 
+        ShaderVariable(WinString const& name, D3D_SHADER_VARIABLE_CLASS variableClass, D3D_SHADER_VARIABLE_TYPE type, unsigned rows, unsigned columns, unsigned elements, unsigned size, unsigned offset)
+            : Name(name)
+            , Class(variableClass)
+            , Type(type)
+            , Rows(rows)
+            , Columns(columns)
+            , Elements(elements)
+            , Size(size)
+            , Offset(offset)
+        { }
+
+
         WinString Name;
 
         D3D_SHADER_VARIABLE_CLASS Class;
@@ -76,6 +88,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             , InputCount(0)
             , InstructionCount(0)
             , MinFeatureLevel(static_cast<D3D_FEATURE_LEVEL>(0))
+            , SimpleInputs(0)
         { }
 
 
@@ -88,6 +101,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         unsigned InstructionCount;
         D3D_FEATURE_LEVEL MinFeatureLevel;
 
+        // Bit N is set if the shader linking function says input N is a simple input.
+        uint32_t SimpleInputs;
+
         // Sorted by name.
         std::vector<ShaderVariable> Variables;
     };
@@ -0,0 +1,222 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "ShaderPackage.h"
+#include "SharedShaderState.h"
+#include "PixelShaderEffect.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    using namespace ShaderPackageFormat;
+
+
+    static void ThrowBadPackage()
+    {
+        ThrowHR(E_INVALIDARG, Strings::CustomEffectBadShaderPackage);
+    }
+
+
+    static void ThrowIfWin32Failed(BOOL succeeded)
+    {
+        if (!succeeded)
+            ThrowHR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+
+    static_assert(ShaderPackageFormat::MaxInputCount == static_cast<uint32_t>(MaxShaderInputs), "ShaderPackageFormat::MaxInputCount must match MaxShaderInputs");
+
+    static_assert(ShaderPackageFormat::Scalar == D3D_SVC_SCALAR &&
+                  ShaderPackageFormat::Vector == D3D_SVC_VECTOR &&
+                  ShaderPackageFormat::MatrixRows == D3D_SVC_MATRIX_ROWS &&
+                  ShaderPackageFormat::MatrixColumns == D3D_SVC_MATRIX_COLUMNS, "ShaderPackageFormat::VariableClass must match D3D_SHADER_VARIABLE_CLASS");
+
+    static_assert(ShaderPackageFormat::Bool == D3D_SVT_BOOL &&
+                  ShaderPackageFormat::Int == D3D_SVT_INT &&
+                  ShaderPackageFormat::Float == D3D_SVT_FLOAT, "ShaderPackageFormat::VariableType must match D3D_SHADER_VARIABLE_TYPE");
+
+    static_assert(sizeof(Shader::Hash) == sizeof(IID), "ShaderPackageFormat::Shader::Hash must hold an IID");
+
+
+    static WinString ToWinString(std::u16string const& value)
+    {
+        auto begin = reinterpret_cast<wchar_t const*>(value.data());
+
+        return WinString(begin, begin + value.size());
+    }
+
+
+    static IID GetHash(Shader const& shader)
+    {
+        IID hash;
+        memcpy(&hash, shader.Hash, sizeof(hash));
+        return hash;
+    }
+
+
+    ShaderPackage::ShaderPackage(BYTE const* data, size_t size, std::shared_ptr<void const> const& owner)
+        : m_owner(owner)
+    {
+        if (!ShaderPackageReader::Open(data, size, &m_reader))
+            ThrowBadPackage();
+
+        m_shaderNames.reserve(m_reader.GetShaderCount());
+
+        for (size_t i = 0; i < m_reader.GetShaderCount(); i++)
+        {
+            m_shaderNames.push_back(ToWinString(m_reader.GetShader(i).Name));
+        }
+    }
+
+
+    std::shared_ptr<ShaderPackage> ShaderPackage::MapFile(wchar_t const* path)
+    {
+        Wrappers::FileHandle file(CreateFile2(path, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr));
+        ThrowIfWin32Failed(file.IsValid());
+
+        FILE_STANDARD_INFO info;
+        ThrowIfWin32Failed(GetFileInformationByHandleEx(file.Get(), FileStandardInfo, &info, sizeof(info)));
+
+        if (info.EndOfFile.QuadPart < static_cast<LONGLONG>(sizeof(Header)) ||
+            info.EndOfFile.QuadPart > UINT32_MAX)
+        {
+            ThrowBadPackage();
+        }
+
+        Wrappers::HandleT<Wrappers::HandleTraits::HANDLENullTraits> mapping(CreateFileMappingFromApp(file.Get(), nullptr, PAGE_READONLY, 0, nullptr));
+        ThrowIfWin32Failed(mapping.IsValid());
+
+        auto view = MapViewOfFileFromApp(mapping.Get(), FILE_MAP_READ, 0, 0);
+        ThrowIfWin32Failed(view != nullptr);
+
+        // The view keeps the file mapping alive after our handles are closed.
+        std::shared_ptr<void const> owner(view, [](void const* value) { UnmapViewOfFile(value); });
+
+        return std::make_shared<ShaderPackage>(static_cast<BYTE const*>(view), static_cast<size_t>(info.EndOfFile.QuadPart), owner);
+    }
+
+
+    unsigned ShaderPackage::GetShaderCount() const
+    {
+        return static_cast<unsigned>(m_shaderNames.size());
+    }
+
+
+    WinString const& ShaderPackage::GetShaderName(unsigned index) const
+    {
+        if (index >= m_shaderNames.size())
+            ThrowHR(E_BOUNDS);
+
+        return m_shaderNames[index];
+    }
+
+
+    bool ShaderPackage::FindShader(HSTRING name, unsigned* index) const
+    {
+        auto it = std::find_if(m_shaderNames.begin(), m_shaderNames.end(), [=](WinString const& shaderName) { return shaderName.Equals(name); });
+
+        if (it == m_shaderNames.end())
+            return false;
+
+        *index = static_cast<unsigned>(it - m_shaderNames.begin());
+        return true;
+    }
+
+
+    CachedShader ShaderPackage::GetShader(unsigned index) const
+    {
+        if (index >= m_shaderNames.size())
+            ThrowHR(E_BOUNDS);
+
+        auto& shader = m_reader.GetShader(index);
+
+        // Look up the cache using the hash from the package. The cache compares code as well
+        // as hashes, so a hit means the package hash matches one that was computed from this
+        // code. On a miss, LoadShader checks the hash before anything is added to the cache.
+        auto& cache = ShaderCache::Instance();
+
+        auto cachedShader = cache.Lookup(GetHash(shader.Layout), shader.Code, shader.Layout.CodeSize);
+
+        if (!cachedShader.Shader)
+        {
+            cachedShader = cache.Insert(LoadShader(index));
+        }
+
+        return cachedShader;
+    }
+
+
+    ComPtr<SharedShaderState> ShaderPackage::CreateSharedShaderState(unsigned index) const
+    {
+        auto sharedState = Make<SharedShaderState>(GetShader(index));
+        CheckMakeResult(sharedState);
+
+        return sharedState;
+    }
+
+
+    ComPtr<PixelShaderEffect> ShaderPackage::CreatePixelShaderEffect(unsigned index) const
+    {
+        auto sharedState = CreateSharedShaderState(index);
+
+        auto effect = Make<PixelShaderEffect>(nullptr, nullptr, sharedState.Get());
+        CheckMakeResult(effect);
+
+        return effect;
+    }
+
+
+    CachedShader ShaderPackage::LoadShader(unsigned index) const
+    {
+        auto& shader = m_reader.GetShader(index);
+        auto& layout = shader.Layout;
+
+        // The hash is used as the D2D shader ID, so a wrong one would make D2D run
+        // whichever other shader was loaded with that ID.
+        auto hash = GetHash(layout);
+
+        if (hash != SharedShaderState::ComputeShaderHash(shader.Code, layout.CodeSize))
+            ThrowBadPackage();
+
+        auto description = std::make_shared<ShaderDescription>();
+
+        description->Code.assign(shader.Code, shader.Code + layout.CodeSize);
+        description->Hash = hash;
+        description->InputCount = layout.InputCount;
+        description->InstructionCount = layout.InstructionCount;
+        description->MinFeatureLevel = static_cast<D3D_FEATURE_LEVEL>(layout.MinFeatureLevel);
+
+        if (layout.Flags & HasLinkingInfo)
+        {
+            description->SimpleInputs = layout.SimpleInputs;
+        }
+        else
+        {
+            // The tool could not reflect over the linking function, so fall back to doing that here.
+            description->SimpleInputs = SharedShaderState::ReflectOverShaderLinkingFunction(description->Code);
+        }
+
+        auto variables = m_reader.GetVariables(index);
+
+        description->Variables.reserve(variables.size());
+
+        for (auto& variable : variables)
+        {
+            description->Variables.emplace_back(ToWinString(variable.Name),
+                                                static_cast<D3D_SHADER_VARIABLE_CLASS>(variable.Layout.Class),
+                                                static_cast<D3D_SHADER_VARIABLE_TYPE>(variable.Layout.Type),
+                                                variable.Layout.Rows,
+                                                variable.Layout.Columns,
+                                                variable.Layout.Elements,
+                                                variable.Layout.Size,
+                                                variable.Layout.Offset);
+        }
+
+        // The tool sorts variables by name, but it costs little to make sure they match our comparison.
+        std::sort(description->Variables.begin(), description->Variables.end(), VariableNameComparison());
+
+        return CachedShader{ description, std::make_shared<std::vector<BYTE> const>(shader.Constants, shader.Constants + layout.ConstantsSize) };
+    }
+
+}}}}}
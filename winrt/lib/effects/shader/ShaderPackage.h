@@ -0,0 +1,52 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "ShaderCache.h"
+#include "ShaderPackageReader.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    class PixelShaderEffect;
+    class SharedShaderState;
+
+    //
+    // Reads a shader package, constructing SharedShaderState without D3D reflection.
+    //
+    // The package layout is validated by ShaderPackageReader when it is opened, so
+    // malformed packages fail early rather than when a particular shader is used.
+    // The hash stored for each shader is checked against its code when the shader
+    // is first loaded. Shaders loaded from a package go through the ShaderCache,
+    // so later PixelShaderEffects created from the same bytecode also skip reflection.
+    //
+    class ShaderPackage
+    {
+        std::shared_ptr<void const> m_owner;
+        ShaderPackageReader m_reader;
+        std::vector<WinString> m_shaderNames;
+
+    public:
+        // Reads a package from memory. The owner keeps the data alive for the lifetime of the package.
+        ShaderPackage(BYTE const* data, size_t size, std::shared_ptr<void const> const& owner = nullptr);
+
+        // Memory-maps a package file.
+        static std::shared_ptr<ShaderPackage> MapFile(wchar_t const* path);
+
+        unsigned GetShaderCount() const;
+        WinString const& GetShaderName(unsigned index) const;
+
+        // Returns false if the package does not contain a shader with this name.
+        bool FindShader(HSTRING name, unsigned* index) const;
+
+        CachedShader GetShader(unsigned index) const;
+
+        ComPtr<SharedShaderState> CreateSharedShaderState(unsigned index) const;
+        ComPtr<PixelShaderEffect> CreatePixelShaderEffect(unsigned index) const;
+
+    private:
+        CachedShader LoadShader(unsigned index) const;
+    };
+
+}}}}}
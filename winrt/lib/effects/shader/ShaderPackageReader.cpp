@@ -0,0 +1,218 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+// This file deliberately does not use the precompiled header, as it must not
+// depend on anything beyond the C++ standard library.
+
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+
+#include "ShaderPackageReader.h"
+
+using namespace ShaderPackageFormat;
+
+
+static_assert(sizeof(char16_t) == 2, "Package strings are UTF-16");
+
+
+bool ShaderPackageReader::Open(uint8_t const* data, size_t size, ShaderPackageReader* result)
+{
+    ShaderPackageReader reader;
+
+    reader.m_data = data;
+    reader.m_size = size;
+
+    if (!reader.ReadShaderTable())
+    {
+        *result = ShaderPackageReader();
+        return false;
+    }
+
+    *result = std::move(reader);
+    return true;
+}
+
+
+ShaderPackageReader::ShaderPackageReader()
+    : m_data(nullptr)
+    , m_size(0)
+{
+}
+
+
+size_t ShaderPackageReader::GetShaderCount() const
+{
+    return m_shaders.size();
+}
+
+
+ShaderPackageReader::ShaderInfo const& ShaderPackageReader::GetShader(size_t index) const
+{
+    assert(index < m_shaders.size());
+
+    return m_shaders[index];
+}
+
+
+std::vector<ShaderPackageReader::VariableInfo> ShaderPackageReader::GetVariables(size_t index) const
+{
+    auto& shader = GetShader(index).Layout;
+
+    std::vector<VariableInfo> variables(shader.VariableCount);
+
+    for (uint32_t i = 0; i < shader.VariableCount; i++)
+    {
+        auto& variable = variables[i];
+
+        // The whole table was validated by Open, so these cannot fail.
+        bool succeeded = Read(shader.VariableTableOffset + i * static_cast<uint32_t>(sizeof(Variable)), &variable.Layout) &&
+                         ReadString(variable.Layout.NameOffset, variable.Layout.NameLength, &variable.Name);
+
+        assert(succeeded);
+        (void)succeeded;
+    }
+
+    return variables;
+}
+
+
+bool ShaderPackageReader::ReadShaderTable()
+{
+    // Offsets are 32 bit, so validated ranges can be added without overflow.
+    if (m_size > UINT32_MAX)
+        return false;
+
+    Header header;
+
+    if (!Read(0, &header))
+        return false;
+
+    if (header.Magic != Magic || header.Version != Version)
+        return false;
+
+    if (!ValidateRange(header.ShaderTableOffset, static_cast<uint64_t>(header.ShaderCount) * sizeof(Shader)))
+        return false;
+
+    m_shaders.resize(header.ShaderCount);
+
+    for (uint32_t i = 0; i < header.ShaderCount; i++)
+    {
+        auto& shader = m_shaders[i];
+
+        if (!Read(header.ShaderTableOffset + i * static_cast<uint32_t>(sizeof(Shader)), &shader.Layout) ||
+            !ValidateShader(shader.Layout) ||
+            !ReadString(shader.Layout.NameOffset, shader.Layout.NameLength, &shader.Name))
+        {
+            return false;
+        }
+
+        shader.Code = m_data + shader.Layout.CodeOffset;
+        shader.Constants = m_data + shader.Layout.ConstantsOffset;
+    }
+
+    return true;
+}
+
+
+template<typename T>
+bool ShaderPackageReader::Read(uint32_t offset, T* value) const
+{
+    if (!ValidateRange(offset, sizeof(T)))
+        return false;
+
+    // Copy out rather than casting, as packages loaded from memory need not be aligned.
+    memcpy(value, m_data + offset, sizeof(T));
+    return true;
+}
+
+
+bool ShaderPackageReader::ValidateRange(uint32_t offset, uint64_t size) const
+{
+    return offset <= m_size && size <= m_size - offset;
+}
+
+
+bool ShaderPackageReader::ReadString(uint32_t offset, uint32_t length, std::u16string* value) const
+{
+    if (!ValidateRange(offset, static_cast<uint64_t>(length) * sizeof(char16_t)))
+        return false;
+
+    value->resize(length);
+
+    if (length)
+    {
+        memcpy(&(*value)[0], m_data + offset, length * sizeof(char16_t));
+    }
+
+    return true;
+}
+
+
+static bool IsSupportedVariable(Variable const& variable)
+{
+    switch (variable.Class)
+    {
+    case Scalar:
+    case Vector:
+    case MatrixRows:
+    case MatrixColumns:
+        break;
+
+    default:
+        return false;
+    }
+
+    switch (variable.Type)
+    {
+    case Float:
+    case Int:
+    case Bool:
+        break;
+
+    default:
+        return false;
+    }
+
+    return variable.Rows >= 1 && variable.Rows <= 4 &&
+           variable.Columns >= 1 && variable.Columns <= 4;
+}
+
+
+bool ShaderPackageReader::ValidateShader(Shader const& shader) const
+{
+    if (!ValidateRange(shader.NameOffset, static_cast<uint64_t>(shader.NameLength) * sizeof(char16_t)) ||
+        !ValidateRange(shader.CodeOffset, shader.CodeSize) ||
+        !ValidateRange(shader.ConstantsOffset, shader.ConstantsSize) ||
+        !ValidateRange(shader.VariableTableOffset, static_cast<uint64_t>(shader.VariableCount) * sizeof(Variable)))
+    {
+        return false;
+    }
+
+    if (!shader.CodeSize || shader.InputCount > MaxInputCount)
+        return false;
+
+    for (uint32_t i = 0; i < shader.VariableCount; i++)
+    {
+        Variable variable;
+
+        if (!Read(shader.VariableTableOffset + i * static_cast<uint32_t>(sizeof(Variable)), &variable))
+            return false;
+
+        if (!ValidateRange(variable.NameOffset, static_cast<uint64_t>(variable.NameLength) * sizeof(char16_t)))
+            return false;
+
+        // Each component takes 4 bytes, and the variable must lie inside the constant buffer.
+        uint64_t componentCount = static_cast<uint64_t>(variable.Rows) * variable.Columns * std::max(variable.Elements, 1u);
+
+        if (!IsSupportedVariable(variable) ||
+            componentCount * 4 > variable.Size ||
+            static_cast<uint64_t>(variable.Offset) + variable.Size > shader.ConstantsSize)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,150 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// Binary layout of a shader package, as written by tools/shaderpackage.
+//
+// A package bundles compiled pixel shaders with the metadata that would otherwise
+// be obtained by hashing the shader code and using D3D reflection each time a
+// PixelShaderEffect is created. All values are little-endian, all offsets are
+// in bytes from the start of the package, and strings are UTF-16 without a
+// null terminator. This must be kept in sync with the tool.
+//
+// This file and ShaderPackageReader.cpp depend only on the C++ standard library,
+// so the parser can be built and tested on platforms without D3D or WinRT.
+// ShaderPackage checks that the enum values below match their D3D equivalents.
+//
+namespace ShaderPackageFormat
+{
+    const uint32_t Magic = 0x50533257;  // "W2SP"
+    const uint32_t Version = 1;
+
+    const uint32_t MaxInputCount = 8;
+
+    enum ShaderFlags : uint32_t
+    {
+        // SimpleInputs was computed by the tool. If this is not set, the
+        // shader has a linking function that must be reflected at load time.
+        HasLinkingInfo = 1,
+    };
+
+    // Values of D3D_SHADER_VARIABLE_CLASS that shader properties support.
+    enum VariableClass : uint32_t
+    {
+        Scalar = 0,
+        Vector = 1,
+        MatrixRows = 2,
+        MatrixColumns = 3,
+    };
+
+    // Values of D3D_SHADER_VARIABLE_TYPE that shader properties support.
+    enum VariableType : uint32_t
+    {
+        Bool = 1,
+        Int = 2,
+        Float = 3,
+    };
+
+    struct Header
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t ShaderCount;
+        uint32_t ShaderTableOffset;
+    };
+
+    struct Shader
+    {
+        uint8_t Hash[16];
+        uint32_t NameOffset;
+        uint32_t NameLength;
+        uint32_t CodeOffset;
+        uint32_t CodeSize;
+        uint32_t ConstantsOffset;
+        uint32_t ConstantsSize;
+        uint32_t VariableTableOffset;
+        uint32_t VariableCount;
+        uint32_t InputCount;
+        uint32_t InstructionCount;
+        uint32_t MinFeatureLevel;
+        uint32_t Flags;
+        uint32_t SimpleInputs;
+    };
+
+    struct Variable
+    {
+        uint32_t NameOffset;
+        uint32_t NameLength;
+        uint32_t Class;
+        uint32_t Type;
+        uint32_t Rows;
+        uint32_t Columns;
+        uint32_t Elements;
+        uint32_t Size;
+        uint32_t Offset;
+    };
+
+    static_assert(sizeof(Header) == 16, "ShaderPackageFormat::Header must match the tool");
+    static_assert(sizeof(Shader) == 68, "ShaderPackageFormat::Shader must match the tool");
+    static_assert(sizeof(Variable) == 36, "ShaderPackageFormat::Variable must match the tool");
+}
+
+
+//
+// Validates and decodes a shader package held in memory.
+//
+// Every offset and size in the package is checked when it is opened, so accessors
+// never read outside the data. Code and constants point into the package, which
+// the caller must keep alive for as long as the reader is used. Shader hashes are
+// returned as stored: checking them against the code is left to the caller.
+//
+class ShaderPackageReader
+{
+public:
+    struct VariableInfo
+    {
+        std::u16string Name;
+        ShaderPackageFormat::Variable Layout;
+    };
+
+    struct ShaderInfo
+    {
+        std::u16string Name;
+        ShaderPackageFormat::Shader Layout;
+        uint8_t const* Code;
+        uint8_t const* Constants;
+    };
+
+    // Returns false if the package is malformed, in which case *result is left empty.
+    static bool Open(uint8_t const* data, size_t size, ShaderPackageReader* result);
+
+    ShaderPackageReader();
+
+    size_t GetShaderCount() const;
+    ShaderInfo const& GetShader(size_t index) const;
+
+    // Variables are returned in package order. Names are not deduplicated or sorted.
+    std::vector<VariableInfo> GetVariables(size_t index) const;
+
+private:
+    uint8_t const* m_data;
+    size_t m_size;
+
+    std::vector<ShaderInfo> m_shaders;
+
+    bool ReadShaderTable();
+    bool ValidateRange(uint32_t offset, uint64_t size) const;
+    bool ReadString(uint32_t offset, uint32_t length, std::u16string* value) const;
+    bool ValidateShader(ShaderPackageFormat::Shader const& shader) const;
+
+    template<typename T>
+    bool Read(uint32_t offset, T* value) const;
+};
@@ -0,0 +1,154 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "ShaderRectMapping.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    // Larger than the distance between any two LONG coordinates, so expanding by this always
+    // clamps to INT_MIN/INT_MAX, and contracting by it always produces an inverted rect.
+    static const int64_t InfiniteExpansion = static_cast<int64_t>(1) << 32;
+
+
+    static LONG ExpandedEdge(LONG value, int64_t expansion)
+    {
+        auto sum = static_cast<int64_t>(value) + expansion;
+
+        return static_cast<LONG>(std::min<int64_t>(std::max<int64_t>(INT_MIN, sum), INT_MAX));
+    }
+
+
+    static D2D1_RECT_L ExpandedRect(D2D1_RECT_L const& rect, int64_t expansion)
+    {
+        return D2D1_RECT_L
+        {
+            ExpandedEdge(rect.left,   -expansion),
+            ExpandedEdge(rect.top,    -expansion),
+            ExpandedEdge(rect.right,   expansion),
+            ExpandedEdge(rect.bottom,  expansion),
+        };
+    }
+
+
+    ShaderRectMapping::ShaderRectMapping(CoordinateMappingState const& state, unsigned inputCount)
+        : m_inputCount(inputCount)
+        , m_maxOffset(state.MaxOffset)
+        , m_hasOutputContribution(false)
+    {
+        if (inputCount > MaxShaderInputs)
+            ThrowHR(E_INVALIDARG);
+
+        for (unsigned i = 0; i < inputCount; i++)
+        {
+            m_mapping[i] = state.Mapping[i];
+            m_borderMode[i] = state.BorderMode[i];
+
+            switch (m_mapping[i])
+            {
+            case SamplerCoordinateMapping::Unknown:
+                // Due to unknown coordinate mapping, we must request access to an infinite input area,
+                // and this input does not contribute to the output rectangle.
+                m_inputExpansion[i] = InfiniteExpansion;
+                m_outputExpansion[i] = -InfiniteExpansion;
+                break;
+
+            case SamplerCoordinateMapping::OneToOne:
+                // Rectangles map directly between this input and the output.
+                m_inputExpansion[i] = 0;
+                m_outputExpansion[i] = 0;
+                m_hasOutputContribution = true;
+                break;
+
+            case SamplerCoordinateMapping::Offset:
+                // Rectangles are expanded due to the use of offset texture coordinates.
+                // For hard borders, input rectangles pass through to the output unchanged.
+                m_inputExpansion[i] = m_maxOffset;
+                m_outputExpansion[i] = (m_borderMode[i] == EffectBorderMode::Hard) ? 0 : m_maxOffset;
+                m_hasOutputContribution = true;
+                break;
+
+            default:
+                ThrowHR(E_INVALIDARG);
+            }
+        }
+    }
+
+
+    void ShaderRectMapping::MapOutputRectToInputRects(D2D1_RECT_L const& outputRect, D2D1_RECT_L* inputRects) const
+    {
+        for (unsigned i = 0; i < m_inputCount; i++)
+        {
+            inputRects[i] = ExpandedRect(outputRect, m_inputExpansion[i]);
+        }
+    }
+
+
+    void ShaderRectMapping::MapOutputRectsToInputRects(D2D1_RECT_L const* outputRects, unsigned outputRectCount, D2D1_RECT_L* inputRects) const
+    {
+        for (unsigned i = 0; i < outputRectCount; i++)
+        {
+            MapOutputRectToInputRects(outputRects[i], inputRects + i * m_inputCount);
+        }
+    }
+
+
+    D2D1_RECT_L ShaderRectMapping::MapInputRectsToOutputRect(D2D1_RECT_L const* inputRects) const
+    {
+        ValidateOutputMapping();
+
+        if (!m_hasOutputContribution)
+            return D2D1_RECT_L{ INT_MIN, INT_MIN, INT_MAX, INT_MAX };
+
+        // Start from an empty rect, which non-contributing inputs (inverted by
+        // their negative infinite expansion) leave unchanged.
+        D2D1_RECT_L accumulatedRect = { INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+
+        for (unsigned i = 0; i < m_inputCount; i++)
+        {
+            auto rect = ExpandedRect(inputRects[i], m_outputExpansion[i]);
+
+            accumulatedRect.left   = std::min(accumulatedRect.left,   rect.left);
+            accumulatedRect.top    = std::min(accumulatedRect.top,    rect.top);
+            accumulatedRect.right  = std::max(accumulatedRect.right,  rect.right);
+            accumulatedRect.bottom = std::max(accumulatedRect.bottom, rect.bottom);
+        }
+
+        return accumulatedRect;
+    }
+
+
+    void ShaderRectMapping::ValidateOutputMapping() const
+    {
+        bool gotOffset = false;
+
+        for (unsigned i = 0; i < m_inputCount; i++)
+        {
+            if (m_mapping[i] != SamplerCoordinateMapping::Offset)
+                continue;
+
+            if (!m_maxOffset)
+            {
+                WinStringBuilder message;
+                message.Format(Strings::CustomEffectOffsetMappingWithoutMaxOffset, i + 1);
+                ThrowHR(E_INVALIDARG, message.Get());
+            }
+
+            if (m_borderMode[i] != EffectBorderMode::Soft &&
+                m_borderMode[i] != EffectBorderMode::Hard)
+            {
+                ThrowHR(E_INVALIDARG);
+            }
+
+            gotOffset = true;
+        }
+
+        // Validate that if MaxOffset is set, at least one input should be using SamplerCoordinateMapping::Offset.
+        if (m_maxOffset && !gotOffset)
+        {
+            ThrowHR(E_INVALIDARG, Strings::CustomEffectMaxOffsetWithoutOffsetMapping);
+        }
+    }
+
+}}}}}
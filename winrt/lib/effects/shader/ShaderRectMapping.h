@@ -0,0 +1,67 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "SharedShaderState.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
+{
+    //
+    // Maps rectangles between the inputs and output of a custom pixel shader,
+    // according to its CoordinateMappingState.
+    //
+    // The sampler coordinate mapping and border mode of every input are resolved
+    // up front into a single expansion amount per input, in each direction. An
+    // infinite region is represented as an expansion too large for any LONG
+    // coordinate, and an input that does not affect the output as a negative
+    // expansion of the same size. Mapping rectangles is then the same branch
+    // free clamp/min/max arithmetic for every input, which the compiler can
+    // vectorize, rather than a switch per input.
+    //
+    // This is used by PixelShaderTransform and ClipTransform, and can be reused
+    // to map many output tiles at once when splitting a draw into tiles.
+    //
+    class ShaderRectMapping
+    {
+        unsigned m_inputCount;
+        int m_maxOffset;
+
+        SamplerCoordinateMapping m_mapping[MaxShaderInputs];
+        EffectBorderMode m_borderMode[MaxShaderInputs];
+
+        // How far to expand an output rect to get the region of each input that it reads.
+        int64_t m_inputExpansion[MaxShaderInputs];
+
+        // How far to expand each input rect to get the region of the output that it affects.
+        int64_t m_outputExpansion[MaxShaderInputs];
+
+        bool m_hasOutputContribution;
+
+    public:
+        // Throws E_INVALIDARG if inputCount is greater than MaxShaderInputs, or if any of the
+        // first inputCount inputs has an invalid SamplerCoordinateMapping.
+        ShaderRectMapping(CoordinateMappingState const& state, unsigned inputCount);
+
+        unsigned GetInputCount() const { return m_inputCount; }
+
+        // Maps an output rect back to the region of each input that is needed to draw it.
+        // Writes GetInputCount() rects to inputRects.
+        void MapOutputRectToInputRects(D2D1_RECT_L const& outputRect, D2D1_RECT_L* inputRects) const;
+
+        // Batched version of MapOutputRectToInputRects, for mapping many output tiles at once.
+        // Writes outputRectCount * GetInputCount() rects to inputRects, grouped by output rect.
+        void MapOutputRectsToInputRects(D2D1_RECT_L const* outputRects, unsigned outputRectCount, D2D1_RECT_L* inputRects) const;
+
+        // Maps the bounds of each input forward to the region of the output that they can affect.
+        // Reads GetInputCount() rects from inputRects. Inputs with unknown coordinate mapping
+        // do not contribute; if no inputs contribute, the output is infinite. Throws E_INVALIDARG
+        // if the border modes or MaxOffset are inconsistent with the coordinate mappings.
+        D2D1_RECT_L MapInputRectsToOutputRect(D2D1_RECT_L const* inputRects) const;
+
+    private:
+        void ValidateOutputMapping() const;
+    };
+
+}}}}}
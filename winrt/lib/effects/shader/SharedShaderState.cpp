@@ -4,6 +4,7 @@
 
 #include "pch.h"
 #include "SharedShaderState.h"
+#include "ShaderCache.h"
 #include "utils/HashUtilities.h"
 
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace Effects
@@ -29,30 +30,88 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
 
     SharedShaderState::SharedShaderState(ShaderDescription const& shader, std::vector<BYTE> const& constants, CoordinateMappingState const& coordinateMapping, SourceInterpolationState const& sourceInterpolation)
+        : m_shader(std::make_shared<ShaderDescription>(shader))
+        , m_constants(std::make_shared<std::vector<BYTE>>(constants))
+        , m_constantsDirty(false)
+        , m_coordinateMapping(coordinateMapping)
+        , m_sourceInterpolation(sourceInterpolation)
+    { }
+
+
+    SharedShaderState::SharedShaderState(std::shared_ptr<ShaderDescription> const& shader, std::shared_ptr<std::vector<BYTE>> const& constants, CoordinateMappingState const& coordinateMapping, SourceInterpolationState const& sourceInterpolation)
         : m_shader(shader)
         , m_constants(constants)
+        , m_constantsDirty(false)
         , m_coordinateMapping(coordinateMapping)
         , m_sourceInterpolation(sourceInterpolation)
     { }
 
 
     SharedShaderState::SharedShaderState(BYTE* shaderCode, uint32_t shaderCodeSize)
+        : m_constantsDirty(false)
     {
-        // Store the shader program code.
-        m_shader.Code.assign(shaderCode, shaderCode + shaderCodeSize);
+        // Hash the shader program code to generate a unique ID.
+        auto hash = ComputeShaderHash(shaderCode, shaderCodeSize);
+
+        // If this shader has been used before, share the existing reflection results.
+        auto& cache = ShaderCache::Instance();
+
+        auto cachedShader = cache.Lookup(hash, shaderCode, shaderCodeSize);
+
+        if (!cachedShader.Shader)
+        {
+            m_shader = std::make_shared<ShaderDescription>();
+            m_constants = std::make_shared<std::vector<BYTE>>();
+
+            // Store the shader program code.
+            m_shader->Code.assign(shaderCode, shaderCode + shaderCodeSize);
+            m_shader->Hash = hash;
+
+            // Look up shader metadata.
+            ReflectOverShader();
+
+            cachedShader = cache.Insert(CachedShader{ m_shader, m_constants });
+        }
+
+        UseCachedShader(cachedShader);
+    }
+
 
-        // Hash it to generate a unique ID.
+    IID SharedShaderState::ComputeShaderHash(BYTE const* shaderCode, size_t shaderCodeSize)
+    {
         static const IID salt{ 0x489257f6, 0x6544, 0x4277, 0x89, 0x82, 0xea, 0xd1, 0x69, 0x39, 0x1f, 0x3d };
 
-        m_shader.Hash = GetVersion5Uuid(salt, shaderCode, shaderCodeSize);
+        return GetVersion5Uuid(salt, shaderCode, shaderCodeSize);
+    }
+
 
-        // Look up shader metadata.
-        ReflectOverShader();
+    SharedShaderState::SharedShaderState(CachedShader const& cachedShader)
+        : m_constantsDirty(false)
+    {
+        UseCachedShader(cachedShader);
+    }
+
+
+    void SharedShaderState::UseCachedShader(CachedShader const& cachedShader)
+    {
+        // The cached constant buffer holds default values, so we need our own copy to modify.
+        m_shader = cachedShader.Shader;
+        m_constants = std::make_shared<std::vector<BYTE>>(*cachedShader.Constants);
+
+        // Simple inputs (as determined by the shader linking function) default to passthrough coordinate mapping.
+        for (unsigned i = 0; i < MaxShaderInputs; i++)
+        {
+            if (m_shader->SimpleInputs & (1u << i))
+            {
+                m_coordinateMapping.Mapping[i] = SamplerCoordinateMapping::OneToOne;
+            }
+        }
     }
 
 
     ComPtr<ISharedShaderState> SharedShaderState::Clone()
     {
+        // The clone shares our shader description and constant buffer until one of us changes it.
         auto clone = Make<SharedShaderState>(m_shader, m_constants, m_coordinateMapping, m_sourceInterpolation);
         CheckMakeResult(clone);
 
@@ -62,13 +121,13 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
     unsigned SharedShaderState::GetPropertyCount()
     {
-        return static_cast<unsigned>(m_shader.Variables.size());
+        return static_cast<unsigned>(m_shader->Variables.size());
     }
 
 
     bool SharedShaderState::HasProperty(HSTRING name)
     {
-        return std::binary_search(m_shader.Variables.begin(), m_shader.Variables.end(), name, VariableNameComparison());
+        return std::binary_search(m_shader->Variables.begin(), m_shader->Variables.end(), name, VariableNameComparison());
     }
 
 
@@ -154,6 +213,66 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     {
         auto& variable = FindVariable(name);
 
+        SetProperty(variable, boxedValue);
+    }
+
+
+    void SharedShaderState::SetProperties(std::vector<StringObjectPair> const& values)
+    {
+        MapKeyComparison<WinString> comparison;
+
+        // Sort the new values by name, so they can all be resolved with one merge against
+        // our sorted variable list rather than a separate search for each. The sort is
+        // stable, so if a name is repeated the last value wins, as if set one at a time.
+        std::vector<StringObjectPair const*> sortedValues;
+
+        sortedValues.reserve(values.size());
+
+        for (auto& value : values)
+        {
+            sortedValues.push_back(&value);
+        }
+
+        std::stable_sort(sortedValues.begin(), sortedValues.end(),
+            [&](StringObjectPair const* value1, StringObjectPair const* value2)
+            {
+                return comparison(value1->first, value2->first);
+            });
+
+        // Holding a reference to the current constants makes the first write copy them,
+        // so if any value turns out to be invalid, we can put everything back as it was.
+        auto previousConstants = m_constants;
+        auto previousConstantsDirty = m_constantsDirty;
+
+        auto rollbackWarden = MakeScopeWarden([&]
+        {
+            m_constants = previousConstants;
+            m_constantsDirty = previousConstantsDirty;
+        });
+
+        auto variable = m_shader->Variables.begin();
+
+        for (auto value : sortedValues)
+        {
+            while (variable != m_shader->Variables.end() && comparison(variable->Name, value->first))
+            {
+                ++variable;
+            }
+
+            if (variable == m_shader->Variables.end() || comparison(value->first, variable->Name))
+            {
+                ThrowUnknownProperty(value->first);
+            }
+
+            SetProperty(*variable, value->second.Get());
+        }
+
+        rollbackWarden.Dismiss();
+    }
+
+
+    void SharedShaderState::SetProperty(ShaderVariable const& variable, IInspectable* boxedValue)
+    {
         switch (variable.Type)
         {
             case D3D_SVT_FLOAT:
@@ -210,9 +329,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     {
         std::vector<StringObjectPair> properties;
 
-        properties.reserve(m_shader.Variables.size());
+        properties.reserve(m_shader->Variables.size());
 
-        for (auto& variable : m_shader.Variables)
+        for (auto& variable : m_shader->Variables)
         {
             properties.emplace_back(variable.Name, GetProperty(variable));
         }
@@ -221,23 +340,57 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
+    unsigned SharedShaderState::GetPropertyHandle(HSTRING name)
+    {
+        auto& variable = FindVariable(name);
+
+        return static_cast<unsigned>(&variable - m_shader->Variables.data());
+    }
+
+
+    void SharedShaderState::SetPropertyByHandle(unsigned handle, float value)             { SetFloatsByHandle(handle, value); }
+    void SharedShaderState::SetPropertyByHandle(unsigned handle, Vector2 const& value)    { SetFloatsByHandle(handle, value); }
+    void SharedShaderState::SetPropertyByHandle(unsigned handle, Vector3 const& value)    { SetFloatsByHandle(handle, value); }
+    void SharedShaderState::SetPropertyByHandle(unsigned handle, Vector4 const& value)    { SetFloatsByHandle(handle, value); }
+    void SharedShaderState::SetPropertyByHandle(unsigned handle, Matrix3x2 const& value)  { SetFloatsByHandle(handle, value); }
+    void SharedShaderState::SetPropertyByHandle(unsigned handle, Matrix4x4 const& value)  { SetFloatsByHandle(handle, value); }
+
+
     ShaderVariable const& SharedShaderState::FindVariable(HSTRING name)
     {
         VariableNameComparison comparison;
 
-        auto it = std::lower_bound(m_shader.Variables.begin(), m_shader.Variables.end(), name, comparison);
+        auto it = std::lower_bound(m_shader->Variables.begin(), m_shader->Variables.end(), name, comparison);
 
-        if (it == m_shader.Variables.end() || comparison(name, *it))
+        if (it == m_shader->Variables.end() || comparison(name, *it))
         {
-            WinStringBuilder message;
-            message.Format(Strings::CustomEffectUnknownProperty, WindowsGetStringRawBuffer(name, nullptr));
-            ThrowHR(E_INVALIDARG, message.Get());
+            ThrowUnknownProperty(name);
         }
 
         return *it;
     }
 
 
+    void SharedShaderState::ThrowUnknownProperty(HSTRING name)
+    {
+        WinStringBuilder message;
+        message.Format(Strings::CustomEffectUnknownProperty, WindowsGetStringRawBuffer(name, nullptr));
+        ThrowHR(E_INVALIDARG, message.Get());
+    }
+
+
+    std::vector<BYTE>& SharedShaderState::MutableConstants()
+    {
+        // Copy on write, if our constant buffer is shared with a clone.
+        if (m_constants.use_count() > 1)
+        {
+            m_constants = std::make_shared<std::vector<BYTE>>(*m_constants);
+        }
+
+        return *m_constants;
+    }
+
+
     // For formatting error message strings.
     template<typename T> wchar_t const* PropertyTypeName() { static_assert(false, "missing specialization"); }
 
@@ -251,6 +404,36 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     template<> wchar_t const* PropertyTypeName<Matrix4x4>() { return L"Matrix4x4"; }
 
 
+    // Looks up which type SetProperty expects for a variable, matching the dispatch in SetProperty.
+    static wchar_t const* GetPropertyTypeName(ShaderVariable const& variable, bool* isArray)
+    {
+        *isArray = (variable.Elements != 0);
+
+        if (variable.Type == D3D_SVT_FLOAT)
+        {
+            if (variable.IsVector(2))       return PropertyTypeName<Vector2>();
+            if (variable.IsVector(3))       return PropertyTypeName<Vector3>();
+            if (variable.IsVector(4))       return PropertyTypeName<Vector4>();
+            if (variable.IsMatrix(3, 2))    return PropertyTypeName<Matrix3x2>();
+            if (variable.IsMatrix(4, 4))    return PropertyTypeName<Matrix4x4>();
+        }
+
+        // Everything else is boxed as individual components.
+        *isArray |= (variable.ComponentCount() > 1);
+
+        switch (variable.Type)
+        {
+        case D3D_SVT_FLOAT: return PropertyTypeName<float>();
+        case D3D_SVT_INT:   return PropertyTypeName<int>();
+        case D3D_SVT_BOOL:  return PropertyTypeName<bool>();
+
+        default:
+            assert(false);
+            return L"";
+        }
+    }
+
+
     // Types used in the following templates:
     //
     // For floats and ints:
@@ -349,7 +532,31 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     }
 
 
+    // Transfers a single float, vector, or matrix straight into the constant buffer.
+    template<typename TBoxed>
+    void SharedShaderState::SetFloatsByHandle(unsigned handle, TBoxed value)
+    {
+        if (handle >= m_shader->Variables.size())
+            ThrowHR(E_BOUNDS);
+
+        auto& variable = m_shader->Variables[handle];
+
+        bool isArray;
+        auto typeName = GetPropertyTypeName(variable, &isArray);
+
+        if (isArray || wcscmp(typeName, PropertyTypeName<TBoxed>()) != 0)
+        {
+            WinStringBuilder message;
+            message.Format(isArray ? Strings::CustomEffectWrongPropertyTypeArray : Strings::CustomEffectWrongPropertyType, static_cast<wchar_t const*>(variable.Name), typeName);
+            ThrowHR(E_INVALIDARG, message.Get());
+        }
+
+        CopyConstantData<CopyDirection::Write>(variable, reinterpret_cast<float*>(&value));
+    }
+
+
     // Templated helper responsible for transfering a single component value to or from the constant buffer.
+    // Returns true if a write changed the value.
     template<CopyDirection Direction, typename T>
     struct TransferValue
     { };
@@ -361,9 +568,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     {
         typedef T TConstant;
 
-        void operator() (T constantBuffer, T& value)
+        bool operator() (T constantBuffer, T& value)
         {
             value = constantBuffer;
+            return false;
         }
     };
 
@@ -374,9 +582,14 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     {
         typedef T TConstant;
 
-        void operator() (T& constantBuffer, T value)
+        bool operator() (T& constantBuffer, T value)
         {
+            // Bitwise comparison, so changes between eg. +0 and -0 are not lost.
+            if (memcmp(&constantBuffer, &value, sizeof(T)) == 0)
+                return false;
+
             constantBuffer = value;
+            return true;
         }
     };
 
@@ -387,9 +600,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     {
         typedef int TConstant;
 
-        void operator() (int constantBuffer, boolean& value)
+        bool operator() (int constantBuffer, boolean& value)
         {
             value = !!constantBuffer;
+            return false;
         }
     };
 
@@ -400,9 +614,15 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
     {
         typedef int TConstant;
 
-        void operator() (int& constantBuffer, boolean value)
+        bool operator() (int& constantBuffer, boolean value)
         {
-            constantBuffer = !!value;
+            int newValue = !!value;
+
+            if (constantBuffer == newValue)
+                return false;
+
+            constantBuffer = newValue;
+            return true;
         }
     };
 
@@ -420,10 +640,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         Transferer transferFunction;
 
         // Look up our region of the constant buffer.
-        auto constantBuffer = reinterpret_cast<Transferer::TConstant*>(m_constants.data() + variable.Offset);
+        auto constantBuffer = reinterpret_cast<Transferer::TConstant*>(m_constants->data() + variable.Offset);
 
         // Compute the size of a single array element.
         const unsigned componentsPerRegister = 4;
+        const unsigned componentSize = static_cast<unsigned>(sizeof(Transferer::TConstant));
 
         unsigned elementSize = ((variable.Class == D3D_SVC_MATRIX_COLUMNS) ? variable.Columns : variable.Rows) * componentsPerRegister;
 
@@ -453,7 +674,17 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                     }
 
                     // Read or write this component value.
-                    transferFunction(constantBuffer[constantIndex], values[valueIndex++]);
+                    auto component = constantBuffer[constantIndex];
+
+                    if (transferFunction(component, values[valueIndex++]))
+                    {
+                        // The value changed, so store it (making sure not to affect any clones
+                        // that share our buffer) and note that it needs passing on to D2D.
+                        constantBuffer = reinterpret_cast<Transferer::TConstant*>(MutableConstants().data() + variable.Offset);
+                        constantBuffer[constantIndex] = component;
+
+                        m_constantsDirty = true;
+                    }
                 }
             }
         }
@@ -465,7 +696,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         // Create the shader reflection interface.
         ComPtr<ID3D11ShaderReflection> reflector;
 
-        HRESULT hr = D3DReflect(m_shader.Code.data(), m_shader.Code.size(), IID_PPV_ARGS(&reflector));
+        HRESULT hr = D3DReflect(m_shader->Code.data(), m_shader->Code.size(), IID_PPV_ARGS(&reflector));
 
         if (FAILED(hr))
             ThrowHR(E_INVALIDARG, Strings::CustomEffectBadShader);
@@ -493,12 +724,12 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         }
 
         // Grab some other metadata.
-        m_shader.InstructionCount = desc.InstructionCount;
+        m_shader->InstructionCount = desc.InstructionCount;
 
-        ThrowIfFailed(reflector->GetMinFeatureLevel(&m_shader.MinFeatureLevel));
+        ThrowIfFailed(reflector->GetMinFeatureLevel(&m_shader->MinFeatureLevel));
 
         // If this shader was compiled to support shader linking, we can also determine which inputs are simple vs. complex.
-        ReflectOverShaderLinkingFunction();
+        m_shader->SimpleInputs = ReflectOverShaderLinkingFunction(m_shader->Code);
     }
 
 
@@ -516,7 +747,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
                     ThrowHR(E_INVALIDARG, Strings::CustomEffectTooManyTextures);
 
                 // Record how many input textures this shader uses.
-                m_shader.InputCount = std::max(m_shader.InputCount, inputDesc.BindPoint + 1);
+                m_shader->InputCount = std::max(m_shader->InputCount, inputDesc.BindPoint + 1);
                 break;
 
             case D3D_SIT_CBUFFER:
@@ -535,10 +766,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         ThrowIfFailed(constantBuffer->GetDesc(&desc));
 
         // Resize our constant buffer to match the shader.
-        m_constants.resize(desc.Size);
+        m_constants->resize(desc.Size);
 
         // Look up variable metadata.
-        m_shader.Variables.reserve(desc.Variables);
+        m_shader->Variables.reserve(desc.Variables);
 
         for (unsigned i = 0; i < desc.Variables; i++)
         {
@@ -546,7 +777,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         }
 
         // Sort the variables by name.
-        std::sort(m_shader.Variables.begin(), m_shader.Variables.end(), VariableNameComparison());
+        std::sort(m_shader->Variables.begin(), m_shader->Variables.end(), VariableNameComparison());
     }
 
 
@@ -652,7 +883,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         // This can only fail if the shader blob is corrupted.
         auto endOffset = desc.StartOffset + desc.Size;
 
-        if (endOffset > m_constants.size() || endOffset < desc.StartOffset)
+        if (endOffset > m_constants->size() || endOffset < desc.StartOffset)
         {
             ThrowHR(E_UNEXPECTED);
         }
@@ -660,36 +891,36 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         // Initialize our constant buffer with the default value of the variable.
         if (desc.DefaultValue)
         {
-            CopyDefaultValue(m_constants.data() + desc.StartOffset, desc, type);
+            CopyDefaultValue(m_constants->data() + desc.StartOffset, desc, type);
         }
 
         // Store metadata about this variable.
-        m_shader.Variables.emplace_back(desc, type);
+        m_shader->Variables.emplace_back(desc, type);
     }
 
 
-    void SharedShaderState::ReflectOverShaderLinkingFunction()
+    uint32_t SharedShaderState::ReflectOverShaderLinkingFunction(std::vector<BYTE> const& shaderCode)
     {
         // If this shader was compiled to support shader linking, we can get extra information
         // (telling us which inputs are simple vs. complex) from the shader linking function.
         
-        // It's valid to use shaders that don't support linking, so we return on failure rather than throwing.
+        // It's valid to use shaders that don't support linking, so we return no simple inputs on failure rather than throwing.
         ComPtr<ID3DBlob> privateData;
 
-        if (FAILED(D3DGetBlobPart(m_shader.Code.data(), m_shader.Code.size(), D3D_BLOB_PRIVATE_DATA, 0, &privateData)))
-            return;
+        if (FAILED(D3DGetBlobPart(shaderCode.data(), shaderCode.size(), D3D_BLOB_PRIVATE_DATA, 0, &privateData)))
+            return 0;
 
         ComPtr<ID3D11LibraryReflection> reflector;
 
         if (FAILED(D3DReflectLibrary(privateData->GetBufferPointer(), privateData->GetBufferSize(), IID_PPV_ARGS(&reflector))))
-            return;
+            return 0;
 
         D3D11_LIBRARY_DESC desc;
         reflector->GetDesc(&desc);
 
         // For shader linking there should be a single function entrypoint.
         if (desc.FunctionCount != 1)
-            return;
+            return 0;
 
         auto function = reflector->GetFunctionByIndex(0);
 
@@ -697,6 +928,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         ThrowIfFailed(function->GetDesc(&functionDesc));
 
         int inputCount = 0;
+        uint32_t simpleInputs = 0;
 
         for (int i = 0; i < functionDesc.FunctionParameterCount; i++)
         {
@@ -711,9 +943,16 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             else if (strstr(parameterDesc.SemanticName, "INPUT"))
             {
                 // INPUT semantic means a simple input, so select passthrough coordinate mapping mode.
-                m_coordinateMapping.Mapping[inputCount++] = SamplerCoordinateMapping::OneToOne;
+                if (inputCount < MaxShaderInputs)
+                {
+                    simpleInputs |= 1u << inputCount;
+                }
+
+                inputCount++;
             }
         }
+
+        return simpleInputs;
     }
 
 }}}}}
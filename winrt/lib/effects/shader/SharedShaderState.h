@@ -14,6 +14,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
     const int MaxShaderInputs = 8;
 
+    struct CachedShader;
+
 
     // Describes how this shader maps between its input images and output locations.
     struct CoordinateMappingState
@@ -53,6 +55,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
 
         virtual ShaderDescription const& Shader() = 0;
         virtual std::vector<BYTE> const& Constants() = 0;
+        virtual bool AreConstantsDirty() = 0;
+        virtual void ClearDirtyConstants() = 0;
         virtual CoordinateMappingState& CoordinateMapping() = 0;
         virtual SourceInterpolationState& SourceInterpolation() = 0;
 
@@ -61,26 +65,45 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         virtual bool HasProperty(HSTRING name) = 0;
         virtual ComPtr<IInspectable> GetProperty(HSTRING name) = 0;
         virtual void SetProperty(HSTRING name, IInspectable* boxedValue) = 0;
+        virtual void SetProperties(std::vector<StringObjectPair> const& values) = 0;
         virtual std::vector<StringObjectPair> EnumerateProperties() = 0;
+
+        // Handle based property accessors, which skip the name lookup and boxing. A handle
+        // is the index of the property in Shader().Variables, so remains valid for clones.
+        virtual unsigned GetPropertyHandle(HSTRING name) = 0;
+        virtual void SetPropertyByHandle(unsigned handle, float value) = 0;
+        virtual void SetPropertyByHandle(unsigned handle, Vector2 const& value) = 0;
+        virtual void SetPropertyByHandle(unsigned handle, Vector3 const& value) = 0;
+        virtual void SetPropertyByHandle(unsigned handle, Vector4 const& value) = 0;
+        virtual void SetPropertyByHandle(unsigned handle, Matrix3x2 const& value) = 0;
+        virtual void SetPropertyByHandle(unsigned handle, Matrix4x4 const& value) = 0;
     };
     
 
     class SharedShaderState : public RuntimeClass<RuntimeClassFlags<ClassicCom>, ISharedShaderState>
                             , private LifespanTracker<SharedShaderState>
     {
-        ShaderDescription m_shader;
-        std::vector<BYTE> m_constants;
+        // Clones share the shader description, which never changes after reflection, and
+        // the constant buffer, which is copied on write. A state is only ever modified or
+        // cloned by the PixelShaderEffect that owns it, while holding the effect lock.
+        std::shared_ptr<ShaderDescription> m_shader;
+        std::shared_ptr<std::vector<BYTE>> m_constants;
+        bool m_constantsDirty;
         CoordinateMappingState m_coordinateMapping;
         SourceInterpolationState m_sourceInterpolation;
 
     public:
         SharedShaderState(ShaderDescription const& shader, std::vector<BYTE> const& constants, CoordinateMappingState const& coordinateMapping, SourceInterpolationState const& sourceInterpolation);
+        SharedShaderState(std::shared_ptr<ShaderDescription> const& shader, std::shared_ptr<std::vector<BYTE>> const& constants, CoordinateMappingState const& coordinateMapping, SourceInterpolationState const& sourceInterpolation);
         SharedShaderState(BYTE* shaderCode, uint32_t shaderCodeSize);
+        SharedShaderState(CachedShader const& cachedShader);
 
         virtual ComPtr<ISharedShaderState> Clone() override;
 
-        virtual ShaderDescription const& Shader() override { return m_shader; }
-        virtual std::vector<BYTE> const& Constants() override { return m_constants; }
+        virtual ShaderDescription const& Shader() override { return *m_shader; }
+        virtual std::vector<BYTE> const& Constants() override { return *m_constants; }
+        virtual bool AreConstantsDirty() override { return m_constantsDirty; }
+        virtual void ClearDirtyConstants() override { m_constantsDirty = false; }
         virtual CoordinateMappingState& CoordinateMapping() override { return m_coordinateMapping; }
         virtual SourceInterpolationState& SourceInterpolation() { return m_sourceInterpolation; }
 
@@ -89,11 +112,33 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         virtual bool HasProperty(HSTRING name) override;
         virtual ComPtr<IInspectable> GetProperty(HSTRING name) override;
         virtual void SetProperty(HSTRING name, IInspectable* boxedValue) override;
+        virtual void SetProperties(std::vector<StringObjectPair> const& values) override;
         virtual std::vector<StringObjectPair> EnumerateProperties() override;
 
+        virtual unsigned GetPropertyHandle(HSTRING name) override;
+        virtual void SetPropertyByHandle(unsigned handle, float value) override;
+        virtual void SetPropertyByHandle(unsigned handle, Vector2 const& value) override;
+        virtual void SetPropertyByHandle(unsigned handle, Vector3 const& value) override;
+        virtual void SetPropertyByHandle(unsigned handle, Vector4 const& value) override;
+        virtual void SetPropertyByHandle(unsigned handle, Matrix3x2 const& value) override;
+        virtual void SetPropertyByHandle(unsigned handle, Matrix4x4 const& value) override;
+
+        // Returns the ShaderDescription::Hash that identifies this shader code.
+        static IID ComputeShaderHash(BYTE const* shaderCode, size_t shaderCodeSize);
+
+        // Returns a ShaderDescription::SimpleInputs bitmask, or zero if the shader does not support linking.
+        static uint32_t ReflectOverShaderLinkingFunction(std::vector<BYTE> const& shaderCode);
+
     private:
+        void UseCachedShader(CachedShader const& cachedShader);
+
         ComPtr<IInspectable> GetProperty(ShaderVariable const& variable);
+        void SetProperty(ShaderVariable const& variable, IInspectable* boxedValue);
+
         ShaderVariable const& FindVariable(HSTRING name);
+        static void ThrowUnknownProperty(HSTRING name);
+
+        std::vector<BYTE>& MutableConstants();
 
 
         // Transfer property values between constant buffer and boxed IInspectable formats.
@@ -106,13 +151,15 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         template<CopyDirection Direction, typename TComponent>
         void CopyConstantData(ShaderVariable const& variable, TComponent* values);
 
+        template<typename TBoxed>
+        void SetFloatsByHandle(unsigned handle, TBoxed value);
+
 
         // Shader reflection (done at init time).
         void ReflectOverShader();
         void ReflectOverBindings(ID3D11ShaderReflection* reflector, D3D11_SHADER_DESC const& desc);
         void ReflectOverConstantBuffer(ID3D11ShaderReflectionConstantBuffer* constantBuffer);
         void ReflectOverVariable(ID3D11ShaderReflectionVariable* variable);
-        void ReflectOverShaderLinkingFunction();
     };
 
 }}}}}
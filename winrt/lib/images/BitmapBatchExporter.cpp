@@ -0,0 +1,786 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "BitmapBatchExporter.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    static int64_t GetTimestamp()
+    {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return counter.QuadPart;
+    }
+
+
+    static std::exception_ptr MakeHResultExceptionPtr(HRESULT hr)
+    {
+        try
+        {
+            ThrowHR(hr);
+        }
+        catch (...)
+        {
+            return std::current_exception();
+        }
+    }
+
+
+    //
+    // Lets WIC read straight out of a mapped staging bitmap, converting to
+    // whatever pixel format the encoder wants as it goes.
+    //
+    class MappedPixelSource : public RuntimeClass<RuntimeClassFlags<ClassicCom>, IWICBitmapSource>
+        , private LifespanTracker<MappedPixelSource>
+    {
+        BYTE const* m_pixels;
+        UINT m_stride;
+        D2D1_SIZE_U m_size;
+        UINT m_bytesPerPixel;
+        GUID m_format;
+        double m_dpi;
+
+    public:
+        MappedPixelSource(BYTE const* pixels, UINT stride, D2D1_SIZE_U size, UINT bytesPerPixel, GUID const& format, double dpi)
+            : m_pixels(pixels)
+            , m_stride(stride)
+            , m_size(size)
+            , m_bytesPerPixel(bytesPerPixel)
+            , m_format(format)
+            , m_dpi(dpi)
+        {
+        }
+
+        IFACEMETHODIMP GetSize(UINT* width, UINT* height) override
+        {
+            if (!width || !height)
+                return E_INVALIDARG;
+
+            *width = m_size.width;
+            *height = m_size.height;
+            return S_OK;
+        }
+
+        IFACEMETHODIMP GetPixelFormat(WICPixelFormatGUID* format) override
+        {
+            if (!format)
+                return E_INVALIDARG;
+
+            *format = m_format;
+            return S_OK;
+        }
+
+        IFACEMETHODIMP GetResolution(double* dpiX, double* dpiY) override
+        {
+            if (!dpiX || !dpiY)
+                return E_INVALIDARG;
+
+            *dpiX = m_dpi;
+            *dpiY = m_dpi;
+            return S_OK;
+        }
+
+        IFACEMETHODIMP CopyPalette(IWICPalette*) override
+        {
+            return WINCODEC_ERR_PALETTEUNAVAILABLE;
+        }
+
+        IFACEMETHODIMP CopyPixels(WICRect const* rect, UINT stride, UINT bufferSize, BYTE* buffer) override
+        {
+            WICRect wholeBitmap{ 0, 0, static_cast<INT>(m_size.width), static_cast<INT>(m_size.height) };
+
+            if (!rect)
+                rect = &wholeBitmap;
+
+            if (rect->X < 0 || rect->Y < 0 || rect->Width < 0 || rect->Height < 0 ||
+                static_cast<uint64_t>(rect->X) + rect->Width > m_size.width ||
+                static_cast<uint64_t>(rect->Y) + rect->Height > m_size.height)
+            {
+                return E_INVALIDARG;
+            }
+
+            if (rect->Width == 0 || rect->Height == 0)
+                return S_OK;
+
+            auto bytesPerRow = static_cast<uint64_t>(rect->Width) * m_bytesPerPixel;
+
+            if (!buffer || stride < bytesPerRow || bufferSize < (rect->Height - 1) * static_cast<uint64_t>(stride) + bytesPerRow)
+                return E_INVALIDARG;
+
+            auto source = m_pixels + rect->Y * static_cast<size_t>(m_stride) + rect->X * m_bytesPerPixel;
+
+            for (INT y = 0; y < rect->Height; y++)
+            {
+                memcpy(buffer, source, static_cast<size_t>(bytesPerRow));
+
+                buffer += stride;
+                source += m_stride;
+            }
+
+            return S_OK;
+        }
+    };
+
+
+    BitmapBatchExporter::BitmapBatchExporter(Options const& options)
+        : m_isShuttingDown(false)
+        , m_encodingCount(0)
+        , m_statistics{}
+        , m_firstExportTicks(0)
+        , m_lastCompletionTicks(0)
+        , m_readbackWaitTicks(0)
+        , m_encodeTicks(0)
+    {
+        auto workerCount = options.MaximumConcurrency ? options.MaximumConcurrency : std::max(std::thread::hardware_concurrency(), 1U);
+
+        m_maximumQueued = options.MaximumQueuedBitmaps ? options.MaximumQueuedBitmaps : workerCount * 2;
+
+        try
+        {
+            for (uint32_t i = 0; i < workerCount; i++)
+            {
+                m_workers.emplace_back([this] { WorkerThread(); });
+            }
+        }
+        catch (...)
+        {
+            // Stop any workers that did start.
+            {
+                Lock lock(m_mutex);
+                m_isShuttingDown = true;
+            }
+
+            m_workAvailable.notify_all();
+
+            for (auto& worker : m_workers)
+            {
+                worker.join();
+            }
+
+            throw;
+        }
+    }
+
+
+    BitmapBatchExporter::~BitmapBatchExporter()
+    {
+        {
+            Lock lock(m_mutex);
+            m_isShuttingDown = true;
+        }
+
+        m_workAvailable.notify_all();
+        m_queueChanged.notify_all();
+
+        // Workers finish the bitmap they are encoding, but take no more.
+        for (auto& worker : m_workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+
+        m_workers.clear();
+
+        while (!m_queue.empty())
+        {
+            auto& pendingExport = m_queue.front();
+            auto error = MakeHResultExceptionPtr(E_ABORT);
+
+            pendingExport->Result.set_exception(error);
+
+            if (pendingExport->Completed)
+                pendingExport->Completed(error);
+
+            m_queue.pop();
+        }
+    }
+
+
+    std::future<void> BitmapBatchExporter::Export(ICanvasBitmap* bitmap, HSTRING fileName, CanvasBitmapFileFormat fileFormat, float quality, CompletedFunction const& completed)
+    {
+        CheckInPointer(bitmap);
+
+        auto pendingExport = std::make_unique<PendingExport>();
+        pendingExport->FileName = WinString(fileName);
+        pendingExport->Quality = quality;
+        pendingExport->Completed = completed;
+
+        if (fileFormat == CanvasBitmapFileFormat::Auto)
+            pendingExport->ContainerFormat = GetEncoderFromFileExtension(pendingExport->FileName);
+        else
+            pendingExport->ContainerFormat = GetGUIDForFileFormat(fileFormat);
+
+        return Enqueue(bitmap, std::move(pendingExport));
+    }
+
+
+    std::future<void> BitmapBatchExporter::Export(ICanvasBitmap* bitmap, IStream* stream, CanvasBitmapFileFormat fileFormat, float quality, CompletedFunction const& completed)
+    {
+        CheckInPointer(bitmap);
+        CheckInPointer(stream);
+
+        if (fileFormat == CanvasBitmapFileFormat::Auto)
+            ThrowHR(E_INVALIDARG, Strings::AutoFileFormatNotAllowed);
+
+        auto pendingExport = std::make_unique<PendingExport>();
+        pendingExport->Stream = stream;
+        pendingExport->Quality = quality;
+        pendingExport->Completed = completed;
+        pendingExport->ContainerFormat = GetGUIDForFileFormat(fileFormat);
+
+        return Enqueue(bitmap, std::move(pendingExport));
+    }
+
+
+    std::future<void> BitmapBatchExporter::Enqueue(ICanvasBitmap* bitmap, std::unique_ptr<PendingExport> pendingExport)
+    {
+        if (pendingExport->Quality < 0.0f || pendingExport->Quality > 1.0f)
+            ThrowHR(E_INVALIDARG);
+
+        auto& d2dBitmap = As<ICanvasBitmapInternal>(bitmap)->GetD2DBitmap();
+
+        pendingExport->Device = GetCanvasDevice(As<ICanvasResourceCreator>(bitmap).Get());
+        pendingExport->Size = d2dBitmap->GetPixelSize();
+        pendingExport->PixelFormat = d2dBitmap->GetPixelFormat();
+
+        // Formats that WIC can't describe, such as A8 or block compressed, can still be saved one at a time with SaveAsync.
+        if (GetWicPixelFormat(pendingExport->PixelFormat) == GUID_NULL)
+            ThrowHR(E_INVALIDARG);
+
+        float dpiY;
+        d2dBitmap->GetDpi(&pendingExport->Dpi, &dpiY);
+
+        auto result = pendingExport->Result.get_future();
+
+        {
+            Lock lock(m_mutex);
+
+            // Each queued export holds a staging bitmap, so wait for room before starting another copy.
+            m_queueChanged.wait(lock, [&] { return m_isShuttingDown || m_queue.size() < m_maximumQueued; });
+
+            if (m_isShuttingDown)
+                ThrowHR(E_ABORT);
+
+            // Start the GPU copy, but don't wait for it. Workers map the
+            // staging bitmap when they get to it, by which time the copy has
+            // normally finished.
+            pendingExport->StagingBitmap = ScopedBitmapMappedPixelAccess::CopyToStagingBitmap(pendingExport->Device.Get(), d2dBitmap.Get());
+
+            if (m_firstExportTicks == 0)
+                m_firstExportTicks = GetTimestamp();
+
+            m_queue.push(std::move(pendingExport));
+        }
+
+        m_workAvailable.notify_one();
+
+        return result;
+    }
+
+
+    void BitmapBatchExporter::WaitForAll()
+    {
+        Lock lock(m_mutex);
+
+        m_queueChanged.wait(lock, [&] { return m_queue.empty() && m_encodingCount == 0; });
+    }
+
+
+    bool BitmapBatchExporter::IsWorkerThread() const
+    {
+        auto currentThread = std::this_thread::get_id();
+
+        return std::any_of(m_workers.begin(), m_workers.end(), [&] (std::thread const& worker) { return worker.get_id() == currentThread; });
+    }
+
+
+    BitmapBatchExporterStatistics BitmapBatchExporter::GetStatistics()
+    {
+        Lock lock(m_mutex);
+
+        auto statistics = m_statistics;
+
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+
+        auto toSeconds = [&](int64_t ticks) { return static_cast<double>(ticks) / frequency.QuadPart; };
+
+        statistics.ElapsedSeconds = (m_lastCompletionTicks > m_firstExportTicks) ? toSeconds(m_lastCompletionTicks - m_firstExportTicks) : 0;
+        statistics.ReadbackWaitSeconds = toSeconds(m_readbackWaitTicks);
+        statistics.EncodeSeconds = toSeconds(m_encodeTicks);
+
+        if (statistics.ElapsedSeconds > 0)
+        {
+            statistics.BitmapsPerSecond = statistics.BitmapsExported / statistics.ElapsedSeconds;
+            statistics.PixelsPerSecond = statistics.PixelsExported / statistics.ElapsedSeconds;
+        }
+
+        return statistics;
+    }
+
+
+    GUID BitmapBatchExporter::GetWicPixelFormat(D2D1_PIXEL_FORMAT const& format)
+    {
+        bool premultiplied = (format.alphaMode == D2D1_ALPHA_MODE_PREMULTIPLIED);
+        bool ignoreAlpha = (format.alphaMode == D2D1_ALPHA_MODE_IGNORE);
+
+        switch (format.format)
+        {
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+            return premultiplied ? GUID_WICPixelFormat32bppPBGRA :
+                   ignoreAlpha   ? GUID_WICPixelFormat32bppBGR :
+                                   GUID_WICPixelFormat32bppBGRA;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+            return premultiplied ? GUID_WICPixelFormat32bppPRGBA :
+                   ignoreAlpha   ? GUID_WICPixelFormat32bppRGB :
+                                   GUID_WICPixelFormat32bppRGBA;
+
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+            return premultiplied ? GUID_WICPixelFormat64bppPRGBA : GUID_WICPixelFormat64bppRGBA;
+
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            return premultiplied ? GUID_WICPixelFormat64bppPRGBAHalf : GUID_WICPixelFormat64bppRGBAHalf;
+
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return premultiplied ? GUID_WICPixelFormat128bppPRGBAFloat : GUID_WICPixelFormat128bppRGBAFloat;
+
+        default:
+            return GUID_NULL;
+        }
+    }
+
+
+    void BitmapBatchExporter::WorkerThread()
+    {
+        Wrappers::RoInitializeWrapper initialize(RO_INIT_MULTITHREADED);
+
+        // Held for the lifetime of the worker, rather than looked up for every
+        // bitmap. WIC encoders themselves can only be initialized once, so
+        // each bitmap still needs its own.
+        auto wicAdapter = WicAdapter::GetInstance();
+        ComPtr<IWICImagingFactory2> factory = wicAdapter->GetFactory();
+
+        Lock lock(m_mutex);
+
+        for (;;)
+        {
+            m_workAvailable.wait(lock, [&] { return m_isShuttingDown || !m_queue.empty(); });
+
+            if (m_isShuttingDown)
+                return;
+
+            auto pendingExport = std::move(m_queue.front());
+            m_queue.pop();
+            m_encodingCount++;
+
+            lock.unlock();
+
+            // There's now room for another export.
+            m_queueChanged.notify_all();
+
+            int64_t readbackWaitTicks = 0;
+            int64_t encodeTicks = 0;
+            std::exception_ptr error;
+
+            try
+            {
+                auto startTicks = GetTimestamp();
+
+                // This waits for the GPU copy, if it hasn't finished yet.
+                ScopedBitmapMappedPixelAccess pixels(pendingExport->Device.Get(), std::move(pendingExport->StagingBitmap), pendingExport->Size.height);
+
+                auto mappedTicks = GetTimestamp();
+                readbackWaitTicks = mappedTicks - startTicks;
+
+                Encode(factory.Get(), *pendingExport, pixels);
+
+                encodeTicks = GetTimestamp() - mappedTicks;
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            auto pixelCount = static_cast<uint64_t>(pendingExport->Size.width) * pendingExport->Size.height;
+            auto result = std::move(pendingExport->Result);
+            auto completed = std::move(pendingExport->Completed);
+
+            // Release the device and destination before taking the lock.
+            pendingExport.reset();
+
+            lock.lock();
+
+            if (error)
+            {
+                m_statistics.BitmapsFailed++;
+            }
+            else
+            {
+                m_statistics.BitmapsExported++;
+                m_statistics.PixelsExported += pixelCount;
+            }
+
+            m_readbackWaitTicks += readbackWaitTicks;
+            m_encodeTicks += encodeTicks;
+            m_lastCompletionTicks = GetTimestamp();
+            m_encodingCount--;
+
+            // The statistics already include this export by the time its future is ready.
+            if (error)
+                result.set_exception(error);
+            else
+                result.set_value();
+
+            m_queueChanged.notify_all();
+
+            if (completed)
+            {
+                lock.unlock();
+                completed(error);
+                lock.lock();
+            }
+        }
+    }
+
+
+    void BitmapBatchExporter::Encode(IWICImagingFactory2* factory, PendingExport& pendingExport, ScopedBitmapMappedPixelAccess const& pixels)
+    {
+        auto stream = pendingExport.Stream;
+
+        if (!stream)
+        {
+            ComPtr<IWICStream> wicStream;
+            ThrowIfFailed(factory->CreateStream(&wicStream));
+            ThrowIfFailed(wicStream->InitializeFromFilename(static_cast<wchar_t const*>(pendingExport.FileName), GENERIC_WRITE));
+
+            stream = wicStream;
+        }
+
+        ComPtr<IWICBitmapEncoder> encoder;
+        ThrowIfFailed(factory->CreateEncoder(pendingExport.ContainerFormat, nullptr, &encoder));
+        ThrowIfFailed(encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache));
+
+        ComPtr<IWICBitmapFrameEncode> frame;
+        ComPtr<IPropertyBag2> frameProperties;
+        ThrowIfFailed(encoder->CreateNewFrame(&frame, &frameProperties));
+
+        bool supportsQuality =
+            pendingExport.ContainerFormat == GUID_ContainerFormatJpeg ||
+            pendingExport.ContainerFormat == GUID_ContainerFormatWmp;
+
+        if (supportsQuality)
+        {
+            PROPBAG2 option{};
+            option.pstrName = L"ImageQuality";
+            VARIANT value{};
+            value.vt = VT_R4;
+            value.fltVal = pendingExport.Quality;
+            ThrowIfFailed(frameProperties->Write(1, &option, &value));
+        }
+
+        ThrowIfFailed(frame->Initialize(frameProperties.Get()));
+        ThrowIfFailed(frame->SetSize(pendingExport.Size.width, pendingExport.Size.height));
+        ThrowIfFailed(frame->SetResolution(pendingExport.Dpi, pendingExport.Dpi));
+
+        auto dxgiFormat = pendingExport.PixelFormat.format;
+        auto bytesPerPixel = GetBytesPerBlock(dxgiFormat);
+
+        // Like SaveAsync, extended range formats keep their precision if the
+        // file format supports it, and everything else is saved as 8 bit BGRA.
+        WICPixelFormatGUID frameFormat = GUID_WICPixelFormat32bppBGRA;
+
+        if (FileFormatSupportsHdr(pendingExport.ContainerFormat) && bytesPerPixel > 4)
+            frameFormat = GetWicPixelFormat(D2D1::PixelFormat(dxgiFormat, D2D1_ALPHA_MODE_STRAIGHT));
+
+        // The encoder may pick the closest format it supports instead, which WriteSource converts to.
+        ThrowIfFailed(frame->SetPixelFormat(&frameFormat));
+
+        auto source = Make<MappedPixelSource>(
+            pixels.GetLockedData(),
+            pixels.GetStride(),
+            pendingExport.Size,
+            bytesPerPixel,
+            GetWicPixelFormat(pendingExport.PixelFormat),
+            pendingExport.Dpi);
+        CheckMakeResult(source);
+
+        ThrowIfFailed(frame->WriteSource(source.Get(), nullptr));
+
+        ThrowIfFailed(frame->Commit());
+        ThrowIfFailed(encoder->Commit());
+    }
+
+
+    //
+    // BitmapBatchExportAction
+    //
+
+    BitmapBatchExportAction::BitmapBatchExportAction()
+    {
+        ThrowIfFailed(Start());
+    }
+
+
+    void BitmapBatchExportAction::SetResult(std::exception_ptr const& error)
+    {
+        if (error)
+        {
+            HRESULT hr = ExceptionBoundary([&] { std::rethrow_exception(error); });
+
+            (void)TryTransitionToError(hr);
+        }
+        else
+        {
+            (void)TryTransitionToCompleted();
+        }
+
+        // If the action was cancelled, this reports that instead.
+        (void)FireCompletion();
+    }
+
+
+    IFACEMETHODIMP BitmapBatchExportAction::put_Completed(IAsyncActionCompletedHandler* handler)
+    {
+        return PutOnComplete(handler);
+    }
+
+
+    IFACEMETHODIMP BitmapBatchExportAction::get_Completed(IAsyncActionCompletedHandler** handler)
+    {
+        return GetOnComplete(handler);
+    }
+
+
+    IFACEMETHODIMP BitmapBatchExportAction::GetResults()
+    {
+        return CheckValidStateForResultsCall();
+    }
+
+
+    HRESULT BitmapBatchExportAction::OnStart()
+    {
+        return S_OK;
+    }
+
+
+    void BitmapBatchExportAction::OnCancel()
+    {
+    }
+
+
+    void BitmapBatchExportAction::OnClose()
+    {
+    }
+
+
+    //
+    // CanvasBitmapBatchExporterFactory
+    //
+
+    ActivatableClassWithFactory(CanvasBitmapBatchExporter, CanvasBitmapBatchExporterFactory);
+
+
+    IFACEMETHODIMP CanvasBitmapBatchExporterFactory::ActivateInstance(IInspectable** instance)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckAndClearOutPointer(instance);
+
+                auto exporter = Make<CanvasBitmapBatchExporter>(BitmapBatchExporter::Options());
+                CheckMakeResult(exporter);
+
+                ThrowIfFailed(exporter.CopyTo(instance));
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchExporterFactory::CreateWithOptions(
+        int32_t maximumConcurrency,
+        int32_t maximumQueuedBitmaps,
+        ICanvasBitmapBatchExporter** exporter)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckAndClearOutPointer(exporter);
+
+                if (maximumConcurrency < 0 || maximumQueuedBitmaps < 0)
+                    ThrowHR(E_INVALIDARG);
+
+                BitmapBatchExporter::Options options;
+                options.MaximumConcurrency = static_cast<uint32_t>(maximumConcurrency);
+                options.MaximumQueuedBitmaps = static_cast<uint32_t>(maximumQueuedBitmaps);
+
+                auto batchExporter = Make<CanvasBitmapBatchExporter>(options);
+                CheckMakeResult(batchExporter);
+
+                ThrowIfFailed(batchExporter.CopyTo(exporter));
+            });
+    }
+
+
+    //
+    // CanvasBitmapBatchExporter
+    //
+
+    CanvasBitmapBatchExporter::CanvasBitmapBatchExporter(BitmapBatchExporter::Options const& options)
+        : m_exporter(std::make_shared<BitmapBatchExporter>(options))
+    {
+    }
+
+
+    CanvasBitmapBatchExporter::~CanvasBitmapBatchExporter()
+    {
+        (void)Close();
+    }
+
+
+    std::shared_ptr<BitmapBatchExporter> CanvasBitmapBatchExporter::GetExporter()
+    {
+        Lock lock(m_mutex);
+
+        if (!m_exporter)
+            ThrowHR(RO_E_CLOSED);
+
+        return m_exporter;
+    }
+
+
+    template<typename DESTINATION>
+    void CanvasBitmapBatchExporter::Save(ICanvasBitmap* bitmap, DESTINATION destination, CanvasBitmapFileFormat fileFormat, float quality, IAsyncAction** asyncAction)
+    {
+        CheckInPointer(bitmap);
+        CheckAndClearOutPointer(asyncAction);
+
+        auto exporter = GetExporter();
+
+        auto action = Make<BitmapBatchExportAction>();
+        CheckMakeResult(action);
+
+        // The export keeps the action alive until it completes. This blocks
+        // while the exporter already has as many bitmaps queued as it allows.
+        (void)exporter->Export(bitmap, destination, fileFormat, quality,
+            [action] (std::exception_ptr const& error)
+            {
+                action->SetResult(error);
+            });
+
+        ThrowIfFailed(action.CopyTo(asyncAction));
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchExporter::SaveToFileAsync(
+        ICanvasBitmap* bitmap,
+        HSTRING fileName,
+        IAsyncAction** asyncAction)
+    {
+        return SaveToFileWithBitmapFileFormatAsync(bitmap, fileName, CanvasBitmapFileFormat::Auto, asyncAction);
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchExporter::SaveToFileWithBitmapFileFormatAsync(
+        ICanvasBitmap* bitmap,
+        HSTRING fileName,
+        CanvasBitmapFileFormat fileFormat,
+        IAsyncAction** asyncAction)
+    {
+        return SaveToFileWithBitmapFileFormatAndQualityAsync(bitmap, fileName, fileFormat, 0.9f, asyncAction);
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchExporter::SaveToFileWithBitmapFileFormatAndQualityAsync(
+        ICanvasBitmap* bitmap,
+        HSTRING fileName,
+        CanvasBitmapFileFormat fileFormat,
+        float quality,
+        IAsyncAction** asyncAction)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                Save(bitmap, fileName, fileFormat, quality, asyncAction);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchExporter::SaveToStreamAsync(
+        ICanvasBitmap* bitmap,
+        IRandomAccessStream* stream,
+        CanvasBitmapFileFormat fileFormat,
+        IAsyncAction** asyncAction)
+    {
+        return SaveToStreamWithQualityAsync(bitmap, stream, fileFormat, 0.9f, asyncAction);
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchExporter::SaveToStreamWithQualityAsync(
+        ICanvasBitmap* bitmap,
+        IRandomAccessStream* stream,
+        CanvasBitmapFileFormat fileFormat,
+        float quality,
+        IAsyncAction** asyncAction)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(stream);
+
+                ComPtr<IStream> nativeStream;
+                ThrowIfFailed(CreateStreamOverRandomAccessStream(stream, IID_PPV_ARGS(&nativeStream)));
+
+                Save(bitmap, nativeStream.Get(), fileFormat, quality, asyncAction);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchExporter::get_Statistics(CanvasBitmapBatchExporterStatistics* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                auto statistics = GetExporter()->GetStatistics();
+
+                value->BitmapsExported = statistics.BitmapsExported;
+                value->BitmapsFailed = statistics.BitmapsFailed;
+                value->PixelsExported = statistics.PixelsExported;
+                value->ElapsedSeconds = statistics.ElapsedSeconds;
+                value->ReadbackWaitSeconds = statistics.ReadbackWaitSeconds;
+                value->EncodeSeconds = statistics.EncodeSeconds;
+                value->BitmapsPerSecond = statistics.BitmapsPerSecond;
+                value->PixelsPerSecond = statistics.PixelsPerSecond;
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchExporter::Close()
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                std::shared_ptr<BitmapBatchExporter> exporter;
+
+                {
+                    Lock lock(m_mutex);
+                    std::swap(exporter, m_exporter);
+                }
+
+                // Destroying the exporter joins its workers, which cannot
+                // happen on one of them, as it would if the last reference
+                // to this object were released from a completion handler.
+                if (exporter && exporter->IsWorkerThread())
+                {
+                    auto holder = std::make_shared<std::shared_ptr<BitmapBatchExporter>>(std::move(exporter));
+
+                    auto destroyExporter = Make<AsyncAction>([holder] { holder->reset(); });
+                    CheckMakeResult(destroyExporter);
+                }
+            });
+    }
+
+}}}}
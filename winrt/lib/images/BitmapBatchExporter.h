@@ -0,0 +1,241 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "utils/LockUtilities.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    struct BitmapBatchExporterStatistics
+    {
+        uint64_t BitmapsExported;
+        uint64_t BitmapsFailed;
+        uint64_t PixelsExported;
+
+        // From the first export to the most recent one finishing.
+        double ElapsedSeconds;
+
+        // Summed over all workers. Time spent waiting for readbacks means
+        // the GPU, rather than encoding, is the bottleneck.
+        double ReadbackWaitSeconds;
+        double EncodeSeconds;
+
+        double BitmapsPerSecond;
+        double PixelsPerSecond;
+    };
+
+
+    //
+    // Saves many bitmaps at once, for example the tiles of a large export.
+    //
+    // CanvasBitmap.SaveAsync renders each bitmap through a WIC image encoder
+    // on the calling thread, which reads the pixels back from the GPU and
+    // then encodes them, with nothing overlapping. This exporter instead
+    // starts copying each bitmap into a staging bitmap as soon as it is
+    // queued, and encodes from the mapped staging bitmap on a fixed number of
+    // worker threads. So the GPU copies out the next bitmaps while earlier
+    // ones are being encoded.
+    //
+    // Every queued bitmap holds a staging bitmap until it has been encoded,
+    // so Export blocks once MaximumQueuedBitmaps are waiting. The future of
+    // an export reports any error from encoding it. Exports still queued
+    // when the exporter is destroyed report E_ABORT.
+    //
+    // Instead of waiting on the future, an export can also be given a
+    // function to call when it finishes, with a null error if it succeeded.
+    // This is called on a worker thread, without the exporter's lock held,
+    // and must not throw.
+    //
+    class BitmapBatchExporter : private LifespanTracker<BitmapBatchExporter>
+    {
+    public:
+        typedef std::function<void(std::exception_ptr const& error)> CompletedFunction;
+
+        struct Options
+        {
+            // Zero means one worker per core.
+            uint32_t MaximumConcurrency;
+
+            // Zero means two per worker.
+            uint32_t MaximumQueuedBitmaps;
+
+            Options()
+                : MaximumConcurrency(0)
+                , MaximumQueuedBitmaps(0)
+            {
+            }
+        };
+
+    private:
+        struct PendingExport
+        {
+            // The device owns the pool that the staging bitmap is returned to, so must outlive the lease.
+            ComPtr<ICanvasDevice> Device;
+            StagingBitmapLease StagingBitmap;
+
+            D2D1_SIZE_U Size;
+            D2D1_PIXEL_FORMAT PixelFormat;
+            float Dpi;
+
+            // Exactly one of these is the destination.
+            WinString FileName;
+            ComPtr<IStream> Stream;
+
+            GUID ContainerFormat;
+            float Quality;
+
+            std::promise<void> Result;
+            CompletedFunction Completed;
+        };
+
+        std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_queueChanged;
+        bool m_isShuttingDown;
+
+        uint32_t m_maximumQueued;
+        std::queue<std::unique_ptr<PendingExport>> m_queue;
+        uint32_t m_encodingCount;
+
+        BitmapBatchExporterStatistics m_statistics;
+        int64_t m_firstExportTicks;
+        int64_t m_lastCompletionTicks;
+        int64_t m_readbackWaitTicks;
+        int64_t m_encodeTicks;
+
+        std::vector<std::thread> m_workers;
+
+    public:
+        BitmapBatchExporter(Options const& options = Options());
+        ~BitmapBatchExporter();
+
+        BitmapBatchExporter(BitmapBatchExporter const&) = delete;
+        BitmapBatchExporter& operator=(BitmapBatchExporter const&) = delete;
+
+        // CanvasBitmapFileFormat::Auto picks the format from the file extension.
+        std::future<void> Export(ICanvasBitmap* bitmap, HSTRING fileName, CanvasBitmapFileFormat fileFormat, float quality = 0.9f, CompletedFunction const& completed = nullptr);
+        std::future<void> Export(ICanvasBitmap* bitmap, IStream* stream, CanvasBitmapFileFormat fileFormat, float quality = 0.9f, CompletedFunction const& completed = nullptr);
+
+        // Blocks until every queued export has finished.
+        void WaitForAll();
+
+        uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+        uint32_t GetMaximumQueuedBitmaps() const { return m_maximumQueued; }
+
+        bool IsWorkerThread() const;
+
+        BitmapBatchExporterStatistics GetStatistics();
+
+        // Maps a bitmap format onto the WIC format that describes its pixels,
+        // or GUID_NULL if the exporter can't encode from it directly.
+        static GUID GetWicPixelFormat(D2D1_PIXEL_FORMAT const& format);
+
+    private:
+        std::future<void> Enqueue(ICanvasBitmap* bitmap, std::unique_ptr<PendingExport> pendingExport);
+
+        void WorkerThread();
+
+        static void Encode(IWICImagingFactory2* factory, PendingExport& pendingExport, ScopedBitmapMappedPixelAccess const& pixels);
+    };
+
+
+    //
+    // Exports cannot be cancelled once queued, as the readback has already
+    // started. Cancelling the action only changes how it reports completion.
+    //
+    class BitmapBatchExportAction
+        : public RuntimeClass<AsyncBase<IAsyncActionCompletedHandler>, IAsyncAction>
+        , private LifespanTracker<BitmapBatchExportAction>
+    {
+        InspectableClass(InterfaceName_Windows_Foundation_IAsyncAction, BaseTrust);
+
+    public:
+        BitmapBatchExportAction();
+
+        void SetResult(std::exception_ptr const& error);
+
+        IFACEMETHOD(put_Completed)(IAsyncActionCompletedHandler* handler) override;
+        IFACEMETHOD(get_Completed)(IAsyncActionCompletedHandler** handler) override;
+        IFACEMETHOD(GetResults)() override;
+
+    protected:
+        virtual HRESULT OnStart() override;
+        virtual void OnCancel() override;
+        virtual void OnClose() override;
+    };
+
+
+    class CanvasBitmapBatchExporterFactory
+        : public AgileActivationFactory<ICanvasBitmapBatchExporterFactory>
+        , private LifespanTracker<CanvasBitmapBatchExporterFactory>
+    {
+        InspectableClassStatic(RuntimeClass_Microsoft_Graphics_Canvas_CanvasBitmapBatchExporter, BaseTrust);
+
+    public:
+        IFACEMETHOD(ActivateInstance)(IInspectable** instance) override;
+
+        IFACEMETHOD(CreateWithOptions)(
+            int32_t maximumConcurrency,
+            int32_t maximumQueuedBitmaps,
+            ICanvasBitmapBatchExporter** exporter) override;
+    };
+
+
+    class CanvasBitmapBatchExporter : public RuntimeClass<ICanvasBitmapBatchExporter, IClosable>
+                                    , private LifespanTracker<CanvasBitmapBatchExporter>
+    {
+        InspectableClass(RuntimeClass_Microsoft_Graphics_Canvas_CanvasBitmapBatchExporter, BaseTrust);
+
+        std::mutex m_mutex;
+        std::shared_ptr<BitmapBatchExporter> m_exporter;
+
+    public:
+        CanvasBitmapBatchExporter(BitmapBatchExporter::Options const& options);
+
+        virtual ~CanvasBitmapBatchExporter();
+
+        IFACEMETHOD(SaveToFileAsync)(
+            ICanvasBitmap* bitmap,
+            HSTRING fileName,
+            IAsyncAction** asyncAction) override;
+
+        IFACEMETHOD(SaveToFileWithBitmapFileFormatAsync)(
+            ICanvasBitmap* bitmap,
+            HSTRING fileName,
+            CanvasBitmapFileFormat fileFormat,
+            IAsyncAction** asyncAction) override;
+
+        IFACEMETHOD(SaveToFileWithBitmapFileFormatAndQualityAsync)(
+            ICanvasBitmap* bitmap,
+            HSTRING fileName,
+            CanvasBitmapFileFormat fileFormat,
+            float quality,
+            IAsyncAction** asyncAction) override;
+
+        IFACEMETHOD(SaveToStreamAsync)(
+            ICanvasBitmap* bitmap,
+            IRandomAccessStream* stream,
+            CanvasBitmapFileFormat fileFormat,
+            IAsyncAction** asyncAction) override;
+
+        IFACEMETHOD(SaveToStreamWithQualityAsync)(
+            ICanvasBitmap* bitmap,
+            IRandomAccessStream* stream,
+            CanvasBitmapFileFormat fileFormat,
+            float quality,
+            IAsyncAction** asyncAction) override;
+
+        IFACEMETHOD(get_Statistics)(CanvasBitmapBatchExporterStatistics* value) override;
+
+        IFACEMETHOD(Close)() override;
+
+    private:
+        std::shared_ptr<BitmapBatchExporter> GetExporter();
+
+        template<typename DESTINATION>
+        void Save(ICanvasBitmap* bitmap, DESTINATION destination, CanvasBitmapFileFormat fileFormat, float quality, IAsyncAction** asyncAction);
+    };
+
+}}}}
@@ -0,0 +1,803 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "BitmapBatchLoader.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    static std::exception_ptr MakeHResultExceptionPtr(HRESULT hr)
+    {
+        try
+        {
+            ThrowHR(hr);
+        }
+        catch (...)
+        {
+            return std::current_exception();
+        }
+    }
+
+
+    BitmapBatchLoader::BitmapBatchLoader(ICanvasDevice* device, Options const& options)
+        : m_device(device)
+        , m_options(options)
+        , m_isShuttingDown(false)
+        , m_isUploading(false)
+        , m_nextId(1)
+    {
+        CheckInPointer(device);
+
+        if (m_options.UploadBatchSize == 0)
+            ThrowHR(E_INVALIDARG);
+
+        auto workerCount = m_options.MaximumConcurrency ? m_options.MaximumConcurrency : std::max(std::thread::hardware_concurrency(), 1U);
+
+        try
+        {
+            for (uint32_t i = 0; i < workerCount; i++)
+            {
+                m_workers.emplace_back([this] { WorkerThread(); });
+            }
+        }
+        catch (...)
+        {
+            // Stop any workers that did start.
+            {
+                Lock lock(m_mutex);
+                m_isShuttingDown = true;
+            }
+
+            m_workAvailable.notify_all();
+
+            for (auto& worker : m_workers)
+            {
+                worker.join();
+            }
+
+            throw;
+        }
+    }
+
+
+    BitmapBatchLoader::~BitmapBatchLoader()
+    {
+        {
+            Lock lock(m_mutex);
+            m_isShuttingDown = true;
+        }
+
+        m_workAvailable.notify_all();
+
+        for (auto& worker : m_workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+
+        m_workers.clear();
+
+        // Workers only leave loads behind in the queue, or decoded but not uploaded.
+        for (auto& entry : m_queue)
+        {
+            SetError(*entry.second, MakeHResultExceptionPtr(E_ABORT));
+        }
+
+        for (auto& load : m_decoded)
+        {
+            SetError(*load, MakeHResultExceptionPtr(E_ABORT));
+        }
+
+        m_queue.clear();
+        m_queuedPriorities.clear();
+        m_decoded.clear();
+        m_inFlight.clear();
+    }
+
+
+    std::future<ComPtr<CanvasBitmap>> BitmapBatchLoader::Load(HSTRING fileName, int32_t priority, RequestId* requestId, CompletedFunction const& completed)
+    {
+        CheckInPointer(fileName);
+
+        auto load = std::make_unique<PendingLoad>(0, priority);
+        load->FileName = WinString(fileName);
+        load->Completed = completed;
+
+        return Enqueue(std::move(load), requestId);
+    }
+
+
+    std::future<ComPtr<CanvasBitmap>> BitmapBatchLoader::Load(IStream* stream, int32_t priority, RequestId* requestId, CompletedFunction const& completed)
+    {
+        CheckInPointer(stream);
+
+        auto load = std::make_unique<PendingLoad>(0, priority);
+        load->Stream = stream;
+        load->Completed = completed;
+
+        return Enqueue(std::move(load), requestId);
+    }
+
+
+    std::future<ComPtr<CanvasBitmap>> BitmapBatchLoader::Load(IUriRuntimeClass* uri, int32_t priority, RequestId* requestId, CompletedFunction const& completed)
+    {
+        CheckInPointer(uri);
+
+        auto load = std::make_unique<PendingLoad>(0, priority);
+        load->Uri = uri;
+        load->Completed = completed;
+
+        return Enqueue(std::move(load), requestId);
+    }
+
+
+    std::future<ComPtr<CanvasBitmap>> BitmapBatchLoader::Enqueue(std::unique_ptr<PendingLoad> load, RequestId* requestId)
+    {
+        auto result = load->Result.get_future();
+
+        {
+            Lock lock(m_mutex);
+
+            load->Id = m_nextId++;
+
+            if (requestId)
+                *requestId = load->Id;
+
+            QueueKey key{ load->Priority, load->Id };
+
+            m_queuedPriorities[load->Id] = load->Priority;
+            m_queue[key] = std::move(load);
+        }
+
+        m_workAvailable.notify_one();
+
+        return result;
+    }
+
+
+    void BitmapBatchLoader::SetResult(PendingLoad& load, ComPtr<CanvasBitmap> const& bitmap)
+    {
+        load.Result.set_value(bitmap);
+
+        if (load.Completed)
+            load.Completed(bitmap, nullptr);
+    }
+
+
+    void BitmapBatchLoader::SetError(PendingLoad& load, std::exception_ptr const& error)
+    {
+        load.Result.set_exception(error);
+
+        if (load.Completed)
+            load.Completed(nullptr, error);
+    }
+
+
+    bool BitmapBatchLoader::SetPriority(RequestId requestId, int32_t priority)
+    {
+        Lock lock(m_mutex);
+
+        auto it = m_queuedPriorities.find(requestId);
+
+        if (it == m_queuedPriorities.end())
+            return false;
+
+        auto queued = m_queue.find(QueueKey{ it->second, requestId });
+
+        if (priority == it->second)
+            return true;
+
+        // Insert the new entry before removing the old one, so that running out of
+        // memory leaves the load queued at its old priority rather than losing it.
+        auto& slot = m_queue[QueueKey{ priority, requestId }];
+
+        slot = std::move(queued->second);
+        m_queue.erase(queued);
+
+        slot->Priority = priority;
+        it->second = priority;
+
+        return true;
+    }
+
+
+    void BitmapBatchLoader::Reprioritize(std::function<int32_t(RequestId requestId, int32_t priority)> const& getPriority)
+    {
+        Lock lock(m_mutex);
+
+        // Anything that can throw (getPriority, or allocating the new map) happens
+        // before any load is moved, so a failure leaves the queue as it was.
+        std::vector<int32_t> priorities;
+        priorities.reserve(m_queue.size());
+
+        for (auto& entry : m_queue)
+        {
+            priorities.push_back(getPriority(entry.first.Id, entry.first.Priority));
+        }
+
+        std::map<QueueKey, std::unique_ptr<PendingLoad>> queue;
+        std::vector<std::unique_ptr<PendingLoad>*> slots;
+        slots.reserve(m_queue.size());
+
+        size_t i = 0;
+
+        for (auto& entry : m_queue)
+        {
+            slots.push_back(&queue[QueueKey{ priorities[i++], entry.first.Id }]);
+        }
+
+        i = 0;
+
+        for (auto& entry : m_queue)
+        {
+            auto& load = entry.second;
+
+            load->Priority = priorities[i];
+            m_queuedPriorities.find(load->Id)->second = priorities[i];
+
+            *slots[i++] = std::move(load);
+        }
+
+        std::swap(queue, m_queue);
+    }
+
+
+    bool BitmapBatchLoader::Cancel(RequestId requestId)
+    {
+        std::unique_ptr<PendingLoad> cancelledLoad;
+
+        {
+            Lock lock(m_mutex);
+
+            auto it = m_queuedPriorities.find(requestId);
+
+            if (it != m_queuedPriorities.end())
+            {
+                auto queued = m_queue.find(QueueKey{ it->second, requestId });
+                cancelledLoad = std::move(queued->second);
+                m_queue.erase(queued);
+                m_queuedPriorities.erase(it);
+            }
+            else
+            {
+                // Loads that are still decoding, or waiting for upload, are
+                // dropped by the worker that next looks at them.
+                auto inFlight = m_inFlight.find(requestId);
+
+                if (inFlight == m_inFlight.end())
+                    return false;
+
+                inFlight->second->IsCancelled = true;
+            }
+        }
+
+        if (cancelledLoad)
+            SetError(*cancelledLoad, MakeHResultExceptionPtr(E_ABORT));
+
+        // With less queued, a partial batch may now be due for upload.
+        m_workAvailable.notify_all();
+
+        return true;
+    }
+
+
+    void BitmapBatchLoader::CancelAll()
+    {
+        std::map<QueueKey, std::unique_ptr<PendingLoad>> queue;
+
+        {
+            Lock lock(m_mutex);
+
+            std::swap(queue, m_queue);
+            m_queuedPriorities.clear();
+
+            for (auto& entry : m_inFlight)
+            {
+                entry.second->IsCancelled = true;
+            }
+        }
+
+        for (auto& entry : queue)
+        {
+            SetError(*entry.second, MakeHResultExceptionPtr(E_ABORT));
+        }
+
+        m_workAvailable.notify_all();
+    }
+
+
+    uint32_t BitmapBatchLoader::GetQueuedCount()
+    {
+        Lock lock(m_mutex);
+
+        return static_cast<uint32_t>(m_queue.size());
+    }
+
+
+    bool BitmapBatchLoader::IsWorkerThread() const
+    {
+        auto currentThread = std::this_thread::get_id();
+
+        return std::any_of(m_workers.begin(), m_workers.end(), [&] (std::thread const& worker) { return worker.get_id() == currentThread; });
+    }
+
+
+    bool BitmapBatchLoader::IsUploadDue(Lock const& lock)
+    {
+        MustOwnLock(lock);
+
+        if (m_isUploading || m_decoded.empty())
+            return false;
+
+        // Don't hold back a partial batch if there's nothing left to fill it.
+        return m_decoded.size() >= m_options.UploadBatchSize || m_queue.empty();
+    }
+
+
+    void BitmapBatchLoader::WorkerThread()
+    {
+        Wrappers::RoInitializeWrapper initialize(RO_INIT_MULTITHREADED);
+
+        // Held for the lifetime of the worker, rather than looked up for every image.
+        auto adapter = CanvasBitmapAdapter::GetInstance();
+
+        Lock lock(m_mutex);
+
+        for (;;)
+        {
+            m_workAvailable.wait(lock, [&] { return m_isShuttingDown || !m_queue.empty() || IsUploadDue(lock); });
+
+            if (m_isShuttingDown)
+                return;
+
+            if (IsUploadDue(lock))
+            {
+                std::vector<std::unique_ptr<PendingLoad>> batch;
+                std::swap(batch, m_decoded);
+
+                for (auto& load : batch)
+                {
+                    m_inFlight.erase(load->Id);
+                }
+
+                m_isUploading = true;
+                lock.unlock();
+
+                Upload(batch);
+
+                lock.lock();
+                m_isUploading = false;
+
+                // Decoded loads that arrived during the upload may be due by now.
+                m_workAvailable.notify_all();
+                continue;
+            }
+
+            auto first = m_queue.begin();
+            auto load = std::move(first->second);
+            m_queue.erase(first);
+            m_queuedPriorities.erase(load->Id);
+            m_inFlight[load->Id] = load.get();
+
+            lock.unlock();
+
+            try
+            {
+                load->DecodedSource = Decode(adapter.get(), *load);
+            }
+            catch (...)
+            {
+                load->DecodeError = std::current_exception();
+            }
+
+            lock.lock();
+
+            m_decoded.push_back(std::move(load));
+        }
+    }
+
+
+    ComPtr<IWICBitmapSource> BitmapBatchLoader::Decode(CanvasBitmapAdapter* adapter, PendingLoad const& load)
+    {
+        WicBitmapSource source;
+
+        if (load.Uri)
+        {
+            ComPtr<IRandomAccessStreamReferenceStatics> streamReferenceStatics;
+            ThrowIfFailed(GetActivationFactory(HStringReference(RuntimeClass_Windows_Storage_Streams_RandomAccessStreamReference).Get(), &streamReferenceStatics));
+
+            ComPtr<IRandomAccessStreamReference> streamReference;
+            ThrowIfFailed(streamReferenceStatics->CreateFromUri(load.Uri.Get(), &streamReference));
+
+            ComPtr<IAsyncOperation<IRandomAccessStreamWithContentType*>> openOperation;
+            ThrowIfFailed(streamReference->OpenReadAsync(&openOperation));
+
+            // This is a worker thread, so it can simply wait for the file to open.
+            Wrappers::Event operationCompleted(CreateEventEx(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS));
+            auto handler = Callback<AddFtmBase<IAsyncOperationCompletedHandler<IRandomAccessStreamWithContentType*>>::Type>(
+                [&](IAsyncOperation<IRandomAccessStreamWithContentType*>*, AsyncStatus)
+                {
+                    SetEvent(operationCompleted.Get());
+                    return S_OK;
+                });
+            CheckMakeResult(handler);
+
+            ThrowIfFailed(openOperation->put_Completed(handler.Get()));
+
+            if (WaitForSingleObjectEx(operationCompleted.Get(), INFINITE, false) != WAIT_OBJECT_0)
+                ThrowHR(E_UNEXPECTED);
+
+            ComPtr<IRandomAccessStreamWithContentType> randomAccessStream;
+            ThrowIfFailed(openOperation->GetResults(&randomAccessStream));
+
+            ComPtr<IStream> stream;
+            ThrowIfFailed(CreateStreamOverRandomAccessStream(randomAccessStream.Get(), IID_PPV_ARGS(&stream)));
+
+            source = adapter->CreateWicBitmapSource(m_device.Get(), stream.Get());
+        }
+        else if (load.Stream)
+        {
+            source = adapter->CreateWicBitmapSource(m_device.Get(), load.Stream.Get());
+        }
+        else
+        {
+            source = adapter->CreateWicBitmapSource(m_device.Get(), load.FileName);
+        }
+
+        auto wicBitmapSource = source.Source;
+
+        if (source.Transform != WICBitmapTransformRotate0)
+            wicBitmapSource = adapter->CreateFlipRotator(wicBitmapSource, source.Transform);
+
+        return adapter->DecodeToMemory(wicBitmapSource);
+    }
+
+
+    void BitmapBatchLoader::Upload(std::vector<std::unique_ptr<PendingLoad>>& batch)
+    {
+        auto deviceInternal = As<ICanvasDeviceInternal>(m_device);
+
+        for (auto& load : batch)
+        {
+            if (load->IsCancelled)
+            {
+                SetError(*load, MakeHResultExceptionPtr(E_ABORT));
+                continue;
+            }
+
+            if (load->DecodeError)
+            {
+                SetError(*load, load->DecodeError);
+                continue;
+            }
+
+            try
+            {
+                auto d2dBitmap = deviceInternal->CreateBitmapFromWicResource(load->DecodedSource.Get(), m_options.Dpi, m_options.Alpha);
+
+                auto bitmap = Make<CanvasBitmap>(m_device.Get(), d2dBitmap.Get());
+                CheckMakeResult(bitmap);
+
+                SetResult(*load, bitmap);
+            }
+            catch (...)
+            {
+                SetError(*load, std::current_exception());
+            }
+
+            // Free the decoded pixels as soon as they're on the device.
+            load->DecodedSource.Reset();
+        }
+    }
+
+
+
+    //
+    // BitmapBatchLoadOperation
+    //
+
+    BitmapBatchLoadOperation::BitmapBatchLoadOperation(std::shared_ptr<BitmapBatchLoader> const& loader)
+        : m_loader(loader)
+        , m_requestId(0)
+    {
+        ThrowIfFailed(Start());
+    }
+
+
+    void BitmapBatchLoadOperation::SetResult(ComPtr<CanvasBitmap> const& bitmap, std::exception_ptr const& error)
+    {
+        if (error)
+        {
+            HRESULT hr = ExceptionBoundary([&] { std::rethrow_exception(error); });
+
+            (void)TryTransitionToError(hr);
+        }
+        else
+        {
+            m_result = bitmap;
+
+            (void)TryTransitionToCompleted();
+        }
+
+        // If the operation was cancelled, this reports that instead.
+        (void)FireCompletion();
+    }
+
+
+    IFACEMETHODIMP BitmapBatchLoadOperation::put_Completed(IAsyncOperationCompletedHandler<CanvasBitmap*>* handler)
+    {
+        return PutOnComplete(handler);
+    }
+
+
+    IFACEMETHODIMP BitmapBatchLoadOperation::get_Completed(IAsyncOperationCompletedHandler<CanvasBitmap*>** handler)
+    {
+        return GetOnComplete(handler);
+    }
+
+
+    IFACEMETHODIMP BitmapBatchLoadOperation::GetResults(ICanvasBitmap** results)
+    {
+        HRESULT hr = CheckValidStateForResultsCall();
+
+        if (FAILED(hr))
+            return hr;
+
+        return m_result.CopyTo(results);
+    }
+
+
+    std::shared_ptr<BitmapBatchLoader> BitmapBatchLoadOperation::GetLoader()
+    {
+        return m_loader.lock();
+    }
+
+
+    BitmapBatchLoader::RequestId BitmapBatchLoadOperation::GetRequestId()
+    {
+        return m_requestId;
+    }
+
+
+    HRESULT BitmapBatchLoadOperation::OnStart()
+    {
+        return S_OK;
+    }
+
+
+    void BitmapBatchLoadOperation::OnCancel()
+    {
+        // The loader then completes the request with E_ABORT, unless it is
+        // already being uploaded, in which case it completes as normal.
+        // Either way, the operation reports that it was cancelled. If the
+        // loader has been closed, every request has already completed.
+        if (auto loader = m_loader.lock())
+            loader->Cancel(m_requestId);
+    }
+
+
+    void BitmapBatchLoadOperation::OnClose()
+    {
+        m_result.Reset();
+    }
+
+
+    //
+    // CanvasBitmapBatchLoaderFactory
+    //
+
+    ActivatableClassWithFactory(CanvasBitmapBatchLoader, CanvasBitmapBatchLoaderFactory);
+
+
+    IFACEMETHODIMP CanvasBitmapBatchLoaderFactory::Create(
+        ICanvasResourceCreator* resourceCreator,
+        ICanvasBitmapBatchLoader** loader)
+    {
+        BitmapBatchLoader::Options options;
+
+        return CreateWithOptions(resourceCreator, static_cast<int32_t>(options.MaximumConcurrency), options.Dpi, options.Alpha, loader);
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchLoaderFactory::CreateWithOptions(
+        ICanvasResourceCreator* resourceCreator,
+        int32_t maximumConcurrency,
+        float dpi,
+        CanvasAlphaMode alpha,
+        ICanvasBitmapBatchLoader** loader)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(resourceCreator);
+                CheckAndClearOutPointer(loader);
+
+                if (maximumConcurrency < 0 || !(dpi > 0))
+                    ThrowHR(E_INVALIDARG);
+
+                ComPtr<ICanvasDevice> device;
+                ThrowIfFailed(resourceCreator->get_Device(&device));
+
+                BitmapBatchLoader::Options options;
+                options.MaximumConcurrency = static_cast<uint32_t>(maximumConcurrency);
+                options.Dpi = dpi;
+                options.Alpha = alpha;
+
+                auto batchLoader = Make<CanvasBitmapBatchLoader>(device.Get(), options);
+                CheckMakeResult(batchLoader);
+
+                ThrowIfFailed(batchLoader.CopyTo(loader));
+            });
+    }
+
+
+    //
+    // CanvasBitmapBatchLoader
+    //
+
+    CanvasBitmapBatchLoader::CanvasBitmapBatchLoader(ICanvasDevice* device, BitmapBatchLoader::Options const& options)
+        : m_loader(std::make_shared<BitmapBatchLoader>(device, options))
+    {
+    }
+
+
+    CanvasBitmapBatchLoader::~CanvasBitmapBatchLoader()
+    {
+        (void)Close();
+    }
+
+
+    std::shared_ptr<BitmapBatchLoader> CanvasBitmapBatchLoader::GetLoader()
+    {
+        Lock lock(m_mutex);
+
+        if (!m_loader)
+            ThrowHR(RO_E_CLOSED);
+
+        return m_loader;
+    }
+
+
+    template<typename SOURCE>
+    void CanvasBitmapBatchLoader::Load(SOURCE source, int32_t priority, IAsyncOperation<CanvasBitmap*>** canvasBitmap)
+    {
+        CheckAndClearOutPointer(canvasBitmap);
+
+        auto loader = GetLoader();
+
+        auto operation = Make<BitmapBatchLoadOperation>(loader);
+        CheckMakeResult(operation);
+
+        BitmapBatchLoader::RequestId requestId;
+
+        // The request keeps the operation alive until it completes.
+        loader->Load(source, priority, &requestId,
+            [operation] (ComPtr<CanvasBitmap> const& bitmap, std::exception_ptr const& error)
+            {
+                operation->SetResult(bitmap, error);
+            });
+
+        operation->SetRequestId(requestId);
+
+        ThrowIfFailed(operation.CopyTo(canvasBitmap));
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchLoader::LoadAsyncFromHstring(
+        HSTRING fileName,
+        int32_t priority,
+        IAsyncOperation<CanvasBitmap*>** canvasBitmap)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                Load(fileName, priority, canvasBitmap);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchLoader::LoadAsyncFromUri(
+        IUriRuntimeClass* uri,
+        int32_t priority,
+        IAsyncOperation<CanvasBitmap*>** canvasBitmap)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                Load(uri, priority, canvasBitmap);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchLoader::LoadAsyncFromStream(
+        IRandomAccessStream* stream,
+        int32_t priority,
+        IAsyncOperation<CanvasBitmap*>** canvasBitmap)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(stream);
+
+                ComPtr<IStream> nativeStream;
+                ThrowIfFailed(CreateStreamOverRandomAccessStream(stream, IID_PPV_ARGS(&nativeStream)));
+
+                Load(nativeStream.Get(), priority, canvasBitmap);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchLoader::SetPriority(
+        IAsyncOperation<CanvasBitmap*>* loadOperation,
+        int32_t priority,
+        boolean* succeeded)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(loadOperation);
+                CheckInPointer(succeeded);
+
+                auto loader = GetLoader();
+
+                ComPtr<ICanvasBitmapBatchLoadOperationInternal> operation;
+
+                if (FAILED(loadOperation->QueryInterface(IID_PPV_ARGS(&operation))) || operation->GetLoader() != loader)
+                    ThrowHR(E_INVALIDARG);
+
+                *succeeded = loader->SetPriority(operation->GetRequestId(), priority);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchLoader::CancelAll()
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                GetLoader()->CancelAll();
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchLoader::get_QueuedCount(int32_t* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                *value = static_cast<int32_t>(GetLoader()->GetQueuedCount());
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasBitmapBatchLoader::Close()
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                std::shared_ptr<BitmapBatchLoader> loader;
+
+                {
+                    Lock lock(m_mutex);
+                    std::swap(loader, m_loader);
+                }
+
+                // Destroying the loader joins its workers, and aborts the
+                // requests that are still outstanding. That cannot happen on
+                // one of the workers, as it would if the last reference to
+                // this object were released from a completion handler, so
+                // the thread pool does it instead.
+                if (loader && loader->IsWorkerThread())
+                {
+                    auto holder = std::make_shared<std::shared_ptr<BitmapBatchLoader>>(std::move(loader));
+
+                    auto destroyLoader = Make<AsyncAction>([holder] { holder->reset(); });
+                    CheckMakeResult(destroyLoader);
+                }
+            });
+    }
+
+}}}}
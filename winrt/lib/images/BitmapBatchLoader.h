@@ -0,0 +1,293 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "utils/LockUtilities.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Loads many bitmaps at once, for example a screenful of thumbnails.
+    //
+    // CanvasBitmap.LoadAsync starts an independent thread pool operation for
+    // every image, so loading thousands of them saturates the thread pool with
+    // no way to say which images are wanted first. This loader instead keeps
+    // its own queue, ordered by priority, and decodes from it on a fixed
+    // number of worker threads. Each worker decodes an image entirely into
+    // memory, so that no WIC work is left for the upload. Decoded images are
+    // then uploaded to the device in batches, one batch at a time, while the
+    // other workers carry on decoding.
+    //
+    // Requests that have not yet been uploaded can be cancelled, and queued
+    // requests can be given a new priority, for example when the set of
+    // visible thumbnails changes. The future of a cancelled request reports
+    // E_ABORT, as do those of requests still outstanding when the loader is
+    // destroyed.
+    //
+    // Instead of waiting on the future, a request can also be given a
+    // function to call with its result. This is called on whichever thread
+    // completes the request, without the loader's lock held, and must not
+    // throw.
+    //
+    class BitmapBatchLoader : private LifespanTracker<BitmapBatchLoader>
+    {
+    public:
+        typedef uint64_t RequestId;
+
+        typedef std::function<void(ComPtr<CanvasBitmap> const& bitmap, std::exception_ptr const& error)> CompletedFunction;
+
+        struct Options
+        {
+            // Zero means one worker per core.
+            uint32_t MaximumConcurrency;
+
+            // Decoded images are uploaded once this many are ready, or sooner
+            // if nothing else is queued.
+            uint32_t UploadBatchSize;
+
+            float Dpi;
+            CanvasAlphaMode Alpha;
+
+            Options()
+                : MaximumConcurrency(0)
+                , UploadBatchSize(16)
+                , Dpi(DEFAULT_DPI)
+                , Alpha(CanvasAlphaMode::Premultiplied)
+            {
+            }
+        };
+
+    private:
+        struct PendingLoad
+        {
+            RequestId Id;
+            int32_t Priority;
+            bool IsCancelled;
+
+            // Exactly one of these identifies the image.
+            WinString FileName;
+            ComPtr<IStream> Stream;
+            ComPtr<ABI::Windows::Foundation::IUriRuntimeClass> Uri;
+
+            ComPtr<IWICBitmapSource> DecodedSource;
+            std::exception_ptr DecodeError;
+
+            std::promise<ComPtr<CanvasBitmap>> Result;
+            CompletedFunction Completed;
+
+            PendingLoad(RequestId id, int32_t priority)
+                : Id(id)
+                , Priority(priority)
+                , IsCancelled(false)
+            {
+            }
+        };
+
+        // Higher priorities come first, then requests in the order they were made.
+        struct QueueKey
+        {
+            int32_t Priority;
+            RequestId Id;
+
+            bool operator<(QueueKey const& other) const
+            {
+                if (Priority != other.Priority)
+                    return Priority > other.Priority;
+
+                return Id < other.Id;
+            }
+        };
+
+        ComPtr<ICanvasDevice> m_device;
+        Options m_options;
+
+        std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        bool m_isShuttingDown;
+        bool m_isUploading;
+        RequestId m_nextId;
+
+        std::map<QueueKey, std::unique_ptr<PendingLoad>> m_queue;
+
+        // The priority of each queued request, which is needed to find it in m_queue.
+        std::unordered_map<RequestId, int32_t> m_queuedPriorities;
+
+        // Loads that have been taken from the queue, but not yet uploaded.
+        std::unordered_map<RequestId, PendingLoad*> m_inFlight;
+
+        // Decoded loads waiting to be uploaded. Owned here, but still in m_inFlight.
+        std::vector<std::unique_ptr<PendingLoad>> m_decoded;
+
+        std::vector<std::thread> m_workers;
+
+    public:
+        BitmapBatchLoader(ICanvasDevice* device, Options const& options = Options());
+        ~BitmapBatchLoader();
+
+        BitmapBatchLoader(BitmapBatchLoader const&) = delete;
+        BitmapBatchLoader& operator=(BitmapBatchLoader const&) = delete;
+
+        std::future<ComPtr<CanvasBitmap>> Load(HSTRING fileName, int32_t priority = 0, RequestId* requestId = nullptr, CompletedFunction const& completed = nullptr);
+        std::future<ComPtr<CanvasBitmap>> Load(IStream* stream, int32_t priority = 0, RequestId* requestId = nullptr, CompletedFunction const& completed = nullptr);
+        std::future<ComPtr<CanvasBitmap>> Load(ABI::Windows::Foundation::IUriRuntimeClass* uri, int32_t priority = 0, RequestId* requestId = nullptr, CompletedFunction const& completed = nullptr);
+
+        // Returns false if the request has already started decoding, or has finished.
+        bool SetPriority(RequestId requestId, int32_t priority);
+
+        // Calls getPriority for every queued request, to give it a new priority.
+        // This holds the loader's lock, so getPriority must not call back into it.
+        void Reprioritize(std::function<int32_t(RequestId requestId, int32_t priority)> const& getPriority);
+
+        // Returns false if the request is already being uploaded, or has finished.
+        bool Cancel(RequestId requestId);
+
+        void CancelAll();
+
+        uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+        bool IsWorkerThread() const;
+
+        // Requests that have not yet started decoding.
+        uint32_t GetQueuedCount();
+
+    private:
+        std::future<ComPtr<CanvasBitmap>> Enqueue(std::unique_ptr<PendingLoad> load, RequestId* requestId);
+
+        static void SetResult(PendingLoad& load, ComPtr<CanvasBitmap> const& bitmap);
+        static void SetError(PendingLoad& load, std::exception_ptr const& error);
+
+        void WorkerThread();
+
+        bool IsUploadDue(Lock const& lock);
+
+        ComPtr<IWICBitmapSource> Decode(CanvasBitmapAdapter* adapter, PendingLoad const& load);
+        void Upload(std::vector<std::unique_ptr<PendingLoad>>& batch);
+    };
+
+
+    //
+    // Exposes BitmapBatchLoader as CanvasBitmapBatchLoader.
+    //
+    // Each LoadAsync returns a BitmapBatchLoadOperation, which the loader
+    // completes from its workers, so that pending requests do not each hold
+    // a thread pool thread. Cancelling the operation cancels the request.
+    //
+
+    class __declspec(uuid("625FE807-6D08-4765-AA3B-991CBC4CA177"))
+    ICanvasBitmapBatchLoadOperationInternal : public IUnknown
+    {
+    public:
+        virtual std::shared_ptr<BitmapBatchLoader> GetLoader() = 0;
+        virtual BitmapBatchLoader::RequestId GetRequestId() = 0;
+    };
+
+
+    class BitmapBatchLoadOperation
+        : public RuntimeClass<
+            AsyncBase<IAsyncOperationCompletedHandler<CanvasBitmap*>>,
+            IAsyncOperation<CanvasBitmap*>,
+            CloakedIid<ICanvasBitmapBatchLoadOperationInternal>>
+        , private LifespanTracker<BitmapBatchLoadOperation>
+    {
+        InspectableClass(IAsyncOperation<CanvasBitmap*>::z_get_rc_name_impl(), BaseTrust);
+
+        std::weak_ptr<BitmapBatchLoader> m_loader;
+        BitmapBatchLoader::RequestId m_requestId;
+
+        ComPtr<CanvasBitmap> m_result;
+
+    public:
+        BitmapBatchLoadOperation(std::shared_ptr<BitmapBatchLoader> const& loader);
+
+        // Must be called before the operation is handed out.
+        void SetRequestId(BitmapBatchLoader::RequestId requestId) { m_requestId = requestId; }
+
+        void SetResult(ComPtr<CanvasBitmap> const& bitmap, std::exception_ptr const& error);
+
+        IFACEMETHOD(put_Completed)(IAsyncOperationCompletedHandler<CanvasBitmap*>* handler) override;
+        IFACEMETHOD(get_Completed)(IAsyncOperationCompletedHandler<CanvasBitmap*>** handler) override;
+        IFACEMETHOD(GetResults)(ICanvasBitmap** results) override;
+
+        // ICanvasBitmapBatchLoadOperationInternal
+
+        virtual std::shared_ptr<BitmapBatchLoader> GetLoader() override;
+        virtual BitmapBatchLoader::RequestId GetRequestId() override;
+
+    protected:
+        virtual HRESULT OnStart() override;
+        virtual void OnCancel() override;
+        virtual void OnClose() override;
+    };
+
+
+    class CanvasBitmapBatchLoaderFactory
+        : public AgileActivationFactory<ICanvasBitmapBatchLoaderFactory>
+        , private LifespanTracker<CanvasBitmapBatchLoaderFactory>
+    {
+        InspectableClassStatic(RuntimeClass_Microsoft_Graphics_Canvas_CanvasBitmapBatchLoader, BaseTrust);
+
+    public:
+        IFACEMETHOD(Create)(
+            ICanvasResourceCreator* resourceCreator,
+            ICanvasBitmapBatchLoader** loader) override;
+
+        IFACEMETHOD(CreateWithOptions)(
+            ICanvasResourceCreator* resourceCreator,
+            int32_t maximumConcurrency,
+            float dpi,
+            CanvasAlphaMode alpha,
+            ICanvasBitmapBatchLoader** loader) override;
+    };
+
+
+    class CanvasBitmapBatchLoader : public RuntimeClass<ICanvasBitmapBatchLoader, IClosable>
+                                  , private LifespanTracker<CanvasBitmapBatchLoader>
+    {
+        InspectableClass(RuntimeClass_Microsoft_Graphics_Canvas_CanvasBitmapBatchLoader, BaseTrust);
+
+        std::mutex m_mutex;
+
+        // Shared with the operations, which only hold weak references.
+        std::shared_ptr<BitmapBatchLoader> m_loader;
+
+    public:
+        CanvasBitmapBatchLoader(ICanvasDevice* device, BitmapBatchLoader::Options const& options);
+
+        virtual ~CanvasBitmapBatchLoader();
+
+        IFACEMETHOD(LoadAsyncFromHstring)(
+            HSTRING fileName,
+            int32_t priority,
+            IAsyncOperation<CanvasBitmap*>** canvasBitmap) override;
+
+        IFACEMETHOD(LoadAsyncFromUri)(
+            IUriRuntimeClass* uri,
+            int32_t priority,
+            IAsyncOperation<CanvasBitmap*>** canvasBitmap) override;
+
+        IFACEMETHOD(LoadAsyncFromStream)(
+            IRandomAccessStream* stream,
+            int32_t priority,
+            IAsyncOperation<CanvasBitmap*>** canvasBitmap) override;
+
+        IFACEMETHOD(SetPriority)(
+            IAsyncOperation<CanvasBitmap*>* loadOperation,
+            int32_t priority,
+            boolean* succeeded) override;
+
+        IFACEMETHOD(CancelAll)() override;
+
+        IFACEMETHOD(get_QueuedCount)(int32_t* value) override;
+
+        IFACEMETHOD(Close)() override;
+
+    private:
+        std::shared_ptr<BitmapBatchLoader> GetLoader();
+
+        template<typename SOURCE>
+        void Load(SOURCE source, int32_t priority, IAsyncOperation<CanvasBitmap*>** canvasBitmap);
+    };
+
+}}}}
@@ -5,6 +5,10 @@
 #include "pch.h"
 #include <propkey.h>
 
+#include "utils/HashUtilities.h"
+#include "utils/MappedFileStream.h"
+#include "PixelReadbackQueue.h"
+
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 {
     using namespace ABI::Windows::Storage::Streams;
@@ -43,45 +47,29 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     }
 
 
-    class BitmapSubRectangle
+    BitmapSubRectangle::BitmapSubRectangle(ComPtr<ID2D1Bitmap> const& d2dBitmap, D2D1_RECT_U const& rect)
     {
-        unsigned m_totalBytes;
-        unsigned m_bytesPerRow;
-        unsigned m_blocksHigh;
-
-        DXGI_FORMAT m_format;
-        
-    public:
-        BitmapSubRectangle(ComPtr<ID2D1Bitmap> const& d2dBitmap, D2D1_RECT_U const& rect)
-        {
-            VerifyWellFormedSubrectangle(rect, d2dBitmap->GetPixelSize());
+        VerifyWellFormedSubrectangle(rect, d2dBitmap->GetPixelSize());
 
-            m_format = d2dBitmap->GetPixelFormat().format;
-            auto blockSize = GetBlockSize(m_format);
+        m_format = d2dBitmap->GetPixelFormat().format;
+        auto blockSize = GetBlockSize(m_format);
 
-            if (!IsBlockAligned(blockSize, rect))
-                ThrowHR(E_INVALIDARG, Strings::BlockCompressedSubRectangleMustBeAligned);
+        if (!IsBlockAligned(blockSize, rect))
+            ThrowHR(E_INVALIDARG, Strings::BlockCompressedSubRectangleMustBeAligned);
 
-            auto bytesPerBlock = GetBytesPerBlock(m_format);
+        auto bytesPerBlock = GetBytesPerBlock(m_format);
 
-            auto pixelWidth = (rect.right - rect.left);
-            auto blocksWide = pixelWidth / blockSize;
+        auto pixelWidth = (rect.right - rect.left);
+        auto blocksWide = pixelWidth / blockSize;
 
-            auto pixelHeight = (rect.bottom - rect.top);
-            m_blocksHigh = pixelHeight / blockSize;
-
-            auto totalBlocks = blocksWide * m_blocksHigh;
-
-            m_totalBytes = totalBlocks * bytesPerBlock;
-            m_bytesPerRow = blocksWide * bytesPerBlock;
-        }
+        auto pixelHeight = (rect.bottom - rect.top);
+        m_blocksHigh = pixelHeight / blockSize;
 
-        unsigned GetTotalBytes() const { return m_totalBytes; }
-        unsigned GetBytesPerRow() const { return m_bytesPerRow; }
-        unsigned GetBlocksHigh() const { return m_blocksHigh; }
+        auto totalBlocks = blocksWide * m_blocksHigh;
 
-        DXGI_FORMAT GetFormat() const { return m_format; }
-    };
+        m_totalBytes = totalBlocks * bytesPerBlock;
+        m_bytesPerRow = blocksWide * bytesPerBlock;
+    }
 
 
     bool FileFormatSupportsHdr(GUID const& containerFormat)
@@ -106,7 +94,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         }
     }
 
-    static GUID GetEncoderFromFileExtension(
+    GUID GetEncoderFromFileExtension(
         WinString fileName)
     {
         static const struct ExtensionTable
@@ -255,11 +243,20 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
     WicBitmapSource DefaultBitmapAdapter::CreateWicBitmapSource(ICanvasDevice* device, HSTRING fileName, bool tryEnableIndexing)
     {
-        ComPtr<IWICStream> stream;
-        ThrowIfFailed(m_wicAdapter->GetFactory()->CreateStream(&stream));
+        // Decoders read straight from a mapping of the file, rather than
+        // through a file stream's own buffering. Very large files aren't mapped,
+        // as the view would take up too much of a 32 bit process's address space.
+        const uint64_t maxMappedFileSize = 64 * 1024 * 1024;
 
         WinString fileNameString(fileName);
-        ThrowIfFailed(stream->InitializeFromFilename(static_cast<const wchar_t*>(fileNameString), GENERIC_READ));
+        auto path = static_cast<const wchar_t*>(fileNameString);
+
+        if (auto mappedStream = MappedFileStream::TryCreate(path, maxMappedFileSize))
+            return CreateWicBitmapSource(device, mappedStream.Get(), tryEnableIndexing);
+
+        ComPtr<IWICStream> stream;
+        ThrowIfFailed(m_wicAdapter->GetFactory()->CreateStream(&stream));
+        ThrowIfFailed(stream->InitializeFromFilename(path, GENERIC_READ));
 
         return CreateWicBitmapSource(device, stream.Get(), tryEnableIndexing);
     }
@@ -357,6 +354,20 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         return bitmapFlipRotator;
     }
 
+    ComPtr<IWICBitmapSource> DefaultBitmapAdapter::DecodeToMemory(
+        ComPtr<IWICBitmapSource> const& source)
+    {
+        // Block compressed DDS frames are copied straight into the bitmap, so
+        // must be left as they are.
+        if (MaybeAs<IWICDdsFrameDecode>(source))
+            return source;
+
+        ComPtr<IWICBitmap> bitmap;
+        ThrowIfFailed(m_wicAdapter->GetFactory()->CreateBitmapFromSource(source.Get(), WICBitmapCacheOnLoad, &bitmap));
+
+        return bitmap;
+    }
+
 
     ComPtr<CanvasBitmap> CanvasBitmap::CreateNew(
         ICanvasDevice* canvasDevice,
@@ -402,6 +413,157 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     }
 
 
+    //
+    // Loading through the device's decoded bitmap cache
+    //
+
+    static std::wstring GetDecodedBitmapKeySuffix(float dpi, CanvasAlphaMode alpha)
+    {
+        return L"|" + std::to_wstring(dpi) + L"|" + std::to_wstring(static_cast<int>(alpha));
+    }
+
+
+    template<typename T>
+    static ComPtr<CanvasBitmap> GetOrCreateCachedBitmap(
+        ICanvasDevice* canvasDevice,
+        std::wstring const& key,
+        T fileNameOrStream,
+        float dpi,
+        CanvasAlphaMode alpha)
+    {
+        auto canvasDeviceInternal = As<ICanvasDeviceInternal>(canvasDevice);
+
+        auto d2dBitmap = canvasDeviceInternal->FindDecodedBitmap(key);
+
+        if (!d2dBitmap)
+        {
+            auto wicBitmapSource = CreateWicBitmapSourceWithExifTransform(canvasDevice, fileNameOrStream);
+
+            d2dBitmap = canvasDeviceInternal->CreateBitmapFromWicResource(wicBitmapSource.Get(), dpi, alpha);
+
+            // If another caller got there first, share their bitmap instead.
+            d2dBitmap = canvasDeviceInternal->AddDecodedBitmap(key, d2dBitmap.Get());
+        }
+
+        // Callers that load the same image share a single wrapper, too.
+        // Decoded bitmaps are never render targets, so that is always a
+        // CanvasBitmap.
+        auto bitmap = ResourceManager::GetOrCreate<ICanvasBitmap>(canvasDevice, d2dBitmap.Get());
+
+        return static_cast<CanvasBitmap*>(bitmap.Get());
+    }
+
+
+    ComPtr<CanvasBitmap> CanvasBitmap::GetOrCreateCached(
+        ICanvasDevice* canvasDevice,
+        HSTRING fileName,
+        float dpi,
+        CanvasAlphaMode alpha)
+    {
+        CheckInPointer(canvasDevice);
+        CheckInPointer(fileName);
+
+        auto path = WindowsGetStringRawBuffer(fileName, nullptr);
+
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+        if (!GetFileAttributesExW(path, GetFileExInfoStandard, &attributes))
+        {
+            // Without a modification time there's no safe key, so leave it
+            // to the regular load to report the error, or to read the file.
+            return CreateNew(canvasDevice, fileName, dpi, alpha);
+        }
+
+        auto lastWriteTime = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) |
+                             attributes.ftLastWriteTime.dwLowDateTime;
+
+        auto key = L"file|" + std::wstring(path) + L"|" + std::to_wstring(lastWriteTime) + GetDecodedBitmapKeySuffix(dpi, alpha);
+
+        return GetOrCreateCachedBitmap(canvasDevice, key, fileName, dpi, alpha);
+    }
+
+
+    ComPtr<CanvasBitmap> CanvasBitmap::GetOrCreateCached(
+        ICanvasDevice* canvasDevice,
+        IStream* fileStream,
+        float dpi,
+        CanvasAlphaMode alpha)
+    {
+        CheckInPointer(canvasDevice);
+        CheckInPointer(fileStream);
+
+        // Streams have no name or timestamp, so they are identified by a hash
+        // of their contents. Hashing reads the whole stream, which is far
+        // cheaper than decoding and uploading it again.
+        LARGE_INTEGER start{};
+        ThrowIfFailed(fileStream->Seek(start, STREAM_SEEK_SET, nullptr));
+
+        Sha1 hash;
+        std::vector<BYTE> buffer(64 * 1024);
+
+        for (;;)
+        {
+            ULONG bytesRead = 0;
+            ThrowIfFailed(fileStream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &bytesRead));
+
+            if (bytesRead == 0)
+                break;
+
+            hash.Update(buffer.data(), bytesRead);
+        }
+
+        BYTE digest[Sha1::DigestSize];
+        hash.Finish(digest);
+
+        std::wstring key = L"stream|";
+
+        for (auto value : digest)
+        {
+            static const wchar_t hexDigits[] = L"0123456789abcdef";
+
+            key += hexDigits[value >> 4];
+            key += hexDigits[value & 0xF];
+        }
+
+        key += GetDecodedBitmapKeySuffix(dpi, alpha);
+
+        ThrowIfFailed(fileStream->Seek(start, STREAM_SEEK_SET, nullptr));
+
+        return GetOrCreateCachedBitmap(canvasDevice, key, fileStream, dpi, alpha);
+    }
+
+
+    // Returns how many bytes of memory an image of this size reads, with
+    // stride bytes between the start of each row of blocks.
+    static uint32_t GetSizeOfPixelBytes(
+        DXGI_FORMAT format,
+        int32_t widthInPixels,
+        int32_t heightInPixels,
+        uint32_t stride)
+    {
+        auto blockSize = static_cast<int32_t>(GetBlockSize(format));
+
+        if ((widthInPixels % blockSize) != 0 || (heightInPixels % blockSize) != 0)
+            ThrowHR(E_INVALIDARG, Strings::BlockCompressedDimensionsMustBeMultipleOf4);
+
+        if (widthInPixels < 0 || heightInPixels < 0)
+            ThrowHR(E_INVALIDARG);
+
+        auto bytesPerRow = static_cast<uint64_t>(GetBytesPerBlock(format)) * (widthInPixels / blockSize);
+        auto blocksHigh = static_cast<uint64_t>(heightInPixels / blockSize);
+
+        if (stride < bytesPerRow)
+            ThrowHR(E_INVALIDARG);
+
+        auto size = blocksHigh ? (blocksHigh - 1) * stride + bytesPerRow : 0;
+
+        if (size > UINT_MAX)
+            ThrowHR(E_INVALIDARG);
+
+        return static_cast<uint32_t>(size);
+    }
+
+
     ComPtr<CanvasBitmap> CanvasBitmap::CreateNew(
         ICanvasDevice* device,
         uint32_t byteCount,
@@ -445,6 +607,10 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         return bitmap;
     }
 
+
+    // Colors are swizzled to B8G8R8A8 in bands of about this many bytes.
+    static const uint32_t ColorUploadBandSize = 1024 * 1024;
+
     
     ComPtr<CanvasBitmap> CanvasBitmap::CreateNew(
         ICanvasDevice* device,
@@ -455,17 +621,59 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         float dpi,
         CanvasAlphaMode alpha)
     {
-        auto convertedBytes = ConvertColorsToBgra(colorCount, colors);
+        auto width = static_cast<uint32_t>(widthInPixels);
+        auto height = static_cast<uint32_t>(heightInPixels);
+        auto bytesPerRow = width * 4;
+
+        GetSizeOfPixelBytes(DXGI_FORMAT_B8G8R8A8_UNORM, widthInPixels, heightInPixels, bytesPerRow);
 
-        return CreateNew(
+        if (colorCount < static_cast<uint64_t>(width) * height)
+            ThrowHR(E_INVALIDARG);
+
+        auto deviceInternal = As<ICanvasDeviceInternal>(device);
+
+        // D2D can't read Colors directly, but there's no need to convert the
+        // whole image up front. Big images are converted and uploaded one
+        // band of rows at a time, through a buffer of bounded size.
+        auto rowsPerBand = bytesPerRow ? std::max(ColorUploadBandSize / bytesPerRow, 1U) : height;
+
+        std::unique_ptr<uint8_t[]> band;
+        ComPtr<ID2D1Bitmap1> d2dBitmap;
+
+        if (width == 0 || height == 0)
+        {
+            d2dBitmap = deviceInternal->CreateBitmapFromBytes(nullptr, bytesPerRow, widthInPixels, heightInPixels, dpi, PIXEL_FORMAT(B8G8R8A8UIntNormalized), alpha);
+        }
+        else if (rowsPerBand >= height)
+        {
+            band.reset(new uint8_t[bytesPerRow * height]);
+            SwizzleColorAndBgra(reinterpret_cast<uint8_t const*>(colors), band.get(), width * height);
+
+            d2dBitmap = deviceInternal->CreateBitmapFromBytes(band.get(), bytesPerRow, widthInPixels, heightInPixels, dpi, PIXEL_FORMAT(B8G8R8A8UIntNormalized), alpha);
+        }
+        else
+        {
+            d2dBitmap = deviceInternal->CreateBitmapFromBytes(nullptr, bytesPerRow, widthInPixels, heightInPixels, dpi, PIXEL_FORMAT(B8G8R8A8UIntNormalized), alpha);
+
+            band.reset(new uint8_t[bytesPerRow * rowsPerBand]);
+
+            for (uint32_t y = 0; y < height; y += rowsPerBand)
+            {
+                auto rowCount = std::min(rowsPerBand, height - y);
+
+                SwizzleColorAndBgra(reinterpret_cast<uint8_t const*>(colors + y * width), band.get(), width * rowCount);
+
+                auto rect = D2D1::RectU(0, y, width, y + rowCount);
+                ThrowIfFailed(d2dBitmap->CopyFromMemory(&rect, band.get(), bytesPerRow));
+            }
+        }
+
+        auto bitmap = Make<CanvasBitmap>(
             device,
-            static_cast<uint32_t>(convertedBytes.size()),
-            convertedBytes.empty() ? nullptr : &convertedBytes[0],
-            widthInPixels,
-            heightInPixels,
-            dpi,
-            PIXEL_FORMAT(B8G8R8A8UIntNormalized),
-            alpha);
+            d2dBitmap.Get());
+        CheckMakeResult(bitmap);
+
+        return bitmap;
     }
 
 
@@ -557,6 +765,147 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
 #endif
 
+
+    static bool CanUploadInto(
+        ICanvasBitmap* bitmap,
+        ID2D1Bitmap1* d2dBitmap,
+        ICanvasDevice* device,
+        int32_t widthInPixels,
+        int32_t heightInPixels,
+        float dpi,
+        DirectXPixelFormat format,
+        CanvasAlphaMode alpha)
+    {
+        if (!IsSameInstance(GetCanvasDevice(As<ICanvasResourceCreator>(bitmap).Get()).Get(), device))
+            return false;
+
+        // CPU readable bitmaps can't be written by CopyFromMemory.
+        if ((d2dBitmap->GetOptions() & D2D1_BITMAP_OPTIONS_CPU_READ) != 0)
+            return false;
+
+        auto size = d2dBitmap->GetPixelSize();
+
+        if (size.width != static_cast<uint32_t>(widthInPixels) || size.height != static_cast<uint32_t>(heightInPixels))
+            return false;
+
+        auto pixelFormat = d2dBitmap->GetPixelFormat();
+
+        if (pixelFormat.format != static_cast<DXGI_FORMAT>(format) || pixelFormat.alphaMode != ToD2DAlphaMode(alpha))
+            return false;
+
+        float dpiX, dpiY;
+        d2dBitmap->GetDpi(&dpiX, &dpiY);
+
+        return dpiX == dpi && dpiY == dpi;
+    }
+
+
+    ComPtr<ICanvasBitmap> CanvasBitmap::CreateFromMemory(
+        ICanvasDevice* device,
+        uint32_t byteCount,
+        uint8_t const* bytes,
+        uint32_t stride,
+        int32_t widthInPixels,
+        int32_t heightInPixels,
+        float dpi,
+        DirectXPixelFormat format,
+        CanvasAlphaMode alpha,
+        ICanvasBitmap* bitmapToReuse)
+    {
+        CheckInPointer(device);
+
+        auto bytesNeeded = GetSizeOfPixelBytes(static_cast<DXGI_FORMAT>(format), widthInPixels, heightInPixels, stride);
+
+        if (byteCount < bytesNeeded)
+            ThrowHR(E_INVALIDARG);
+
+        if (bytesNeeded > 0)
+            CheckInPointer(bytes);
+
+        if (bitmapToReuse)
+        {
+            auto& d2dBitmap = As<ICanvasBitmapInternal>(bitmapToReuse)->GetD2DBitmap();
+
+            if (CanUploadInto(bitmapToReuse, d2dBitmap.Get(), device, widthInPixels, heightInPixels, dpi, format, alpha))
+            {
+                if (bytesNeeded > 0)
+                    ThrowIfFailed(d2dBitmap->CopyFromMemory(nullptr, bytes, stride));
+
+                return bitmapToReuse;
+            }
+        }
+
+        // D2D copies from the bytes, but its API isn't const correct.
+        auto d2dBitmap = As<ICanvasDeviceInternal>(device)->CreateBitmapFromBytes(
+            (bytesNeeded > 0) ? const_cast<uint8_t*>(bytes) : nullptr,
+            stride,
+            widthInPixels,
+            heightInPixels,
+            dpi,
+            format,
+            alpha);
+
+        auto bitmap = Make<CanvasBitmap>(
+            device,
+            d2dBitmap.Get());
+        CheckMakeResult(bitmap);
+
+        return bitmap;
+    }
+
+
+    ComPtr<ICanvasBitmap> CanvasBitmap::CreateFromMemory(
+        ICanvasDevice* device,
+        IBuffer* buffer,
+        uint32_t stride,
+        int32_t widthInPixels,
+        int32_t heightInPixels,
+        float dpi,
+        DirectXPixelFormat format,
+        CanvasAlphaMode alpha,
+        ICanvasBitmap* bitmapToReuse)
+    {
+        using ::Windows::Storage::Streams::IBufferByteAccess;
+
+        CheckInPointer(buffer);
+
+        uint32_t byteCount;
+        uint8_t* bytes;
+
+        ThrowIfFailed(buffer->get_Length(&byteCount));
+        ThrowIfFailed(As<IBufferByteAccess>(buffer)->Buffer(&bytes));
+
+        return CreateFromMemory(device, byteCount, bytes, stride, widthInPixels, heightInPixels, dpi, format, alpha, bitmapToReuse);
+    }
+
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+    ComPtr<ICanvasBitmap> CanvasBitmap::CreateFromMemory(
+        ICanvasDevice* device,
+        IMemoryBufferReference* buffer,
+        uint32_t stride,
+        int32_t widthInPixels,
+        int32_t heightInPixels,
+        float dpi,
+        DirectXPixelFormat format,
+        CanvasAlphaMode alpha,
+        ICanvasBitmap* bitmapToReuse)
+    {
+        using ::Windows::Foundation::IMemoryBufferByteAccess;
+
+        CheckInPointer(buffer);
+
+        uint32_t byteCount;
+        uint8_t* bytes;
+
+        ThrowIfFailed(As<IMemoryBufferByteAccess>(buffer)->GetBuffer(&bytes, &byteCount));
+
+        return CreateFromMemory(device, byteCount, bytes, stride, widthInPixels, heightInPixels, dpi, format, alpha, bitmapToReuse);
+    }
+
+#endif
+
     
     //
     // ICanvasBitmapStatics
@@ -812,6 +1161,40 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             });
     }
 
+    IFACEMETHODIMP CanvasBitmapFactory::CreateFromBytesWithBufferAndStride(
+        ICanvasResourceCreator* resourceCreator,
+        IBuffer* buffer,
+        int32_t widthInPixels,
+        int32_t heightInPixels,
+        uint32_t stride,
+        DirectXPixelFormat format,
+        float dpi,
+        CanvasAlphaMode alpha,
+        ICanvasBitmap** canvasBitmap)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(resourceCreator);
+                CheckAndClearOutPointer(canvasBitmap);
+
+                ComPtr<ICanvasDevice> canvasDevice;
+                ThrowIfFailed(resourceCreator->get_Device(&canvasDevice));
+
+                auto newBitmap = CanvasBitmap::CreateFromMemory(
+                    canvasDevice.Get(),
+                    buffer,
+                    stride,
+                    widthInPixels,
+                    heightInPixels,
+                    dpi,
+                    format,
+                    alpha);
+
+                ThrowIfFailed(newBitmap.CopyTo(canvasBitmap));
+            });
+    }
+
     IFACEMETHODIMP CanvasBitmapFactory::CreateFromColors(
         ICanvasResourceCreator* resourceCreator,
         uint32_t colorCount,
@@ -1101,6 +1484,95 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             });
     }
 
+    IFACEMETHODIMP CanvasBitmapFactory::LoadCachedAsyncFromHstring(
+        ICanvasResourceCreator* resourceCreator,
+        HSTRING fileName,
+        ABI::Windows::Foundation::IAsyncOperation<CanvasBitmap*>** canvasBitmapAsyncOperation)
+    {
+        return LoadCachedAsyncFromHstringWithDpiAndAlpha(
+            resourceCreator,
+            fileName,
+            DEFAULT_DPI,
+            CanvasAlphaMode::Premultiplied,
+            canvasBitmapAsyncOperation);
+    }
+
+    IFACEMETHODIMP CanvasBitmapFactory::LoadCachedAsyncFromHstringWithDpiAndAlpha(
+        ICanvasResourceCreator* resourceCreator,
+        HSTRING rawFileName,
+        float dpi,
+        CanvasAlphaMode alpha,
+        ABI::Windows::Foundation::IAsyncOperation<CanvasBitmap*>** canvasBitmapAsyncOperation)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(resourceCreator);
+                CheckInPointer(rawFileName);
+                CheckAndClearOutPointer(canvasBitmapAsyncOperation);
+
+                ComPtr<ICanvasDevice> canvasDevice;
+                ThrowIfFailed(resourceCreator->get_Device(&canvasDevice));
+
+                WinString fileName(rawFileName);
+
+                auto asyncOperation = Make<AsyncOperation<CanvasBitmap>>(
+                    [=]
+                    {
+                        return CanvasBitmap::GetOrCreateCached(canvasDevice.Get(), fileName, dpi, alpha);
+                    });
+
+                CheckMakeResult(asyncOperation);
+                ThrowIfFailed(asyncOperation.CopyTo(canvasBitmapAsyncOperation));
+            });
+    }
+
+    IFACEMETHODIMP CanvasBitmapFactory::LoadCachedAsyncFromStream(
+        ICanvasResourceCreator* resourceCreator,
+        IRandomAccessStream* stream,
+        ABI::Windows::Foundation::IAsyncOperation<CanvasBitmap*>** canvasBitmapAsyncOperation)
+    {
+        return LoadCachedAsyncFromStreamWithDpiAndAlpha(
+            resourceCreator,
+            stream,
+            DEFAULT_DPI,
+            CanvasAlphaMode::Premultiplied,
+            canvasBitmapAsyncOperation);
+    }
+
+    IFACEMETHODIMP CanvasBitmapFactory::LoadCachedAsyncFromStreamWithDpiAndAlpha(
+        ICanvasResourceCreator* resourceCreator,
+        IRandomAccessStream* rawStream,
+        float dpi,
+        CanvasAlphaMode alpha,
+        ABI::Windows::Foundation::IAsyncOperation<CanvasBitmap*>** canvasBitmapAsyncOperation)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(resourceCreator);
+                CheckInPointer(rawStream);
+                CheckAndClearOutPointer(canvasBitmapAsyncOperation);
+
+                ComPtr<ICanvasDevice> canvasDevice;
+                ThrowIfFailed(resourceCreator->get_Device(&canvasDevice));
+
+                ComPtr<IRandomAccessStream> stream = rawStream;
+
+                auto asyncOperation = Make<AsyncOperation<CanvasBitmap>>(
+                [=]
+                {
+                    ComPtr<IStream> nativeStream;
+                    ThrowIfFailed(CreateStreamOverRandomAccessStream(stream.Get(), IID_PPV_ARGS(&nativeStream)));
+
+                    return CanvasBitmap::GetOrCreateCached(canvasDevice.Get(), nativeStream.Get(), dpi, alpha);
+                });
+
+                CheckMakeResult(asyncOperation);
+                ThrowIfFailed(asyncOperation.CopyTo(canvasBitmapAsyncOperation));
+            });
+    }
+
 
     //
     // CanvasBitmap
@@ -1115,7 +1587,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             && "CanvasBitmap should never be constructed with a render-target bitmap.  This should have been validated before construction.");
     }
 
-    static void CopyPixelBytes(
+    void CopyPixelBytes(
         BitmapSubRectangle const& r,
         uint32_t sourceStride,
         uint32_t destinationStride,
@@ -1205,6 +1677,95 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             stdext::make_checked_array_iterator(destination, capacity));
     }
 
+    void GetPixelBytesAsyncImpl(
+        ICanvasBitmap* bitmap,
+        ComPtr<ID2D1Bitmap1> const& d2dBitmap,
+        D2D1_RECT_U const& subRectangle,
+        IBuffer* buffer,
+        IAsyncAction** resultAsyncAction)
+    {
+        using ::Windows::Storage::Streams::IBufferByteAccess;
+
+        CheckInPointer(buffer);
+        CheckAndClearOutPointer(resultAsyncAction);
+
+        ComPtr<IBuffer> destinationBuffer = buffer;
+        auto byteAccess = As<IBufferByteAccess>(buffer);
+
+        BitmapSubRectangle r(d2dBitmap, subRectangle);
+
+        uint32_t capacity;
+        ThrowIfFailed(buffer->get_Capacity(&capacity));
+
+        if (capacity < r.GetTotalBytes())
+        {
+            WinStringBuilder message;
+            message.Format(Strings::WrongArrayLength, r.GetTotalBytes(), capacity);
+            ThrowHR(E_INVALIDARG, message.Get());
+        }
+
+        // The copy to a staging bitmap is issued here, so the result reflects
+        // the bitmap as it is now. Mapping it, which waits for the GPU, is left
+        // to the thread pool rather than stalling the caller. Readbacks from the
+        // same device share its queue, which bounds how many are in flight.
+        auto device = GetCanvasDevice(As<ICanvasResourceCreator>(bitmap).Get());
+        auto readback = std::make_shared<PixelReadbackFuture>(As<ICanvasDeviceInternal>(device)->EnqueuePixelReadback(bitmap, subRectangle));
+
+        auto asyncAction = Make<AsyncAction>(
+            [readback, destinationBuffer, byteAccess, capacity]
+            {
+                auto bytes = readback->Get();
+
+                ThrowIfFailed(destinationBuffer->put_Length(static_cast<uint32_t>(bytes.size())));
+
+                uint8_t* destination;
+                ThrowIfFailed(byteAccess->Buffer(&destination));
+
+                std::copy(bytes.begin(), bytes.end(), stdext::make_checked_array_iterator(destination, capacity));
+            });
+
+        CheckMakeResult(asyncAction);
+        ThrowIfFailed(asyncAction.CopyTo(resultAsyncAction));
+    }
+
+    void GetPixelBytesImpl(
+        ComPtr<ICanvasDevice> const& device,
+        ComPtr<ID2D1Bitmap1> const& d2dBitmap,
+        D2D1_RECT_U const& subRectangle,
+        DXGI_FORMAT targetFormat,
+        D2D1_ALPHA_MODE targetAlpha,
+        uint32_t* valueCount,
+        uint8_t** valueElements)
+    {
+        CheckInPointer(valueCount);
+        CheckAndClearOutPointer(valueElements);
+
+        VerifyWellFormedSubrectangle(subRectangle, d2dBitmap->GetPixelSize());
+
+        auto bitmapFormat = d2dBitmap->GetPixelFormat();
+
+        VerifyConvertiblePixelFormat(bitmapFormat.format, bitmapFormat.alphaMode);
+        VerifyConvertiblePixelFormat(targetFormat, targetAlpha);
+
+        const unsigned int subRectangleWidth = subRectangle.right - subRectangle.left;
+        const unsigned int subRectangleHeight = subRectangle.bottom - subRectangle.top;
+        const unsigned int targetBytesPerRow = subRectangleWidth * GetBytesPerBlock(targetFormat);
+
+        ScopedBitmapMappedPixelAccess bitmapPixelAccess(device.Get(), d2dBitmap.Get(), &subRectangle);
+
+        ComArray<uint8_t> array(targetBytesPerRow * subRectangleHeight);
+
+        ConvertPixels(
+            subRectangleWidth,
+            subRectangleHeight,
+            bitmapPixelAccess.GetLockedData(),
+            PixelLayout{ bitmapFormat.format, bitmapFormat.alphaMode, bitmapPixelAccess.GetStride() },
+            array.GetData(),
+            PixelLayout{ targetFormat, targetAlpha, targetBytesPerRow });
+
+        array.Detach(valueCount, valueElements);
+    }
+
     void GetPixelColorsImpl(
         ComPtr<ICanvasDevice> const& device,
         ComPtr<ID2D1Bitmap1> const& d2dBitmap,
@@ -1229,21 +1790,13 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         const unsigned int destSizeInPixels = subRectangleWidth * subRectangleHeight;
         ComArray<Color> array(destSizeInPixels);
 
-        byte* sourceRowStart = bitmapPixelAccess.GetLockedData();
-
-        for (unsigned int y = 0; y < subRectangleHeight; y++)
-        {
-            for (unsigned int x = 0; x < subRectangleWidth; x++)
-            {
-                uint32_t sourcePixel = *(reinterpret_cast<uint32_t*>(&sourceRowStart[x * 4]));
-                Color& destColor = array[y * subRectangleWidth + x];
-                destColor.B = (sourcePixel >> 0) & 0xFF;
-                destColor.G = (sourcePixel >> 8) & 0xFF;
-                destColor.R = (sourcePixel >> 16) & 0xFF;
-                destColor.A = (sourcePixel >> 24) & 0xFF;
-            }
-            sourceRowStart += bitmapPixelAccess.GetStride();
-        }
+        SwizzleColorAndBgra(
+            bitmapPixelAccess.GetLockedData(),
+            bitmapPixelAccess.GetStride(),
+            reinterpret_cast<uint8_t*>(array.GetData()),
+            subRectangleWidth * 4,
+            subRectangleWidth,
+            subRectangleHeight);
 
         array.Detach(valueCount, valueElements);
     }
@@ -1397,6 +1950,50 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         SetPixelBytesImpl(d2dBitmap, subRectangle, byteCount, bytes);
     }
 
+    void SetPixelBytesImpl(
+        ComPtr<ID2D1Bitmap1> const& d2dBitmap,
+        D2D1_RECT_U const& subRectangle,
+        DXGI_FORMAT sourceFormat,
+        D2D1_ALPHA_MODE sourceAlpha,
+        uint32_t valueCount,
+        uint8_t* valueElements)
+    {
+        CheckInPointer(valueElements);
+
+        VerifyWellFormedSubrectangle(subRectangle, d2dBitmap->GetPixelSize());
+
+        auto bitmapFormat = d2dBitmap->GetPixelFormat();
+
+        VerifyConvertiblePixelFormat(sourceFormat, sourceAlpha);
+        VerifyConvertiblePixelFormat(bitmapFormat.format, bitmapFormat.alphaMode);
+
+        const unsigned int subRectangleWidth = subRectangle.right - subRectangle.left;
+        const unsigned int subRectangleHeight = subRectangle.bottom - subRectangle.top;
+        const unsigned int sourceBytesPerRow = subRectangleWidth * GetBytesPerBlock(sourceFormat);
+        const unsigned int bitmapBytesPerRow = subRectangleWidth * GetBytesPerBlock(bitmapFormat.format);
+
+        const uint32_t expectedArraySize = sourceBytesPerRow * subRectangleHeight;
+        if (valueCount < expectedArraySize)
+        {
+            WinStringBuilder message;
+            message.Format(Strings::WrongArrayLength, expectedArraySize, valueCount);
+            ThrowHR(E_INVALIDARG, message.Get());
+        }
+
+        // Every byte is overwritten by the conversion, so there's no need to zero-initialize this.
+        std::unique_ptr<uint8_t[]> convertedValues(new uint8_t[bitmapBytesPerRow * subRectangleHeight]);
+
+        ConvertPixels(
+            subRectangleWidth,
+            subRectangleHeight,
+            valueElements,
+            PixelLayout{ sourceFormat, sourceAlpha, sourceBytesPerRow },
+            convertedValues.get(),
+            PixelLayout{ bitmapFormat.format, bitmapFormat.alphaMode, bitmapBytesPerRow });
+
+        ThrowIfFailed(d2dBitmap->CopyFromMemory(&subRectangle, convertedValues.get(), bitmapBytesPerRow));
+    }
+
     void SetPixelColorsImpl(
         ComPtr<ID2D1Bitmap1> const& d2dBitmap,
         D2D1_RECT_U const& subRectangle,
@@ -1423,9 +2020,12 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             ThrowHR(E_INVALIDARG, Strings::PixelColorsFormatRestriction);
         }
 
-        auto convertedValues = ConvertColorsToBgra(expectedArraySize, valueElements);
+        // Every byte is overwritten by the swizzle, so there's no need to zero-initialize this.
+        std::unique_ptr<uint8_t[]> convertedValues(new uint8_t[expectedArraySize * 4]);
+
+        SwizzleColorAndBgra(reinterpret_cast<uint8_t const*>(valueElements), convertedValues.get(), expectedArraySize);
 
-        ThrowIfFailed(d2dBitmap->CopyFromMemory(&subRectangle, convertedValues.data(), subRectangleWidth * 4));
+        ThrowIfFailed(d2dBitmap->CopyFromMemory(&subRectangle, convertedValues.get(), subRectangleWidth * 4));
     }
 
 
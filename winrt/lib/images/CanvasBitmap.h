@@ -24,6 +24,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
     bool FileFormatSupportsHdr(GUID const& containerFormat);
     GUID GetGUIDForFileFormat(CanvasBitmapFileFormat fileFormat);
+    GUID GetEncoderFromFileExtension(WinString fileName);
 
     struct WicBitmapSource
     {
@@ -45,6 +46,11 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         virtual ComPtr<IWICBitmapSource> CreateFlipRotator(
             ComPtr<IWICBitmapSource> const& source,
             WICBitmapTransformOptions transformOptions) = 0;
+
+        // Decodes all of the source's pixels into memory, so that nothing is
+        // left to decode when the bitmap is created from it.
+        virtual ComPtr<IWICBitmapSource> DecodeToMemory(
+            ComPtr<IWICBitmapSource> const& source) = 0;
     };
 
 
@@ -61,6 +67,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         virtual ComPtr<IWICBitmapSource> CreateFlipRotator(
             ComPtr<IWICBitmapSource> const& source,
             WICBitmapTransformOptions transformOptions) override;
+
+        virtual ComPtr<IWICBitmapSource> DecodeToMemory(
+            ComPtr<IWICBitmapSource> const& source) override;
     };
 
 
@@ -158,6 +167,17 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             CanvasAlphaMode alpha,
             ICanvasBitmap** canvasBitmap) override;
 
+        IFACEMETHOD(CreateFromBytesWithBufferAndStride)(
+            ICanvasResourceCreator* resourceCreator,
+            IBuffer* buffer,
+            int32_t widthInPixels,
+            int32_t heightInPixels,
+            uint32_t stride,
+            DirectXPixelFormat format,
+            float dpi,
+            CanvasAlphaMode alpha,
+            ICanvasBitmap** canvasBitmap) override;
+
         IFACEMETHOD(CreateFromColors)(
             ICanvasResourceCreator* resourceCreator,
             uint32_t colorCount,
@@ -246,6 +266,30 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             CanvasAlphaMode alpha,
             ABI::Windows::Foundation::IAsyncOperation<CanvasBitmap*>** canvasBitmapAsyncOperation) override;
 
+        IFACEMETHOD(LoadCachedAsyncFromHstring)(
+            ICanvasResourceCreator* resourceCreator,
+            HSTRING fileName,
+            ABI::Windows::Foundation::IAsyncOperation<CanvasBitmap*>** canvasBitmapAsyncOperation) override;
+
+        IFACEMETHOD(LoadCachedAsyncFromHstringWithDpiAndAlpha)(
+            ICanvasResourceCreator* resourceCreator,
+            HSTRING fileName,
+            float dpi,
+            CanvasAlphaMode alpha,
+            ABI::Windows::Foundation::IAsyncOperation<CanvasBitmap*>** canvasBitmapAsyncOperation) override;
+
+        IFACEMETHOD(LoadCachedAsyncFromStream)(
+            ICanvasResourceCreator* resourceCreator,
+            IRandomAccessStream* stream,
+            ABI::Windows::Foundation::IAsyncOperation<CanvasBitmap*>** canvasBitmapAsyncOperation) override;
+
+        IFACEMETHOD(LoadCachedAsyncFromStreamWithDpiAndAlpha)(
+            ICanvasResourceCreator* resourceCreator,
+            IRandomAccessStream* stream,
+            float dpi,
+            CanvasAlphaMode alpha,
+            ABI::Windows::Foundation::IAsyncOperation<CanvasBitmap*>** canvasBitmapAsyncOperation) override;
+
     private:
         HRESULT CreateFromDirect3D11SurfaceImpl(
             ICanvasResourceCreator* resourceCreator,
@@ -256,6 +300,35 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     };
 
 
+    //
+    // Validates a subrectangle of a bitmap, and describes the layout of its
+    // pixel bytes (taking block compressed formats into account).
+    //
+    class BitmapSubRectangle
+    {
+        unsigned m_totalBytes;
+        unsigned m_bytesPerRow;
+        unsigned m_blocksHigh;
+
+        DXGI_FORMAT m_format;
+
+    public:
+        BitmapSubRectangle(ComPtr<ID2D1Bitmap> const& d2dBitmap, D2D1_RECT_U const& rect);
+
+        unsigned GetTotalBytes() const { return m_totalBytes; }
+        unsigned GetBytesPerRow() const { return m_bytesPerRow; }
+        unsigned GetBlocksHigh() const { return m_blocksHigh; }
+
+        DXGI_FORMAT GetFormat() const { return m_format; }
+    };
+
+    void CopyPixelBytes(
+        BitmapSubRectangle const& r,
+        uint32_t sourceStride,
+        uint32_t destinationStride,
+        stdext::checked_array_iterator<uint8_t*> const& source,
+        stdext::checked_array_iterator<uint8_t*> const& destination);
+
     void GetPixelBytesImpl(
         ComPtr<ICanvasDevice> const& device,
         ComPtr<ID2D1Bitmap1> const& d2dBitmap,
@@ -269,6 +342,23 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         D2D1_RECT_U const& subRectangle,
         IBuffer* buffer);
 
+    void GetPixelBytesAsyncImpl(
+        ICanvasBitmap* bitmap,
+        ComPtr<ID2D1Bitmap1> const& d2dBitmap,
+        D2D1_RECT_U const& subRectangle,
+        IBuffer* buffer,
+        IAsyncAction** resultAsyncAction);
+
+    // Reads pixels converted to targetFormat and targetAlpha. See PixelFormatConversion.h.
+    void GetPixelBytesImpl(
+        ComPtr<ICanvasDevice> const& device,
+        ComPtr<ID2D1Bitmap1> const& d2dBitmap,
+        D2D1_RECT_U const& subRectangle,
+        DXGI_FORMAT targetFormat,
+        D2D1_ALPHA_MODE targetAlpha,
+        uint32_t* valueCount,
+        uint8_t** valueElements);
+
     void GetPixelColorsImpl(
         ComPtr<ICanvasDevice> const& device,
         ComPtr<ID2D1Bitmap1> const& d2dBitmap,
@@ -303,6 +393,15 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         D2D1_RECT_U const& subRectangle,
         IBuffer* buffer);
 
+    // Writes pixels that are in sourceFormat and sourceAlpha. See PixelFormatConversion.h.
+    void SetPixelBytesImpl(
+        ComPtr<ID2D1Bitmap1> const& d2dBitmap,
+        D2D1_RECT_U const& subRectangle,
+        DXGI_FORMAT sourceFormat,
+        D2D1_ALPHA_MODE sourceAlpha,
+        uint32_t valueCount,
+        uint8_t* valueElements);
+
     void SetPixelColorsImpl(
         ComPtr<ID2D1Bitmap1> const& d2dBitmap,
         D2D1_RECT_U const& subRectangle,
@@ -674,6 +773,68 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
                 });
         }
 
+        IFACEMETHODIMP GetPixelBytesWithFormat(
+            DirectXPixelFormat format,
+            CanvasAlphaMode alpha,
+            uint32_t* valueCount,
+            uint8_t** valueElements) override
+        {
+            return ExceptionBoundary(
+                [&]
+                {
+                    auto& d2dBitmap = GetResource();
+
+                    GetPixelBytesImpl(
+                        m_device,
+                        d2dBitmap,
+                        GetResourceBitmapExtents(d2dBitmap),
+                        static_cast<DXGI_FORMAT>(format),
+                        ToD2DAlphaMode(alpha),
+                        valueCount,
+                        valueElements);
+                });
+        }
+
+        IFACEMETHODIMP GetPixelBytesAsync(
+            IBuffer* buffer,
+            IAsyncAction** asyncAction) override
+        {
+            return ExceptionBoundary(
+                [&]
+                {
+                    auto& d2dBitmap = GetResource();
+
+                    GetPixelBytesAsyncImpl(
+                        this,
+                        d2dBitmap,
+                        GetResourceBitmapExtents(d2dBitmap),
+                        buffer,
+                        asyncAction);
+                });
+        }
+
+        IFACEMETHODIMP GetPixelBytesWithSubrectangleAsync(
+            IBuffer* buffer,
+            int32_t left,
+            int32_t top,
+            int32_t width,
+            int32_t height,
+            IAsyncAction** asyncAction) override
+        {
+            return ExceptionBoundary(
+                [&]
+                {
+                    auto& d2dBitmap = GetResource();
+
+                    GetPixelBytesAsyncImpl(
+                        this,
+                        d2dBitmap,
+                        ToD2DRectU(left, top, width, height),
+                        buffer,
+                        asyncAction);
+                });
+        }
+
         IFACEMETHODIMP GetPixelColors(
             uint32_t* valueCount,
             ABI::Windows::UI::Color **valueElements) override
@@ -786,6 +947,27 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
                 });
         }
 
+        IFACEMETHODIMP SetPixelBytesWithFormat(
+            uint32_t valueCount,
+            uint8_t* valueElements,
+            DirectXPixelFormat format,
+            CanvasAlphaMode alpha) override
+        {
+            return ExceptionBoundary(
+                [&]
+                {
+                    auto& d2dBitmap = GetResource();
+
+                    SetPixelBytesImpl(
+                        d2dBitmap,
+                        GetResourceBitmapExtents(d2dBitmap),
+                        static_cast<DXGI_FORMAT>(format),
+                        ToD2DAlphaMode(alpha),
+                        valueCount,
+                        valueElements);
+                });
+        }
+
         IFACEMETHODIMP SetPixelColors(
             uint32_t valueCount,
             ABI::Windows::UI::Color* valueElements) override
@@ -934,6 +1116,70 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             ICanvasDevice* device,
             ISoftwareBitmap* sourceBitmap);
 
+#endif
+
+        //
+        // Loads through the device's decoded bitmap cache, so that loading
+        // an image that is already on the device returns the existing bitmap.
+        // Files are identified by path and modification time, and streams by
+        // a hash of their contents. The returned bitmap may be shared with
+        // other callers, so it must not be modified or closed.
+        //
+        static ComPtr<CanvasBitmap> GetOrCreateCached(
+            ICanvasDevice* canvasDevice,
+            HSTRING fileName,
+            float dpi,
+            CanvasAlphaMode alpha);
+
+        static ComPtr<CanvasBitmap> GetOrCreateCached(
+            ICanvasDevice* canvasDevice,
+            IStream* fileStream,
+            float dpi,
+            CanvasAlphaMode alpha);
+
+        //
+        // Uploads pixels straight from the caller's memory, which may have
+        // padding at the end of each row, with no intermediate copy. If
+        // bitmapToReuse belongs to the same device and matches the requested
+        // size, format, alpha mode and DPI, its contents are replaced and it
+        // is returned, instead of allocating a new bitmap.
+        //
+        static ComPtr<ICanvasBitmap> CreateFromMemory(
+            ICanvasDevice* device,
+            uint32_t byteCount,
+            uint8_t const* bytes,
+            uint32_t stride,
+            int32_t widthInPixels,
+            int32_t heightInPixels,
+            float dpi,
+            DirectXPixelFormat format,
+            CanvasAlphaMode alpha,
+            ICanvasBitmap* bitmapToReuse = nullptr);
+
+        static ComPtr<ICanvasBitmap> CreateFromMemory(
+            ICanvasDevice* device,
+            IBuffer* buffer,
+            uint32_t stride,
+            int32_t widthInPixels,
+            int32_t heightInPixels,
+            float dpi,
+            DirectXPixelFormat format,
+            CanvasAlphaMode alpha,
+            ICanvasBitmap* bitmapToReuse = nullptr);
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+        static ComPtr<ICanvasBitmap> CreateFromMemory(
+            ICanvasDevice* device,
+            IMemoryBufferReference* buffer,
+            uint32_t stride,
+            int32_t widthInPixels,
+            int32_t heightInPixels,
+            float dpi,
+            DirectXPixelFormat format,
+            CanvasAlphaMode alpha,
+            ICanvasBitmap* bitmapToReuse = nullptr);
+
 #endif
 
         CanvasBitmap(
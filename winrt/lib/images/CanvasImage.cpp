@@ -33,7 +33,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
         auto d2dDeviceContext = GetDeviceContextForGetBounds(device.Get(), resourceCreator);
 
-        auto d2dImage = imageInternal->GetD2DImage(device.Get(), d2dDeviceContext.Get());
+        auto d2dImage = imageInternal->GetD2DImage(device.Get(), d2dDeviceContext.Get(), GetImageFlags::ReadDpiFromDeviceContext | GetImageFlags::NoLastingReference);
 
         D2D1_MATRIX_3X2_F previousTransform;
         d2dDeviceContext->GetTransform(&previousTransform);
@@ -25,6 +25,7 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         MinimalRealization          = 8,    // Do the bare minimum to get back an ID2D1Image - no validation or recursive realization
         AllowNullEffectInputs       = 16,   // Allow partially configured effect graphs where some inputs are null
         UnrealizeOnFailure          = 32,   // If an input is invalid, unrealize the effect and return null rather than throwing
+        NoLastingReference          = 64,   // The caller does not keep the image after the call, so an effect can still pool it later
     };
 
     DEFINE_ENUM_FLAG_OPERATORS(GetImageFlags)
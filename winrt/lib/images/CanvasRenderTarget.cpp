@@ -158,6 +158,66 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             });
     }
 
+    IFACEMETHODIMP CanvasRenderTargetFactory::CreateTransient(
+        ICanvasResourceCreatorWithDpi* resourceCreator,
+        float width,
+        float height,
+        ICanvasRenderTarget** renderTarget)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(resourceCreator);
+                CheckAndClearOutPointer(renderTarget);
+
+                float dpi;
+                ThrowIfFailed(resourceCreator->get_Dpi(&dpi));
+
+                ComPtr<ICanvasDevice> canvasDevice;
+                ThrowIfFailed(As<ICanvasResourceCreator>(resourceCreator)->get_Device(&canvasDevice));
+
+                auto newRenderTarget = CanvasRenderTarget::CreateTransient(
+                    canvasDevice.Get(),
+                    width,
+                    height,
+                    dpi,
+                    PIXEL_FORMAT(B8G8R8A8UIntNormalized),
+                    CanvasAlphaMode::Premultiplied);
+
+                ThrowIfFailed(newRenderTarget.CopyTo(renderTarget));
+            });
+    }
+
+    IFACEMETHODIMP CanvasRenderTargetFactory::CreateTransientWithDpiAndFormatAndAlpha(
+        ICanvasResourceCreator* resourceCreator,
+        float width,
+        float height,
+        float dpi,
+        DirectXPixelFormat format,
+        CanvasAlphaMode alpha,
+        ICanvasRenderTarget** renderTarget)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(resourceCreator);
+                CheckAndClearOutPointer(renderTarget);
+
+                ComPtr<ICanvasDevice> canvasDevice;
+                ThrowIfFailed(resourceCreator->get_Device(&canvasDevice));
+
+                auto newRenderTarget = CanvasRenderTarget::CreateTransient(
+                    canvasDevice.Get(),
+                    width,
+                    height,
+                    dpi,
+                    format,
+                    alpha);
+
+                ThrowIfFailed(newRenderTarget.CopyTo(renderTarget));
+            });
+    }
+
 
     static ComPtr<ICanvasDrawingSession> CreateDrawingSessionOverD2DBitmap(
         ICanvasDevice* owner,
@@ -212,6 +272,26 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     }
 
 
+    ComPtr<CanvasRenderTarget> CanvasRenderTarget::CreateTransient(
+        ICanvasDevice* canvasDevice,
+        float width,
+        float height,
+        float dpi,
+        DirectXPixelFormat format,
+        CanvasAlphaMode alpha)
+    {
+        ComPtr<ICanvasDeviceInternal> canvasDeviceInternal;
+        ThrowIfFailed(canvasDevice->QueryInterface(canvasDeviceInternal.GetAddressOf()));
+
+        auto bitmapLease = canvasDeviceInternal->LeaseTransientRenderTarget(width, height, dpi, format, alpha);
+
+        auto renderTarget = Make<CanvasRenderTarget>(canvasDevice, std::move(bitmapLease));
+        CheckMakeResult(renderTarget);
+
+        return renderTarget;
+    }
+
+
     CanvasRenderTarget::CanvasRenderTarget(
         ICanvasDevice* canvasDevice,
         ID2D1Bitmap1* d2dBitmap)
@@ -223,6 +303,55 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     }
 
 
+    CanvasRenderTarget::CanvasRenderTarget(
+        ICanvasDevice* canvasDevice,
+        TransientRenderTargetLease&& transientLease)
+        : CanvasBitmapImpl(canvasDevice, transientLease.Get())
+        , m_hasActiveDrawingSession(std::make_shared<bool>())
+        , m_transientPoolOwner(canvasDevice)
+        , m_transientLease(std::move(transientLease))
+    {
+        assert(IsRenderTargetBitmap(m_transientLease.Get()));
+    }
+
+
+    CanvasRenderTarget::~CanvasRenderTarget()
+    {
+        ReturnTransientBitmap();
+    }
+
+
+    IFACEMETHODIMP CanvasRenderTarget::Close()
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                ReturnTransientBitmap();
+                ThrowIfFailed(CanvasBitmapImpl::Close());
+            });
+    }
+
+
+    void CanvasRenderTarget::ReturnTransientBitmap()
+    {
+        if (!m_transientPoolOwner)
+            return;
+
+        // Unregister the bitmap before it goes back to the pool, where another
+        // thread may take it and wrap it in a new CanvasRenderTarget.
+        CanvasBitmapImpl::Close();
+
+        // A drawing session that is still open would keep drawing to the
+        // bitmap after it had been handed out again.
+        if (*m_hasActiveDrawingSession)
+            m_transientLease.Discard();
+        else
+            m_transientLease.Close();
+
+        m_transientPoolOwner.Reset();
+    }
+
+
     IFACEMETHODIMP CanvasRenderTarget::CreateDrawingSession(
         _COM_Outptr_ ICanvasDrawingSession** drawingSession)
     {
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "drawing/TransientRenderTargetPool.h"
+
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 {
     using namespace ::Microsoft::WRL;
@@ -63,6 +65,21 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             float dpi,
             CanvasAlphaMode alpha,
             ICanvasRenderTarget** canvasRenderTarget) override;
+
+        IFACEMETHOD(CreateTransient)(
+            ICanvasResourceCreatorWithDpi* resourceCreator,
+            float width,
+            float height,
+            ICanvasRenderTarget** renderTarget) override;
+
+        IFACEMETHOD(CreateTransientWithDpiAndFormatAndAlpha)(
+            ICanvasResourceCreator* resourceCreator,
+            float width,
+            float height,
+            float dpi,
+            DirectXPixelFormat format,
+            CanvasAlphaMode alpha,
+            ICanvasRenderTarget** renderTarget) override;
     };
 
 
@@ -85,6 +102,12 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
         std::shared_ptr<bool> m_hasActiveDrawingSession;
 
+        // Only used by render targets from CreateTransient. The device owns
+        // the pool that the bitmap goes back to, so it is declared first, to
+        // be released after the lease.
+        ComPtr<ICanvasDevice> m_transientPoolOwner;
+        TransientRenderTargetLease m_transientLease;
+
     public:
         static ComPtr<CanvasRenderTarget> CreateNew(
             ICanvasDevice* canvasDevice,
@@ -94,11 +117,36 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
             DirectXPixelFormat format,
             CanvasAlphaMode alpha);
 
+        // Takes a bitmap from the device's transient render target pool, for
+        // intermediate results that only live for part of a frame. Closing
+        // or releasing the render target hands the bitmap back to the pool.
+        // The contents are undefined until drawn to.
+        static ComPtr<CanvasRenderTarget> CreateTransient(
+            ICanvasDevice* canvasDevice,
+            float width,
+            float height,
+            float dpi,
+            DirectXPixelFormat format,
+            CanvasAlphaMode alpha);
+
         CanvasRenderTarget(
             ICanvasDevice* device,
             ID2D1Bitmap1* bitmap);
 
+        CanvasRenderTarget(
+            ICanvasDevice* device,
+            TransientRenderTargetLease&& transientLease);
+
+        ~CanvasRenderTarget();
+
         IFACEMETHOD(CreateDrawingSession)(
             ICanvasDrawingSession** drawingSession) override;
+
+        IFACEMETHOD(Close)() override;
+
+    private:
+        void ReturnTransientBitmap();
     };
+
+
 }}}}
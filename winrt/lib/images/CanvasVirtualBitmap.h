@@ -129,6 +129,12 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 
         // ICanvasImageInternal
         ComPtr<ID2D1Image> GetD2DImage(ICanvasDevice* , ID2D1DeviceContext*, GetImageFlags, float, float*) override;
+
+        // Used by VirtualBitmapTileManager, which caches regions of the
+        // underlying image source. This is null if the wrapped image did not
+        // come from WIC.
+        ComPtr<ID2D1ImageSourceFromWic> const& GetImageSourceFromWic() const { return m_imageSourceFromWic; }
+        D2D1_ORIENTATION GetD2DOrientation() const { return m_orientation; }
     };
 
 }}}}
@@ -0,0 +1,264 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "PixelReadbackQueue.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    struct PendingReadback
+    {
+        // The device owns the pool that the staging bitmap is returned to, so must outlive the lease.
+        ComPtr<ICanvasDevice> Device;
+        StagingBitmapLease StagingBitmap;
+        BitmapSubRectangle SubRectangle;
+        unsigned Height;
+        uint64_t Sequence;
+        std::promise<std::vector<uint8_t>> Result;
+
+        PendingReadback(ComPtr<ICanvasDevice> const& device, BitmapSubRectangle const& subRectangle, unsigned height)
+            : Device(device)
+            , SubRectangle(subRectangle)
+            , Height(height)
+            , Sequence(0)
+        {
+        }
+
+        void Complete();
+    };
+
+
+    // Shared between the queue and its futures, which hold it weakly so that
+    // destroying the queue still breaks the promises of in flight readbacks.
+    struct PixelReadbackFuture::State
+    {
+        std::mutex Mutex;
+        uint64_t NextSequence;
+
+        // Ordered from oldest to newest.
+        std::queue<std::unique_ptr<PendingReadback>> PendingReadbacks;
+
+        State()
+            : NextSequence(0)
+        {
+        }
+    };
+
+
+    //
+    // PixelReadbackFuture
+    //
+
+    PixelReadbackFuture::PixelReadbackFuture()
+        : m_sequence(0)
+    {
+    }
+
+
+    PixelReadbackFuture::PixelReadbackFuture(std::weak_ptr<State> const& queueState, uint64_t sequence, std::future<std::vector<uint8_t>>&& result)
+        : m_queueState(queueState)
+        , m_sequence(sequence)
+        , m_result(std::move(result))
+    {
+    }
+
+
+    PixelReadbackFuture::PixelReadbackFuture(PixelReadbackFuture&& other)
+        : m_queueState(std::move(other.m_queueState))
+        , m_sequence(other.m_sequence)
+        , m_result(std::move(other.m_result))
+    {
+    }
+
+
+    PixelReadbackFuture& PixelReadbackFuture::operator=(PixelReadbackFuture&& other)
+    {
+        m_queueState = std::move(other.m_queueState);
+        m_sequence = other.m_sequence;
+        m_result = std::move(other.m_result);
+        return *this;
+    }
+
+
+    bool PixelReadbackFuture::IsValid() const
+    {
+        return m_result.valid();
+    }
+
+
+    bool PixelReadbackFuture::IsReady() const
+    {
+        return m_result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+
+    void PixelReadbackFuture::Wait()
+    {
+        if (!IsReady())
+        {
+            // If another thread has already taken this readback off the queue, this
+            // does nothing and we wait below for that thread to finish mapping it.
+            if (auto queueState = m_queueState.lock())
+            {
+                PixelReadbackQueue::CompleteThrough(*queueState, m_sequence);
+            }
+        }
+
+        m_result.wait();
+    }
+
+
+    std::vector<uint8_t> PixelReadbackFuture::Get()
+    {
+        Wait();
+
+        return m_result.get();
+    }
+
+
+    //
+    // PixelReadbackQueue
+    //
+
+    PixelReadbackQueue::PixelReadbackQueue(uint32_t latency)
+        : m_state(std::make_shared<State>())
+        , m_latency(latency)
+    {
+    }
+
+
+    PixelReadbackFuture PixelReadbackQueue::Enqueue(ICanvasBitmap* bitmap)
+    {
+        CheckInPointer(bitmap);
+
+        auto& d2dBitmap = As<ICanvasBitmapInternal>(bitmap)->GetD2DBitmap();
+        auto size = d2dBitmap->GetPixelSize();
+
+        return Enqueue(bitmap, D2D1::RectU(0, 0, size.width, size.height));
+    }
+
+
+    PixelReadbackFuture PixelReadbackQueue::Enqueue(ICanvasBitmap* bitmap, D2D1_RECT_U const& subRectangle)
+    {
+        CheckInPointer(bitmap);
+
+        auto& d2dBitmap = As<ICanvasBitmapInternal>(bitmap)->GetD2DBitmap();
+        auto device = GetCanvasDevice(As<ICanvasResourceCreator>(bitmap).Get());
+
+        auto readback = std::make_unique<PendingReadback>(
+            device,
+            BitmapSubRectangle(d2dBitmap, subRectangle),
+            subRectangle.bottom - subRectangle.top);
+
+        // Start the GPU copy, but don't wait for it.
+        readback->StagingBitmap = ScopedBitmapMappedPixelAccess::CopyToStagingBitmap(device.Get(), d2dBitmap.Get(), &subRectangle);
+
+        auto result = readback->Result.get_future();
+
+        // Take the readbacks that are now too old to leave in flight. These are
+        // completed without holding the lock, as mapping may have to wait for the GPU.
+        std::vector<std::unique_ptr<PendingReadback>> dueReadbacks;
+        uint64_t sequence;
+
+        {
+            Lock lock(m_state->Mutex);
+
+            sequence = m_state->NextSequence++;
+            readback->Sequence = sequence;
+
+            m_state->PendingReadbacks.push(std::move(readback));
+
+            while (m_state->PendingReadbacks.size() > m_latency)
+            {
+                dueReadbacks.push_back(std::move(m_state->PendingReadbacks.front()));
+                m_state->PendingReadbacks.pop();
+            }
+        }
+
+        for (auto& dueReadback : dueReadbacks)
+        {
+            dueReadback->Complete();
+        }
+
+        return PixelReadbackFuture(m_state, sequence, std::move(result));
+    }
+
+
+    void PixelReadbackQueue::Flush()
+    {
+        CompleteThrough(*m_state, UINT64_MAX);
+    }
+
+
+    void PixelReadbackQueue::Close()
+    {
+        std::queue<std::unique_ptr<PendingReadback>> abandonedReadbacks;
+
+        {
+            Lock lock(m_state->Mutex);
+
+            std::swap(abandonedReadbacks, m_state->PendingReadbacks);
+        }
+
+        // Released without holding the lock, as each releases a reference to its device.
+    }
+
+
+    uint32_t PixelReadbackQueue::GetPendingCount()
+    {
+        Lock lock(m_state->Mutex);
+
+        return static_cast<uint32_t>(m_state->PendingReadbacks.size());
+    }
+
+
+    void PixelReadbackQueue::CompleteThrough(State& state, uint64_t sequence)
+    {
+        std::vector<std::unique_ptr<PendingReadback>> dueReadbacks;
+
+        {
+            Lock lock(state.Mutex);
+
+            while (!state.PendingReadbacks.empty() && state.PendingReadbacks.front()->Sequence <= sequence)
+            {
+                dueReadbacks.push_back(std::move(state.PendingReadbacks.front()));
+                state.PendingReadbacks.pop();
+            }
+        }
+
+        for (auto& dueReadback : dueReadbacks)
+        {
+            dueReadback->Complete();
+        }
+    }
+
+
+    void PendingReadback::Complete()
+    {
+        try
+        {
+            auto& r = SubRectangle;
+
+            std::vector<uint8_t> bytes(r.GetTotalBytes());
+
+            {
+                ScopedBitmapMappedPixelAccess bitmapPixelAccess(Device.Get(), std::move(StagingBitmap), Height);
+
+                CopyPixelBytes(
+                    r,
+                    bitmapPixelAccess.GetStride(),
+                    r.GetBytesPerRow(),
+                    begin(bitmapPixelAccess),
+                    stdext::make_checked_array_iterator(bytes.data(), bytes.size()));
+            }
+
+            Result.set_value(std::move(bytes));
+        }
+        catch (...)
+        {
+            Result.set_exception(std::current_exception());
+        }
+    }
+
+}}}}
@@ -0,0 +1,103 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    class PixelReadbackQueue;
+
+
+    //
+    // Result of PixelReadbackQueue::Enqueue.
+    //
+    // Like a std::future for the pixel bytes, except that Get and Wait do not
+    // rely on some later call to the queue: if the readback is still in flight,
+    // they complete it (along with any readbacks queued before it) on the calling
+    // thread. IsReady only reports whether the readback has already completed.
+    //
+    class PixelReadbackFuture
+    {
+        struct State;
+
+        std::weak_ptr<State> m_queueState;
+        uint64_t m_sequence;
+        std::future<std::vector<uint8_t>> m_result;
+
+        friend class PixelReadbackQueue;
+
+        PixelReadbackFuture(std::weak_ptr<State> const& queueState, uint64_t sequence, std::future<std::vector<uint8_t>>&& result);
+
+    public:
+        PixelReadbackFuture();
+
+        PixelReadbackFuture(PixelReadbackFuture&& other);
+        PixelReadbackFuture& operator=(PixelReadbackFuture&& other);
+
+        PixelReadbackFuture(PixelReadbackFuture const&) = delete;
+        PixelReadbackFuture& operator=(PixelReadbackFuture const&) = delete;
+
+        bool IsValid() const;
+        bool IsReady() const;
+
+        void Wait();
+
+        // Can only be called once, as with std::future::get.
+        std::vector<uint8_t> Get();
+    };
+
+
+    //
+    // Pipelined alternative to CanvasBitmap.GetPixelBytes.
+    //
+    // GetPixelBytes maps its staging bitmap straight after copying into it, so
+    // the CPU stalls until the GPU has caught up. Enqueue only starts the copy,
+    // and returns a future for the pixel bytes. Staging bitmaps are mapped in
+    // the order they were queued, once more than Latency readbacks are in
+    // flight, when Flush is called, or when a future's Get or Wait needs the
+    // result. So a caller that captures once per frame, and only asks for
+    // each result once it is ready, receives each frame's pixels Latency
+    // frames later, by which time the GPU has normally finished with it.
+    //
+    // Errors that happen while mapping are reported through the future. If the
+    // queue is destroyed with readbacks still in flight, their futures report
+    // std::future_errc::broken_promise.
+    //
+    class PixelReadbackQueue : private LifespanTracker<PixelReadbackQueue>
+    {
+        typedef PixelReadbackFuture::State State;
+
+        std::shared_ptr<State> m_state;
+        uint32_t m_latency;
+
+    public:
+        static const uint32_t DefaultLatency = 2;
+
+        PixelReadbackQueue(uint32_t latency = DefaultLatency);
+
+        PixelReadbackQueue(PixelReadbackQueue const&) = delete;
+        PixelReadbackQueue& operator=(PixelReadbackQueue const&) = delete;
+
+        PixelReadbackFuture Enqueue(ICanvasBitmap* bitmap);
+        PixelReadbackFuture Enqueue(ICanvasBitmap* bitmap, D2D1_RECT_U const& subRectangle);
+
+        // Completes every readback that is still in flight.
+        void Flush();
+
+        // Abandons every readback that is still in flight, without waiting for
+        // the GPU. Their futures report std::future_errc::broken_promise.
+        void Close();
+
+        uint32_t GetLatency() const { return m_latency; }
+
+        uint32_t GetPendingCount();
+
+    private:
+        friend class PixelReadbackFuture;
+
+        // Completes, in order, the in flight readbacks up to and including this one.
+        static void CompleteThrough(State& state, uint64_t sequence);
+    };
+
+}}}}
@@ -7,53 +7,77 @@
 
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 {
-    ScopedBitmapMappedPixelAccess::ScopedBitmapMappedPixelAccess(ICanvasDevice* device, ID2D1Bitmap1* d2dBitmap, D2D1_RECT_U const* optionalSubRectangle)
+    static D2D1_SIZE_U GetCopySize(ID2D1Bitmap1* d2dBitmap, D2D1_RECT_U const* optionalSubRectangle)
     {
-        auto bitmapSize = d2dBitmap->GetPixelSize();
-        
-        auto bitmapOptions = D2D1_BITMAP_OPTIONS_CPU_READ | 
-                             D2D1_BITMAP_OPTIONS_CANNOT_DRAW;
-        
-        D2D1_BITMAP_PROPERTIES1 bitmapProperties = D2D1::BitmapProperties1(bitmapOptions, d2dBitmap->GetPixelFormat());
-
-        if (optionalSubRectangle)
+        if (!optionalSubRectangle)
+            return d2dBitmap->GetPixelSize();
+
+        assert(optionalSubRectangle->right > optionalSubRectangle->left);
+        assert(optionalSubRectangle->bottom > optionalSubRectangle->top);
+
+        return D2D1_SIZE_U
         {
-            assert(optionalSubRectangle->right > optionalSubRectangle->left);
-            assert(optionalSubRectangle->bottom > optionalSubRectangle->top);
+            optionalSubRectangle->right - optionalSubRectangle->left,
+            optionalSubRectangle->bottom - optionalSubRectangle->top
+        };
+    }
+
+
+    ScopedBitmapMappedPixelAccess::ScopedBitmapMappedPixelAccess(ICanvasDevice* device, ID2D1Bitmap1* d2dBitmap, D2D1_RECT_U const* optionalSubRectangle)
+        : m_device(device)
+    {
+        m_stagingResource = CopyToStagingBitmap(device, d2dBitmap, optionalSubRectangle);
+
+        Map(GetCopySize(d2dBitmap, optionalSubRectangle).height);
+    }
 
-            bitmapSize.width = optionalSubRectangle->right - optionalSubRectangle->left;
-            bitmapSize.height = optionalSubRectangle->bottom - optionalSubRectangle->top;
-        }
 
-        auto deviceContext = As<ICanvasDeviceInternal>(device)->GetResourceCreationDeviceContext();
+    ScopedBitmapMappedPixelAccess::ScopedBitmapMappedPixelAccess(ICanvasDevice* device, StagingBitmapLease&& stagingBitmap, unsigned int height)
+        : m_device(device)
+        , m_stagingResource(std::move(stagingBitmap))
+    {
+        Map(height);
+    }
+
 
-        ThrowIfFailed(deviceContext->CreateBitmap(
-            bitmapSize, 
-            nullptr,
-            0,
-            &bitmapProperties,
-            &m_stagingResource));
+    StagingBitmapLease ScopedBitmapMappedPixelAccess::CopyToStagingBitmap(ICanvasDevice* device, ID2D1Bitmap1* d2dBitmap, D2D1_RECT_U const* optionalSubRectangle)
+    {
+        //
+        // Staging bitmaps come from a per-device pool, so may be larger
+        // than the requested size.
+        //
+        auto stagingBitmap = As<ICanvasDeviceInternal>(device)->LeaseStagingBitmap(
+            GetCopySize(d2dBitmap, optionalSubRectangle),
+            d2dBitmap->GetPixelFormat());
 
         // 
         // This class copies only the requested subrectangle, not the
         // whole texture, in the interest of a small perf gain.
         // The copied area is located at (0,0).
         //
-        ThrowIfFailed(m_stagingResource->CopyFromBitmap(
+        ThrowIfFailed(stagingBitmap->CopyFromBitmap(
             nullptr, 
             d2dBitmap,
             optionalSubRectangle));
 
+        return stagingBitmap;
+    }
+
+
+    void ScopedBitmapMappedPixelAccess::Map(unsigned int height)
+    {
+        // This waits for the GPU to finish copying into the staging bitmap.
         ThrowIfFailed(m_stagingResource->Map(
             D2D1_MAP_OPTIONS_READ,
             &m_mappedSubresource));
 
-        m_lockedBufferSize = m_mappedSubresource.pitch * bitmapSize.height;
+        m_lockedBufferSize = m_mappedSubresource.pitch * height;
     }
 
 
     ScopedBitmapMappedPixelAccess::~ScopedBitmapMappedPixelAccess()
     {
+        // Unmapped before the lease hands the staging bitmap back to the pool.
         ThrowIfFailed(m_stagingResource->Unmap());
     }
 
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "drawing/StagingBitmapPool.h"
 #include "utils/D2DResourceLock.h"
 
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
@@ -12,15 +13,28 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     {
         D2D1_MAPPED_RECT m_mappedSubresource;
         unsigned int m_lockedBufferSize;
-        ComPtr<ID2D1Bitmap1> m_stagingResource;
+
+        // The device owns the pool that the staging bitmap is returned to, so must outlive the lease.
+        ComPtr<ICanvasDevice> m_device;
+        StagingBitmapLease m_stagingResource;
 
     public:
         ScopedBitmapMappedPixelAccess(ICanvasDevice* device, ID2D1Bitmap1* d2dBitmap, D2D1_RECT_U const* optionalSubRectangle = nullptr);
+
+        // Maps a staging bitmap that was filled by an earlier call to CopyToStagingBitmap.
+        ScopedBitmapMappedPixelAccess(ICanvasDevice* device, StagingBitmapLease&& stagingBitmap, unsigned int height);
+
         ~ScopedBitmapMappedPixelAccess();
 
+        // Starts copying pixels into a staging bitmap, without waiting for the GPU to finish.
+        static StagingBitmapLease CopyToStagingBitmap(ICanvasDevice* device, ID2D1Bitmap1* d2dBitmap, D2D1_RECT_U const* optionalSubRectangle = nullptr);
+
         uint8_t* GetLockedData()           const { return m_mappedSubresource.bits; }
         unsigned int GetLockedBufferSize() const { return m_lockedBufferSize; }
         unsigned int GetStride()           const { return m_mappedSubresource.pitch; }
+
+    private:
+        void Map(unsigned int height);
     };
 
 
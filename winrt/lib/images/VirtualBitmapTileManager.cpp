@@ -0,0 +1,496 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include "CanvasVirtualBitmap.h"
+#include "VirtualBitmapTileManager.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    static double GetTimeInSeconds()
+    {
+        LARGE_INTEGER counter;
+        LARGE_INTEGER frequency;
+
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+
+        return static_cast<double>(counter.QuadPart) / static_cast<double>(frequency.QuadPart);
+    }
+
+
+    static bool IsRotatedSideways(D2D1_ORIENTATION orientation)
+    {
+        switch (orientation)
+        {
+        case D2D1_ORIENTATION_ROTATE_CLOCKWISE90:
+        case D2D1_ORIENTATION_ROTATE_CLOCKWISE90_FLIP_HORIZONTAL:
+        case D2D1_ORIENTATION_ROTATE_CLOCKWISE270:
+        case D2D1_ORIENTATION_ROTATE_CLOCKWISE270_FLIP_HORIZONTAL:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+
+    static D2D1_SIZE_U GetSourceSize(D2D1_SIZE_U const& size, D2D1_ORIENTATION orientation)
+    {
+        if (IsRotatedSideways(orientation))
+            return D2D1_SIZE_U{ size.height, size.width };
+        else
+            return size;
+    }
+
+
+    static void AddToBounds(D2D1_RECT_U& bounds, D2D1_RECT_U const& rect)
+    {
+        if (bounds.left >= bounds.right || bounds.top >= bounds.bottom)
+        {
+            bounds = rect;
+            return;
+        }
+
+        bounds.left = std::min(bounds.left, rect.left);
+        bounds.top = std::min(bounds.top, rect.top);
+        bounds.right = std::max(bounds.right, rect.right);
+        bounds.bottom = std::max(bounds.bottom, rect.bottom);
+    }
+
+
+    static ComPtr<ID2D1ImageSourceFromWic> GetCachedOnDemandImageSource(CanvasVirtualBitmap* bitmap)
+    {
+        CheckInPointer(bitmap);
+
+        boolean isCachedOnDemand;
+        ThrowIfFailed(bitmap->get_IsCachedOnDemand(&isCachedOnDemand));
+
+        // Otherwise D2D decodes the whole image up front, so there are no
+        // tiles to manage.
+        if (!isCachedOnDemand)
+            ThrowHR(E_INVALIDARG);
+
+        return bitmap->GetImageSourceFromWic();
+    }
+
+
+    static D2D1_SIZE_U GetSizeInPixels(CanvasVirtualBitmap* bitmap)
+    {
+        BitmapSize size;
+        ThrowIfFailed(bitmap->get_SizeInPixels(&size));
+
+        return D2D1_SIZE_U{ size.Width, size.Height };
+    }
+
+
+    VirtualBitmapTileManager::VirtualBitmapTileManager(CanvasVirtualBitmap* bitmap, Options const& options)
+        : VirtualBitmapTileManager(bitmap, GetCachedOnDemandImageSource(bitmap), options)
+    {
+    }
+
+
+    VirtualBitmapTileManager::VirtualBitmapTileManager(CanvasVirtualBitmap* bitmap, ComPtr<ID2D1ImageSourceFromWic> const& imageSource, Options const& options)
+        : VirtualBitmapTileManager(
+            GetSizeInPixels(bitmap),
+            bitmap->GetD2DOrientation(),
+            [imageSource] (D2D1_RECT_U const& tile) { ThrowIfFailed(imageSource->EnsureCached(&tile)); },
+            [imageSource] (D2D1_RECT_U const& rectangleToPreserve) { ThrowIfFailed(imageSource->TrimCache(&rectangleToPreserve)); },
+            options)
+    {
+    }
+
+
+    VirtualBitmapTileManager::VirtualBitmapTileManager(
+        D2D1_SIZE_U const& size,
+        D2D1_ORIENTATION orientation,
+        LoadTileFunction const& loadTile,
+        TrimFunction const& trim,
+        Options const& options)
+        : m_size(size)
+        , m_orientation(orientation)
+        , m_loadTile(loadTile)
+        , m_trim(trim)
+        , m_isShuttingDown(false)
+        , m_scheduler(GetSourceSize(size, orientation), options.Scheduling)
+    {
+        if (!m_loadTile || !m_trim)
+            ThrowHR(E_INVALIDARG);
+
+        auto workerCount = options.MaximumConcurrency ? options.MaximumConcurrency : std::max(std::thread::hardware_concurrency(), 1U);
+
+        try
+        {
+            for (uint32_t i = 0; i < workerCount; i++)
+            {
+                m_workers.emplace_back([this] { WorkerThread(); });
+            }
+        }
+        catch (...)
+        {
+            // Stop any workers that did start.
+            {
+                Lock lock(m_mutex);
+                m_isShuttingDown = true;
+            }
+
+            m_workAvailable.notify_all();
+
+            for (auto& worker : m_workers)
+            {
+                worker.join();
+            }
+
+            throw;
+        }
+    }
+
+
+    VirtualBitmapTileManager::~VirtualBitmapTileManager()
+    {
+        {
+            Lock lock(m_mutex);
+            m_isShuttingDown = true;
+            m_queue.clear();
+        }
+
+        m_workAvailable.notify_all();
+        m_idle.notify_all();
+
+        for (auto& worker : m_workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+    }
+
+
+    void VirtualBitmapTileManager::SetViewport(Rect const& viewport)
+    {
+        SetViewport(viewport, GetTimeInSeconds());
+    }
+
+
+    void VirtualBitmapTileManager::SetViewport(Rect const& viewport, double time)
+    {
+        // Round outwards to whole pixels, within the image.
+        auto left = std::max(std::floor(viewport.X), 0.0f);
+        auto top = std::max(std::floor(viewport.Y), 0.0f);
+        auto right = std::min(std::ceil(viewport.X + viewport.Width), static_cast<float>(m_size.width));
+        auto bottom = std::min(std::ceil(viewport.Y + viewport.Height), static_cast<float>(m_size.height));
+
+        D2D1_RECT_U pixels{};
+
+        if (left < right && top < bottom)
+        {
+            pixels = D2D1_RECT_U
+            {
+                static_cast<uint32_t>(left),
+                static_cast<uint32_t>(top),
+                static_cast<uint32_t>(right),
+                static_cast<uint32_t>(bottom)
+            };
+        }
+
+        auto sourceRect = MapToSourceRect(pixels, m_orientation, GetSourceSize(m_size, m_orientation));
+
+        {
+            Lock lock(m_mutex);
+
+            auto tiles = m_scheduler.UpdateViewport(sourceRect, time);
+
+            m_queue.clear();
+
+            for (auto& tile : tiles)
+            {
+                if (m_loading.find(VirtualBitmapTileScheduler::GetKey(tile)) == m_loading.end())
+                    m_queue.push_back(tile);
+            }
+        }
+
+        m_workAvailable.notify_all();
+        m_idle.notify_all();
+    }
+
+
+    void VirtualBitmapTileManager::WaitForIdle()
+    {
+        Lock lock(m_mutex);
+
+        m_idle.wait(lock, [&] { return m_isShuttingDown || (m_queue.empty() && m_loading.empty()); });
+    }
+
+
+    uint32_t VirtualBitmapTileManager::GetQueuedCount()
+    {
+        Lock lock(m_mutex);
+
+        return static_cast<uint32_t>(m_queue.size());
+    }
+
+
+    VirtualBitmapTileStatistics VirtualBitmapTileManager::GetStatistics()
+    {
+        Lock lock(m_mutex);
+
+        return m_scheduler.GetStatistics();
+    }
+
+
+    void VirtualBitmapTileManager::WorkerThread()
+    {
+        Wrappers::RoInitializeWrapper initialize(RO_INIT_MULTITHREADED);
+
+        Lock lock(m_mutex);
+
+        for (;;)
+        {
+            m_workAvailable.wait(lock, [&] { return m_isShuttingDown || !m_queue.empty(); });
+
+            if (m_isShuttingDown)
+                return;
+
+            auto tile = m_queue.front();
+            m_queue.pop_front();
+
+            auto key = VirtualBitmapTileScheduler::GetKey(tile);
+            m_loading.insert(key);
+
+            auto bounds = m_scheduler.GetTileBounds(tile);
+
+            lock.unlock();
+
+            bool loaded;
+
+            try
+            {
+                m_loadTile(bounds);
+                loaded = true;
+            }
+            catch (...)
+            {
+                loaded = false;
+            }
+
+            lock.lock();
+
+            m_loading.erase(key);
+
+            if (loaded)
+            {
+                auto evictedTiles = m_scheduler.OnTileLoaded(tile);
+
+                // This is done while holding the lock, so that a trim can't
+                // race with another worker marking a tile as resident. Tiles
+                // that other workers are still loading are kept too, as they
+                // will be marked resident once they finish.
+                if (!evictedTiles.empty())
+                {
+                    auto rectangleToPreserve = m_scheduler.GetResidentBounds();
+
+                    for (auto loadingKey : m_loading)
+                    {
+                        AddToBounds(rectangleToPreserve, m_scheduler.GetTileBounds(VirtualBitmapTileScheduler::GetTile(loadingKey)));
+                    }
+
+                    try
+                    {
+                        m_trim(rectangleToPreserve);
+                    }
+                    catch (...)
+                    {
+                        // The cache just stays larger than it should be, until the next trim.
+                    }
+                }
+            }
+            else
+            {
+                m_scheduler.OnTileLoadFailed(tile);
+            }
+
+            if (m_queue.empty() && m_loading.empty())
+                m_idle.notify_all();
+        }
+    }
+
+
+    D2D1_RECT_U VirtualBitmapTileManager::MapToSourceRect(D2D1_RECT_U const& rect, D2D1_ORIENTATION orientation, D2D1_SIZE_U const& sourceSize)
+    {
+        // D2D flips the source first, and then rotates it clockwise. Undo
+        // that, in reverse.
+        uint32_t rotation = 0;
+        bool isFlipped = false;
+
+        switch (orientation)
+        {
+        case D2D1_ORIENTATION_DEFAULT:                              rotation = 0;   isFlipped = false; break;
+        case D2D1_ORIENTATION_FLIP_HORIZONTAL:                      rotation = 0;   isFlipped = true;  break;
+        case D2D1_ORIENTATION_ROTATE_CLOCKWISE180:                  rotation = 180; isFlipped = false; break;
+        case D2D1_ORIENTATION_ROTATE_CLOCKWISE180_FLIP_HORIZONTAL:  rotation = 180; isFlipped = true;  break;
+        case D2D1_ORIENTATION_ROTATE_CLOCKWISE90_FLIP_HORIZONTAL:   rotation = 90;  isFlipped = true;  break;
+        case D2D1_ORIENTATION_ROTATE_CLOCKWISE270:                  rotation = 270; isFlipped = false; break;
+        case D2D1_ORIENTATION_ROTATE_CLOCKWISE270_FLIP_HORIZONTAL:  rotation = 270; isFlipped = true;  break;
+        case D2D1_ORIENTATION_ROTATE_CLOCKWISE90:                   rotation = 90;  isFlipped = false; break;
+        default:
+            ThrowHR(E_INVALIDARG);
+        }
+
+        int64_t width = sourceSize.width;
+        int64_t height = sourceSize.height;
+
+        struct Point
+        {
+            int64_t X;
+            int64_t Y;
+        };
+
+        auto mapPoint = [&](int64_t u, int64_t v)
+        {
+            Point point;
+
+            switch (rotation)
+            {
+            case 0:   point = Point{ u,         v };          break;
+            case 90:  point = Point{ v,         height - u }; break;
+            case 180: point = Point{ width - u, height - v }; break;
+            default:  point = Point{ width - v, u };          break;
+            }
+
+            if (isFlipped)
+                point.X = width - point.X;
+
+            return point;
+        };
+
+        auto a = mapPoint(rect.left, rect.top);
+        auto b = mapPoint(rect.right, rect.bottom);
+
+        return D2D1_RECT_U
+        {
+            static_cast<uint32_t>(std::min(a.X, b.X)),
+            static_cast<uint32_t>(std::min(a.Y, b.Y)),
+            static_cast<uint32_t>(std::max(a.X, b.X)),
+            static_cast<uint32_t>(std::max(a.Y, b.Y))
+        };
+    }
+
+
+
+    ActivatableClassWithFactory(CanvasVirtualBitmapTileCache, CanvasVirtualBitmapTileCacheFactory);
+
+
+    static ComPtr<CanvasVirtualBitmapTileCache> CreateTileCache(
+        ICanvasVirtualBitmap* virtualBitmap,
+        VirtualBitmapTileManager::Options const& options)
+    {
+        CheckInPointer(virtualBitmap);
+
+        // ICanvasVirtualBitmap is exclusive to CanvasVirtualBitmap.
+        auto tileCache = Make<CanvasVirtualBitmapTileCache>(static_cast<CanvasVirtualBitmap*>(virtualBitmap), options);
+        CheckMakeResult(tileCache);
+
+        return tileCache;
+    }
+
+
+    IFACEMETHODIMP CanvasVirtualBitmapTileCacheFactory::Create(
+        ICanvasVirtualBitmap* virtualBitmap,
+        ICanvasVirtualBitmapTileCache** tileCache)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckAndClearOutPointer(tileCache);
+
+                ThrowIfFailed(CreateTileCache(virtualBitmap, VirtualBitmapTileManager::Options()).CopyTo(tileCache));
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasVirtualBitmapTileCacheFactory::CreateWithTileSizeAndBudget(
+        ICanvasVirtualBitmap* virtualBitmap,
+        int32_t tileSize,
+        uint64_t maximumResidentBytes,
+        ICanvasVirtualBitmapTileCache** tileCache)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckAndClearOutPointer(tileCache);
+
+                if (tileSize <= 0)
+                    ThrowHR(E_INVALIDARG);
+
+                VirtualBitmapTileManager::Options options;
+                options.Scheduling.TileSize = static_cast<uint32_t>(tileSize);
+                options.Scheduling.MaximumResidentBytes = maximumResidentBytes;
+
+                ThrowIfFailed(CreateTileCache(virtualBitmap, options).CopyTo(tileCache));
+            });
+    }
+
+
+    CanvasVirtualBitmapTileCache::CanvasVirtualBitmapTileCache(CanvasVirtualBitmap* virtualBitmap, VirtualBitmapTileManager::Options const& options)
+        : m_manager(std::make_unique<VirtualBitmapTileManager>(virtualBitmap, options))
+    {
+    }
+
+
+    VirtualBitmapTileManager* CanvasVirtualBitmapTileCache::GetManager()
+    {
+        if (!m_manager)
+            ThrowHR(RO_E_CLOSED);
+
+        return m_manager.get();
+    }
+
+
+    IFACEMETHODIMP CanvasVirtualBitmapTileCache::SetViewport(Rect viewport)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                GetManager()->SetViewport(viewport);
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasVirtualBitmapTileCache::get_Statistics(CanvasVirtualBitmapTileStatistics* value)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckInPointer(value);
+
+                auto statistics = GetManager()->GetStatistics();
+
+                value->ResidentTiles = statistics.ResidentTiles;
+                value->ResidentBytes = statistics.ResidentBytes;
+                value->VisibleTileHits = statistics.VisibleTileHits;
+                value->VisibleTileMisses = statistics.VisibleTileMisses;
+                value->TilesLoaded = statistics.TilesLoaded;
+                value->TileLoadFailures = statistics.TileLoadFailures;
+                value->TilesPrefetched = statistics.TilesPrefetched;
+                value->PrefetchedTilesUsed = statistics.PrefetchedTilesUsed;
+                value->TilesEvicted = statistics.TilesEvicted;
+            });
+    }
+
+
+    IFACEMETHODIMP CanvasVirtualBitmapTileCache::Close()
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                // Waits for the workers to finish the tiles they are loading.
+                m_manager.reset();
+            });
+    }
+
+}}}}
+
+#endif
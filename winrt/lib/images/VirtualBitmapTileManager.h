@@ -0,0 +1,175 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+#include "utils/LockUtilities.h"
+#include "VirtualBitmapTileScheduler.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    class CanvasVirtualBitmap;
+
+    //
+    // Keeps the part of a CanvasVirtualBitmap around the viewport decoded,
+    // for example while panning over a very large image.
+    //
+    // A virtual bitmap loaded with CanvasVirtualBitmapOptions.CacheOnDemand
+    // only decodes the regions that are drawn, at the time they are drawn,
+    // and keeps them until the image source is destroyed. So panning stalls
+    // on every newly exposed region, and memory grows with everything that
+    // has ever been seen. This manager instead splits the image into tiles,
+    // and whenever the viewport changes it asks VirtualBitmapTileScheduler
+    // which tiles to load. Those are cached on a fixed number of worker
+    // threads, visible tiles first and then the ones the viewport is heading
+    // towards. When the scheduler evicts tiles, the image source's cache is
+    // trimmed back to the tiles that remain.
+    //
+    // D2D can only be told to keep a single rectangle when trimming, so this
+    // is the bounding rectangle of the resident tiles, and of any tiles that
+    // other workers are still loading. Before a trim, the scheduler evicts
+    // every tile outside a range around the viewport and where it is heading,
+    // which it keeps within the budget. So the trimmed cache holds no more
+    // than the budget, plus at most one in flight tile per worker, unless
+    // the visible tiles alone exceed it.
+    //
+    // Tiles are in the pixels of the source image, before any EXIF
+    // orientation, since that is what the image source caches. Viewports are
+    // in the pixels of the virtual bitmap, and are mapped across.
+    //
+    class VirtualBitmapTileManager : private LifespanTracker<VirtualBitmapTileManager>
+    {
+    public:
+        // Both of these are called on worker threads, with rectangles in
+        // source pixels.
+        typedef std::function<void(D2D1_RECT_U const& tile)> LoadTileFunction;
+        typedef std::function<void(D2D1_RECT_U const& rectangleToPreserve)> TrimFunction;
+
+        struct Options
+        {
+            VirtualBitmapTileScheduler::Options Scheduling;
+
+            // Zero means one worker per core.
+            uint32_t MaximumConcurrency;
+
+            Options()
+                : MaximumConcurrency(2)
+            {
+            }
+        };
+
+    private:
+        D2D1_SIZE_U m_size;
+        D2D1_ORIENTATION m_orientation;
+        LoadTileFunction m_loadTile;
+        TrimFunction m_trim;
+
+        std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_idle;
+        bool m_isShuttingDown;
+
+        VirtualBitmapTileScheduler m_scheduler;
+
+        // Replaced on every viewport update, so stale prefetches are dropped.
+        std::deque<VirtualBitmapTile> m_queue;
+
+        // Tiles that workers are loading right now, by key.
+        std::set<uint64_t> m_loading;
+
+        std::vector<std::thread> m_workers;
+
+    public:
+        // The bitmap must have been loaded with CanvasVirtualBitmapOptions.CacheOnDemand.
+        VirtualBitmapTileManager(CanvasVirtualBitmap* bitmap, Options const& options = Options());
+
+        // For images cached some other way. The size is that of the oriented image.
+        VirtualBitmapTileManager(
+            D2D1_SIZE_U const& size,
+            D2D1_ORIENTATION orientation,
+            LoadTileFunction const& loadTile,
+            TrimFunction const& trim,
+            Options const& options = Options());
+
+        ~VirtualBitmapTileManager();
+
+        VirtualBitmapTileManager(VirtualBitmapTileManager const&) = delete;
+        VirtualBitmapTileManager& operator=(VirtualBitmapTileManager const&) = delete;
+
+        // Call this whenever the visible region changes, for example once per
+        // frame while panning. The viewport is in pixels, which for a virtual
+        // bitmap are the same as DIPs.
+        void SetViewport(Rect const& viewport);
+
+        // As above, with an explicit time in seconds for estimating velocity.
+        void SetViewport(Rect const& viewport, double time);
+
+        // Blocks until every queued tile has been loaded.
+        void WaitForIdle();
+
+        uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+        // Tiles waiting for a worker.
+        uint32_t GetQueuedCount();
+
+        VirtualBitmapTileStatistics GetStatistics();
+
+        // Maps a rectangle in the oriented image back to the source image.
+        static D2D1_RECT_U MapToSourceRect(D2D1_RECT_U const& rect, D2D1_ORIENTATION orientation, D2D1_SIZE_U const& sourceSize);
+
+    private:
+        VirtualBitmapTileManager(CanvasVirtualBitmap* bitmap, ComPtr<ID2D1ImageSourceFromWic> const& imageSource, Options const& options);
+
+        void WorkerThread();
+    };
+
+
+    //
+    // Exposes VirtualBitmapTileManager as CanvasVirtualBitmapTileCache.
+    //
+
+    class CanvasVirtualBitmapTileCacheFactory
+        : public AgileActivationFactory<ICanvasVirtualBitmapTileCacheFactory>
+        , private LifespanTracker<CanvasVirtualBitmapTileCacheFactory>
+    {
+        InspectableClassStatic(RuntimeClass_Microsoft_Graphics_Canvas_CanvasVirtualBitmapTileCache, BaseTrust);
+
+    public:
+        IFACEMETHOD(Create)(
+            ICanvasVirtualBitmap* virtualBitmap,
+            ICanvasVirtualBitmapTileCache** tileCache) override;
+
+        IFACEMETHOD(CreateWithTileSizeAndBudget)(
+            ICanvasVirtualBitmap* virtualBitmap,
+            int32_t tileSize,
+            uint64_t maximumResidentBytes,
+            ICanvasVirtualBitmapTileCache** tileCache) override;
+    };
+
+
+    class CanvasVirtualBitmapTileCache : public RuntimeClass<ICanvasVirtualBitmapTileCache, IClosable>
+                                       , private LifespanTracker<CanvasVirtualBitmapTileCache>
+    {
+        InspectableClass(RuntimeClass_Microsoft_Graphics_Canvas_CanvasVirtualBitmapTileCache, BaseTrust);
+
+        std::unique_ptr<VirtualBitmapTileManager> m_manager;
+
+    public:
+        CanvasVirtualBitmapTileCache(CanvasVirtualBitmap* virtualBitmap, VirtualBitmapTileManager::Options const& options);
+
+        IFACEMETHOD(SetViewport)(Rect viewport) override;
+
+        IFACEMETHOD(get_Statistics)(CanvasVirtualBitmapTileStatistics* value) override;
+
+        IFACEMETHOD(Close)() override;
+
+    private:
+        VirtualBitmapTileManager* GetManager();
+    };
+
+}}}}
+
+#endif
@@ -0,0 +1,364 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "VirtualBitmapTileScheduler.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    // Orders tiles by the distance of their centers from a point, breaking
+    // ties by position so that the order doesn't depend on how the tiles
+    // were gathered.
+    static void SortByDistance(std::vector<VirtualBitmapTile>& tiles, Vector2 const& point, uint32_t tileSize)
+    {
+        auto getDistanceSquared = [&](VirtualBitmapTile const& tile)
+        {
+            auto dx = (tile.Column + 0.5f) * tileSize - point.X;
+            auto dy = (tile.Row + 0.5f) * tileSize - point.Y;
+
+            return dx * dx + dy * dy;
+        };
+
+        std::sort(tiles.begin(), tiles.end(),
+            [&](VirtualBitmapTile const& a, VirtualBitmapTile const& b)
+            {
+                auto distanceA = getDistanceSquared(a);
+                auto distanceB = getDistanceSquared(b);
+
+                if (distanceA != distanceB)
+                    return distanceA < distanceB;
+
+                if (a.Row != b.Row)
+                    return a.Row < b.Row;
+
+                return a.Column < b.Column;
+            });
+    }
+
+
+    VirtualBitmapTileScheduler::VirtualBitmapTileScheduler(D2D1_SIZE_U const& imageSize, Options const& options)
+        : m_imageSize(imageSize)
+        , m_options(options)
+        , m_residentBytes(0)
+        , m_visibleTiles{}
+        , m_wantedTiles{}
+        , m_hasViewport(false)
+        , m_lastCenter{}
+        , m_lastTime(0)
+        , m_velocity{}
+        , m_statistics{}
+    {
+        if (options.TileSize == 0 || options.BytesPerPixel == 0 || !(options.PrefetchSeconds >= 0))
+            ThrowHR(E_INVALIDARG);
+
+        m_columnCount = static_cast<uint32_t>((static_cast<uint64_t>(imageSize.width) + options.TileSize - 1) / options.TileSize);
+        m_rowCount = static_cast<uint32_t>((static_cast<uint64_t>(imageSize.height) + options.TileSize - 1) / options.TileSize);
+    }
+
+
+    std::vector<VirtualBitmapTile> VirtualBitmapTileScheduler::UpdateViewport(D2D1_RECT_U const& viewport, double time)
+    {
+        auto left = static_cast<float>(viewport.left);
+        auto top = static_cast<float>(viewport.top);
+        auto right = static_cast<float>(viewport.right);
+        auto bottom = static_cast<float>(viewport.bottom);
+
+        Vector2 center{ (left + right) / 2, (top + bottom) / 2 };
+
+        if (m_hasViewport && time > m_lastTime)
+        {
+            auto elapsed = static_cast<float>(time - m_lastTime);
+
+            Vector2 velocity{ (center.X - m_lastCenter.X) / elapsed, (center.Y - m_lastCenter.Y) / elapsed };
+
+            // Averaging with the previous estimate smooths out uneven frame times.
+            m_velocity = Vector2{ (m_velocity.X + velocity.X) / 2, (m_velocity.Y + velocity.Y) / 2 };
+        }
+
+        m_hasViewport = true;
+        m_lastCenter = center;
+        m_lastTime = time;
+
+        m_visibleTiles = GetTileRange(left, top, right, bottom);
+        m_wantedTiles = m_visibleTiles;
+
+        std::vector<VirtualBitmapTile> tilesToLoad;
+
+        // Nothing is visible, so there's nothing to prefetch around either.
+        if (m_visibleTiles.Left == m_visibleTiles.Right || m_visibleTiles.Top == m_visibleTiles.Bottom)
+            return tilesToLoad;
+
+        std::vector<VirtualBitmapTile> visibleTiles;
+
+        for (auto row = m_visibleTiles.Top; row < m_visibleTiles.Bottom; row++)
+        {
+            for (auto column = m_visibleTiles.Left; column < m_visibleTiles.Right; column++)
+            {
+                visibleTiles.push_back(VirtualBitmapTile{ column, row });
+            }
+        }
+
+        SortByDistance(visibleTiles, center, m_options.TileSize);
+
+        // Resident tiles that are still wanted, most important first.
+        std::vector<ResidentList::iterator> wantedResidentTiles;
+
+        for (auto& tile : visibleTiles)
+        {
+            auto it = m_residentIndex.find(GetKey(tile));
+
+            if (it == m_residentIndex.end())
+            {
+                m_statistics.VisibleTileMisses++;
+                tilesToLoad.push_back(tile);
+                continue;
+            }
+
+            m_statistics.VisibleTileHits++;
+
+            if (it->second->IsUnusedPrefetch)
+            {
+                it->second->IsUnusedPrefetch = false;
+                m_statistics.PrefetchedTilesUsed++;
+            }
+
+            wantedResidentTiles.push_back(it->second);
+        }
+
+        // Prefetch around where the viewport is predicted to be. The
+        // prediction is limited to how far the budget could reach anyway, so
+        // a fling doesn't make us consider every tile in a huge image.
+        auto maximumDistance = static_cast<float>(GetMaximumPrefetchDistance());
+
+        Vector2 offset
+        {
+            std::max(-maximumDistance, std::min(m_velocity.X * m_options.PrefetchSeconds, maximumDistance)),
+            std::max(-maximumDistance, std::min(m_velocity.Y * m_options.PrefetchSeconds, maximumDistance))
+        };
+
+        // Candidates are the neighbours of the viewport, and everything
+        // between it and where it is predicted to be.
+        auto tileSize = static_cast<float>(m_options.TileSize);
+
+        auto candidateRange = GetTileRange(
+            std::min(left - tileSize, left + offset.X),
+            std::min(top - tileSize, top + offset.Y),
+            std::max(right + tileSize, right + offset.X),
+            std::max(bottom + tileSize, bottom + offset.Y));
+
+        std::vector<VirtualBitmapTile> candidates;
+
+        for (auto row = candidateRange.Top; row < candidateRange.Bottom; row++)
+        {
+            for (auto column = candidateRange.Left; column < candidateRange.Right; column++)
+            {
+                VirtualBitmapTile tile{ column, row };
+
+                if (!IsVisible(tile))
+                    candidates.push_back(tile);
+            }
+        }
+
+        SortByDistance(candidates, Vector2{ center.X + offset.X, center.Y + offset.Y }, m_options.TileSize);
+
+        // Each candidate that is taken grows the wanted range, which must stay
+        // within the budget. Skipped candidates may leave room for later ones,
+        // for example those in the same row as the viewport.
+        for (auto& tile : candidates)
+        {
+            TileRange range
+            {
+                std::min(m_wantedTiles.Left, tile.Column),
+                std::min(m_wantedTiles.Top, tile.Row),
+                std::max(m_wantedTiles.Right, tile.Column + 1),
+                std::max(m_wantedTiles.Bottom, tile.Row + 1)
+            };
+
+            if (GetRangeBytes(range) > m_options.MaximumResidentBytes)
+                continue;
+
+            m_wantedTiles = range;
+
+            auto it = m_residentIndex.find(GetKey(tile));
+
+            if (it == m_residentIndex.end())
+                tilesToLoad.push_back(tile);
+            else
+                wantedResidentTiles.push_back(it->second);
+        }
+
+        // Move the wanted tiles to the front of the LRU order, keeping the
+        // most important first, so that eviction takes unwanted tiles first.
+        for (auto it = wantedResidentTiles.rbegin(); it != wantedResidentTiles.rend(); ++it)
+        {
+            m_residentTiles.splice(m_residentTiles.begin(), m_residentTiles, *it);
+        }
+
+        return tilesToLoad;
+    }
+
+
+    std::vector<VirtualBitmapTile> VirtualBitmapTileScheduler::OnTileLoaded(VirtualBitmapTile const& tile)
+    {
+        if (tile.Column >= m_columnCount || tile.Row >= m_rowCount)
+            ThrowHR(E_INVALIDARG);
+
+        std::vector<VirtualBitmapTile> evictedTiles;
+
+        auto key = GetKey(tile);
+
+        if (m_residentIndex.find(key) != m_residentIndex.end())
+            return evictedTiles;
+
+        auto isVisible = IsVisible(tile);
+        auto bytes = GetTileBytes(tile);
+
+        m_residentTiles.push_front(ResidentTile{ tile, bytes, !isVisible });
+        m_residentIndex[key] = m_residentTiles.begin();
+        m_residentBytes += bytes;
+
+        m_statistics.TilesLoaded++;
+
+        if (!isVisible)
+            m_statistics.TilesPrefetched++;
+
+        if (m_residentBytes <= m_options.MaximumResidentBytes)
+            return evictedTiles;
+
+        // Evict everything outside the wanted range, least recently used
+        // first. The wanted range fits in the budget, unless the visible tiles
+        // alone exceed it, so this brings the resident tiles back within it.
+        auto it = m_residentTiles.end();
+
+        while (it != m_residentTiles.begin())
+        {
+            --it;
+
+            if (m_wantedTiles.Contains(it->Tile))
+                continue;
+
+            evictedTiles.push_back(it->Tile);
+
+            m_residentBytes -= it->Bytes;
+            m_residentIndex.erase(GetKey(it->Tile));
+            it = m_residentTiles.erase(it);
+        }
+
+        m_statistics.TilesEvicted += evictedTiles.size();
+
+        return evictedTiles;
+    }
+
+
+    void VirtualBitmapTileScheduler::OnTileLoadFailed(VirtualBitmapTile const&)
+    {
+        // The tile stays missing, so the next viewport update asks for it again.
+        m_statistics.TileLoadFailures++;
+    }
+
+
+    bool VirtualBitmapTileScheduler::IsResident(VirtualBitmapTile const& tile) const
+    {
+        return m_residentIndex.find(GetKey(tile)) != m_residentIndex.end();
+    }
+
+
+    D2D1_RECT_U VirtualBitmapTileScheduler::GetTileBounds(VirtualBitmapTile const& tile) const
+    {
+        auto left = static_cast<uint64_t>(tile.Column) * m_options.TileSize;
+        auto top = static_cast<uint64_t>(tile.Row) * m_options.TileSize;
+
+        return D2D1_RECT_U
+        {
+            static_cast<uint32_t>(std::min<uint64_t>(left, m_imageSize.width)),
+            static_cast<uint32_t>(std::min<uint64_t>(top, m_imageSize.height)),
+            static_cast<uint32_t>(std::min<uint64_t>(left + m_options.TileSize, m_imageSize.width)),
+            static_cast<uint32_t>(std::min<uint64_t>(top + m_options.TileSize, m_imageSize.height))
+        };
+    }
+
+
+    D2D1_RECT_U VirtualBitmapTileScheduler::GetResidentBounds() const
+    {
+        if (m_residentTiles.empty())
+            return D2D1_RECT_U{};
+
+        D2D1_RECT_U bounds{ UINT32_MAX, UINT32_MAX, 0, 0 };
+
+        for (auto& residentTile : m_residentTiles)
+        {
+            auto tileBounds = GetTileBounds(residentTile.Tile);
+
+            bounds.left = std::min(bounds.left, tileBounds.left);
+            bounds.top = std::min(bounds.top, tileBounds.top);
+            bounds.right = std::max(bounds.right, tileBounds.right);
+            bounds.bottom = std::max(bounds.bottom, tileBounds.bottom);
+        }
+
+        return bounds;
+    }
+
+
+    VirtualBitmapTileStatistics VirtualBitmapTileScheduler::GetStatistics() const
+    {
+        auto statistics = m_statistics;
+
+        statistics.ResidentTiles = static_cast<uint32_t>(m_residentTiles.size());
+        statistics.ResidentBytes = m_residentBytes;
+
+        return statistics;
+    }
+
+
+    VirtualBitmapTileScheduler::TileRange VirtualBitmapTileScheduler::GetTileRange(float left, float top, float right, float bottom) const
+    {
+        left = std::max(left, 0.0f);
+        top = std::max(top, 0.0f);
+        right = std::min(right, static_cast<float>(m_imageSize.width));
+        bottom = std::min(bottom, static_cast<float>(m_imageSize.height));
+
+        if (left >= right || top >= bottom)
+            return TileRange{};
+
+        auto tileSize = static_cast<float>(m_options.TileSize);
+
+        return TileRange
+        {
+            static_cast<uint32_t>(left / tileSize),
+            static_cast<uint32_t>(top / tileSize),
+            std::min(static_cast<uint32_t>(std::ceil(right / tileSize)), m_columnCount),
+            std::min(static_cast<uint32_t>(std::ceil(bottom / tileSize)), m_rowCount)
+        };
+    }
+
+
+    uint64_t VirtualBitmapTileScheduler::GetTileBytes(VirtualBitmapTile const& tile) const
+    {
+        auto bounds = GetTileBounds(tile);
+
+        return static_cast<uint64_t>(bounds.right - bounds.left) * (bounds.bottom - bounds.top) * m_options.BytesPerPixel;
+    }
+
+
+    uint64_t VirtualBitmapTileScheduler::GetRangeBytes(TileRange const& range) const
+    {
+        if (range.Left >= range.Right || range.Top >= range.Bottom)
+            return 0;
+
+        auto topLeft = GetTileBounds(VirtualBitmapTile{ range.Left, range.Top });
+        auto bottomRight = GetTileBounds(VirtualBitmapTile{ range.Right - 1, range.Bottom - 1 });
+
+        return static_cast<uint64_t>(bottomRight.right - topLeft.left) * (bottomRight.bottom - topLeft.top) * m_options.BytesPerPixel;
+    }
+
+
+    uint64_t VirtualBitmapTileScheduler::GetMaximumPrefetchDistance() const
+    {
+        auto tileBytes = static_cast<uint64_t>(m_options.TileSize) * m_options.TileSize * m_options.BytesPerPixel;
+        auto tilesInBudget = std::max<uint64_t>(m_options.MaximumResidentBytes / tileBytes, 1);
+
+        return tilesInBudget * m_options.TileSize;
+    }
+
+}}}}
@@ -0,0 +1,175 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    struct VirtualBitmapTile
+    {
+        uint32_t Column;
+        uint32_t Row;
+    };
+
+
+    struct VirtualBitmapTileStatistics
+    {
+        uint32_t ResidentTiles;
+        uint64_t ResidentBytes;
+
+        // Counted for every visible tile on every viewport update, so a tile
+        // that takes several frames to load counts as several misses.
+        uint64_t VisibleTileHits;
+        uint64_t VisibleTileMisses;
+
+        uint64_t TilesLoaded;
+        uint64_t TileLoadFailures;
+
+        // Tiles loaded while they were not visible, and how many of those
+        // then became visible before being evicted.
+        uint64_t TilesPrefetched;
+        uint64_t PrefetchedTilesUsed;
+
+        uint64_t TilesEvicted;
+    };
+
+
+    //
+    // Decides which tiles of a virtual bitmap should be loaded, in what
+    // order, and which should be evicted to stay within a memory budget.
+    //
+    // This is only bookkeeping: it knows nothing about D2D, and nothing
+    // about threads. VirtualBitmapTileManager does the loading, and
+    // serializes calls into the scheduler.
+    //
+    // Every viewport update returns the tiles that are wanted but not
+    // resident, most important first. Visible tiles come first, nearest the
+    // center of the viewport first. Then come prefetch candidates: the
+    // neighbours of the viewport, and the tiles it is heading towards, judged
+    // from how fast it has been moving. These are ordered by how close they
+    // are to where the viewport is predicted to be.
+    //
+    // D2D can only be told to keep a single rectangle when its cache is
+    // trimmed, so the visible tiles and the prefetch candidates that are
+    // taken make up a wanted range of tiles, and a candidate is only taken if
+    // the range still fits in the budget with it. When loading a tile takes
+    // the resident tiles over budget, every tile outside the wanted range is
+    // evicted, least recently used first. What remains then fits within the
+    // budget, as does the rectangle around it. Visible tiles are never
+    // evicted, so a viewport larger than the budget can exceed it.
+    //
+    class VirtualBitmapTileScheduler
+    {
+    public:
+        struct Options
+        {
+            uint32_t TileSize;
+            uint64_t MaximumResidentBytes;
+            uint32_t BytesPerPixel;
+
+            // How far ahead of a moving viewport to prefetch.
+            float PrefetchSeconds;
+
+            Options()
+                : TileSize(256)
+                , MaximumResidentBytes(64 * 1024 * 1024)
+                , BytesPerPixel(4)
+                , PrefetchSeconds(0.5f)
+            {
+            }
+        };
+
+    private:
+        // Half open ranges of columns and rows.
+        struct TileRange
+        {
+            uint32_t Left;
+            uint32_t Top;
+            uint32_t Right;
+            uint32_t Bottom;
+
+            bool Contains(VirtualBitmapTile const& tile) const
+            {
+                return tile.Column >= Left && tile.Column < Right && tile.Row >= Top && tile.Row < Bottom;
+            }
+        };
+
+        struct ResidentTile
+        {
+            VirtualBitmapTile Tile;
+            uint64_t Bytes;
+            bool IsUnusedPrefetch;
+        };
+
+        typedef std::list<ResidentTile> ResidentList;
+
+        D2D1_SIZE_U m_imageSize;
+        Options m_options;
+        uint32_t m_columnCount;
+        uint32_t m_rowCount;
+
+        // Most recently used first.
+        ResidentList m_residentTiles;
+        std::unordered_map<uint64_t, ResidentList::iterator> m_residentIndex;
+        uint64_t m_residentBytes;
+
+        TileRange m_visibleTiles;
+
+        // Contains the visible tiles, and the prefetch candidates that fit in the budget.
+        TileRange m_wantedTiles;
+
+        bool m_hasViewport;
+        Vector2 m_lastCenter;
+        double m_lastTime;
+        Vector2 m_velocity;
+
+        VirtualBitmapTileStatistics m_statistics;
+
+    public:
+        VirtualBitmapTileScheduler(D2D1_SIZE_U const& imageSize, Options const& options = Options());
+
+        // The viewport is in image pixels, and time is in seconds from any
+        // fixed starting point. Returns the tiles to load, most important first.
+        std::vector<VirtualBitmapTile> UpdateViewport(D2D1_RECT_U const& viewport, double time);
+
+        // Records that a tile has been loaded. Returns the tiles that were
+        // evicted to make room for it.
+        std::vector<VirtualBitmapTile> OnTileLoaded(VirtualBitmapTile const& tile);
+
+        void OnTileLoadFailed(VirtualBitmapTile const& tile);
+
+        bool IsResident(VirtualBitmapTile const& tile) const;
+        bool IsVisible(VirtualBitmapTile const& tile) const { return m_visibleTiles.Contains(tile); }
+
+        // In image pixels.
+        D2D1_RECT_U GetTileBounds(VirtualBitmapTile const& tile) const;
+
+        // The smallest rectangle containing every resident tile, or an empty
+        // rectangle if there are none. After an eviction this lies within the
+        // wanted range, so holds no more than the budget.
+        D2D1_RECT_U GetResidentBounds() const;
+
+        // In image pixels per second.
+        Vector2 GetVelocity() const { return m_velocity; }
+
+        VirtualBitmapTileStatistics GetStatistics() const;
+
+        static uint64_t GetKey(VirtualBitmapTile const& tile)
+        {
+            return (static_cast<uint64_t>(tile.Row) << 32) | tile.Column;
+        }
+
+        static VirtualBitmapTile GetTile(uint64_t key)
+        {
+            return VirtualBitmapTile{ static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32) };
+        }
+
+    private:
+        TileRange GetTileRange(float left, float top, float right, float bottom) const;
+        uint64_t GetTileBytes(VirtualBitmapTile const& tile) const;
+        uint64_t GetRangeBytes(TileRange const& range) const;
+        uint64_t GetMaximumPrefetchDistance() const;
+    };
+
+}}}}
@@ -25,6 +25,7 @@
 #include <functional>
 #include <future>
 #include <iterator>
+#include <list>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -122,6 +123,8 @@
 #include "utils/Conversion.h"
 #include "utils/DxgiUtilities.h"
 #include "utils/MathUtilities.h"
+#include "utils/PixelFormatConversion.h"
+#include "utils/PixelSwizzle.h"
 #include "utils/ResourceManager.h"
 #include "utils/ResourceWrapper.h"
 #include "utils/CachedResourceReference.h"
@@ -188,12 +188,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     {
         std::vector<uint8_t> convertedBytes(colorCount * 4);
 
-        for (uint32_t i = 0; i < colorCount; i++)
+        if (colorCount)
         {
-            convertedBytes[i * 4 + 0] = colors[i].B;
-            convertedBytes[i * 4 + 1] = colors[i].G;
-            convertedBytes[i * 4 + 2] = colors[i].R;
-            convertedBytes[i * 4 + 3] = colors[i].A;
+            SwizzleColorAndBgra(reinterpret_cast<uint8_t const*>(colors), convertedBytes.data(), colorCount);
         }
 
         assert(convertedBytes.size() <= UINT_MAX);
@@ -5,45 +5,17 @@
 #include "pch.h"
 #include "HashUtilities.h"
 
-using namespace ABI::Windows::Security::Cryptography;
-using namespace ABI::Windows::Security::Cryptography::Core;
-using namespace ABI::Windows::Storage::Streams;
-
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 {
     ComArray<BYTE> GetSha1Hash(BYTE const* data, size_t dataSize)
     {
-        // Look up WinRT activation factories.
-        ComPtr<ICryptographicBufferStatics> bufferStatics;
-        ThrowIfFailed(GetActivationFactory(Wrappers::HStringReference(RuntimeClass_Windows_Security_Cryptography_CryptographicBuffer).Get(), &bufferStatics));
-
-        ComPtr<IHashAlgorithmNamesStatics> algorithmNames;
-        ThrowIfFailed(GetActivationFactory(Wrappers::HStringReference(RuntimeClass_Windows_Security_Cryptography_Core_HashAlgorithmNames).Get(), &algorithmNames));
-
-        ComPtr<IHashAlgorithmProviderStatics> algorithmStatics;
-        ThrowIfFailed(GetActivationFactory(Wrappers::HStringReference(RuntimeClass_Windows_Security_Cryptography_Core_HashAlgorithmProvider).Get(), &algorithmStatics));
-
-        // Convert the input data to an IBuffer.
-        ComPtr<IBuffer> dataBuffer;
-        ThrowIfFailed(bufferStatics->CreateFromByteArray(static_cast<UINT32>(dataSize), const_cast<BYTE*>(data), &dataBuffer));
+        BYTE digest[Sha1::DigestSize];
 
-        // Look up the name of the SHA1 hashing algorithm.
-        WinString sha1Name;
-        ThrowIfFailed(algorithmNames->get_Sha1(sha1Name.GetAddressOf()));
+        Sha1 sha1;
+        sha1.Update(data, dataSize);
+        sha1.Finish(digest);
 
-        // Instantiate the hashing algorithm.
-        ComPtr<IHashAlgorithmProvider> algorithm;
-        ThrowIfFailed(algorithmStatics->OpenAlgorithm(sha1Name, &algorithm));
-
-        // Hash our data.
-        ComPtr<IBuffer> resultBuffer;
-        ThrowIfFailed(algorithm->HashData(dataBuffer.Get(), &resultBuffer));
-
-        // Convert IBuffer -> ComArray.
-        ComArray<BYTE> result;
-        ThrowIfFailed(bufferStatics->CopyToByteArray(resultBuffer.Get(), result.GetAddressOfSize(), result.GetAddressOfData()));
-
-        return result;
+        return ComArray<BYTE>(digest, digest + Sha1::DigestSize);
     }
 
 
@@ -67,21 +39,21 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
     // based on an input name, so the same name always produces the same UUID .
     IID GetVersion5Uuid(IID const& namespaceId, BYTE const* name, size_t nameSize)
     {
-        // Convert the namespace to a byte array.
-        auto namespaceBytes = reinterpret_cast<BYTE const*>(&namespaceId);
+        // Convert the namespace to network byte ordering.
+        BYTE namespaceBytes[sizeof(IID)];
+        memcpy(namespaceBytes, &namespaceId, sizeof(IID));
 
-        std::vector<BYTE> buffer(namespaceBytes, namespaceBytes + sizeof(IID));
+        SwapUuidByteOrder(namespaceBytes);
 
-        // Convert to network byte ordering.
-        SwapUuidByteOrder(buffer.data());
+        // Hash the namespace followed by the name, and take the first 16 bytes.
+        BYTE result[Sha1::DigestSize];
 
-        // Concatenate the name onto the namespace.
-        buffer.insert(buffer.end(), name, name + nameSize);
+        Sha1 sha1;
+        sha1.Update(namespaceBytes, sizeof(namespaceBytes));
+        sha1.Update(name, nameSize);
+        sha1.Finish(result);
 
-        // Take the first 16 bytes of the SHA-1 hash.
-        auto result = GetSha1Hash(buffer.data(), buffer.size());
-    
-        assert(result.GetSize() >= sizeof(IID));
+        static_assert(sizeof(result) >= sizeof(IID), "SHA-1 digest must be large enough to fill a UUID");
 
         // Set the variant bits (MSB0-1 = 2 means standard RFC 4122 UUID).
         result[8] &= 0x3F;
@@ -92,9 +64,12 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
         result[6] |= 5 << 4;
 
         // Convert to local byte ordering.
-        SwapUuidByteOrder(result.GetData());
+        SwapUuidByteOrder(result);
+
+        IID uuid;
+        memcpy(&uuid, result, sizeof(IID));
 
-        return *reinterpret_cast<IID*>(result.GetData());
+        return uuid;
     }
 
 }}}}
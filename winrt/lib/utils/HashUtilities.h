@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "Sha1.h"
+
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
 {
     ComArray<BYTE> GetSha1Hash(BYTE const* data, size_t dataSize);
@@ -0,0 +1,293 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "MappedFileStream.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    static void ThrowIfWin32Failed(BOOL succeeded)
+    {
+        if (!succeeded)
+            ThrowHR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+
+    // Touching a mapped page can fail if the file is on a network or
+    // removable drive that goes away, which shows up as a structured
+    // exception rather than an error code. This must be a separate function
+    // because __try can't be mixed with C++ object unwinding.
+    static HRESULT CopyFromView(void* destination, BYTE const* source, size_t size)
+    {
+        __try
+        {
+            memcpy(destination, source, size);
+            return S_OK;
+        }
+        __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+        {
+            return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+        }
+    }
+
+
+    ComPtr<MappedFileStream> MappedFileStream::Create(wchar_t const* path)
+    {
+        return CreateFromFile(path, SIZE_MAX, true);
+    }
+
+
+    ComPtr<MappedFileStream> MappedFileStream::TryCreate(wchar_t const* path, uint64_t maxSize)
+    {
+        return CreateFromFile(path, maxSize, false);
+    }
+
+
+    ComPtr<MappedFileStream> MappedFileStream::CreateFromFile(wchar_t const* path, uint64_t maxSize, bool throwOnFailure)
+    {
+        CheckInPointer(path);
+
+        Wrappers::FileHandle file(CreateFile2(path, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr));
+        ThrowIfWin32Failed(file.IsValid());
+
+        FILE_STANDARD_INFO info;
+        ThrowIfWin32Failed(GetFileInformationByHandleEx(file.Get(), FileStandardInfo, &info, sizeof(info)));
+
+        auto size = static_cast<uint64_t>(info.EndOfFile.QuadPart);
+
+        // The whole file is mapped at once, so it must fit in the address space.
+        if (size > std::min<uint64_t>(maxSize, SIZE_MAX))
+        {
+            if (throwOnFailure)
+                ThrowHR(E_OUTOFMEMORY);
+
+            return nullptr;
+        }
+
+        std::shared_ptr<BYTE const> view;
+
+        // Empty files can't be mapped, but there's nothing to read from them anyway.
+        if (size > 0)
+        {
+            Wrappers::HandleT<Wrappers::HandleTraits::HANDLENullTraits> mapping(CreateFileMappingFromApp(file.Get(), nullptr, PAGE_READONLY, 0, nullptr));
+
+            if (!mapping.IsValid() && !throwOnFailure)
+                return nullptr;
+
+            ThrowIfWin32Failed(mapping.IsValid());
+
+            auto address = MapViewOfFileFromApp(mapping.Get(), FILE_MAP_READ, 0, 0);
+
+            if (!address && !throwOnFailure)
+                return nullptr;
+
+            ThrowIfWin32Failed(address != nullptr);
+
+            // The view keeps the file mapping alive after our handles are closed.
+            view.reset(static_cast<BYTE const*>(address), [](BYTE const* value) { UnmapViewOfFile(value); });
+        }
+
+        auto stream = Make<MappedFileStream>(view, size);
+        CheckMakeResult(stream);
+
+        return stream;
+    }
+
+
+    MappedFileStream::MappedFileStream(std::shared_ptr<BYTE const> const& view, uint64_t size, uint64_t position)
+        : m_view(view)
+        , m_size(size)
+        , m_position(position)
+    {
+    }
+
+
+    size_t MappedFileStream::GetBytesAvailable(uint64_t bytesWanted) const
+    {
+        if (m_position >= m_size)
+            return 0;
+
+        return static_cast<size_t>(std::min(bytesWanted, m_size - m_position));
+    }
+
+
+    IFACEMETHODIMP MappedFileStream::Read(void* buffer, ULONG bufferSize, ULONG* bytesRead)
+    {
+        if (bytesRead)
+            *bytesRead = 0;
+
+        if (!buffer && bufferSize > 0)
+            return STG_E_INVALIDPOINTER;
+
+        auto count = GetBytesAvailable(bufferSize);
+
+        if (count > 0)
+        {
+            auto hr = CopyFromView(buffer, m_view.get() + m_position, count);
+
+            if (FAILED(hr))
+                return hr;
+
+            m_position += count;
+        }
+
+        if (bytesRead)
+            *bytesRead = static_cast<ULONG>(count);
+
+        return (count < bufferSize) ? S_FALSE : S_OK;
+    }
+
+
+    IFACEMETHODIMP MappedFileStream::Write(void const*, ULONG, ULONG* bytesWritten)
+    {
+        if (bytesWritten)
+            *bytesWritten = 0;
+
+        return STG_E_ACCESSDENIED; // This stream is read only.
+    }
+
+
+    IFACEMETHODIMP MappedFileStream::Seek(LARGE_INTEGER offset, DWORD origin, ULARGE_INTEGER* newPosition)
+    {
+        int64_t base;
+
+        switch (origin)
+        {
+        case STREAM_SEEK_SET: base = 0;                                 break;
+        case STREAM_SEEK_CUR: base = static_cast<int64_t>(m_position);  break;
+        case STREAM_SEEK_END: base = static_cast<int64_t>(m_size);      break;
+        default:
+            return STG_E_INVALIDFUNCTION;
+        }
+
+        auto position = base + offset.QuadPart;
+
+        // Seeking past the end is allowed, and subsequent reads return no data.
+        if (position < 0)
+            return STG_E_INVALIDFUNCTION;
+
+        m_position = static_cast<uint64_t>(position);
+
+        if (newPosition)
+            newPosition->QuadPart = m_position;
+
+        return S_OK;
+    }
+
+
+    IFACEMETHODIMP MappedFileStream::SetSize(ULARGE_INTEGER)
+    {
+        return STG_E_ACCESSDENIED; // This stream is read only.
+    }
+
+
+    IFACEMETHODIMP MappedFileStream::CopyTo(IStream* stream, ULARGE_INTEGER size, ULARGE_INTEGER* bytesRead, ULARGE_INTEGER* bytesWritten)
+    {
+        if (bytesRead)
+            bytesRead->QuadPart = 0;
+
+        if (bytesWritten)
+            bytesWritten->QuadPart = 0;
+
+        if (!stream)
+            return STG_E_INVALIDPOINTER;
+
+        // Copy through a bounded buffer rather than handing the view to the
+        // destination, so that in-page errors are caught by CopyFromView instead
+        // of faulting inside someone else's Write.
+        auto remaining = GetBytesAvailable(size.QuadPart);
+
+        if (remaining == 0)
+            return S_OK;
+
+        size_t const bufferSize = std::min(remaining, CopyToBufferSize);
+
+        std::unique_ptr<BYTE[]> buffer(new (std::nothrow) BYTE[bufferSize]);
+
+        if (!buffer)
+            return E_OUTOFMEMORY;
+
+        while (remaining > 0)
+        {
+            auto chunkSize = static_cast<ULONG>(std::min(remaining, bufferSize));
+            ULONG chunkWritten = 0;
+
+            auto hr = CopyFromView(buffer.get(), m_view.get() + m_position, chunkSize);
+
+            if (FAILED(hr))
+                return hr;
+
+            hr = stream->Write(buffer.get(), chunkSize, &chunkWritten);
+
+            m_position += chunkSize;
+            remaining -= chunkSize;
+
+            if (bytesRead)
+                bytesRead->QuadPart += chunkSize;
+
+            if (bytesWritten)
+                bytesWritten->QuadPart += chunkWritten;
+
+            if (FAILED(hr))
+                return hr;
+        }
+
+        return S_OK;
+    }
+
+
+    IFACEMETHODIMP MappedFileStream::Commit(DWORD)
+    {
+        return S_OK; // Nothing is transacted, so this has no effect.
+    }
+
+
+    IFACEMETHODIMP MappedFileStream::Revert()
+    {
+        return S_OK; // Nothing is transacted, so this has no effect.
+    }
+
+
+    IFACEMETHODIMP MappedFileStream::LockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD)
+    {
+        return STG_E_INVALIDFUNCTION; // Region locking is not supported.
+    }
+
+
+    IFACEMETHODIMP MappedFileStream::UnlockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD)
+    {
+        return STG_E_INVALIDFUNCTION; // Region locking is not supported.
+    }
+
+
+    IFACEMETHODIMP MappedFileStream::Stat(STATSTG* statistics, DWORD)
+    {
+        if (!statistics)
+            return STG_E_INVALIDPOINTER;
+
+        // The stream has no name, whatever the flags ask for.
+        *statistics = STATSTG{};
+        statistics->type = STGTY_STREAM;
+        statistics->cbSize.QuadPart = m_size;
+        statistics->grfMode = STGM_READ | STGM_SHARE_DENY_WRITE;
+
+        return S_OK;
+    }
+
+
+    IFACEMETHODIMP MappedFileStream::Clone(IStream** stream)
+    {
+        return ExceptionBoundary(
+            [&]
+            {
+                CheckAndClearOutPointer(stream);
+
+                auto clone = Make<MappedFileStream>(m_view, m_size, m_position);
+                CheckMakeResult(clone);
+
+                ThrowIfFailed(clone.CopyTo(stream));
+            });
+    }
+
+}}}}
@@ -0,0 +1,62 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Read-only, seekable IStream over a memory-mapped file. Reads copy
+    // straight out of a view of the whole file, which the OS pages in from
+    // its cache, instead of going through a file handle and a second layer
+    // of buffering. Clones share the same view, and the view stays mapped
+    // until the last of them is released.
+    //
+    class MappedFileStream : public RuntimeClass<
+        RuntimeClassFlags<ClassicCom>,
+        ChainInterfaces<IStream, ISequentialStream>>
+        , private LifespanTracker<MappedFileStream>
+    {
+        std::shared_ptr<BYTE const> m_view;
+        uint64_t m_size;
+        uint64_t m_position;
+
+    public:
+        // Size of the buffer that CopyTo passes to the destination stream.
+        static const size_t CopyToBufferSize = 64 * 1024;
+
+        static ComPtr<MappedFileStream> Create(wchar_t const* path);
+
+        // Returns null, rather than throwing, if the file is larger than maxSize
+        // or can't be mapped, so the caller can fall back to reading it some other
+        // way. Errors opening the file are still thrown.
+        static ComPtr<MappedFileStream> TryCreate(wchar_t const* path, uint64_t maxSize);
+
+        MappedFileStream(std::shared_ptr<BYTE const> const& view, uint64_t size, uint64_t position = 0);
+
+        BYTE const* GetData() const { return m_view.get(); }
+        uint64_t GetSize() const { return m_size; }
+
+        // ISequentialStream
+        IFACEMETHOD(Read)(void* buffer, ULONG bufferSize, ULONG* bytesRead) override;
+        IFACEMETHOD(Write)(void const* buffer, ULONG bufferSize, ULONG* bytesWritten) override;
+
+        // IStream
+        IFACEMETHOD(Seek)(LARGE_INTEGER offset, DWORD origin, ULARGE_INTEGER* newPosition) override;
+        IFACEMETHOD(SetSize)(ULARGE_INTEGER newSize) override;
+        IFACEMETHOD(CopyTo)(IStream* stream, ULARGE_INTEGER size, ULARGE_INTEGER* bytesRead, ULARGE_INTEGER* bytesWritten) override;
+        IFACEMETHOD(Commit)(DWORD flags) override;
+        IFACEMETHOD(Revert)() override;
+        IFACEMETHOD(LockRegion)(ULARGE_INTEGER offset, ULARGE_INTEGER size, DWORD lockType) override;
+        IFACEMETHOD(UnlockRegion)(ULARGE_INTEGER offset, ULARGE_INTEGER size, DWORD lockType) override;
+        IFACEMETHOD(Stat)(STATSTG* statistics, DWORD flags) override;
+        IFACEMETHOD(Clone)(IStream** stream) override;
+
+    private:
+        static ComPtr<MappedFileStream> CreateFromFile(wchar_t const* path, uint64_t maxSize, bool throwOnFailure);
+
+        size_t GetBytesAvailable(uint64_t bytesWanted) const;
+    };
+
+}}}}
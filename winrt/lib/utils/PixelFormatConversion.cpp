@@ -0,0 +1,449 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "PixelFormatConversion.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    static uint8_t FloatToUnorm(float value)
+    {
+        // Written so that NaN becomes zero.
+        if (!(value > 0.0f))
+            return 0;
+
+        if (value >= 1.0f)
+            return 255;
+
+        return static_cast<uint8_t>(value * 255.0f + 0.5f);
+    }
+
+
+    // Lookup tables, built when the DLL is loaded.
+    struct ConversionTables
+    {
+        float UnormToFloat[256];
+        float SrgbUnormToLinear[256];
+
+        // A linear value encodes to sRGB byte N when it is at least the first N thresholds.
+        float LinearToSrgbUnormThresholds[255];
+
+        // Unpremultiply[alpha][color]
+        uint8_t Unpremultiply[256][256];
+
+        ConversionTables()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                UnormToFloat[i] = i / 255.0f;
+                SrgbUnormToLinear[i] = SrgbToLinear(i / 255.0f);
+            }
+
+            for (int i = 0; i < 255; i++)
+            {
+                LinearToSrgbUnormThresholds[i] = SrgbToLinear((i + 0.5f) / 255.0f);
+            }
+
+            for (int alpha = 0; alpha < 256; alpha++)
+            {
+                for (int color = 0; color < 256; color++)
+                {
+                    int value = alpha ? (color * 255 + alpha / 2) / alpha : 0;
+
+                    Unpremultiply[alpha][color] = static_cast<uint8_t>(std::min(value, 255));
+                }
+            }
+        }
+    };
+
+    static ConversionTables const tables;
+
+
+    static uint8_t LinearToSrgbUnorm(float value)
+    {
+        if (!(value > 0.0f))
+            return 0;
+
+        auto thresholds = tables.LinearToSrgbUnormThresholds;
+
+        return static_cast<uint8_t>(std::upper_bound(thresholds, thresholds + 255, value) - thresholds);
+    }
+
+
+    //
+    // Unpremultiplication of 8 bit pixels.
+    //
+
+    static void UnpremultiplyPixel(uint8_t* pixel)
+    {
+        auto& table = tables.Unpremultiply[pixel[3]];
+
+        pixel[0] = table[pixel[0]];
+        pixel[1] = table[pixel[1]];
+        pixel[2] = table[pixel[2]];
+    }
+
+
+    void UnpremultiplyPixels(uint8_t* pixels, uint32_t pixelCount)
+    {
+        for (uint32_t i = 0; i < pixelCount; i++)
+        {
+            UnpremultiplyPixel(pixels + i * 4);
+        }
+    }
+
+
+    static void MakePixelsOpaque(uint8_t* pixels, uint32_t pixelCount)
+    {
+        for (uint32_t i = 0; i < pixelCount; i++)
+        {
+            pixels[i * 4 + 3] = 255;
+        }
+    }
+
+
+    //
+    // Formats.
+    //
+
+    struct ConvertibleFormat
+    {
+        DXGI_FORMAT Format;
+        bool IsHalfFloat;
+        bool IsSrgb;
+
+        // For the 8 bit formats. Green is always byte 1, and alpha byte 3.
+        uint8_t RedOffset;
+        uint8_t BlueOffset;
+    };
+
+    static ConvertibleFormat const convertibleFormats[] =
+    {
+        { DXGI_FORMAT_B8G8R8A8_UNORM,      false, false, 2, 0 },
+        { DXGI_FORMAT_B8G8R8A8_UNORM_SRGB, false, true,  2, 0 },
+        { DXGI_FORMAT_R8G8B8A8_UNORM,      false, false, 0, 2 },
+        { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, false, true,  0, 2 },
+        { DXGI_FORMAT_R16G16B16A16_FLOAT,  true,  false, 0, 0 },
+    };
+
+
+    static ConvertibleFormat const* FindConvertibleFormat(DXGI_FORMAT format)
+    {
+        for (auto& convertibleFormat : convertibleFormats)
+        {
+            if (convertibleFormat.Format == format)
+                return &convertibleFormat;
+        }
+
+        return nullptr;
+    }
+
+
+    bool IsConvertiblePixelFormat(DXGI_FORMAT format, D2D1_ALPHA_MODE alphaMode)
+    {
+        switch (alphaMode)
+        {
+        case D2D1_ALPHA_MODE_PREMULTIPLIED:
+        case D2D1_ALPHA_MODE_STRAIGHT:
+        case D2D1_ALPHA_MODE_IGNORE:
+            return FindConvertibleFormat(format) != nullptr;
+
+        default:
+            return false;
+        }
+    }
+
+
+    void VerifyConvertiblePixelFormat(DXGI_FORMAT format, D2D1_ALPHA_MODE alphaMode)
+    {
+        if (!IsConvertiblePixelFormat(format, alphaMode))
+        {
+            ThrowHR(E_INVALIDARG, Strings::PixelFormatConversionRestriction);
+        }
+    }
+
+
+    //
+    // Converts rows of pixels, according to a plan worked out up front.
+    //
+    // 8 bit to 8 bit conversions that don't change the color encoding reorder
+    // the bytes, then adjust alpha in place. Everything else goes through a
+    // row of floats.
+    //
+    class PixelConverter
+    {
+        ConvertibleFormat const* m_source;
+        ConvertibleFormat const* m_destination;
+        bool m_useVectorKernels;
+
+        bool m_isCopy;
+        bool m_unpremultiply;
+        bool m_premultiply;
+        bool m_makeOpaque;
+        bool m_decodeSrgb;
+        bool m_encodeSrgb;
+        PixelByteOrder m_byteOrder;
+
+    public:
+        PixelConverter(PixelLayout const& source, PixelLayout const& destination, bool useVectorKernels)
+            : m_source(FindConvertibleFormat(source.Format))
+            , m_destination(FindConvertibleFormat(destination.Format))
+            , m_useVectorKernels(useVectorKernels)
+        {
+            assert(m_source && m_destination);
+
+            m_isCopy = (source.Format == destination.Format && source.AlphaMode == destination.AlphaMode);
+
+            bool changeEncoding = (m_source->IsSrgb != m_destination->IsSrgb);
+
+            bool sourceIsOpaque = (source.AlphaMode == D2D1_ALPHA_MODE_IGNORE);
+            bool sourceIsPremultiplied = (source.AlphaMode != D2D1_ALPHA_MODE_STRAIGHT);
+            bool destinationIsPremultiplied = (destination.AlphaMode != D2D1_ALPHA_MODE_STRAIGHT);
+
+            // Changing the color encoding has to be done on straight colors.
+            // Opaque colors are the same whether they are premultiplied or not.
+            m_unpremultiply = !sourceIsOpaque && sourceIsPremultiplied && (!destinationIsPremultiplied || changeEncoding);
+            m_premultiply = !sourceIsOpaque && destinationIsPremultiplied && (!sourceIsPremultiplied || changeEncoding);
+            m_makeOpaque = sourceIsOpaque || destination.AlphaMode == D2D1_ALPHA_MODE_IGNORE;
+
+            m_decodeSrgb = changeEncoding && m_source->IsSrgb;
+            m_encodeSrgb = changeEncoding && m_destination->IsSrgb;
+
+            m_byteOrder.Source[m_destination->RedOffset] = m_source->RedOffset;
+            m_byteOrder.Source[1] = 1;
+            m_byteOrder.Source[m_destination->BlueOffset] = m_source->BlueOffset;
+            m_byteOrder.Source[3] = 3;
+        }
+
+        void ConvertRows(
+            uint8_t const* source,
+            uint32_t sourceStride,
+            uint8_t* destination,
+            uint32_t destinationStride,
+            uint32_t width,
+            uint32_t rowCount) const
+        {
+            auto destinationBytesPerRow = width * GetBytesPerBlock(m_destination->Format);
+
+            if (m_isCopy && !m_makeOpaque)
+            {
+                for (uint32_t y = 0; y < rowCount; y++)
+                {
+                    memcpy(destination + y * destinationStride, source + y * sourceStride, destinationBytesPerRow);
+                }
+            }
+            else if (!m_source->IsHalfFloat && !m_destination->IsHalfFloat && !m_decodeSrgb && !m_encodeSrgb)
+            {
+                auto kernel = m_useVectorKernels ? GetDefaultPixelSwizzleKernel() : PixelSwizzleKernel::Scalar;
+
+                for (uint32_t y = 0; y < rowCount; y++)
+                {
+                    auto destinationRow = destination + y * destinationStride;
+
+                    ShufflePixelBytes(source + y * sourceStride, destinationRow, width, m_byteOrder, kernel);
+
+                    if (m_unpremultiply)
+                        UnpremultiplyPixels(destinationRow, width);
+
+                    if (m_premultiply)
+                        PremultiplyPixels(destinationRow, width, m_useVectorKernels);
+
+                    if (m_makeOpaque)
+                        MakePixelsOpaque(destinationRow, width);
+                }
+            }
+            else
+            {
+                std::vector<float> rgba(width * 4);
+
+                for (uint32_t y = 0; y < rowCount; y++)
+                {
+                    DecodeRow(source + y * sourceStride, rgba.data(), width);
+                    EncodeRow(rgba.data(), destination + y * destinationStride, width);
+                }
+            }
+        }
+
+    private:
+        void DecodeRow(uint8_t const* source, float* rgba, uint32_t width) const
+        {
+            if (m_source->IsHalfFloat)
+            {
+                HalfToFloat(reinterpret_cast<uint16_t const*>(source), rgba, width * 4, m_useVectorKernels);
+
+                if (m_unpremultiply)
+                {
+                    for (uint32_t x = 0; x < width; x++)
+                    {
+                        UnpremultiplyFloats(rgba + x * 4);
+                    }
+                }
+
+                return;
+            }
+
+            auto colorTable = m_decodeSrgb ? tables.SrgbUnormToLinear : tables.UnormToFloat;
+
+            for (uint32_t x = 0; x < width; x++)
+            {
+                uint8_t pixel[4];
+                memcpy(pixel, source + x * 4, sizeof(pixel));
+
+                // sRGB colors are unpremultiplied before they are decoded.
+                if (m_unpremultiply && m_decodeSrgb)
+                    UnpremultiplyPixel(pixel);
+
+                auto out = rgba + x * 4;
+
+                out[0] = colorTable[pixel[m_source->RedOffset]];
+                out[1] = colorTable[pixel[1]];
+                out[2] = colorTable[pixel[m_source->BlueOffset]];
+                out[3] = tables.UnormToFloat[pixel[3]];
+
+                if (m_unpremultiply && !m_decodeSrgb)
+                    UnpremultiplyFloats(out);
+            }
+        }
+
+        void EncodeRow(float* rgba, uint8_t* destination, uint32_t width) const
+        {
+            if (m_destination->IsHalfFloat)
+            {
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    auto pixel = rgba + x * 4;
+
+                    if (m_premultiply)
+                        PremultiplyFloats(pixel);
+
+                    if (m_makeOpaque)
+                        pixel[3] = 1.0f;
+                }
+
+                FloatToHalf(rgba, reinterpret_cast<uint16_t*>(destination), width * 4, m_useVectorKernels);
+                return;
+            }
+
+            for (uint32_t x = 0; x < width; x++)
+            {
+                auto in = rgba + x * 4;
+
+                // sRGB colors are premultiplied after they are encoded.
+                if (m_premultiply && !m_encodeSrgb)
+                    PremultiplyFloats(in);
+
+                uint8_t pixel[4];
+
+                if (m_encodeSrgb)
+                {
+                    pixel[m_destination->RedOffset] = LinearToSrgbUnorm(in[0]);
+                    pixel[1] = LinearToSrgbUnorm(in[1]);
+                    pixel[m_destination->BlueOffset] = LinearToSrgbUnorm(in[2]);
+                }
+                else
+                {
+                    pixel[m_destination->RedOffset] = FloatToUnorm(in[0]);
+                    pixel[1] = FloatToUnorm(in[1]);
+                    pixel[m_destination->BlueOffset] = FloatToUnorm(in[2]);
+                }
+
+                pixel[3] = FloatToUnorm(in[3]);
+
+                if (m_premultiply && m_encodeSrgb)
+                    PremultiplyPixel(pixel);
+
+                if (m_makeOpaque)
+                    pixel[3] = 255;
+
+                memcpy(destination + x * 4, pixel, sizeof(pixel));
+            }
+        }
+
+        static void PremultiplyFloats(float* pixel)
+        {
+            pixel[0] *= pixel[3];
+            pixel[1] *= pixel[3];
+            pixel[2] *= pixel[3];
+        }
+
+        static void UnpremultiplyFloats(float* pixel)
+        {
+            auto alpha = pixel[3];
+
+            for (int i = 0; i < 3; i++)
+            {
+                pixel[i] = (alpha > 0.0f) ? pixel[i] / alpha : 0.0f;
+            }
+        }
+    };
+
+
+    //
+    // Below this many pixels per thread, starting threads costs more than it saves.
+    //
+    static const uint32_t MinimumPixelsPerThread = 256 * 1024;
+
+
+    void ConvertPixels(
+        uint32_t width,
+        uint32_t height,
+        uint8_t const* source,
+        PixelLayout const& sourceLayout,
+        uint8_t* destination,
+        PixelLayout const& destinationLayout,
+        PixelConversionOptions const& options)
+    {
+        VerifyConvertiblePixelFormat(sourceLayout.Format, sourceLayout.AlphaMode);
+        VerifyConvertiblePixelFormat(destinationLayout.Format, destinationLayout.AlphaMode);
+
+        if (width == 0 || height == 0)
+            return;
+
+        CheckInPointer(source);
+        CheckInPointer(destination);
+
+        if (sourceLayout.Stride < width * GetBytesPerBlock(sourceLayout.Format) ||
+            destinationLayout.Stride < width * GetBytesPerBlock(destinationLayout.Format))
+        {
+            ThrowHR(E_INVALIDARG);
+        }
+
+        PixelConverter converter(sourceLayout, destinationLayout, options.UseVectorKernels);
+
+        // Split the rows into one band per thread. The calling thread converts the first band itself.
+        uint32_t threadCount = options.MaximumThreadCount ? options.MaximumThreadCount : std::max(std::thread::hardware_concurrency(), 1U);
+
+        uint64_t pixelCount = static_cast<uint64_t>(width) * height;
+        auto bandCount = static_cast<uint32_t>(std::min<uint64_t>(std::min(threadCount, height), std::max<uint64_t>(pixelCount / MinimumPixelsPerThread, 1)));
+        auto rowsPerBand = (height + bandCount - 1) / bandCount;
+
+        auto convertBand = [&](uint32_t firstRow)
+        {
+            auto rowCount = std::min(rowsPerBand, height - firstRow);
+
+            converter.ConvertRows(
+                source + static_cast<size_t>(firstRow) * sourceLayout.Stride,
+                sourceLayout.Stride,
+                destination + static_cast<size_t>(firstRow) * destinationLayout.Stride,
+                destinationLayout.Stride,
+                width,
+                rowCount);
+        };
+
+        std::vector<std::future<void>> bands;
+
+        for (uint32_t firstRow = rowsPerBand; firstRow < height; firstRow += rowsPerBand)
+        {
+            bands.push_back(std::async(std::launch::async, convertBand, firstRow));
+        }
+
+        convertBand(0);
+
+        for (auto& band : bands)
+        {
+            band.get();
+        }
+    }
+
+}}}}
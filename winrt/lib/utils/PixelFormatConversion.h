@@ -0,0 +1,68 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include "PixelFormatConversionKernels.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Converts pixels between the formats apps most often want to read or
+    // write directly:
+    //
+    //     DXGI_FORMAT_B8G8R8A8_UNORM          DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+    //     DXGI_FORMAT_R8G8B8A8_UNORM          DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+    //     DXGI_FORMAT_R16G16B16A16_FLOAT
+    //
+    // in premultiplied, straight or ignored alpha.
+    //
+    // The _SRGB formats hold gamma encoded colors and the others hold linear
+    // colors, so converting between the two groups encodes or decodes sRGB.
+    // Colors are premultiplied in the encoding they are stored in.
+    //
+    // Conversions between the 8 bit formats use vectorized kernels, and large
+    // images are split across several threads.
+    //
+    struct PixelLayout
+    {
+        DXGI_FORMAT Format;
+        D2D1_ALPHA_MODE AlphaMode;
+        uint32_t Stride;
+    };
+
+    struct PixelConversionOptions
+    {
+        // When false, only the portable scalar code is used.
+        bool UseVectorKernels;
+
+        // Zero means one thread per core.
+        uint32_t MaximumThreadCount;
+
+        PixelConversionOptions()
+            : UseVectorKernels(true)
+            , MaximumThreadCount(0)
+        {
+        }
+    };
+
+    bool IsConvertiblePixelFormat(DXGI_FORMAT format, D2D1_ALPHA_MODE alphaMode);
+
+    // Throws E_INVALIDARG if the format can't be converted.
+    void VerifyConvertiblePixelFormat(DXGI_FORMAT format, D2D1_ALPHA_MODE alphaMode);
+
+    void ConvertPixels(
+        uint32_t width,
+        uint32_t height,
+        uint8_t const* source,
+        PixelLayout const& sourceLayout,
+        uint8_t* destination,
+        PixelLayout const& destinationLayout,
+        PixelConversionOptions const& options = PixelConversionOptions());
+
+    // The inverse of PremultiplyPixels (see PixelFormatConversionKernels.h),
+    // operating in place on 8 bit pixels with alpha in the fourth byte.
+    void UnpremultiplyPixels(uint8_t* pixels, uint32_t pixelCount);
+
+}}}}
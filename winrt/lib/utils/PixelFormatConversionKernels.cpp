@@ -0,0 +1,352 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+// This file deliberately does not use the precompiled header, so that the
+// vector kernels only depend on the standard library and compiler intrinsics,
+// and can be built by compilers other than MSVC.
+
+#include <cmath>
+#include <cstring>
+
+#include "PixelFormatConversionKernels.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#define PIXEL_CONVERSION_X86
+#elif defined(_M_ARM)
+#include <arm_neon.h>
+#define PIXEL_CONVERSION_NEON
+#elif defined(_M_ARM64)
+#include <arm64_neon.h>
+#define PIXEL_CONVERSION_NEON
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define PIXEL_CONVERSION_NEON
+#endif
+
+// MSVC lets any function use any instruction set, but other compilers need
+// functions that use F16C to say so.
+#if defined(PIXEL_CONVERSION_X86) && !defined(_MSC_VER)
+#define PIXEL_CONVERSION_TARGET_F16C __attribute__((target("avx,f16c")))
+#else
+#define PIXEL_CONVERSION_TARGET_F16C
+#endif
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Half precision floats.
+    //
+
+    float HalfToFloat(uint16_t value)
+    {
+        uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+        uint32_t exponent = (value >> 10) & 0x1F;
+        uint32_t mantissa = value & 0x3FF;
+
+        uint32_t bits;
+
+        if (exponent == 0x1F)
+        {
+            // Infinity, or NaN (which is made quiet, as the hardware does).
+            bits = sign | 0x7F800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0);
+        }
+        else if (exponent != 0)
+        {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+        else if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // Denormals are normal floats.
+            exponent = 113;
+
+            while ((mantissa & 0x400) == 0)
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+        }
+
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+
+    uint16_t FloatToHalf(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+        auto magnitude = bits & 0x7FFFFFFF;
+
+        if (magnitude >= 0x7F800000)
+        {
+            // Infinity, or NaN with as much of its payload as fits.
+            if (magnitude == 0x7F800000)
+                return sign | 0x7C00;
+            else
+                return sign | 0x7E00 | static_cast<uint16_t>((magnitude >> 13) & 0x3FF);
+        }
+
+        // 65520 and up round to infinity.
+        if (magnitude >= 0x477FF000)
+            return sign | 0x7C00;
+
+        if (magnitude < 0x38800000)
+        {
+            // Too small for a normal half. Anything up to 2^-25 rounds to zero.
+            if (magnitude <= 0x33000000)
+                return sign;
+
+            uint32_t exponent = magnitude >> 23;
+            uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+            uint32_t shift = 126 - exponent;
+
+            uint32_t result = mantissa >> shift;
+            uint32_t remainder = mantissa & ((1u << shift) - 1);
+            uint32_t halfway = 1u << (shift - 1);
+
+            if (remainder > halfway || (remainder == halfway && (result & 1)))
+                result++;
+
+            return sign | static_cast<uint16_t>(result);
+        }
+
+        // Rebias the exponent, rounding the mantissa to nearest even.
+        uint32_t rounded = magnitude + 0xFFF + ((magnitude >> 13) & 1);
+
+        return sign | static_cast<uint16_t>((rounded - 0x38000000) >> 13);
+    }
+
+
+#ifdef PIXEL_CONVERSION_X86
+
+    static bool CpuSupportsF16c()
+    {
+        unsigned int ecx;
+
+#if defined(_MSC_VER)
+        int cpuInfo[4];
+        __cpuid(cpuInfo, 1);
+        ecx = static_cast<unsigned int>(cpuInfo[2]);
+#else
+        unsigned int eax, ebx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            return false;
+#endif
+
+        // F16C instructions are VEX encoded, so also need the OS to support AVX.
+        bool hasOsxsave = (ecx & (1 << 27)) != 0;
+        bool hasAvx = (ecx & (1 << 28)) != 0;
+        bool hasF16c = (ecx & (1 << 29)) != 0;
+
+        if (!hasOsxsave || !hasAvx || !hasF16c)
+            return false;
+
+#if defined(_MSC_VER)
+        uint64_t enabledState = _xgetbv(0);
+#else
+        uint32_t low, high;
+        __asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        uint64_t enabledState = low | (static_cast<uint64_t>(high) << 32);
+#endif
+
+        return (enabledState & 6) == 6;
+    }
+
+    static bool const cpuSupportsF16c = CpuSupportsF16c();
+
+
+    // These return how many values they converted, which is a multiple of 8.
+
+    PIXEL_CONVERSION_TARGET_F16C
+    static uint32_t HalfToFloatF16c(uint16_t const* source, float* destination, uint32_t count)
+    {
+        uint32_t i = 0;
+
+        for (; i + 8 <= count; i += 8)
+        {
+            auto halves = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i));
+            _mm256_storeu_ps(destination + i, _mm256_cvtph_ps(halves));
+        }
+
+        _mm256_zeroupper();
+
+        return i;
+    }
+
+
+    PIXEL_CONVERSION_TARGET_F16C
+    static uint32_t FloatToHalfF16c(float const* source, uint16_t* destination, uint32_t count)
+    {
+        uint32_t i = 0;
+
+        for (; i + 8 <= count; i += 8)
+        {
+            auto halves = _mm256_cvtps_ph(_mm256_loadu_ps(source + i), 0 /* round to nearest even */);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), halves);
+        }
+
+        _mm256_zeroupper();
+
+        return i;
+    }
+
+#endif
+
+
+    void HalfToFloat(uint16_t const* source, float* destination, uint32_t count, bool useVectorKernels)
+    {
+        uint32_t i = 0;
+
+#ifdef PIXEL_CONVERSION_X86
+        if (useVectorKernels && cpuSupportsF16c)
+            i = HalfToFloatF16c(source, destination, count);
+#else
+        (void)useVectorKernels;
+#endif
+
+        for (; i < count; i++)
+        {
+            destination[i] = HalfToFloat(source[i]);
+        }
+    }
+
+
+    void FloatToHalf(float const* source, uint16_t* destination, uint32_t count, bool useVectorKernels)
+    {
+        uint32_t i = 0;
+
+#ifdef PIXEL_CONVERSION_X86
+        if (useVectorKernels && cpuSupportsF16c)
+            i = FloatToHalfF16c(source, destination, count);
+#else
+        (void)useVectorKernels;
+#endif
+
+        for (; i < count; i++)
+        {
+            destination[i] = FloatToHalf(source[i]);
+        }
+    }
+
+
+    //
+    // sRGB.
+    //
+
+    float SrgbToLinear(float value)
+    {
+        if (value <= 0.04045f)
+            return value / 12.92f;
+        else
+            return powf((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+
+    float LinearToSrgb(float value)
+    {
+        if (value <= 0.0031308f)
+            return value * 12.92f;
+        else
+            return 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+
+    //
+    // Premultiplication of 8 bit pixels.
+    //
+
+    void PremultiplyPixel(uint8_t* pixel)
+    {
+        uint32_t alpha = pixel[3];
+
+        for (int i = 0; i < 3; i++)
+        {
+            // Exactly round(color * alpha / 255).
+            uint32_t value = pixel[i] * alpha + 128;
+            pixel[i] = static_cast<uint8_t>((value + (value >> 8)) >> 8);
+        }
+    }
+
+
+#ifdef PIXEL_CONVERSION_X86
+
+    static __m128i PremultiplyTwoPixels(__m128i pixels, __m128i alphaMask)
+    {
+        // Each of the 16 bit lanes holds one channel.
+        auto alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+        auto value = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(128));
+        value = _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+
+        // Keep the original alpha.
+        return _mm_or_si128(_mm_andnot_si128(alphaMask, value), _mm_and_si128(alphaMask, pixels));
+    }
+
+#endif
+
+
+    void PremultiplyPixels(uint8_t* pixels, uint32_t pixelCount, bool useVectorKernels)
+    {
+        uint32_t i = 0;
+
+        if (useVectorKernels)
+        {
+#if defined(PIXEL_CONVERSION_X86)
+            auto const zero = _mm_setzero_si128();
+            auto const alphaMask = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+
+            for (; i + 4 <= pixelCount; i += 4)
+            {
+                auto p = reinterpret_cast<__m128i*>(pixels + i * 4);
+                auto fourPixels = _mm_loadu_si128(p);
+
+                auto low = PremultiplyTwoPixels(_mm_unpacklo_epi8(fourPixels, zero), alphaMask);
+                auto high = PremultiplyTwoPixels(_mm_unpackhi_epi8(fourPixels, zero), alphaMask);
+
+                _mm_storeu_si128(p, _mm_packus_epi16(low, high));
+            }
+#elif defined(PIXEL_CONVERSION_NEON)
+            for (; i + 16 <= pixelCount; i += 16)
+            {
+                auto channels = vld4q_u8(pixels + i * 4);
+                auto alpha = channels.val[3];
+
+                for (int c = 0; c < 3; c++)
+                {
+                    auto low = vmull_u8(vget_low_u8(channels.val[c]), vget_low_u8(alpha));
+                    auto high = vmull_u8(vget_high_u8(channels.val[c]), vget_high_u8(alpha));
+
+                    // (value + 128 + ((value + 128) >> 8)) >> 8, as for the scalar version.
+                    channels.val[c] = vcombine_u8(
+                        vrshrn_n_u16(vrsraq_n_u16(low, low, 8), 8),
+                        vrshrn_n_u16(vrsraq_n_u16(high, high, 8), 8));
+                }
+
+                vst4q_u8(pixels + i * 4, channels);
+            }
+#endif
+        }
+
+        for (; i < pixelCount; i++)
+        {
+            PremultiplyPixel(pixels + i * 4);
+        }
+    }
+
+}}}}
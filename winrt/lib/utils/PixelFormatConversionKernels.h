@@ -0,0 +1,30 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include <cstdint>
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Building blocks of ConvertPixels (see PixelFormatConversion.h) that have
+    // vectorized versions. When useVectorKernels is false, or the CPU lacks
+    // the instructions, only the portable scalar code is used.
+    //
+
+    float HalfToFloat(uint16_t value);
+    uint16_t FloatToHalf(float value);  // Rounds to nearest even.
+
+    void HalfToFloat(uint16_t const* source, float* destination, uint32_t count, bool useVectorKernels);
+    void FloatToHalf(float const* source, uint16_t* destination, uint32_t count, bool useVectorKernels);
+
+    float SrgbToLinear(float value);
+    float LinearToSrgb(float value);
+
+    // Operate in place on 8 bit pixels, with alpha in the fourth byte.
+    void PremultiplyPixel(uint8_t* pixel);
+    void PremultiplyPixels(uint8_t* pixels, uint32_t pixelCount, bool useVectorKernels);
+
+}}}}
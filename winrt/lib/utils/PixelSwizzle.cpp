@@ -0,0 +1,273 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "PixelSwizzle.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#define PIXEL_SWIZZLE_X86
+#elif defined(_M_ARM)
+#include <arm_neon.h>
+#define PIXEL_SWIZZLE_NEON
+#elif defined(_M_ARM64)
+#include <arm64_neon.h>
+#define PIXEL_SWIZZLE_NEON
+#endif
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    PixelByteOrder const ReverseEachPixel = { { 3, 2, 1, 0 } };
+
+
+    static void ShuffleScalar(uint8_t const* source, uint8_t* destination, uint32_t pixelCount, PixelByteOrder const& order)
+    {
+        for (uint32_t i = 0; i < pixelCount; i++)
+        {
+            // Read the whole pixel first, in case this is being done in place.
+            uint8_t pixel[4];
+            memcpy(pixel, source + i * 4, sizeof(pixel));
+
+            for (int j = 0; j < 4; j++)
+            {
+                destination[i * 4 + j] = pixel[order.Source[j]];
+            }
+        }
+    }
+
+
+#ifdef PIXEL_SWIZZLE_X86
+
+    static __m128i MakeShuffleMask(PixelByteOrder const& order)
+    {
+        __declspec(align(16)) uint8_t mask[16];
+
+        for (int i = 0; i < 16; i++)
+        {
+            mask[i] = static_cast<uint8_t>((i & ~3) + order.Source[i & 3]);
+        }
+
+        return _mm_load_si128(reinterpret_cast<__m128i const*>(mask));
+    }
+
+
+    static void ShuffleSsse3(uint8_t const* source, uint8_t* destination, uint32_t pixelCount, PixelByteOrder const& order)
+    {
+        auto const mask = MakeShuffleMask(order);
+
+        uint32_t i = 0;
+
+        for (; i + 4 <= pixelCount; i += 4)
+        {
+            auto pixels = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i * 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_shuffle_epi8(pixels, mask));
+        }
+
+        ShuffleScalar(source + i * 4, destination + i * 4, pixelCount - i, order);
+    }
+
+
+    static void ShuffleAvx2(uint8_t const* source, uint8_t* destination, uint32_t pixelCount, PixelByteOrder const& order)
+    {
+        // vpshufb shuffles within each 128 bit lane, so the mask is repeated for both halves.
+        auto const halfMask = MakeShuffleMask(order);
+        auto const mask = _mm256_inserti128_si256(_mm256_castsi128_si256(halfMask), halfMask, 1);
+
+        uint32_t i = 0;
+
+        for (; i + 8 <= pixelCount; i += 8)
+        {
+            auto pixels = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(source + i * 4));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), _mm256_shuffle_epi8(pixels, mask));
+        }
+
+        // Avoid the penalty for mixing AVX and SSE code.
+        _mm256_zeroupper();
+
+        ShuffleScalar(source + i * 4, destination + i * 4, pixelCount - i, order);
+    }
+
+
+    static bool CpuSupportsSsse3()
+    {
+        int cpuInfo[4];
+        __cpuid(cpuInfo, 1);
+
+        return (cpuInfo[2] & (1 << 9)) != 0;
+    }
+
+
+    static bool CpuSupportsAvx2()
+    {
+        int cpuInfo[4];
+        __cpuid(cpuInfo, 0);
+
+        if (cpuInfo[0] < 7)
+            return false;
+
+        // AVX2 also needs the OS to preserve the upper halves of the YMM registers.
+        __cpuid(cpuInfo, 1);
+
+        bool hasOsxsave = (cpuInfo[2] & (1 << 27)) != 0;
+        bool hasAvx = (cpuInfo[2] & (1 << 28)) != 0;
+
+        if (!hasOsxsave || !hasAvx || (_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(cpuInfo, 7, 0);
+
+        return (cpuInfo[1] & (1 << 5)) != 0;
+    }
+
+#endif
+
+
+#ifdef PIXEL_SWIZZLE_NEON
+
+    static void ShuffleNeon(uint8_t const* source, uint8_t* destination, uint32_t pixelCount, PixelByteOrder const& order)
+    {
+        uint32_t i = 0;
+
+        // vld4 splits 16 pixels into one register per byte position.
+        for (; i + 16 <= pixelCount; i += 16)
+        {
+            auto pixels = vld4q_u8(source + i * 4);
+
+            uint8x16x4_t shuffled;
+            shuffled.val[0] = pixels.val[order.Source[0]];
+            shuffled.val[1] = pixels.val[order.Source[1]];
+            shuffled.val[2] = pixels.val[order.Source[2]];
+            shuffled.val[3] = pixels.val[order.Source[3]];
+
+            vst4q_u8(destination + i * 4, shuffled);
+        }
+
+        ShuffleScalar(source + i * 4, destination + i * 4, pixelCount - i, order);
+    }
+
+#endif
+
+
+    bool IsPixelSwizzleKernelSupported(PixelSwizzleKernel kernel)
+    {
+        switch (kernel)
+        {
+        case PixelSwizzleKernel::Scalar:
+            return true;
+
+#ifdef PIXEL_SWIZZLE_X86
+        case PixelSwizzleKernel::Ssse3:
+            return CpuSupportsSsse3();
+
+        case PixelSwizzleKernel::Avx2:
+            return CpuSupportsAvx2();
+#endif
+
+#ifdef PIXEL_SWIZZLE_NEON
+        case PixelSwizzleKernel::Neon:
+            return true;
+#endif
+
+        default:
+            return false;
+        }
+    }
+
+
+    static PixelSwizzleKernel SelectDefaultPixelSwizzleKernel()
+    {
+        PixelSwizzleKernel const fastestFirst[] =
+        {
+            PixelSwizzleKernel::Avx2,
+            PixelSwizzleKernel::Ssse3,
+            PixelSwizzleKernel::Neon,
+        };
+
+        for (auto kernel : fastestFirst)
+        {
+            if (IsPixelSwizzleKernelSupported(kernel))
+                return kernel;
+        }
+
+        return PixelSwizzleKernel::Scalar;
+    }
+
+
+    // Detected once, when the DLL is loaded.
+    static PixelSwizzleKernel const defaultPixelSwizzleKernel = SelectDefaultPixelSwizzleKernel();
+
+
+    PixelSwizzleKernel GetDefaultPixelSwizzleKernel()
+    {
+        return defaultPixelSwizzleKernel;
+    }
+
+
+    void ShufflePixelBytes(uint8_t const* source, uint8_t* destination, uint32_t pixelCount, PixelByteOrder const& order)
+    {
+        ShufflePixelBytes(source, destination, pixelCount, order, defaultPixelSwizzleKernel);
+    }
+
+
+    void ShufflePixelBytes(uint8_t const* source, uint8_t* destination, uint32_t pixelCount, PixelByteOrder const& order, PixelSwizzleKernel kernel)
+    {
+        assert(source == destination || source + pixelCount * 4 <= destination || destination + pixelCount * 4 <= source);
+        assert(IsPixelSwizzleKernelSupported(kernel));
+
+        switch (kernel)
+        {
+#ifdef PIXEL_SWIZZLE_X86
+        case PixelSwizzleKernel::Ssse3:
+            ShuffleSsse3(source, destination, pixelCount, order);
+            break;
+
+        case PixelSwizzleKernel::Avx2:
+            ShuffleAvx2(source, destination, pixelCount, order);
+            break;
+#endif
+
+#ifdef PIXEL_SWIZZLE_NEON
+        case PixelSwizzleKernel::Neon:
+            ShuffleNeon(source, destination, pixelCount, order);
+            break;
+#endif
+
+        default:
+            ShuffleScalar(source, destination, pixelCount, order);
+            break;
+        }
+    }
+
+
+    void ShufflePixelBytes(
+        uint8_t const* source,
+        uint32_t sourceStride,
+        uint8_t* destination,
+        uint32_t destinationStride,
+        uint32_t width,
+        uint32_t height,
+        PixelByteOrder const& order)
+    {
+        auto bytesPerRow = width * 4;
+
+        assert(sourceStride >= bytesPerRow);
+        assert(destinationStride >= bytesPerRow);
+
+        if (sourceStride == bytesPerRow && destinationStride == bytesPerRow)
+        {
+            ShufflePixelBytes(source, destination, width * height, order);
+            return;
+        }
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            ShufflePixelBytes(source, destination, width, order);
+
+            source += sourceStride;
+            destination += destinationStride;
+        }
+    }
+
+}}}}
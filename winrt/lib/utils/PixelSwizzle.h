@@ -0,0 +1,77 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    //
+    // Reorders the four bytes of each pixel, for example to convert between
+    // B8G8R8A8 and R8G8B8A8. Vectorized kernels are used where the CPU
+    // supports them.
+    //
+    enum class PixelSwizzleKernel
+    {
+        Scalar,
+        Ssse3,
+        Avx2,
+        Neon,
+    };
+
+    bool IsPixelSwizzleKernelSupported(PixelSwizzleKernel kernel);
+
+    // The fastest kernel supported by this CPU.
+    PixelSwizzleKernel GetDefaultPixelSwizzleKernel();
+
+    // Byte i of each destination pixel is taken from byte Source[i] of the source pixel.
+    struct PixelByteOrder
+    {
+        uint8_t Source[4];
+    };
+
+    // Source and destination may be the same, but must not otherwise overlap.
+    void ShufflePixelBytes(uint8_t const* source, uint8_t* destination, uint32_t pixelCount, PixelByteOrder const& order);
+    void ShufflePixelBytes(uint8_t const* source, uint8_t* destination, uint32_t pixelCount, PixelByteOrder const& order, PixelSwizzleKernel kernel);
+
+    // Shuffles a width x height block of pixels, row by row. This is done in
+    // a single pass when neither the source nor the destination have padding
+    // at the end of their rows.
+    void ShufflePixelBytes(
+        uint8_t const* source,
+        uint32_t sourceStride,
+        uint8_t* destination,
+        uint32_t destinationStride,
+        uint32_t width,
+        uint32_t height,
+        PixelByteOrder const& order);
+
+    //
+    // Windows.UI.Color is laid out in memory as A, R, G, B, so converting
+    // between it and B8G8R8A8 pixel bytes just reverses the order of the four
+    // bytes of each pixel. The same swizzle goes in either direction.
+    //
+    extern PixelByteOrder const ReverseEachPixel;
+
+    inline void SwizzleColorAndBgra(uint8_t const* source, uint8_t* destination, uint32_t pixelCount)
+    {
+        ShufflePixelBytes(source, destination, pixelCount, ReverseEachPixel);
+    }
+
+    inline void SwizzleColorAndBgra(uint8_t const* source, uint8_t* destination, uint32_t pixelCount, PixelSwizzleKernel kernel)
+    {
+        ShufflePixelBytes(source, destination, pixelCount, ReverseEachPixel, kernel);
+    }
+
+    inline void SwizzleColorAndBgra(
+        uint8_t const* source,
+        uint32_t sourceStride,
+        uint8_t* destination,
+        uint32_t destinationStride,
+        uint32_t width,
+        uint32_t height)
+    {
+        ShufflePixelBytes(source, sourceStride, destination, destinationStride, width, height, ReverseEachPixel);
+    }
+
+}}}}
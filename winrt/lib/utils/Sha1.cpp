@@ -0,0 +1,158 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+// This file deliberately does not use the precompiled header, so the hash can be
+// built and reused with nothing more than the C++ standard library.
+
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+
+#include "Sha1.h"
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    static inline uint32_t RotateLeft(uint32_t value, int shift)
+    {
+        return (value << shift) | (value >> (32 - shift));
+    }
+
+
+    Sha1::Sha1()
+        : m_totalSize(0)
+        , m_blockSize(0)
+    {
+        m_state[0] = 0x67452301;
+        m_state[1] = 0xEFCDAB89;
+        m_state[2] = 0x98BADCFE;
+        m_state[3] = 0x10325476;
+        m_state[4] = 0xC3D2E1F0;
+    }
+
+
+    void Sha1::Update(uint8_t const* data, size_t dataSize)
+    {
+        m_totalSize += dataSize;
+
+        // Top up a partially filled block.
+        if (m_blockSize > 0)
+        {
+            auto count = std::min(dataSize, BlockSize - m_blockSize);
+
+            memcpy(m_block + m_blockSize, data, count);
+
+            m_blockSize += count;
+            data += count;
+            dataSize -= count;
+
+            if (m_blockSize < BlockSize)
+                return;
+
+            ProcessBlock(m_block);
+            m_blockSize = 0;
+        }
+
+        // Hash whole blocks directly from the input, without copying them.
+        while (dataSize >= BlockSize)
+        {
+            ProcessBlock(data);
+
+            data += BlockSize;
+            dataSize -= BlockSize;
+        }
+
+        // Keep any leftovers for next time.
+        memcpy(m_block, data, dataSize);
+        m_blockSize = dataSize;
+    }
+
+
+    void Sha1::Finish(uint8_t (&digest)[DigestSize])
+    {
+        uint64_t totalBits = m_totalSize * 8;
+
+        // Pad with a single 1 bit, then zeros up to 8 bytes short of a block boundary.
+        uint8_t padding[BlockSize * 2] = { 0x80 };
+
+        size_t paddingSize = ((m_blockSize < BlockSize - 8) ? BlockSize : BlockSize * 2) - m_blockSize - 8;
+
+        // Followed by the message length in bits, big-endian.
+        uint8_t length[8];
+
+        for (int i = 0; i < 8; i++)
+        {
+            length[i] = static_cast<uint8_t>(totalBits >> (56 - i * 8));
+        }
+
+        Update(padding, paddingSize);
+        Update(length, sizeof(length));
+
+        assert(m_blockSize == 0);
+
+        for (int i = 0; i < 5; i++)
+        {
+            digest[i * 4 + 0] = static_cast<uint8_t>(m_state[i] >> 24);
+            digest[i * 4 + 1] = static_cast<uint8_t>(m_state[i] >> 16);
+            digest[i * 4 + 2] = static_cast<uint8_t>(m_state[i] >> 8);
+            digest[i * 4 + 3] = static_cast<uint8_t>(m_state[i]);
+        }
+    }
+
+
+    void Sha1::ProcessBlock(uint8_t const* block)
+    {
+        // Expand the block into the 80 word message schedule.
+        uint32_t w[80];
+
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = (static_cast<uint32_t>(block[i * 4 + 0]) << 24) |
+                   (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+                   (static_cast<uint32_t>(block[i * 4 + 2]) << 8) |
+                   (static_cast<uint32_t>(block[i * 4 + 3]));
+        }
+
+        for (int i = 16; i < 80; i++)
+        {
+            w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = m_state[0];
+        uint32_t b = m_state[1];
+        uint32_t c = m_state[2];
+        uint32_t d = m_state[3];
+        uint32_t e = m_state[4];
+
+        auto round = [&](uint32_t f, uint32_t k, uint32_t word)
+        {
+            uint32_t temp = RotateLeft(a, 5) + f + e + k + word;
+
+            e = d;
+            d = c;
+            c = RotateLeft(b, 30);
+            b = a;
+            a = temp;
+        };
+
+        // Four groups of 20 rounds, each with its own mixing function and constant.
+        for (int i = 0; i < 20; i++)
+            round((b & c) | (~b & d), 0x5A827999, w[i]);
+
+        for (int i = 20; i < 40; i++)
+            round(b ^ c ^ d, 0x6ED9EBA1, w[i]);
+
+        for (int i = 40; i < 60; i++)
+            round((b & c) | (b & d) | (c & d), 0x8F1BBCDC, w[i]);
+
+        for (int i = 60; i < 80; i++)
+            round(b ^ c ^ d, 0xCA62C1D6, w[i]);
+
+        m_state[0] += a;
+        m_state[1] += b;
+        m_state[2] += c;
+        m_state[3] += d;
+        m_state[4] += e;
+    }
+
+}}}}
@@ -0,0 +1,36 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas
+{
+    // Incremental SHA-1 (FIPS 180-4) implementation. This is used to generate stable
+    // IDs from data such as shader code, not for anything security sensitive, and is
+    // portable C++ so it avoids the cost of activating the WinRT crypto APIs.
+    class Sha1
+    {
+    public:
+        static const size_t DigestSize = 20;
+
+        Sha1();
+
+        void Update(uint8_t const* data, size_t dataSize);
+        void Finish(uint8_t (&digest)[DigestSize]);
+
+    private:
+        static const size_t BlockSize = 64;
+
+        uint32_t m_state[5];
+        uint64_t m_totalSize;
+        uint8_t m_block[BlockSize];
+        size_t m_blockSize;
+
+        void ProcessBlock(uint8_t const* block);
+    };
+
+}}}}
@@ -24,9 +24,14 @@ STRING(CanvasPrintDocumentGetDeferralMayOnlyBeCalledOnce, L"GetDeferral can only
 STRING(CanvasPrintDocumentDeferralCompleteMayOnlyBeCalledOnce, L"CanvasPrintDeferral.Complete may only be called once.")
 STRING(ColorManagementProfileTypeNotSupported, L"This type of ColorManagementProfile is not supported on this version of Windows. Use ColorManagementProfile.IsSupported to determine which types are available.")
 STRING(CommandListCannotBeDrawnToAfterItHasBeenUsed, L"CanvasCommandList.CreateDrawingSession cannot be called after the CanvasCommandList has been used as an image.")
+STRING(CpuEffectInfiniteBounds, L"This effect graph has infinite bounds, so a region to render must be specified.")
+STRING(CpuEffectUnsupportedEffect, L"This effect graph contains an effect, or effect mode, that is not supported by the CPU effect renderer.")
+STRING(CpuEffectUnsupportedSource, L"This effect graph contains a source image that is not supported by the CPU effect renderer.")
+STRING(CpuEffectRenderOnCpuInfiniteBounds, L"An effect graph with infinite bounds cannot be rendered on the CPU. Use a CropEffect to limit it to a finite region.")
 STRING(CreateDrawingSessionCalledBeforeRegionsInvalidated, L"CreateDrawingSession cannot be called before the RegionsInvalidated event has been raised.")
 STRING(CustomEffectBadFeatureLevel, L"This shader requires a higher Direct3D feature level than is supported by the device. Check PixelShaderEffect.IsSupported before using it.")
 STRING(CustomEffectBadShader, L"Unable to load the specified shader. This should be a Direct3D pixel shader compiled for shader model 4.")
+STRING(CustomEffectBadShaderPackage, L"Unable to load the specified shader package. The package is corrupt or was created by an incompatible version of the shaderpackage tool.")
 STRING(CustomEffectBadPropertyType, L"Shader property '%S' is an unsupported type.")
 STRING(CustomEffectMaxOffsetWithoutOffsetMapping, L"When PixelShaderEffect.MaxSamplerOffset is set, at least one source should be using SamplerCoordinateMapping.Offset.")
 STRING(CustomEffectOffsetMappingWithoutMaxOffset, L"When PixelShaderEffect.Source%dMapping is set to Offset, MaxSamplerOffset should also be set.")
@@ -59,6 +64,7 @@ STRING(NotSupportedOnThisVersionOfWindows, L"This API is not supported on this v
 STRING(PathBuilderAddGeometryMidFigure, L"CanvasPathBuilder.AddGeometry may not be called in the middle of a figure.")
 STRING(PathBuilderClosedMidFigure, L"There was an attempt to use a CanvasPathBuilder, which was missing a call to CanvasPathBuilder.EndFigure.")
 STRING(PixelColorsFormatRestriction, L"This method only supports resources with pixel format DirectXPixelFormat.B8G8R8A8UIntNormalized.")
+STRING(PixelFormatConversionRestriction, L"Pixel format conversion only supports pixel formats DirectXPixelFormat.B8G8R8A8UIntNormalized, B8G8R8A8UIntNormalizedSrgb, R8G8B8A8UIntNormalized, R8G8B8A8UIntNormalizedSrgb and R16G16B16A16Float, with premultiplied, straight or ignored alpha.")
 STRING(PoppedWrongLayer, L"Attempting to close a CanvasActiveLayer that is not top of the stack. The most recently created layer must be closed first.")
 STRING(RemoteFontUnavailable, L"The requested font is not locally available.")
 STRING(ResourceManagerNoDevice, L"To wrap this resource type, a device parameter must be passed to GetOrCreate.")
@@ -147,7 +147,10 @@ CanvasAnimatedControl::CanvasAnimatedControl(std::shared_ptr<ICanvasAnimatedCont
     : BaseControlWithDrawHandler<CanvasAnimatedControlTraits>(adapter, false)
     , m_stepTimer(adapter)
     , m_hasUpdated(false)
+    , m_effectAnimator(Make<Effects::CanvasEffectAnimator>())
 {
+    CheckMakeResult(m_effectAnimator);
+
     CreateContentControl();
 
     m_sharedState.IsStepTimerFixedStep = m_stepTimer.IsFixedTimeStep();
@@ -540,6 +543,17 @@ IFACEMETHODIMP CanvasAnimatedControl::RunOnGameLoopThreadAsync(
         });
 }
 
+IFACEMETHODIMP CanvasAnimatedControl::get_EffectAnimator(Effects::ICanvasEffectAnimator** value)
+{
+    return ExceptionBoundary(
+        [&]
+        {
+            CheckAndClearOutPointer(value);
+
+            ThrowIfFailed(m_effectAnimator.CopyTo(value));
+        });
+}
+
 void CanvasAnimatedControl::CreateOrUpdateRenderTarget(
     ICanvasDevice* device,
     CanvasAlphaMode newAlphaMode,
@@ -1279,6 +1293,9 @@ CanvasAnimatedControl::UpdateResult CanvasAnimatedControl::Update(bool forceUpda
             auto timing = GetTimingInformationFromTimer();
             timing.IsRunningSlowly = isRunningSlowly;
 
+            // Animated effect properties are committed first, so Update handlers see (and can override) the new values.
+            m_effectAnimator->GetAnimator().Update(timing.TotalTime);
+
             auto updateEventArgs = Make<CanvasAnimatedUpdateEventArgs>(timing);
             ThrowIfFailed(m_updateEventList.InvokeAll(this, updateEventArgs.Get()));
 
@@ -9,6 +9,7 @@
 #include "CanvasGameLoop.h"
 #include "CanvasSwapChainPanel.h"
 #include "StepTimer.h"
+#include "effects/EffectAnimator.h"
 
 namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { namespace UI { namespace Xaml
 {
@@ -140,6 +141,9 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
         StepTimer m_stepTimer;
         bool m_hasUpdated;
 
+        // Evaluated once per update, before the Update event is raised. Internally synchronized.
+        ComPtr<Effects::CanvasEffectAnimator> m_effectAnimator;
+
         //
         // State shared between the UI thread and the update/render thread.
         // Access to this must be guarded using m_sharedStateMutex
@@ -241,6 +245,8 @@ namespace ABI { namespace Microsoft { namespace Graphics { namespace Canvas { na
             IDispatchedHandler* callback,
             IAsyncAction** asyncAction) override;
 
+        IFACEMETHODIMP get_EffectAnimator(Effects::ICanvasEffectAnimator** value) override;
+
         //
         // BaseControl
         //
@@ -109,6 +109,147 @@ public:
             });
     }
 
+    TEST_METHOD(CanvasBitmap_LoadCachedAsync_FromFile_ReturnsSameBitmapUntilTrimmed)
+    {
+        auto canvasDevice = ref new CanvasDevice();
+        auto fileName = L"Assets/HighDpiGrid.png";
+
+        auto first = WaitExecution(CanvasBitmap::LoadCachedAsync(canvasDevice, fileName));
+        auto second = WaitExecution(CanvasBitmap::LoadCachedAsync(canvasDevice, fileName));
+
+        Assert::AreEqual(first, second);
+        Assert::AreEqual(4u, first->SizeInPixels.Width);
+
+        // Regular loads are not cached.
+        auto uncached = WaitExecution(CanvasBitmap::LoadAsync(canvasDevice, fileName));
+        Assert::AreNotEqual(GetWrappedResource<ID2D1Bitmap1>(first).Get(), GetWrappedResource<ID2D1Bitmap1>(uncached).Get());
+
+        // Nor are loads with a different DPI.
+        auto highDpi = WaitExecution(CanvasBitmap::LoadCachedAsync(canvasDevice, fileName, 150, CanvasAlphaMode::Premultiplied));
+        Assert::AreNotEqual(first, highDpi);
+        Assert::AreEqual(150.0f, highDpi->Dpi);
+
+        auto d2dBitmap = GetWrappedResource<ID2D1Bitmap1>(first);
+        first = second = nullptr;
+
+        canvasDevice->Trim();
+
+        auto afterTrim = WaitExecution(CanvasBitmap::LoadCachedAsync(canvasDevice, fileName));
+        Assert::AreNotEqual(d2dBitmap.Get(), GetWrappedResource<ID2D1Bitmap1>(afterTrim).Get());
+    }
+
+    TEST_METHOD(CanvasBitmap_LoadCachedAsync_FromStreamsWithSameContents_ReturnsSameBitmap)
+    {
+        auto canvasDevice = ref new CanvasDevice();
+        auto uri = ref new Uri("ms-appx:///Assets/HighDpiGrid.png");
+
+        auto storageFile = WaitExecution(Windows::Storage::StorageFile::GetFileFromApplicationUriAsync(uri));
+
+        auto first = WaitExecution(CanvasBitmap::LoadCachedAsync(canvasDevice, WaitExecution(storageFile->OpenReadAsync())));
+        auto second = WaitExecution(CanvasBitmap::LoadCachedAsync(canvasDevice, WaitExecution(storageFile->OpenReadAsync())));
+
+        Assert::AreEqual(first, second);
+
+        // A closed bitmap is not handed out again, but its pixels are still cached.
+        auto d2dBitmap = GetWrappedResource<ID2D1Bitmap1>(first);
+        delete first;
+
+        auto third = WaitExecution(CanvasBitmap::LoadCachedAsync(canvasDevice, WaitExecution(storageFile->OpenReadAsync())));
+
+        Assert::AreNotEqual(second, third);
+        Assert::AreEqual(d2dBitmap.Get(), GetWrappedResource<ID2D1Bitmap1>(third).Get());
+    }
+
+    TEST_METHOD(CanvasBitmapBatchLoader_LoadAsync_FromFileUriAndStream)
+    {
+        auto canvasDevice = ref new CanvasDevice();
+        auto loader = ref new CanvasBitmapBatchLoader(canvasDevice, 2, 150, CanvasAlphaMode::Premultiplied);
+
+        auto uri = ref new Uri("ms-appx:///Assets/HighDpiGrid.png");
+        auto storageFile = WaitExecution(Windows::Storage::StorageFile::GetFileFromApplicationUriAsync(uri));
+
+        auto fromFile = loader->LoadAsync("Assets/HighDpiGrid.png", 0);
+        auto fromUri = loader->LoadAsync(uri, 1);
+        auto fromStream = loader->LoadAsync(WaitExecution(storageFile->OpenReadAsync()), 2);
+
+        for (auto bitmap : { WaitExecution(fromFile), WaitExecution(fromUri), WaitExecution(fromStream) })
+        {
+            Assert::AreEqual(4u, bitmap->SizeInPixels.Width);
+            Assert::AreEqual(150.0f, bitmap->Dpi);
+            Assert::AreEqual(canvasDevice, bitmap->Device);
+        }
+
+        Assert::AreEqual(0, loader->QueuedCount);
+        Assert::IsFalse(loader->SetPriority(fromFile, 10));
+    }
+
+    TEST_METHOD(CanvasBitmapBatchLoader_LoadAsync_FileNotFound)
+    {
+        auto loader = ref new CanvasBitmapBatchLoader(ref new CanvasDevice());
+
+        auto async = loader->LoadAsync("FileThatDoesNotExist.jpg", 0);
+        ExpectCOMException(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND), [&] { WaitExecution(async); });
+    }
+
+    TEST_METHOD(CanvasBitmapBatchLoader_Closed)
+    {
+        auto loader = ref new CanvasBitmapBatchLoader(ref new CanvasDevice());
+
+        delete loader;
+
+        ExpectObjectClosed([&] { loader->LoadAsync("Assets/HighDpiGrid.png", 0); });
+        ExpectObjectClosed([&] { loader->CancelAll(); });
+        ExpectObjectClosed([&] { loader->QueuedCount; });
+    }
+
+    TEST_METHOD(CanvasBitmapBatchExporter_SaveAsync_ToStreamAndFile)
+    {
+        auto canvasDevice = ref new CanvasDevice();
+        auto exporter = ref new CanvasBitmapBatchExporter(2, 0);
+
+        auto renderTarget = ref new CanvasRenderTarget(canvasDevice, 4, 4, DEFAULT_DPI);
+
+        auto stream = ref new InMemoryRandomAccessStream();
+        String^ fileName = String::Concat(Windows::Storage::ApplicationData::Current->TemporaryFolder->Path, L"\\batch.png");
+
+        auto toStream = exporter->SaveAsync(renderTarget, stream, CanvasBitmapFileFormat::Png);
+        auto toFile = exporter->SaveAsync(renderTarget, fileName);
+
+        WaitExecution(toStream);
+        WaitExecution(toFile);
+
+        Assert::IsTrue(stream->Size > 0);
+
+        auto reloaded = WaitExecution(CanvasBitmap::LoadAsync(canvasDevice, fileName));
+        Assert::AreEqual(4u, reloaded->SizeInPixels.Width);
+
+        auto statistics = exporter->Statistics;
+        Assert::AreEqual<uint64_t>(2, statistics.BitmapsExported);
+        Assert::AreEqual<uint64_t>(0, statistics.BitmapsFailed);
+        Assert::AreEqual<uint64_t>(2 * 4 * 4, statistics.PixelsExported);
+    }
+
+    TEST_METHOD(CanvasBitmapBatchExporter_SaveAsync_InvalidArguments)
+    {
+        auto exporter = ref new CanvasBitmapBatchExporter();
+        auto renderTarget = ref new CanvasRenderTarget(m_sharedDevice, 1, 1, DEFAULT_DPI);
+
+        Assert::ExpectException<Platform::InvalidArgumentException^>([&] { exporter->SaveAsync(renderTarget, ref new InMemoryRandomAccessStream(), CanvasBitmapFileFormat::Auto); });
+        Assert::ExpectException<Platform::InvalidArgumentException^>([&] { exporter->SaveAsync(renderTarget, ref new InMemoryRandomAccessStream(), CanvasBitmapFileFormat::Jpeg, 1.5f); });
+        Assert::ExpectException<Platform::InvalidArgumentException^>([&] { ref new CanvasBitmapBatchExporter(-1, 0); });
+    }
+
+    TEST_METHOD(CanvasBitmapBatchExporter_Closed)
+    {
+        auto exporter = ref new CanvasBitmapBatchExporter();
+        auto renderTarget = ref new CanvasRenderTarget(m_sharedDevice, 1, 1, DEFAULT_DPI);
+
+        delete exporter;
+
+        ExpectObjectClosed([&] { exporter->SaveAsync(renderTarget, ref new InMemoryRandomAccessStream(), CanvasBitmapFileFormat::Png); });
+        ExpectObjectClosed([&] { exporter->Statistics; });
+    }
+
     TEST_METHOD(CanvasBitmap_LoadStreamAndUri)
     {
         CanvasDevice^ canvasDevice = ref new CanvasDevice();
@@ -1962,6 +2103,136 @@ public:
             });
     }
 
+    TEST_METHOD(CanvasBitmap_CreateFromBytesWithStride_SkipsRowPadding)
+    {
+        const int width = 2;
+        const int height = 3;
+        const uint32_t stride = 12;
+
+        // Each row holds two pixels, then four bytes of padding that must be ignored.
+        // The last row is not padded.
+        const uint32_t length = stride * (height - 1) + width * 4;
+
+        auto writer = ref new DataWriter();
+
+        for (uint32_t i = 0; i < length; ++i)
+        {
+            writer->WriteByte((i % stride) < width * 4 ? static_cast<byte>(i) : 0xFF);
+        }
+
+        auto buffer = writer->DetachBuffer();
+
+        auto bitmap = CanvasBitmap::CreateFromBytes(m_sharedDevice, buffer, width, height, stride, DirectXPixelFormat::B8G8R8A8UIntNormalized, DEFAULT_DPI, CanvasAlphaMode::Ignore);
+
+        Assert::AreEqual(static_cast<uint32_t>(width), bitmap->SizeInPixels.Width);
+        Assert::AreEqual(static_cast<uint32_t>(height), bitmap->SizeInPixels.Height);
+
+        auto pixelBytes = bitmap->GetPixelBytes();
+        Assert::AreEqual(static_cast<uint32_t>(width * height * 4), pixelBytes->Length);
+
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width * 4; ++x)
+            {
+                Assert::AreEqual(static_cast<byte>(y * stride + x), pixelBytes[y * width * 4 + x]);
+            }
+        }
+
+        // A stride shorter than a row, or a buffer too short for the last row, is rejected.
+        ExpectCOMException(E_INVALIDARG, [&] { CanvasBitmap::CreateFromBytes(m_sharedDevice, buffer, width, height, width * 4 - 1, DirectXPixelFormat::B8G8R8A8UIntNormalized, DEFAULT_DPI, CanvasAlphaMode::Ignore); });
+        ExpectCOMException(E_INVALIDARG, [&] { CanvasBitmap::CreateFromBytes(m_sharedDevice, buffer, width, height + 1, stride, DirectXPixelFormat::B8G8R8A8UIntNormalized, DEFAULT_DPI, CanvasAlphaMode::Ignore); });
+    }
+
+    TEST_METHOD(CanvasBitmap_GetPixelBytesWithFormat_ConvertsFromBitmapFormat)
+    {
+        Color color[] = { ColorHelper::FromArgb(128, 200, 100, 50) };
+        auto bitmap = CanvasBitmap::CreateFromColors(m_sharedDevice, ref new Platform::Array<Color>(color, 1), 1, 1);
+
+        // B8G8R8A8 premultiplied is stored as (50, 100, 200) * 128 / 255, then alpha.
+        auto premultipliedBgra = bitmap->GetPixelBytes();
+        Assert::AreEqual(4u, premultipliedBgra->Length);
+
+        // Reading back as R8G8B8A8 swaps red and blue, leaving the values premultiplied.
+        auto premultipliedRgba = bitmap->GetPixelBytes(DirectXPixelFormat::R8G8B8A8UIntNormalized, CanvasAlphaMode::Premultiplied);
+        Assert::AreEqual(4u, premultipliedRgba->Length);
+        Assert::AreEqual(premultipliedBgra[2], premultipliedRgba[0]);
+        Assert::AreEqual(premultipliedBgra[1], premultipliedRgba[1]);
+        Assert::AreEqual(premultipliedBgra[0], premultipliedRgba[2]);
+        Assert::AreEqual(premultipliedBgra[3], premultipliedRgba[3]);
+
+        // Half floats take 8 bytes per pixel.
+        auto halfFloat = bitmap->GetPixelBytes(DirectXPixelFormat::R16G16B16A16Float, CanvasAlphaMode::Premultiplied);
+        Assert::AreEqual(8u, halfFloat->Length);
+
+        ExpectCOMException(E_INVALIDARG, [&] { bitmap->GetPixelBytes(DirectXPixelFormat::BC1UIntNormalized, CanvasAlphaMode::Premultiplied); });
+    }
+
+    TEST_METHOD(CanvasBitmap_SetPixelBytesWithFormat_ConvertsToBitmapFormat)
+    {
+        auto bitmap = CanvasBitmap::CreateFromColors(m_sharedDevice, ref new Platform::Array<Color>(2), 2, 1);
+
+        // Straight alpha R8G8B8A8, which is premultiplied and reordered to B8G8R8A8 on the way in.
+        byte straightRgba[] = { 200, 100, 50, 255, 10, 20, 30, 255 };
+
+        bitmap->SetPixelBytes(ref new Platform::Array<byte>(straightRgba, _countof(straightRgba)), DirectXPixelFormat::R8G8B8A8UIntNormalized, CanvasAlphaMode::Straight);
+
+        auto colors = bitmap->GetPixelColors();
+
+        Assert::AreEqual(ColorHelper::FromArgb(255, 200, 100, 50), colors[0]);
+        Assert::AreEqual(ColorHelper::FromArgb(255, 10, 20, 30), colors[1]);
+
+        ExpectCOMException(E_INVALIDARG, [&] { bitmap->SetPixelBytes(ref new Platform::Array<byte>(7), DirectXPixelFormat::R8G8B8A8UIntNormalized, CanvasAlphaMode::Straight); });
+    }
+
+    TEST_METHOD(CanvasBitmap_GetPixelBytesAsync_MatchesGetPixelBytes)
+    {
+        auto renderTarget = ref new CanvasRenderTarget(m_sharedDevice, 8, 8, DEFAULT_DPI);
+
+        {
+            auto drawingSession = renderTarget->CreateDrawingSession();
+            drawingSession->Clear(Colors::Blue);
+            drawingSession->FillRectangle(2, 2, 4, 4, Colors::Red);
+        }
+
+        auto expected = renderTarget->GetPixelBytes();
+        auto buffer = ref new Buffer(expected->Length);
+
+        WaitExecution(renderTarget->GetPixelBytesAsync(buffer));
+
+        Assert::AreEqual(expected->Length, buffer->Length);
+
+        auto actual = ref new Platform::Array<byte>(buffer->Length);
+        DataReader::FromBuffer(buffer)->ReadBytes(actual);
+
+        for (auto i = 0u; i < expected->Length; ++i)
+        {
+            Assert::AreEqual(expected[i], actual[i]);
+        }
+
+        // The subrectangle overload only fills as much of the buffer as it needs.
+        auto expectedSubrectangle = renderTarget->GetPixelBytes(2, 2, 4, 4);
+
+        WaitExecution(renderTarget->GetPixelBytesAsync(buffer, 2, 2, 4, 4));
+
+        Assert::AreEqual(expectedSubrectangle->Length, buffer->Length);
+
+        actual = ref new Platform::Array<byte>(buffer->Length);
+        DataReader::FromBuffer(buffer)->ReadBytes(actual);
+
+        for (auto i = 0u; i < expectedSubrectangle->Length; ++i)
+        {
+            Assert::AreEqual(expectedSubrectangle[i], actual[i]);
+        }
+    }
+
+    TEST_METHOD(CanvasBitmap_GetPixelBytesAsync_WhenBufferIsTooSmall_FailsBeforeReturning)
+    {
+        auto renderTarget = ref new CanvasRenderTarget(m_sharedDevice, 8, 8, DEFAULT_DPI);
+        auto buffer = ref new Buffer(8 * 8 * 4 - 1);
+
+        ExpectCOMException(E_INVALIDARG, [&] { renderTarget->GetPixelBytesAsync(buffer); });
+    }
+
     TEST_METHOD(CanvasBitmap_SetPixelBytes)
     {
         ForAllBlockCompressedFormats(
@@ -1373,6 +1373,77 @@ TEST_CLASS(CanvasEffectsTests)
         Assert::IsFalse(!!d2dEffect2->GetValue<BOOL>(D2D1_PROPERTY_CACHED));
     }
 
+    TEST_METHOD(CanvasEffect_RenderOnCpu_MatchesGpuRendering)
+    {
+        auto device = ref new CanvasDevice();
+
+        const int width = 4;
+        const int height = 4;
+
+        auto colors = ref new Array<Color>(width * height);
+
+        for (int i = 0; i < width * height; i++)
+        {
+            colors[i] = Color{ 255, static_cast<uint8_t>(i * 16), static_cast<uint8_t>(255 - i * 16), static_cast<uint8_t>(i * 8) };
+        }
+
+        auto bitmap = CanvasBitmap::CreateFromColors(device, colors, width, height, DEFAULT_DPI, CanvasAlphaMode::Premultiplied);
+
+        // Swap red and blue, then move the result away from the origin.
+        auto colorMatrix = ref new ColorMatrixEffect();
+        colorMatrix->Source = bitmap;
+        colorMatrix->ColorMatrix = Matrix5x4{ 0, 0, 1, 0,
+                                              0, 1, 0, 0,
+                                              1, 0, 0, 0,
+                                              0, 0, 0, 1,
+                                              0, 0, 0, 0 };
+
+        auto transform = ref new Transform2DEffect();
+        transform->Source = colorMatrix;
+        transform->TransformMatrix = float3x2{ 1, 0, 0, 1, 2, 1 };
+
+        Assert::IsFalse(transform->RenderOnCpu);
+
+        auto draw = [&]
+        {
+            auto renderTarget = ref new CanvasRenderTarget(device, 8, 8, DEFAULT_DPI);
+
+            auto drawingSession = renderTarget->CreateDrawingSession();
+            drawingSession->Clear(Colors::Transparent);
+            drawingSession->DrawImage(transform);
+            delete drawingSession;
+
+            return renderTarget->GetPixelColors();
+        };
+
+        auto gpuColors = draw();
+
+        transform->RenderOnCpu = true;
+        Assert::IsTrue(transform->RenderOnCpu);
+
+        auto cpuColors = draw();
+
+        // The GPU may round differently, so allow the channels to differ by one.
+        auto assertClose = [](uint8_t expected, uint8_t actual)
+        {
+            Assert::AreEqual(static_cast<float>(expected), static_cast<float>(actual), 1.0f);
+        };
+
+        for (unsigned i = 0; i < gpuColors->Length; i++)
+        {
+            assertClose(gpuColors[i].A, cpuColors[i].A);
+            assertClose(gpuColors[i].R, cpuColors[i].R);
+            assertClose(gpuColors[i].G, cpuColors[i].G);
+            assertClose(gpuColors[i].B, cpuColors[i].B);
+        }
+
+        // The source was moved to (2, 1), with its red and blue swapped.
+        Assert::AreEqual<int>(255, cpuColors[1 * 8 + 2].A);
+        Assert::AreEqual<int>(colors[0].B, cpuColors[1 * 8 + 2].R);
+        Assert::AreEqual<int>(colors[0].R, cpuColors[1 * 8 + 2].B);
+        Assert::AreEqual<int>(0, cpuColors[0].A);
+    }
+
     template<typename TValue, typename TGetter, typename TSetter>
     static void TestInterfaceProperty_NotRealized(TValue^ const& valueWrapper, TGetter&& getter, TSetter&& setter)
     {
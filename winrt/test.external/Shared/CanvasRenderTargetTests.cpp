@@ -103,4 +103,56 @@ TEST_CLASS(CanvasRenderTargetTests)
                 renderTarget->CreateDrawingSession();
             });
     }
+
+
+    TEST_METHOD(CanvasRenderTarget_CreateTransient_ReusesClosedRenderTargetsBitmap)
+    {
+        auto device = ref new CanvasDevice();
+
+        auto renderTarget = CanvasRenderTarget::CreateTransient(device, 23, 42, DEFAULT_DPI, DirectXPixelFormat::B8G8R8A8UIntNormalized, CanvasAlphaMode::Premultiplied);
+        auto d2dBitmap = GetWrappedResource<ID2D1Bitmap1>(renderTarget);
+
+        Assert::AreEqual(Size{ 23, 42 }, renderTarget->Size);
+
+        delete renderTarget;
+
+        ExpectObjectClosed([&] { renderTarget->CreateDrawingSession(); });
+
+        auto sameSize = CanvasRenderTarget::CreateTransient(device, 23, 42, DEFAULT_DPI, DirectXPixelFormat::B8G8R8A8UIntNormalized, CanvasAlphaMode::Premultiplied);
+        Assert::AreEqual(d2dBitmap.Get(), GetWrappedResource<ID2D1Bitmap1>(sameSize).Get());
+
+        // Only closed render targets are reused.
+        auto secondSameSize = CanvasRenderTarget::CreateTransient(device, 23, 42, DEFAULT_DPI, DirectXPixelFormat::B8G8R8A8UIntNormalized, CanvasAlphaMode::Premultiplied);
+        Assert::AreNotEqual(d2dBitmap.Get(), GetWrappedResource<ID2D1Bitmap1>(secondSameSize).Get());
+
+        auto otherSize = CanvasRenderTarget::CreateTransient(device, 42, 23, DEFAULT_DPI, DirectXPixelFormat::B8G8R8A8UIntNormalized, CanvasAlphaMode::Premultiplied);
+        Assert::AreNotEqual(d2dBitmap.Get(), GetWrappedResource<ID2D1Bitmap1>(otherSize).Get());
+    }
+
+
+    TEST_METHOD(CanvasRenderTarget_CreateTransient_UsesResourceCreatorDpi)
+    {
+        auto creator = ref new StubResourceCreatorWithDpi(ref new CanvasDevice(), 144);
+
+        auto renderTarget = CanvasRenderTarget::CreateTransient(creator, 23, 42);
+
+        Assert::AreEqual(creator->Dpi, renderTarget->Dpi);
+        Assert::AreEqual(DirectXPixelFormat::B8G8R8A8UIntNormalized, renderTarget->Format);
+        Assert::AreEqual(CanvasAlphaMode::Premultiplied, renderTarget->AlphaMode);
+    }
+
+
+    TEST_METHOD(CanvasRenderTarget_CreateTransient_AfterTrim_DoesNotReuseBitmap)
+    {
+        auto device = ref new CanvasDevice();
+
+        auto renderTarget = CanvasRenderTarget::CreateTransient(device, 16, 16, DEFAULT_DPI, DirectXPixelFormat::B8G8R8A8UIntNormalized, CanvasAlphaMode::Premultiplied);
+        auto d2dBitmap = GetWrappedResource<ID2D1Bitmap1>(renderTarget);
+        delete renderTarget;
+
+        device->Trim();
+
+        auto newRenderTarget = CanvasRenderTarget::CreateTransient(device, 16, 16, DEFAULT_DPI, DirectXPixelFormat::B8G8R8A8UIntNormalized, CanvasAlphaMode::Premultiplied);
+        Assert::AreNotEqual(d2dBitmap.Get(), GetWrappedResource<ID2D1Bitmap1>(newRenderTarget).Get());
+    }
 };
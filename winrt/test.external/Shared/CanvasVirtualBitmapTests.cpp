@@ -63,6 +63,48 @@ public:
         Assert::AreEqual(4.0f, bounds.Width);
         Assert::AreEqual(4.0f, bounds.Height);
     }
+
+    TEST_METHOD(CanvasVirtualBitmapTileCache_WhenBitmapIsNotCachedOnDemand_Throws)
+    {
+        auto virtualBitmap = WaitExecution(CanvasVirtualBitmap::LoadAsync(m_device, "Assets/HighDpiGrid.png"));
+
+        Assert::IsFalse(virtualBitmap->IsCachedOnDemand);
+
+        Assert::ExpectException<Platform::InvalidArgumentException^>(
+            [&] { ref new CanvasVirtualBitmapTileCache(virtualBitmap); });
+    }
+
+    TEST_METHOD(CanvasVirtualBitmapTileCache_SetViewport_CountsVisibleTiles)
+    {
+        auto virtualBitmap = WaitExecution(CanvasVirtualBitmap::LoadAsync(m_device, "Assets/HighDpiGrid.png", CanvasVirtualBitmapOptions::CacheOnDemand));
+
+        Assert::IsTrue(virtualBitmap->IsCachedOnDemand);
+
+        // A 4x4 image in 2 pixel tiles, so the whole image is 4 tiles.
+        auto tileCache = ref new CanvasVirtualBitmapTileCache(virtualBitmap, 2, 1024);
+
+        tileCache->SetViewport(Rect{ 0, 0, 4, 4 });
+
+        auto statistics = tileCache->Statistics;
+        Assert::AreEqual<uint64_t>(0, statistics.VisibleTileHits);
+        Assert::AreEqual<uint64_t>(4, statistics.VisibleTileMisses);
+
+        delete tileCache;
+
+        ExpectObjectClosed([&] { tileCache->SetViewport(Rect{ 0, 0, 4, 4 }); });
+        ExpectObjectClosed([&] { tileCache->Statistics; });
+    }
+
+    TEST_METHOD(CanvasVirtualBitmapTileCache_InvalidTileSize_Throws)
+    {
+        auto virtualBitmap = WaitExecution(CanvasVirtualBitmap::LoadAsync(m_device, "Assets/HighDpiGrid.png", CanvasVirtualBitmapOptions::CacheOnDemand));
+
+        Assert::ExpectException<Platform::InvalidArgumentException^>(
+            [&] { ref new CanvasVirtualBitmapTileCache(virtualBitmap, 0, 1024); });
+
+        Assert::ExpectException<Platform::InvalidArgumentException^>(
+            [&] { ref new CanvasVirtualBitmapTileCache(virtualBitmap, -1, 1024); });
+    }
 };
 
 #endif
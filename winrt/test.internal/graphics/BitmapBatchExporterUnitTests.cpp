@@ -0,0 +1,412 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/images/BitmapBatchExporter.h>
+
+//
+// 8x8 staging bitmap with padding at the end of each row, which can be held
+// in Map to simulate a GPU copy that hasn't finished yet.
+//
+class ExportStagingD2DBitmap : public MockD2DBitmap
+{
+public:
+    static const uint32_t Size = 8;
+    static const uint32_t Pitch = Size * 4 + 8;
+
+    std::vector<uint8_t> Pixels;
+    HRESULT MapResult;
+    std::shared_future<void> MapReleased;
+
+    ExportStagingD2DBitmap()
+        : Pixels(Pitch * Size)
+        , MapResult(S_OK)
+    {
+        for (size_t i = 0; i < Pixels.size(); i++)
+        {
+            Pixels[i] = static_cast<uint8_t>(i % 251);
+        }
+
+        CopyFromBitmapMethod.AllowAnyCall();
+    }
+
+    STDMETHOD(Map)(D2D1_MAP_OPTIONS options, D2D1_MAPPED_RECT* mappedRect) override
+    {
+        if (MapReleased.valid())
+            MapReleased.wait();
+
+        if (FAILED(MapResult))
+            return MapResult;
+
+        mappedRect->pitch = Pitch;
+        mappedRect->bits = Pixels.data();
+        return S_OK;
+    }
+
+    STDMETHOD(Unmap)() override
+    {
+        return S_OK;
+    }
+};
+
+
+template<typename T>
+static bool IsReady(std::future<T> const& future, std::chrono::milliseconds timeout = std::chrono::milliseconds(0))
+{
+    return future.wait_for(timeout) == std::future_status::ready;
+}
+
+
+TEST_CLASS(BitmapBatchExporterUnitTests)
+{
+    struct Fixture
+    {
+        ComPtr<StubCanvasDevice> Device;
+        ComPtr<StubD2DBitmap> D2DBitmap;
+        ComPtr<CanvasBitmap> Bitmap;
+        D2D1_PIXEL_FORMAT PixelFormat;
+
+        std::vector<ComPtr<ExportStagingD2DBitmap>> StagingBitmaps;
+
+        // When set, staging bitmaps can't be mapped until ReleaseMaps is called.
+        std::promise<void> MapsReleased;
+        std::shared_future<void> MapsReleasedFuture;
+        bool HoldMaps;
+
+        Fixture(bool holdMaps = false)
+            : Device(Make<StubCanvasDevice>())
+            , D2DBitmap(Make<StubD2DBitmap>())
+            , PixelFormat(D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE))
+            , MapsReleasedFuture(MapsReleased.get_future().share())
+            , HoldMaps(holdMaps)
+        {
+            D2DBitmap->GetPixelFormatMethod.AllowAnyCall([=] { return PixelFormat; });
+            D2DBitmap->GetPixelSizeMethod.AllowAnyCall([] { return D2D1_SIZE_U{ ExportStagingD2DBitmap::Size, ExportStagingD2DBitmap::Size }; });
+
+            Bitmap = Make<CanvasBitmap>(Device.Get(), D2DBitmap.Get());
+
+            Device->LeaseStagingBitmapMethod.AllowAnyCall(
+                [=](D2D1_SIZE_U, D2D1_PIXEL_FORMAT)
+                {
+                    auto stagingBitmap = Make<ExportStagingD2DBitmap>();
+
+                    if (HoldMaps)
+                        stagingBitmap->MapReleased = MapsReleasedFuture;
+
+                    StagingBitmaps.push_back(stagingBitmap);
+                    return StagingBitmapLease(stagingBitmap);
+                });
+        }
+
+        void ReleaseMaps()
+        {
+            MapsReleased.set_value();
+        }
+    };
+
+    static BitmapBatchExporter::Options WithOneWorker(uint32_t maximumQueuedBitmaps = 0)
+    {
+        BitmapBatchExporter::Options options;
+        options.MaximumConcurrency = 1;
+        options.MaximumQueuedBitmaps = maximumQueuedBitmaps;
+        return options;
+    }
+
+    static ComPtr<IStream> CreateMemoryStream()
+    {
+        ComPtr<IStream> stream;
+        ThrowIfFailed(CreateStreamOnHGlobal(nullptr, TRUE, &stream));
+        return stream;
+    }
+
+    TEST_METHOD_EX(BitmapBatchExporter_Construction_DefaultsToTwoQueuedBitmapsPerWorker)
+    {
+        BitmapBatchExporter exporter(WithOneWorker());
+
+        Assert::AreEqual(1u, exporter.GetWorkerCount());
+        Assert::AreEqual(2u, exporter.GetMaximumQueuedBitmaps());
+    }
+
+    TEST_METHOD_EX(BitmapBatchExporter_Export_ValidatesArguments)
+    {
+        Fixture f;
+        BitmapBatchExporter exporter(WithOneWorker());
+
+        auto stream = CreateMemoryStream();
+
+        ExpectHResultException(E_INVALIDARG, [&] { exporter.Export(nullptr, stream.Get(), CanvasBitmapFileFormat::Png); });
+        ExpectHResultException(E_INVALIDARG, [&] { exporter.Export(f.Bitmap.Get(), static_cast<IStream*>(nullptr), CanvasBitmapFileFormat::Png); });
+        ExpectHResultException(E_INVALIDARG, [&] { exporter.Export(f.Bitmap.Get(), stream.Get(), CanvasBitmapFileFormat::Auto); });
+        ExpectHResultException(E_INVALIDARG, [&] { exporter.Export(f.Bitmap.Get(), stream.Get(), CanvasBitmapFileFormat::Jpeg, -0.1f); });
+        ExpectHResultException(E_INVALIDARG, [&] { exporter.Export(f.Bitmap.Get(), stream.Get(), CanvasBitmapFileFormat::Jpeg, 1.1f); });
+        ExpectHResultException(E_INVALIDARG, [&] { exporter.Export(f.Bitmap.Get(), HStringReference(L"tile.unknown").Get(), CanvasBitmapFileFormat::Auto); });
+
+        // Nothing was copied for any of those.
+        Assert::AreEqual<size_t>(0, f.StagingBitmaps.size());
+    }
+
+    TEST_METHOD_EX(BitmapBatchExporter_Export_UnsupportedPixelFormat_Throws)
+    {
+        Fixture f;
+        f.PixelFormat = D2D1::PixelFormat(DXGI_FORMAT_A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED);
+
+        BitmapBatchExporter exporter(WithOneWorker());
+
+        ExpectHResultException(E_INVALIDARG, [&] { exporter.Export(f.Bitmap.Get(), CreateMemoryStream().Get(), CanvasBitmapFileFormat::Png); });
+    }
+
+    TEST_METHOD_EX(BitmapBatchExporter_GetWicPixelFormat)
+    {
+        Assert::IsTrue(GUID_WICPixelFormat32bppPBGRA == BitmapBatchExporter::GetWicPixelFormat(D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED)));
+        Assert::IsTrue(GUID_WICPixelFormat32bppBGR == BitmapBatchExporter::GetWicPixelFormat(D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE)));
+        Assert::IsTrue(GUID_WICPixelFormat32bppRGBA == BitmapBatchExporter::GetWicPixelFormat(D2D1::PixelFormat(DXGI_FORMAT_R8G8B8A8_UNORM, D2D1_ALPHA_MODE_STRAIGHT)));
+        Assert::IsTrue(GUID_WICPixelFormat64bppPRGBAHalf == BitmapBatchExporter::GetWicPixelFormat(D2D1::PixelFormat(DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_PREMULTIPLIED)));
+        Assert::IsTrue(GUID_WICPixelFormat128bppRGBAFloat == BitmapBatchExporter::GetWicPixelFormat(D2D1::PixelFormat(DXGI_FORMAT_R32G32B32A32_FLOAT, D2D1_ALPHA_MODE_STRAIGHT)));
+        Assert::IsTrue(GUID_NULL == BitmapBatchExporter::GetWicPixelFormat(D2D1::PixelFormat(DXGI_FORMAT_BC1_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED)));
+    }
+
+    TEST_METHOD_EX(BitmapBatchExporter_Export_EncodesStagingBitmapPixels)
+    {
+        Fixture f;
+        BitmapBatchExporter exporter(WithOneWorker());
+
+        auto stream = CreateMemoryStream();
+
+        exporter.Export(f.Bitmap.Get(), stream.Get(), CanvasBitmapFileFormat::Png).get();
+
+        // Decode the result, and check it matches the staging bitmap, minus its row padding.
+        auto factory = WicAdapter::GetInstance()->GetFactory();
+
+        ThrowIfFailed(stream->Seek(LARGE_INTEGER{}, STREAM_SEEK_SET, nullptr));
+
+        ComPtr<IWICBitmapDecoder> decoder;
+        ThrowIfFailed(factory->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, &decoder));
+
+        ComPtr<IWICBitmapFrameDecode> frame;
+        ThrowIfFailed(decoder->GetFrame(0, &frame));
+
+        ComPtr<IWICFormatConverter> converter;
+        ThrowIfFailed(factory->CreateFormatConverter(&converter));
+        ThrowIfFailed(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone, nullptr, 0, WICBitmapPaletteTypeCustom));
+
+        UINT width, height;
+        ThrowIfFailed(converter->GetSize(&width, &height));
+        Assert::AreEqual(8u, width);
+        Assert::AreEqual(8u, height);
+
+        uint32_t const stride = width * 4;
+        std::vector<uint8_t> decoded(stride * height);
+        ThrowIfFailed(converter->CopyPixels(nullptr, stride, static_cast<UINT>(decoded.size()), decoded.data()));
+
+        auto& expected = f.StagingBitmaps[0]->Pixels;
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                // Alpha is ignored, so only the color channels round trip.
+                for (uint32_t channel = 0; channel < 3; channel++)
+                {
+                    Assert::AreEqual(expected[y * ExportStagingD2DBitmap::Pitch + x * 4 + channel], decoded[y * stride + x * 4 + channel]);
+                }
+            }
+        }
+    }
+
+    TEST_METHOD_EX(BitmapBatchExporter_Export_CopiesBeforeEarlierBitmapsAreEncoded)
+    {
+        Fixture f(true);
+        BitmapBatchExporter exporter(WithOneWorker(2));
+
+        std::vector<std::future<void>> results;
+
+        for (int i = 0; i < 3; i++)
+        {
+            results.push_back(exporter.Export(f.Bitmap.Get(), CreateMemoryStream().Get(), CanvasBitmapFileFormat::Png));
+        }
+
+        // All three GPU copies have been started, although the first
+        // bitmap is still waiting to be mapped.
+        Assert::AreEqual<size_t>(3, f.StagingBitmaps.size());
+
+        for (auto& stagingBitmap : f.StagingBitmaps)
+        {
+            stagingBitmap->CopyFromBitmapMethod.SetExpectedCalls(0);
+        }
+
+        // The worker holds the first, and two more are queued, so the next export has to wait.
+        auto blockedExport = std::async(std::launch::async,
+            [&]
+            {
+                return exporter.Export(f.Bitmap.Get(), CreateMemoryStream().Get(), CanvasBitmapFileFormat::Png);
+            });
+
+        Assert::IsFalse(IsReady(blockedExport, std::chrono::milliseconds(50)));
+
+        f.ReleaseMaps();
+
+        results.push_back(blockedExport.get());
+
+        for (auto& result : results)
+        {
+            result.get();
+        }
+    }
+
+    TEST_METHOD_EX(BitmapBatchExporter_MapFailure_IsReportedThroughFuture)
+    {
+        Fixture f(true);
+        BitmapBatchExporter exporter(WithOneWorker());
+
+        auto result = exporter.Export(f.Bitmap.Get(), CreateMemoryStream().Get(), CanvasBitmapFileFormat::Png);
+
+        f.StagingBitmaps[0]->MapResult = DXGI_ERROR_DEVICE_REMOVED;
+        f.ReleaseMaps();
+
+        ExpectHResultException(DXGI_ERROR_DEVICE_REMOVED, [&] { result.get(); });
+
+        auto statistics = exporter.GetStatistics();
+        Assert::AreEqual<uint64_t>(0, statistics.BitmapsExported);
+        Assert::AreEqual<uint64_t>(1, statistics.BitmapsFailed);
+    }
+
+    TEST_METHOD_EX(BitmapBatchExporter_GetStatistics_CountsExportedBitmapsAndPixels)
+    {
+        Fixture f;
+        BitmapBatchExporter exporter;
+
+        for (int i = 0; i < 5; i++)
+        {
+            exporter.Export(f.Bitmap.Get(), CreateMemoryStream().Get(), CanvasBitmapFileFormat::Bmp);
+        }
+
+        exporter.WaitForAll();
+
+        auto statistics = exporter.GetStatistics();
+
+        Assert::AreEqual<uint64_t>(5, statistics.BitmapsExported);
+        Assert::AreEqual<uint64_t>(0, statistics.BitmapsFailed);
+        Assert::AreEqual<uint64_t>(5 * ExportStagingD2DBitmap::Size * ExportStagingD2DBitmap::Size, statistics.PixelsExported);
+        Assert::IsTrue(statistics.ElapsedSeconds > 0);
+        Assert::IsTrue(statistics.EncodeSeconds > 0);
+        Assert::IsTrue(statistics.BitmapsPerSecond > 0);
+        Assert::IsTrue(statistics.PixelsPerSecond > 0);
+    }
+
+    TEST_METHOD_EX(BitmapBatchExporter_Export_CallsCompletedFunction)
+    {
+        Fixture f(true);
+        BitmapBatchExporter exporter(WithOneWorker());
+
+        std::promise<std::exception_ptr> goodResult;
+        std::promise<std::exception_ptr> badResult;
+
+        exporter.Export(f.Bitmap.Get(), CreateMemoryStream().Get(), CanvasBitmapFileFormat::Png, 0.9f,
+            [&](std::exception_ptr const& error) { goodResult.set_value(error); });
+
+        exporter.Export(f.Bitmap.Get(), CreateMemoryStream().Get(), CanvasBitmapFileFormat::Png, 0.9f,
+            [&](std::exception_ptr const& error) { badResult.set_value(error); });
+
+        f.StagingBitmaps[1]->MapResult = DXGI_ERROR_DEVICE_REMOVED;
+        f.ReleaseMaps();
+
+        Assert::IsFalse(static_cast<bool>(goodResult.get_future().get()));
+
+        auto error = badResult.get_future().get();
+        ExpectHResultException(DXGI_ERROR_DEVICE_REMOVED, [&] { std::rethrow_exception(error); });
+    }
+
+    // Blocks until the action completes, and returns how it completed.
+    static AsyncStatus WaitForCompletion(ComPtr<IAsyncAction> const& action)
+    {
+        Wrappers::Event completed(CreateEventEx(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS));
+        AsyncStatus completedStatus = AsyncStatus::Started;
+
+        auto handler = Callback<IAsyncActionCompletedHandler>(
+            [&](IAsyncAction*, AsyncStatus status)
+            {
+                completedStatus = status;
+                SetEvent(completed.Get());
+                return S_OK;
+            });
+
+        ThrowIfFailed(action->put_Completed(handler.Get()));
+
+        Assert::AreEqual(WAIT_OBJECT_0, WaitForSingleObjectEx(completed.Get(), 5000, false), L"timed out waiting");
+
+        return completedStatus;
+    }
+
+    TEST_METHOD_EX(CanvasBitmapBatchExporterFactory_CreateWithOptions)
+    {
+        auto factory = Make<CanvasBitmapBatchExporterFactory>();
+
+        ComPtr<ICanvasBitmapBatchExporter> exporter;
+
+        Assert::AreEqual(E_INVALIDARG, factory->CreateWithOptions(-1, 0, &exporter));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateWithOptions(0, -1, &exporter));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateWithOptions(0, 0, nullptr));
+
+        ThrowIfFailed(factory->CreateWithOptions(1, 3, &exporter));
+        Assert::IsNotNull(exporter.Get());
+
+        ComPtr<IInspectable> inspectable;
+        ThrowIfFailed(factory->ActivateInstance(&inspectable));
+        Assert::IsNotNull(As<ICanvasBitmapBatchExporter>(inspectable).Get());
+    }
+
+    TEST_METHOD_EX(CanvasBitmapBatchExporter_SaveAsync_InvalidArgs)
+    {
+        Fixture f;
+        auto exporter = Make<CanvasBitmapBatchExporter>(WithOneWorker());
+
+        ComPtr<IAsyncAction> action;
+
+        Assert::AreEqual(E_INVALIDARG, exporter->SaveToFileAsync(nullptr, WinString(L"tile.png"), &action));
+        Assert::AreEqual(E_INVALIDARG, exporter->SaveToFileAsync(f.Bitmap.Get(), WinString(L"tile.png"), nullptr));
+        Assert::AreEqual(E_INVALIDARG, exporter->SaveToFileWithBitmapFileFormatAndQualityAsync(f.Bitmap.Get(), WinString(L"tile.png"), CanvasBitmapFileFormat::Png, 2.0f, &action));
+        Assert::AreEqual(E_INVALIDARG, exporter->SaveToStreamAsync(f.Bitmap.Get(), nullptr, CanvasBitmapFileFormat::Png, &action));
+
+        Assert::AreEqual<size_t>(0, f.StagingBitmaps.size());
+    }
+
+    TEST_METHOD_EX(CanvasBitmapBatchExporter_SaveAsync_ReportsErrorThroughAction)
+    {
+        Fixture f(true);
+        auto exporter = Make<CanvasBitmapBatchExporter>(WithOneWorker());
+
+        ComPtr<IAsyncAction> action;
+        ThrowIfFailed(exporter->SaveToFileAsync(f.Bitmap.Get(), WinString(L"tile.png"), &action));
+
+        f.StagingBitmaps[0]->MapResult = DXGI_ERROR_DEVICE_REMOVED;
+        f.ReleaseMaps();
+
+        Assert::AreEqual(AsyncStatus::Error, WaitForCompletion(action));
+
+        HRESULT errorCode;
+        ThrowIfFailed(As<IAsyncInfo>(action)->get_ErrorCode(&errorCode));
+        Assert::AreEqual(DXGI_ERROR_DEVICE_REMOVED, errorCode);
+
+        CanvasBitmapBatchExporterStatistics statistics;
+        ThrowIfFailed(exporter->get_Statistics(&statistics));
+        Assert::AreEqual<uint64_t>(0, statistics.BitmapsExported);
+        Assert::AreEqual<uint64_t>(1, statistics.BitmapsFailed);
+    }
+
+    TEST_METHOD_EX(CanvasBitmapBatchExporter_Closed)
+    {
+        Fixture f;
+        auto exporter = Make<CanvasBitmapBatchExporter>(WithOneWorker());
+
+        ThrowIfFailed(exporter->Close());
+        ThrowIfFailed(exporter->Close());
+
+        ComPtr<IAsyncAction> action;
+        CanvasBitmapBatchExporterStatistics statistics;
+
+        Assert::AreEqual(RO_E_CLOSED, exporter->SaveToFileAsync(f.Bitmap.Get(), WinString(L"tile.png"), &action));
+        Assert::AreEqual(RO_E_CLOSED, exporter->get_Statistics(&statistics));
+    }
+};
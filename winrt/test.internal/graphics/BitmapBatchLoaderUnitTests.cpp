@@ -0,0 +1,681 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/images/BitmapBatchLoader.h>
+
+//
+// Bitmap adapter that reports the name of each file as it is decoded.
+//
+class NotifyingBitmapAdapter : public TestBitmapAdapter
+{
+public:
+    std::function<void(std::wstring const&)> OnDecode;
+
+    NotifyingBitmapAdapter()
+        : TestBitmapAdapter(Make<MockWICFormatConverter>())
+    {
+    }
+
+    virtual WicBitmapSource CreateWicBitmapSource(ICanvasDevice* device, HSTRING fileName, bool tryEnableIndexing) override
+    {
+        if (OnDecode)
+            OnDecode(WindowsGetStringRawBuffer(fileName, nullptr));
+
+        return TestBitmapAdapter::CreateWicBitmapSource(device, fileName, tryEnableIndexing);
+    }
+};
+
+
+TEST_CLASS(BitmapBatchLoaderUnitTests)
+{
+    struct Fixture
+    {
+        std::shared_ptr<NotifyingBitmapAdapter> Adapter;
+        ComPtr<StubCanvasDevice> Device;
+
+        // Records "decode <name>" and "upload" events, in the order they happen.
+        std::mutex LogMutex;
+        std::vector<std::wstring> Log;
+
+        // When set, the first decode waits here until ReleaseFirstDecode is
+        // called, so that other requests queue up behind it.
+        bool HoldFirstDecode;
+        bool IsFirstDecode;
+        std::promise<void> FirstDecodeStarted;
+        std::promise<void> FirstDecodeReleased;
+        std::shared_future<void> FirstDecodeReleasedFuture;
+
+        std::function<void(std::wstring const&)> OnDecode;
+
+        Fixture(bool holdFirstDecode = false)
+            : Adapter(std::make_shared<NotifyingBitmapAdapter>())
+            , Device(Make<StubCanvasDevice>())
+            , HoldFirstDecode(holdFirstDecode)
+            , IsFirstDecode(true)
+            , FirstDecodeReleasedFuture(FirstDecodeReleased.get_future().share())
+        {
+            CanvasBitmapAdapter::SetInstance(Adapter);
+
+            Adapter->OnDecode =
+                [=](std::wstring const& fileName)
+                {
+                    Record(L"decode " + fileName);
+
+                    if (OnDecode)
+                        OnDecode(fileName);
+
+                    if (HoldFirstDecode && IsFirstDecode)
+                    {
+                        IsFirstDecode = false;
+                        FirstDecodeStarted.set_value();
+                        FirstDecodeReleasedFuture.wait();
+                    }
+                };
+
+            Device->MockCreateBitmapFromWicResource =
+                [=](IWICBitmapSource*, CanvasAlphaMode, float dpi) -> ComPtr<ID2D1Bitmap1>
+                {
+                    Record(L"upload");
+                    return Make<StubD2DBitmap>(D2D1_BITMAP_OPTIONS_NONE, dpi);
+                };
+        }
+
+        void Record(std::wstring const& event)
+        {
+            Lock lock(LogMutex);
+            Log.push_back(event);
+        }
+
+        std::vector<std::wstring> GetLog()
+        {
+            Lock lock(LogMutex);
+            return Log;
+        }
+
+        std::vector<std::wstring> GetDecodedFileNames()
+        {
+            std::vector<std::wstring> fileNames;
+
+            for (auto& event : GetLog())
+            {
+                if (event.compare(0, 7, L"decode ") == 0)
+                    fileNames.push_back(event.substr(7));
+            }
+
+            return fileNames;
+        }
+
+        void WaitForFirstDecode()
+        {
+            FirstDecodeStarted.get_future().wait();
+        }
+
+        void ReleaseFirstDecode()
+        {
+            FirstDecodeReleased.set_value();
+        }
+    };
+
+    static BitmapBatchLoader::Options WithOneWorker(uint32_t uploadBatchSize = 16)
+    {
+        BitmapBatchLoader::Options options;
+        options.MaximumConcurrency = 1;
+        options.UploadBatchSize = uploadBatchSize;
+        return options;
+    }
+
+    static void AssertOrder(std::vector<std::wstring> const& expected, std::vector<std::wstring> const& actual)
+    {
+        Assert::AreEqual(expected.size(), actual.size());
+
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            Assert::AreEqual(expected[i].c_str(), actual[i].c_str());
+        }
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_Construction_ValidatesArguments)
+    {
+        Fixture f;
+
+        ExpectHResultException(E_INVALIDARG, [] { BitmapBatchLoader loader(nullptr); });
+
+        auto options = WithOneWorker(0);
+        ExpectHResultException(E_INVALIDARG, [&] { BitmapBatchLoader loader(f.Device.Get(), options); });
+
+        BitmapBatchLoader::Options defaultOptions;
+        BitmapBatchLoader loader(f.Device.Get(), defaultOptions);
+
+        Assert::AreEqual(std::max(std::thread::hardware_concurrency(), 1U), loader.GetWorkerCount());
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_Load_DecodesAndUploadsEveryRequest)
+    {
+        Fixture f;
+
+        BitmapBatchLoader::Options options;
+        options.MaximumConcurrency = 4;
+        options.UploadBatchSize = 3;
+        options.Dpi = 123;
+
+        BitmapBatchLoader loader(f.Device.Get(), options);
+
+        std::vector<std::future<ComPtr<CanvasBitmap>>> results;
+
+        for (int i = 0; i < 50; i++)
+        {
+            results.push_back(loader.Load(WinString(std::to_wstring(i).c_str()), i % 3));
+        }
+
+        for (auto& result : results)
+        {
+            auto bitmap = result.get();
+            Assert::IsNotNull(bitmap.Get());
+
+            float dpi;
+            ThrowIfFailed(bitmap->get_Dpi(&dpi));
+            Assert::AreEqual(123.0f, dpi);
+        }
+
+        auto log = f.GetLog();
+        Assert::AreEqual<size_t>(50, f.GetDecodedFileNames().size());
+        Assert::AreEqual<size_t>(50, std::count(log.begin(), log.end(), L"upload"));
+        Assert::AreEqual(0u, loader.GetQueuedCount());
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_Load_DecodesHighestPriorityFirst)
+    {
+        Fixture f(true);
+        BitmapBatchLoader loader(f.Device.Get(), WithOneWorker());
+
+        auto first = loader.Load(WinString(L"first"));
+        f.WaitForFirstDecode();
+
+        auto a = loader.Load(WinString(L"a"), 1);
+        auto b = loader.Load(WinString(L"b"), 5);
+        auto c = loader.Load(WinString(L"c"), 3);
+        auto d = loader.Load(WinString(L"d"), 5);
+
+        Assert::AreEqual(4u, loader.GetQueuedCount());
+
+        f.ReleaseFirstDecode();
+
+        first.get(); a.get(); b.get(); c.get(); d.get();
+
+        // Equal priorities are decoded in the order they were requested.
+        AssertOrder({ L"first", L"b", L"d", L"c", L"a" }, f.GetDecodedFileNames());
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_SetPriority_MovesQueuedRequest)
+    {
+        Fixture f(true);
+        BitmapBatchLoader loader(f.Device.Get(), WithOneWorker());
+
+        BitmapBatchLoader::RequestId firstId, aId, bId, cId;
+
+        auto first = loader.Load(WinString(L"first"), 0, &firstId);
+        f.WaitForFirstDecode();
+
+        auto a = loader.Load(WinString(L"a"), 0, &aId);
+        auto b = loader.Load(WinString(L"b"), 0, &bId);
+        auto c = loader.Load(WinString(L"c"), 0, &cId);
+
+        Assert::IsTrue(loader.SetPriority(cId, 10));
+        Assert::IsTrue(loader.SetPriority(aId, -1));
+
+        // Already decoding.
+        Assert::IsFalse(loader.SetPriority(firstId, 10));
+
+        f.ReleaseFirstDecode();
+
+        first.get(); a.get(); b.get(); c.get();
+
+        AssertOrder({ L"first", L"c", L"b", L"a" }, f.GetDecodedFileNames());
+
+        // Finished.
+        Assert::IsFalse(loader.SetPriority(cId, 10));
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_Reprioritize_ReordersQueue)
+    {
+        Fixture f(true);
+        BitmapBatchLoader loader(f.Device.Get(), WithOneWorker());
+
+        BitmapBatchLoader::RequestId ids[4];
+        std::vector<std::future<ComPtr<CanvasBitmap>>> results;
+
+        results.push_back(loader.Load(WinString(L"first")));
+        f.WaitForFirstDecode();
+
+        results.push_back(loader.Load(WinString(L"a"), 7, &ids[0]));
+        results.push_back(loader.Load(WinString(L"b"), 7, &ids[1]));
+        results.push_back(loader.Load(WinString(L"c"), 7, &ids[2]));
+        results.push_back(loader.Load(WinString(L"d"), 7, &ids[3]));
+
+        // As if only b and d were still visible.
+        int callCount = 0;
+
+        loader.Reprioritize(
+            [&](BitmapBatchLoader::RequestId id, int32_t priority)
+            {
+                callCount++;
+                Assert::AreEqual(7, priority);
+                return (id == ids[1] || id == ids[3]) ? 1 : 0;
+            });
+
+        Assert::AreEqual(4, callCount);
+
+        f.ReleaseFirstDecode();
+
+        for (auto& result : results)
+        {
+            result.get();
+        }
+
+        AssertOrder({ L"first", L"b", L"d", L"a", L"c" }, f.GetDecodedFileNames());
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_Reprioritize_WhenGetPriorityThrows_LeavesQueueUnchanged)
+    {
+        Fixture f(true);
+        BitmapBatchLoader loader(f.Device.Get(), WithOneWorker());
+
+        BitmapBatchLoader::RequestId ids[3];
+        std::vector<std::future<ComPtr<CanvasBitmap>>> results;
+
+        results.push_back(loader.Load(WinString(L"first")));
+        f.WaitForFirstDecode();
+
+        results.push_back(loader.Load(WinString(L"a"), 3, &ids[0]));
+        results.push_back(loader.Load(WinString(L"b"), 2, &ids[1]));
+        results.push_back(loader.Load(WinString(L"c"), 1, &ids[2]));
+
+        int callCount = 0;
+
+        ExpectHResultException(E_FAIL,
+            [&]
+            {
+                loader.Reprioritize(
+                    [&](BitmapBatchLoader::RequestId, int32_t)
+                    {
+                        if (++callCount == 2)
+                            ThrowHR(E_FAIL);
+
+                        return 10 - callCount;
+                    });
+            });
+
+        // Every request is still queued at its old priority.
+        Assert::IsTrue(loader.SetPriority(ids[0], 3));
+        Assert::IsTrue(loader.Cancel(ids[1]));
+        ExpectHResultException(E_ABORT, [&] { results[2].get(); });
+
+        f.ReleaseFirstDecode();
+
+        results[0].get();
+        results[1].get();
+        results[3].get();
+
+        AssertOrder({ L"first", L"a", L"c" }, f.GetDecodedFileNames());
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_Cancel_QueuedRequest_IsNeverDecoded)
+    {
+        Fixture f(true);
+        BitmapBatchLoader loader(f.Device.Get(), WithOneWorker());
+
+        BitmapBatchLoader::RequestId aId;
+
+        auto first = loader.Load(WinString(L"first"));
+        f.WaitForFirstDecode();
+
+        auto a = loader.Load(WinString(L"a"), 0, &aId);
+        auto b = loader.Load(WinString(L"b"));
+
+        Assert::IsTrue(loader.Cancel(aId));
+        Assert::IsFalse(loader.Cancel(aId));
+
+        ExpectHResultException(E_ABORT, [&] { a.get(); });
+
+        f.ReleaseFirstDecode();
+
+        first.get();
+        b.get();
+
+        AssertOrder({ L"first", L"b" }, f.GetDecodedFileNames());
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_Cancel_WhileDecoding_IsNotUploaded)
+    {
+        Fixture f(true);
+        BitmapBatchLoader loader(f.Device.Get(), WithOneWorker());
+
+        BitmapBatchLoader::RequestId firstId;
+
+        auto first = loader.Load(WinString(L"first"), 0, &firstId);
+        f.WaitForFirstDecode();
+
+        Assert::IsTrue(loader.Cancel(firstId));
+
+        f.ReleaseFirstDecode();
+
+        ExpectHResultException(E_ABORT, [&] { first.get(); });
+
+        auto log = f.GetLog();
+        Assert::AreEqual<size_t>(0, std::count(log.begin(), log.end(), L"upload"));
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_CancelAll_AbortsEverythingNotYetUploaded)
+    {
+        Fixture f(true);
+        BitmapBatchLoader loader(f.Device.Get(), WithOneWorker());
+
+        std::vector<std::future<ComPtr<CanvasBitmap>>> results;
+
+        results.push_back(loader.Load(WinString(L"first")));
+        f.WaitForFirstDecode();
+
+        for (int i = 0; i < 10; i++)
+        {
+            results.push_back(loader.Load(WinString(L"queued")));
+        }
+
+        loader.CancelAll();
+
+        Assert::AreEqual(0u, loader.GetQueuedCount());
+
+        f.ReleaseFirstDecode();
+
+        for (auto& result : results)
+        {
+            ExpectHResultException(E_ABORT, [&] { result.get(); });
+        }
+
+        // The loader is still usable afterwards.
+        Assert::IsNotNull(loader.Load(WinString(L"after")).get().Get());
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_DecodeError_IsReportedThroughFuture)
+    {
+        Fixture f;
+
+        f.OnDecode =
+            [](std::wstring const& fileName)
+            {
+                if (fileName == L"bad")
+                    ThrowHR(WINCODEC_ERR_COMPONENTNOTFOUND);
+            };
+
+        BitmapBatchLoader loader(f.Device.Get(), WithOneWorker());
+
+        auto good = loader.Load(WinString(L"good"));
+        auto bad = loader.Load(WinString(L"bad"));
+
+        Assert::IsNotNull(good.get().Get());
+        ExpectHResultException(WINCODEC_ERR_COMPONENTNOTFOUND, [&] { bad.get(); });
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_DecodedImages_AreUploadedInBatches)
+    {
+        Fixture f(true);
+        BitmapBatchLoader loader(f.Device.Get(), WithOneWorker(3));
+
+        std::vector<std::future<ComPtr<CanvasBitmap>>> results;
+
+        results.push_back(loader.Load(WinString(L"0")));
+        f.WaitForFirstDecode();
+
+        for (int i = 1; i < 7; i++)
+        {
+            results.push_back(loader.Load(WinString(std::to_wstring(i).c_str())));
+        }
+
+        f.ReleaseFirstDecode();
+
+        for (auto& result : results)
+        {
+            result.get();
+        }
+
+        // The last, partial, batch is uploaded as soon as nothing else is queued.
+        AssertOrder(
+            {
+                L"decode 0", L"decode 1", L"decode 2", L"upload", L"upload", L"upload",
+                L"decode 3", L"decode 4", L"decode 5", L"upload", L"upload", L"upload",
+                L"decode 6", L"upload",
+            },
+            f.GetLog());
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_Destruction_AbortsOutstandingRequests)
+    {
+        Fixture f(true);
+
+        std::vector<std::future<ComPtr<CanvasBitmap>>> results;
+
+        {
+            BitmapBatchLoader loader(f.Device.Get(), WithOneWorker());
+
+            results.push_back(loader.Load(WinString(L"first")));
+            f.WaitForFirstDecode();
+
+            for (int i = 0; i < 10; i++)
+            {
+                results.push_back(loader.Load(WinString(L"queued")));
+            }
+
+            f.ReleaseFirstDecode();
+        }
+
+        // Every request has finished, one way or another, rather than being
+        // left with a broken promise.
+        for (auto& result : results)
+        {
+            Assert::IsTrue(result.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+
+            try
+            {
+                Assert::IsNotNull(result.get().Get());
+            }
+            catch (HResultException const& e)
+            {
+                Assert::AreEqual(E_ABORT, e.GetHr());
+            }
+        }
+    }
+
+    TEST_METHOD_EX(BitmapBatchLoader_Load_CallsCompletedFunction)
+    {
+        Fixture f;
+
+        f.OnDecode =
+            [](std::wstring const& fileName)
+            {
+                if (fileName == L"bad")
+                    ThrowHR(WINCODEC_ERR_COMPONENTNOTFOUND);
+            };
+
+        std::promise<ComPtr<CanvasBitmap>> goodResult;
+        std::promise<std::exception_ptr> badResult;
+
+        BitmapBatchLoader loader(f.Device.Get(), WithOneWorker());
+
+        loader.Load(WinString(L"good"), 0, nullptr,
+            [&](ComPtr<CanvasBitmap> const& bitmap, std::exception_ptr const&) { goodResult.set_value(bitmap); });
+
+        loader.Load(WinString(L"bad"), 0, nullptr,
+            [&](ComPtr<CanvasBitmap> const&, std::exception_ptr const& error) { badResult.set_value(error); });
+
+        Assert::IsNotNull(goodResult.get_future().get().Get());
+
+        auto error = badResult.get_future().get();
+        ExpectHResultException(WINCODEC_ERR_COMPONENTNOTFOUND, [&] { std::rethrow_exception(error); });
+    }
+
+    // Blocks until the operation completes, and returns how it completed.
+    static AsyncStatus WaitForCompletion(ComPtr<IAsyncOperation<CanvasBitmap*>> const& operation)
+    {
+        Wrappers::Event completed(CreateEventEx(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS));
+        AsyncStatus completedStatus = AsyncStatus::Started;
+
+        auto handler = Callback<IAsyncOperationCompletedHandler<CanvasBitmap*>>(
+            [&](IAsyncOperation<CanvasBitmap*>*, AsyncStatus status)
+            {
+                completedStatus = status;
+                SetEvent(completed.Get());
+                return S_OK;
+            });
+
+        ThrowIfFailed(operation->put_Completed(handler.Get()));
+
+        Assert::AreEqual(WAIT_OBJECT_0, WaitForSingleObjectEx(completed.Get(), 5000, false), L"timed out waiting");
+
+        return completedStatus;
+    }
+
+    static ComPtr<IAsyncOperation<CanvasBitmap*>> LoadAsync(ComPtr<CanvasBitmapBatchLoader> const& loader, wchar_t const* fileName, int32_t priority = 0)
+    {
+        ComPtr<IAsyncOperation<CanvasBitmap*>> operation;
+        ThrowIfFailed(loader->LoadAsyncFromHstring(WinString(fileName), priority, &operation));
+        return operation;
+    }
+
+    TEST_METHOD_EX(CanvasBitmapBatchLoaderFactory_CreateWithOptions)
+    {
+        Fixture f;
+        auto factory = Make<CanvasBitmapBatchLoaderFactory>();
+
+        ComPtr<ICanvasBitmapBatchLoader> loader;
+
+        Assert::AreEqual(E_INVALIDARG, factory->Create(nullptr, &loader));
+        Assert::AreEqual(E_INVALIDARG, factory->Create(f.Device.Get(), nullptr));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateWithOptions(f.Device.Get(), -1, DEFAULT_DPI, CanvasAlphaMode::Premultiplied, &loader));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateWithOptions(f.Device.Get(), 1, 0, CanvasAlphaMode::Premultiplied, &loader));
+
+        ThrowIfFailed(factory->CreateWithOptions(f.Device.Get(), 1, 150, CanvasAlphaMode::Premultiplied, &loader));
+
+        ComPtr<IAsyncOperation<CanvasBitmap*>> operation;
+        ThrowIfFailed(loader->LoadAsyncFromHstring(WinString(L"a"), 0, &operation));
+
+        Assert::AreEqual(AsyncStatus::Completed, WaitForCompletion(operation));
+
+        ComPtr<ICanvasBitmap> bitmap;
+        ThrowIfFailed(operation->GetResults(&bitmap));
+
+        float dpi;
+        ThrowIfFailed(As<ICanvasResourceCreatorWithDpi>(bitmap)->get_Dpi(&dpi));
+        Assert::AreEqual(150.0f, dpi);
+    }
+
+    TEST_METHOD_EX(CanvasBitmapBatchLoader_LoadAsync_InvalidArgs)
+    {
+        Fixture f;
+        auto loader = Make<CanvasBitmapBatchLoader>(f.Device.Get(), WithOneWorker());
+
+        ComPtr<IAsyncOperation<CanvasBitmap*>> operation;
+
+        Assert::AreEqual(E_INVALIDARG, loader->LoadAsyncFromHstring(nullptr, 0, &operation));
+        Assert::AreEqual(E_INVALIDARG, loader->LoadAsyncFromHstring(WinString(L"a"), 0, nullptr));
+        Assert::AreEqual(E_INVALIDARG, loader->LoadAsyncFromUri(nullptr, 0, &operation));
+        Assert::AreEqual(E_INVALIDARG, loader->LoadAsyncFromStream(nullptr, 0, &operation));
+    }
+
+    TEST_METHOD_EX(CanvasBitmapBatchLoader_CancelledOperation_IsNeverDecoded)
+    {
+        Fixture f(true);
+        auto loader = Make<CanvasBitmapBatchLoader>(f.Device.Get(), WithOneWorker());
+
+        auto first = LoadAsync(loader, L"first");
+        f.WaitForFirstDecode();
+
+        auto a = LoadAsync(loader, L"a");
+        auto b = LoadAsync(loader, L"b");
+
+        ThrowIfFailed(As<IAsyncInfo>(a)->Cancel());
+
+        int32_t queuedCount;
+        ThrowIfFailed(loader->get_QueuedCount(&queuedCount));
+        Assert::AreEqual(1, queuedCount);
+
+        f.ReleaseFirstDecode();
+
+        Assert::AreEqual(AsyncStatus::Completed, WaitForCompletion(first));
+        Assert::AreEqual(AsyncStatus::Canceled, WaitForCompletion(a));
+        Assert::AreEqual(AsyncStatus::Completed, WaitForCompletion(b));
+
+        AssertOrder({ L"first", L"b" }, f.GetDecodedFileNames());
+    }
+
+    TEST_METHOD_EX(CanvasBitmapBatchLoader_SetPriority_MovesQueuedRequest)
+    {
+        Fixture f(true);
+        auto loader = Make<CanvasBitmapBatchLoader>(f.Device.Get(), WithOneWorker());
+        auto otherLoader = Make<CanvasBitmapBatchLoader>(f.Device.Get(), WithOneWorker());
+
+        auto first = LoadAsync(loader, L"first");
+        f.WaitForFirstDecode();
+
+        auto a = LoadAsync(loader, L"a");
+        auto b = LoadAsync(loader, L"b");
+
+        boolean succeeded;
+
+        ThrowIfFailed(loader->SetPriority(b.Get(), 10, &succeeded));
+        Assert::IsTrue(!!succeeded);
+
+        // Already decoding.
+        ThrowIfFailed(loader->SetPriority(first.Get(), 10, &succeeded));
+        Assert::IsFalse(!!succeeded);
+
+        Assert::AreEqual(E_INVALIDARG, loader->SetPriority(nullptr, 10, &succeeded));
+        Assert::AreEqual(E_INVALIDARG, loader->SetPriority(a.Get(), 10, nullptr));
+        Assert::AreEqual(E_INVALIDARG, otherLoader->SetPriority(a.Get(), 10, &succeeded));
+
+        f.ReleaseFirstDecode();
+
+        WaitForCompletion(first);
+        WaitForCompletion(a);
+        WaitForCompletion(b);
+
+        AssertOrder({ L"first", L"b", L"a" }, f.GetDecodedFileNames());
+    }
+
+    TEST_METHOD_EX(CanvasBitmapBatchLoader_Closed)
+    {
+        Fixture f(true);
+        auto loader = Make<CanvasBitmapBatchLoader>(f.Device.Get(), WithOneWorker());
+
+        auto first = LoadAsync(loader, L"first");
+        f.WaitForFirstDecode();
+
+        auto a = LoadAsync(loader, L"a");
+
+        f.ReleaseFirstDecode();
+
+        ThrowIfFailed(loader->Close());
+        ThrowIfFailed(loader->Close());
+
+        // Closing finishes every outstanding request, one way or another.
+        for (auto& operation : { first, a })
+        {
+            AsyncStatus status;
+            ThrowIfFailed(As<IAsyncInfo>(operation)->get_Status(&status));
+            Assert::AreNotEqual(AsyncStatus::Started, status);
+        }
+
+        ComPtr<IAsyncOperation<CanvasBitmap*>> operation;
+        boolean succeeded;
+        int32_t queuedCount;
+
+        Assert::AreEqual(RO_E_CLOSED, loader->LoadAsyncFromHstring(WinString(L"b"), 0, &operation));
+        Assert::AreEqual(RO_E_CLOSED, loader->SetPriority(a.Get(), 10, &succeeded));
+        Assert::AreEqual(RO_E_CLOSED, loader->CancelAll());
+        Assert::AreEqual(RO_E_CLOSED, loader->get_QueuedCount(&queuedCount));
+
+        // Cancelling after the loader has gone does nothing.
+        ThrowIfFailed(As<IAsyncInfo>(a)->Cancel());
+    }
+};
@@ -0,0 +1,262 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "stubs/StubBuffer.h"
+
+class UploadableD2DBitmap : public StubD2DBitmap
+{
+public:
+    CALL_COUNTER_WITH_MOCK(CopyFromMemoryMethod, HRESULT(D2D1_RECT_U const*, void const*, UINT32));
+
+    UploadableD2DBitmap(int32_t width, int32_t height, DirectXPixelFormat format, D2D1_BITMAP_OPTIONS options = D2D1_BITMAP_OPTIONS_NONE, float dpi = DEFAULT_DPI)
+        : StubD2DBitmap(options, dpi)
+    {
+        GetPixelSizeMethod.AllowAnyCall(
+            [=] { return D2D1_SIZE_U{ static_cast<uint32_t>(width), static_cast<uint32_t>(height) }; });
+
+        GetPixelFormatMethod.AllowAnyCall(
+            [=] { return D2D1::PixelFormat(static_cast<DXGI_FORMAT>(format), D2D1_ALPHA_MODE_PREMULTIPLIED); });
+    }
+
+    STDMETHOD(CopyFromMemory)(D2D1_RECT_U const* destinationRect, void const* sourceData, UINT32 pitch) override
+    {
+        return CopyFromMemoryMethod.WasCalled(destinationRect, sourceData, pitch);
+    }
+};
+
+
+TEST_CLASS(CanvasBitmapFromMemoryUnitTests)
+{
+    struct Fixture
+    {
+        ComPtr<StubCanvasDevice> Device;
+
+        Fixture()
+            : Device(Make<StubCanvasDevice>())
+        {
+        }
+
+        void ExpectCreateBitmapFromBytes(uint8_t const* expectedBytes, uint32_t expectedPitch)
+        {
+            Device->CreateBitmapFromBytesMethod.SetExpectedCalls(1,
+                [=](uint8_t* bytes, uint32_t pitch, int32_t width, int32_t height, float dpi, DirectXPixelFormat format, CanvasAlphaMode)
+                {
+                    Assert::IsTrue(bytes == expectedBytes);
+                    Assert::AreEqual(expectedPitch, pitch);
+
+                    return Make<UploadableD2DBitmap>(width, height, format, D2D1_BITMAP_OPTIONS_NONE, dpi);
+                });
+        }
+
+        ComPtr<ICanvasBitmap> MakeBitmap(int32_t width, int32_t height, DirectXPixelFormat format = PIXEL_FORMAT(B8G8R8A8UIntNormalized))
+        {
+            auto d2dBitmap = Make<UploadableD2DBitmap>(width, height, format);
+            return Make<CanvasBitmap>(Device.Get(), d2dBitmap.Get());
+        }
+    };
+
+    TEST_METHOD_EX(CanvasBitmap_CreateFromMemory_PassesCallersBytesAndStrideStraightThrough)
+    {
+        Fixture f;
+
+        uint32_t const stride = 48;
+        std::vector<uint8_t> bytes(stride * 3 + 8 * 4);
+
+        f.ExpectCreateBitmapFromBytes(bytes.data(), stride);
+
+        auto bitmap = CanvasBitmap::CreateFromMemory(f.Device.Get(), static_cast<uint32_t>(bytes.size()), bytes.data(), stride, 8, 4, DEFAULT_DPI, PIXEL_FORMAT(B8G8R8A8UIntNormalized), CanvasAlphaMode::Premultiplied);
+
+        Assert::IsNotNull(bitmap.Get());
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_CreateFromMemory_LastRowNeedNotBePadded)
+    {
+        Fixture f;
+
+        // Three padded rows plus one tightly packed one.
+        uint32_t const stride = 48;
+        std::vector<uint8_t> bytes(stride * 3 + 8 * 4);
+
+        ExpectHResultException(E_INVALIDARG,
+            [&] { CanvasBitmap::CreateFromMemory(f.Device.Get(), static_cast<uint32_t>(bytes.size() - 1), bytes.data(), stride, 8, 4, DEFAULT_DPI, PIXEL_FORMAT(B8G8R8A8UIntNormalized), CanvasAlphaMode::Premultiplied); });
+
+        f.ExpectCreateBitmapFromBytes(bytes.data(), stride);
+
+        CanvasBitmap::CreateFromMemory(f.Device.Get(), static_cast<uint32_t>(bytes.size()), bytes.data(), stride, 8, 4, DEFAULT_DPI, PIXEL_FORMAT(B8G8R8A8UIntNormalized), CanvasAlphaMode::Premultiplied);
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_CreateFromMemory_RejectsInvalidArguments)
+    {
+        Fixture f;
+
+        std::vector<uint8_t> bytes(1024);
+        auto size = static_cast<uint32_t>(bytes.size());
+
+        // Stride shorter than a row.
+        ExpectHResultException(E_INVALIDARG,
+            [&] { CanvasBitmap::CreateFromMemory(f.Device.Get(), size, bytes.data(), 31, 8, 4, DEFAULT_DPI, PIXEL_FORMAT(B8G8R8A8UIntNormalized), CanvasAlphaMode::Premultiplied); });
+
+        // Negative size.
+        ExpectHResultException(E_INVALIDARG,
+            [&] { CanvasBitmap::CreateFromMemory(f.Device.Get(), size, bytes.data(), 32, -8, 4, DEFAULT_DPI, PIXEL_FORMAT(B8G8R8A8UIntNormalized), CanvasAlphaMode::Premultiplied); });
+
+        // Block compressed size that isn't a multiple of 4.
+        ExpectHResultException(E_INVALIDARG,
+            [&] { CanvasBitmap::CreateFromMemory(f.Device.Get(), size, bytes.data(), 64, 6, 4, DEFAULT_DPI, PIXEL_FORMAT(BC1UIntNormalized), CanvasAlphaMode::Premultiplied); });
+
+        // Null bytes.
+        ExpectHResultException(E_INVALIDARG,
+            [&] { CanvasBitmap::CreateFromMemory(f.Device.Get(), size, nullptr, 32, 8, 4, DEFAULT_DPI, PIXEL_FORMAT(B8G8R8A8UIntNormalized), CanvasAlphaMode::Premultiplied); });
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_CreateFromMemory_WhenBitmapToReuseMatches_UploadsIntoIt)
+    {
+        Fixture f;
+
+        auto existingBitmap = f.MakeBitmap(8, 4);
+        auto d2dBitmap = static_cast<UploadableD2DBitmap*>(As<ICanvasBitmapInternal>(existingBitmap)->GetD2DBitmap().Get());
+
+        uint32_t const stride = 40;
+        std::vector<uint8_t> bytes(stride * 4);
+
+        f.Device->CreateBitmapFromBytesMethod.SetExpectedCalls(0);
+
+        d2dBitmap->CopyFromMemoryMethod.SetExpectedCalls(1,
+            [&](D2D1_RECT_U const* rect, void const* data, UINT32 pitch)
+            {
+                Assert::IsNull(rect);
+                Assert::IsTrue(data == bytes.data());
+                Assert::AreEqual(stride, pitch);
+                return S_OK;
+            });
+
+        auto bitmap = CanvasBitmap::CreateFromMemory(f.Device.Get(), static_cast<uint32_t>(bytes.size()), bytes.data(), stride, 8, 4, DEFAULT_DPI, PIXEL_FORMAT(B8G8R8A8UIntNormalized), CanvasAlphaMode::Premultiplied, existingBitmap.Get());
+
+        Assert::IsTrue(IsSameInstance(existingBitmap.Get(), bitmap.Get()));
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_CreateFromMemory_WhenBitmapToReuseDoesNotMatch_CreatesNewBitmap)
+    {
+        Fixture f;
+
+        std::vector<uint8_t> bytes(32 * 4);
+        auto size = static_cast<uint32_t>(bytes.size());
+
+        ComPtr<ICanvasBitmap> mismatchedBitmaps[] =
+        {
+            f.MakeBitmap(8, 5),
+            f.MakeBitmap(4, 4),
+            f.MakeBitmap(8, 4, PIXEL_FORMAT(R8G8B8A8UIntNormalized)),
+            Make<CanvasBitmap>(Make<StubCanvasDevice>().Get(), Make<UploadableD2DBitmap>(8, 4, PIXEL_FORMAT(B8G8R8A8UIntNormalized)).Get()),
+            Make<CanvasBitmap>(f.Device.Get(), Make<UploadableD2DBitmap>(8, 4, PIXEL_FORMAT(B8G8R8A8UIntNormalized), D2D1_BITMAP_OPTIONS_NONE, 2 * DEFAULT_DPI).Get()),
+            Make<CanvasBitmap>(f.Device.Get(), Make<UploadableD2DBitmap>(8, 4, PIXEL_FORMAT(B8G8R8A8UIntNormalized), D2D1_BITMAP_OPTIONS_CPU_READ | D2D1_BITMAP_OPTIONS_CANNOT_DRAW).Get()),
+        };
+
+        for (auto& mismatchedBitmap : mismatchedBitmaps)
+        {
+            f.ExpectCreateBitmapFromBytes(bytes.data(), 32);
+
+            auto bitmap = CanvasBitmap::CreateFromMemory(f.Device.Get(), size, bytes.data(), 32, 8, 4, DEFAULT_DPI, PIXEL_FORMAT(B8G8R8A8UIntNormalized), CanvasAlphaMode::Premultiplied, mismatchedBitmap.Get());
+
+            Assert::IsFalse(IsSameInstance(mismatchedBitmap.Get(), bitmap.Get()));
+        }
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_CreateFromMemory_FromBuffer_UsesBufferContents)
+    {
+        Fixture f;
+
+        uint32_t const stride = 64;
+        auto buffer = Make<StubBuffer>(stride * 2 + 32);
+
+        uint8_t* bufferBytes;
+        ThrowIfFailed(buffer->Buffer(&bufferBytes));
+
+        f.ExpectCreateBitmapFromBytes(bufferBytes, stride);
+
+        CanvasBitmap::CreateFromMemory(f.Device.Get(), buffer.Get(), stride, 8, 3, DEFAULT_DPI, PIXEL_FORMAT(B8G8R8A8UIntNormalized), CanvasAlphaMode::Premultiplied);
+
+        // Too small for a fourth row.
+        ExpectHResultException(E_INVALIDARG,
+            [&] { CanvasBitmap::CreateFromMemory(f.Device.Get(), buffer.Get(), stride, 8, 4, DEFAULT_DPI, PIXEL_FORMAT(B8G8R8A8UIntNormalized), CanvasAlphaMode::Premultiplied); });
+    }
+
+    TEST_METHOD_EX(CanvasBitmapFactory_CreateFromBytesWithStride_UsesBufferContents)
+    {
+        Fixture f;
+        auto factory = Make<CanvasBitmapFactory>();
+
+        uint32_t const stride = 64;
+        auto buffer = Make<StubBuffer>(stride * 2 + 32);
+
+        uint8_t* bufferBytes;
+        ThrowIfFailed(buffer->Buffer(&bufferBytes));
+
+        f.ExpectCreateBitmapFromBytes(bufferBytes, stride);
+
+        ComPtr<ICanvasBitmap> bitmap;
+        ThrowIfFailed(factory->CreateFromBytesWithBufferAndStride(f.Device.Get(), buffer.Get(), 8, 3, stride, PIXEL_FORMAT(B8G8R8A8UIntNormalized), DEFAULT_DPI, CanvasAlphaMode::Premultiplied, &bitmap));
+
+        Assert::IsNotNull(bitmap.Get());
+
+        Assert::AreEqual(E_INVALIDARG, factory->CreateFromBytesWithBufferAndStride(nullptr, buffer.Get(), 8, 3, stride, PIXEL_FORMAT(B8G8R8A8UIntNormalized), DEFAULT_DPI, CanvasAlphaMode::Premultiplied, &bitmap));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateFromBytesWithBufferAndStride(f.Device.Get(), nullptr, 8, 3, stride, PIXEL_FORMAT(B8G8R8A8UIntNormalized), DEFAULT_DPI, CanvasAlphaMode::Premultiplied, &bitmap));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateFromBytesWithBufferAndStride(f.Device.Get(), buffer.Get(), 8, 3, stride, PIXEL_FORMAT(B8G8R8A8UIntNormalized), DEFAULT_DPI, CanvasAlphaMode::Premultiplied, nullptr));
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_CreateFromColors_LargeImage_IsUploadedInBands)
+    {
+        Fixture f;
+
+        int32_t const width = 1024;
+        int32_t const height = 1000;
+
+        std::vector<Color> colors(width * height);
+
+        for (int32_t y = 0; y < height; y++)
+        {
+            colors[y * width] = Color{ 0xFF, static_cast<uint8_t>(y), 0, 0 };
+        }
+
+        uint32_t nextRow = 0;
+        int bandCount = 0;
+
+        f.Device->CreateBitmapFromBytesMethod.SetExpectedCalls(1,
+            [&](uint8_t* bytes, uint32_t pitch, int32_t w, int32_t h, float dpi, DirectXPixelFormat format, CanvasAlphaMode)
+            {
+                Assert::IsNull(bytes);
+                Assert::AreEqual<uint32_t>(width * 4, pitch);
+
+                auto d2dBitmap = Make<UploadableD2DBitmap>(w, h, format, D2D1_BITMAP_OPTIONS_NONE, dpi);
+
+                d2dBitmap->CopyFromMemoryMethod.AllowAnyCall(
+                    [&](D2D1_RECT_U const* rect, void const* data, UINT32 pitch)
+                    {
+                        Assert::AreEqual(nextRow, rect->top);
+                        Assert::AreEqual<uint32_t>(width, rect->right);
+                        Assert::AreEqual<uint32_t>(width * 4, pitch);
+
+                        auto bytes = static_cast<uint8_t const*>(data);
+
+                        for (auto y = rect->top; y < rect->bottom; y++)
+                        {
+                            Assert::AreEqual(static_cast<uint8_t>(y), bytes[(y - rect->top) * pitch + 2]);
+                        }
+
+                        nextRow = rect->bottom;
+                        bandCount++;
+                        return S_OK;
+                    });
+
+                return d2dBitmap;
+            });
+
+        CanvasBitmap::CreateNew(f.Device.Get(), static_cast<uint32_t>(colors.size()), colors.data(), width, height, DEFAULT_DPI, CanvasAlphaMode::Premultiplied);
+
+        Assert::AreEqual<uint32_t>(height, nextRow);
+        Assert::IsTrue(bandCount > 1);
+    }
+};
@@ -98,6 +98,21 @@ TEST_CLASS(CanvasBitmapUnitTest)
         Assert::AreEqual(RO_E_CLOSED, canvasBitmap->CopyPixelsFromBitmap(otherBitmap.Get()));
         Assert::AreEqual(RO_E_CLOSED, canvasBitmap->CopyPixelsFromBitmapWithDestPoint(otherBitmap.Get(), 0, 0));
         Assert::AreEqual(RO_E_CLOSED, canvasBitmap->CopyPixelsFromBitmapWithDestPointAndSourceRect(otherBitmap.Get(), 0, 0, 0, 0, 0, 0));
+
+        ComPtr<ABI::Windows::Foundation::IAsyncAction> asyncAction;
+        Assert::AreEqual(RO_E_CLOSED, canvasBitmap->GetPixelBytesAsync(nullptr, &asyncAction));
+        Assert::AreEqual(RO_E_CLOSED, canvasBitmap->GetPixelBytesWithSubrectangleAsync(nullptr, 0, 0, 1, 1, &asyncAction));
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_GetPixelBytesAsync_NullArg)
+    {
+        Fixture f;
+
+        auto canvasBitmap = CanvasBitmap::CreateNew(f.m_canvasDevice.Get(), f.m_testFileName, DEFAULT_DPI, CanvasAlphaMode::Premultiplied);
+
+        ComPtr<ABI::Windows::Foundation::IAsyncAction> asyncAction;
+        Assert::AreEqual(E_INVALIDARG, canvasBitmap->GetPixelBytesAsync(nullptr, &asyncAction));
+        Assert::AreEqual(E_INVALIDARG, canvasBitmap->GetPixelBytesWithSubrectangleAsync(nullptr, 0, 0, 1, 1, &asyncAction));
     }
 
     TEST_METHOD_EX(CanvasBitmap_GetDevice)
@@ -127,6 +127,315 @@ public:
         Assert::IsFalse(!!forceSoftwareRenderer);
     }
 
+    TEST_METHOD_EX(CanvasDevice_DeviceContextPool_PrewarmFailureDoesNotFailCreation)
+    {
+        Fixture f;
+
+        auto d2dDevice = Make<MockD2DDevice>(Make<MockD2DFactory>().Get());
+
+        bool shouldFail = true;
+
+        d2dDevice->MockCreateDeviceContext =
+            [&] (D2D1_DEVICE_CONTEXT_OPTIONS, ID2D1DeviceContext1** deviceContext)
+            {
+                if (shouldFail)
+                    ThrowHR(DXGI_ERROR_DEVICE_REMOVED);
+
+                ThrowIfFailed(Make<MockD2DDeviceContext>().CopyTo(deviceContext));
+            };
+
+        f.SharedDeviceState->SetDeviceContextPoolPrewarmCount(2);
+
+        auto canvasDevice = Make<CanvasDevice>(d2dDevice.Get());
+
+        f.SharedDeviceState->SetDeviceContextPoolPrewarmCount(0);
+
+        Assert::IsNotNull(canvasDevice.Get());
+
+        // Leases still report the error, and work once contexts can be created again.
+        ExpectHResultException(DXGI_ERROR_DEVICE_REMOVED, [&] { canvasDevice->GetResourceCreationDeviceContext(); });
+
+        shouldFail = false;
+
+        auto lease = canvasDevice->GetResourceCreationDeviceContext();
+        Assert::IsNotNull(lease.Get());
+    }
+
+    TEST_METHOD_EX(CanvasDevice_DeviceContextPool_IsPrewarmedOnCreation)
+    {
+        Fixture f;
+
+        auto d2dDevice = Make<MockD2DDevice>(Make<MockD2DFactory>().Get());
+
+        int deviceContextCount = 0;
+
+        d2dDevice->MockCreateDeviceContext =
+            [&] (D2D1_DEVICE_CONTEXT_OPTIONS, ID2D1DeviceContext1** deviceContext)
+            {
+                deviceContextCount++;
+                ThrowIfFailed(Make<MockD2DDeviceContext>().CopyTo(deviceContext));
+            };
+
+        // Not prewarmed by default.
+        Make<CanvasDevice>(d2dDevice.Get());
+        Assert::AreEqual(0, deviceContextCount);
+
+        f.SharedDeviceState->SetDeviceContextPoolPrewarmCount(2);
+
+        auto canvasDevice = Make<CanvasDevice>(d2dDevice.Get());
+
+        f.SharedDeviceState->SetDeviceContextPoolPrewarmCount(0);
+
+        auto expectedCount = std::min(2u, DeviceContextPool::GetDefaultMaximumSize());
+
+        Assert::AreEqual<int>(expectedCount, deviceContextCount);
+
+        {
+            auto lease = canvasDevice->GetResourceCreationDeviceContext();
+        }
+
+        Assert::AreEqual<int>(expectedCount, deviceContextCount);
+
+        auto statistics = canvasDevice->GetDeviceContextPoolStatistics();
+
+        Assert::AreEqual<uint64_t>(1, statistics.LeasesTaken);
+        Assert::AreEqual<uint64_t>(expectedCount, statistics.DeviceContextsCreated);
+        Assert::AreEqual<uint64_t>(0, statistics.DeviceContextsDiscarded);
+    }
+
+    TEST_METHOD_EX(CanvasDevice_DeviceContextPoolSize_AppliesToNewDevices)
+    {
+        Fixture f;
+
+        auto factory = Make<CanvasDeviceFactory>();
+
+        uint32_t poolSize;
+        ThrowIfFailed(factory->get_DeviceContextPoolSize(&poolSize));
+        Assert::AreEqual(DeviceContextPool::GetDefaultMaximumSize(), poolSize);
+
+        Assert::AreEqual(E_INVALIDARG, factory->get_DeviceContextPoolSize(nullptr));
+        Assert::AreEqual(E_INVALIDARG, factory->put_DeviceContextPoolSize(DeviceContextPool::MaximumSizeLimit + 1));
+
+        auto d2dDevice = Make<MockD2DDevice>(Make<MockD2DFactory>().Get());
+
+        d2dDevice->MockCreateDeviceContext =
+            [&] (D2D1_DEVICE_CONTEXT_OPTIONS, ID2D1DeviceContext1** deviceContext)
+            {
+                ThrowIfFailed(Make<MockD2DDeviceContext>().CopyTo(deviceContext));
+            };
+
+        auto existingDevice = Make<CanvasDevice>(d2dDevice.Get());
+
+        auto defaultPoolSize = poolSize;
+        auto restorePoolSize = MakeScopeWarden([&] { ThrowIfFailed(factory->put_DeviceContextPoolSize(defaultPoolSize)); });
+
+        ThrowIfFailed(factory->put_DeviceContextPoolSize(1));
+
+        ThrowIfFailed(factory->get_DeviceContextPoolSize(&poolSize));
+        Assert::AreEqual(1u, poolSize);
+
+        auto newDevice = Make<CanvasDevice>(d2dDevice.Get());
+
+        for (auto& device : { existingDevice, newDevice })
+        {
+            auto lease1 = device->GetResourceCreationDeviceContext();
+            auto lease2 = device->GetResourceCreationDeviceContext();
+        }
+
+        // Only one of the two returned contexts fits in the new device's pool,
+        // while the device created before the change still keeps both.
+        Assert::AreEqual<uint64_t>(1, newDevice->GetDeviceContextPoolStatistics().DeviceContextsDiscarded);
+        Assert::AreEqual<uint64_t>(defaultPoolSize >= 2 ? 0 : 1, existingDevice->GetDeviceContextPoolStatistics().DeviceContextsDiscarded);
+    }
+
+    TEST_METHOD_EX(CanvasDevice_DeviceContextPool_PrewarmFailureOtherThanDeviceLostFailsCreation)
+    {
+        Fixture f;
+
+        auto d2dDevice = Make<MockD2DDevice>(Make<MockD2DFactory>().Get());
+
+        d2dDevice->MockCreateDeviceContext =
+            [&] (D2D1_DEVICE_CONTEXT_OPTIONS, ID2D1DeviceContext1**)
+            {
+                ThrowHR(E_OUTOFMEMORY);
+            };
+
+        f.SharedDeviceState->SetDeviceContextPoolPrewarmCount(1);
+        auto restorePrewarmCount = MakeScopeWarden([&] { f.SharedDeviceState->SetDeviceContextPoolPrewarmCount(0); });
+
+        ExpectHResultException(E_OUTOFMEMORY, [&] { Make<CanvasDevice>(d2dDevice.Get()); });
+    }
+
+    TEST_METHOD_EX(CanvasDevice_DeviceContextPoolPrewarmCount_AppliesToNewDevices)
+    {
+        Fixture f;
+
+        auto factory = Make<CanvasDeviceFactory>();
+
+        uint32_t prewarmCount;
+        ThrowIfFailed(factory->get_DeviceContextPoolPrewarmCount(&prewarmCount));
+        Assert::AreEqual(0u, prewarmCount);
+
+        Assert::AreEqual(E_INVALIDARG, factory->get_DeviceContextPoolPrewarmCount(nullptr));
+        Assert::AreEqual(E_INVALIDARG, factory->put_DeviceContextPoolPrewarmCount(DeviceContextPool::MaximumSizeLimit + 1));
+
+        auto d2dDevice = Make<MockD2DDevice>(Make<MockD2DFactory>().Get());
+
+        int deviceContextCount = 0;
+
+        d2dDevice->MockCreateDeviceContext =
+            [&] (D2D1_DEVICE_CONTEXT_OPTIONS, ID2D1DeviceContext1** deviceContext)
+            {
+                deviceContextCount++;
+                ThrowIfFailed(Make<MockD2DDeviceContext>().CopyTo(deviceContext));
+            };
+
+        auto restorePrewarmCount = MakeScopeWarden([&] { ThrowIfFailed(factory->put_DeviceContextPoolPrewarmCount(0)); });
+
+        ThrowIfFailed(factory->put_DeviceContextPoolPrewarmCount(1));
+
+        ThrowIfFailed(factory->get_DeviceContextPoolPrewarmCount(&prewarmCount));
+        Assert::AreEqual(1u, prewarmCount);
+
+        Make<CanvasDevice>(d2dDevice.Get());
+
+        Assert::AreEqual<int>(std::min(1u, DeviceContextPool::GetDefaultMaximumSize()), deviceContextCount);
+    }
+
+    TEST_METHOD_EX(CanvasDevice_DeviceContextPoolStatistics_MatchesPool)
+    {
+        Fixture f;
+
+        auto d2dDevice = Make<MockD2DDevice>(Make<MockD2DFactory>().Get());
+
+        d2dDevice->MockCreateDeviceContext =
+            [&] (D2D1_DEVICE_CONTEXT_OPTIONS, ID2D1DeviceContext1** deviceContext)
+            {
+                ThrowIfFailed(Make<MockD2DDeviceContext>().CopyTo(deviceContext));
+            };
+
+        auto canvasDevice = Make<CanvasDevice>(d2dDevice.Get());
+
+        Assert::AreEqual(E_INVALIDARG, canvasDevice->get_DeviceContextPoolStatistics(nullptr));
+
+        auto lease = canvasDevice->GetResourceCreationDeviceContext();
+
+        CanvasDeviceContextPoolStatistics statistics;
+        ThrowIfFailed(canvasDevice->get_DeviceContextPoolStatistics(&statistics));
+
+        auto expected = canvasDevice->GetDeviceContextPoolStatistics();
+
+        Assert::AreEqual<uint64_t>(1, statistics.LeasesTaken);
+        Assert::AreEqual<uint64_t>(expected.DeviceContextsCreated, statistics.DeviceContextsCreated);
+        Assert::AreEqual<uint64_t>(expected.DeviceContextsDiscarded, statistics.DeviceContextsDiscarded);
+        Assert::AreEqual<uint32_t>(1, statistics.ActiveLeaseCount);
+        Assert::AreEqual<uint32_t>(1, statistics.PeakActiveLeaseCount);
+    }
+
+    static ComPtr<MockD2DDevice> MakeD2DDeviceThatCreatesRenderTargets(int* deviceContextCount)
+    {
+        auto d2dDevice = Make<MockD2DDevice>(Make<MockD2DFactory>().Get());
+
+        d2dDevice->MockCreateDeviceContext =
+            [=] (D2D1_DEVICE_CONTEXT_OPTIONS, ID2D1DeviceContext1** value)
+            {
+                (*deviceContextCount)++;
+
+                auto deviceContext = Make<MockD2DDeviceContext>();
+
+                deviceContext->GetMaximumBitmapSizeMethod.AllowAnyCall([] { return 16384; });
+
+                deviceContext->CreateBitmapMethod.AllowAnyCall(
+                    [] (D2D1_SIZE_U, void const*, UINT32, D2D1_BITMAP_PROPERTIES1 const*, ID2D1Bitmap1** bitmap)
+                    {
+                        return Make<StubD2DBitmap>(D2D1_BITMAP_OPTIONS_TARGET).CopyTo(bitmap);
+                    });
+
+                ThrowIfFailed(deviceContext.CopyTo(value));
+            };
+
+        return d2dDevice;
+    }
+
+    static ComPtr<CanvasRenderTarget> CreateTransientRenderTarget(ICanvasDevice* canvasDevice)
+    {
+        return CanvasRenderTarget::CreateTransient(
+            canvasDevice,
+            16,
+            16,
+            DEFAULT_DPI,
+            PIXEL_FORMAT(B8G8R8A8UIntNormalized),
+            CanvasAlphaMode::Premultiplied);
+    }
+
+    TEST_METHOD_EX(CanvasDevice_LeaseTransientRenderTarget_OnlyTakesDeviceContextOnMiss)
+    {
+        Fixture f;
+
+        int deviceContextCount = 0;
+        auto canvasDevice = Make<CanvasDevice>(MakeD2DDeviceThatCreatesRenderTargets(&deviceContextCount).Get());
+
+        ThrowIfFailed(CreateTransientRenderTarget(canvasDevice.Get())->Close());
+        ThrowIfFailed(CreateTransientRenderTarget(canvasDevice.Get())->Close());
+
+        Assert::AreEqual<uint64_t>(1, canvasDevice->GetTransientRenderTargetPoolStatistics().Reuses);
+        Assert::AreEqual<uint64_t>(1, canvasDevice->GetDeviceContextPoolStatistics().LeasesTaken);
+        Assert::AreEqual(1, deviceContextCount);
+    }
+
+    TEST_METHOD_EX(CanvasDevice_TransientRenderTarget_KeepsDeviceAliveUntilClosed)
+    {
+        Fixture f;
+
+        int deviceContextCount = 0;
+        auto canvasDevice = Make<CanvasDevice>(MakeD2DDeviceThatCreatesRenderTargets(&deviceContextCount).Get());
+
+        WeakRef weakDevice;
+        ThrowIfFailed(AsWeak(canvasDevice.Get(), &weakDevice));
+
+        auto renderTarget = CreateTransientRenderTarget(canvasDevice.Get());
+
+        // Closing the render target then releases the last reference to the
+        // device, which must not happen until the bitmap is back in its pool.
+        canvasDevice.Reset();
+        Assert::IsTrue(IsWeakRefValid(weakDevice));
+
+        ThrowIfFailed(renderTarget->Close());
+
+        Assert::IsFalse(IsWeakRefValid(weakDevice));
+    }
+
+    TEST_METHOD_EX(CanvasDevice_Trim_ReleasesCachedAndPooledBitmaps)
+    {
+        Fixture f;
+
+        int deviceContextCount = 0;
+        auto d2dDevice = MakeD2DDeviceThatCreatesRenderTargets(&deviceContextCount);
+        d2dDevice->ClearResourcesMethod.AllowAnyCall();
+        static_cast<MockDxgiDevice*>(d2dDevice->GetDxgiDevice().Get())->MockTrim = [] {};
+
+        auto canvasDevice = Make<CanvasDevice>(d2dDevice.Get());
+
+        ThrowIfFailed(CreateTransientRenderTarget(canvasDevice.Get())->Close());
+        Assert::AreEqual<uint32_t>(1, canvasDevice->GetTransientRenderTargetPoolStatistics().PooledTargetCount);
+
+        auto decodedBitmap = Make<StubD2DBitmap>();
+        decodedBitmap->GetPixelSizeMethod.AllowAnyCall([] { return D2D1_SIZE_U{ 16, 16 }; });
+        decodedBitmap->GetPixelFormatMethod.AllowAnyCall([] { return D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED); });
+
+        canvasDevice->AddDecodedBitmap(L"key", decodedBitmap.Get());
+        Assert::AreEqual<uint32_t>(1, canvasDevice->GetDecodedBitmapCacheStatistics().CachedBitmapCount);
+
+        canvasDevice->LeaseStagingBitmap(D2D1_SIZE_U{ 16, 16 }, D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+        Assert::AreEqual<uint32_t>(1, canvasDevice->GetStagingBitmapPoolStatistics().PooledBitmapCount);
+
+        ThrowIfFailed(canvasDevice->Trim());
+
+        Assert::AreEqual<uint32_t>(0, canvasDevice->GetTransientRenderTargetPoolStatistics().PooledTargetCount);
+        Assert::AreEqual<uint32_t>(0, canvasDevice->GetDecodedBitmapCacheStatistics().CachedBitmapCount);
+        Assert::AreEqual<uint32_t>(0, canvasDevice->GetStagingBitmapPoolStatistics().PooledBitmapCount);
+    }
+
     TEST_METHOD_EX(CanvasDevice_Closed)
     {
         Fixture f;
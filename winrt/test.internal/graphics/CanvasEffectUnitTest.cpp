@@ -338,6 +338,211 @@ public:
         testEffect->put_Source(nullptr);
     }
 
+    TEST_METHOD_EX(CanvasEffect_Realize_LeasesD2DEffectFromDevice)
+    {
+        Fixture f;
+
+        auto testEffect = Make<TestEffect>(m_blurGuid, 0, 1, false);
+        auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+        auto d2dEffect = Make<StubD2DEffect>(m_blurGuid);
+
+        ThrowIfFailed(testEffect->put_Source(As<IGraphicsEffectSource>(stubBitmap).Get()));
+
+        f.m_deviceContext->DrawImageMethod.AllowAnyCall();
+        f.m_deviceContext->CreateEffectMethod.SetExpectedCalls(0);
+
+        f.m_canvasDevice->LeaseEffectMethod.SetExpectedCalls(1,
+            [&](ID2D1DeviceContext* deviceContext, IID const& effectId)
+            {
+                Assert::IsTrue(IsSameInstance(f.m_deviceContext.Get(), deviceContext));
+                Assert::AreEqual(m_blurGuid, effectId);
+                return d2dEffect;
+            });
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffect.Get()));
+
+        Assert::IsTrue(IsSameInstance(d2dEffect.Get(), As<ICanvasImageInternal>(testEffect)->GetD2DImage(f.m_canvasDevice.Get(), f.m_deviceContext.Get()).Get()));
+    }
+
+    TEST_METHOD_EX(CanvasEffect_Close_ReturnsD2DEffectToDevice)
+    {
+        Fixture f;
+
+        auto testEffect = Make<TestEffect>(m_blurGuid, 0, 1, false);
+        auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+
+        ThrowIfFailed(testEffect->put_Source(As<IGraphicsEffectSource>(stubBitmap).Get()));
+
+        ComPtr<ID2D1Effect> d2dEffect;
+
+        f.m_deviceContext->DrawImageMethod.AllowAnyCall();
+        f.m_deviceContext->CreateEffectMethod.SetExpectedCalls(1,
+            [&](IID const&, ID2D1Effect** effect)
+            {
+                d2dEffect = Make<StubD2DEffect>(m_blurGuid);
+                return d2dEffect.CopyTo(effect);
+            });
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffect.Get()));
+
+        // Nothing else kept the effect after drawing it, so it can be pooled.
+        f.m_canvasDevice->ReleaseEffectMethod.SetExpectedCalls(1,
+            [&](IID const& effectId, ComPtr<ID2D1Effect> effect, bool isShared)
+            {
+                Assert::AreEqual(m_blurGuid, effectId);
+                Assert::IsTrue(IsSameInstance(d2dEffect.Get(), effect.Get()));
+                Assert::IsFalse(isShared);
+            });
+
+        ThrowIfFailed(testEffect->Close());
+    }
+
+    TEST_METHOD_EX(CanvasEffect_AfterGetNativeResource_D2DEffectIsReturnedAsShared)
+    {
+        Fixture f;
+
+        auto testEffect = Make<TestEffect>(m_blurGuid, 0, 1, false);
+        auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+
+        ThrowIfFailed(testEffect->put_Source(As<IGraphicsEffectSource>(stubBitmap).Get()));
+
+        f.m_deviceContext->DrawImageMethod.AllowAnyCall();
+        f.m_deviceContext->CreateEffectMethod.AllowAnyCall(
+            [&](IID const& effectId, ID2D1Effect** effect)
+            {
+                return Make<MockD2DEffectThatCountsCalls>(effectId).CopyTo(effect);
+            });
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffect.Get()));
+
+        ComPtr<ID2D1Effect> nativeEffect;
+        ThrowIfFailed(As<ICanvasResourceWrapperNative>(testEffect)->GetNativeResource(f.m_canvasDevice.Get(), DEFAULT_DPI, IID_PPV_ARGS(&nativeEffect)));
+
+        f.m_canvasDevice->ReleaseEffectMethod.SetExpectedCalls(1,
+            [&](IID const&, ComPtr<ID2D1Effect> effect, bool isShared)
+            {
+                Assert::IsTrue(IsSameInstance(nativeEffect.Get(), effect.Get()));
+                Assert::IsTrue(isShared);
+            });
+
+        ThrowIfFailed(testEffect->Close());
+    }
+
+    struct EffectChainFixture : public Fixture
+    {
+        ComPtr<TestEffect> Parent;
+        ComPtr<TestEffect> Child;
+        std::vector<ComPtr<MockD2DEffectThatCountsCalls>> MockEffects;
+
+        EffectChainFixture()
+        {
+            m_deviceContext->DrawImageMethod.AllowAnyCall();
+            m_deviceContext->CreateEffectMethod.AllowAnyCall(
+                [&](IID const& effectId, ID2D1Effect** effect)
+                {
+                    MockEffects.push_back(Make<MockD2DEffectThatCountsCalls>(effectId));
+                    return MockEffects.back().CopyTo(effect);
+                });
+
+            auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, m_canvasDevice.Get());
+
+            Parent = Make<TestEffect>(CLSID_D2D1GaussianBlur, 0, 1, false);
+            Child = Make<TestEffect>(CLSID_D2D1Border, 0, 1, false);
+
+            ThrowIfFailed(Child->put_Source(As<IGraphicsEffectSource>(stubBitmap).Get()));
+            ThrowIfFailed(Parent->put_Source(Child.Get()));
+
+            ThrowIfFailed(m_drawingSession->DrawImageAtOrigin(Parent.Get()));
+
+            Assert::AreEqual<size_t>(2, MockEffects.size());
+        }
+
+        void ExpectRelease(IID const& expectedEffectId, bool expectedIsShared)
+        {
+            m_canvasDevice->ReleaseEffectMethod.SetExpectedCalls(1,
+                [=](IID const& effectId, ComPtr<ID2D1Effect>, bool isShared)
+                {
+                    Assert::AreEqual(expectedEffectId, effectId);
+                    Assert::AreEqual(expectedIsShared, isShared);
+                });
+        }
+    };
+
+    TEST_METHOD_EX(CanvasEffect_SourceEffect_IsReturnedAsSharedWhileParentUsesIt)
+    {
+        EffectChainFixture f;
+
+        f.ExpectRelease(CLSID_D2D1Border, true);
+        ThrowIfFailed(f.Child->Close());
+    }
+
+    TEST_METHOD_EX(CanvasEffect_SourceEffect_IsReturnedAsUnsharedAfterParentIsClosed)
+    {
+        EffectChainFixture f;
+
+        f.ExpectRelease(CLSID_D2D1GaussianBlur, false);
+        ThrowIfFailed(f.Parent->Close());
+
+        f.ExpectRelease(CLSID_D2D1Border, false);
+        ThrowIfFailed(f.Child->Close());
+    }
+
+    TEST_METHOD_EX(CanvasEffect_SourceEffect_IsReturnedAsUnsharedAfterParentStopsUsingIt)
+    {
+        EffectChainFixture f;
+
+        ThrowIfFailed(f.Parent->put_Source(nullptr));
+
+        f.ExpectRelease(CLSID_D2D1Border, false);
+        ThrowIfFailed(f.Child->Close());
+    }
+
+    TEST_METHOD_EX(CanvasEffect_RenderOnCpu_WhenSet_ReturnsD2DEffectToDevice)
+    {
+        Fixture f;
+
+        auto testEffect = Make<TestEffect>(m_blurGuid, 0, 1, false);
+        auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+
+        ThrowIfFailed(testEffect->put_Source(As<IGraphicsEffectSource>(stubBitmap).Get()));
+
+        boolean renderOnCpu;
+        ThrowIfFailed(testEffect->get_RenderOnCpu(&renderOnCpu));
+        Assert::IsFalse(!!renderOnCpu);
+
+        f.m_deviceContext->DrawImageMethod.AllowAnyCall();
+        f.m_deviceContext->CreateEffectMethod.AllowAnyCall(
+            [&](IID const& effectId, ID2D1Effect** effect)
+            {
+                return Make<MockD2DEffectThatCountsCalls>(effectId).CopyTo(effect);
+            });
+
+        ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffect.Get()));
+
+        f.m_canvasDevice->ReleaseEffectMethod.SetExpectedCalls(1);
+
+        ThrowIfFailed(testEffect->put_RenderOnCpu(true));
+
+        ThrowIfFailed(testEffect->get_RenderOnCpu(&renderOnCpu));
+        Assert::IsTrue(!!renderOnCpu);
+    }
+
+    TEST_METHOD_EX(CanvasEffect_RenderOnCpu_UnsupportedGraph_FailsWithoutCreatingD2DEffects)
+    {
+        Fixture f;
+
+        auto testEffect = Make<TestEffect>(CLSID_D2D1Morphology, 0, 1, false);
+        auto stubBitmap = CreateStubCanvasBitmap(DEFAULT_DPI, f.m_canvasDevice.Get());
+
+        ThrowIfFailed(testEffect->put_Source(As<IGraphicsEffectSource>(stubBitmap).Get()));
+        ThrowIfFailed(testEffect->put_RenderOnCpu(true));
+
+        f.m_deviceContext->CreateEffectMethod.SetExpectedCalls(0);
+        f.m_canvasDevice->LeaseEffectMethod.SetExpectedCalls(0);
+
+        Assert::AreEqual(E_NOTIMPL, f.m_drawingSession->DrawImageAtOrigin(testEffect.Get()));
+    }
+
     TEST_METHOD_EX(CanvasEffect_GetBounds_NullArg)
     {
         ABI::Windows::Foundation::Rect bounds;
@@ -546,14 +751,14 @@ public:
         Assert::AreEqual<size_t>(2, mockEffects.size());
         CheckEffectTypeAndInput(mockEffects[0].Get(), m_blurGuid, highDpiBitmap.Get(), f.m_deviceContext.Get());
 
-        // Drawing a high DPI bitmap that doesn't match a different high DPI device context should insert a new DPI compensation effect.
+        // Drawing a high DPI bitmap that doesn't match a different high DPI device context should reinsert the cached DPI compensation effect.
         f.m_dpi = highDpi2;
 
         ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffect.Get()));
 
-        Assert::AreEqual<size_t>(3, mockEffects.size());
-        CheckEffectTypeAndInput(mockEffects[0].Get(), m_blurGuid, mockEffects[2].Get());
-        CheckEffectTypeAndInput(mockEffects[2].Get(), CLSID_D2D1DpiCompensation, highDpiBitmap.Get(), f.m_deviceContext.Get(), highDpi);
+        Assert::AreEqual<size_t>(2, mockEffects.size());
+        CheckEffectTypeAndInput(mockEffects[0].Get(), m_blurGuid, mockEffects[1].Get());
+        CheckEffectTypeAndInput(mockEffects[1].Get(), CLSID_D2D1DpiCompensation, highDpiBitmap.Get(), f.m_deviceContext.Get(), highDpi);
 
         // If we insert our own DPI compensation effect in the chain, Win2D should not automatically add a new one.
         auto dpiCompensationEffect = Make<TestEffect>(CLSID_D2D1DpiCompensation, 0, 1, true);
@@ -562,10 +767,203 @@ public:
         ThrowIfFailed(dpiCompensationEffect->put_Source(highDpiBitmap.Get()));
         ThrowIfFailed(f.m_drawingSession->DrawImageAtOrigin(testEffect.Get()));
 
-        Assert::AreEqual<size_t>(4, mockEffects.size());
-        CheckEffectTypeAndInput(mockEffects[0].Get(), m_blurGuid, mockEffects[3].Get());
-        CheckEffectTypeAndInput(mockEffects[3].Get(), CLSID_D2D1DpiCompensation, highDpiBitmap.Get(), f.m_deviceContext.Get());
-        Assert::IsTrue(IsSameInstance(mockEffects[3].Get(), As<ICanvasImageInternal>(dpiCompensationEffect)->GetD2DImage(f.m_canvasDevice.Get(), f.m_deviceContext.Get()).Get()));
+        Assert::AreEqual<size_t>(3, mockEffects.size());
+        CheckEffectTypeAndInput(mockEffects[0].Get(), m_blurGuid, mockEffects[2].Get());
+        CheckEffectTypeAndInput(mockEffects[2].Get(), CLSID_D2D1DpiCompensation, highDpiBitmap.Get(), f.m_deviceContext.Get());
+        Assert::IsTrue(IsSameInstance(mockEffects[2].Get(), As<ICanvasImageInternal>(dpiCompensationEffect)->GetD2DImage(f.m_canvasDevice.Get(), f.m_deviceContext.Get()).Get()));
+    }
+
+    struct DpiCompensationCacheFixture : public Fixture
+    {
+        std::vector<ComPtr<MockD2DEffectThatCountsCalls>> MockEffects;
+        ComPtr<TestEffect> Effect;
+        ComPtr<CanvasBitmap> Bitmap;
+
+        DpiCompensationCacheFixture(float bitmapDpi)
+        {
+            m_deviceContext->DrawImageMethod.AllowAnyCall();
+
+            m_deviceContext->CreateEffectMethod.AllowAnyCall(
+                [&](IID const& effectId, ID2D1Effect** effect)
+                {
+                    MockEffects.push_back(Make<MockD2DEffectThatCountsCalls>(effectId));
+                    return MockEffects.back().CopyTo(effect);
+                });
+
+            Bitmap = CreateStubCanvasBitmap(bitmapDpi, m_canvasDevice.Get());
+            Effect = Make<TestEffect>(CLSID_D2D1GaussianBlur, 0, 1, true);
+
+            ThrowIfFailed(Effect->put_Source(Bitmap.Get()));
+        }
+
+        void DrawToRenderTarget(float dpi)
+        {
+            m_dpi = dpi;
+            ThrowIfFailed(m_drawingSession->DrawImageAtOrigin(Effect.Get()));
+        }
+
+        void DrawToCommandList()
+        {
+            // Command lists are DPI independent, so always get DPI compensation.
+            As<ICanvasImageInternal>(Effect)->GetD2DImage(m_canvasDevice.Get(), m_deviceContext.Get(), GetImageFlags::AlwaysInsertDpiCompensation);
+        }
+
+        MockD2DEffectThatCountsCalls* Compensator()
+        {
+            Assert::AreEqual<size_t>(2, MockEffects.size());
+            Assert::AreEqual(CLSID_D2D1DpiCompensation, MockEffects[1]->m_effectId);
+            return MockEffects[1].Get();
+        }
+    };
+
+    TEST_METHOD_EX(CanvasEffect_DpiCompensation_AlternatingCommandListAndRenderTarget_DoesNotRecreateCompensator)
+    {
+        DpiCompensationCacheFixture f(DEFAULT_DPI);
+
+        f.DrawToRenderTarget(DEFAULT_DPI);
+
+        Assert::AreEqual<size_t>(1, f.MockEffects.size());
+
+        f.DrawToCommandList();
+
+        auto compensator = f.Compensator();
+        CheckEffectTypeAndInput(f.MockEffects[0].Get(), m_blurGuid, compensator);
+
+        // Border mode, interpolation mode and input DPI.
+        Assert::AreEqual(1, compensator->m_setInputCalls);
+        Assert::AreEqual(3, compensator->m_setValueCalls);
+
+        auto blurSetInputCalls = f.MockEffects[0]->m_setInputCalls;
+
+        for (int i = 0; i < 3; i++)
+        {
+            f.DrawToRenderTarget(DEFAULT_DPI);
+            CheckEffectTypeAndInput(f.MockEffects[0].Get(), m_blurGuid, f.Bitmap.Get(), f.m_deviceContext.Get());
+
+            f.DrawToCommandList();
+            CheckEffectTypeAndInput(f.MockEffects[0].Get(), m_blurGuid, compensator);
+        }
+
+        Assert::IsTrue(IsSameInstance(compensator, f.Compensator()));
+        Assert::AreEqual(1, compensator->m_setInputCalls);
+        Assert::AreEqual(3, compensator->m_setValueCalls);
+
+        // Only the input of the blur effect should have been switched back and forth.
+        Assert::AreEqual(blurSetInputCalls + 6, f.MockEffects[0]->m_setInputCalls);
+    }
+
+    TEST_METHOD_EX(CanvasEffect_DpiCompensation_AlternatingTargetDpi_DoesNotRecreateCompensator)
+    {
+        const float highDpi = DEFAULT_DPI * 2;
+
+        DpiCompensationCacheFixture f(highDpi);
+
+        for (int i = 0; i < 3; i++)
+        {
+            f.DrawToRenderTarget(DEFAULT_DPI);
+
+            auto compensator = f.Compensator();
+            CheckEffectTypeAndInput(f.MockEffects[0].Get(), m_blurGuid, compensator);
+            CheckEffectTypeAndInput(compensator, CLSID_D2D1DpiCompensation, f.Bitmap.Get(), f.m_deviceContext.Get(), highDpi);
+
+            f.DrawToRenderTarget(highDpi);
+
+            Assert::AreEqual<size_t>(2, f.MockEffects.size());
+            CheckEffectTypeAndInput(f.MockEffects[0].Get(), m_blurGuid, f.Bitmap.Get(), f.m_deviceContext.Get());
+        }
+
+        Assert::AreEqual(1, f.Compensator()->m_setInputCalls);
+        Assert::AreEqual(3, f.Compensator()->m_setValueCalls);
+    }
+
+    TEST_METHOD_EX(CanvasEffect_DpiCompensation_WhenSourceHasNoDpi_CachedCompensatorIsReleased)
+    {
+        DpiCompensationCacheFixture f(DEFAULT_DPI);
+
+        f.DrawToCommandList();
+
+        auto compensator = f.Compensator();
+
+        // Switch to a source that never needs DPI compensation.
+        auto dpiIndependentSource = Make<TestEffect>(m_blurGuid, 0, 1, true);
+        ThrowIfFailed(dpiIndependentSource->put_Source(f.Bitmap.Get()));
+        ThrowIfFailed(f.Effect->put_Source(dpiIndependentSource.Get()));
+
+        // The effect itself, the original compensator, the new source effect, and a new compensator
+        // for the new source's bitmap input.
+        f.DrawToCommandList();
+
+        Assert::AreEqual<size_t>(4, f.MockEffects.size());
+        CheckEffectTypeAndInput(f.MockEffects[0].Get(), m_blurGuid, f.MockEffects[2].Get());
+
+        // Only our test vector still references the old compensator.
+        compensator->AddRef();
+        Assert::AreEqual<ULONG>(1, compensator->Release());
+    }
+
+    TEST_METHOD_EX(CanvasEffect_DpiCompensation_WhenSourceHasNoDpi_CachedCompensatorIsReturnedToDevice)
+    {
+        DpiCompensationCacheFixture f(DEFAULT_DPI);
+
+        f.DrawToRenderTarget(DEFAULT_DPI * 2);
+
+        auto compensator = f.Compensator();
+
+        auto dpiIndependentSource = Make<TestEffect>(m_blurGuid, 0, 1, true);
+        ThrowIfFailed(dpiIndependentSource->put_Source(f.Bitmap.Get()));
+
+        f.m_canvasDevice->ReleaseEffectMethod.SetExpectedCalls(1,
+            [&](IID const& effectId, ComPtr<ID2D1Effect> effect, bool isShared)
+            {
+                Assert::AreEqual(CLSID_D2D1DpiCompensation, effectId);
+                Assert::IsTrue(IsSameInstance(compensator, effect.Get()));
+                Assert::IsFalse(isShared);
+            });
+
+        ThrowIfFailed(f.Effect->put_Source(dpiIndependentSource.Get()));
+    }
+
+    TEST_METHOD_EX(CanvasEffect_Close_ReturnsDpiCompensatorToDevice)
+    {
+        DpiCompensationCacheFixture f(DEFAULT_DPI * 2);
+
+        f.DrawToRenderTarget(DEFAULT_DPI);
+
+        auto compensator = f.Compensator();
+        bool compensatorWasReturned = false;
+
+        f.m_canvasDevice->ReleaseEffectMethod.SetExpectedCalls(2,
+            [&](IID const& effectId, ComPtr<ID2D1Effect> effect, bool isShared)
+            {
+                if (IsEqualGUID(effectId, CLSID_D2D1DpiCompensation))
+                {
+                    Assert::IsTrue(IsSameInstance(compensator, effect.Get()));
+                    compensatorWasReturned = true;
+                }
+
+                Assert::IsFalse(isShared);
+            });
+
+        ThrowIfFailed(f.Effect->Close());
+
+        Assert::IsTrue(compensatorWasReturned);
+    }
+
+    TEST_METHOD_EX(CanvasEffect_AfterDrawingToCommandList_DpiCompensatorIsReturnedAsShared)
+    {
+        DpiCompensationCacheFixture f(DEFAULT_DPI);
+
+        f.DrawToCommandList();
+
+        f.Compensator();
+
+        f.m_canvasDevice->ReleaseEffectMethod.SetExpectedCalls(2,
+            [&](IID const&, ComPtr<ID2D1Effect>, bool isShared)
+            {
+                Assert::IsTrue(isShared);
+            });
+
+        ThrowIfFailed(f.Effect->Close());
     }
 
     struct CommandListFixture
@@ -104,6 +104,159 @@ TEST_CLASS(CanvasRenderTargetTests)
         Assert::AreEqual(RO_E_CLOSED, renderTarget->CreateDrawingSession(&drawingSession));
     }
 
+    TEST_METHOD_EX(CanvasRenderTarget_CreateTransient_ClosingRenderTargetReturnsBitmapToPool)
+    {
+        auto canvasDevice = Make<StubCanvasDevice>();
+        auto deviceContext = Make<MockD2DDeviceContext>();
+        TransientRenderTargetPool pool;
+
+        deviceContext->CreateBitmapMethod.SetExpectedCalls(1,
+            [](D2D1_SIZE_U, void const*, UINT32, D2D1_BITMAP_PROPERTIES1 const*, ID2D1Bitmap1** bitmap)
+            {
+                return Make<StubD2DBitmap>(D2D1_BITMAP_OPTIONS_TARGET).CopyTo(bitmap);
+            });
+
+        canvasDevice->LeaseTransientRenderTargetMethod.SetExpectedCalls(2,
+            [&](float width, float height, float dpi, DirectXPixelFormat format, CanvasAlphaMode alpha)
+            {
+                Assert::AreEqual(23.0f, width);
+                Assert::AreEqual(42.0f, height);
+                Assert::AreEqual(DEFAULT_DPI, dpi);
+                Assert::AreEqual(PIXEL_FORMAT(B8G8R8A8UIntNormalized), format);
+                Assert::AreEqual(CanvasAlphaMode::Premultiplied, alpha);
+
+                return pool.TakeLease(deviceContext.Get(), D2D1_SIZE_U{ 23, 42 }, D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED), dpi);
+            });
+
+        auto createTransient = [&]
+        {
+            return CanvasRenderTarget::CreateTransient(
+                canvasDevice.Get(),
+                23,
+                42,
+                DEFAULT_DPI,
+                PIXEL_FORMAT(B8G8R8A8UIntNormalized),
+                CanvasAlphaMode::Premultiplied);
+        };
+
+        auto renderTarget = createTransient();
+        Assert::IsNotNull(renderTarget.Get());
+
+        Assert::AreEqual(S_OK, renderTarget->Close());
+
+        Assert::AreEqual<uint32_t>(1, pool.GetStatistics().PooledTargetCount);
+
+        ComPtr<ICanvasDrawingSession> drawingSession;
+        Assert::AreEqual(RO_E_CLOSED, renderTarget->CreateDrawingSession(&drawingSession));
+
+        // The pooled bitmap can be wrapped again by the next transient render target.
+        auto secondRenderTarget = createTransient();
+
+        Assert::IsFalse(IsSameInstance(renderTarget.Get(), secondRenderTarget.Get()));
+        Assert::AreEqual<uint64_t>(1, pool.GetStatistics().Reuses);
+    }
+
+    static void LeaseFromPool(StubCanvasDevice* canvasDevice, TransientRenderTargetPool* pool)
+    {
+        canvasDevice->LeaseTransientRenderTargetMethod.AllowAnyCall(
+            [=](float width, float height, float dpi, DirectXPixelFormat format, CanvasAlphaMode alpha)
+            {
+                auto deviceContext = Make<MockD2DDeviceContext>();
+
+                deviceContext->CreateBitmapMethod.AllowAnyCall(
+                    [](D2D1_SIZE_U, void const*, UINT32, D2D1_BITMAP_PROPERTIES1 const* properties, ID2D1Bitmap1** bitmap)
+                    {
+                        return Make<StubD2DBitmap>(D2D1_BITMAP_OPTIONS_TARGET, properties->dpiX).CopyTo(bitmap);
+                    });
+
+                auto size = D2D1_SIZE_U{ static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+
+                return pool->TakeLease(deviceContext.Get(), size, D2D1::PixelFormat(static_cast<DXGI_FORMAT>(format), ToD2DAlphaMode(alpha)), dpi);
+            });
+    }
+
+    static ComPtr<CanvasRenderTarget> CreateTransientRenderTarget(ICanvasDevice* canvasDevice)
+    {
+        return CanvasRenderTarget::CreateTransient(
+            canvasDevice,
+            1,
+            1,
+            DEFAULT_DPI,
+            PIXEL_FORMAT(B8G8R8A8UIntNormalized),
+            CanvasAlphaMode::Premultiplied);
+    }
+
+    TEST_METHOD_EX(CanvasRenderTarget_CreateTransient_ReleasingRenderTargetReturnsBitmapToPool)
+    {
+        TransientRenderTargetPool pool;
+        auto canvasDevice = Make<StubCanvasDevice>();
+        LeaseFromPool(canvasDevice.Get(), &pool);
+
+        auto renderTarget = CreateTransientRenderTarget(canvasDevice.Get());
+        auto d2dBitmap = GetWrappedResource<ID2D1Bitmap1>(renderTarget);
+
+        renderTarget.Reset();
+
+        Assert::AreEqual<uint32_t>(1, pool.GetStatistics().PooledTargetCount);
+
+        // Wrapping the same bitmap again fails if the released render target
+        // left it registered with the ResourceManager.
+        auto secondRenderTarget = CreateTransientRenderTarget(canvasDevice.Get());
+
+        Assert::IsTrue(IsSameInstance(d2dBitmap.Get(), GetWrappedResource<ID2D1Bitmap1>(secondRenderTarget).Get()));
+    }
+
+    TEST_METHOD_EX(CanvasRenderTarget_CreateTransient_ClosingWithActiveDrawingSession_DoesNotPoolBitmap)
+    {
+        TransientRenderTargetPool pool;
+        Fixture f;
+        LeaseFromPool(f.m_canvasDevice.Get(), &pool);
+
+        auto renderTarget = CreateTransientRenderTarget(f.m_canvasDevice.Get());
+
+        ComPtr<ICanvasDrawingSession> drawingSession;
+        ThrowIfFailed(renderTarget->CreateDrawingSession(&drawingSession));
+
+        Assert::AreEqual(S_OK, renderTarget->Close());
+
+        auto statistics = pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(0, statistics.PooledTargetCount);
+        Assert::AreEqual<uint32_t>(0, statistics.LeasedTargetCount);
+        Assert::AreEqual<uint64_t>(1, statistics.TargetsDiscarded);
+    }
+
+    TEST_METHOD_EX(CanvasRenderTargetFactory_CreateTransient_UsesDpiOfResourceCreator)
+    {
+        TransientRenderTargetPool pool;
+        auto canvasDevice = Make<StubCanvasDevice>();
+        LeaseFromPool(canvasDevice.Get(), &pool);
+
+        auto resourceCreator = Make<StubResourceCreatorWithDpi>(canvasDevice.Get());
+        resourceCreator->SetDpi(144);
+
+        auto factory = Make<CanvasRenderTargetFactory>();
+
+        ComPtr<ICanvasRenderTarget> renderTarget;
+        ThrowIfFailed(factory->CreateTransient(resourceCreator.Get(), 1, 1, &renderTarget));
+
+        float dpi;
+        ThrowIfFailed(As<ICanvasResourceCreatorWithDpi>(renderTarget)->get_Dpi(&dpi));
+        Assert::AreEqual(144.0f, dpi);
+    }
+
+    TEST_METHOD_EX(CanvasRenderTargetFactory_CreateTransient_NullArgs)
+    {
+        auto canvasDevice = Make<StubCanvasDevice>();
+        auto resourceCreator = Make<StubResourceCreatorWithDpi>(canvasDevice.Get());
+        auto factory = Make<CanvasRenderTargetFactory>();
+
+        ComPtr<ICanvasRenderTarget> renderTarget;
+        Assert::AreEqual(E_INVALIDARG, factory->CreateTransient(nullptr, 1, 1, &renderTarget));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateTransient(resourceCreator.Get(), 1, 1, nullptr));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateTransientWithDpiAndFormatAndAlpha(nullptr, 1, 1, DEFAULT_DPI, PIXEL_FORMAT(B8G8R8A8UIntNormalized), CanvasAlphaMode::Premultiplied, &renderTarget));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateTransientWithDpiAndFormatAndAlpha(canvasDevice.Get(), 1, 1, DEFAULT_DPI, PIXEL_FORMAT(B8G8R8A8UIntNormalized), CanvasAlphaMode::Premultiplied, nullptr));
+    }
+
     TEST_METHOD_EX(CanvasRenderTarget_DrawingSession)
     {        
         Fixture f;
@@ -837,6 +837,27 @@ TEST_CLASS(CanvasSwapChainUnitTests)
         ThrowIfFailed(canvasSwapChain->PresentWithSyncInterval(3));
     }
 
+    TEST_METHOD_EX(CanvasSwapChain_Present_EndsTransientRenderTargetFrame)
+    {
+        StubDeviceFixture f;
+
+        f.m_canvasDevice->CreateSwapChainForCompositionMethod.AllowAnyCall([=](int32_t, int32_t, DirectXPixelFormat, int32_t, CanvasAlphaMode)
+        {
+            auto swapChain = Make<MockDxgiSwapChain>();
+
+            swapChain->SetMatrixTransformMethod.SetExpectedCalls(1);
+            swapChain->Present1Method.SetExpectedCalls(1);
+
+            return swapChain;
+        });
+
+        auto canvasSwapChain = f.CreateTestSwapChain();
+
+        f.m_canvasDevice->EndTransientRenderTargetFrameMethod.SetExpectedCalls(1);
+
+        ThrowIfFailed(canvasSwapChain->Present());
+    }
+
     TEST_METHOD_EX(CanvasSwapChain_CreateDrawingSession)
     {
         StubDeviceFixture f;
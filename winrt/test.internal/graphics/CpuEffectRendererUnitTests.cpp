@@ -0,0 +1,788 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/effects/cpu/CpuEffectRenderer.h>
+#include <lib/effects/generated/BlendEffect.h>
+#include <lib/effects/generated/BorderEffect.h>
+#include <lib/effects/generated/CompositeEffect.h>
+#include <lib/effects/generated/CropEffect.h>
+#include <lib/effects/generated/GaussianBlurEffect.h>
+#include <lib/effects/generated/SaturationEffect.h>
+#include <lib/effects/generated/Transform2DEffect.h>
+
+using namespace CpuEffectKernels;
+
+namespace
+{
+    const CpuColor Transparent  { 0, 0, 0, 0 };
+    const CpuColor OpaqueRed    { 1, 0, 0, 1 };
+    const CpuColor OpaqueBlue   { 0, 0, 1, 1 };
+    const CpuColor HalfGreen    { 0, 0.5f, 0, 0.5f };
+
+    CpuImage MakeSolidImage(CpuRect const& bounds, CpuColor const& color)
+    {
+        CpuImage image(bounds);
+
+        for (int y = bounds.Top; y < bounds.Bottom; y++)
+        {
+            for (int x = bounds.Left; x < bounds.Right; x++)
+            {
+                image.SetPixel(x, y, color);
+            }
+        }
+
+        return image;
+    }
+
+    void AssertColorsEqual(CpuColor const& expected, CpuColor const& actual, float tolerance = 0.0001f)
+    {
+        Assert::AreEqual(expected.R, actual.R, tolerance);
+        Assert::AreEqual(expected.G, actual.G, tolerance);
+        Assert::AreEqual(expected.B, actual.B, tolerance);
+        Assert::AreEqual(expected.A, actual.A, tolerance);
+    }
+
+    void AssertImagesEqual(CpuImage const& expected, CpuImage const& actual)
+    {
+        auto& bounds = expected.GetBounds();
+
+        Assert::IsTrue(bounds == actual.GetBounds());
+
+        for (int y = bounds.Top; y < bounds.Bottom; y++)
+        {
+            for (int x = bounds.Left; x < bounds.Right; x++)
+            {
+                AssertColorsEqual(expected.GetPixel(x, y), actual.GetPixel(x, y));
+            }
+        }
+    }
+
+    float SumOfAlpha(CpuImage const& image)
+    {
+        float sum = 0;
+        auto& bounds = image.GetBounds();
+
+        for (int y = bounds.Top; y < bounds.Bottom; y++)
+        {
+            for (int x = bounds.Left; x < bounds.Right; x++)
+            {
+                sum += image.GetPixel(x, y).A;
+            }
+        }
+
+        return sum;
+    }
+}
+
+TEST_CLASS(CpuEffectKernelsUnitTests)
+{
+public:
+    TEST_METHOD_EX(CpuEffectKernels_GaussianBlur_SoftBorder)
+    {
+        CpuImage input(CpuRect{ 0, 0, 9, 9 });
+        input.SetPixel(4, 4, OpaqueRed);
+
+        auto outputBounds = GetGaussianBlurBounds(input.GetBounds(), 1.0f, BorderMode::Soft);
+
+        Assert::IsTrue(CpuRect{ -3, -3, 12, 12 } == outputBounds);
+
+        auto output = GaussianBlur(input, input.GetBounds(), 1.0f, BorderMode::Soft, outputBounds);
+
+        // Blurring spreads the pixel out symmetrically, without gaining or losing any coverage.
+        Assert::AreEqual(1.0f, SumOfAlpha(output), 0.0001f);
+        Assert::AreEqual(output.GetPixel(3, 4).A, output.GetPixel(5, 4).A);
+        Assert::AreEqual(output.GetPixel(4, 3).A, output.GetPixel(4, 5).A);
+        Assert::IsTrue(output.GetPixel(4, 4).A > output.GetPixel(5, 4).A);
+        Assert::AreEqual(0.0f, output.GetPixel(4, 4).B);
+    }
+
+    TEST_METHOD_EX(CpuEffectKernels_GaussianBlur_HardBorderClampsEdges)
+    {
+        auto input = MakeSolidImage(CpuRect{ 0, 0, 5, 5 }, OpaqueBlue);
+
+        Assert::IsTrue(input.GetBounds() == GetGaussianBlurBounds(input.GetBounds(), 2.0f, BorderMode::Hard));
+
+        auto output = GaussianBlur(input, input.GetBounds(), 2.0f, BorderMode::Hard, CpuRect{ -1, -1, 6, 6 });
+
+        AssertColorsEqual(OpaqueBlue, output.GetPixel(0, 0));
+        AssertColorsEqual(OpaqueBlue, output.GetPixel(4, 4));
+        AssertColorsEqual(Transparent, output.GetPixel(-1, 0));
+        AssertColorsEqual(Transparent, output.GetPixel(5, 5));
+    }
+
+    TEST_METHOD_EX(CpuEffectKernels_GaussianBlur_ZeroAmountIsIdentity)
+    {
+        auto input = MakeSolidImage(CpuRect{ 0, 0, 3, 2 }, HalfGreen);
+
+        auto output = GaussianBlur(input, input.GetBounds(), 0.0f, BorderMode::Soft, input.GetBounds());
+
+        AssertImagesEqual(input, output);
+    }
+
+    TEST_METHOD_EX(CpuEffectKernels_ColorMatrix)
+    {
+        // Swap red and blue, and halve alpha.
+        float matrix[20] =
+        {
+            0, 0, 1, 0,
+            0, 1, 0, 0,
+            1, 0, 0, 0,
+            0, 0, 0, 0.5f,
+            0, 0, 0, 0,
+        };
+
+        auto premultiplied = MakeSolidImage(CpuRect{ 0, 0, 1, 1 }, CpuColor{ 0.5f, 0, 0, 0.5f });
+        ColorMatrix(premultiplied, matrix, ColorMatrixAlphaMode::Premultiplied, false);
+        AssertColorsEqual(CpuColor{ 0, 0, 0.25f, 0.25f }, premultiplied.GetPixel(0, 0));
+
+        auto straight = MakeSolidImage(CpuRect{ 0, 0, 1, 1 }, CpuColor{ 0.5f, 0, 0, 0.5f });
+        ColorMatrix(straight, matrix, ColorMatrixAlphaMode::Straight, false);
+        AssertColorsEqual(CpuColor{ 0, 0, 0.5f, 0.25f }, straight.GetPixel(0, 0));
+
+        // An offset pushes the result out of range unless clamped.
+        float offsetMatrix[20] =
+        {
+            1, 0, 0, 0,
+            0, 1, 0, 0,
+            0, 0, 1, 0,
+            0, 0, 0, 1,
+            1, 0, 0, 0,
+        };
+
+        auto clamped = MakeSolidImage(CpuRect{ 0, 0, 1, 1 }, OpaqueRed);
+        ColorMatrix(clamped, offsetMatrix, ColorMatrixAlphaMode::Premultiplied, true);
+        AssertColorsEqual(OpaqueRed, clamped.GetPixel(0, 0));
+
+        auto unclamped = MakeSolidImage(CpuRect{ 0, 0, 1, 1 }, OpaqueRed);
+        ColorMatrix(unclamped, offsetMatrix, ColorMatrixAlphaMode::Premultiplied, false);
+        AssertColorsEqual(CpuColor{ 2, 0, 0, 1 }, unclamped.GetPixel(0, 0));
+    }
+
+    TEST_METHOD_EX(CpuEffectKernels_Blend)
+    {
+        auto rect = CpuRect{ 0, 0, 2, 1 };
+
+        auto background = MakeSolidImage(rect, CpuColor{ 0.5f, 0.5f, 0.5f, 1 });
+        auto foreground = MakeSolidImage(CpuRect{ 0, 0, 1, 1 }, CpuColor{ 0.5f, 1, 0, 1 });
+
+        auto multiply = Blend(background, foreground, BlendMode::Multiply, rect);
+        AssertColorsEqual(CpuColor{ 0.25f, 0.5f, 0, 1 }, multiply.GetPixel(0, 0));
+
+        // Where the foreground is transparent, the background shows through unchanged.
+        AssertColorsEqual(background.GetPixel(1, 0), multiply.GetPixel(1, 0));
+
+        auto screen = Blend(background, foreground, BlendMode::Screen, rect);
+        AssertColorsEqual(CpuColor{ 0.75f, 1, 0.5f, 1 }, screen.GetPixel(0, 0));
+
+        auto difference = Blend(background, foreground, BlendMode::Difference, rect);
+        AssertColorsEqual(CpuColor{ 0, 0.5f, 0.5f, 1 }, difference.GetPixel(0, 0));
+
+        // Luminosity keeps the (gray) background hue, so gives a gray result.
+        auto luminosity = Blend(background, foreground, BlendMode::Luminosity, rect);
+        auto gray = luminosity.GetPixel(0, 0);
+        Assert::AreEqual(gray.R, gray.G, 0.0001f);
+        Assert::AreEqual(gray.R, gray.B, 0.0001f);
+
+        Assert::IsFalse(IsBlendModeSupported(BlendMode::Dissolve));
+        Assert::IsFalse(IsBlendModeSupported(static_cast<BlendMode>(26)));
+    }
+
+    TEST_METHOD_EX(CpuEffectKernels_Composite)
+    {
+        auto rect = CpuRect{ 0, 0, 2, 1 };
+        auto sourceBounds = CpuRect{ 0, 0, 1, 1 };
+        auto source = MakeSolidImage(sourceBounds, HalfGreen);
+
+        auto sourceOver = MakeSolidImage(rect, OpaqueRed);
+        Composite(sourceOver, source, sourceBounds, CompositeMode::SourceOver);
+        AssertColorsEqual(CpuColor{ 0.5f, 0.5f, 0, 1 }, sourceOver.GetPixel(0, 0));
+        AssertColorsEqual(OpaqueRed, sourceOver.GetPixel(1, 0));
+
+        auto destinationOut = MakeSolidImage(rect, OpaqueRed);
+        Composite(destinationOut, source, sourceBounds, CompositeMode::DestinationOut);
+        AssertColorsEqual(CpuColor{ 0.5f, 0, 0, 0.5f }, destinationOut.GetPixel(0, 0));
+
+        // SourceCopy clears the destination outside the source, BoundedSourceCopy does not.
+        auto sourceCopy = MakeSolidImage(rect, OpaqueRed);
+        Composite(sourceCopy, source, sourceBounds, CompositeMode::SourceCopy);
+        AssertColorsEqual(HalfGreen, sourceCopy.GetPixel(0, 0));
+        AssertColorsEqual(Transparent, sourceCopy.GetPixel(1, 0));
+
+        auto boundedSourceCopy = MakeSolidImage(rect, OpaqueRed);
+        Composite(boundedSourceCopy, source, sourceBounds, CompositeMode::BoundedSourceCopy);
+        AssertColorsEqual(HalfGreen, boundedSourceCopy.GetPixel(0, 0));
+        AssertColorsEqual(OpaqueRed, boundedSourceCopy.GetPixel(1, 0));
+
+        auto plus = MakeSolidImage(rect, OpaqueRed);
+        Composite(plus, source, sourceBounds, CompositeMode::Plus);
+        AssertColorsEqual(CpuColor{ 1, 0.5f, 0, 1 }, plus.GetPixel(0, 0));
+    }
+
+    TEST_METHOD_EX(CpuEffectKernels_ArithmeticComposite)
+    {
+        auto rect = CpuRect{ 0, 0, 1, 1 };
+
+        auto source1 = MakeSolidImage(rect, CpuColor{ 0.5f, 0.25f, 0, 1 });
+        auto source2 = MakeSolidImage(rect, CpuColor{ 0.5f, 1, 1, 1 });
+
+        float coefficients[4] = { 1, 0.5f, 0.25f, 0.125f };
+
+        auto output = ArithmeticComposite(source1, source2, coefficients, false, rect);
+        AssertColorsEqual(CpuColor{ 0.25f + 0.25f + 0.125f + 0.125f, 0.25f + 0.125f + 0.25f + 0.125f, 0.25f + 0.125f, 1.875f }, output.GetPixel(0, 0));
+
+        auto clamped = ArithmeticComposite(source1, source2, coefficients, true, rect);
+        Assert::AreEqual(1.0f, clamped.GetPixel(0, 0).A);
+    }
+
+    TEST_METHOD_EX(CpuEffectKernels_Crop)
+    {
+        float rect[4] = { 0.5f, 0, 2, std::numeric_limits<float>::infinity() };
+
+        auto inputBounds = CpuRect{ 0, 0, 4, 1 };
+
+        Assert::IsTrue(CpuRect{ 0, 0, 2, 1 } == GetCropBounds(inputBounds, rect));
+
+        auto soft = MakeSolidImage(inputBounds, OpaqueRed);
+        Crop(soft, rect, BorderMode::Soft);
+        AssertColorsEqual(CpuColor{ 0.5f, 0, 0, 0.5f }, soft.GetPixel(0, 0));
+        AssertColorsEqual(OpaqueRed, soft.GetPixel(1, 0));
+        AssertColorsEqual(Transparent, soft.GetPixel(2, 0));
+
+        auto hard = MakeSolidImage(inputBounds, OpaqueRed);
+        Crop(hard, rect, BorderMode::Hard);
+        AssertColorsEqual(OpaqueRed, hard.GetPixel(0, 0));
+        AssertColorsEqual(Transparent, hard.GetPixel(2, 0));
+    }
+
+    TEST_METHOD_EX(CpuEffectKernels_Transform)
+    {
+        CpuImage input(CpuRect{ 0, 0, 2, 1 });
+        input.SetPixel(0, 0, OpaqueRed);
+        input.SetPixel(1, 0, OpaqueBlue);
+
+        // Integer translation is exact.
+        float translate[6] = { 1, 0, 0, 1, 3, 2 };
+
+        auto translatedBounds = GetTransformBounds(input.GetBounds(), translate);
+        Assert::IsTrue(CpuRect{ 3, 2, 5, 3 } == translatedBounds);
+
+        auto translated = Transform(input, input.GetBounds(), translate, InterpolationMode::Linear, BorderMode::Soft, translatedBounds);
+        AssertColorsEqual(OpaqueRed, translated.GetPixel(3, 2));
+        AssertColorsEqual(OpaqueBlue, translated.GetPixel(4, 2));
+
+        // Scaling up with nearest neighbor filtering duplicates pixels.
+        float scale[6] = { 2, 0, 0, 2, 0, 0 };
+
+        auto scaledBounds = GetTransformBounds(input.GetBounds(), scale);
+        Assert::IsTrue(CpuRect{ 0, 0, 4, 2 } == scaledBounds);
+
+        auto sourceRect = GetTransformSourceRect(scaledBounds, input.GetBounds(), scale);
+        Assert::IsTrue(input.GetBounds() == sourceRect);
+
+        auto scaled = Transform(input, input.GetBounds(), scale, InterpolationMode::NearestNeighbor, BorderMode::Soft, scaledBounds);
+        AssertColorsEqual(OpaqueRed, scaled.GetPixel(1, 1));
+        AssertColorsEqual(OpaqueBlue, scaled.GetPixel(2, 0));
+
+        // A half pixel shift with linear filtering averages neighbors, and fades out at soft edges.
+        float halfPixel[6] = { 1, 0, 0, 1, 0.5f, 0 };
+
+        auto shifted = Transform(input, input.GetBounds(), halfPixel, InterpolationMode::Linear, BorderMode::Soft, CpuRect{ 0, 0, 3, 1 });
+        AssertColorsEqual(CpuColor{ 0.5f, 0, 0, 0.5f }, shifted.GetPixel(0, 0));
+        AssertColorsEqual(CpuColor{ 0.5f, 0, 0.5f, 1 }, shifted.GetPixel(1, 0));
+        AssertColorsEqual(CpuColor{ 0, 0, 0.5f, 0.5f }, shifted.GetPixel(2, 0));
+
+        // Singular matrices produce nothing.
+        float singular[6] = { 0, 0, 0, 0, 0, 0 };
+        Assert::IsTrue(GetTransformBounds(input.GetBounds(), singular).IsEmpty());
+    }
+
+    TEST_METHOD_EX(CpuEffectKernels_Border)
+    {
+        CpuImage input(CpuRect{ 0, 0, 2, 1 });
+        input.SetPixel(0, 0, OpaqueRed);
+        input.SetPixel(1, 0, OpaqueBlue);
+
+        auto outputRect = CpuRect{ -2, -1, 4, 2 };
+
+        auto clamp = Border(input, input.GetBounds(), EdgeMode::Clamp, EdgeMode::Clamp, outputRect);
+        AssertColorsEqual(OpaqueRed, clamp.GetPixel(-2, -1));
+        AssertColorsEqual(OpaqueBlue, clamp.GetPixel(3, 1));
+
+        auto wrap = Border(input, input.GetBounds(), EdgeMode::Wrap, EdgeMode::Clamp, outputRect);
+        AssertColorsEqual(OpaqueRed, wrap.GetPixel(-2, 0));
+        AssertColorsEqual(OpaqueBlue, wrap.GetPixel(-1, 0));
+        AssertColorsEqual(OpaqueRed, wrap.GetPixel(2, 0));
+
+        auto mirror = Border(input, input.GetBounds(), EdgeMode::Mirror, EdgeMode::Clamp, outputRect);
+        AssertColorsEqual(OpaqueBlue, mirror.GetPixel(-2, 0));
+        AssertColorsEqual(OpaqueRed, mirror.GetPixel(-1, 0));
+        AssertColorsEqual(OpaqueBlue, mirror.GetPixel(2, 0));
+        AssertColorsEqual(OpaqueRed, mirror.GetPixel(3, 0));
+    }
+
+    TEST_METHOD_EX(CpuEffectKernels_GetBorderSourceRects)
+    {
+        auto inputBounds = CpuRect{ 0, 0, 100, 100 };
+
+        auto assertRects = [&](std::vector<CpuRect> const& expected, CpuRect const& outputRect, EdgeMode edgeModeX, EdgeMode edgeModeY)
+        {
+            auto rects = GetBorderSourceRects(outputRect, inputBounds, edgeModeX, edgeModeY);
+
+            Assert::AreEqual(expected.size(), rects.size());
+
+            for (size_t i = 0; i < rects.size(); i++)
+            {
+                Assert::IsTrue(expected[i] == rects[i]);
+            }
+        };
+
+        // Regions inside the input only read what they overlap.
+        assertRects({ CpuRect{ 10, 10, 20, 20 } }, CpuRect{ 10, 10, 20, 20 }, EdgeMode::Wrap, EdgeMode::Mirror);
+
+        // Clamping reads the nearest edge.
+        assertRects({ CpuRect{ 0, 10, 5, 20 } }, CpuRect{ -5, 10, 5, 20 }, EdgeMode::Clamp, EdgeMode::Clamp);
+        assertRects({ CpuRect{ 99, 99, 100, 100 } }, CpuRect{ 150, 150, 160, 160 }, EdgeMode::Clamp, EdgeMode::Clamp);
+
+        // Wrapping reads a strip from the far edge.
+        assertRects({ CpuRect{ 0, 10, 5, 20 }, CpuRect{ 95, 10, 100, 20 } }, CpuRect{ -5, 10, 5, 20 }, EdgeMode::Wrap, EdgeMode::Clamp);
+
+        // Mirroring reads the same strip twice.
+        assertRects({ CpuRect{ 0, 10, 5, 20 } }, CpuRect{ -5, 10, 5, 20 }, EdgeMode::Mirror, EdgeMode::Clamp);
+
+        // Wrapping in both directions reads all four corners.
+        assertRects(
+            {
+                CpuRect{ 0,  0,  5,   5   },
+                CpuRect{ 95, 0,  100, 5   },
+                CpuRect{ 0,  95, 5,   100 },
+                CpuRect{ 95, 95, 100, 100 },
+            },
+            CpuRect{ -5, -5, 5, 5 }, EdgeMode::Wrap, EdgeMode::Wrap);
+
+        // Regions at least a period wide need the whole input.
+        assertRects({ CpuRect{ 0, 10, 100, 20 } }, CpuRect{ 1000, 10, 1100, 20 }, EdgeMode::Wrap, EdgeMode::Clamp);
+
+        assertRects({}, CpuRect::Empty(), EdgeMode::Wrap, EdgeMode::Wrap);
+
+        inputBounds = CpuRect::Empty();
+        assertRects({}, CpuRect{ 0, 0, 10, 10 }, EdgeMode::Wrap, EdgeMode::Wrap);
+    }
+
+    TEST_METHOD_EX(CpuEffectKernels_Opacity)
+    {
+        auto image = MakeSolidImage(CpuRect{ 0, 0, 2, 2 }, OpaqueRed);
+
+        Opacity(image, 0.25f);
+
+        AssertColorsEqual(CpuColor{ 0.25f, 0, 0, 0.25f }, image.GetPixel(1, 1));
+    }
+
+    TEST_METHOD_EX(CpuEffectKernels_Bgra8RoundTrip)
+    {
+        uint8_t pixels[] =
+        {
+            255, 0, 0, 255,     128, 64, 0, 128,
+            0, 0, 0, 0,         10, 20, 30, 40,
+        };
+
+        auto image = FromBgra8(pixels, 2, 2, 8, true);
+
+        AssertColorsEqual(OpaqueBlue, image.GetPixel(0, 0));
+
+        auto bytes = ToBgra8(image);
+
+        Assert::AreEqual(sizeof(pixels), bytes.size());
+        Assert::IsTrue(memcmp(pixels, bytes.data(), sizeof(pixels)) == 0);
+
+        // Straight alpha input is premultiplied.
+        uint8_t straight[] = { 255, 255, 255, 51 };
+
+        AssertColorsEqual(CpuColor{ 0.2f, 0.2f, 0.2f, 0.2f }, FromBgra8(straight, 1, 1, 4, false).GetPixel(0, 0));
+    }
+};
+
+
+TEST_CLASS(CpuEffectRendererUnitTests)
+{
+    class TestImageSource : public RuntimeClass<IGraphicsEffectSource>
+    {
+        InspectableClass(L"TestImageSource", BaseTrust);
+
+    public:
+        CpuImage Image;
+
+        TestImageSource(CpuImage const& image)
+            : Image(image)
+        { }
+    };
+
+    static CpuEffectRenderer MakeRenderer()
+    {
+        return CpuEffectRenderer(
+            [](IGraphicsEffectSource* source, CpuEffectRenderer::SourceReader* reader)
+            {
+                auto testSource = dynamic_cast<TestImageSource*>(source);
+
+                if (!testSource)
+                    return false;
+
+                *reader = CpuEffectRenderer::SourceReader::FromImage(testSource->Image);
+                return true;
+            });
+    }
+
+public:
+    TEST_METHOD_EX(CpuEffectRenderer_RendersGraphUsingEffectProperties)
+    {
+        CpuImage pixels(CpuRect{ 0, 0, 4, 4 });
+        pixels.SetPixel(1, 1, OpaqueRed);
+        pixels.SetPixel(2, 2, OpaqueBlue);
+
+        auto image = Make<TestImageSource>(pixels);
+
+        auto transform = Make<Transform2DEffect>();
+        ThrowIfFailed(transform->put_Source(image.Get()));
+        ThrowIfFailed(transform->put_TransformMatrix(Numerics::Matrix3x2{ 1, 0, 0, 1, 10, 20 }));
+
+        auto blur = Make<GaussianBlurEffect>();
+        ThrowIfFailed(blur->put_Source(transform.Get()));
+        ThrowIfFailed(blur->put_BlurAmount(1.5f));
+
+        auto crop = Make<CropEffect>();
+        ThrowIfFailed(crop->put_Source(blur.Get()));
+        ThrowIfFailed(crop->put_SourceRectangle(Rect{ 10, 20, 3, 4 }));
+
+        auto renderer = MakeRenderer();
+
+        Assert::IsTrue(CpuEffectRenderer::IsSupported(crop.Get()));
+        Assert::IsTrue(CpuRect{ 10, 20, 13, 24 } == renderer.GetBounds(crop.Get()));
+
+        auto output = renderer.Render(crop.Get());
+
+        // Evaluate the same graph by calling the kernels directly.
+        float matrix[6] = { 1, 0, 0, 1, 10, 20 };
+        float cropRect[4] = { 10, 20, 13, 24 };
+
+        auto transformed = Transform(pixels, pixels.GetBounds(), matrix, InterpolationMode::Linear, BorderMode::Soft, CpuRect{ 0, 0, 20, 30 });
+        auto expected = GaussianBlur(transformed, transformed.GetBounds(), 1.5f, BorderMode::Soft, CpuRect{ 10, 20, 13, 24 });
+        Crop(expected, cropRect, BorderMode::Soft);
+
+        AssertImagesEqual(expected, output);
+    }
+
+    TEST_METHOD_EX(CpuEffectRenderer_CompositeDrawsSourcesInOrder)
+    {
+        auto bottom = Make<TestImageSource>(MakeSolidImage(CpuRect{ 0, 0, 2, 2 }, OpaqueRed));
+        auto top = Make<TestImageSource>(MakeSolidImage(CpuRect{ 1, 1, 3, 3 }, OpaqueBlue));
+
+        auto composite = Make<CompositeEffect>();
+
+        ComPtr<IVector<IGraphicsEffectSource*>> sources;
+        ThrowIfFailed(composite->get_Sources(&sources));
+        ThrowIfFailed(sources->Append(bottom.Get()));
+        ThrowIfFailed(sources->Append(top.Get()));
+
+        auto output = MakeRenderer().Render(composite.Get());
+
+        Assert::IsTrue(CpuRect{ 0, 0, 3, 3 } == output.GetBounds());
+
+        AssertColorsEqual(OpaqueRed, output.GetPixel(0, 0));
+        AssertColorsEqual(OpaqueBlue, output.GetPixel(1, 1));
+        AssertColorsEqual(OpaqueBlue, output.GetPixel(2, 2));
+        AssertColorsEqual(Transparent, output.GetPixel(2, 0));
+    }
+
+    TEST_METHOD_EX(CpuEffectRenderer_SharedSourceIsOnlyResolvedOnce)
+    {
+        auto image = Make<TestImageSource>(MakeSolidImage(CpuRect{ 0, 0, 1, 1 }, HalfGreen));
+
+        auto blend = Make<BlendEffect>();
+        ThrowIfFailed(blend->put_Background(image.Get()));
+        ThrowIfFailed(blend->put_Foreground(image.Get()));
+        ThrowIfFailed(blend->put_Mode(BlendEffectMode::Multiply));
+
+        int resolveCount = 0;
+
+        CpuEffectRenderer renderer(
+            [&](IGraphicsEffectSource* source, CpuEffectRenderer::SourceReader* reader)
+            {
+                resolveCount++;
+                *reader = CpuEffectRenderer::SourceReader::FromImage(dynamic_cast<TestImageSource*>(source)->Image);
+                return true;
+            });
+
+        auto output = renderer.Render(blend.Get());
+
+        Assert::AreEqual(1, resolveCount);
+        AssertColorsEqual(CpuColor{ 0, 0.75f, 0, 0.75f }, output.GetPixel(0, 0));
+    }
+
+    static CpuEffectRenderer MakeRecordingRenderer(std::vector<CpuRect>& regionsRead, std::mutex& mutex)
+    {
+        return CpuEffectRenderer(
+            [&](IGraphicsEffectSource* source, CpuEffectRenderer::SourceReader* reader)
+            {
+                auto testSource = dynamic_cast<TestImageSource*>(source);
+
+                if (!testSource)
+                    return false;
+
+                reader->Bounds = testSource->Image.GetBounds();
+                reader->Read = [&, testSource](CpuRect const& region)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    regionsRead.push_back(region);
+                    return testSource->Image.Copy(region);
+                };
+
+                return true;
+            });
+    }
+
+    TEST_METHOD_EX(CpuEffectRenderer_Border_OnlyReadsSampledRegions)
+    {
+        auto bounds = CpuRect{ 0, 0, 100, 100 };
+
+        CpuImage pixels(bounds);
+
+        for (int y = 0; y < 100; y++)
+        {
+            for (int x = 0; x < 100; x++)
+            {
+                pixels.SetPixel(x, y, CpuColor{ x / 100.0f, y / 100.0f, 0, 1 });
+            }
+        }
+
+        auto border = Make<BorderEffect>();
+        ThrowIfFailed(border->put_Source(Make<TestImageSource>(pixels).Get()));
+        ThrowIfFailed(border->put_ExtendX(CanvasEdgeBehavior::Wrap));
+        ThrowIfFailed(border->put_ExtendY(CanvasEdgeBehavior::Mirror));
+
+        std::mutex mutex;
+        std::vector<CpuRect> regionsRead;
+
+        auto renderer = MakeRecordingRenderer(regionsRead, mutex);
+
+        // A region inside the source only reads the pixels under it.
+        auto inside = CpuRect{ 10, 10, 20, 20 };
+
+        AssertImagesEqual(Border(pixels, bounds, EdgeMode::Wrap, EdgeMode::Mirror, inside), renderer.Render(border.Get(), inside));
+
+        Assert::AreEqual<size_t>(1, regionsRead.size());
+        Assert::IsTrue(inside == regionsRead[0]);
+
+        // A region across the left edge reads that edge, plus a strip from the right edge.
+        regionsRead.clear();
+
+        auto acrossEdge = CpuRect{ -5, 10, 5, 20 };
+
+        AssertImagesEqual(Border(pixels, bounds, EdgeMode::Wrap, EdgeMode::Mirror, acrossEdge), renderer.Render(border.Get(), acrossEdge));
+
+        Assert::AreEqual<size_t>(2, regionsRead.size());
+        Assert::IsTrue(CpuRect{ 0, 10, 5, 20 } == regionsRead[0]);
+        Assert::IsTrue(CpuRect{ 95, 10, 100, 20 } == regionsRead[1]);
+
+        // A region far outside the source reads no more than its own size.
+        regionsRead.clear();
+
+        auto outside = CpuRect{ 1030, -260, 1050, -250 };
+
+        AssertImagesEqual(Border(pixels, bounds, EdgeMode::Wrap, EdgeMode::Mirror, outside), renderer.Render(border.Get(), outside));
+
+        int pixelsRead = 0;
+
+        for (auto& region : regionsRead)
+        {
+            pixelsRead += region.Width() * region.Height();
+        }
+
+        Assert::IsTrue(pixelsRead <= outside.Width() * outside.Height());
+    }
+
+    TEST_METHOD_EX(CpuEffectRenderer_SharedEffectIsRenderedOncePerRegion)
+    {
+        auto image = Make<TestImageSource>(MakeSolidImage(CpuRect{ 0, 0, 8, 8 }, HalfGreen));
+
+        auto transform = Make<Transform2DEffect>();
+        ThrowIfFailed(transform->put_Source(image.Get()));
+        ThrowIfFailed(transform->put_TransformMatrix(Numerics::Matrix3x2{ 1, 0, 0, 1, 2, 0 }));
+
+        auto blend = Make<BlendEffect>();
+        ThrowIfFailed(blend->put_Background(transform.Get()));
+        ThrowIfFailed(blend->put_Foreground(transform.Get()));
+        ThrowIfFailed(blend->put_Mode(BlendEffectMode::Multiply));
+
+        std::mutex mutex;
+        std::vector<CpuRect> regionsRead;
+
+        auto renderer = MakeRecordingRenderer(regionsRead, mutex);
+
+        auto output = renderer.Render(blend.Get());
+
+        Assert::AreEqual<size_t>(1, regionsRead.size());
+        AssertColorsEqual(CpuColor{ 0, 0.75f, 0, 0.75f }, output.GetPixel(5, 5));
+
+        // Results are not kept between tiles, but each tile still evaluates the shared effect once.
+        regionsRead.clear();
+
+        renderer.RenderTiles(blend.Get(), output.GetBounds(), 5, 8, [](CpuImage const&) {});
+
+        Assert::AreEqual<size_t>(2, regionsRead.size());
+    }
+
+    TEST_METHOD_EX(CpuEffectRenderer_RenderTiles_MatchesSingleRender)
+    {
+        CpuImage pixels(CpuRect{ 0, 0, 16, 12 });
+
+        for (int y = 0; y < 12; y++)
+        {
+            for (int x = 0; x < 16; x++)
+            {
+                pixels.SetPixel(x, y, CpuColor{ x / 16.0f, y / 12.0f, 0, 1 });
+            }
+        }
+
+        auto image = Make<TestImageSource>(pixels);
+
+        auto blur = Make<GaussianBlurEffect>();
+        ThrowIfFailed(blur->put_Source(image.Get()));
+        ThrowIfFailed(blur->put_BlurAmount(1.0f));
+
+        std::mutex mutex;
+        std::vector<CpuRect> regionsRead;
+
+        CpuEffectRenderer renderer(
+            [&](IGraphicsEffectSource* source, CpuEffectRenderer::SourceReader* reader)
+            {
+                auto testSource = dynamic_cast<TestImageSource*>(source);
+
+                reader->Bounds = testSource->Image.GetBounds();
+                reader->Read = [&, testSource](CpuRect const& region)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    regionsRead.push_back(region);
+                    return testSource->Image.Copy(region);
+                };
+
+                return true;
+            });
+
+        auto expected = renderer.Render(blur.Get());
+
+        auto bounds = expected.GetBounds();
+
+        regionsRead.clear();
+
+        CpuImage assembled(bounds);
+        std::vector<CpuRect> tiles;
+
+        renderer.RenderTiles(blur.Get(), bounds, 5, 4,
+            [&](CpuImage const& tile)
+            {
+                tiles.push_back(tile.GetBounds());
+
+                auto& tileBounds = tile.GetBounds();
+
+                for (int y = tileBounds.Top; y < tileBounds.Bottom; y++)
+                {
+                    for (int x = tileBounds.Left; x < tileBounds.Right; x++)
+                    {
+                        assembled.SetPixel(x, y, tile.GetPixel(x, y));
+                    }
+                }
+            });
+
+        AssertImagesEqual(expected, assembled);
+
+        // Tiles arrive in raster order, clipped to the requested region.
+        Assert::IsTrue(CpuRect{ bounds.Left, bounds.Top, bounds.Left + 5, bounds.Top + 4 } == tiles.front());
+        Assert::IsTrue(CpuRect{ bounds.Left + 20, bounds.Top + 16, bounds.Right, bounds.Bottom } == tiles.back());
+
+        for (size_t i = 1; i < tiles.size(); i++)
+        {
+            Assert::IsTrue(tiles[i - 1].Top < tiles[i].Top || (tiles[i - 1].Top == tiles[i].Top && tiles[i - 1].Left < tiles[i].Left));
+        }
+
+        // Each tile only reads the part of the source it depends on, plus the blur radius.
+        auto radius = GetGaussianBlurRadius(1.0f);
+
+        Assert::AreEqual(tiles.size(), regionsRead.size());
+
+        for (auto& region : regionsRead)
+        {
+            Assert::IsTrue(region.Width() <= 5 + radius * 2);
+            Assert::IsTrue(region.Height() <= 4 + radius * 2);
+        }
+    }
+
+    TEST_METHOD_EX(CpuEffectRenderer_RenderTiles_InvalidArguments)
+    {
+        auto image = Make<TestImageSource>(MakeSolidImage(CpuRect{ 0, 0, 1, 1 }, OpaqueRed));
+        auto renderer = MakeRenderer();
+        auto sink = [](CpuImage const&) {};
+
+        ExpectHResultException(E_INVALIDARG, [&] { renderer.RenderTiles(image.Get(), CpuRect::Infinite(), 16, 16, sink); });
+        ExpectHResultException(E_INVALIDARG, [&] { renderer.RenderTiles(image.Get(), CpuRect{ 0, 0, 1, 1 }, 0, 16, sink); });
+        ExpectHResultException(E_INVALIDARG, [&] { renderer.RenderTiles(image.Get(), CpuRect{ 0, 0, 1, 1 }, 16, -1, sink); });
+        ExpectHResultException(E_INVALIDARG, [&] { renderer.RenderTiles(image.Get(), CpuRect{ 0, 0, 1, 1 }, 16, 16, nullptr); });
+    }
+
+    TEST_METHOD_EX(CpuEffectRenderer_InfiniteGraphRequiresRegion)
+    {
+        CpuImage pixels(CpuRect{ 0, 0, 2, 1 });
+        pixels.SetPixel(0, 0, OpaqueRed);
+        pixels.SetPixel(1, 0, OpaqueBlue);
+
+        auto border = Make<BorderEffect>();
+        ThrowIfFailed(border->put_Source(Make<TestImageSource>(pixels).Get()));
+        ThrowIfFailed(border->put_ExtendX(CanvasEdgeBehavior::Wrap));
+
+        auto renderer = MakeRenderer();
+
+        Assert::IsTrue(renderer.GetBounds(border.Get()).IsInfinite());
+
+        ExpectHResultException(E_INVALIDARG, [&] { renderer.Render(border.Get()); });
+
+        auto output = renderer.Render(border.Get(), CpuRect{ 100, 100, 102, 101 });
+
+        AssertColorsEqual(OpaqueRed, output.GetPixel(100, 100));
+        AssertColorsEqual(OpaqueBlue, output.GetPixel(101, 100));
+    }
+
+    TEST_METHOD_EX(CpuEffectRenderer_UnsupportedGraphs)
+    {
+        auto image = Make<TestImageSource>(MakeSolidImage(CpuRect{ 0, 0, 1, 1 }, OpaqueRed));
+        auto renderer = MakeRenderer();
+
+        // Effect types without a CPU implementation.
+        auto saturation = Make<SaturationEffect>();
+        ThrowIfFailed(saturation->put_Source(image.Get()));
+
+        auto blur = Make<GaussianBlurEffect>();
+        ThrowIfFailed(blur->put_Source(saturation.Get()));
+
+        Assert::IsFalse(CpuEffectRenderer::IsSupported(blur.Get()));
+        ExpectHResultException(E_NOTIMPL, [&] { renderer.Render(blur.Get()); });
+
+        // Supported effect types with unsupported modes.
+        auto blend = Make<BlendEffect>();
+        ThrowIfFailed(blend->put_Background(image.Get()));
+        ThrowIfFailed(blend->put_Foreground(image.Get()));
+        ThrowIfFailed(blend->put_Mode(BlendEffectMode::Dissolve));
+
+        Assert::IsFalse(CpuEffectRenderer::IsSupported(blend.Get()));
+        ExpectHResultException(E_NOTIMPL, [&] { renderer.Render(blend.Get()); });
+
+        // Sources that the renderer cannot read.
+        auto unknownSource = Make<GaussianBlurEffect>();
+        ThrowIfFailed(unknownSource->put_Source(image.Get()));
+
+        ExpectHResultException(E_NOTIMPL, [&] { CpuEffectRenderer().Render(unknownSource.Get()); });
+
+        // Null sources.
+        ExpectHResultException(E_INVALIDARG, [&] { renderer.Render(Make<GaussianBlurEffect>().Get()); });
+    }
+};
@@ -0,0 +1,309 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+static D2D1_PIXEL_FORMAT const Bgra = D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED);
+
+static ComPtr<MockD2DBitmap> MakeBitmap(uint32_t width, uint32_t height, D2D1_PIXEL_FORMAT format = Bgra)
+{
+    auto bitmap = Make<MockD2DBitmap>();
+
+    bitmap->GetPixelSizeMethod.AllowAnyCall(
+        [=]
+        {
+            return D2D1_SIZE_U{ width, height };
+        });
+
+    bitmap->GetPixelFormatMethod.AllowAnyCall(
+        [=]
+        {
+            return format;
+        });
+
+    return bitmap;
+}
+
+
+//
+// Bitmap adapter that counts how many streams it is asked to decode.
+//
+class CountingBitmapAdapter : public TestBitmapAdapter
+{
+public:
+    int StreamDecodeCount;
+
+    CountingBitmapAdapter()
+        : TestBitmapAdapter(Make<MockWICFormatConverter>())
+        , StreamDecodeCount(0)
+    {
+    }
+
+    virtual WicBitmapSource CreateWicBitmapSource(ICanvasDevice* device, IStream* fileStream, bool tryEnableIndexing) override
+    {
+        StreamDecodeCount++;
+
+        return TestBitmapAdapter::CreateWicBitmapSource(device, HStringReference(L"stream").Get(), tryEnableIndexing);
+    }
+};
+
+
+//
+// Stream over a fixed array of bytes.
+//
+class StubStream : public MockStream
+{
+    std::vector<BYTE> m_contents;
+    size_t m_position;
+
+public:
+    StubStream(std::vector<BYTE> const& contents)
+        : m_contents(contents)
+        , m_position(0)
+    {
+        SeekMethod.AllowAnyCall(
+            [=](LARGE_INTEGER offset, DWORD origin, ULARGE_INTEGER* newPosition)
+            {
+                Assert::AreEqual<DWORD>(STREAM_SEEK_SET, origin);
+
+                m_position = static_cast<size_t>(offset.QuadPart);
+
+                if (newPosition)
+                    newPosition->QuadPart = m_position;
+
+                return S_OK;
+            });
+
+        ReadMethod.AllowAnyCall(
+            [=](void* buffer, ULONG size, ULONG* bytesRead)
+            {
+                auto count = std::min(static_cast<size_t>(size), m_contents.size() - m_position);
+
+                memcpy(buffer, m_contents.data() + m_position, count);
+                m_position += count;
+
+                *bytesRead = static_cast<ULONG>(count);
+                return S_OK;
+            });
+    }
+};
+
+
+TEST_CLASS(DecodedBitmapCacheUnitTests)
+{
+public:
+    TEST_METHOD_EX(DecodedBitmapCache_GetBitmapBytes)
+    {
+        Assert::AreEqual<uint64_t>(64 * 32 * 4, DecodedBitmapCache::GetBitmapBytes(MakeBitmap(64, 32).Get()));
+
+        // Block compressed formats are 8 or 16 bytes per 4x4 block.
+        auto bc1 = D2D1::PixelFormat(DXGI_FORMAT_BC1_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED);
+        Assert::AreEqual<uint64_t>(16 * 8 * 8, DecodedBitmapCache::GetBitmapBytes(MakeBitmap(64, 32, bc1).Get()));
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_Find_ReturnsNullUntilAdded)
+    {
+        DecodedBitmapCache cache;
+
+        Assert::IsNull(cache.Find(L"a").Get());
+
+        auto bitmap = MakeBitmap(16, 16);
+        auto added = cache.Add(L"a", bitmap.Get());
+
+        Assert::IsTrue(IsSameInstance(bitmap.Get(), added.Get()));
+        Assert::IsTrue(IsSameInstance(bitmap.Get(), cache.Find(L"a").Get()));
+        Assert::IsNull(cache.Find(L"b").Get());
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_Statistics_CountHitsMissesAndBytesSaved)
+    {
+        DecodedBitmapCache cache;
+
+        cache.Find(L"a");
+        cache.Add(L"a", MakeBitmap(16, 16).Get());
+        cache.Find(L"a");
+        cache.Find(L"a");
+        cache.Find(L"b");
+
+        auto statistics = cache.GetStatistics();
+
+        Assert::AreEqual<uint64_t>(2, statistics.Hits);
+        Assert::AreEqual<uint64_t>(2, statistics.Misses);
+        Assert::AreEqual<uint64_t>(0, statistics.BitmapsEvicted);
+        Assert::AreEqual<uint64_t>(2 * 16 * 16 * 4, statistics.BytesSaved);
+        Assert::AreEqual(1u, statistics.CachedBitmapCount);
+        Assert::AreEqual<uint64_t>(16 * 16 * 4, statistics.CachedBytes);
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_Add_WhenKeyAlreadyCached_ReturnsExistingBitmap)
+    {
+        DecodedBitmapCache cache;
+
+        auto first = MakeBitmap(16, 16);
+        auto second = MakeBitmap(16, 16);
+
+        cache.Add(L"a", first.Get());
+        auto added = cache.Add(L"a", second.Get());
+
+        Assert::IsTrue(IsSameInstance(first.Get(), added.Get()));
+        Assert::AreEqual(1u, cache.GetStatistics().CachedBitmapCount);
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_Add_EvictsLeastRecentlyUsed)
+    {
+        uint64_t const bitmapBytes = 16 * 16 * 4;
+
+        DecodedBitmapCache cache(bitmapBytes * 3);
+
+        cache.Add(L"a", MakeBitmap(16, 16).Get());
+        cache.Add(L"b", MakeBitmap(16, 16).Get());
+        cache.Add(L"c", MakeBitmap(16, 16).Get());
+
+        // Using a makes b the least recently used.
+        cache.Find(L"a");
+
+        cache.Add(L"d", MakeBitmap(16, 16).Get());
+
+        Assert::IsNull(cache.Find(L"b").Get());
+        Assert::IsNotNull(cache.Find(L"a").Get());
+        Assert::IsNotNull(cache.Find(L"c").Get());
+        Assert::IsNotNull(cache.Find(L"d").Get());
+
+        auto statistics = cache.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.BitmapsEvicted);
+        Assert::AreEqual<uint64_t>(bitmapBytes * 3, statistics.CachedBytes);
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_Add_BitmapLargerThanMaximum_IsNotCached)
+    {
+        DecodedBitmapCache cache(16 * 16 * 4);
+
+        cache.Add(L"a", MakeBitmap(16, 16).Get());
+
+        auto bitmap = MakeBitmap(32, 32);
+        auto added = cache.Add(L"b", bitmap.Get());
+
+        Assert::IsTrue(IsSameInstance(bitmap.Get(), added.Get()));
+        Assert::IsNull(cache.Find(L"b").Get());
+
+        // The existing bitmap was not evicted to make room for it.
+        Assert::IsNotNull(cache.Find(L"a").Get());
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_SetMaximumBytes_TrimsToNewSize)
+    {
+        DecodedBitmapCache cache;
+
+        cache.Add(L"a", MakeBitmap(16, 16).Get());
+        cache.Add(L"b", MakeBitmap(16, 16).Get());
+        cache.Add(L"c", MakeBitmap(16, 16).Get());
+
+        cache.SetMaximumBytes(16 * 16 * 4);
+
+        Assert::AreEqual<uint64_t>(16 * 16 * 4, cache.GetMaximumBytes());
+        Assert::AreEqual(1u, cache.GetStatistics().CachedBitmapCount);
+        Assert::IsNotNull(cache.Find(L"c").Get());
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_Clear_KeepsStatistics)
+    {
+        DecodedBitmapCache cache;
+
+        cache.Add(L"a", MakeBitmap(16, 16).Get());
+        cache.Find(L"a");
+        cache.Clear();
+
+        auto statistics = cache.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.Hits);
+        Assert::AreEqual(0u, statistics.CachedBitmapCount);
+        Assert::AreEqual<uint64_t>(0, statistics.CachedBytes);
+
+        Assert::IsNull(cache.Find(L"a").Get());
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_Close_StopsCaching)
+    {
+        DecodedBitmapCache cache;
+
+        cache.Add(L"a", MakeBitmap(16, 16).Get());
+        cache.Close();
+
+        Assert::IsNull(cache.Find(L"a").Get());
+
+        auto bitmap = MakeBitmap(16, 16);
+        auto added = cache.Add(L"b", bitmap.Get());
+
+        Assert::IsTrue(IsSameInstance(bitmap.Get(), added.Get()));
+        Assert::IsNull(cache.Find(L"b").Get());
+    }
+
+    struct CachedLoadFixture
+    {
+        std::shared_ptr<CountingBitmapAdapter> Adapter;
+        ComPtr<StubCanvasDevice> Device;
+
+        CachedLoadFixture()
+            : Adapter(std::make_shared<CountingBitmapAdapter>())
+            , Device(Make<StubCanvasDevice>())
+        {
+            CanvasBitmapAdapter::SetInstance(Adapter);
+
+            Device->MockCreateBitmapFromWicResource =
+                [](IWICBitmapSource*, CanvasAlphaMode, float dpi) -> ComPtr<ID2D1Bitmap1>
+                {
+                    auto bitmap = Make<StubD2DBitmap>(D2D1_BITMAP_OPTIONS_NONE, dpi);
+
+                    bitmap->GetPixelSizeMethod.AllowAnyCall(
+                        []
+                        {
+                            return D2D1_SIZE_U{ 16, 16 };
+                        });
+
+                    bitmap->GetPixelFormatMethod.AllowAnyCall(
+                        []
+                        {
+                            return Bgra;
+                        });
+
+                    return bitmap;
+                };
+        }
+
+        ComPtr<ICanvasBitmap> Load(std::vector<BYTE> const& contents, float dpi = DEFAULT_DPI)
+        {
+            auto stream = Make<StubStream>(contents);
+
+            return CanvasBitmap::GetOrCreateCached(Device.Get(), stream.Get(), dpi, CanvasAlphaMode::Premultiplied);
+        }
+    };
+
+    TEST_METHOD_EX(DecodedBitmapCache_GetOrCreateCached_SameStreamContents_DecodesOnce)
+    {
+        CachedLoadFixture f;
+
+        auto first = f.Load({ 1, 2, 3 });
+        auto second = f.Load({ 1, 2, 3 });
+
+        Assert::AreEqual(1, f.Adapter->StreamDecodeCount);
+        Assert::IsTrue(IsSameInstance(first.Get(), second.Get()));
+
+        auto statistics = f.Device->GetDecodedBitmapCacheStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.Hits);
+        Assert::AreEqual<uint64_t>(1, statistics.Misses);
+        Assert::AreEqual<uint64_t>(16 * 16 * 4, statistics.BytesSaved);
+    }
+
+    TEST_METHOD_EX(DecodedBitmapCache_GetOrCreateCached_DifferentContentsOrDpi_DecodesAgain)
+    {
+        CachedLoadFixture f;
+
+        auto first = f.Load({ 1, 2, 3 });
+        auto differentContents = f.Load({ 1, 2, 4 });
+        auto differentDpi = f.Load({ 1, 2, 3 }, DEFAULT_DPI * 2);
+
+        Assert::AreEqual(3, f.Adapter->StreamDecodeCount);
+        Assert::IsFalse(IsSameInstance(first.Get(), differentContents.Get()));
+        Assert::IsFalse(IsSameInstance(first.Get(), differentDpi.Get()));
+    }
+};
@@ -33,9 +33,9 @@ public:
         CALL_COUNTER(CreateDeviceContextMethod);
         int NumberOfActiveDeviceContexts;
 
-        Fixture()
+        Fixture(unsigned maximumSize = DeviceContextPool::GetDefaultMaximumSize())
             : Device(Make<MockD2DDevice>())
-            , Pool(Device.Get())
+            , Pool(Device.Get(), maximumSize)
             , NumberOfActiveDeviceContexts(0)
         {
             Device->MockCreateDeviceContext =
@@ -131,6 +131,144 @@ public:
         Assert::AreEqual<int>(std::thread::hardware_concurrency(), f.NumberOfActiveDeviceContexts);
     }
 
+    TEST_METHOD_EX(DeviceContextPool_MaximumSizeIsConfigurable)
+    {
+        Fixture f(3);
+
+        Assert::AreEqual(3u, f.Pool.GetMaximumSize());
+
+        f.PopulatePool();
+
+        Assert::AreEqual(3, f.NumberOfActiveDeviceContexts);
+    }
+
+    TEST_METHOD_EX(DeviceContextPool_WhenMaximumSizeIsZero_ContextsAreNotReused)
+    {
+        Fixture f(0);
+
+        f.CreateDeviceContextMethod.SetExpectedCalls(3);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            auto lease = f.Pool.TakeLease();
+
+            Assert::AreEqual(1, f.NumberOfActiveDeviceContexts);
+        }
+
+        Assert::AreEqual(0, f.NumberOfActiveDeviceContexts);
+    }
+
+    TEST_METHOD_EX(DeviceContextPool_DefaultMaximumSize_IsNumberOfCpus)
+    {
+        Assert::AreEqual(std::max(std::thread::hardware_concurrency(), 1U), DeviceContextPool::GetDefaultMaximumSize());
+    }
+
+    TEST_METHOD_EX(DeviceContextPool_WhenDestroyed_PooledContextsAreReleased)
+    {
+        auto device = Make<MockD2DDevice>();
+        int numberOfActiveDeviceContexts = 0;
+
+        device->MockCreateDeviceContext =
+            [&] (D2D1_DEVICE_CONTEXT_OPTIONS, ID2D1DeviceContext1** deviceContext)
+            {
+                auto mockDeviceContext = Make<CountedD2DDeviceContext>(&numberOfActiveDeviceContexts);
+                mockDeviceContext.CopyTo(deviceContext);
+            };
+
+        {
+            DeviceContextPool pool(device.Get(), 2);
+
+            auto lease1 = pool.TakeLease();
+            auto lease2 = pool.TakeLease();
+        }
+
+        Assert::AreEqual(0, numberOfActiveDeviceContexts);
+    }
+
+    TEST_METHOD_EX(DeviceContextPool_Prewarm_CreatesContextsUpFront)
+    {
+        Fixture f(3);
+
+        f.CreateDeviceContextMethod.SetExpectedCalls(2);
+        f.Pool.Prewarm(2);
+
+        Assert::AreEqual(2, f.NumberOfActiveDeviceContexts);
+
+        // Taking leases uses the prewarmed contexts rather than creating more.
+        {
+            auto lease1 = f.Pool.TakeLease();
+            auto lease2 = f.Pool.TakeLease();
+
+            Assert::AreNotEqual(lease1.Get(), lease2.Get());
+        }
+
+        // Prewarming again only tops the pool up to the requested count.
+        f.Pool.Prewarm(2);
+
+        f.CreateDeviceContextMethod.SetExpectedCalls(1);
+        f.Pool.Prewarm(100);
+
+        Assert::AreEqual(3, f.NumberOfActiveDeviceContexts);
+    }
+
+    TEST_METHOD_EX(DeviceContextPool_WhenClosed_Prewarm_Fails)
+    {
+        Fixture f;
+        f.Pool.Close();
+
+        ExpectHResultException(RO_E_CLOSED, [&] { f.Pool.Prewarm(1); });
+    }
+
+    TEST_METHOD_EX(DeviceContextPool_Statistics)
+    {
+        Fixture f(2);
+
+        f.CreateDeviceContextMethod.SetExpectedCalls(3);
+
+        auto statistics = f.Pool.GetStatistics();
+
+        Assert::AreEqual(0ull, statistics.LeasesTaken);
+        Assert::AreEqual(0.0, statistics.AverageLeaseMicroseconds);
+
+        {
+            auto lease1 = f.Pool.TakeLease();
+            auto lease2 = f.Pool.TakeLease();
+            auto lease3 = f.Pool.TakeLease();
+
+            statistics = f.Pool.GetStatistics();
+
+            Assert::AreEqual(3ull, statistics.LeasesTaken);
+            Assert::AreEqual(3ull, statistics.DeviceContextsCreated);
+            Assert::AreEqual(0ull, statistics.DeviceContextsDiscarded);
+            Assert::AreEqual(3u, statistics.ActiveLeaseCount);
+            Assert::AreEqual(3u, statistics.PeakActiveLeaseCount);
+
+            Sleep(1);
+        }
+
+        // The pool only holds two contexts, so one was discarded.
+        statistics = f.Pool.GetStatistics();
+
+        Assert::AreEqual(1ull, statistics.DeviceContextsDiscarded);
+        Assert::AreEqual(0u, statistics.ActiveLeaseCount);
+        Assert::AreEqual(3u, statistics.PeakActiveLeaseCount);
+        Assert::IsTrue(statistics.AverageLeaseMicroseconds > 0);
+
+        // Moving a lease does not count as returning it.
+        {
+            auto lease1 = f.Pool.TakeLease();
+            auto lease2 = std::move(lease1);
+
+            Assert::AreEqual(1u, f.Pool.GetStatistics().ActiveLeaseCount);
+        }
+
+        statistics = f.Pool.GetStatistics();
+
+        Assert::AreEqual(4ull, statistics.LeasesTaken);
+        Assert::AreEqual(3ull, statistics.DeviceContextsCreated);
+        Assert::AreEqual(0u, statistics.ActiveLeaseCount);
+    }
+
     TEST_METHOD_EX(DeviceContextPool_WhenClosed_PoolIsEmptied)
     {
         Fixture f;
@@ -166,4 +304,87 @@ public:
 
         ExpectHResultException(RO_E_CLOSED, [&] { f.Pool.TakeLease(); });
     }
+
+    //
+    // Many threads taking and returning leases at the same time. The time this
+    // takes is measured by DeviceContextPool_Contention_Benchmark in perf.
+    //
+    TEST_METHOD_EX(DeviceContextPool_ConcurrentLeases_AreNeverShared)
+    {
+        class AtomicCountedD2DDeviceContext : public MockD2DDeviceContext
+        {
+            std::atomic<int>* m_counter;
+
+        public:
+            std::atomic<bool> InUse;
+
+            AtomicCountedD2DDeviceContext(std::atomic<int>* counter)
+                : m_counter(counter)
+                , InUse(false)
+            {
+                (*m_counter)++;
+            }
+
+            virtual ~AtomicCountedD2DDeviceContext() override
+            {
+                (*m_counter)--;
+            }
+        };
+
+        auto device = Make<MockD2DDevice>();
+
+        std::atomic<int> numberOfActiveDeviceContexts(0);
+        std::atomic<int> numberOfCreatedDeviceContexts(0);
+
+        device->MockCreateDeviceContext =
+            [&] (D2D1_DEVICE_CONTEXT_OPTIONS, ID2D1DeviceContext1** deviceContext)
+            {
+                numberOfCreatedDeviceContexts++;
+
+                auto mockDeviceContext = Make<AtomicCountedD2DDeviceContext>(&numberOfActiveDeviceContexts);
+                mockDeviceContext.CopyTo(deviceContext);
+            };
+
+        unsigned const threadCount = std::max(DeviceContextPool::GetDefaultMaximumSize(), 4U) * 2;
+        int const leasesPerThread = 1000;
+
+        DeviceContextPool pool(device.Get());
+
+        std::atomic<bool> failed(false);
+        std::vector<std::thread> threads;
+
+        for (unsigned i = 0; i < threadCount; ++i)
+        {
+            threads.emplace_back([&]
+            {
+                for (int j = 0; j < leasesPerThread; ++j)
+                {
+                    auto lease = pool.TakeLease();
+
+                    // The context must not be in use by anyone else while we hold it.
+                    auto deviceContext = static_cast<AtomicCountedD2DDeviceContext*>(lease.Get());
+
+                    if (deviceContext->InUse.exchange(true))
+                        failed = true;
+
+                    deviceContext->InUse = false;
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        Assert::IsFalse(failed.load());
+
+        // Contexts are only created when every pooled context is leased, and
+        // the pool never retains more than its maximum size.
+        Assert::IsTrue(numberOfCreatedDeviceContexts.load() < static_cast<int>(threadCount * leasesPerThread));
+        Assert::IsTrue(numberOfActiveDeviceContexts.load() <= static_cast<int>(pool.GetMaximumSize()));
+
+        pool.Close();
+        Assert::AreEqual(0, numberOfActiveDeviceContexts.load());
+    }
 };
@@ -0,0 +1,528 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/effects/EffectAnimator.h>
+#include <lib/effects/generated/ArithmeticCompositeEffect.h>
+#include <lib/effects/generated/ColorMatrixEffect.h>
+#include <lib/effects/generated/ColorSourceEffect.h>
+#include <lib/effects/generated/GaussianBlurEffect.h>
+#include <lib/effects/generated/HueRotationEffect.h>
+
+TEST_CLASS(EffectAnimatorUnitTests)
+{
+    static EffectAnimationCurve MakeCurve(std::initializer_list<EffectAnimationKeyframe> keyframes, bool isLooped = false)
+    {
+        return EffectAnimationCurve{ keyframes, isLooped };
+    }
+
+    static float GetBlurAmount(ComPtr<GaussianBlurEffect> const& effect)
+    {
+        float value;
+        ThrowIfFailed(effect->get_BlurAmount(&value));
+        return value;
+    }
+
+public:
+    TEST_METHOD_EX(EffectAnimationCurve_LinearAndStep)
+    {
+        auto curve = MakeCurve(
+        {
+            EffectAnimationKeyframe::Linear(1, 10),
+            EffectAnimationKeyframe::Step(2, 20),
+            EffectAnimationKeyframe::Linear(3, 30),
+        });
+
+        // Holds the first and last values outside the keyframe range.
+        Assert::AreEqual(10.0f, curve.Evaluate(0));
+        Assert::AreEqual(10.0f, curve.Evaluate(1));
+        Assert::AreEqual(30.0f, curve.Evaluate(3));
+        Assert::AreEqual(30.0f, curve.Evaluate(100));
+
+        Assert::AreEqual(15.0f, curve.Evaluate(1.5f), 0.0001f);
+        Assert::AreEqual(20.0f, curve.Evaluate(2.0f));
+        Assert::AreEqual(20.0f, curve.Evaluate(2.9f));
+    }
+
+    TEST_METHOD_EX(EffectAnimationCurve_KeyframesAreSortedWhenBound)
+    {
+        auto effect = Make<GaussianBlurEffect>();
+
+        EffectAnimator animator;
+
+        animator.AddBinding(effect.Get(), D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION, 0, MakeCurve(
+        {
+            EffectAnimationKeyframe::Linear(1, 8),
+            EffectAnimationKeyframe::Linear(0, 4),
+        }));
+
+        animator.Update(0.5f);
+
+        Assert::AreEqual(6.0f, GetBlurAmount(effect), 0.0001f);
+    }
+
+    TEST_METHOD_EX(EffectAnimationCurve_Looped)
+    {
+        auto curve = MakeCurve(
+        {
+            EffectAnimationKeyframe::Linear(1, 0),
+            EffectAnimationKeyframe::Linear(3, 4),
+        }, true);
+
+        Assert::AreEqual(0.0f, curve.Evaluate(0));
+        Assert::AreEqual(2.0f, curve.Evaluate(2), 0.0001f);
+        Assert::AreEqual(2.0f, curve.Evaluate(4), 0.0001f);
+        Assert::AreEqual(1.0f, curve.Evaluate(5.5f), 0.0001f);
+    }
+
+    TEST_METHOD_EX(EffectAnimationCurve_CubicBezier)
+    {
+        // A Bezier with control points on the diagonal is linear.
+        auto linear = MakeCurve(
+        {
+            EffectAnimationKeyframe::CubicBezier(0, 0, 0.25f, 0.25f, 0.75f, 0.75f),
+            EffectAnimationKeyframe::Linear(1, 1),
+        });
+
+        for (float t = 0; t <= 1; t += 0.125f)
+        {
+            Assert::AreEqual(t, linear.Evaluate(t), 0.0001f);
+        }
+
+        // CSS "ease".
+        auto ease = MakeCurve(
+        {
+            EffectAnimationKeyframe::CubicBezier(0, 0, 0.25f, 0.1f, 0.25f, 1),
+            EffectAnimationKeyframe::Linear(1, 1),
+        });
+
+        Assert::AreEqual(0.8024f, ease.Evaluate(0.5f), 0.001f);
+
+        // X control points are clamped to keep the curve a function of time.
+        auto clamped = EffectAnimationKeyframe::CubicBezier(0, 0, -1, 0, 2, 1);
+
+        Assert::AreEqual(0.0f, clamped.Parameters[0]);
+        Assert::AreEqual(1.0f, clamped.Parameters[2]);
+    }
+
+    TEST_METHOD_EX(EffectAnimationCurve_Spring)
+    {
+        auto underdamped = MakeCurve(
+        {
+            EffectAnimationKeyframe::Spring(0, 0, 10, 0.3f),
+            EffectAnimationKeyframe::Linear(10, 1),
+        });
+
+        Assert::AreEqual(0.0f, underdamped.Evaluate(0));
+        Assert::IsTrue(underdamped.Evaluate(0.5f) > 1.0f);
+        Assert::AreEqual(1.0f, underdamped.Evaluate(9), 0.001f);
+
+        auto criticallyDamped = MakeCurve(
+        {
+            EffectAnimationKeyframe::Spring(0, 0, 10, 1),
+            EffectAnimationKeyframe::Linear(10, 1),
+        });
+
+        auto overdamped = MakeCurve(
+        {
+            EffectAnimationKeyframe::Spring(0, 0, 10, 2),
+            EffectAnimationKeyframe::Linear(10, 1),
+        });
+
+        float previousCritical = 0;
+        float previousOver = 0;
+
+        for (float t = 0.1f; t < 2; t += 0.1f)
+        {
+            auto critical = criticallyDamped.Evaluate(t);
+            auto over = overdamped.Evaluate(t);
+
+            Assert::IsTrue(critical >= previousCritical && critical <= 1);
+            Assert::IsTrue(over >= previousOver && over < critical);
+
+            previousCritical = critical;
+            previousOver = over;
+        }
+
+        ExpectHResultException(E_INVALIDARG, [] { EffectAnimationKeyframe::Spring(0, 0, 0, 1); });
+        ExpectHResultException(E_INVALIDARG, [] { EffectAnimationKeyframe::Spring(0, 0, 1, -1); });
+    }
+
+    TEST_METHOD_EX(EffectAnimator_UpdateMatchesCurveEvaluate)
+    {
+        std::vector<EffectAnimationCurve> curves =
+        {
+            MakeCurve({ EffectAnimationKeyframe::Linear(0, 0), EffectAnimationKeyframe::Linear(2, 10) }),
+            MakeCurve({ EffectAnimationKeyframe::Step(0, 3), EffectAnimationKeyframe::Linear(2, 10) }),
+            MakeCurve({ EffectAnimationKeyframe::CubicBezier(0, 1, 0.4f, 0, 0.2f, 1), EffectAnimationKeyframe::Linear(2, 5) }),
+            MakeCurve({ EffectAnimationKeyframe::Spring(0, 2, 5, 0.5f), EffectAnimationKeyframe::Linear(2, 7) }),
+            MakeCurve({ EffectAnimationKeyframe::Linear(0.5f, 1), EffectAnimationKeyframe::Linear(1, 2) }, true),
+        };
+
+        EffectAnimator animator;
+        std::vector<ComPtr<GaussianBlurEffect>> effects;
+
+        for (auto& curve : curves)
+        {
+            effects.push_back(Make<GaussianBlurEffect>());
+            animator.AddBinding(effects.back().Get(), D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION, 0, curve);
+        }
+
+        for (float t = -1; t < 3; t += 0.25f)
+        {
+            animator.Update(t);
+
+            for (size_t i = 0; i < curves.size(); i++)
+            {
+                Assert::AreEqual(curves[i].Evaluate(t), GetBlurAmount(effects[i]), 0.00001f);
+            }
+        }
+    }
+
+    TEST_METHOD_EX(EffectAnimator_UpdateWithTimeSpan)
+    {
+        auto effect = Make<GaussianBlurEffect>();
+
+        EffectAnimator animator;
+        animator.AddBinding(effect.Get(), D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION, 0, MakeCurve(
+        {
+            EffectAnimationKeyframe::Linear(0, 0),
+            EffectAnimationKeyframe::Linear(1, 100),
+        }));
+
+        animator.Update(TimeSpan{ 2500000 });
+
+        Assert::AreEqual(25.0f, GetBlurAmount(effect), 0.001f);
+    }
+
+    TEST_METHOD_EX(EffectAnimator_AnimatesArrayComponents)
+    {
+        auto effect = Make<ColorMatrixEffect>();
+
+        Matrix5x4 matrix{};
+        matrix.M11 = 1;
+        matrix.M22 = 2;
+        matrix.M33 = 3;
+        ThrowIfFailed(effect->put_ColorMatrix(matrix));
+
+        EffectAnimator animator;
+
+        // Components are bound out of order, to check they are still committed together.
+        animator.AddBinding(effect.Get(), D2D1_COLORMATRIX_PROP_COLOR_MATRIX, 19, MakeCurve({ EffectAnimationKeyframe::Linear(0, 0), EffectAnimationKeyframe::Linear(1, 4) }));
+        animator.AddBinding(effect.Get(), D2D1_COLORMATRIX_PROP_COLOR_MATRIX, 0, MakeCurve({ EffectAnimationKeyframe::Linear(0, 0), EffectAnimationKeyframe::Linear(1, 8) }));
+
+        animator.Update(0.5f);
+
+        ThrowIfFailed(effect->get_ColorMatrix(&matrix));
+
+        Assert::AreEqual(4.0f, matrix.M11);
+        Assert::AreEqual(2.0f, matrix.M22);
+        Assert::AreEqual(3.0f, matrix.M33);
+        Assert::AreEqual(2.0f, matrix.M54);
+    }
+
+    TEST_METHOD_EX(EffectAnimator_LaterBindingWinsForSameValue)
+    {
+        auto effect = Make<GaussianBlurEffect>();
+
+        EffectAnimator animator;
+        animator.AddBinding(effect.Get(), D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION, 0, MakeCurve({ EffectAnimationKeyframe::Step(0, 1) }));
+        animator.AddBinding(effect.Get(), D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION, 0, MakeCurve({ EffectAnimationKeyframe::Step(0, 2) }));
+
+        animator.Update(0.0f);
+
+        Assert::AreEqual(2.0f, GetBlurAmount(effect));
+    }
+
+    TEST_METHOD_EX(EffectAnimator_RemoveBindings)
+    {
+        auto effect1 = Make<GaussianBlurEffect>();
+        auto effect2 = Make<GaussianBlurEffect>();
+
+        auto curve = MakeCurve({ EffectAnimationKeyframe::Linear(0, 0), EffectAnimationKeyframe::Linear(1, 10) });
+
+        EffectAnimator animator;
+        auto id1 = animator.AddBinding(effect1.Get(), D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION, 0, curve);
+        animator.AddBinding(effect2.Get(), D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION, 0, curve);
+        animator.AddBinding(effect2.Get(), D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION, 0, curve);
+
+        Assert::AreEqual<size_t>(3, animator.GetBindingCount());
+
+        animator.Update(0.5f);
+
+        animator.RemoveBinding(id1);
+        Assert::AreEqual<size_t>(2, animator.GetBindingCount());
+
+        animator.Update(1.0f);
+
+        Assert::AreEqual(5.0f, GetBlurAmount(effect1));
+        Assert::AreEqual(10.0f, GetBlurAmount(effect2));
+
+        animator.RemoveBindings(effect2.Get());
+        Assert::AreEqual<size_t>(0, animator.GetBindingCount());
+
+        animator.Update(0.0f);
+
+        Assert::AreEqual(10.0f, GetBlurAmount(effect2));
+    }
+
+    TEST_METHOD_EX(EffectAnimator_InvalidBindings)
+    {
+        auto effect = Make<GaussianBlurEffect>();
+        auto curve = MakeCurve({ EffectAnimationKeyframe::Linear(0, 0) });
+
+        auto colorMatrix = Make<ColorMatrixEffect>();
+
+        EffectAnimator animator;
+
+        ExpectHResultException(E_INVALIDARG, [&] { animator.AddBinding(nullptr, 0, 0, curve); });
+        ExpectHResultException(E_INVALIDARG, [&] { animator.AddBinding(effect.Get(), 0, 0, EffectAnimationCurve{}); });
+        ExpectHResultException(E_BOUNDS, [&] { animator.AddBinding(effect.Get(), 100, 0, curve); });
+
+        // Enum properties cannot be animated.
+        ExpectHResultException(E_INVALIDARG, [&] { animator.AddBinding(effect.Get(), D2D1_GAUSSIANBLUR_PROP_BORDER_MODE, 0, curve); });
+
+        // Scalar properties only have one component, and a 5x4 matrix has 20.
+        ExpectHResultException(E_BOUNDS, [&] { animator.AddBinding(effect.Get(), D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION, 1, curve); });
+        ExpectHResultException(E_BOUNDS, [&] { animator.AddBinding(colorMatrix.Get(), D2D1_COLORMATRIX_PROP_COLOR_MATRIX, 20, curve); });
+
+        // Rejected bindings are not added, so Update keeps working.
+        Assert::AreEqual<size_t>(0, animator.GetBindingCount());
+
+        animator.AddBinding(colorMatrix.Get(), D2D1_COLORMATRIX_PROP_COLOR_MATRIX, 19, curve);
+        animator.Update(0.0f);
+    }
+
+    TEST_METHOD_EX(CanvasEffect_GetPropertyComponentCount)
+    {
+        auto blur = Make<GaussianBlurEffect>();
+        auto colorMatrix = Make<ColorMatrixEffect>();
+
+        Assert::AreEqual(1u, blur->GetPropertyComponentCount(D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION));
+        Assert::AreEqual(20u, colorMatrix->GetPropertyComponentCount(D2D1_COLORMATRIX_PROP_COLOR_MATRIX));
+
+        ExpectHResultException(E_INVALIDARG, [&] { blur->GetPropertyComponentCount(D2D1_GAUSSIANBLUR_PROP_BORDER_MODE); });
+        ExpectHResultException(E_BOUNDS, [&] { blur->GetPropertyComponentCount(100); });
+    }
+
+    TEST_METHOD_EX(CanvasEffect_SetPropertyComponents)
+    {
+        auto effect = Make<ColorMatrixEffect>();
+
+        EffectPropertyComponent values[] =
+        {
+            { D2D1_COLORMATRIX_PROP_COLOR_MATRIX, 1, 5 },
+            { D2D1_COLORMATRIX_PROP_COLOR_MATRIX, 4, 6 },
+        };
+
+        effect->SetPropertyComponents(values, _countof(values));
+
+        Matrix5x4 matrix;
+        ThrowIfFailed(effect->get_ColorMatrix(&matrix));
+
+        Assert::AreEqual(1.0f, matrix.M11);
+        Assert::AreEqual(5.0f, matrix.M12);
+        Assert::AreEqual(6.0f, matrix.M21);
+        Assert::AreEqual(1.0f, matrix.M22);
+
+        effect->SetPropertyComponents(nullptr, 0);
+
+        ExpectHResultException(E_INVALIDARG, [&] { effect->SetPropertyComponents(nullptr, 1); });
+
+        EffectPropertyComponent outOfRange[] = { { 100, 0, 0 } };
+        ExpectHResultException(E_BOUNDS, [&] { effect->SetPropertyComponents(outOfRange, 1); });
+    }
+};
+
+
+TEST_CLASS(CanvasEffectAnimatorUnitTests)
+{
+    static uint32_t AddAnimation(ICanvasEffectAnimator* animator, IGraphicsEffect* effect, wchar_t const* propertyName, uint32_t component, float from, float to)
+    {
+        CanvasEffectKeyframe keyframes[] =
+        {
+            { 0, from, CanvasEffectEasing::Linear },
+            { 1, to,   CanvasEffectEasing::Linear },
+        };
+
+        uint32_t animationId;
+        ThrowIfFailed(animator->AddAnimation(effect, WinString(propertyName), component, _countof(keyframes), keyframes, false, &animationId));
+        return animationId;
+    }
+
+    static void UpdateAt(ICanvasEffectAnimator* animator, float seconds)
+    {
+        ThrowIfFailed(animator->Update(TimeSpan{ static_cast<INT64>(seconds * 10000000) }));
+    }
+
+public:
+    TEST_METHOD_EX(CanvasEffectAnimator_Implements_Expected_Interfaces)
+    {
+        auto animator = Make<CanvasEffectAnimator>();
+
+        ASSERT_IMPLEMENTS_INTERFACE(animator, ICanvasEffectAnimator);
+    }
+
+    TEST_METHOD_EX(CanvasEffectAnimator_NullArgs)
+    {
+        auto animator = Make<CanvasEffectAnimator>();
+        auto effect = Make<GaussianBlurEffect>();
+
+        CanvasEffectKeyframe keyframe{};
+        uint32_t animationId;
+
+        Assert::AreEqual(E_INVALIDARG, animator->AddAnimation(nullptr, WinString(L"BlurAmount"), 0, 1, &keyframe, false, &animationId));
+        Assert::AreEqual(E_INVALIDARG, animator->AddAnimation(effect.Get(), WinString(L"BlurAmount"), 0, 1, nullptr, false, &animationId));
+        Assert::AreEqual(E_INVALIDARG, animator->AddAnimation(effect.Get(), WinString(L"BlurAmount"), 0, 1, &keyframe, false, nullptr));
+        Assert::AreEqual(E_INVALIDARG, animator->RemoveAnimations(nullptr));
+        Assert::AreEqual(E_INVALIDARG, animator->get_AnimationCount(nullptr));
+    }
+
+    TEST_METHOD_EX(CanvasEffectAnimator_AnimatesPropertiesByName)
+    {
+        auto animator = Make<CanvasEffectAnimator>();
+        auto blur = Make<GaussianBlurEffect>();
+        auto colorMatrix = Make<ColorMatrixEffect>();
+
+        AddAnimation(animator.Get(), blur.Get(), L"BlurAmount", 0, 0, 10);
+        AddAnimation(animator.Get(), colorMatrix.Get(), L"ColorMatrix", 4, 2, 4);
+
+        UpdateAt(animator.Get(), 0.5f);
+
+        float blurAmount;
+        ThrowIfFailed(blur->get_BlurAmount(&blurAmount));
+        Assert::AreEqual(5.0f, blurAmount, 0.0001f);
+
+        Matrix5x4 matrix;
+        ThrowIfFailed(colorMatrix->get_ColorMatrix(&matrix));
+        Assert::AreEqual(3.0f, matrix.M21, 0.0001f);
+    }
+
+    TEST_METHOD_EX(CanvasEffectAnimator_AnglesAreInRadians)
+    {
+        auto animator = Make<CanvasEffectAnimator>();
+        auto effect = Make<HueRotationEffect>();
+
+        AddAnimation(animator.Get(), effect.Get(), L"Angle", 0, 0, 2);
+
+        UpdateAt(animator.Get(), 0.25f);
+
+        float angle;
+        ThrowIfFailed(effect->get_Angle(&angle));
+        Assert::AreEqual(0.5f, angle, 0.0001f);
+    }
+
+    TEST_METHOD_EX(CanvasEffectAnimator_VectorElementPropertiesMapToTheirComponent)
+    {
+        auto animator = Make<CanvasEffectAnimator>();
+        auto effect = Make<ArithmeticCompositeEffect>();
+
+        AddAnimation(animator.Get(), effect.Get(), L"Source2Amount", 0, 0, 8);
+
+        UpdateAt(animator.Get(), 0.5f);
+
+        float source1Amount;
+        float source2Amount;
+        ThrowIfFailed(effect->get_Source1Amount(&source1Amount));
+        ThrowIfFailed(effect->get_Source2Amount(&source2Amount));
+        Assert::AreEqual(0.0f, source1Amount);
+        Assert::AreEqual(4.0f, source2Amount, 0.0001f);
+
+        // These properties are a single float, so only component 0 exists.
+        CanvasEffectKeyframe keyframe{};
+        uint32_t animationId;
+        Assert::AreEqual(E_BOUNDS, animator->AddAnimation(effect.Get(), WinString(L"Source2Amount"), 1, 1, &keyframe, false, &animationId));
+    }
+
+    TEST_METHOD_EX(CanvasEffectAnimator_EasingsMatchEffectAnimationCurve)
+    {
+        auto animator = Make<CanvasEffectAnimator>();
+        auto bezier = Make<GaussianBlurEffect>();
+        auto spring = Make<GaussianBlurEffect>();
+
+        CanvasEffectKeyframe bezierKeyframes[] =
+        {
+            { 0, 0,  CanvasEffectEasing::CubicBezier, { 0.25f, 0.1f, 0.25f, 1 } },
+            { 1, 10, CanvasEffectEasing::Linear },
+        };
+
+        CanvasEffectKeyframe springKeyframes[] =
+        {
+            { 0, 0,  CanvasEffectEasing::Spring, { 10, 0.3f } },
+            { 2, 10, CanvasEffectEasing::Linear },
+        };
+
+        uint32_t animationId;
+        ThrowIfFailed(animator->AddAnimation(bezier.Get(), WinString(L"BlurAmount"), 0, _countof(bezierKeyframes), bezierKeyframes, false, &animationId));
+        ThrowIfFailed(animator->AddAnimation(spring.Get(), WinString(L"BlurAmount"), 0, _countof(springKeyframes), springKeyframes, false, &animationId));
+
+        UpdateAt(animator.Get(), 0.5f);
+
+        auto expectedBezier = EffectAnimationCurve{ { EffectAnimationKeyframe::CubicBezier(0, 0, 0.25f, 0.1f, 0.25f, 1), EffectAnimationKeyframe::Linear(1, 10) }, false };
+        auto expectedSpring = EffectAnimationCurve{ { EffectAnimationKeyframe::Spring(0, 0, 10, 0.3f), EffectAnimationKeyframe::Linear(2, 10) }, false };
+
+        float value;
+        ThrowIfFailed(bezier->get_BlurAmount(&value));
+        Assert::AreEqual(expectedBezier.Evaluate(0.5f), value, 0.0001f);
+
+        ThrowIfFailed(spring->get_BlurAmount(&value));
+        Assert::AreEqual(expectedSpring.Evaluate(0.5f), value, 0.0001f);
+    }
+
+    TEST_METHOD_EX(CanvasEffectAnimator_RejectsPropertiesThatCannotBeAnimated)
+    {
+        auto animator = Make<CanvasEffectAnimator>();
+        auto blur = Make<GaussianBlurEffect>();
+        auto colorSource = Make<ColorSourceEffect>();
+
+        CanvasEffectKeyframe keyframe{};
+        uint32_t animationId;
+
+        // Unknown names, non-float properties, and properties converted from other types.
+        Assert::AreEqual(E_INVALIDARG, animator->AddAnimation(blur.Get(), WinString(L"NoSuchProperty"), 0, 1, &keyframe, false, &animationId));
+        Assert::AreEqual(E_INVALIDARG, animator->AddAnimation(blur.Get(), WinString(L"BorderMode"), 0, 1, &keyframe, false, &animationId));
+        Assert::AreEqual(E_INVALIDARG, animator->AddAnimation(colorSource.Get(), WinString(L"Color"), 0, 1, &keyframe, false, &animationId));
+
+        // Bad keyframes.
+        CanvasEffectKeyframe badEasing{ 0, 0, static_cast<CanvasEffectEasing>(100) };
+        CanvasEffectKeyframe badSpring{ 0, 0, CanvasEffectEasing::Spring };
+
+        Assert::AreEqual(E_INVALIDARG, animator->AddAnimation(blur.Get(), WinString(L"BlurAmount"), 0, 0, &keyframe, false, &animationId));
+        Assert::AreEqual(E_INVALIDARG, animator->AddAnimation(blur.Get(), WinString(L"BlurAmount"), 0, 1, &badEasing, false, &animationId));
+        Assert::AreEqual(E_INVALIDARG, animator->AddAnimation(blur.Get(), WinString(L"BlurAmount"), 0, 1, &badSpring, false, &animationId));
+
+        int32_t count;
+        ThrowIfFailed(animator->get_AnimationCount(&count));
+        Assert::AreEqual(0, count);
+    }
+
+    TEST_METHOD_EX(CanvasEffectAnimator_RemoveAnimations)
+    {
+        auto animator = Make<CanvasEffectAnimator>();
+        auto effect1 = Make<GaussianBlurEffect>();
+        auto effect2 = Make<GaussianBlurEffect>();
+
+        auto id = AddAnimation(animator.Get(), effect1.Get(), L"BlurAmount", 0, 0, 10);
+        AddAnimation(animator.Get(), effect2.Get(), L"BlurAmount", 0, 0, 10);
+        AddAnimation(animator.Get(), effect2.Get(), L"BlurAmount", 0, 10, 0);
+
+        int32_t count;
+        ThrowIfFailed(animator->get_AnimationCount(&count));
+        Assert::AreEqual(3, count);
+
+        ThrowIfFailed(animator->RemoveAnimation(id));
+        ThrowIfFailed(animator->get_AnimationCount(&count));
+        Assert::AreEqual(2, count);
+
+        ThrowIfFailed(animator->RemoveAnimations(effect2.Get()));
+        ThrowIfFailed(animator->get_AnimationCount(&count));
+        Assert::AreEqual(0, count);
+
+        AddAnimation(animator.Get(), effect1.Get(), L"BlurAmount", 0, 0, 10);
+        ThrowIfFailed(animator->Clear());
+        ThrowIfFailed(animator->get_AnimationCount(&count));
+        Assert::AreEqual(0, count);
+    }
+};
@@ -0,0 +1,301 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+//
+// Mock effect with two float properties, which records inputs and property
+// values so tests can check what the pool resets them to.
+//
+class PoolableD2DEffect : public MockD2DEffect
+{
+public:
+    static const UINT32 PropertyCount = 2;
+    static const float DefaultValue;
+
+    D2D1_PROPERTY_TYPE PropertyType;
+    std::map<UINT32, std::vector<BYTE>> Properties;
+    std::vector<ComPtr<ID2D1Image>> Inputs;
+
+    PoolableD2DEffect(D2D1_PROPERTY_TYPE propertyType = D2D1_PROPERTY_TYPE_FLOAT)
+        : PropertyType(propertyType)
+        , Inputs(1)
+    {
+        MockGetType = [=](UINT32)
+        {
+            return PropertyType;
+        };
+
+        MockGetValue = [=](UINT32 index, D2D1_PROPERTY_TYPE, BYTE* data, UINT32 dataSize)
+        {
+            auto& value = Properties[index];
+            Assert::AreEqual<size_t>(value.size(), dataSize);
+            memcpy(data, value.data(), dataSize);
+            return S_OK;
+        };
+
+        MockSetValue = [=](UINT32 index, D2D1_PROPERTY_TYPE, CONST BYTE* data, UINT32 dataSize)
+        {
+            Properties[index] = std::vector<BYTE>(data, data + dataSize);
+            return S_OK;
+        };
+
+        MockGetInputCount = [=]
+        {
+            return static_cast<UINT32>(Inputs.size());
+        };
+
+        MockSetInput = [=](UINT32 index, ID2D1Image* input)
+        {
+            Inputs[index] = input;
+        };
+
+        for (UINT32 i = 0; i < PropertyCount; i++)
+        {
+            SetValue(i, DefaultValue);
+        }
+    }
+
+    STDMETHOD_(UINT32, GetPropertyCount)() CONST override
+    {
+        return PropertyCount;
+    }
+
+    STDMETHOD_(UINT32, GetValueSize)(UINT32 index) CONST override
+    {
+        return static_cast<UINT32>(sizeof(float));
+    }
+
+    STDMETHOD(GetSubProperties)(UINT32, ID2D1Properties** subProperties) CONST override
+    {
+        *subProperties = nullptr;
+        return D2DERR_NO_SUBPROPERTIES;
+    }
+
+    float GetFloat(UINT32 index)
+    {
+        return *reinterpret_cast<float*>(Properties[index].data());
+    }
+};
+
+const float PoolableD2DEffect::DefaultValue = 23.0f;
+
+
+TEST_CLASS(EffectPoolUnitTests)
+{
+public:
+    struct Fixture
+    {
+        ComPtr<MockD2DDeviceContext> DeviceContext;
+        EffectPool Pool;
+
+        std::vector<ComPtr<PoolableD2DEffect>> CreatedEffects;
+        D2D1_PROPERTY_TYPE PropertyType;
+
+        Fixture(uint32_t maximumSize = EffectPool::DefaultMaximumSize)
+            : DeviceContext(Make<MockD2DDeviceContext>())
+            , Pool(maximumSize)
+            , PropertyType(D2D1_PROPERTY_TYPE_FLOAT)
+        {
+            DeviceContext->CreateEffectMethod.AllowAnyCall(
+                [=](IID const&, ID2D1Effect** effect)
+                {
+                    auto mockEffect = Make<PoolableD2DEffect>(PropertyType);
+                    CreatedEffects.push_back(mockEffect);
+                    return mockEffect.CopyTo(effect);
+                });
+        }
+
+        // Creates an effect, then hands it back to the pool as no longer used by anyone else.
+        void CreateAndReturn(IID const& effectId)
+        {
+            auto effect = Pool.CreateEffect(DeviceContext.Get(), effectId);
+            CreatedEffects.clear();
+            Pool.ReturnEffect(effectId, std::move(effect), false);
+        }
+    };
+
+    TEST_METHOD_EX(EffectPool_WhenEmpty_TryTakeEffectReturnsNull)
+    {
+        Fixture f;
+
+        Assert::IsNull(f.Pool.TryTakeEffect(CLSID_D2D1GaussianBlur).Get());
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(0, statistics.EffectsCreated);
+        Assert::AreEqual<uint64_t>(0, statistics.EffectsReused);
+    }
+
+    TEST_METHOD_EX(EffectPool_CreateEffect_UsesDeviceContext)
+    {
+        Fixture f;
+
+        f.DeviceContext->CreateEffectMethod.SetExpectedCalls(1,
+            [&](IID const& effectId, ID2D1Effect** effect)
+            {
+                Assert::AreEqual(CLSID_D2D1GaussianBlur, effectId);
+                return Make<PoolableD2DEffect>().CopyTo(effect);
+            });
+
+        auto effect = f.Pool.CreateEffect(f.DeviceContext.Get(), CLSID_D2D1GaussianBlur);
+
+        Assert::IsNotNull(effect.Get());
+        Assert::AreEqual<uint64_t>(1, f.Pool.GetStatistics().EffectsCreated);
+    }
+
+    TEST_METHOD_EX(EffectPool_ReturnedEffect_IsReusedForSameEffectId)
+    {
+        Fixture f;
+
+        auto effect = f.Pool.CreateEffect(f.DeviceContext.Get(), CLSID_D2D1GaussianBlur);
+        ID2D1Effect* rawEffect = effect.Get();
+        f.CreatedEffects.clear();
+
+        f.Pool.ReturnEffect(CLSID_D2D1GaussianBlur, std::move(effect), false);
+
+        Assert::IsNull(effect.Get());
+        Assert::IsNull(f.Pool.TryTakeEffect(CLSID_D2D1Border).Get());
+
+        auto reusedEffect = f.Pool.TryTakeEffect(CLSID_D2D1GaussianBlur);
+
+        Assert::AreEqual(rawEffect, reusedEffect.Get());
+        Assert::IsNull(f.Pool.TryTakeEffect(CLSID_D2D1GaussianBlur).Get());
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.EffectsCreated);
+        Assert::AreEqual<uint64_t>(1, statistics.EffectsReused);
+        Assert::AreEqual<uint64_t>(0, statistics.EffectsDiscarded);
+        Assert::AreEqual<uint32_t>(0, statistics.PooledEffectCount);
+    }
+
+    TEST_METHOD_EX(EffectPool_ReturnedEffect_IsResetToDefaults)
+    {
+        Fixture f;
+
+        auto effect = f.Pool.CreateEffect(f.DeviceContext.Get(), CLSID_D2D1GaussianBlur);
+
+        // Only the pool may reference a pooled effect, so we observe it through a raw pointer.
+        PoolableD2DEffect* mockEffect = f.CreatedEffects.back().Get();
+        f.CreatedEffects.clear();
+
+        auto input = Make<MockD2DEffect>();
+        effect->SetInput(0, input.Get());
+        ThrowIfFailed(effect->SetValue(0, 1.0f));
+        ThrowIfFailed(effect->SetValue(1, 2.0f));
+        ThrowIfFailed(effect->SetValue(D2D1_PROPERTY_CACHED, static_cast<BOOL>(true)));
+        ThrowIfFailed(effect->SetValue(D2D1_PROPERTY_PRECISION, D2D1_BUFFER_PRECISION_32BPC_FLOAT));
+
+        f.Pool.ReturnEffect(CLSID_D2D1GaussianBlur, std::move(effect), false);
+
+        Assert::AreEqual<uint32_t>(1, f.Pool.GetStatistics().PooledEffectCount);
+
+        Assert::IsNull(mockEffect->Inputs[0].Get());
+        Assert::AreEqual(PoolableD2DEffect::DefaultValue, mockEffect->GetFloat(0));
+        Assert::AreEqual(PoolableD2DEffect::DefaultValue, mockEffect->GetFloat(1));
+        Assert::AreEqual<BOOL>(FALSE, *reinterpret_cast<BOOL*>(mockEffect->Properties[D2D1_PROPERTY_CACHED].data()));
+        Assert::AreEqual<uint32_t>(D2D1_BUFFER_PRECISION_UNKNOWN, *reinterpret_cast<uint32_t*>(mockEffect->Properties[D2D1_PROPERTY_PRECISION].data()));
+    }
+
+    TEST_METHOD_EX(EffectPool_SharedEffect_IsDiscarded)
+    {
+        Fixture f;
+
+        auto effect = f.Pool.CreateEffect(f.DeviceContext.Get(), CLSID_D2D1GaussianBlur);
+
+        f.Pool.ReturnEffect(CLSID_D2D1GaussianBlur, std::move(effect), true);
+
+        Assert::IsNull(f.Pool.TryTakeEffect(CLSID_D2D1GaussianBlur).Get());
+        Assert::AreEqual<uint64_t>(1, f.Pool.GetStatistics().EffectsDiscarded);
+    }
+
+    TEST_METHOD_EX(EffectPool_UnsharedEffect_IsPooledRegardlessOfReferenceCount)
+    {
+        Fixture f;
+
+        auto effect = f.Pool.CreateEffect(f.DeviceContext.Get(), CLSID_D2D1GaussianBlur);
+
+        // f.CreatedEffects still holds a reference, as D2D itself might.
+        f.Pool.ReturnEffect(CLSID_D2D1GaussianBlur, std::move(effect), false);
+
+        Assert::AreEqual<uint32_t>(1, f.Pool.GetStatistics().PooledEffectCount);
+        Assert::AreEqual(f.CreatedEffects.back().Get(), f.Pool.TryTakeEffect(CLSID_D2D1GaussianBlur).Get());
+    }
+
+    TEST_METHOD_EX(EffectPool_EffectNotCreatedByPool_IsDiscarded)
+    {
+        Fixture f;
+
+        ComPtr<ID2D1Effect> effect = Make<PoolableD2DEffect>();
+
+        f.Pool.ReturnEffect(CLSID_D2D1GaussianBlur, std::move(effect), false);
+
+        Assert::IsNull(f.Pool.TryTakeEffect(CLSID_D2D1GaussianBlur).Get());
+        Assert::AreEqual<uint64_t>(1, f.Pool.GetStatistics().EffectsDiscarded);
+    }
+
+    TEST_METHOD_EX(EffectPool_EffectWithObjectProperties_IsNotPooled)
+    {
+        Fixture f;
+
+        f.PropertyType = D2D1_PROPERTY_TYPE_IUNKNOWN;
+
+        f.CreateAndReturn(CLSID_D2D1GaussianBlur);
+
+        Assert::IsNull(f.Pool.TryTakeEffect(CLSID_D2D1GaussianBlur).Get());
+        Assert::AreEqual<uint64_t>(1, f.Pool.GetStatistics().EffectsDiscarded);
+    }
+
+    TEST_METHOD_EX(EffectPool_WhenFull_LeastRecentlyReturnedEffectIsDiscarded)
+    {
+        Fixture f(2);
+
+        f.CreateAndReturn(CLSID_D2D1GaussianBlur);
+        f.CreateAndReturn(CLSID_D2D1Border);
+        f.CreateAndReturn(CLSID_D2D1Crop);
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.EffectsDiscarded);
+        Assert::AreEqual<uint32_t>(2, statistics.PooledEffectCount);
+
+        Assert::IsNull(f.Pool.TryTakeEffect(CLSID_D2D1GaussianBlur).Get());
+        Assert::IsNotNull(f.Pool.TryTakeEffect(CLSID_D2D1Border).Get());
+        Assert::IsNotNull(f.Pool.TryTakeEffect(CLSID_D2D1Crop).Get());
+    }
+
+    TEST_METHOD_EX(EffectPool_ReducingMaximumSize_TrimsPool)
+    {
+        Fixture f;
+
+        f.CreateAndReturn(CLSID_D2D1GaussianBlur);
+        f.CreateAndReturn(CLSID_D2D1Border);
+
+        f.Pool.SetMaximumSize(1);
+
+        Assert::AreEqual<uint32_t>(1, f.Pool.GetMaximumSize());
+        Assert::AreEqual<uint32_t>(1, f.Pool.GetStatistics().PooledEffectCount);
+        Assert::IsNotNull(f.Pool.TryTakeEffect(CLSID_D2D1Border).Get());
+
+        f.Pool.SetMaximumSize(0);
+
+        f.CreateAndReturn(CLSID_D2D1Border);
+
+        Assert::AreEqual<uint32_t>(0, f.Pool.GetStatistics().PooledEffectCount);
+    }
+
+    TEST_METHOD_EX(EffectPool_AfterClose_EffectsAreNotPooled)
+    {
+        Fixture f;
+
+        f.CreateAndReturn(CLSID_D2D1GaussianBlur);
+
+        f.Pool.Close();
+
+        Assert::AreEqual<uint32_t>(0, f.Pool.GetStatistics().PooledEffectCount);
+        Assert::IsNull(f.Pool.TryTakeEffect(CLSID_D2D1GaussianBlur).Get());
+
+        f.CreateAndReturn(CLSID_D2D1GaussianBlur);
+
+        Assert::IsNull(f.Pool.TryTakeEffect(CLSID_D2D1GaussianBlur).Get());
+    }
+};
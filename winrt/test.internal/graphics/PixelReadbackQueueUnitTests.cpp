@@ -0,0 +1,371 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/images/PixelReadbackQueue.h>
+
+#include "stubs/StubBuffer.h"
+
+//
+// Staging bitmap that can be mapped, exposing a recognizable pattern of bytes.
+//
+class ReadbackD2DBitmap : public MockD2DBitmap
+{
+public:
+    static const uint32_t Pitch = 64;
+
+    std::vector<uint8_t> Pixels;
+    HRESULT MapResult;
+    int MapCount;
+    bool IsMapped;
+
+    ReadbackD2DBitmap(uint32_t height)
+        : Pixels(Pitch * height)
+        , MapResult(S_OK)
+        , MapCount(0)
+        , IsMapped(false)
+    {
+        for (size_t i = 0; i < Pixels.size(); i++)
+        {
+            Pixels[i] = static_cast<uint8_t>(i % 251);
+        }
+
+        CopyFromBitmapMethod.AllowAnyCall();
+    }
+
+    STDMETHOD(Map)(D2D1_MAP_OPTIONS options, D2D1_MAPPED_RECT* mappedRect) override
+    {
+        Assert::AreEqual<uint32_t>(D2D1_MAP_OPTIONS_READ, options);
+        Assert::IsFalse(IsMapped);
+
+        MapCount++;
+
+        if (FAILED(MapResult))
+            return MapResult;
+
+        IsMapped = true;
+        mappedRect->pitch = Pitch;
+        mappedRect->bits = Pixels.data();
+        return S_OK;
+    }
+
+    STDMETHOD(Unmap)() override
+    {
+        Assert::IsTrue(IsMapped);
+        IsMapped = false;
+        return S_OK;
+    }
+};
+
+
+static bool IsReady(PixelReadbackFuture const& future)
+{
+    return future.IsReady();
+}
+
+
+TEST_CLASS(PixelReadbackQueueUnitTests)
+{
+public:
+    struct Fixture
+    {
+        ComPtr<StubCanvasDevice> Device;
+        ComPtr<StubD2DBitmap> D2DBitmap;
+        ComPtr<CanvasBitmap> Bitmap;
+
+        std::vector<ComPtr<ReadbackD2DBitmap>> StagingBitmaps;
+
+        Fixture()
+            : Device(Make<StubCanvasDevice>())
+            , D2DBitmap(Make<StubD2DBitmap>())
+        {
+            D2DBitmap->GetPixelFormatMethod.AllowAnyCall([] { return D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED); });
+            D2DBitmap->GetPixelSizeMethod.AllowAnyCall([] { return D2D1_SIZE_U{ 8, 8 }; });
+
+            Bitmap = Make<CanvasBitmap>(Device.Get(), D2DBitmap.Get());
+
+            Device->LeaseStagingBitmapMethod.AllowAnyCall(
+                [=](D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format)
+                {
+                    Assert::AreEqual<uint32_t>(DXGI_FORMAT_B8G8R8A8_UNORM, format.format);
+
+                    auto stagingBitmap = Make<ReadbackD2DBitmap>(size.height);
+                    StagingBitmaps.push_back(stagingBitmap);
+                    return StagingBitmapLease(stagingBitmap);
+                });
+        }
+    };
+
+    TEST_METHOD_EX(PixelReadbackQueue_Enqueue_CopiesWithoutMapping)
+    {
+        Fixture f;
+        PixelReadbackQueue queue;
+
+        auto result = queue.Enqueue(f.Bitmap.Get());
+
+        Assert::AreEqual<size_t>(1, f.StagingBitmaps.size());
+
+        auto stagingBitmap = f.StagingBitmaps[0];
+        stagingBitmap->CopyFromBitmapMethod.SetExpectedCalls(0);
+
+        Assert::AreEqual(0, stagingBitmap->MapCount);
+        Assert::IsFalse(IsReady(result));
+        Assert::AreEqual<uint32_t>(1, queue.GetPendingCount());
+
+        queue.Flush();
+    }
+
+    TEST_METHOD_EX(PixelReadbackQueue_Enqueue_CopiesSubrectangleToStagingBitmap)
+    {
+        Fixture f;
+        PixelReadbackQueue queue;
+
+        auto subRectangle = D2D1::RectU(2, 1, 5, 4);
+
+        f.Device->LeaseStagingBitmapMethod.SetExpectedCalls(1,
+            [&](D2D1_SIZE_U size, D2D1_PIXEL_FORMAT)
+            {
+                Assert::AreEqual(D2D1_SIZE_U{ 3, 3 }, size);
+
+                auto stagingBitmap = Make<ReadbackD2DBitmap>(size.height);
+
+                stagingBitmap->CopyFromBitmapMethod.SetExpectedCalls(1,
+                    [&](D2D1_POINT_2U const* destinationPoint, ID2D1Bitmap* source, D2D1_RECT_U const* sourceRectangle)
+                    {
+                        Assert::IsNull(destinationPoint);
+                        Assert::AreEqual(static_cast<ID2D1Bitmap*>(f.D2DBitmap.Get()), source);
+                        Assert::AreEqual(subRectangle, *sourceRectangle);
+                        return S_OK;
+                    });
+
+                f.StagingBitmaps.push_back(stagingBitmap);
+                return StagingBitmapLease(stagingBitmap);
+            });
+
+        queue.Enqueue(f.Bitmap.Get(), subRectangle);
+        queue.Flush();
+    }
+
+    TEST_METHOD_EX(PixelReadbackQueue_ReadbacksComplete_OnceLatencyIsExceeded)
+    {
+        Fixture f;
+        PixelReadbackQueue queue(2);
+
+        auto result1 = queue.Enqueue(f.Bitmap.Get());
+        auto result2 = queue.Enqueue(f.Bitmap.Get());
+
+        Assert::IsFalse(IsReady(result1));
+        Assert::IsFalse(IsReady(result2));
+
+        auto result3 = queue.Enqueue(f.Bitmap.Get());
+
+        Assert::IsTrue(IsReady(result1));
+        Assert::IsFalse(IsReady(result2));
+        Assert::IsFalse(IsReady(result3));
+
+        Assert::AreEqual(1, f.StagingBitmaps[0]->MapCount);
+        Assert::IsFalse(f.StagingBitmaps[0]->IsMapped);
+        Assert::AreEqual(0, f.StagingBitmaps[1]->MapCount);
+        Assert::AreEqual(0, f.StagingBitmaps[2]->MapCount);
+
+        Assert::AreEqual<uint32_t>(2, queue.GetPendingCount());
+
+        queue.Flush();
+
+        Assert::IsTrue(IsReady(result2));
+        Assert::IsTrue(IsReady(result3));
+        Assert::AreEqual<uint32_t>(0, queue.GetPendingCount());
+
+        for (auto& stagingBitmap : f.StagingBitmaps)
+        {
+            Assert::AreEqual(1, stagingBitmap->MapCount);
+            Assert::IsFalse(stagingBitmap->IsMapped);
+        }
+    }
+
+    TEST_METHOD_EX(PixelReadbackQueue_WhenLatencyIsZero_ReadbacksCompleteImmediately)
+    {
+        Fixture f;
+        PixelReadbackQueue queue(0);
+
+        auto result = queue.Enqueue(f.Bitmap.Get());
+
+        Assert::IsTrue(IsReady(result));
+        Assert::AreEqual<uint32_t>(0, queue.GetPendingCount());
+    }
+
+    TEST_METHOD_EX(PixelReadbackQueue_Result_ContainsTightlyPackedPixelBytes)
+    {
+        Fixture f;
+        PixelReadbackQueue queue;
+
+        auto result = queue.Enqueue(f.Bitmap.Get(), D2D1::RectU(2, 1, 5, 4));
+        queue.Flush();
+
+        auto bytes = result.Get();
+
+        // 3x3 pixels, at 4 bytes each, copied from the top left of the staging bitmap.
+        auto& stagingPixels = f.StagingBitmaps[0]->Pixels;
+
+        Assert::AreEqual<size_t>(3 * 3 * 4, bytes.size());
+
+        for (uint32_t y = 0; y < 3; y++)
+        {
+            for (uint32_t x = 0; x < 3 * 4; x++)
+            {
+                Assert::AreEqual(stagingPixels[y * ReadbackD2DBitmap::Pitch + x], bytes[y * 3 * 4 + x]);
+            }
+        }
+    }
+
+    TEST_METHOD_EX(PixelReadbackQueue_MapFailure_IsReportedThroughFuture)
+    {
+        Fixture f;
+        PixelReadbackQueue queue;
+
+        auto result1 = queue.Enqueue(f.Bitmap.Get());
+        auto result2 = queue.Enqueue(f.Bitmap.Get());
+
+        f.StagingBitmaps[0]->MapResult = DXGI_ERROR_DEVICE_REMOVED;
+
+        queue.Flush();
+
+        ExpectHResultException(DXGI_ERROR_DEVICE_REMOVED, [&] { result1.Get(); });
+
+        // Later readbacks are unaffected.
+        Assert::AreEqual<size_t>(8 * 8 * 4, result2.Get().size());
+    }
+
+    TEST_METHOD_EX(PixelReadbackQueue_Get_CompletesReadbacksInOrderWithoutFlush)
+    {
+        Fixture f;
+        PixelReadbackQueue queue(2);
+
+        auto result1 = queue.Enqueue(f.Bitmap.Get());
+        auto result2 = queue.Enqueue(f.Bitmap.Get());
+
+        // Asking for the newest result on the same thread must not wait for a later Enqueue or Flush.
+        Assert::AreEqual<size_t>(8 * 8 * 4, result2.Get().size());
+
+        // Older readbacks are mapped first.
+        Assert::IsTrue(IsReady(result1));
+        Assert::AreEqual(1, f.StagingBitmaps[0]->MapCount);
+        Assert::AreEqual(1, f.StagingBitmaps[1]->MapCount);
+        Assert::AreEqual<uint32_t>(0, queue.GetPendingCount());
+
+        // Newer readbacks are left in flight.
+        auto result3 = queue.Enqueue(f.Bitmap.Get());
+        auto result4 = queue.Enqueue(f.Bitmap.Get());
+
+        result3.Wait();
+
+        Assert::IsTrue(IsReady(result3));
+        Assert::IsFalse(IsReady(result4));
+        Assert::AreEqual(0, f.StagingBitmaps[3]->MapCount);
+        Assert::AreEqual<uint32_t>(1, queue.GetPendingCount());
+
+        // Results that are already complete are returned as is.
+        Assert::AreEqual<size_t>(8 * 8 * 4, result1.Get().size());
+        Assert::AreEqual(1, f.StagingBitmaps[0]->MapCount);
+
+        queue.Flush();
+
+        Assert::IsTrue(IsReady(result4));
+    }
+
+    TEST_METHOD_EX(PixelReadbackQueue_InvalidSubrectangle_Throws)
+    {
+        Fixture f;
+        PixelReadbackQueue queue;
+
+        f.Device->LeaseStagingBitmapMethod.SetExpectedCalls(0);
+
+        ExpectHResultException(E_INVALIDARG, [&] { queue.Enqueue(f.Bitmap.Get(), D2D1::RectU(0, 0, 9, 8)); });
+        ExpectHResultException(E_INVALIDARG, [&] { queue.Enqueue(f.Bitmap.Get(), D2D1::RectU(4, 0, 4, 8)); });
+
+        Assert::AreEqual<uint32_t>(0, queue.GetPendingCount());
+    }
+
+    TEST_METHOD_EX(PixelReadbackQueue_ClosedBitmap_Throws)
+    {
+        Fixture f;
+        PixelReadbackQueue queue;
+
+        ThrowIfFailed(f.Bitmap->Close());
+
+        ExpectHResultException(RO_E_CLOSED, [&] { queue.Enqueue(f.Bitmap.Get()); });
+    }
+
+    TEST_METHOD_EX(PixelReadbackQueue_Close_AbandonsReadbacksInFlight)
+    {
+        Fixture f;
+        PixelReadbackQueue queue;
+
+        auto result = queue.Enqueue(f.Bitmap.Get());
+
+        queue.Close();
+
+        Assert::AreEqual<uint32_t>(0, queue.GetPendingCount());
+        Assert::AreEqual(0, f.StagingBitmaps[0]->MapCount);
+
+        try
+        {
+            result.Get();
+            Assert::Fail(L"Expected this to throw.");
+        }
+        catch (std::future_error const& e)
+        {
+            Assert::IsTrue(e.code() == std::future_errc::broken_promise);
+        }
+    }
+
+    TEST_METHOD_EX(PixelReadbackQueue_GetPixelBytesAsync_EnqueuesOnDeviceQueue)
+    {
+        Fixture f;
+        PixelReadbackQueue deviceQueue;
+
+        f.Device->EnqueuePixelReadbackMethod.SetExpectedCalls(2,
+            [&](ICanvasBitmap* bitmap, D2D1_RECT_U const& subRectangle)
+            {
+                Assert::IsTrue(IsSameInstance(f.Bitmap.Get(), bitmap));
+                return deviceQueue.Enqueue(bitmap, subRectangle);
+            });
+
+        auto buffer = Make<StubBuffer>(8 * 8 * 4);
+
+        ComPtr<IAsyncAction> action1;
+        ComPtr<IAsyncAction> action2;
+        ThrowIfFailed(f.Bitmap->GetPixelBytesAsync(buffer.Get(), &action1));
+        ThrowIfFailed(f.Bitmap->GetPixelBytesWithSubrectangleAsync(buffer.Get(), 2, 1, 3, 3, &action2));
+
+        Assert::AreEqual<size_t>(2, f.StagingBitmaps.size());
+
+        deviceQueue.Flush();
+    }
+
+    TEST_METHOD_EX(PixelReadbackQueue_WhenDestroyedWithReadbacksInFlight_FuturesReportBrokenPromise)
+    {
+        Fixture f;
+
+        PixelReadbackFuture result;
+
+        {
+            PixelReadbackQueue queue;
+            result = queue.Enqueue(f.Bitmap.Get());
+        }
+
+        Assert::AreEqual(0, f.StagingBitmaps[0]->MapCount);
+
+        try
+        {
+            result.Get();
+            Assert::Fail(L"Expected this to throw.");
+        }
+        catch (std::future_error const& e)
+        {
+            Assert::IsTrue(e.code() == std::future_errc::broken_promise);
+        }
+    }
+};
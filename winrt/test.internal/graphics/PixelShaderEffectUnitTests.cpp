@@ -9,6 +9,9 @@
 #include <lib/effects/shader/PixelShaderTransform.h>
 #include <lib/effects/shader/ClipTransform.h>
 #include <lib/effects/shader/SharedShaderState.h>
+#include <lib/effects/shader/ShaderCache.h>
+#include <lib/effects/shader/ShaderPackage.h>
+#include <lib/effects/shader/ShaderRectMapping.h>
 
 #include "mocks/MockD2DDrawInfo.h"
 #include "mocks/MockD2DEffectContext.h"
@@ -267,6 +270,183 @@ TEST_CLASS(PixelShaderEffectUnitTests)
     }
 
 
+    TEST_METHOD_EX(PixelShaderEffect_HandlePropertyChangesArePassedThroughToD2D)
+    {
+        Fixture f;
+
+        // Construct a shader description containing one float variable.
+        D3D11_SHADER_VARIABLE_DESC variableDesc = { "foo", 0, sizeof(float) };
+        D3D11_SHADER_TYPE_DESC variableType = { D3D_SVC_SCALAR, D3D_SVT_FLOAT, 1, 1 };
+
+        ShaderVariable variable(variableDesc, variableType);
+
+        ShaderDescription desc;
+        desc.Variables.push_back(variable);
+
+        auto sharedState = MakeSharedShaderState(desc, std::vector<BYTE>(sizeof(float)));
+        auto effect = Make<PixelShaderEffect>(nullptr, nullptr, sharedState.Get());
+
+        uint32_t handle;
+        ThrowIfFailed(effect->GetPropertyHandle(HStringReference(L"foo").Get(), &handle));
+
+        Assert::AreEqual(E_INVALIDARG, effect->GetPropertyHandle(HStringReference(L"bar").Get(), &handle));
+        Assert::AreEqual(E_INVALIDARG, effect->GetPropertyHandle(HStringReference(L"foo").Get(), nullptr));
+
+        // Set the value before realizing.
+        ThrowIfFailed(effect->SetFloat(handle, 3));
+
+        effect->GetD2DImage(f.CanvasDevice.Get(), f.DeviceContext.Get(), GetImageFlags::None, 0, nullptr);
+
+        auto& d2dConstants = f.GetEffectPropertyValue<float>(PixelShaderEffectProperty::Constants);
+        Assert::AreEqual(3.0f, d2dConstants);
+
+        // Changes made after realization should immediately be passed along to D2D.
+        ThrowIfFailed(effect->SetFloat(handle, 5));
+        Assert::AreEqual(5.0f, d2dConstants);
+
+        // Handles must match the type of the property.
+        Assert::AreEqual(E_INVALIDARG, effect->SetVector2(handle, Vector2{ 1, 2 }));
+        Assert::AreEqual(5.0f, d2dConstants);
+
+        // Values set through handles are visible via the property map.
+        ComPtr<IMap<HSTRING, IInspectable*>> properties;
+        ThrowIfFailed(effect->get_Properties(&properties));
+
+        ComPtr<IInspectable> value;
+        ThrowIfFailed(properties->Lookup(HStringReference(L"foo").Get(), &value));
+
+        float unboxed;
+        ThrowIfFailed(As<IReference<float>>(value)->get_Value(&unboxed));
+        Assert::AreEqual(5.0f, unboxed);
+    }
+
+
+    TEST_METHOD_EX(PixelShaderEffect_BatchedPropertyChangesArePassedThroughToD2D)
+    {
+        Fixture f;
+
+        // Construct a shader description containing two float variables.
+        D3D11_SHADER_VARIABLE_DESC variableDescA = { "a", 0, sizeof(float) };
+        D3D11_SHADER_VARIABLE_DESC variableDescB = { "b", sizeof(float), sizeof(float) };
+        D3D11_SHADER_TYPE_DESC variableType = { D3D_SVC_SCALAR, D3D_SVT_FLOAT, 1, 1 };
+
+        ShaderDescription desc;
+        desc.Variables.push_back(ShaderVariable(variableDescA, variableType));
+        desc.Variables.push_back(ShaderVariable(variableDescB, variableType));
+
+        struct Constants
+        {
+            float A;
+            float B;
+        };
+
+        auto sharedState = MakeSharedShaderState(desc, std::vector<BYTE>(sizeof(Constants)));
+        auto effect = Make<PixelShaderEffect>(nullptr, nullptr, sharedState.Get());
+
+        effect->GetD2DImage(f.CanvasDevice.Get(), f.DeviceContext.Get(), GetImageFlags::None, 0, nullptr);
+
+        auto& d2dConstants = f.GetEffectPropertyValue<Constants>(PixelShaderEffectProperty::Constants);
+
+        // Changes made while an update scope is open are held back until it is closed.
+        ComPtr<IMap<HSTRING, IInspectable*>> properties;
+        ThrowIfFailed(effect->get_Properties(&properties));
+
+        ComPtr<IPixelShaderEffectUpdateScope> outerScope;
+        ComPtr<IPixelShaderEffectUpdateScope> innerScope;
+
+        ThrowIfFailed(effect->BeginUpdate(&outerScope));
+        ThrowIfFailed(effect->BeginUpdate(&innerScope));
+
+        uint32_t handleB;
+        ThrowIfFailed(effect->GetPropertyHandle(HStringReference(L"b").Get(), &handleB));
+
+        boolean replaced;
+        ThrowIfFailed(properties->Insert(HStringReference(L"a").Get(), Make<Nullable<float>>(1.0f).Get(), &replaced));
+        ThrowIfFailed(effect->SetFloat(handleB, 2.0f));
+
+        ThrowIfFailed(As<IClosable>(innerScope)->Close());
+
+        Assert::AreEqual(0.0f, d2dConstants.A);
+        Assert::AreEqual(0.0f, d2dConstants.B);
+
+        // Closing a scope twice does not end the outer update.
+        ThrowIfFailed(As<IClosable>(innerScope)->Close());
+
+        Assert::AreEqual(0.0f, d2dConstants.A);
+        Assert::AreEqual(0.0f, d2dConstants.B);
+
+        ThrowIfFailed(As<IClosable>(outerScope)->Close());
+
+        Assert::AreEqual(1.0f, d2dConstants.A);
+        Assert::AreEqual(2.0f, d2dConstants.B);
+
+        // SetProperties applies all its values at once.
+        auto values = Make<Map<HSTRING, IInspectable*>>();
+
+        ThrowIfFailed(values->Insert(HStringReference(L"b").Get(), Make<Nullable<float>>(4.0f).Get(), &replaced));
+        ThrowIfFailed(values->Insert(HStringReference(L"a").Get(), Make<Nullable<float>>(3.0f).Get(), &replaced));
+
+        ThrowIfFailed(effect->SetProperties(values.Get()));
+
+        Assert::AreEqual(3.0f, d2dConstants.A);
+        Assert::AreEqual(4.0f, d2dConstants.B);
+
+        // If any value is invalid, none are applied.
+        ThrowIfFailed(values->Insert(HStringReference(L"c").Get(), Make<Nullable<float>>(5.0f).Get(), &replaced));
+        ThrowIfFailed(values->Insert(HStringReference(L"b").Get(), Make<Nullable<float>>(6.0f).Get(), &replaced));
+
+        Assert::AreEqual(E_INVALIDARG, effect->SetProperties(values.Get()));
+        Assert::AreEqual(E_INVALIDARG, effect->SetProperties(nullptr));
+
+        Assert::AreEqual(3.0f, d2dConstants.A);
+        Assert::AreEqual(4.0f, d2dConstants.B);
+        Assert::AreEqual(4.0f, reinterpret_cast<Constants const*>(sharedState->Constants().data())->B);
+    }
+
+
+    TEST_METHOD_EX(PixelShaderEffect_UpdateScope_EndsUpdateWhenReleased)
+    {
+        Fixture f;
+
+        D3D11_SHADER_VARIABLE_DESC variableDesc = { "foo", 0, sizeof(float) };
+        D3D11_SHADER_TYPE_DESC variableType = { D3D_SVC_SCALAR, D3D_SVT_FLOAT, 1, 1 };
+
+        ShaderDescription desc;
+        desc.Variables.push_back(ShaderVariable(variableDesc, variableType));
+
+        auto sharedState = MakeSharedShaderState(desc, std::vector<BYTE>(sizeof(float)));
+        auto effect = Make<PixelShaderEffect>(nullptr, nullptr, sharedState.Get());
+
+        effect->GetD2DImage(f.CanvasDevice.Get(), f.DeviceContext.Get(), GetImageFlags::None, 0, nullptr);
+
+        auto& d2dConstants = f.GetEffectPropertyValue<float>(PixelShaderEffectProperty::Constants);
+
+        uint32_t handle;
+        ThrowIfFailed(effect->GetPropertyHandle(HStringReference(L"foo").Get(), &handle));
+
+        Assert::AreEqual(E_INVALIDARG, effect->BeginUpdate(nullptr));
+
+        // An exception thrown part way through a batch must not leave the effect holding back changes.
+        ExpectHResultException(E_FAIL, [&]
+        {
+            ComPtr<IPixelShaderEffectUpdateScope> scope;
+            ThrowIfFailed(effect->BeginUpdate(&scope));
+
+            ASSERT_IMPLEMENTS_INTERFACE(scope, IClosable);
+
+            ThrowIfFailed(effect->SetFloat(handle, 3));
+            Assert::AreEqual(0.0f, d2dConstants);
+
+            ThrowHR(E_FAIL);
+        });
+
+        Assert::AreEqual(3.0f, d2dConstants);
+
+        ThrowIfFailed(effect->SetFloat(handle, 5));
+        Assert::AreEqual(5.0f, d2dConstants);
+    }
+
+
     TEST_METHOD_EX(PixelShaderEffect_CoordinateMappingChangesArePassedThroughToD2D)
     {
         Fixture f;
@@ -672,6 +852,16 @@ public:
         mockDrawInfo->SetPixelShaderConstantBufferMethod.SetExpectedCalls(1, validateConstants);
 
         ThrowIfFailed(impl->PrepareForRender(D2D1_CHANGE_TYPE_NONE));
+
+        Expectations::Instance()->Validate();
+
+        // Unchanged values are filtered out by PixelShaderEffect before they reach
+        // the blob property, so any set is treated as a change and uploaded.
+        ThrowIfFailed(binding.setFunction(impl.Get(), constants.data(), static_cast<unsigned>(constants.size())));
+
+        mockDrawInfo->SetPixelShaderConstantBufferMethod.SetExpectedCalls(1, validateConstants);
+
+        ThrowIfFailed(impl->PrepareForRender(D2D1_CHANGE_TYPE_NONE));
     }
 
 
@@ -1279,185 +1469,906 @@ public:
 };
 
 
-// The following tests only do minimal validation across the different shader property types,
-// numbers of inputs, default value initialization, and property accessor methods.
-// Full validation for these things occurs in test.managed: EffectTests.cs.
-// This test only exists to check a handful of internal things the managed tests can't access.
-
-static std::vector<BYTE> compiledShader1;
-static std::vector<BYTE> compiledShader2;
-
-
-TEST_CLASS(SharedShaderStateUnitTests)
+TEST_CLASS(ShaderRectMappingUnitTests)
 {
-    TEST_CLASS_INITIALIZE(Initialize)
+    // Per-input reference implementation of output to input rect mapping, as used by PixelShaderTransform.
+    static HRESULT ReferenceMapOutputRectToInputRects(CoordinateMappingState const& state, D2D1_RECT_L const& outputRect, D2D1_RECT_L* inputRects, unsigned inputCount)
     {
-#define HLSL(quote) #quote
-
-        static char const* shader1 = HLSL
-        (
-            cbuffer constants : register(b0)
+        return ExceptionBoundary([&]
+        {
+            for (unsigned i = 0; i < inputCount; i++)
             {
-                float f                    : packoffset(c0.x);
-                int i                      : packoffset(c0.y);
-                bool b                     : packoffset(c0.z);
-                row_major float4x4 rows    : packoffset(c1);
-                column_major float4x4 cols : packoffset(c5);
-                row_major int2x4 irows     : packoffset(c9);
-                column_major int2x4 icols  : packoffset(c11);
-            };
+                switch (state.Mapping[i])
+                {
+                case SamplerCoordinateMapping::Unknown:
+                    inputRects[i] = D2D_RECT_L{ INT_MIN, INT_MIN, INT_MAX, INT_MAX };
+                    break;
 
-            float4 main() : SV_Target
-            {
-                return rows._11 * cols._11 * f * i * b;
-            }
-        );
+                case SamplerCoordinateMapping::OneToOne:
+                    inputRects[i] = outputRect;
+                    break;
 
-        static char const* shader2 = HLSL
-        (
-            float4 main() : SV_Target
-            {
-                return 0;
-            }
-        );
+                case SamplerCoordinateMapping::Offset:
+                    inputRects[i] = ExpandRectangle(outputRect, state.MaxOffset);
+                    break;
 
-        compiledShader1 = CompileShader(shader1);
-        compiledShader2 = CompileShader(shader2);
+                default:
+                    ThrowHR(E_INVALIDARG);
+                }
+            }
+        });
     }
 
 
-    static std::vector<BYTE> CompileShader(char const* shaderCode)
+    // Per-input reference implementation of input to output rect mapping, as used by ClipTransform.
+    static HRESULT ReferenceMapInputRectsToOutputRect(CoordinateMappingState const& state, D2D1_RECT_L const* inputRects, unsigned inputCount, D2D1_RECT_L* outputRect)
     {
-        ComPtr<ID3DBlob> result;
-
-        ThrowIfFailed(D3DCompile(shaderCode, strlen(shaderCode), nullptr, nullptr, nullptr, "main", "ps_4_0", 0, 0, &result, nullptr));
+        return ExceptionBoundary([&]
+        {
+            D2D_RECT_L accumulatedRect = { INT_MIN, INT_MIN, INT_MAX, INT_MAX };
+            bool gotRect = false;
+            bool gotOffset = false;
 
-        auto buffer = reinterpret_cast<BYTE*>(result->GetBufferPointer());
+            for (unsigned i = 0; i < inputCount; i++)
+            {
+                D2D_RECT_L rect;
 
-        return std::vector<BYTE>(buffer, buffer + result->GetBufferSize());
-    }
+                switch (state.Mapping[i])
+                {
+                case SamplerCoordinateMapping::Unknown:
+                    continue;
 
+                case SamplerCoordinateMapping::OneToOne:
+                    rect = inputRects[i];
+                    break;
 
-    TEST_METHOD_EX(SharedShaderState_Clone)
-    {
-        ShaderDescription desc;
-        desc.InputCount = 73;
+                case SamplerCoordinateMapping::Offset:
+                    if (!state.MaxOffset)
+                        ThrowHR(E_INVALIDARG);
 
-        std::vector<BYTE> constants = { 29 };
+                    switch (state.BorderMode[i])
+                    {
+                    case EffectBorderMode::Soft:
+                        rect = ExpandRectangle(inputRects[i], state.MaxOffset);
+                        break;
 
-        CoordinateMappingState coordinateMapping;
-        coordinateMapping.MaxOffset = 23;
+                    case EffectBorderMode::Hard:
+                        rect = inputRects[i];
+                        break;
 
-        SourceInterpolationState sourceInterpolation;
-        sourceInterpolation.Filter[0] = D2D1_FILTER_ANISOTROPIC;
+                    default:
+                        ThrowHR(E_INVALIDARG);
+                    }
 
-        auto originalState = MakeSharedShaderState(desc, constants, coordinateMapping, sourceInterpolation);
+                    gotOffset = true;
+                    break;
 
-        Assert::AreEqual(desc.InputCount, originalState->Shader().InputCount);
-        Assert::AreEqual<size_t>(1, originalState->Constants().size());
-        Assert::AreEqual(constants[0], originalState->Constants()[0]);
-        Assert::AreEqual(coordinateMapping.MaxOffset, originalState->CoordinateMapping().MaxOffset);
-        Assert::AreEqual<int>(sourceInterpolation.Filter[0], originalState->SourceInterpolation().Filter[0]);
+                default:
+                    ThrowHR(E_INVALIDARG);
+                }
 
-        auto clone = originalState->Clone();
+                accumulatedRect = gotRect ? RectangleUnion(accumulatedRect, rect) : rect;
+                gotRect = true;
+            }
 
-        Assert::AreEqual(desc.InputCount, clone->Shader().InputCount);
-        Assert::AreEqual<size_t>(1, clone->Constants().size());
-        Assert::AreEqual(constants[0], clone->Constants()[0]);
-        Assert::AreEqual(coordinateMapping.MaxOffset, clone->CoordinateMapping().MaxOffset);
-        Assert::AreEqual<int>(sourceInterpolation.Filter[0], clone->SourceInterpolation().Filter[0]);
+            if (state.MaxOffset && !gotOffset)
+                ThrowHR(E_INVALIDARG);
 
-        Assert::AreNotEqual<void const*>(&originalState->Shader(), &clone->Shader());
-        Assert::AreNotEqual<void const*>(&originalState->Constants(), &clone->Constants());
-        Assert::AreNotEqual<void const*>(&originalState->CoordinateMapping(), &clone->CoordinateMapping());
-        Assert::AreNotEqual<void const*>(&originalState->SourceInterpolation(), &clone->SourceInterpolation());
-    };
+            *outputRect = accumulatedRect;
+        });
+    }
 
 
-    TEST_METHOD_EX(SharedShaderState_Hashing)
+    static void ValidateAgainstReference(CoordinateMappingState const& state, unsigned inputCount, D2D1_RECT_L const* rects, unsigned rectCount)
     {
-        auto state1a = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
-        auto state1b = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
-        
-        auto state2a = Make<SharedShaderState>(compiledShader2.data(), static_cast<unsigned>(compiledShader2.size()));
-        auto state2b = Make<SharedShaderState>(compiledShader2.data(), static_cast<unsigned>(compiledShader2.size()));
+        ShaderRectMapping mapping(state, inputCount);
 
-        Assert::AreEqual(state1a->Shader().Hash, state1b->Shader().Hash);
-        Assert::AreEqual(state2a->Shader().Hash, state2b->Shader().Hash);
+        Assert::AreEqual(inputCount, mapping.GetInputCount());
 
-        Assert::AreNotEqual(state1a->Shader().Hash, state2a->Shader().Hash);
-    };
+        for (unsigned r = 0; r < rectCount; r++)
+        {
+            // Output to input mapping is the same for every rect in the set.
+            D2D1_RECT_L expectedInputs[MaxShaderInputs];
+            D2D1_RECT_L actualInputs[MaxShaderInputs];
 
+            ThrowIfFailed(ReferenceMapOutputRectToInputRects(state, rects[r], expectedInputs, inputCount));
 
-    TEST_METHOD_EX(SharedShaderState_ShaderReflection)
-    {
-        auto state = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+            mapping.MapOutputRectToInputRects(rects[r], actualInputs);
 
-        Assert::AreEqual(compiledShader1, state->Shader().Code);
-        Assert::AreEqual(0u, state->Shader().InputCount);
-        Assert::IsTrue(state->Shader().InstructionCount > 3 && state->Shader().InstructionCount < 20);
-        Assert::AreEqual<int>(D3D_FEATURE_LEVEL_10_0, state->Shader().MinFeatureLevel);
+            for (unsigned i = 0; i < inputCount; i++)
+            {
+                Assert::AreEqual(expectedInputs[i], actualInputs[i]);
+            }
 
-        auto& variables = state->Shader().Variables;
+            // Input to output mapping takes a different rect for each input.
+            D2D1_RECT_L inputs[MaxShaderInputs];
 
-        Assert::AreEqual<size_t>(7, variables.size());
+            for (unsigned i = 0; i < inputCount; i++)
+            {
+                inputs[i] = rects[(r + i) % rectCount];
+            }
 
-        // The variable list is sorted, so indices are alphabetical.
-        ValidateVariable(variables[2], L"f",     D3D_SVC_SCALAR,         D3D_SVT_FLOAT, 1, 1, 0, 4,  0);
-        ValidateVariable(variables[3], L"i",     D3D_SVC_SCALAR,         D3D_SVT_INT,   1, 1, 0, 4,  4);
-        ValidateVariable(variables[0], L"b",     D3D_SVC_SCALAR,         D3D_SVT_BOOL,  1, 1, 0, 4,  8);
-        ValidateVariable(variables[6], L"rows",  D3D_SVC_MATRIX_ROWS,    D3D_SVT_FLOAT, 4, 4, 0, 64, 16);
-        ValidateVariable(variables[1], L"cols",  D3D_SVC_MATRIX_COLUMNS, D3D_SVT_FLOAT, 4, 4, 0, 64, 80);
-        ValidateVariable(variables[5], L"irows", D3D_SVC_MATRIX_ROWS,    D3D_SVT_INT,   2, 4, 0, 32, 144);
-        ValidateVariable(variables[4], L"icols", D3D_SVC_MATRIX_COLUMNS, D3D_SVT_INT,   2, 4, 0, 56, 176);
-    };
+            D2D1_RECT_L expectedOutput{};
+            D2D1_RECT_L actualOutput{};
 
+            auto expectedHr = ReferenceMapInputRectsToOutputRect(state, inputs, inputCount, &expectedOutput);
 
-    static void ValidateVariable(ShaderVariable const& variable, 
-                                 std::wstring expectedName,
-                                 D3D_SHADER_VARIABLE_CLASS expectedClass, 
-                                 D3D_SHADER_VARIABLE_TYPE expectedType,
-                                 unsigned expectedRows, 
-                                 unsigned expectedColumns, 
-                                 unsigned expectedElements,
-                                 unsigned expectedSize, 
-                                 unsigned expectedOffset)
-    {
-        Assert::AreEqual<std::wstring>(expectedName, static_cast<wchar_t const*>(variable.Name));
-        Assert::AreEqual<int>(expectedClass, variable.Class);
-        Assert::AreEqual<int>(expectedType, variable.Type);
-        Assert::AreEqual(expectedRows, variable.Rows);
-        Assert::AreEqual(expectedColumns, variable.Columns);
-        Assert::AreEqual(expectedElements, variable.Elements);
-        Assert::AreEqual(expectedSize, variable.Size);
-        Assert::AreEqual(expectedOffset, variable.Offset);
+            auto actualHr = ExceptionBoundary([&]
+            {
+                actualOutput = mapping.MapInputRectsToOutputRect(inputs);
+            });
+
+            Assert::AreEqual(expectedHr, actualHr);
+            Assert::AreEqual(expectedOutput, actualOutput);
+        }
     }
 
 
-    TEST_METHOD_EX(SharedShaderState_ConstantBufferLayout)
+    static D2D1_RECT_L const* TestRects(unsigned* count)
     {
-        // Layout of this struct matches the compiledShader1 constant buffer.
-        struct ConstantBuffer
+        static const D2D1_RECT_L rects[] =
         {
-            float f;
-            int i;
-            int b;
-            int _pad;
+            { 0, 0, 0, 0 },
+            { 1, 2, 3, 4 },
+            { -10, -20, 30, 40 },
+            { 50, 200, 79, 210 },
+            { -3, 210, 50, 220 },
+            { 5, 5, -5, -5 },
+            { INT_MIN, INT_MIN, INT_MAX, INT_MAX },
+            { INT_MIN + 1, -1, INT_MAX - 1, 1 },
+            { INT_MAX - 2, INT_MIN, INT_MAX, INT_MIN + 2 },
+        };
 
-            float rows[16];
-            float cols[16];
+        *count = _countof(rects);
 
-            int irows[8];
-            int icols[14];
+        return rects;
+    }
 
-            int _pad2[2];
+public:
+    TEST_METHOD_EX(ShaderRectMapping_MatchesPerInputMapping_AllModeCombinations)
+    {
+        const SamplerCoordinateMapping mappings[] =
+        {
+            SamplerCoordinateMapping::Unknown,
+            SamplerCoordinateMapping::OneToOne,
+            SamplerCoordinateMapping::Offset,
         };
 
-        auto state = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+        const EffectBorderMode borderModes[] =
+        {
+            EffectBorderMode::Soft,
+            EffectBorderMode::Hard,
+        };
 
-        Assert::AreEqual(sizeof(ConstantBuffer), state->Constants().size());
+        const int maxOffsets[] = { 0, 1, 7, -3, INT_MAX };
 
-        auto constants = reinterpret_cast<ConstantBuffer const*>(state->Constants().data());
+        const unsigned testInputCount = 3;
+        const unsigned modeCount = _countof(mappings) * _countof(borderModes);
+
+        unsigned rectCount;
+        auto rects = TestRects(&rectCount);
+
+        // Every combination of mapping and border mode across three inputs, for each input count and offset.
+        unsigned combinationCount = 1;
+
+        for (unsigned i = 0; i < testInputCount; i++)
+        {
+            combinationCount *= modeCount;
+        }
+
+        for (unsigned combination = 0; combination < combinationCount; combination++)
+        {
+            CoordinateMappingState state;
+
+            auto remaining = combination;
+
+            for (unsigned i = 0; i < testInputCount; i++)
+            {
+                auto mode = remaining % modeCount;
+                remaining /= modeCount;
+
+                state.Mapping[i] = mappings[mode % _countof(mappings)];
+                state.BorderMode[i] = borderModes[mode / _countof(mappings)];
+            }
+
+            for (auto maxOffset : maxOffsets)
+            {
+                state.MaxOffset = maxOffset;
+
+                for (unsigned inputCount = 0; inputCount <= testInputCount; inputCount++)
+                {
+                    ValidateAgainstReference(state, inputCount, rects, rectCount);
+                }
+            }
+        }
+    }
+
+
+    TEST_METHOD_EX(ShaderRectMapping_MatchesPerInputMapping_MaxInputs)
+    {
+        unsigned rectCount;
+        auto rects = TestRects(&rectCount);
+
+        CoordinateMappingState state;
+
+        for (unsigned seed = 0; seed < 64; seed++)
+        {
+            for (unsigned i = 0; i < MaxShaderInputs; i++)
+            {
+                state.Mapping[i] = static_cast<SamplerCoordinateMapping>((seed + i * 7) % 3);
+                state.BorderMode[i] = static_cast<EffectBorderMode>((seed >> i) & 1);
+            }
+
+            state.MaxOffset = seed % 5;
+
+            ValidateAgainstReference(state, MaxShaderInputs, rects, rectCount);
+        }
+    }
+
+
+    TEST_METHOD_EX(ShaderRectMapping_MapOutputRectsToInputRects_MatchesSingleRectMapping)
+    {
+        CoordinateMappingState state;
+
+        state.Mapping[0] = SamplerCoordinateMapping::Offset;
+        state.Mapping[1] = SamplerCoordinateMapping::Unknown;
+        state.Mapping[2] = SamplerCoordinateMapping::OneToOne;
+        state.MaxOffset = 3;
+
+        const unsigned inputCount = 3;
+
+        ShaderRectMapping mapping(state, inputCount);
+
+        unsigned rectCount;
+        auto rects = TestRects(&rectCount);
+
+        std::vector<D2D1_RECT_L> batched(rectCount * inputCount);
+
+        mapping.MapOutputRectsToInputRects(rects, rectCount, batched.data());
+
+        for (unsigned r = 0; r < rectCount; r++)
+        {
+            D2D1_RECT_L expected[inputCount];
+
+            mapping.MapOutputRectToInputRects(rects[r], expected);
+
+            for (unsigned i = 0; i < inputCount; i++)
+            {
+                Assert::AreEqual(expected[i], batched[r * inputCount + i]);
+            }
+        }
+    }
+
+
+    TEST_METHOD_EX(ShaderRectMapping_InvalidArguments)
+    {
+        CoordinateMappingState state;
+
+        ExpectHResultException(E_INVALIDARG, [&] { ShaderRectMapping(state, MaxShaderInputs + 1); });
+
+        state.Mapping[1] = static_cast<SamplerCoordinateMapping>(23);
+
+        ExpectHResultException(E_INVALIDARG, [&] { ShaderRectMapping(state, 2); });
+
+        // Invalid mappings beyond the input count are ignored.
+        ShaderRectMapping(state, 1);
+
+        // Invalid border modes only matter when mapping inputs forward with Offset mapping.
+        state.Mapping[1] = SamplerCoordinateMapping::Offset;
+        state.BorderMode[1] = static_cast<EffectBorderMode>(23);
+        state.MaxOffset = 1;
+
+        ShaderRectMapping mapping(state, 2);
+
+        D2D1_RECT_L rects[2] = {};
+
+        mapping.MapOutputRectToInputRects(D2D1_RECT_L{ 1, 2, 3, 4 }, rects);
+
+        ExpectHResultException(E_INVALIDARG, [&] { mapping.MapInputRectsToOutputRect(rects); });
+    }
+};
+
+
+// The following tests only do minimal validation across the different shader property types,
+// numbers of inputs, default value initialization, and property accessor methods.
+// Full validation for these things occurs in test.managed: EffectTests.cs.
+// This test only exists to check a handful of internal things the managed tests can't access.
+
+TEST_CLASS(ShaderCacheUnitTests)
+{
+    static CachedShader MakeCachedShader(BYTE code, int guidValue)
+    {
+        auto shader = std::make_shared<ShaderDescription>();
+
+        shader->Code.assign(1, code);
+        shader->Hash = IID{ static_cast<unsigned long>(guidValue) };
+
+        return CachedShader{ shader, std::make_shared<std::vector<BYTE>>(1, code) };
+    }
+
+    TEST_METHOD_EX(ShaderCache_LookupAfterInsert)
+    {
+        ShaderCache cache;
+
+        auto shader = MakeCachedShader(1, 1);
+
+        Assert::IsNull(cache.Lookup(shader.Shader->Hash, shader.Shader->Code.data(), 1).Shader.get());
+
+        auto inserted = cache.Insert(shader);
+        Assert::AreEqual<void const*>(shader.Shader.get(), inserted.Shader.get());
+
+        auto found = cache.Lookup(shader.Shader->Hash, shader.Shader->Code.data(), 1);
+        Assert::AreEqual<void const*>(shader.Shader.get(), found.Shader.get());
+        Assert::AreEqual<void const*>(shader.Constants.get(), found.Constants.get());
+
+        auto statistics = cache.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.Hits);
+        Assert::AreEqual<uint64_t>(1, statistics.Misses);
+        Assert::AreEqual(1u, statistics.CachedShaderCount);
+    }
+
+    TEST_METHOD_EX(ShaderCache_InsertReturnsExistingEntry)
+    {
+        ShaderCache cache;
+
+        auto shader1 = MakeCachedShader(1, 1);
+        auto shader2 = MakeCachedShader(1, 1);
+
+        cache.Insert(shader1);
+
+        auto result = cache.Insert(shader2);
+        Assert::AreEqual<void const*>(shader1.Shader.get(), result.Shader.get());
+    }
+
+    TEST_METHOD_EX(ShaderCache_LookupComparesShaderCode)
+    {
+        ShaderCache cache;
+
+        auto shader = MakeCachedShader(1, 1);
+        cache.Insert(shader);
+
+        BYTE otherCode = 2;
+        Assert::IsNull(cache.Lookup(shader.Shader->Hash, &otherCode, 1).Shader.get());
+    }
+
+    TEST_METHOD_EX(ShaderCache_EntriesAreReleasedWhenNotRetainedOrReferenced)
+    {
+        ShaderCache cache(1);
+
+        auto shader1 = MakeCachedShader(1, 1);
+        auto shader2 = MakeCachedShader(2, 2);
+
+        auto hash1 = shader1.Shader->Hash;
+        BYTE code1 = 1;
+
+        cache.Insert(shader1);
+        cache.Insert(shader2);
+
+        // Only one shader is retained, but shader1 is still alive so remains cached.
+        auto statistics = cache.GetStatistics();
+        Assert::AreEqual(2u, statistics.CachedShaderCount);
+        Assert::AreEqual(1u, statistics.RetainedShaderCount);
+        Assert::AreEqual<uint64_t>(1, statistics.Evictions);
+
+        Assert::IsNotNull(cache.Lookup(hash1, &code1, 1).Shader.get());
+
+        // That lookup made shader1 the retained shader. Once we drop our reference
+        // and a lookup of shader2 pushes it out of the retained set, it is released.
+        shader1 = CachedShader{};
+        cache.Lookup(shader2.Shader->Hash, shader2.Shader->Code.data(), 1);
+
+        Assert::IsNull(cache.Lookup(hash1, &code1, 1).Shader.get());
+        Assert::AreEqual(1u, cache.GetStatistics().CachedShaderCount);
+    }
+
+    TEST_METHOD_EX(ShaderCache_SetMaximumRetainedCount)
+    {
+        ShaderCache cache;
+
+        Assert::AreEqual(static_cast<uint32_t>(ShaderCache::DefaultMaximumRetainedCount), cache.GetMaximumRetainedCount());
+
+        std::weak_ptr<ShaderDescription> weakShader;
+
+        {
+            auto shader = MakeCachedShader(1, 1);
+            weakShader = shader.Shader;
+            cache.Insert(shader);
+        }
+
+        Assert::IsFalse(weakShader.expired());
+
+        cache.SetMaximumRetainedCount(0);
+
+        Assert::IsTrue(weakShader.expired());
+        Assert::AreEqual(0u, cache.GetStatistics().CachedShaderCount);
+    }
+
+    TEST_METHOD_EX(ShaderCache_Clear)
+    {
+        ShaderCache cache;
+
+        auto shader = MakeCachedShader(1, 1);
+        cache.Insert(shader);
+
+        cache.Clear();
+
+        Assert::IsNull(cache.Lookup(shader.Shader->Hash, shader.Shader->Code.data(), 1).Shader.get());
+        Assert::AreEqual(0u, cache.GetStatistics().CachedShaderCount);
+    }
+};
+
+
+// Writes a shader package in the same format as tools/shaderpackage.
+static std::vector<BYTE> MakeShaderPackage(std::vector<std::pair<std::wstring, CachedShader>> const& shaders, uint32_t flags = ShaderPackageFormat::HasLinkingInfo)
+{
+    using namespace ShaderPackageFormat;
+
+    size_t variableCount = 0;
+
+    for (auto& shader : shaders)
+    {
+        variableCount += shader.second.Shader->Variables.size();
+    }
+
+    std::vector<BYTE> package(sizeof(Header) + shaders.size() * sizeof(Shader) + variableCount * sizeof(Variable));
+
+    auto addData = [&](void const* data, size_t size)
+    {
+        package.resize((package.size() + 3) & ~3);
+
+        auto offset = static_cast<uint32_t>(package.size());
+        auto bytes = static_cast<BYTE const*>(data);
+
+        package.insert(package.end(), bytes, bytes + size);
+
+        return offset;
+    };
+
+    Header header = { Magic, Version, static_cast<uint32_t>(shaders.size()), sizeof(Header) };
+    memcpy(package.data(), &header, sizeof(header));
+
+    auto variableOffset = static_cast<uint32_t>(sizeof(Header) + shaders.size() * sizeof(Shader));
+
+    for (size_t i = 0; i < shaders.size(); i++)
+    {
+        auto& name = shaders[i].first;
+        auto& description = *shaders[i].second.Shader;
+        auto& constants = *shaders[i].second.Constants;
+
+        Shader shader = {};
+
+        memcpy(shader.Hash, &description.Hash, sizeof(shader.Hash));
+        shader.NameOffset = addData(name.c_str(), name.size() * sizeof(wchar_t));
+        shader.NameLength = static_cast<uint32_t>(name.size());
+        shader.CodeOffset = addData(description.Code.data(), description.Code.size());
+        shader.CodeSize = static_cast<uint32_t>(description.Code.size());
+        shader.ConstantsOffset = addData(constants.data(), constants.size());
+        shader.ConstantsSize = static_cast<uint32_t>(constants.size());
+        shader.VariableTableOffset = variableOffset;
+        shader.VariableCount = static_cast<uint32_t>(description.Variables.size());
+        shader.InputCount = description.InputCount;
+        shader.InstructionCount = description.InstructionCount;
+        shader.MinFeatureLevel = description.MinFeatureLevel;
+        shader.Flags = flags;
+        shader.SimpleInputs = description.SimpleInputs;
+
+        memcpy(package.data() + sizeof(Header) + i * sizeof(Shader), &shader, sizeof(shader));
+
+        for (auto& variable : description.Variables)
+        {
+            auto variableName = static_cast<wchar_t const*>(variable.Name);
+            auto variableNameLength = wcslen(variableName);
+
+            Variable packageVariable =
+            {
+                addData(variableName, variableNameLength * sizeof(wchar_t)),
+                static_cast<uint32_t>(variableNameLength),
+                static_cast<uint32_t>(variable.Class),
+                static_cast<uint32_t>(variable.Type),
+                variable.Rows,
+                variable.Columns,
+                variable.Elements,
+                variable.Size,
+                variable.Offset,
+            };
+
+            memcpy(package.data() + variableOffset, &packageVariable, sizeof(packageVariable));
+
+            variableOffset += sizeof(Variable);
+        }
+    }
+
+    return package;
+}
+
+
+static std::vector<BYTE> compiledShader1;
+static std::vector<BYTE> compiledShader2;
+
+
+TEST_CLASS(SharedShaderStateUnitTests)
+{
+    TEST_CLASS_INITIALIZE(Initialize)
+    {
+#define HLSL(quote) #quote
+
+        static char const* shader1 = HLSL
+        (
+            cbuffer constants : register(b0)
+            {
+                float f                    : packoffset(c0.x);
+                int i                      : packoffset(c0.y);
+                bool b                     : packoffset(c0.z);
+                row_major float4x4 rows    : packoffset(c1);
+                column_major float4x4 cols : packoffset(c5);
+                row_major int2x4 irows     : packoffset(c9);
+                column_major int2x4 icols  : packoffset(c11);
+            };
+
+            float4 main() : SV_Target
+            {
+                return rows._11 * cols._11 * f * i * b;
+            }
+        );
+
+        static char const* shader2 = HLSL
+        (
+            float4 main() : SV_Target
+            {
+                return 0;
+            }
+        );
+
+        compiledShader1 = CompileShader(shader1);
+        compiledShader2 = CompileShader(shader2);
+    }
+
+
+    static std::vector<BYTE> CompileShader(char const* shaderCode)
+    {
+        ComPtr<ID3DBlob> result;
+
+        ThrowIfFailed(D3DCompile(shaderCode, strlen(shaderCode), nullptr, nullptr, nullptr, "main", "ps_4_0", 0, 0, &result, nullptr));
+
+        auto buffer = reinterpret_cast<BYTE*>(result->GetBufferPointer());
+
+        return std::vector<BYTE>(buffer, buffer + result->GetBufferSize());
+    }
+
+
+    // Builds a shader whose private data holds a shader linking function, the same way D2D
+    // effect shaders are compiled. Input 0 is simple and input 1 is complex.
+    static std::vector<BYTE> CompileShaderWithLinkingFunction()
+    {
+        static char const* shader = HLSL
+        (
+            float4 main() : SV_Target
+            {
+                return 0;
+            }
+        );
+
+        static char const* linkingFunction = HLSL
+        (
+            export float4 main(float4 input0 : INPUT0, float4 uv1 : TEXCOORD1)
+            {
+                return input0 * uv1;
+            }
+        );
+
+        ComPtr<ID3DBlob> shaderBlob;
+        ThrowIfFailed(D3DCompile(shader, strlen(shader), nullptr, nullptr, nullptr, "main", "ps_4_0", 0, 0, &shaderBlob, nullptr));
+
+        ComPtr<ID3DBlob> linkingBlob;
+        ThrowIfFailed(D3DCompile(linkingFunction, strlen(linkingFunction), nullptr, nullptr, nullptr, nullptr, "lib_4_0_level_9_1_ps_only", 0, 0, &linkingBlob, nullptr));
+
+        ComPtr<ID3DBlob> result;
+        ThrowIfFailed(D3DSetBlobPart(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), D3D_BLOB_PRIVATE_DATA, 0, linkingBlob->GetBufferPointer(), linkingBlob->GetBufferSize(), &result));
+
+        auto buffer = reinterpret_cast<BYTE*>(result->GetBufferPointer());
+
+        return std::vector<BYTE>(buffer, buffer + result->GetBufferSize());
+    }
+
+
+    TEST_METHOD_EX(SharedShaderState_Clone)
+    {
+        ShaderDescription desc;
+        desc.InputCount = 73;
+
+        std::vector<BYTE> constants = { 29 };
+
+        CoordinateMappingState coordinateMapping;
+        coordinateMapping.MaxOffset = 23;
+
+        SourceInterpolationState sourceInterpolation;
+        sourceInterpolation.Filter[0] = D2D1_FILTER_ANISOTROPIC;
+
+        auto originalState = MakeSharedShaderState(desc, constants, coordinateMapping, sourceInterpolation);
+
+        Assert::AreEqual(desc.InputCount, originalState->Shader().InputCount);
+        Assert::AreEqual<size_t>(1, originalState->Constants().size());
+        Assert::AreEqual(constants[0], originalState->Constants()[0]);
+        Assert::AreEqual(coordinateMapping.MaxOffset, originalState->CoordinateMapping().MaxOffset);
+        Assert::AreEqual<int>(sourceInterpolation.Filter[0], originalState->SourceInterpolation().Filter[0]);
+
+        auto clone = originalState->Clone();
+
+        Assert::AreEqual(desc.InputCount, clone->Shader().InputCount);
+        Assert::AreEqual<size_t>(1, clone->Constants().size());
+        Assert::AreEqual(constants[0], clone->Constants()[0]);
+        Assert::AreEqual(coordinateMapping.MaxOffset, clone->CoordinateMapping().MaxOffset);
+        Assert::AreEqual<int>(sourceInterpolation.Filter[0], clone->SourceInterpolation().Filter[0]);
+
+        // The shader description and constant buffer are shared, while other state is copied.
+        Assert::AreEqual<void const*>(&originalState->Shader(), &clone->Shader());
+        Assert::AreEqual<void const*>(&originalState->Constants(), &clone->Constants());
+        Assert::AreNotEqual<void const*>(&originalState->CoordinateMapping(), &clone->CoordinateMapping());
+        Assert::AreNotEqual<void const*>(&originalState->SourceInterpolation(), &clone->SourceInterpolation());
+    };
+
+
+    TEST_METHOD_EX(SharedShaderState_Clone_CopiesConstantsOnWrite)
+    {
+        auto originalState = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        originalState->SetProperty(HStringReference(L"f").Get(), Make<Nullable<float>>(1.0f).Get());
+
+        auto clone = originalState->Clone();
+
+        Assert::AreEqual<void const*>(&originalState->Constants(), &clone->Constants());
+
+        // Writing the same value does not need a copy.
+        clone->SetProperty(HStringReference(L"f").Get(), Make<Nullable<float>>(1.0f).Get());
+
+        Assert::AreEqual<void const*>(&originalState->Constants(), &clone->Constants());
+
+        // Changing the clone should leave the original alone.
+        clone->SetProperty(HStringReference(L"f").Get(), Make<Nullable<float>>(2.0f).Get());
+
+        Assert::AreNotEqual<void const*>(&originalState->Constants(), &clone->Constants());
+        Assert::AreEqual<void const*>(&originalState->Shader(), &clone->Shader());
+
+        Assert::AreEqual(1.0f, reinterpret_cast<float const*>(originalState->Constants().data())[0]);
+        Assert::AreEqual(2.0f, reinterpret_cast<float const*>(clone->Constants().data())[0]);
+
+        // Now that the buffers are separate, changing the original does not copy again.
+        auto originalConstants = &originalState->Constants();
+
+        originalState->SetProperty(HStringReference(L"f").Get(), Make<Nullable<float>>(3.0f).Get());
+
+        Assert::AreEqual<void const*>(originalConstants, &originalState->Constants());
+        Assert::AreEqual(3.0f, reinterpret_cast<float const*>(originalState->Constants().data())[0]);
+        Assert::AreEqual(2.0f, reinterpret_cast<float const*>(clone->Constants().data())[0]);
+    };
+
+
+    TEST_METHOD_EX(SharedShaderState_DirtyConstants)
+    {
+        auto state = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        Assert::IsFalse(state->AreConstantsDirty());
+
+        // Changing a value marks the constants as dirty.
+        state->SetProperty(HStringReference(L"i").Get(), Make<Nullable<int>>(1).Get());
+
+        Assert::IsTrue(state->AreConstantsDirty());
+
+        Matrix4x4 floatMatrix = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+        state->SetProperty(HStringReference(L"rows").Get(), Make<Nullable<Matrix4x4>>(floatMatrix).Get());
+
+        state->ClearDirtyConstants();
+
+        Assert::IsFalse(state->AreConstantsDirty());
+
+        // Writing values that are already set leaves the buffer clean.
+        state->SetProperty(HStringReference(L"i").Get(), Make<Nullable<int>>(1).Get());
+        state->SetProperty(HStringReference(L"rows").Get(), Make<Nullable<Matrix4x4>>(floatMatrix).Get());
+        state->SetPropertyByHandle(state->GetPropertyHandle(HStringReference(L"rows").Get()), floatMatrix);
+
+        Assert::IsFalse(state->AreConstantsDirty());
+
+        floatMatrix.M22 = 2;
+
+        state->SetPropertyByHandle(state->GetPropertyHandle(HStringReference(L"rows").Get()), floatMatrix);
+
+        Assert::IsTrue(state->AreConstantsDirty());
+    };
+
+
+    TEST_METHOD_EX(SharedShaderState_SetProperties)
+    {
+        auto state = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        Matrix4x4 floatMatrix = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+
+        // Values are not in sorted order, and one name is repeated.
+        std::vector<StringObjectPair> values =
+        {
+            { WinString(L"rows"), Make<Nullable<Matrix4x4>>(floatMatrix) },
+            { WinString(L"f"),    Make<Nullable<float>>(1.0f) },
+            { WinString(L"i"),    Make<Nullable<int>>(2) },
+            { WinString(L"f"),    Make<Nullable<float>>(3.0f) },
+        };
+
+        state->SetProperties(values);
+
+        // Should match setting the same values one at a time.
+        auto expected = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        for (auto& value : values)
+        {
+            expected->SetProperty(value.first, value.second.Get());
+        }
+
+        Assert::AreEqual(expected->Constants(), state->Constants());
+        Assert::AreEqual(3.0f, reinterpret_cast<float const*>(state->Constants().data())[0]);
+
+        // Unknown names or wrongly typed values leave everything unchanged.
+        auto previousConstants = state->Constants();
+        state->ClearDirtyConstants();
+
+        std::vector<StringObjectPair> unknownName =
+        {
+            { WinString(L"f"),       Make<Nullable<float>>(4.0f) },
+            { WinString(L"unknown"), Make<Nullable<float>>(4.0f) },
+        };
+
+        ExpectHResultException(E_INVALIDARG, [&] { state->SetProperties(unknownName); });
+
+        std::vector<StringObjectPair> wrongType =
+        {
+            { WinString(L"f"),    Make<Nullable<float>>(4.0f) },
+            { WinString(L"rows"), Make<Nullable<float>>(4.0f) },
+        };
+
+        ExpectHResultException(E_INVALIDARG, [&] { state->SetProperties(wrongType); });
+
+        Assert::AreEqual(previousConstants, state->Constants());
+        Assert::IsFalse(state->AreConstantsDirty());
+    };
+
+
+    TEST_METHOD_EX(SharedShaderState_Hashing)
+    {
+        auto state1a = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+        auto state1b = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+        
+        auto state2a = Make<SharedShaderState>(compiledShader2.data(), static_cast<unsigned>(compiledShader2.size()));
+        auto state2b = Make<SharedShaderState>(compiledShader2.data(), static_cast<unsigned>(compiledShader2.size()));
+
+        Assert::AreEqual(state1a->Shader().Hash, state1b->Shader().Hash);
+        Assert::AreEqual(state2a->Shader().Hash, state2b->Shader().Hash);
+
+        Assert::AreNotEqual(state1a->Shader().Hash, state2a->Shader().Hash);
+    };
+
+
+    TEST_METHOD_EX(SharedShaderState_ReflectionResultsAreCached)
+    {
+        auto state1 = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        auto before = ShaderCache::Instance().GetStatistics();
+
+        auto state2 = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        auto after = ShaderCache::Instance().GetStatistics();
+
+        Assert::AreEqual(before.Hits + 1, after.Hits);
+        Assert::AreEqual(before.Misses, after.Misses);
+
+        // The shader description is shared, but each state has its own constants.
+        Assert::AreEqual<void const*>(&state1->Shader(), &state2->Shader());
+        Assert::AreNotEqual<void const*>(&state1->Constants(), &state2->Constants());
+        Assert::AreEqual(state1->Constants(), state2->Constants());
+
+        state1->SetProperty(HStringReference(L"f").Get(), Make<Nullable<float>>(1.0f).Get());
+        state2->SetProperty(HStringReference(L"f").Get(), Make<Nullable<float>>(2.0f).Get());
+
+        Assert::AreEqual(1.0f, reinterpret_cast<float const*>(state1->Constants().data())[0]);
+        Assert::AreEqual(2.0f, reinterpret_cast<float const*>(state2->Constants().data())[0]);
+
+        // New states start from the default values, not whatever was last set.
+        auto state3 = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        Assert::AreEqual(0.0f, reinterpret_cast<float const*>(state3->Constants().data())[0]);
+    };
+
+
+    TEST_METHOD_EX(SharedShaderState_CachedShader_KeepsSimpleInputCoordinateMapping)
+    {
+        auto shaderCode = CompileShaderWithLinkingFunction();
+
+        auto state1 = Make<SharedShaderState>(shaderCode.data(), static_cast<unsigned>(shaderCode.size()));
+
+        auto before = ShaderCache::Instance().GetStatistics();
+
+        auto state2 = Make<SharedShaderState>(shaderCode.data(), static_cast<unsigned>(shaderCode.size()));
+
+        auto after = ShaderCache::Instance().GetStatistics();
+
+        Assert::AreEqual(before.Hits + 1, after.Hits);
+
+        // The second state skipped reflection, but must still get the mapping from the linking function.
+        for (auto& state : { state1, state2 })
+        {
+            Assert::AreEqual(1u, state->Shader().SimpleInputs);
+            Assert::AreEqual(SamplerCoordinateMapping::OneToOne, state->CoordinateMapping().Mapping[0]);
+            Assert::AreEqual(SamplerCoordinateMapping::Unknown, state->CoordinateMapping().Mapping[1]);
+        }
+    };
+
+
+    TEST_METHOD_EX(SharedShaderState_ShaderReflection)
+    {
+        auto state = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        Assert::AreEqual(compiledShader1, state->Shader().Code);
+        Assert::AreEqual(0u, state->Shader().InputCount);
+        Assert::IsTrue(state->Shader().InstructionCount > 3 && state->Shader().InstructionCount < 20);
+        Assert::AreEqual<int>(D3D_FEATURE_LEVEL_10_0, state->Shader().MinFeatureLevel);
+
+        auto& variables = state->Shader().Variables;
+
+        Assert::AreEqual<size_t>(7, variables.size());
+
+        // The variable list is sorted, so indices are alphabetical.
+        ValidateVariable(variables[2], L"f",     D3D_SVC_SCALAR,         D3D_SVT_FLOAT, 1, 1, 0, 4,  0);
+        ValidateVariable(variables[3], L"i",     D3D_SVC_SCALAR,         D3D_SVT_INT,   1, 1, 0, 4,  4);
+        ValidateVariable(variables[0], L"b",     D3D_SVC_SCALAR,         D3D_SVT_BOOL,  1, 1, 0, 4,  8);
+        ValidateVariable(variables[6], L"rows",  D3D_SVC_MATRIX_ROWS,    D3D_SVT_FLOAT, 4, 4, 0, 64, 16);
+        ValidateVariable(variables[1], L"cols",  D3D_SVC_MATRIX_COLUMNS, D3D_SVT_FLOAT, 4, 4, 0, 64, 80);
+        ValidateVariable(variables[5], L"irows", D3D_SVC_MATRIX_ROWS,    D3D_SVT_INT,   2, 4, 0, 32, 144);
+        ValidateVariable(variables[4], L"icols", D3D_SVC_MATRIX_COLUMNS, D3D_SVT_INT,   2, 4, 0, 56, 176);
+    };
+
+
+    static void ValidateVariable(ShaderVariable const& variable, 
+                                 std::wstring expectedName,
+                                 D3D_SHADER_VARIABLE_CLASS expectedClass, 
+                                 D3D_SHADER_VARIABLE_TYPE expectedType,
+                                 unsigned expectedRows, 
+                                 unsigned expectedColumns, 
+                                 unsigned expectedElements,
+                                 unsigned expectedSize, 
+                                 unsigned expectedOffset)
+    {
+        Assert::AreEqual<std::wstring>(expectedName, static_cast<wchar_t const*>(variable.Name));
+        Assert::AreEqual<int>(expectedClass, variable.Class);
+        Assert::AreEqual<int>(expectedType, variable.Type);
+        Assert::AreEqual(expectedRows, variable.Rows);
+        Assert::AreEqual(expectedColumns, variable.Columns);
+        Assert::AreEqual(expectedElements, variable.Elements);
+        Assert::AreEqual(expectedSize, variable.Size);
+        Assert::AreEqual(expectedOffset, variable.Offset);
+    }
+
+
+    TEST_METHOD_EX(SharedShaderState_ConstantBufferLayout)
+    {
+        // Layout of this struct matches the compiledShader1 constant buffer.
+        struct ConstantBuffer
+        {
+            float f;
+            int i;
+            int b;
+            int _pad;
+
+            float rows[16];
+            float cols[16];
+
+            int irows[8];
+            int icols[14];
+
+            int _pad2[2];
+        };
+
+        auto state = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        Assert::AreEqual(sizeof(ConstantBuffer), state->Constants().size());
+
+        auto constants = reinterpret_cast<ConstantBuffer const*>(state->Constants().data());
 
         // Float property.
         state->SetProperty(HStringReference(L"f").Get(), Make<Nullable<float>>(1.0f).Get());
@@ -1564,4 +2475,372 @@ TEST_CLASS(SharedShaderStateUnitTests)
         Assert::AreEqual(4, constants->icols[12]);
         Assert::AreEqual(8, constants->icols[13]);
     };
+
+
+    TEST_METHOD_EX(SharedShaderState_PropertyHandles)
+    {
+        auto state = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        auto constants = reinterpret_cast<float const*>(state->Constants().data());
+
+        // Handles are indices into the sorted variable list.
+        auto f = state->GetPropertyHandle(HStringReference(L"f").Get());
+        auto i = state->GetPropertyHandle(HStringReference(L"i").Get());
+        auto rows = state->GetPropertyHandle(HStringReference(L"rows").Get());
+        auto cols = state->GetPropertyHandle(HStringReference(L"cols").Get());
+
+        Assert::AreEqual(2u, f);
+        Assert::AreEqual(6u, rows);
+
+        ExpectHResultException(E_INVALIDARG, [&] { state->GetPropertyHandle(HStringReference(L"unknown").Get()); });
+
+        // Float property.
+        state->SetPropertyByHandle(f, 7.0f);
+        Assert::AreEqual(7.0f, constants[0]);
+
+        // Matrix properties should be laid out the same as when set by name.
+        Matrix4x4 floatMatrix = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+
+        state->SetPropertyByHandle(rows, floatMatrix);
+        state->SetPropertyByHandle(cols, floatMatrix);
+
+        std::vector<BYTE> handleConstants = state->Constants();
+
+        state->SetProperty(HStringReference(L"rows").Get(), Make<Nullable<Matrix4x4>>(Matrix4x4{}).Get());
+        state->SetProperty(HStringReference(L"cols").Get(), Make<Nullable<Matrix4x4>>(Matrix4x4{}).Get());
+
+        state->SetProperty(HStringReference(L"rows").Get(), Make<Nullable<Matrix4x4>>(floatMatrix).Get());
+        state->SetProperty(HStringReference(L"cols").Get(), Make<Nullable<Matrix4x4>>(floatMatrix).Get());
+
+        Assert::AreEqual(handleConstants, state->Constants());
+
+        // Type mismatches.
+        ExpectHResultException(E_INVALIDARG, [&] { state->SetPropertyByHandle(i, 1.0f); });
+        ExpectHResultException(E_INVALIDARG, [&] { state->SetPropertyByHandle(rows, 1.0f); });
+        ExpectHResultException(E_INVALIDARG, [&] { state->SetPropertyByHandle(f, Vector4{}); });
+        ExpectHResultException(E_INVALIDARG, [&] { state->SetPropertyByHandle(f, Matrix4x4{}); });
+
+        // Invalid handle.
+        ExpectHResultException(E_BOUNDS, [&] { state->SetPropertyByHandle(7, 1.0f); });
+    };
+
+
+    TEST_METHOD_EX(SharedShaderState_FromShaderPackage_MatchesReflection)
+    {
+        auto reflected = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        auto description = std::make_shared<ShaderDescription>(reflected->Shader());
+        auto constants = std::make_shared<std::vector<BYTE> const>(reflected->Constants());
+
+        auto packageData = MakeShaderPackage({ { L"shader1", CachedShader{ description, constants } } });
+
+        // Make sure the package is loaded from scratch rather than hitting in the cache.
+        ShaderCache::Instance().Clear();
+
+        ShaderPackage package(packageData.data(), packageData.size());
+
+        auto state = package.CreateSharedShaderState(0);
+
+        Assert::AreNotEqual<void const*>(&reflected->Shader(), &state->Shader());
+
+        Assert::AreEqual(compiledShader1, state->Shader().Code);
+        Assert::AreEqual(reflected->Shader().Hash, state->Shader().Hash);
+        Assert::AreEqual(reflected->Shader().InputCount, state->Shader().InputCount);
+        Assert::AreEqual(reflected->Shader().InstructionCount, state->Shader().InstructionCount);
+        Assert::AreEqual<int>(reflected->Shader().MinFeatureLevel, state->Shader().MinFeatureLevel);
+        Assert::AreEqual(reflected->Constants(), state->Constants());
+
+        auto& variables = state->Shader().Variables;
+
+        Assert::AreEqual<size_t>(7, variables.size());
+
+        ValidateVariable(variables[2], L"f",     D3D_SVC_SCALAR,         D3D_SVT_FLOAT, 1, 1, 0, 4,  0);
+        ValidateVariable(variables[3], L"i",     D3D_SVC_SCALAR,         D3D_SVT_INT,   1, 1, 0, 4,  4);
+        ValidateVariable(variables[0], L"b",     D3D_SVC_SCALAR,         D3D_SVT_BOOL,  1, 1, 0, 4,  8);
+        ValidateVariable(variables[6], L"rows",  D3D_SVC_MATRIX_ROWS,    D3D_SVT_FLOAT, 4, 4, 0, 64, 16);
+        ValidateVariable(variables[1], L"cols",  D3D_SVC_MATRIX_COLUMNS, D3D_SVT_FLOAT, 4, 4, 0, 64, 80);
+        ValidateVariable(variables[5], L"irows", D3D_SVC_MATRIX_ROWS,    D3D_SVT_INT,   2, 4, 0, 32, 144);
+        ValidateVariable(variables[4], L"icols", D3D_SVC_MATRIX_COLUMNS, D3D_SVT_INT,   2, 4, 0, 56, 176);
+
+        // Properties work the same as on a reflected shader.
+        state->SetProperty(HStringReference(L"f").Get(), Make<Nullable<float>>(3.0f).Get());
+        Assert::AreEqual(3.0f, reinterpret_cast<float const*>(state->Constants().data())[0]);
+    };
+
+
+    TEST_METHOD_EX(SharedShaderState_FromShaderPackage_ReflectsLinkingFunctionWhenPackageHasNoLinkingInfo)
+    {
+        auto reflected = Make<SharedShaderState>(compiledShader1.data(), static_cast<unsigned>(compiledShader1.size()));
+
+        // Garbage linking info in the package must be ignored when the flag says it was not computed.
+        auto description = std::make_shared<ShaderDescription>(reflected->Shader());
+        description->SimpleInputs = 0xFF;
+
+        auto constants = std::make_shared<std::vector<BYTE> const>(reflected->Constants());
+
+        auto packageData = MakeShaderPackage({ { L"shader1", CachedShader{ description, constants } } }, 0);
+
+        ShaderCache::Instance().Clear();
+
+        ShaderPackage package(packageData.data(), packageData.size());
+
+        auto state = package.CreateSharedShaderState(0);
+
+        Assert::AreEqual(0u, state->Shader().SimpleInputs);
+    };
+};
+
+
+TEST_CLASS(ShaderPackageUnitTests)
+{
+    // Each test uses different shader code, so they do not see each other's shaders in the ShaderCache.
+    static CachedShader MakeTestShader(BYTE id)
+    {
+        auto description = std::make_shared<ShaderDescription>();
+
+        description->Code = { 'T', 'E', 'S', 'T', id };
+        description->Hash = SharedShaderState::ComputeShaderHash(description->Code.data(), description->Code.size());
+        description->InputCount = 3;
+        description->InstructionCount = 42;
+        description->MinFeatureLevel = D3D_FEATURE_LEVEL_9_3;
+        description->SimpleInputs = 1 << 1;
+
+        // Deliberately not sorted.
+        description->Variables.emplace_back(WinString(L"vector"), D3D_SVC_VECTOR,      D3D_SVT_FLOAT, 1, 2, 0, 8,  4);
+        description->Variables.emplace_back(WinString(L"matrix"), D3D_SVC_MATRIX_ROWS, D3D_SVT_INT,   2, 2, 0, 24, 16);
+        description->Variables.emplace_back(WinString(L"bool"),   D3D_SVC_SCALAR,      D3D_SVT_BOOL,  1, 1, 0, 4,  0);
+
+        auto constants = std::make_shared<std::vector<BYTE> const>(48, id);
+
+        return CachedShader{ description, constants };
+    }
+
+
+    TEST_METHOD_EX(ShaderPackage_LoadsShaderMetadata)
+    {
+        auto expected = MakeTestShader(1);
+        auto packageData = MakeShaderPackage({ { L"test", expected } });
+
+        ShaderPackage package(packageData.data(), packageData.size());
+
+        auto state = package.CreateSharedShaderState(0);
+        auto& shader = state->Shader();
+
+        Assert::AreEqual(expected.Shader->Code, shader.Code);
+        Assert::AreEqual(expected.Shader->Hash, shader.Hash);
+        Assert::AreEqual(3u, shader.InputCount);
+        Assert::AreEqual(42u, shader.InstructionCount);
+        Assert::AreEqual<int>(D3D_FEATURE_LEVEL_9_3, shader.MinFeatureLevel);
+        Assert::AreEqual(2u, shader.SimpleInputs);
+        Assert::AreEqual(*expected.Constants, state->Constants());
+
+        Assert::AreEqual<size_t>(3, shader.Variables.size());
+
+        Assert::AreEqual<std::wstring>(L"bool",   static_cast<wchar_t const*>(shader.Variables[0].Name));
+        Assert::AreEqual<std::wstring>(L"matrix", static_cast<wchar_t const*>(shader.Variables[1].Name));
+        Assert::AreEqual<std::wstring>(L"vector", static_cast<wchar_t const*>(shader.Variables[2].Name));
+
+        auto& matrix = shader.Variables[1];
+
+        Assert::AreEqual<int>(D3D_SVC_MATRIX_ROWS, matrix.Class);
+        Assert::AreEqual<int>(D3D_SVT_INT, matrix.Type);
+        Assert::AreEqual(2u, matrix.Rows);
+        Assert::AreEqual(2u, matrix.Columns);
+        Assert::AreEqual(0u, matrix.Elements);
+        Assert::AreEqual(24u, matrix.Size);
+        Assert::AreEqual(16u, matrix.Offset);
+
+        // Inputs the package marks as simple default to a one-to-one mapping.
+        Assert::AreEqual(SamplerCoordinateMapping::Unknown, state->CoordinateMapping().Mapping[0]);
+        Assert::AreEqual(SamplerCoordinateMapping::OneToOne, state->CoordinateMapping().Mapping[1]);
+        Assert::AreEqual(SamplerCoordinateMapping::Unknown, state->CoordinateMapping().Mapping[2]);
+    };
+
+
+    TEST_METHOD_EX(ShaderPackage_LoadedShadersAreCached)
+    {
+        auto packageData = MakeShaderPackage({ { L"test", MakeTestShader(2) } });
+
+        ShaderPackage package(packageData.data(), packageData.size());
+
+        auto state1 = package.CreateSharedShaderState(0);
+
+        auto before = ShaderCache::Instance().GetStatistics();
+
+        auto state2 = package.CreateSharedShaderState(0);
+
+        auto after = ShaderCache::Instance().GetStatistics();
+
+        Assert::AreEqual(before.Hits + 1, after.Hits);
+        Assert::AreEqual(before.Misses, after.Misses);
+
+        Assert::AreEqual<void const*>(&state1->Shader(), &state2->Shader());
+        Assert::AreNotEqual<void const*>(&state1->Constants(), &state2->Constants());
+    };
+
+
+    TEST_METHOD_EX(ShaderPackage_FindShader)
+    {
+        auto packageData = MakeShaderPackage({ { L"first", MakeTestShader(3) }, { L"second", MakeTestShader(4) } });
+
+        ShaderPackage package(packageData.data(), packageData.size());
+
+        Assert::AreEqual(2u, package.GetShaderCount());
+
+        Assert::AreEqual<std::wstring>(L"first",  static_cast<wchar_t const*>(package.GetShaderName(0)));
+        Assert::AreEqual<std::wstring>(L"second", static_cast<wchar_t const*>(package.GetShaderName(1)));
+
+        unsigned index = 0;
+
+        Assert::IsTrue(package.FindShader(HStringReference(L"second").Get(), &index));
+        Assert::AreEqual(1u, index);
+
+        Assert::IsFalse(package.FindShader(HStringReference(L"third").Get(), &index));
+
+        Assert::AreEqual<BYTE>(4, package.GetShader(1).Shader->Code.back());
+
+        ExpectHResultException(E_BOUNDS, [&] { package.GetShaderName(2); });
+        ExpectHResultException(E_BOUNDS, [&] { package.GetShader(2); });
+    };
+
+
+    TEST_METHOD_EX(ShaderPackage_CreatePixelShaderEffect)
+    {
+        auto packageData = MakeShaderPackage({ { L"test", MakeTestShader(5) } });
+
+        ShaderPackage package(packageData.data(), packageData.size());
+
+        auto effect = package.CreatePixelShaderEffect(0);
+
+        ComPtr<IMap<HSTRING, IInspectable*>> properties;
+        ThrowIfFailed(effect->get_Properties(&properties));
+
+        unsigned size;
+        ThrowIfFailed(properties->get_Size(&size));
+        Assert::AreEqual(3u, size);
+
+        boolean hasKey;
+        ThrowIfFailed(properties->HasKey(HStringReference(L"matrix").Get(), &hasKey));
+        Assert::IsTrue(!!hasKey);
+    };
+
+    static void ExpectBadPackage(std::vector<BYTE> const& packageData)
+    {
+        ExpectHResultException(E_INVALIDARG, [&] { ShaderPackage(packageData.data(), packageData.size()); });
+    }
+
+
+    template<typename T>
+    static std::vector<BYTE> Patch(std::vector<BYTE> packageData, size_t offset, T value)
+    {
+        memcpy(packageData.data() + offset, &value, sizeof(T));
+        return packageData;
+    }
+
+
+    TEST_METHOD_EX(ShaderPackage_RejectsCorruptPackages)
+    {
+        using namespace ShaderPackageFormat;
+
+        auto packageData = MakeShaderPackage({ { L"test", MakeTestShader(6) } });
+
+        auto shaderOffset = sizeof(Header);
+        auto variableOffset = sizeof(Header) + sizeof(Shader);
+
+        // Sanity check that the unmodified package is valid.
+        ShaderPackage(packageData.data(), packageData.size());
+
+        // Every truncation cuts off data that is referenced by the tables.
+        for (size_t size = 0; size < packageData.size(); size++)
+        {
+            ExpectBadPackage(std::vector<BYTE>(packageData.begin(), packageData.begin() + size));
+        }
+
+        ExpectBadPackage(Patch(packageData, offsetof(Header, Magic), 0u));
+        ExpectBadPackage(Patch(packageData, offsetof(Header, Version), Version + 1));
+        ExpectBadPackage(Patch(packageData, offsetof(Header, ShaderCount), UINT32_MAX));
+        ExpectBadPackage(Patch(packageData, offsetof(Header, ShaderTableOffset), UINT32_MAX));
+
+        ExpectBadPackage(Patch(packageData, shaderOffset + offsetof(Shader, NameLength), UINT32_MAX));
+        ExpectBadPackage(Patch(packageData, shaderOffset + offsetof(Shader, CodeOffset), static_cast<uint32_t>(packageData.size())));
+        ExpectBadPackage(Patch(packageData, shaderOffset + offsetof(Shader, CodeSize), 0u));
+        ExpectBadPackage(Patch(packageData, shaderOffset + offsetof(Shader, ConstantsSize), UINT32_MAX));
+        ExpectBadPackage(Patch(packageData, shaderOffset + offsetof(Shader, ConstantsSize), 8u));
+        ExpectBadPackage(Patch(packageData, shaderOffset + offsetof(Shader, VariableCount), 1000u));
+        ExpectBadPackage(Patch(packageData, shaderOffset + offsetof(Shader, InputCount), MaxShaderInputs + 1));
+
+        ExpectBadPackage(Patch(packageData, variableOffset + offsetof(Variable, NameOffset), UINT32_MAX));
+        ExpectBadPackage(Patch(packageData, variableOffset + offsetof(Variable, Class), static_cast<uint32_t>(D3D_SVC_STRUCT)));
+        ExpectBadPackage(Patch(packageData, variableOffset + offsetof(Variable, Type), static_cast<uint32_t>(D3D_SVT_TEXTURE2D)));
+        ExpectBadPackage(Patch(packageData, variableOffset + offsetof(Variable, Rows), 5u));
+        ExpectBadPackage(Patch(packageData, variableOffset + offsetof(Variable, Size), 4u));
+        ExpectBadPackage(Patch(packageData, variableOffset + offsetof(Variable, Offset), 48u));
+        ExpectBadPackage(Patch(packageData, variableOffset + offsetof(Variable, Elements), UINT32_MAX));
+    };
+
+
+    TEST_METHOD_EX(ShaderPackage_RejectsHashThatDoesNotMatchCode)
+    {
+        using namespace ShaderPackageFormat;
+
+        auto expected = MakeTestShader(7);
+        auto packageData = MakeShaderPackage({ { L"test", expected } });
+
+        auto hashOffset = sizeof(Header) + offsetof(Shader, Hash);
+
+        auto wrongHash = Patch(packageData, hashOffset, static_cast<BYTE>(packageData[hashOffset] ^ 1));
+
+        // The layout is still valid, so the package opens, but the shader cannot be loaded.
+        ShaderPackage package(wrongHash.data(), wrongHash.size());
+
+        auto before = ShaderCache::Instance().GetStatistics();
+
+        ExpectHResultException(E_INVALIDARG, [&] { package.GetShader(0); });
+
+        Assert::AreEqual(before.CachedShaderCount, ShaderCache::Instance().GetStatistics().CachedShaderCount);
+
+        // Once the correct shader is cached, the wrong hash still does not match it.
+        ShaderPackage(packageData.data(), packageData.size()).GetShader(0);
+
+        ExpectHResultException(E_INVALIDARG, [&] { package.GetShader(0); });
+    };
+
+
+    TEST_METHOD_EX(ShaderPackageReader_ReadsLayout)
+    {
+        auto expected = MakeTestShader(8);
+        auto packageData = MakeShaderPackage({ { L"first", expected }, { L"second", MakeTestShader(9) } });
+
+        ShaderPackageReader reader;
+
+        Assert::IsFalse(ShaderPackageReader::Open(packageData.data(), 3, &reader));
+        Assert::AreEqual<size_t>(0, reader.GetShaderCount());
+
+        Assert::IsTrue(ShaderPackageReader::Open(packageData.data(), packageData.size(), &reader));
+        Assert::AreEqual<size_t>(2, reader.GetShaderCount());
+
+        auto& shader = reader.GetShader(0);
+
+        Assert::IsTrue(shader.Name == u"first");
+        Assert::IsTrue(reader.GetShader(1).Name == u"second");
+
+        Assert::AreEqual(0, memcmp(shader.Layout.Hash, &expected.Shader->Hash, sizeof(IID)));
+        Assert::AreEqual(expected.Shader->Code, std::vector<BYTE>(shader.Code, shader.Code + shader.Layout.CodeSize));
+        Assert::AreEqual(*expected.Constants, std::vector<BYTE>(shader.Constants, shader.Constants + shader.Layout.ConstantsSize));
+        Assert::AreEqual(3u, shader.Layout.InputCount);
+
+        // Variables come back in package order, without being sorted.
+        auto variables = reader.GetVariables(0);
+
+        Assert::AreEqual<size_t>(3, variables.size());
+
+        Assert::IsTrue(variables[0].Name == u"vector");
+        Assert::IsTrue(variables[1].Name == u"matrix");
+        Assert::IsTrue(variables[2].Name == u"bool");
+
+        Assert::AreEqual<uint32_t>(ShaderPackageFormat::MatrixRows, variables[1].Layout.Class);
+        Assert::AreEqual<uint32_t>(ShaderPackageFormat::Int, variables[1].Layout.Type);
+        Assert::AreEqual(24u, variables[1].Layout.Size);
+        Assert::AreEqual(16u, variables[1].Layout.Offset);
+    };
 };
@@ -0,0 +1,336 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+static D2D1_PIXEL_FORMAT const Bgra = D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED);
+static D2D1_PIXEL_FORMAT const Rgba = D2D1::PixelFormat(DXGI_FORMAT_R8G8B8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED);
+
+// Size in bytes of a 64x64 bitmap in either of the above formats.
+static uint64_t const SmallestBitmapBytes = 64 * 64 * 4;
+
+TEST_CLASS(StagingBitmapPoolUnitTests)
+{
+public:
+    struct Fixture
+    {
+        ComPtr<MockD2DDeviceContext> DeviceContext;
+        StagingBitmapPool Pool;
+
+        Fixture(uint64_t maximumBytes = StagingBitmapPool::DefaultMaximumBytes)
+            : DeviceContext(Make<MockD2DDeviceContext>())
+            , Pool(maximumBytes)
+        {
+            DeviceContext->GetMaximumBitmapSizeMethod.AllowAnyCall(
+                []
+                {
+                    return 16384;
+                });
+
+            DeviceContext->CreateBitmapMethod.AllowAnyCall(
+                [](D2D1_SIZE_U, void const*, UINT32, D2D1_BITMAP_PROPERTIES1 const*, ID2D1Bitmap1** bitmap)
+                {
+                    return Make<MockD2DBitmap>().CopyTo(bitmap);
+                });
+        }
+
+        StagingBitmapLease TakeLease(uint32_t width, uint32_t height, D2D1_PIXEL_FORMAT format = Bgra)
+        {
+            return Pool.TakeLease(DeviceContext.Get(), D2D1_SIZE_U{ width, height }, format);
+        }
+    };
+
+    TEST_METHOD_EX(StagingBitmapPool_GetSizeClass)
+    {
+        struct
+        {
+            uint32_t Value;
+            uint32_t Maximum;
+            uint32_t ExpectedSizeClass;
+        } testCases[]
+        {
+            {     1, 16384,    64 },
+            {    64, 16384,    64 },
+            {    65, 16384,    80 },
+            {   100, 16384,   112 },
+            {   128, 16384,   128 },
+            {   129, 16384,   160 },
+            {  1000, 16384,  1024 },
+            {  1025, 16384,  1280 },
+            { 16000, 16384, 16384 },
+
+            // Rounding up is limited by the maximum bitmap size.
+            {    10,    32,    32 },
+            { 15000, 15500, 15500 },
+
+            // But the size is never rounded down.
+            { 20000, 16384, 20000 },
+        };
+
+        for (auto& testCase : testCases)
+        {
+            auto sizeClass = StagingBitmapPool::GetSizeClass(D2D1_SIZE_U{ testCase.Value, 1 }, testCase.Maximum);
+
+            Assert::AreEqual(testCase.ExpectedSizeClass, sizeClass.width);
+            Assert::AreEqual(std::min(64u, testCase.Maximum), sizeClass.height);
+
+            // Rounding up never wastes more than 25%.
+            Assert::IsTrue(sizeClass.width <= std::max(64u, testCase.Value + testCase.Value / 4));
+        }
+    }
+
+    TEST_METHOD_EX(StagingBitmapPool_TakeLease_CreatesCpuReadableBitmapOfSizeClass)
+    {
+        Fixture f;
+
+        f.DeviceContext->CreateBitmapMethod.SetExpectedCalls(1,
+            [](D2D1_SIZE_U size, void const* data, UINT32, D2D1_BITMAP_PROPERTIES1 const* properties, ID2D1Bitmap1** bitmap)
+            {
+                Assert::AreEqual(112u, size.width);
+                Assert::AreEqual(64u, size.height);
+                Assert::IsNull(data);
+                Assert::AreEqual<uint32_t>(D2D1_BITMAP_OPTIONS_CPU_READ | D2D1_BITMAP_OPTIONS_CANNOT_DRAW, properties->bitmapOptions);
+                Assert::AreEqual<uint32_t>(Bgra.format, properties->pixelFormat.format);
+                Assert::AreEqual<uint32_t>(Bgra.alphaMode, properties->pixelFormat.alphaMode);
+
+                return Make<MockD2DBitmap>().CopyTo(bitmap);
+            });
+
+        auto lease = f.TakeLease(100, 50);
+
+        Assert::IsNotNull(lease.Get());
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(0, statistics.Hits);
+        Assert::AreEqual<uint64_t>(1, statistics.Misses);
+        Assert::AreEqual<uint32_t>(0, statistics.PooledBitmapCount);
+    }
+
+    TEST_METHOD_EX(StagingBitmapPool_ReturnedBitmap_IsReusedForSameSizeClassAndFormat)
+    {
+        Fixture f;
+
+        ID2D1Bitmap1* bitmap;
+
+        {
+            auto lease = f.TakeLease(100, 50);
+            bitmap = lease.Get();
+        }
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(1, statistics.PooledBitmapCount);
+        Assert::AreEqual<uint64_t>(112 * 64 * 4, statistics.PooledBytes);
+
+        f.DeviceContext->CreateBitmapMethod.SetExpectedCalls(0);
+
+        auto lease = f.TakeLease(110, 60);
+
+        Assert::AreEqual(bitmap, lease.Get());
+
+        statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.Hits);
+        Assert::AreEqual<uint64_t>(1, statistics.Misses);
+        Assert::AreEqual<uint32_t>(0, statistics.PooledBitmapCount);
+        Assert::AreEqual<uint64_t>(0, statistics.PooledBytes);
+    }
+
+    TEST_METHOD_EX(StagingBitmapPool_ReturnedBitmap_IsNotReusedForDifferentSizeClassOrFormat)
+    {
+        Fixture f;
+
+        ID2D1Bitmap1* bitmap;
+
+        {
+            auto lease = f.TakeLease(64, 64);
+            bitmap = lease.Get();
+        }
+
+        Assert::AreNotEqual(bitmap, f.TakeLease(65, 64).Get());
+        Assert::AreNotEqual(bitmap, f.TakeLease(64, 64, Rgba).Get());
+        Assert::AreNotEqual(bitmap, f.TakeLease(64, 64, D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE)).Get());
+
+        Assert::AreEqual(bitmap, f.TakeLease(64, 64).Get());
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.Hits);
+        Assert::AreEqual<uint64_t>(4, statistics.Misses);
+    }
+
+    TEST_METHOD_EX(StagingBitmapPool_ConcurrentLeases_GetDifferentBitmaps)
+    {
+        Fixture f;
+
+        {
+            auto lease1 = f.TakeLease(64, 64);
+            auto lease2 = f.TakeLease(64, 64);
+
+            Assert::AreNotEqual(lease1.Get(), lease2.Get());
+        }
+
+        Assert::AreEqual<uint32_t>(2, f.Pool.GetStatistics().PooledBitmapCount);
+
+        f.DeviceContext->CreateBitmapMethod.SetExpectedCalls(0);
+
+        auto lease1 = f.TakeLease(64, 64);
+        auto lease2 = f.TakeLease(64, 64);
+
+        Assert::AreNotEqual(lease1.Get(), lease2.Get());
+        Assert::AreEqual<uint64_t>(2, f.Pool.GetStatistics().Hits);
+    }
+
+    TEST_METHOD_EX(StagingBitmapPool_WhenFull_LeastRecentlyReturnedBitmapsAreDiscarded)
+    {
+        Fixture f(SmallestBitmapBytes * 2);
+
+        ID2D1Bitmap1* bitmaps[3];
+        StagingBitmapLease leases[3];
+
+        for (int i = 0; i < 3; i++)
+        {
+            leases[i] = f.TakeLease(64, 64);
+            bitmaps[i] = leases[i].Get();
+        }
+
+        for (auto& lease : leases)
+        {
+            lease = StagingBitmapLease();
+        }
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.BitmapsDiscarded);
+        Assert::AreEqual<uint32_t>(2, statistics.PooledBitmapCount);
+        Assert::AreEqual<uint64_t>(SmallestBitmapBytes * 2, statistics.PooledBytes);
+
+        // The most recently returned bitmap is reused first, and the oldest is gone.
+        auto lease1 = f.TakeLease(64, 64);
+        auto lease2 = f.TakeLease(64, 64);
+        auto lease3 = f.TakeLease(64, 64);
+
+        Assert::AreEqual(bitmaps[2], lease1.Get());
+        Assert::AreEqual(bitmaps[1], lease2.Get());
+
+        statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(2, statistics.Hits);
+        Assert::AreEqual<uint64_t>(4, statistics.Misses);
+    }
+
+    TEST_METHOD_EX(StagingBitmapPool_BitmapLargerThanMaximum_IsDiscarded)
+    {
+        Fixture f(SmallestBitmapBytes);
+
+        f.TakeLease(64, 65);
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.BitmapsDiscarded);
+        Assert::AreEqual<uint32_t>(0, statistics.PooledBitmapCount);
+    }
+
+    TEST_METHOD_EX(StagingBitmapPool_SetMaximumBytes_TrimsPool)
+    {
+        Fixture f;
+
+        {
+            auto lease1 = f.TakeLease(64, 64);
+            auto lease2 = f.TakeLease(64, 64);
+        }
+
+        Assert::AreEqual<uint32_t>(2, f.Pool.GetStatistics().PooledBitmapCount);
+
+        f.Pool.SetMaximumBytes(SmallestBitmapBytes);
+
+        Assert::AreEqual<uint64_t>(SmallestBitmapBytes, f.Pool.GetMaximumBytes());
+        Assert::AreEqual<uint32_t>(1, f.Pool.GetStatistics().PooledBitmapCount);
+
+        f.Pool.SetMaximumBytes(0);
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(0, statistics.PooledBitmapCount);
+        Assert::AreEqual<uint64_t>(0, statistics.PooledBytes);
+        Assert::AreEqual<uint64_t>(2, statistics.BitmapsDiscarded);
+
+        f.TakeLease(64, 64);
+
+        Assert::AreEqual<uint32_t>(0, f.Pool.GetStatistics().PooledBitmapCount);
+    }
+
+    TEST_METHOD_EX(StagingBitmapPool_Trim_DiscardsPooledBitmapsButKeepsPooling)
+    {
+        Fixture f;
+
+        {
+            auto lease1 = f.TakeLease(64, 64);
+            auto lease2 = f.TakeLease(64, 64, Rgba);
+        }
+
+        f.Pool.Trim();
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(0, statistics.PooledBitmapCount);
+        Assert::AreEqual<uint64_t>(0, statistics.PooledBytes);
+        Assert::AreEqual<uint64_t>(2, statistics.BitmapsDiscarded);
+
+        f.TakeLease(64, 64);
+
+        Assert::AreEqual<uint32_t>(1, f.Pool.GetStatistics().PooledBitmapCount);
+    }
+
+    TEST_METHOD_EX(StagingBitmapPool_WhenClosed_BitmapsAreNotPooled)
+    {
+        Fixture f;
+
+        auto lease = f.TakeLease(64, 64);
+        f.TakeLease(64, 64);
+
+        Assert::AreEqual<uint32_t>(1, f.Pool.GetStatistics().PooledBitmapCount);
+
+        f.Pool.Close();
+
+        Assert::AreEqual<uint32_t>(0, f.Pool.GetStatistics().PooledBitmapCount);
+
+        // Leases taken before closing can still be returned, but are discarded.
+        lease = StagingBitmapLease();
+
+        Assert::AreEqual<uint32_t>(0, f.Pool.GetStatistics().PooledBitmapCount);
+
+        // Leases can still be taken, but always create a new bitmap.
+        f.DeviceContext->CreateBitmapMethod.SetExpectedCalls(1,
+            [](D2D1_SIZE_U, void const*, UINT32, D2D1_BITMAP_PROPERTIES1 const*, ID2D1Bitmap1** bitmap)
+            {
+                return Make<MockD2DBitmap>().CopyTo(bitmap);
+            });
+
+        f.TakeLease(64, 64);
+
+        Assert::AreEqual<uint32_t>(0, f.Pool.GetStatistics().PooledBitmapCount);
+    }
+
+    TEST_METHOD_EX(StagingBitmapPool_MovedLease_IsReturnedOnce)
+    {
+        Fixture f;
+
+        {
+            auto lease = f.TakeLease(64, 64);
+            auto movedLease = std::move(lease);
+
+            Assert::IsNull(lease.Get());
+            Assert::IsNotNull(movedLease.Get());
+        }
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(1, statistics.PooledBitmapCount);
+        Assert::AreEqual<uint64_t>(0, statistics.BitmapsDiscarded);
+    }
+
+    TEST_METHOD_EX(StagingBitmapPool_UnpooledLease_IsNotReturned)
+    {
+        Fixture f;
+
+        {
+            StagingBitmapLease lease(Make<MockD2DBitmap>());
+            Assert::IsNotNull(lease.Get());
+        }
+
+        Assert::AreEqual<uint32_t>(0, f.Pool.GetStatistics().PooledBitmapCount);
+    }
+};
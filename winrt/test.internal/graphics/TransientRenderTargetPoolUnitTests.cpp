@@ -0,0 +1,360 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+static D2D1_PIXEL_FORMAT const Premultiplied = D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED);
+static D2D1_PIXEL_FORMAT const Ignore = D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE);
+static D2D1_PIXEL_FORMAT const Float = D2D1::PixelFormat(DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_PREMULTIPLIED);
+
+// Size in bytes of a 100x50 target in 32 bit formats.
+static uint64_t const TargetBytes = 100 * 50 * 4;
+
+TEST_CLASS(TransientRenderTargetPoolUnitTests)
+{
+public:
+    struct Fixture
+    {
+        ComPtr<MockD2DDeviceContext> DeviceContext;
+        TransientRenderTargetPool Pool;
+
+        Fixture(uint64_t maximumBytes = TransientRenderTargetPool::DefaultMaximumBytes, uint32_t maximumIdleFrames = TransientRenderTargetPool::DefaultMaximumIdleFrames)
+            : DeviceContext(Make<MockD2DDeviceContext>())
+            , Pool(maximumBytes, maximumIdleFrames)
+        {
+            DeviceContext->CreateBitmapMethod.AllowAnyCall(
+                [](D2D1_SIZE_U, void const*, UINT32, D2D1_BITMAP_PROPERTIES1 const*, ID2D1Bitmap1** bitmap)
+                {
+                    return Make<MockD2DBitmap>().CopyTo(bitmap);
+                });
+        }
+
+        TransientRenderTargetLease TakeLease(uint32_t width = 100, uint32_t height = 50, D2D1_PIXEL_FORMAT format = Premultiplied, float dpi = DEFAULT_DPI)
+        {
+            return Pool.TakeLease(DeviceContext.Get(), D2D1_SIZE_U{ width, height }, format, dpi);
+        }
+
+        ID2D1Bitmap1* ReturnNewTarget(uint32_t width = 100, uint32_t height = 50, D2D1_PIXEL_FORMAT format = Premultiplied, float dpi = DEFAULT_DPI)
+        {
+            auto lease = TakeLease(width, height, format, dpi);
+            return lease.Get();
+        }
+    };
+
+    TEST_METHOD_EX(TransientRenderTargetPool_TakeLease_CreatesTargetBitmapOfExactSize)
+    {
+        Fixture f;
+
+        f.DeviceContext->CreateBitmapMethod.SetExpectedCalls(1,
+            [](D2D1_SIZE_U size, void const* data, UINT32, D2D1_BITMAP_PROPERTIES1 const* properties, ID2D1Bitmap1** bitmap)
+            {
+                Assert::AreEqual(100u, size.width);
+                Assert::AreEqual(50u, size.height);
+                Assert::IsNull(data);
+                Assert::AreEqual<uint32_t>(D2D1_BITMAP_OPTIONS_TARGET, properties->bitmapOptions);
+                Assert::AreEqual<uint32_t>(Ignore.format, properties->pixelFormat.format);
+                Assert::AreEqual<uint32_t>(Ignore.alphaMode, properties->pixelFormat.alphaMode);
+                Assert::AreEqual(144.0f, properties->dpiX);
+                Assert::AreEqual(144.0f, properties->dpiY);
+
+                return Make<MockD2DBitmap>().CopyTo(bitmap);
+            });
+
+        auto lease = f.TakeLease(100, 50, Ignore, 144.0f);
+
+        Assert::IsNotNull(lease.Get());
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(0, statistics.Reuses);
+        Assert::AreEqual<uint64_t>(1, statistics.Creations);
+        Assert::AreEqual<uint32_t>(1, statistics.LeasedTargetCount);
+        Assert::AreEqual(TargetBytes, statistics.LeasedBytes);
+        Assert::AreEqual<uint32_t>(0, statistics.PooledTargetCount);
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_TakeLease_WhenCreateBitmapFails_Throws)
+    {
+        Fixture f;
+
+        f.DeviceContext->CreateBitmapMethod.SetExpectedCalls(1,
+            [](D2D1_SIZE_U, void const*, UINT32, D2D1_BITMAP_PROPERTIES1 const*, ID2D1Bitmap1**)
+            {
+                return E_OUTOFMEMORY;
+            });
+
+        ExpectHResultException(E_OUTOFMEMORY, [&] { f.TakeLease(); });
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(0, statistics.Creations);
+        Assert::AreEqual<uint32_t>(0, statistics.LeasedTargetCount);
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_ClosedLease_IsReusedForSameSizeFormatAndDpi)
+    {
+        Fixture f;
+
+        auto lease = f.TakeLease();
+        auto bitmap = lease.Get();
+        lease.Close();
+
+        Assert::IsNull(lease.Get());
+
+        f.DeviceContext->CreateBitmapMethod.SetExpectedCalls(0);
+
+        auto reusedLease = f.TakeLease();
+        Assert::IsTrue(IsSameInstance(bitmap, reusedLease.Get()));
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.Reuses);
+        Assert::AreEqual<uint64_t>(1, statistics.Creations);
+        Assert::AreEqual(0.5, statistics.ReuseRate);
+        Assert::AreEqual<uint32_t>(0, statistics.PooledTargetCount);
+        Assert::AreEqual<uint64_t>(0, statistics.PooledBytes);
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_ReturnedTarget_IsNotReusedForDifferentKey)
+    {
+        struct
+        {
+            uint32_t Width;
+            uint32_t Height;
+            D2D1_PIXEL_FORMAT Format;
+            float Dpi;
+        } testCases[]
+        {
+            { 101,  50, Premultiplied, DEFAULT_DPI },
+            { 100,  51, Premultiplied, DEFAULT_DPI },
+            {  50, 100, Premultiplied, DEFAULT_DPI },
+            { 100,  50, Ignore,        DEFAULT_DPI },
+            { 100,  50, Float,         DEFAULT_DPI },
+            { 100,  50, Premultiplied, 192.0f      },
+        };
+
+        for (auto& testCase : testCases)
+        {
+            Fixture f;
+
+            auto bitmap = f.ReturnNewTarget();
+
+            f.DeviceContext->CreateBitmapMethod.SetExpectedCalls(1,
+                [](D2D1_SIZE_U, void const*, UINT32, D2D1_BITMAP_PROPERTIES1 const*, ID2D1Bitmap1** bitmap)
+                {
+                    return Make<MockD2DBitmap>().CopyTo(bitmap);
+                });
+
+            auto lease = f.TakeLease(testCase.Width, testCase.Height, testCase.Format, testCase.Dpi);
+            Assert::IsFalse(IsSameInstance(bitmap, lease.Get()));
+
+            auto statistics = f.Pool.GetStatistics();
+            Assert::AreEqual<uint64_t>(0, statistics.Reuses);
+            Assert::AreEqual<uint32_t>(1, statistics.PooledTargetCount);
+        }
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_LeasedTarget_IsNotHandedOutTwice)
+    {
+        Fixture f;
+
+        auto lease1 = f.TakeLease();
+        auto lease2 = f.TakeLease();
+
+        Assert::IsFalse(IsSameInstance(lease1.Get(), lease2.Get()));
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(2, statistics.Creations);
+        Assert::AreEqual<uint32_t>(2, statistics.LeasedTargetCount);
+        Assert::AreEqual(TargetBytes * 2, statistics.LeasedBytes);
+        Assert::AreEqual(TargetBytes * 2, statistics.PeakBytes);
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_MovedLease_ReturnsBitmapOnce)
+    {
+        Fixture f;
+
+        {
+            auto lease = f.TakeLease();
+            auto movedLease = std::move(lease);
+
+            Assert::IsNull(lease.Get());
+            Assert::IsNotNull(movedLease.Get());
+        }
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(1, statistics.PooledTargetCount);
+        Assert::AreEqual<uint32_t>(0, statistics.LeasedTargetCount);
+        Assert::AreEqual<uint64_t>(0, statistics.LeasedBytes);
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_WhenOverBudget_LeastRecentlyReturnedIsDiscarded)
+    {
+        Fixture f(TargetBytes * 2);
+
+        auto first = f.TakeLease(100, 50);
+        auto second = f.TakeLease(50, 100);
+        auto third = f.TakeLease(100, 50, Ignore);
+
+        auto secondBitmap = second.Get();
+        auto thirdBitmap = third.Get();
+
+        first.Close();
+        second.Close();
+        third.Close();
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(2, statistics.PooledTargetCount);
+        Assert::AreEqual(TargetBytes * 2, statistics.PooledBytes);
+        Assert::AreEqual<uint64_t>(1, statistics.TargetsDiscarded);
+        Assert::AreEqual(TargetBytes * 3, statistics.PeakBytes);
+
+        auto reusedSecond = f.TakeLease(50, 100);
+        auto reusedThird = f.TakeLease(100, 50, Ignore);
+
+        Assert::IsTrue(IsSameInstance(secondBitmap, reusedSecond.Get()));
+        Assert::IsTrue(IsSameInstance(thirdBitmap, reusedThird.Get()));
+        Assert::AreEqual<uint64_t>(2, f.Pool.GetStatistics().Reuses);
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_TargetLargerThanBudget_IsNotPooled)
+    {
+        Fixture f(TargetBytes - 1);
+
+        f.ReturnNewTarget();
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(0, statistics.PooledTargetCount);
+        Assert::AreEqual<uint64_t>(1, statistics.TargetsDiscarded);
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_SetMaximumBytes_TrimsPool)
+    {
+        Fixture f;
+
+        {
+            auto first = f.TakeLease(100, 50);
+            auto second = f.TakeLease(50, 100);
+        }
+
+        Assert::AreEqual<uint32_t>(2, f.Pool.GetStatistics().PooledTargetCount);
+
+        f.Pool.SetMaximumBytes(TargetBytes);
+
+        Assert::AreEqual(TargetBytes, f.Pool.GetMaximumBytes());
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(1, statistics.PooledTargetCount);
+        Assert::AreEqual(TargetBytes, statistics.PooledBytes);
+
+        f.Pool.SetMaximumBytes(0);
+
+        Assert::AreEqual<uint32_t>(0, f.Pool.GetStatistics().PooledTargetCount);
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_EndFrame_DiscardsTargetsIdleForTooManyFrames)
+    {
+        Fixture f(TransientRenderTargetPool::DefaultMaximumBytes, 2);
+
+        f.ReturnNewTarget(100, 50);
+
+        f.Pool.EndFrame();
+        f.Pool.EndFrame();
+
+        // Leased and returned again in the third frame, so this one stays.
+        auto keptBitmap = f.ReturnNewTarget(50, 100);
+
+        f.Pool.EndFrame();
+
+        Assert::AreEqual<uint32_t>(2, f.Pool.GetStatistics().PooledTargetCount);
+
+        f.Pool.EndFrame();
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(1, statistics.PooledTargetCount);
+        Assert::AreEqual(TargetBytes, statistics.PooledBytes);
+        Assert::AreEqual<uint64_t>(1, statistics.TargetsDiscarded);
+
+        auto lease = f.TakeLease(50, 100);
+        Assert::IsTrue(IsSameInstance(keptBitmap, lease.Get()));
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_EndFrame_TargetReusedEveryFrameIsNeverDiscarded)
+    {
+        Fixture f(TransientRenderTargetPool::DefaultMaximumBytes, 0);
+
+        for (int i = 0; i < 10; i++)
+        {
+            f.ReturnNewTarget();
+            f.Pool.EndFrame();
+        }
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.Creations);
+        Assert::AreEqual<uint64_t>(9, statistics.Reuses);
+        Assert::AreEqual(0.9, statistics.ReuseRate);
+        Assert::AreEqual<uint64_t>(0, statistics.TargetsDiscarded);
+        Assert::AreEqual(TargetBytes, statistics.PeakBytes);
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_ReuseRate_IsZeroBeforeAnyLeases)
+    {
+        Fixture f;
+
+        Assert::AreEqual(0.0, f.Pool.GetStatistics().ReuseRate);
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_DiscardedLease_IsNotPooled)
+    {
+        Fixture f;
+
+        auto lease = f.TakeLease();
+        lease.Discard();
+
+        Assert::IsNull(lease.Get());
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(0, statistics.PooledTargetCount);
+        Assert::AreEqual<uint32_t>(0, statistics.LeasedTargetCount);
+        Assert::AreEqual<uint64_t>(1, statistics.TargetsDiscarded);
+
+        // Closing afterwards does not return anything.
+        lease.Close();
+        Assert::AreEqual<uint32_t>(0, f.Pool.GetStatistics().PooledTargetCount);
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_Trim_DiscardsPooledTargetsButKeepsPooling)
+    {
+        Fixture f;
+
+        f.ReturnNewTarget();
+        f.ReturnNewTarget(50, 100);
+
+        f.Pool.Trim();
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(0, statistics.PooledTargetCount);
+        Assert::AreEqual<uint64_t>(0, statistics.PooledBytes);
+        Assert::AreEqual<uint64_t>(2, statistics.TargetsDiscarded);
+
+        f.ReturnNewTarget();
+        Assert::AreEqual<uint32_t>(1, f.Pool.GetStatistics().PooledTargetCount);
+    }
+
+    TEST_METHOD_EX(TransientRenderTargetPool_Close_DiscardsPooledTargetsAndStopsPooling)
+    {
+        Fixture f;
+
+        f.ReturnNewTarget();
+
+        auto outstandingLease = f.TakeLease(50, 100);
+
+        f.Pool.Close();
+
+        Assert::AreEqual<uint32_t>(0, f.Pool.GetStatistics().PooledTargetCount);
+
+        outstandingLease.Close();
+
+        auto statistics = f.Pool.GetStatistics();
+        Assert::AreEqual<uint32_t>(0, statistics.PooledTargetCount);
+        Assert::AreEqual<uint32_t>(0, statistics.LeasedTargetCount);
+    }
+};
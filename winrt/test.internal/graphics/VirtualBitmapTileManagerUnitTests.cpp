@@ -0,0 +1,400 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/images/CanvasVirtualBitmap.h>
+#include <lib/images/VirtualBitmapTileManager.h>
+
+#include "../mocks/MockD2DImageSourceFromWic.h"
+
+#if WINVER > _WIN32_WINNT_WINBLUE
+
+TEST_CLASS(VirtualBitmapTileManagerUnitTests)
+{
+    // Records what the manager asks of the cache, from any thread.
+    struct RecordingCache
+    {
+        std::mutex Mutex;
+        std::vector<D2D1_RECT_U> LoadedTiles;
+        std::vector<D2D1_RECT_U> Trims;
+        uint32_t FailuresToInject;
+
+        RecordingCache()
+            : FailuresToInject(0)
+        {
+        }
+
+        VirtualBitmapTileManager::LoadTileFunction GetLoadTile()
+        {
+            return [this] (D2D1_RECT_U const& tile)
+            {
+                Lock lock(Mutex);
+
+                if (FailuresToInject > 0)
+                {
+                    FailuresToInject--;
+                    ThrowHR(E_FAIL);
+                }
+
+                LoadedTiles.push_back(tile);
+            };
+        }
+
+        VirtualBitmapTileManager::TrimFunction GetTrim()
+        {
+            return [this] (D2D1_RECT_U const& rectangleToPreserve)
+            {
+                Lock lock(Mutex);
+                Trims.push_back(rectangleToPreserve);
+            };
+        }
+    };
+
+    // 100 pixel tiles of one byte per pixel, loaded one at a time so the order is predictable.
+    static VirtualBitmapTileManager::Options MakeOptions(uint64_t budgetInTiles)
+    {
+        VirtualBitmapTileManager::Options options;
+        options.Scheduling.TileSize = 100;
+        options.Scheduling.BytesPerPixel = 1;
+        options.Scheduling.MaximumResidentBytes = budgetInTiles * 100 * 100;
+        options.MaximumConcurrency = 1;
+        return options;
+    }
+
+public:
+    TEST_METHOD_EX(VirtualBitmapTileManager_Construction)
+    {
+        RecordingCache cache;
+
+        ExpectHResultException(E_INVALIDARG,
+            [&] { VirtualBitmapTileManager(D2D1_SIZE_U{ 300, 300 }, D2D1_ORIENTATION_DEFAULT, nullptr, cache.GetTrim()); });
+
+        ExpectHResultException(E_INVALIDARG,
+            [&] { VirtualBitmapTileManager(D2D1_SIZE_U{ 300, 300 }, D2D1_ORIENTATION_DEFAULT, cache.GetLoadTile(), nullptr); });
+
+        VirtualBitmapTileManager manager(D2D1_SIZE_U{ 300, 300 }, D2D1_ORIENTATION_DEFAULT, cache.GetLoadTile(), cache.GetTrim());
+        Assert::AreEqual(2u, manager.GetWorkerCount());
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileManager_SetViewport_LoadsVisibleTilesThenNeighbours)
+    {
+        RecordingCache cache;
+        VirtualBitmapTileManager manager(D2D1_SIZE_U{ 300, 300 }, D2D1_ORIENTATION_DEFAULT, cache.GetLoadTile(), cache.GetTrim(), MakeOptions(100));
+
+        manager.SetViewport(Rect{ 0, 0, 100, 100 }, 0);
+        manager.WaitForIdle();
+
+        Assert::AreEqual<size_t>(4, cache.LoadedTiles.size());
+        Assert::AreEqual(D2D1_RECT_U{ 0, 0, 100, 100 }, cache.LoadedTiles[0]);
+
+        auto statistics = manager.GetStatistics();
+        Assert::AreEqual<uint64_t>(4, statistics.TilesLoaded);
+        Assert::AreEqual<uint64_t>(3, statistics.TilesPrefetched);
+        Assert::AreEqual<uint64_t>(1, statistics.VisibleTileMisses);
+        Assert::AreEqual(0u, manager.GetQueuedCount());
+
+        // Nothing is trimmed while everything fits.
+        Assert::AreEqual<size_t>(0, cache.Trims.size());
+
+        // Panning onto a prefetched tile is a hit.
+        manager.SetViewport(Rect{ 100, 0, 100, 100 }, 1);
+        manager.WaitForIdle();
+
+        statistics = manager.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.VisibleTileHits);
+        Assert::AreEqual<uint64_t>(1, statistics.PrefetchedTilesUsed);
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileManager_Eviction_TrimsToResidentTiles)
+    {
+        RecordingCache cache;
+        VirtualBitmapTileManager manager(D2D1_SIZE_U{ 300, 300 }, D2D1_ORIENTATION_DEFAULT, cache.GetLoadTile(), cache.GetTrim(), MakeOptions(2));
+
+        // Loads (0, 0) and one neighbour, which fills the budget.
+        manager.SetViewport(Rect{ 0, 0, 100, 100 }, 0);
+        manager.WaitForIdle();
+
+        Assert::AreEqual<size_t>(2, cache.LoadedTiles.size());
+        Assert::AreEqual<size_t>(0, cache.Trims.size());
+
+        // Moving to the opposite corner loads two more tiles. The first of
+        // these goes over budget, which evicts both of the first two.
+        manager.SetViewport(Rect{ 200, 200, 100, 100 }, 10);
+        manager.WaitForIdle();
+
+        Assert::AreEqual<size_t>(4, cache.LoadedTiles.size());
+        Assert::AreEqual<size_t>(1, cache.Trims.size());
+        Assert::AreEqual(D2D1_RECT_U{ 200, 200, 300, 300 }, cache.Trims.back());
+
+        auto statistics = manager.GetStatistics();
+        Assert::AreEqual<uint64_t>(2, statistics.TilesEvicted);
+        Assert::AreEqual(2u, statistics.ResidentTiles);
+        Assert::AreEqual<uint64_t>(2 * 100 * 100, statistics.ResidentBytes);
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileManager_Trim_PreservesTilesStillBeingLoaded)
+    {
+        std::mutex mutex;
+        std::vector<D2D1_RECT_U> trims;
+
+        std::promise<void> secondTileStarted;
+        std::promise<void> releaseSecondTile;
+        auto secondTileStartedFuture = secondTileStarted.get_future().share();
+        auto releaseSecondTileFuture = releaseSecondTile.get_future().share();
+        bool isGated = false;
+
+        auto loadTile = [&] (D2D1_RECT_U const& tile)
+        {
+            bool gated;
+
+            {
+                Lock lock(mutex);
+                gated = isGated;
+            }
+
+            if (!gated)
+                return;
+
+            if (tile.left == 0)
+            {
+                // Don't finish the first tile until the other worker has started on the second.
+                secondTileStartedFuture.wait();
+            }
+            else if (tile.left == 100)
+            {
+                secondTileStarted.set_value();
+                releaseSecondTileFuture.wait();
+            }
+        };
+
+        auto trim = [&] (D2D1_RECT_U const& rectangleToPreserve)
+        {
+            Lock lock(mutex);
+            trims.push_back(rectangleToPreserve);
+        };
+
+        auto options = MakeOptions(2);
+        options.MaximumConcurrency = 2;
+
+        VirtualBitmapTileManager manager(D2D1_SIZE_U{ 500, 100 }, D2D1_ORIENTATION_DEFAULT, loadTile, trim, options);
+
+        // Fill the budget with the two tiles at the right.
+        manager.SetViewport(Rect{ 400, 0, 100, 100 }, 0);
+        manager.WaitForIdle();
+
+        {
+            Lock lock(mutex);
+            isGated = true;
+        }
+
+        // Moving to the left loads (0, 0) and (1, 0) on different workers.
+        // Finishing (0, 0) evicts the first two, while (1, 0) is still loading.
+        manager.SetViewport(Rect{ 0, 0, 100, 100 }, 100);
+
+        secondTileStartedFuture.wait();
+
+        for (;;)
+        {
+            Lock lock(mutex);
+
+            if (!trims.empty())
+                break;
+
+            lock.unlock();
+            std::this_thread::yield();
+        }
+
+        releaseSecondTile.set_value();
+        manager.WaitForIdle();
+
+        Assert::AreEqual<size_t>(1, trims.size());
+        Assert::AreEqual(D2D1_RECT_U{ 0, 0, 200, 100 }, trims[0]);
+
+        auto statistics = manager.GetStatistics();
+        Assert::AreEqual(2u, statistics.ResidentTiles);
+        Assert::AreEqual<uint64_t>(2, statistics.TilesEvicted);
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileManager_FailedLoads_AreCountedAndRetried)
+    {
+        RecordingCache cache;
+        cache.FailuresToInject = 1;
+
+        VirtualBitmapTileManager manager(D2D1_SIZE_U{ 100, 100 }, D2D1_ORIENTATION_DEFAULT, cache.GetLoadTile(), cache.GetTrim(), MakeOptions(100));
+
+        manager.SetViewport(Rect{ 0, 0, 100, 100 }, 0);
+        manager.WaitForIdle();
+
+        Assert::AreEqual<size_t>(0, cache.LoadedTiles.size());
+        Assert::AreEqual<uint64_t>(1, manager.GetStatistics().TileLoadFailures);
+
+        manager.SetViewport(Rect{ 0, 0, 100, 100 }, 1);
+        manager.WaitForIdle();
+
+        Assert::AreEqual<size_t>(1, cache.LoadedTiles.size());
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileManager_SetViewport_IsMappedToSourcePixels)
+    {
+        RecordingCache cache;
+
+        // Rotated sideways, so the 100x200 bitmap comes from a 200x100 source.
+        VirtualBitmapTileManager manager(D2D1_SIZE_U{ 100, 200 }, D2D1_ORIENTATION_ROTATE_CLOCKWISE90, cache.GetLoadTile(), cache.GetTrim(), MakeOptions(1));
+
+        // The top of the bitmap is the left of the source.
+        manager.SetViewport(Rect{ 0, 0, 100, 100 }, 0);
+        manager.WaitForIdle();
+
+        Assert::AreEqual<size_t>(1, cache.LoadedTiles.size());
+        Assert::AreEqual(D2D1_RECT_U{ 0, 0, 100, 100 }, cache.LoadedTiles[0]);
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileManager_MapToSourceRect)
+    {
+        D2D1_SIZE_U sourceSize{ 200, 100 };
+        D2D1_RECT_U rect{ 0, 0, 10, 20 };
+
+        Assert::AreEqual(D2D1_RECT_U{ 0, 0, 10, 20 },     VirtualBitmapTileManager::MapToSourceRect(rect, D2D1_ORIENTATION_DEFAULT, sourceSize));
+        Assert::AreEqual(D2D1_RECT_U{ 190, 0, 200, 20 },  VirtualBitmapTileManager::MapToSourceRect(rect, D2D1_ORIENTATION_FLIP_HORIZONTAL, sourceSize));
+        Assert::AreEqual(D2D1_RECT_U{ 190, 80, 200, 100 }, VirtualBitmapTileManager::MapToSourceRect(rect, D2D1_ORIENTATION_ROTATE_CLOCKWISE180, sourceSize));
+        Assert::AreEqual(D2D1_RECT_U{ 0, 80, 10, 100 },   VirtualBitmapTileManager::MapToSourceRect(rect, D2D1_ORIENTATION_ROTATE_CLOCKWISE180_FLIP_HORIZONTAL, sourceSize));
+
+        // Rotating clockwise turns the bottom left of the source into the top left.
+        Assert::AreEqual(D2D1_RECT_U{ 0, 90, 20, 100 },   VirtualBitmapTileManager::MapToSourceRect(rect, D2D1_ORIENTATION_ROTATE_CLOCKWISE90, sourceSize));
+        Assert::AreEqual(D2D1_RECT_U{ 180, 90, 200, 100 }, VirtualBitmapTileManager::MapToSourceRect(rect, D2D1_ORIENTATION_ROTATE_CLOCKWISE90_FLIP_HORIZONTAL, sourceSize));
+        Assert::AreEqual(D2D1_RECT_U{ 180, 0, 200, 10 },  VirtualBitmapTileManager::MapToSourceRect(rect, D2D1_ORIENTATION_ROTATE_CLOCKWISE270, sourceSize));
+        Assert::AreEqual(D2D1_RECT_U{ 0, 0, 20, 10 },     VirtualBitmapTileManager::MapToSourceRect(rect, D2D1_ORIENTATION_ROTATE_CLOCKWISE270_FLIP_HORIZONTAL, sourceSize));
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileManager_FromVirtualBitmap_RequiresCacheOnDemand)
+    {
+        auto device = Make<StubCanvasDevice>();
+        auto imageSource = Make<MockD2DImageSourceFromWic>();
+
+        auto virtualBitmap = Make<CanvasVirtualBitmap>(device.Get(), imageSource.Get(), imageSource.Get(), Rect{ 0, 0, 100, 100 }, D2D1_ORIENTATION_DEFAULT);
+
+        imageSource->EnsureCachedMethod.SetExpectedCalls(1, [] (D2D1_RECT_U const*) { return D2DERR_UNSUPPORTED_OPERATION; });
+
+        ExpectHResultException(E_INVALIDARG, [&] { VirtualBitmapTileManager(virtualBitmap.Get()); });
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileManager_FromVirtualBitmap_CachesAndTrimsTheImageSource)
+    {
+        auto device = Make<StubCanvasDevice>();
+        auto imageSource = Make<MockD2DImageSourceFromWic>();
+
+        auto virtualBitmap = Make<CanvasVirtualBitmap>(device.Get(), imageSource.Get(), imageSource.Get(), Rect{ 0, 0, 300, 100 }, D2D1_ORIENTATION_DEFAULT);
+
+        std::mutex mutex;
+        std::vector<D2D1_RECT_U> cachedRects;
+        std::vector<D2D1_RECT_U> trimRects;
+
+        imageSource->EnsureCachedMethod.AllowAnyCall(
+            [&] (D2D1_RECT_U const* rect)
+            {
+                Lock lock(mutex);
+                cachedRects.push_back(*rect);
+                return S_OK;
+            });
+
+        imageSource->TrimCacheMethod.AllowAnyCall(
+            [&] (D2D1_RECT_U const* rect)
+            {
+                Lock lock(mutex);
+                trimRects.push_back(*rect);
+                return S_OK;
+            });
+
+        auto options = MakeOptions(1);
+
+        VirtualBitmapTileManager manager(virtualBitmap.Get(), options);
+
+        // The first call probed for cache on demand support.
+        Assert::AreEqual<size_t>(1, cachedRects.size());
+        Assert::AreEqual(D2D1_RECT_U{}, cachedRects[0]);
+
+        manager.SetViewport(Rect{ 0, 0, 100, 100 }, 0);
+        manager.WaitForIdle();
+
+        manager.SetViewport(Rect{ 200, 0, 100, 100 }, 1);
+        manager.WaitForIdle();
+
+        Assert::AreEqual<size_t>(3, cachedRects.size());
+        Assert::AreEqual(D2D1_RECT_U{ 0, 0, 100, 100 }, cachedRects[1]);
+        Assert::AreEqual(D2D1_RECT_U{ 200, 0, 300, 100 }, cachedRects[2]);
+
+        Assert::AreEqual<size_t>(1, trimRects.size());
+        Assert::AreEqual(D2D1_RECT_U{ 200, 0, 300, 100 }, trimRects[0]);
+    }
+
+    static ComPtr<CanvasVirtualBitmap> MakeCachedOnDemandVirtualBitmap()
+    {
+        auto device = Make<StubCanvasDevice>();
+        auto imageSource = Make<MockD2DImageSourceFromWic>();
+
+        imageSource->EnsureCachedMethod.AllowAnyCall();
+        imageSource->TrimCacheMethod.AllowAnyCall();
+
+        return Make<CanvasVirtualBitmap>(device.Get(), imageSource.Get(), imageSource.Get(), Rect{ 0, 0, 300, 100 }, D2D1_ORIENTATION_DEFAULT);
+    }
+
+    TEST_METHOD_EX(CanvasVirtualBitmapTileCacheFactory_InvalidArgs)
+    {
+        auto factory = Make<CanvasVirtualBitmapTileCacheFactory>();
+        auto virtualBitmap = MakeCachedOnDemandVirtualBitmap();
+
+        ComPtr<ICanvasVirtualBitmapTileCache> tileCache;
+
+        Assert::AreEqual(E_INVALIDARG, factory->Create(nullptr, &tileCache));
+        Assert::AreEqual(E_INVALIDARG, factory->Create(virtualBitmap.Get(), nullptr));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateWithTileSizeAndBudget(nullptr, 100, 1024, &tileCache));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateWithTileSizeAndBudget(virtualBitmap.Get(), 100, 1024, nullptr));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateWithTileSizeAndBudget(virtualBitmap.Get(), 0, 1024, &tileCache));
+        Assert::AreEqual(E_INVALIDARG, factory->CreateWithTileSizeAndBudget(virtualBitmap.Get(), -1, 1024, &tileCache));
+    }
+
+    TEST_METHOD_EX(CanvasVirtualBitmapTileCacheFactory_CreateWithTileSizeAndBudget_UsesTileSize)
+    {
+        auto factory = Make<CanvasVirtualBitmapTileCacheFactory>();
+
+        ComPtr<ICanvasVirtualBitmapTileCache> defaultTileCache;
+        ThrowIfFailed(factory->Create(MakeCachedOnDemandVirtualBitmap().Get(), &defaultTileCache));
+
+        ComPtr<ICanvasVirtualBitmapTileCache> tileCache;
+        ThrowIfFailed(factory->CreateWithTileSizeAndBudget(MakeCachedOnDemandVirtualBitmap().Get(), 100, 1024 * 1024, &tileCache));
+
+        ThrowIfFailed(defaultTileCache->SetViewport(Rect{ 0, 0, 300, 100 }));
+        ThrowIfFailed(tileCache->SetViewport(Rect{ 0, 0, 300, 100 }));
+
+        // Visible tiles are counted when the viewport is set, before any are loaded.
+        CanvasVirtualBitmapTileStatistics statistics;
+
+        ThrowIfFailed(defaultTileCache->get_Statistics(&statistics));
+        Assert::AreEqual<uint64_t>(2, statistics.VisibleTileMisses);
+
+        ThrowIfFailed(tileCache->get_Statistics(&statistics));
+        Assert::AreEqual<uint64_t>(3, statistics.VisibleTileMisses);
+    }
+
+    TEST_METHOD_EX(CanvasVirtualBitmapTileCache_Closed)
+    {
+        auto factory = Make<CanvasVirtualBitmapTileCacheFactory>();
+
+        ComPtr<ICanvasVirtualBitmapTileCache> tileCache;
+        ThrowIfFailed(factory->Create(MakeCachedOnDemandVirtualBitmap().Get(), &tileCache));
+
+        ThrowIfFailed(tileCache->SetViewport(Rect{ 0, 0, 300, 100 }));
+
+        ThrowIfFailed(As<IClosable>(tileCache)->Close());
+        ThrowIfFailed(As<IClosable>(tileCache)->Close());
+
+        CanvasVirtualBitmapTileStatistics statistics;
+
+        Assert::AreEqual(RO_E_CLOSED, tileCache->SetViewport(Rect{ 0, 0, 300, 100 }));
+        Assert::AreEqual(RO_E_CLOSED, tileCache->get_Statistics(&statistics));
+    }
+};
+
+#endif
@@ -0,0 +1,315 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/images/VirtualBitmapTileScheduler.h>
+
+TEST_CLASS(VirtualBitmapTileSchedulerUnitTests)
+{
+    // With one byte per pixel and 100 pixel tiles, a whole tile is 10000 bytes.
+    static uint64_t const TileBytes = 100 * 100;
+
+    static VirtualBitmapTileScheduler::Options MakeOptions(uint64_t budgetInTiles)
+    {
+        VirtualBitmapTileScheduler::Options options;
+        options.TileSize = 100;
+        options.BytesPerPixel = 1;
+        options.MaximumResidentBytes = budgetInTiles * TileBytes;
+        return options;
+    }
+
+    static D2D1_RECT_U TileRect(uint32_t column, uint32_t row)
+    {
+        return D2D1_RECT_U{ column * 100, row * 100, column * 100 + 100, row * 100 + 100 };
+    }
+
+    static void AssertTile(uint32_t expectedColumn, uint32_t expectedRow, VirtualBitmapTile const& tile)
+    {
+        Assert::AreEqual(expectedColumn, tile.Column);
+        Assert::AreEqual(expectedRow, tile.Row);
+    }
+
+    static size_t IndexOfColumn(std::vector<VirtualBitmapTile> const& tiles, uint32_t column, size_t start)
+    {
+        for (size_t i = start; i < tiles.size(); i++)
+        {
+            if (tiles[i].Column == column)
+                return i;
+        }
+
+        return tiles.size();
+    }
+
+public:
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_InvalidOptions_Throw)
+    {
+        auto options = MakeOptions(10);
+        options.TileSize = 0;
+        ExpectHResultException(E_INVALIDARG, [&] { VirtualBitmapTileScheduler(D2D1_SIZE_U{ 1000, 1000 }, options); });
+
+        options = MakeOptions(10);
+        options.BytesPerPixel = 0;
+        ExpectHResultException(E_INVALIDARG, [&] { VirtualBitmapTileScheduler(D2D1_SIZE_U{ 1000, 1000 }, options); });
+
+        options = MakeOptions(10);
+        options.PrefetchSeconds = -1;
+        ExpectHResultException(E_INVALIDARG, [&] { VirtualBitmapTileScheduler(D2D1_SIZE_U{ 1000, 1000 }, options); });
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_GetTileBounds_ClipsEdgeTiles)
+    {
+        VirtualBitmapTileScheduler scheduler(D2D1_SIZE_U{ 250, 130 }, MakeOptions(10));
+
+        Assert::AreEqual(D2D1_RECT_U{ 0, 0, 100, 100 }, scheduler.GetTileBounds(VirtualBitmapTile{ 0, 0 }));
+        Assert::AreEqual(D2D1_RECT_U{ 200, 100, 250, 130 }, scheduler.GetTileBounds(VirtualBitmapTile{ 2, 1 }));
+
+        // Edge tiles only count their clipped size against the budget.
+        scheduler.OnTileLoaded(VirtualBitmapTile{ 2, 1 });
+        Assert::AreEqual<uint64_t>(50 * 30, scheduler.GetStatistics().ResidentBytes);
+
+        scheduler.OnTileLoaded(VirtualBitmapTile{ 0, 0 });
+        Assert::AreEqual(D2D1_RECT_U{ 0, 0, 250, 130 }, scheduler.GetResidentBounds());
+
+        ExpectHResultException(E_INVALIDARG, [&] { scheduler.OnTileLoaded(VirtualBitmapTile{ 3, 0 }); });
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_UpdateViewport_ReturnsVisibleTilesFirst_ThenNeighbours)
+    {
+        VirtualBitmapTileScheduler scheduler(D2D1_SIZE_U{ 1000, 1000 }, MakeOptions(100));
+
+        auto tiles = scheduler.UpdateViewport(D2D1_RECT_U{ 100, 100, 300, 300 }, 0);
+
+        // The four visible tiles are the same distance from the center, so
+        // come in row order. Then the ring of twelve tiles around them.
+        Assert::AreEqual<size_t>(16, tiles.size());
+
+        AssertTile(1, 1, tiles[0]);
+        AssertTile(2, 1, tiles[1]);
+        AssertTile(1, 2, tiles[2]);
+        AssertTile(2, 2, tiles[3]);
+
+        for (size_t i = 4; i < tiles.size(); i++)
+        {
+            Assert::IsFalse(scheduler.IsVisible(tiles[i]));
+            Assert::IsTrue(tiles[i].Column <= 3 && tiles[i].Row <= 3);
+        }
+
+        auto statistics = scheduler.GetStatistics();
+        Assert::AreEqual<uint64_t>(4, statistics.VisibleTileMisses);
+        Assert::AreEqual<uint64_t>(0, statistics.VisibleTileHits);
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_UpdateViewport_ResidentTilesAreHitsAndNotReturned)
+    {
+        VirtualBitmapTileScheduler scheduler(D2D1_SIZE_U{ 1000, 1000 }, MakeOptions(100));
+
+        for (auto& tile : scheduler.UpdateViewport(D2D1_RECT_U{ 100, 100, 300, 300 }, 0))
+        {
+            scheduler.OnTileLoaded(tile);
+        }
+
+        auto tiles = scheduler.UpdateViewport(D2D1_RECT_U{ 100, 100, 300, 300 }, 1);
+        Assert::AreEqual<size_t>(0, tiles.size());
+
+        auto statistics = scheduler.GetStatistics();
+        Assert::AreEqual<uint64_t>(4, statistics.VisibleTileMisses);
+        Assert::AreEqual<uint64_t>(4, statistics.VisibleTileHits);
+        Assert::AreEqual<uint64_t>(16, statistics.TilesLoaded);
+        Assert::AreEqual<uint64_t>(12, statistics.TilesPrefetched);
+        Assert::AreEqual(16u, statistics.ResidentTiles);
+        Assert::AreEqual<uint64_t>(16 * TileBytes, statistics.ResidentBytes);
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_UpdateViewport_PrefetchesInTheDirectionOfMovement)
+    {
+        VirtualBitmapTileScheduler scheduler(D2D1_SIZE_U{ 1000, 1000 }, MakeOptions(100));
+
+        scheduler.UpdateViewport(D2D1_RECT_U{ 200, 400, 400, 600 }, 0);
+        auto tiles = scheduler.UpdateViewport(D2D1_RECT_U{ 300, 400, 500, 600 }, 0.1);
+
+        // 1000 pixels per second, averaged with the initial estimate of zero.
+        auto velocity = scheduler.GetVelocity();
+        Assert::AreEqual(500.0f, velocity.X, 0.01f);
+        Assert::AreEqual(0.0f, velocity.Y, 0.01f);
+
+        // Visible tiles come first.
+        for (size_t i = 0; i < 4; i++)
+        {
+            Assert::IsTrue(scheduler.IsVisible(tiles[i]));
+        }
+
+        // Half a second ahead, the viewport is centered at (650, 500), which
+        // is between the two tiles in column 6.
+        AssertTile(6, 4, tiles[4]);
+        AssertTile(6, 5, tiles[5]);
+
+        // The neighbours behind the viewport come after everything ahead of it.
+        auto firstBehind = IndexOfColumn(tiles, 2, 4);
+        Assert::IsTrue(firstBehind < tiles.size());
+
+        for (uint32_t column = 5; column <= 7; column++)
+        {
+            Assert::IsTrue(IndexOfColumn(tiles, column, firstBehind) == tiles.size());
+        }
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_UpdateViewport_PrefetchIsLimitedToTheBudget)
+    {
+        VirtualBitmapTileScheduler scheduler(D2D1_SIZE_U{ 1000, 1000 }, MakeOptions(6));
+
+        auto tiles = scheduler.UpdateViewport(D2D1_RECT_U{ 100, 100, 300, 300 }, 0);
+
+        // Four visible, and two more to fill the budget.
+        Assert::AreEqual<size_t>(6, tiles.size());
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_UpdateViewport_EmptyOrOutsideViewport_ReturnsNothing)
+    {
+        VirtualBitmapTileScheduler scheduler(D2D1_SIZE_U{ 1000, 1000 }, MakeOptions(100));
+
+        Assert::AreEqual<size_t>(0, scheduler.UpdateViewport(D2D1_RECT_U{ 100, 100, 100, 300 }, 0).size());
+        Assert::AreEqual<size_t>(0, scheduler.UpdateViewport(D2D1_RECT_U{ 2000, 2000, 2200, 2200 }, 1).size());
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_OnTileLoaded_EvictsLeastRecentlyUsed_ButNotVisibleTiles)
+    {
+        VirtualBitmapTileScheduler scheduler(D2D1_SIZE_U{ 1000, 1000 }, MakeOptions(3));
+
+        // With room for three tiles, the wanted range is (0, 0) and its neighbour (1, 0).
+        scheduler.UpdateViewport(TileRect(0, 0), 0);
+
+        Assert::AreEqual<size_t>(0, scheduler.OnTileLoaded(VirtualBitmapTile{ 0, 0 }).size());
+        Assert::AreEqual<size_t>(0, scheduler.OnTileLoaded(VirtualBitmapTile{ 5, 5 }).size());
+        Assert::AreEqual<size_t>(0, scheduler.OnTileLoaded(VirtualBitmapTile{ 6, 6 }).size());
+
+        // Going over budget evicts every tile outside the wanted range, least
+        // recently used first. The visible tile is the least recently used, but is skipped.
+        auto evicted = scheduler.OnTileLoaded(VirtualBitmapTile{ 1, 0 });
+
+        Assert::AreEqual<size_t>(2, evicted.size());
+        AssertTile(5, 5, evicted[0]);
+        AssertTile(6, 6, evicted[1]);
+
+        Assert::IsTrue(scheduler.IsResident(VirtualBitmapTile{ 0, 0 }));
+        Assert::IsTrue(scheduler.IsResident(VirtualBitmapTile{ 1, 0 }));
+        Assert::IsFalse(scheduler.IsResident(VirtualBitmapTile{ 5, 5 }));
+
+        auto statistics = scheduler.GetStatistics();
+        Assert::AreEqual<uint64_t>(2, statistics.TilesEvicted);
+        Assert::AreEqual(2u, statistics.ResidentTiles);
+        Assert::AreEqual<uint64_t>(2 * TileBytes, statistics.ResidentBytes);
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_ResidentBoundsStayWithinBudgetWhilePanning)
+    {
+        VirtualBitmapTileScheduler scheduler(D2D1_SIZE_U{ 2000, 2000 }, MakeOptions(12));
+
+        double time = 0;
+
+        auto pan = [&](uint32_t column, uint32_t row)
+        {
+            auto tiles = scheduler.UpdateViewport(D2D1_RECT_U{ column * 100, row * 100, column * 100 + 200, row * 100 + 200 }, time);
+            time += 0.1;
+
+            for (auto& tile : tiles)
+            {
+                if (scheduler.OnTileLoaded(tile).empty())
+                    continue;
+
+                // D2D would be trimmed to this, so it must fit in the budget.
+                auto bounds = scheduler.GetResidentBounds();
+                auto bytes = static_cast<uint64_t>(bounds.right - bounds.left) * (bounds.bottom - bounds.top);
+
+                Assert::IsTrue(bytes <= 12 * TileBytes);
+            }
+        };
+
+        // Diagonally, so that the tiles behind and ahead don't fit in one row or column.
+        for (uint32_t i = 0; i < 15; i++)
+        {
+            pan(i, i);
+        }
+
+        // And back again.
+        for (uint32_t i = 15; i > 0; i--)
+        {
+            pan(i, i);
+        }
+
+        auto statistics = scheduler.GetStatistics();
+        Assert::IsTrue(statistics.TilesEvicted > 0);
+        Assert::IsTrue(statistics.ResidentBytes <= 12 * TileBytes);
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_OnTileLoaded_ViewportLargerThanBudget_KeepsVisibleTiles)
+    {
+        VirtualBitmapTileScheduler scheduler(D2D1_SIZE_U{ 1000, 1000 }, MakeOptions(2));
+
+        for (auto& tile : scheduler.UpdateViewport(D2D1_RECT_U{ 0, 0, 200, 200 }, 0))
+        {
+            Assert::AreEqual<size_t>(0, scheduler.OnTileLoaded(tile).size());
+        }
+
+        Assert::AreEqual(4u, scheduler.GetStatistics().ResidentTiles);
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_UpdateViewport_MovesWantedTilesToFrontOfEvictionOrder)
+    {
+        VirtualBitmapTileScheduler scheduler(D2D1_SIZE_U{ 1000, 1000 }, MakeOptions(2));
+
+        // Loaded with nothing visible, so (9, 9) is the most recently used.
+        scheduler.OnTileLoaded(VirtualBitmapTile{ 0, 0 });
+        scheduler.OnTileLoaded(VirtualBitmapTile{ 9, 9 });
+
+        // With room for one neighbour, (0, 0) is wanted as the neighbour of (0, 1).
+        auto tiles = scheduler.UpdateViewport(TileRect(0, 1), 0);
+
+        Assert::AreEqual<size_t>(1, tiles.size());
+        AssertTile(0, 1, tiles[0]);
+
+        auto evicted = scheduler.OnTileLoaded(tiles[0]);
+
+        Assert::AreEqual<size_t>(1, evicted.size());
+        AssertTile(9, 9, evicted[0]);
+        Assert::IsTrue(scheduler.IsResident(VirtualBitmapTile{ 0, 0 }));
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_PrefetchedTilesAreCountedWhenUsed)
+    {
+        VirtualBitmapTileScheduler scheduler(D2D1_SIZE_U{ 1000, 1000 }, MakeOptions(100));
+
+        scheduler.UpdateViewport(TileRect(0, 0), 0);
+        scheduler.OnTileLoaded(VirtualBitmapTile{ 0, 0 });
+        scheduler.OnTileLoaded(VirtualBitmapTile{ 1, 0 });
+
+        auto statistics = scheduler.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.TilesPrefetched);
+        Assert::AreEqual<uint64_t>(0, statistics.PrefetchedTilesUsed);
+
+        // Counted once, however long it stays visible.
+        scheduler.UpdateViewport(TileRect(1, 0), 1);
+        scheduler.UpdateViewport(TileRect(1, 0), 2);
+
+        statistics = scheduler.GetStatistics();
+        Assert::AreEqual<uint64_t>(1, statistics.PrefetchedTilesUsed);
+        Assert::AreEqual<uint64_t>(2, statistics.VisibleTileHits);
+        Assert::AreEqual<uint64_t>(1, statistics.VisibleTileMisses);
+    }
+
+    TEST_METHOD_EX(VirtualBitmapTileScheduler_OnTileLoadFailed_TileIsRequestedAgain)
+    {
+        VirtualBitmapTileScheduler scheduler(D2D1_SIZE_U{ 100, 100 }, MakeOptions(100));
+
+        auto tiles = scheduler.UpdateViewport(TileRect(0, 0), 0);
+        Assert::AreEqual<size_t>(1, tiles.size());
+
+        scheduler.OnTileLoadFailed(tiles[0]);
+        Assert::AreEqual<uint64_t>(1, scheduler.GetStatistics().TileLoadFailures);
+
+        tiles = scheduler.UpdateViewport(TileRect(0, 0), 1);
+        Assert::AreEqual<size_t>(1, tiles.size());
+        AssertTile(0, 0, tiles[0]);
+    }
+};
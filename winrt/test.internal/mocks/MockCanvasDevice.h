@@ -67,6 +67,28 @@ namespace canvas
         CALL_COUNTER_WITH_MOCK(LeaseHistogramEffectMethod, HistogramAndAtlasEffects(ID2D1DeviceContext*));
         CALL_COUNTER_WITH_MOCK(ReleaseHistogramEffectMethod, void(HistogramAndAtlasEffects));
 
+        CALL_COUNTER_WITH_MOCK(LeaseEffectMethod, ComPtr<ID2D1Effect>(ID2D1DeviceContext*, IID const&));
+        CALL_COUNTER_WITH_MOCK(ReleaseEffectMethod, void(IID const&, ComPtr<ID2D1Effect>, bool));
+        CALL_COUNTER_WITH_MOCK(GetMaximumEffectPoolSizeMethod, uint32_t());
+        CALL_COUNTER_WITH_MOCK(SetMaximumEffectPoolSizeMethod, void(uint32_t));
+        CALL_COUNTER_WITH_MOCK(GetEffectPoolStatisticsMethod, EffectPoolStatistics());
+        CALL_COUNTER_WITH_MOCK(GetDeviceContextPoolStatisticsMethod, DeviceContextPoolStatistics());
+        CALL_COUNTER_WITH_MOCK(LeaseStagingBitmapMethod, StagingBitmapLease(D2D1_SIZE_U, D2D1_PIXEL_FORMAT));
+        CALL_COUNTER_WITH_MOCK(GetStagingBitmapPoolStatisticsMethod, StagingBitmapPoolStatistics());
+        CALL_COUNTER_WITH_MOCK(EnqueuePixelReadbackMethod, PixelReadbackFuture(ICanvasBitmap*, D2D1_RECT_U const&));
+        CALL_COUNTER_WITH_MOCK(FindDecodedBitmapMethod, ComPtr<ID2D1Bitmap1>(std::wstring const&));
+        CALL_COUNTER_WITH_MOCK(AddDecodedBitmapMethod, ComPtr<ID2D1Bitmap1>(std::wstring const&, ID2D1Bitmap1*));
+        CALL_COUNTER_WITH_MOCK(GetMaximumDecodedBitmapCacheBytesMethod, uint64_t());
+        CALL_COUNTER_WITH_MOCK(SetMaximumDecodedBitmapCacheBytesMethod, void(uint64_t));
+        CALL_COUNTER_WITH_MOCK(GetDecodedBitmapCacheStatisticsMethod, DecodedBitmapCacheStatistics());
+        CALL_COUNTER_WITH_MOCK(LeaseTransientRenderTargetMethod, TransientRenderTargetLease(float, float, float, DirectXPixelFormat, CanvasAlphaMode));
+        CALL_COUNTER_WITH_MOCK(EndTransientRenderTargetFrameMethod, void());
+        CALL_COUNTER_WITH_MOCK(GetMaximumTransientRenderTargetBytesMethod, uint64_t());
+        CALL_COUNTER_WITH_MOCK(SetMaximumTransientRenderTargetBytesMethod, void(uint64_t));
+        CALL_COUNTER_WITH_MOCK(GetMaximumTransientRenderTargetIdleFramesMethod, uint32_t());
+        CALL_COUNTER_WITH_MOCK(SetMaximumTransientRenderTargetIdleFramesMethod, void(uint32_t));
+        CALL_COUNTER_WITH_MOCK(GetTransientRenderTargetPoolStatisticsMethod, TransientRenderTargetPoolStatistics());
+
         CALL_COUNTER_WITH_MOCK(IsBufferPrecisionSupportedMethod, HRESULT(CanvasBufferPrecision, boolean*));
 
         CALL_COUNTER_WITH_MOCK(RaiseDeviceLostMethod, HRESULT());
@@ -87,6 +109,12 @@ namespace canvas
         CALL_COUNTER_WITH_MOCK(CreateSvgDocumentMethod, ComPtr<ID2D1SvgDocument>(IStream*));
 #endif
 
+        MockCanvasDevice()
+        {
+            // Swap chains end a transient render target frame each time they present.
+            EndTransientRenderTargetFrameMethod.AllowAnyCall();
+        }
+
         //
         // ICanvasDevice
         //
@@ -138,6 +166,12 @@ namespace canvas
             return E_NOTIMPL;
         }
 
+        IFACEMETHODIMP get_DeviceContextPoolStatistics(CanvasDeviceContextPoolStatistics* value) override
+        {
+            Assert::Fail(L"Unexpected call to get_DeviceContextPoolStatistics");
+            return E_NOTIMPL;
+        }
+
         IFACEMETHODIMP add_DeviceLost(
             DeviceLostHandlerType* value,
             EventRegistrationToken* token)
@@ -444,6 +478,111 @@ namespace canvas
             return ReleaseHistogramEffectMethod.WasCalled(effects);
         }
 
+        virtual ComPtr<ID2D1Effect> LeaseEffect(ID2D1DeviceContext* d2dContext, IID const& effectId) override
+        {
+            return LeaseEffectMethod.WasCalled(d2dContext, effectId);
+        }
+
+        virtual void ReleaseEffect(IID const& effectId, ComPtr<ID2D1Effect>&& effect, bool isShared) override
+        {
+            return ReleaseEffectMethod.WasCalled(effectId, effect, isShared);
+        }
+
+        virtual uint32_t GetMaximumEffectPoolSize() override
+        {
+            return GetMaximumEffectPoolSizeMethod.WasCalled();
+        }
+
+        virtual void SetMaximumEffectPoolSize(uint32_t value) override
+        {
+            return SetMaximumEffectPoolSizeMethod.WasCalled(value);
+        }
+
+        virtual EffectPoolStatistics GetEffectPoolStatistics() override
+        {
+            return GetEffectPoolStatisticsMethod.WasCalled();
+        }
+
+        virtual DeviceContextPoolStatistics GetDeviceContextPoolStatistics() override
+        {
+            return GetDeviceContextPoolStatisticsMethod.WasCalled();
+        }
+
+        virtual StagingBitmapLease LeaseStagingBitmap(D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format) override
+        {
+            return LeaseStagingBitmapMethod.WasCalled(size, format);
+        }
+
+        virtual StagingBitmapPoolStatistics GetStagingBitmapPoolStatistics() override
+        {
+            return GetStagingBitmapPoolStatisticsMethod.WasCalled();
+        }
+
+        virtual PixelReadbackFuture EnqueuePixelReadback(ICanvasBitmap* bitmap, D2D1_RECT_U const& subRectangle) override
+        {
+            return EnqueuePixelReadbackMethod.WasCalled(bitmap, subRectangle);
+        }
+
+        virtual ComPtr<ID2D1Bitmap1> FindDecodedBitmap(std::wstring const& key) override
+        {
+            return FindDecodedBitmapMethod.WasCalled(key);
+        }
+
+        virtual ComPtr<ID2D1Bitmap1> AddDecodedBitmap(std::wstring const& key, ID2D1Bitmap1* bitmap) override
+        {
+            return AddDecodedBitmapMethod.WasCalled(key, bitmap);
+        }
+
+        virtual uint64_t GetMaximumDecodedBitmapCacheBytes() override
+        {
+            return GetMaximumDecodedBitmapCacheBytesMethod.WasCalled();
+        }
+
+        virtual void SetMaximumDecodedBitmapCacheBytes(uint64_t value) override
+        {
+            SetMaximumDecodedBitmapCacheBytesMethod.WasCalled(value);
+        }
+
+        virtual DecodedBitmapCacheStatistics GetDecodedBitmapCacheStatistics() override
+        {
+            return GetDecodedBitmapCacheStatisticsMethod.WasCalled();
+        }
+
+        virtual TransientRenderTargetLease LeaseTransientRenderTarget(float width, float height, float dpi, DirectXPixelFormat format, CanvasAlphaMode alpha) override
+        {
+            return LeaseTransientRenderTargetMethod.WasCalled(width, height, dpi, format, alpha);
+        }
+
+        virtual void EndTransientRenderTargetFrame() override
+        {
+            EndTransientRenderTargetFrameMethod.WasCalled();
+        }
+
+        virtual uint64_t GetMaximumTransientRenderTargetBytes() override
+        {
+            return GetMaximumTransientRenderTargetBytesMethod.WasCalled();
+        }
+
+        virtual void SetMaximumTransientRenderTargetBytes(uint64_t value) override
+        {
+            SetMaximumTransientRenderTargetBytesMethod.WasCalled(value);
+        }
+
+        virtual uint32_t GetMaximumTransientRenderTargetIdleFrames() override
+        {
+            return GetMaximumTransientRenderTargetIdleFramesMethod.WasCalled();
+        }
+
+        virtual void SetMaximumTransientRenderTargetIdleFrames(uint32_t value) override
+        {
+            SetMaximumTransientRenderTargetIdleFramesMethod.WasCalled(value);
+        }
+
+        virtual TransientRenderTargetPoolStatistics GetTransientRenderTargetPoolStatistics() override
+        {
+            return GetTransientRenderTargetPoolStatisticsMethod.WasCalled();
+        }
+
 #if WINVER > _WIN32_WINNT_WINBLUE
         virtual ComPtr<ID2D1GradientMesh> CreateGradientMesh(
             D2D1_GRADIENT_MESH_PATCH const* patches,
@@ -12,6 +12,10 @@ public:
     CALL_COUNTER_WITH_MOCK(CreateWithForceSoftwareRendererOptionMethod, HRESULT(boolean, ICanvasDevice**));
     CALL_COUNTER_WITH_MOCK(put_DebugLevelMethod, HRESULT(CanvasDebugLevel));
     CALL_COUNTER_WITH_MOCK(get_DebugLevelMethod, HRESULT(CanvasDebugLevel*));
+    CALL_COUNTER_WITH_MOCK(put_DeviceContextPoolSizeMethod, HRESULT(UINT32));
+    CALL_COUNTER_WITH_MOCK(get_DeviceContextPoolSizeMethod, HRESULT(UINT32*));
+    CALL_COUNTER_WITH_MOCK(put_DeviceContextPoolPrewarmCountMethod, HRESULT(UINT32));
+    CALL_COUNTER_WITH_MOCK(get_DeviceContextPoolPrewarmCountMethod, HRESULT(UINT32*));
 
     void ExpectToActivateOne(ComPtr<ICanvasDevice> device = Make<StubCanvasDevice>())
     {
@@ -73,4 +77,24 @@ public:
     {
         return get_DebugLevelMethod.WasCalled(debugLevel);
     }
+
+    IFACEMETHODIMP put_DeviceContextPoolSize(UINT32 value) override
+    {
+        return put_DeviceContextPoolSizeMethod.WasCalled(value);
+    }
+
+    IFACEMETHODIMP get_DeviceContextPoolSize(UINT32* value) override
+    {
+        return get_DeviceContextPoolSizeMethod.WasCalled(value);
+    }
+
+    IFACEMETHODIMP put_DeviceContextPoolPrewarmCount(UINT32 value) override
+    {
+        return put_DeviceContextPoolPrewarmCountMethod.WasCalled(value);
+    }
+
+    IFACEMETHODIMP get_DeviceContextPoolPrewarmCount(UINT32* value) override
+    {
+        return get_DeviceContextPoolPrewarmCountMethod.WasCalled(value);
+    }
 };
@@ -0,0 +1,38 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+//
+// Benchmarks time a workload and log the results, rather than checking them.
+// They live in this folder in classes named <Area>Benchmarks, with methods
+// named <Area>_<Workload>_Benchmark, and are declared with BENCHMARK_METHOD
+// instead of TEST_METHOD_EX. This tags them with the Benchmark test category,
+// which the default test run excludes (see readme.txt).
+//
+
+#define BENCHMARK_METHOD(METHOD_NAME)                                           \
+    BEGIN_TEST_METHOD_ATTRIBUTE(METHOD_NAME)                                    \
+        TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")                    \
+    END_TEST_METHOD_ATTRIBUTE()                                                 \
+    TEST_METHOD_EX(METHOD_NAME)
+
+
+// Runs a workload the specified number of times, and logs how long it took.
+template<typename TWorkload>
+inline void LogBenchmark(wchar_t const* name, int iterations, TWorkload&& workload)
+{
+    auto startTime = GetTickCount64();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        workload();
+    }
+
+    auto elapsedTime = GetTickCount64() - startTime;
+
+    WinStringBuilder message;
+    message.Format(L"%s: %d runs in %llu ms", name, iterations, elapsedTime);
+    Logger::WriteMessage(static_cast<wchar_t const*>(message.Get()));
+}
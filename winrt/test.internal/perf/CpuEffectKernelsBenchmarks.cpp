@@ -0,0 +1,94 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/effects/cpu/CpuEffectKernels.h>
+
+#include "BenchmarkHelpers.h"
+
+using namespace CpuEffectKernels;
+
+TEST_CLASS(CpuEffectKernelsBenchmarks)
+{
+    static CpuImage MakeSolidImage(CpuRect const& bounds, CpuColor const& color)
+    {
+        CpuImage image(bounds);
+
+        for (int y = bounds.Top; y < bounds.Bottom; y++)
+        {
+            std::fill(image.GetRow(y), image.GetRow(y) + bounds.Width(), color);
+        }
+
+        return image;
+    }
+
+public:
+    BENCHMARK_METHOD(CpuEffectKernels_Effects_Benchmark)
+    {
+        struct
+        {
+            wchar_t const* Name;
+            int Width;
+            int Height;
+        } sizes[]
+        {
+            { L"256x256", 256,  256  },
+            { L"1080p",   1920, 1080 },
+        };
+
+        int const iterations = 3;
+
+        float const colorMatrix[20] =
+        {
+            0.5f, 0,    0,    0,
+            0,    0.5f, 0,    0,
+            0,    0,    0.5f, 0,
+            0,    0,    0,    1,
+            0.1f, 0.1f, 0.1f, 0,
+        };
+
+        float const coefficients[4] = { 0.5f, 0.25f, 0.25f, 0 };
+
+        float const rotation[6] = { 0.866f, 0.5f, -0.5f, 0.866f, 10, 20 };
+
+        for (auto& size : sizes)
+        {
+            auto bounds = CpuRect{ 0, 0, size.Width, size.Height };
+
+            auto source1 = MakeSolidImage(bounds, CpuColor{ 0, 0.5f, 0, 0.5f });
+            auto source2 = MakeSolidImage(bounds, CpuColor{ 1, 0, 0, 1 });
+
+            float const cropRect[4] = { 1.5f, 1.5f, size.Width - 1.5f, size.Height - 1.5f };
+
+            // Half the output reads from the border extension.
+            auto borderRect = CpuRect{ size.Width / 2, size.Height / 2, size.Width * 3 / 2, size.Height * 3 / 2 };
+
+            struct
+            {
+                wchar_t const* Name;
+                std::function<void()> Run;
+            } effects[]
+            {
+                { L"GaussianBlur",        [&] { GaussianBlur(source1, bounds, 3.0f, BorderMode::Soft, bounds); } },
+                { L"ColorMatrix",         [&] { ColorMatrix(source1, colorMatrix, ColorMatrixAlphaMode::Premultiplied, false); } },
+                { L"Blend",               [&] { Blend(source1, source2, BlendMode::Multiply, bounds); } },
+                { L"Composite",           [&] { Composite(source1, source2, bounds, CompositeMode::SourceOver); } },
+                { L"ArithmeticComposite", [&] { ArithmeticComposite(source1, source2, coefficients, false, bounds); } },
+                { L"Crop",                [&] { Crop(source1, cropRect, BorderMode::Soft); } },
+                { L"Transform2D",         [&] { Transform(source1, bounds, rotation, InterpolationMode::Linear, BorderMode::Soft, bounds); } },
+                { L"Border",              [&] { Border(source2, bounds, EdgeMode::Wrap, EdgeMode::Mirror, borderRect); } },
+                { L"Opacity",             [&] { Opacity(source1, 0.99f); } },
+            };
+
+            for (auto& effect : effects)
+            {
+                WinStringBuilder name;
+                name.Format(L"%s %s", size.Name, effect.Name);
+
+                LogBenchmark(static_cast<wchar_t const*>(name.Get()), iterations, effect.Run);
+            }
+        }
+    }
+};
@@ -0,0 +1,64 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "BenchmarkHelpers.h"
+
+TEST_CLASS(DeviceContextPoolBenchmarks)
+{
+public:
+    // Many threads taking and returning leases at the same time, so the cost
+    // of contention on the pool can be compared between changes.
+    BENCHMARK_METHOD(DeviceContextPool_Contention_Benchmark)
+    {
+        auto device = Make<MockD2DDevice>();
+
+        std::atomic<int> numberOfCreatedDeviceContexts(0);
+
+        device->MockCreateDeviceContext =
+            [&] (D2D1_DEVICE_CONTEXT_OPTIONS, ID2D1DeviceContext1** deviceContext)
+            {
+                numberOfCreatedDeviceContexts++;
+
+                ThrowIfFailed(Make<MockD2DDeviceContext>().CopyTo(deviceContext));
+            };
+
+        unsigned const threadCount = std::max(DeviceContextPool::GetDefaultMaximumSize(), 4U) * 2;
+        int const leasesPerThread = 20000;
+
+        DeviceContextPool pool(device.Get());
+
+        WinStringBuilder name;
+        name.Format(L"%u threads x %d leases", threadCount, leasesPerThread);
+
+        LogBenchmark(static_cast<wchar_t const*>(name.Get()), 1,
+            [&]
+            {
+                std::vector<std::thread> threads;
+
+                for (unsigned i = 0; i < threadCount; ++i)
+                {
+                    threads.emplace_back([&]
+                    {
+                        for (int j = 0; j < leasesPerThread; ++j)
+                        {
+                            auto lease = pool.TakeLease();
+                        }
+                    });
+                }
+
+                for (auto& thread : threads)
+                {
+                    thread.join();
+                }
+            });
+
+        pool.Close();
+
+        WinStringBuilder message;
+        message.Format(L"%d device contexts created", numberOfCreatedDeviceContexts.load());
+        Logger::WriteMessage(static_cast<wchar_t const*>(message.Get()));
+    }
+};
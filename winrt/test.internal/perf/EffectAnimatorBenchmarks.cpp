@@ -0,0 +1,72 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/effects/EffectAnimator.h>
+#include <lib/effects/generated/ColorMatrixEffect.h>
+
+#include "BenchmarkHelpers.h"
+
+TEST_CLASS(EffectAnimatorBenchmarks)
+{
+public:
+    // Compares EffectAnimator::Update against setting the same values one
+    // property at a time, for 100 effects with 20 animated floats each.
+    BENCHMARK_METHOD(EffectAnimator_Update_Benchmark)
+    {
+        const int effectCount = 100;
+        const int iterations = 1000;
+
+        std::vector<ComPtr<ColorMatrixEffect>> effects;
+
+        EffectAnimator animator;
+
+        auto curve = EffectAnimationCurve{
+        {
+            EffectAnimationKeyframe::Linear(0, 0),
+            EffectAnimationKeyframe::CubicBezier(1, 1, 0.25f, 0.1f, 0.25f, 1),
+            EffectAnimationKeyframe::Spring(2, 0, 20, 0.5f),
+            EffectAnimationKeyframe::Linear(3, 1),
+        }, true };
+
+        for (int i = 0; i < effectCount; i++)
+        {
+            effects.push_back(Make<ColorMatrixEffect>());
+
+            for (unsigned int component = 0; component < 20; component++)
+            {
+                animator.AddBinding(effects.back().Get(), D2D1_COLORMATRIX_PROP_COLOR_MATRIX, component, curve);
+            }
+        }
+
+        int frame = 0;
+
+        LogBenchmark(L"EffectAnimator::Update", iterations,
+            [&]
+            {
+                animator.Update(frame++ / 60.0f);
+            });
+
+        frame = 0;
+
+        LogBenchmark(L"put_ColorMatrix per effect", iterations,
+            [&]
+            {
+                Matrix5x4 matrix;
+                auto values = reinterpret_cast<float*>(&matrix);
+                auto time = frame++ / 60.0f;
+
+                for (auto& effect : effects)
+                {
+                    for (int component = 0; component < 20; component++)
+                    {
+                        values[component] = curve.Evaluate(time);
+                    }
+
+                    ThrowIfFailed(effect->put_ColorMatrix(matrix));
+                }
+            });
+    }
+};
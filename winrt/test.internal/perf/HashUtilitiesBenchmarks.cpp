@@ -0,0 +1,51 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/utils/HashUtilities.h>
+
+#include "BenchmarkHelpers.h"
+
+using namespace ABI::Microsoft::Graphics::Canvas;
+
+TEST_CLASS(HashUtilitiesBenchmarks)
+{
+public:
+    // Sha1 throughput for one large buffer, and for UUIDs generated from many
+    // shader sized blobs, as PixelShaderEffect does.
+    BENCHMARK_METHOD(Sha1_LargeAndShaderSizedBuffers_Benchmark)
+    {
+        const size_t largeSize = 64 * 1024 * 1024;
+        const size_t shaderSize = 4 * 1024;
+        const int shaderCount = 16384;
+
+        std::vector<BYTE> data(largeSize);
+
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = static_cast<BYTE>(i * 7);
+        }
+
+        LogBenchmark(L"Sha1 of 64 MB", 1,
+            [&]
+            {
+                BYTE digest[Sha1::DigestSize];
+
+                Sha1 sha1;
+                sha1.Update(data.data(), data.size());
+                sha1.Finish(digest);
+            });
+
+        static const IID salt{ 0xA911588C, 0xDB0A, 0x41D2, 0xAF, 0x64, 0xEB, 0xEC, 0x03, 0x72, 0x94, 0xD0 };
+
+        int i = 0;
+
+        LogBenchmark(L"GetVersion5Uuid of 4 KB", shaderCount,
+            [&]
+            {
+                GetVersion5Uuid(salt, data.data() + i++ * shaderSize, shaderSize);
+            });
+    }
+};
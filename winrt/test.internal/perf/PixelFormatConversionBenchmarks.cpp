@@ -0,0 +1,79 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "BenchmarkHelpers.h"
+
+TEST_CLASS(PixelFormatConversionBenchmarks)
+{
+public:
+    // Converts a 1080p image between common formats, with the scalar code,
+    // the vector kernels on one thread, and the vector kernels on every core.
+    BENCHMARK_METHOD(PixelFormatConversion_ConvertPixels_Benchmark)
+    {
+        struct
+        {
+            wchar_t const* Name;
+            DXGI_FORMAT SourceFormat;
+            D2D1_ALPHA_MODE SourceAlpha;
+            DXGI_FORMAT DestinationFormat;
+            D2D1_ALPHA_MODE DestinationAlpha;
+        } conversions[]
+        {
+            { L"BGRA to RGBA",              DXGI_FORMAT_B8G8R8A8_UNORM,      D2D1_ALPHA_MODE_PREMULTIPLIED, DXGI_FORMAT_R8G8B8A8_UNORM,     D2D1_ALPHA_MODE_PREMULTIPLIED },
+            { L"Straight to premultiplied", DXGI_FORMAT_R8G8B8A8_UNORM,      D2D1_ALPHA_MODE_STRAIGHT,      DXGI_FORMAT_B8G8R8A8_UNORM,     D2D1_ALPHA_MODE_PREMULTIPLIED },
+            { L"Premultiplied to straight", DXGI_FORMAT_B8G8R8A8_UNORM,      D2D1_ALPHA_MODE_PREMULTIPLIED, DXGI_FORMAT_R8G8B8A8_UNORM,     D2D1_ALPHA_MODE_STRAIGHT },
+            { L"sRGB to half",              DXGI_FORMAT_B8G8R8A8_UNORM_SRGB, D2D1_ALPHA_MODE_PREMULTIPLIED, DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_PREMULTIPLIED },
+            { L"Half to sRGB",              DXGI_FORMAT_R16G16B16A16_FLOAT,  D2D1_ALPHA_MODE_PREMULTIPLIED, DXGI_FORMAT_B8G8R8A8_UNORM_SRGB, D2D1_ALPHA_MODE_PREMULTIPLIED },
+        };
+
+        uint32_t const width = 1920;
+        uint32_t const height = 1080;
+        int const iterations = 10;
+
+        std::vector<uint8_t> source(width * height * 8);
+        std::vector<uint8_t> destination(width * height * 8);
+
+        for (size_t i = 0; i < source.size(); i++)
+        {
+            source[i] = static_cast<uint8_t>(i * 7 + 3);
+        }
+
+        PixelConversionOptions scalar;
+        scalar.UseVectorKernels = false;
+        scalar.MaximumThreadCount = 1;
+
+        PixelConversionOptions vectorized;
+        vectorized.MaximumThreadCount = 1;
+
+        struct
+        {
+            wchar_t const* Name;
+            PixelConversionOptions Options;
+        } modes[]
+        {
+            { L"scalar",           scalar },
+            { L"vector",           vectorized },
+            { L"vector, threaded", PixelConversionOptions() },
+        };
+
+        for (auto& conversion : conversions)
+        {
+            auto sourceLayout = PixelLayout{ conversion.SourceFormat, conversion.SourceAlpha, width * GetBytesPerBlock(conversion.SourceFormat) };
+            auto destinationLayout = PixelLayout{ conversion.DestinationFormat, conversion.DestinationAlpha, width * GetBytesPerBlock(conversion.DestinationFormat) };
+
+            for (auto& mode : modes)
+            {
+                auto name = std::wstring(L"1080p ") + conversion.Name + L" (" + mode.Name + L")";
+
+                LogBenchmark(name.c_str(), iterations,
+                    [&]
+                    {
+                        ConvertPixels(width, height, source.data(), sourceLayout, destination.data(), destinationLayout, mode.Options);
+                    });
+            }
+        }
+    }
+};
@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include "BenchmarkHelpers.h"
+
+TEST_CLASS(PixelSwizzleBenchmarks)
+{
+    static wchar_t const* GetKernelName(PixelSwizzleKernel kernel)
+    {
+        switch (kernel)
+        {
+        case PixelSwizzleKernel::Scalar: return L"Scalar";
+        case PixelSwizzleKernel::Ssse3:  return L"SSSE3";
+        case PixelSwizzleKernel::Avx2:   return L"AVX2";
+        case PixelSwizzleKernel::Neon:   return L"NEON";
+        default:                         return L"Unknown";
+        }
+    }
+
+public:
+    // Swizzles whole frames with each kernel the CPU supports.
+    BENCHMARK_METHOD(PixelSwizzle_ColorAndBgra_Benchmark)
+    {
+        struct
+        {
+            wchar_t const* Name;
+            uint32_t Width;
+            uint32_t Height;
+        } resolutions[]
+        {
+            { L"720p",  1280,  720 },
+            { L"1080p", 1920, 1080 },
+            { L"4K",    3840, 2160 },
+        };
+
+        PixelSwizzleKernel const kernels[] =
+        {
+            PixelSwizzleKernel::Scalar,
+            PixelSwizzleKernel::Ssse3,
+            PixelSwizzleKernel::Avx2,
+            PixelSwizzleKernel::Neon,
+        };
+
+        int const iterations = 20;
+
+        for (auto& resolution : resolutions)
+        {
+            auto pixelCount = resolution.Width * resolution.Height;
+
+            std::vector<uint8_t> source(pixelCount * 4);
+            std::vector<uint8_t> destination(source.size());
+
+            for (size_t i = 0; i < source.size(); i++)
+            {
+                source[i] = static_cast<uint8_t>(i * 7 + 3);
+            }
+
+            for (auto kernel : kernels)
+            {
+                if (!IsPixelSwizzleKernelSupported(kernel))
+                    continue;
+
+                auto name = std::wstring(resolution.Name) + L" " + GetKernelName(kernel);
+
+                LogBenchmark(name.c_str(), iterations,
+                    [&]
+                    {
+                        SwizzleColorAndBgra(source.data(), destination.data(), pixelCount, kernel);
+                    });
+            }
+        }
+    }
+};
@@ -0,0 +1,75 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+#include <lib/effects/shader/SharedShaderState.h>
+
+#include "BenchmarkHelpers.h"
+
+TEST_CLASS(SharedShaderStateBenchmarks)
+{
+    static std::vector<BYTE> CompileShader(char const* shaderCode)
+    {
+        ComPtr<ID3DBlob> result;
+
+        ThrowIfFailed(D3DCompile(shaderCode, strlen(shaderCode), nullptr, nullptr, nullptr, "main", "ps_4_0", 0, 0, &result, nullptr));
+
+        auto buffer = reinterpret_cast<BYTE*>(result->GetBufferPointer());
+
+        return std::vector<BYTE>(buffer, buffer + result->GetBufferSize());
+    }
+
+public:
+    // Compares setting the same values by name (boxing each one, as callers
+    // of the Properties map must) against setting them by handle.
+    BENCHMARK_METHOD(SharedShaderState_PropertyHandles_Benchmark)
+    {
+        const int iterations = 100000;
+
+        static char const* shaderCode =
+            "cbuffer constants : register(b0)"
+            "{"
+            "    float f                 : packoffset(c0.x);"
+            "    row_major float4x4 rows : packoffset(c1);"
+            "};"
+            "float4 main() : SV_Target"
+            "{"
+            "    return rows._11 * f;"
+            "}";
+
+        auto compiledShader = CompileShader(shaderCode);
+
+        auto byName = Make<SharedShaderState>(compiledShader.data(), static_cast<unsigned>(compiledShader.size()));
+        auto byHandle = Make<SharedShaderState>(compiledShader.data(), static_cast<unsigned>(compiledShader.size()));
+
+        auto fName = HStringReference(L"f");
+        auto rowsName = HStringReference(L"rows");
+
+        auto f = byHandle->GetPropertyHandle(fName.Get());
+        auto rows = byHandle->GetPropertyHandle(rowsName.Get());
+
+        Matrix4x4 matrix = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+
+        int i = 0;
+
+        LogBenchmark(L"SetProperty by name", iterations,
+            [&]
+            {
+                byName->SetProperty(fName.Get(), Make<Nullable<float>>(static_cast<float>(i++)).Get());
+                byName->SetProperty(rowsName.Get(), Make<Nullable<Matrix4x4>>(matrix).Get());
+            });
+
+        i = 0;
+
+        LogBenchmark(L"SetPropertyByHandle", iterations,
+            [&]
+            {
+                byHandle->SetPropertyByHandle(f, static_cast<float>(i++));
+                byHandle->SetPropertyByHandle(rows, matrix);
+            });
+
+        Assert::AreEqual(byName->Constants(), byHandle->Constants());
+    }
+};
@@ -0,0 +1,50 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+namespace canvas
+{
+    class StubBuffer : public RuntimeClass<
+        IBuffer,
+        ::Windows::Storage::Streams::IBufferByteAccess>
+    {
+        std::vector<uint8_t> m_bytes;
+        uint32_t m_length;
+
+    public:
+        StubBuffer(uint32_t capacity)
+            : m_bytes(capacity)
+            , m_length(capacity)
+        {
+        }
+
+        IFACEMETHODIMP get_Capacity(UINT32* value) override
+        {
+            *value = static_cast<UINT32>(m_bytes.size());
+            return S_OK;
+        }
+
+        IFACEMETHODIMP get_Length(UINT32* value) override
+        {
+            *value = m_length;
+            return S_OK;
+        }
+
+        IFACEMETHODIMP put_Length(UINT32 value) override
+        {
+            if (value > m_bytes.size())
+                return E_INVALIDARG;
+
+            m_length = value;
+            return S_OK;
+        }
+
+        IFACEMETHODIMP Buffer(byte** value) override
+        {
+            *value = m_bytes.data();
+            return S_OK;
+        }
+    };
+}
@@ -24,6 +24,9 @@ namespace canvas
         ComPtr<MockD3D11Device> m_d3dDevice;
         ComPtr<MockEventSource<DeviceLostHandlerType>> m_deviceLostEventSource;
         DeviceContextPool m_deviceContextPool;
+        DecodedBitmapCache m_decodedBitmapCache;
+        TransientRenderTargetPool m_transientRenderTargetPool;
+        PixelReadbackQueue m_pixelReadbackQueue;
         
     public:
         StubCanvasDevice(ComPtr<ID2D1Device1> device = Make<StubD2DDevice>(), ComPtr<MockD3D11Device> d3dDevice = nullptr)
@@ -66,6 +69,105 @@ namespace canvas
                     return m_deviceContextPool.TakeLease();
                 });
 
+            // Effects are always created from scratch, so tests can observe each CreateEffect call.
+            LeaseEffectMethod.AllowAnyCall(
+                [=](ID2D1DeviceContext* d2dContext, IID const& effectId)
+                {
+                    DeviceContextLease contextLease;
+
+                    if (!d2dContext)
+                    {
+                        contextLease = GetResourceCreationDeviceContext();
+                        d2dContext = contextLease.Get();
+                    }
+
+                    ComPtr<ID2D1Effect> effect;
+                    ThrowIfFailed(d2dContext->CreateEffect(effectId, &effect));
+                    return effect;
+                });
+
+            ReleaseEffectMethod.AllowAnyCall();
+
+            LeaseStagingBitmapMethod.AllowAnyCall(
+                [=](D2D1_SIZE_U size, D2D1_PIXEL_FORMAT format)
+                {
+                    auto contextLease = GetResourceCreationDeviceContext();
+
+                    auto bitmapProperties = D2D1::BitmapProperties1(
+                        D2D1_BITMAP_OPTIONS_CPU_READ | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
+                        format);
+
+                    ComPtr<ID2D1Bitmap1> bitmap;
+                    ThrowIfFailed(contextLease->CreateBitmap(size, nullptr, 0, &bitmapProperties, &bitmap));
+                    return StagingBitmapLease(std::move(bitmap));
+                });
+
+            EnqueuePixelReadbackMethod.AllowAnyCall(
+                [=](ICanvasBitmap* bitmap, D2D1_RECT_U const& subRectangle)
+                {
+                    return m_pixelReadbackQueue.Enqueue(bitmap, subRectangle);
+                });
+
+            // A real cache, so tests can observe hits and misses through its statistics.
+            FindDecodedBitmapMethod.AllowAnyCall(
+                [=](std::wstring const& key)
+                {
+                    return m_decodedBitmapCache.Find(key);
+                });
+
+            AddDecodedBitmapMethod.AllowAnyCall(
+                [=](std::wstring const& key, ID2D1Bitmap1* bitmap)
+                {
+                    return m_decodedBitmapCache.Add(key, bitmap);
+                });
+
+            GetMaximumDecodedBitmapCacheBytesMethod.AllowAnyCall(
+                [=]
+                {
+                    return m_decodedBitmapCache.GetMaximumBytes();
+                });
+
+            SetMaximumDecodedBitmapCacheBytesMethod.AllowAnyCall(
+                [=](uint64_t value)
+                {
+                    m_decodedBitmapCache.SetMaximumBytes(value);
+                });
+
+            GetDecodedBitmapCacheStatisticsMethod.AllowAnyCall(
+                [=]
+                {
+                    return m_decodedBitmapCache.GetStatistics();
+                });
+
+            // A real pool, so tests can observe reuse through its statistics.
+            LeaseTransientRenderTargetMethod.AllowAnyCall(
+                [=](float width, float height, float dpi, DirectXPixelFormat format, CanvasAlphaMode alpha)
+                {
+                    auto contextLease = GetResourceCreationDeviceContext();
+
+                    auto size = D2D1_SIZE_U
+                    {
+                        static_cast<uint32_t>(SizeDipsToPixels(width, dpi)),
+                        static_cast<uint32_t>(SizeDipsToPixels(height, dpi))
+                    };
+
+                    auto pixelFormat = D2D1::PixelFormat(static_cast<DXGI_FORMAT>(format), ToD2DAlphaMode(alpha));
+
+                    return m_transientRenderTargetPool.TakeLease(contextLease.Get(), size, pixelFormat, dpi);
+                });
+
+            EndTransientRenderTargetFrameMethod.AllowAnyCall(
+                [=]
+                {
+                    m_transientRenderTargetPool.EndFrame();
+                });
+
+            GetTransientRenderTargetPoolStatisticsMethod.AllowAnyCall(
+                [=]
+                {
+                    return m_transientRenderTargetPool.GetStatistics();
+                });
+
             GetPrimaryDisplayOutputMethod.AllowAnyCall(
                 [=]
                 {
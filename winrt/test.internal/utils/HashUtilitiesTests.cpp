@@ -9,6 +9,74 @@ using namespace ABI::Microsoft::Graphics::Canvas;
 
 TEST_CLASS(HashUtilitiesTests)
 {
+    static std::wstring Sha1Hex(std::string const& message, size_t splitPosition = 0)
+    {
+        auto data = reinterpret_cast<BYTE const*>(message.data());
+
+        BYTE digest[Sha1::DigestSize];
+
+        Sha1 sha1;
+        sha1.Update(data, splitPosition);
+        sha1.Update(data + splitPosition, message.size() - splitPosition);
+        sha1.Finish(digest);
+
+        std::wstring result;
+
+        for (auto value : digest)
+        {
+            wchar_t hex[3];
+            swprintf_s(hex, L"%02x", value);
+            result += hex;
+        }
+
+        return result;
+    }
+
+
+    // Known answer tests from FIPS 180-2 appendix A, plus the empty message.
+    TEST_METHOD_EX(Sha1KnownAnswerTest)
+    {
+        Assert::AreEqual<std::wstring>(L"a9993e364706816aba3e25717850c26c9cd0d89d", Sha1Hex("abc"));
+        Assert::AreEqual<std::wstring>(L"da39a3ee5e6b4b0d3255bfef95601890afd80709", Sha1Hex(""));
+        Assert::AreEqual<std::wstring>(L"84983e441c3bd26ebaae4aa1f95129e5e54670f1", Sha1Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+        Assert::AreEqual<std::wstring>(L"34aa973cd4c4daa4f61eeb2bdbad27316534016f", Sha1Hex(std::string(1000000, 'a')));
+    }
+
+
+    TEST_METHOD_EX(Sha1IncrementalUpdatesMatchSingleUpdate)
+    {
+        // Lengths either side of the block size and padding boundaries, split at every position.
+        for (size_t length = 50; length < 140; length++)
+        {
+            std::string message(length, 'x');
+
+            for (size_t i = 0; i < length; i++)
+            {
+                message[i] = static_cast<char>(i * 7);
+            }
+
+            auto expected = Sha1Hex(message);
+
+            for (size_t split = 1; split < length; split++)
+            {
+                Assert::AreEqual(expected, Sha1Hex(message, split));
+            }
+        }
+    }
+
+
+    TEST_METHOD_EX(GetSha1HashTest)
+    {
+        const BYTE data[] = { 'a', 'b', 'c' };
+
+        auto hash = GetSha1Hash(data, sizeof(data));
+
+        Assert::AreEqual(20u, hash.GetSize());
+        Assert::AreEqual<BYTE>(0xa9, hash[0]);
+        Assert::AreEqual<BYTE>(0x9d, hash[19]);
+    }
+
+
     TEST_METHOD_EX(Version5UuidTest)
     {
         const BYTE name1[] = { 'H', 'e', 'l', 'l', 'o' };
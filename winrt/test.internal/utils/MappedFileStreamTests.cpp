@@ -0,0 +1,311 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+#include "../lib/utils/MappedFileStream.h"
+#include "../mocks/MockStream.h"
+
+using namespace ABI::Microsoft::Graphics::Canvas;
+
+TEST_CLASS(MappedFileStreamTests)
+{
+    // Deterministic but irregular contents, so misplaced reads don't match by accident.
+    static BYTE GetExpectedByte(uint64_t offset)
+    {
+        return static_cast<BYTE>(offset * 31 + (offset >> 12));
+    }
+
+    // A file in the temp folder, filled with GetExpectedByte, and deleted afterwards.
+    class TemporaryFile
+    {
+        std::wstring m_path;
+
+    public:
+        TemporaryFile(uint64_t size)
+        {
+            static int nextId = 0;
+
+            wchar_t tempPath[MAX_PATH];
+            Assert::AreNotEqual(0ul, GetTempPathW(MAX_PATH, tempPath));
+
+            m_path = std::wstring(tempPath) + L"MappedFileStreamTests-" + std::to_wstring(GetCurrentProcessId()) + L"-" + std::to_wstring(nextId++) + L".bin";
+
+            Wrappers::FileHandle file(CreateFile2(m_path.c_str(), GENERIC_WRITE, 0, CREATE_ALWAYS, nullptr));
+            Assert::IsTrue(file.IsValid());
+
+            std::vector<BYTE> buffer(1024 * 1024);
+
+            for (uint64_t offset = 0; offset < size; offset += buffer.size())
+            {
+                auto count = static_cast<DWORD>(std::min<uint64_t>(buffer.size(), size - offset));
+
+                for (DWORD i = 0; i < count; i++)
+                {
+                    buffer[i] = GetExpectedByte(offset + i);
+                }
+
+                DWORD written;
+                Assert::IsTrue(!!WriteFile(file.Get(), buffer.data(), count, &written, nullptr));
+                Assert::AreEqual(count, written);
+            }
+        }
+
+        ~TemporaryFile()
+        {
+            DeleteFileW(m_path.c_str());
+        }
+
+        wchar_t const* GetPath() const { return m_path.c_str(); }
+    };
+
+    static void AssertReadMatches(IStream* stream, uint64_t offset, ULONG size, ULONG expectedBytesRead)
+    {
+        std::vector<BYTE> buffer(size);
+        ULONG bytesRead;
+
+        auto hr = stream->Read(buffer.data(), size, &bytesRead);
+
+        Assert::AreEqual((expectedBytesRead == size) ? S_OK : S_FALSE, hr);
+        Assert::AreEqual(expectedBytesRead, bytesRead);
+
+        for (ULONG i = 0; i < bytesRead; i++)
+        {
+            if (buffer[i] != GetExpectedByte(offset + i))
+                Assert::Fail(L"Unexpected byte");
+        }
+    }
+
+    static uint64_t Seek(IStream* stream, int64_t offset, DWORD origin)
+    {
+        LARGE_INTEGER distance;
+        distance.QuadPart = offset;
+
+        ULARGE_INTEGER newPosition;
+        ThrowIfFailed(stream->Seek(distance, origin, &newPosition));
+
+        return newPosition.QuadPart;
+    }
+
+public:
+    TEST_METHOD_EX(MappedFileStream_Create_MissingFile_Throws)
+    {
+        ExpectHResultException(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND),
+            [] { MappedFileStream::Create(L"MappedFileStreamTests-does-not-exist.bin"); });
+    }
+
+    TEST_METHOD_EX(MappedFileStream_TryCreate_ReturnsNullAboveMaxSize)
+    {
+        TemporaryFile file(1000);
+
+        Assert::IsNull(MappedFileStream::TryCreate(file.GetPath(), 999).Get());
+
+        auto stream = MappedFileStream::TryCreate(file.GetPath(), 1000);
+        Assert::IsNotNull(stream.Get());
+
+        AssertReadMatches(stream.Get(), 0, 1000, 1000);
+    }
+
+    TEST_METHOD_EX(MappedFileStream_TryCreate_MissingFile_Throws)
+    {
+        ExpectHResultException(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND),
+            [] { MappedFileStream::TryCreate(L"MappedFileStreamTests-does-not-exist.bin", UINT64_MAX); });
+    }
+
+    TEST_METHOD_EX(MappedFileStream_EmptyFile)
+    {
+        TemporaryFile file(0);
+
+        auto stream = MappedFileStream::Create(file.GetPath());
+
+        STATSTG statistics;
+        Assert::AreEqual(S_OK, stream->Stat(&statistics, STATFLAG_NONAME));
+        Assert::AreEqual<uint64_t>(0, statistics.cbSize.QuadPart);
+
+        AssertReadMatches(stream.Get(), 0, 16, 0);
+    }
+
+    TEST_METHOD_EX(MappedFileStream_LargeFile_SequentialReadsMatchContents)
+    {
+        // Large enough to span many pages, with a size that isn't a multiple of them.
+        uint64_t const size = 40 * 1024 * 1024 + 3;
+
+        TemporaryFile file(size);
+
+        auto stream = MappedFileStream::Create(file.GetPath());
+
+        Assert::AreEqual(size, stream->GetSize());
+
+        STATSTG statistics;
+        Assert::AreEqual(S_OK, stream->Stat(&statistics, STATFLAG_NONAME));
+        Assert::AreEqual(size, statistics.cbSize.QuadPart);
+        Assert::IsNull(statistics.pwcsName);
+
+        ULONG const chunkSize = 1024 * 1024 + 17;
+        uint64_t offset = 0;
+
+        while (size - offset >= chunkSize)
+        {
+            AssertReadMatches(stream.Get(), offset, chunkSize, chunkSize);
+            offset += chunkSize;
+        }
+
+        // The last read is short, and reports S_FALSE.
+        AssertReadMatches(stream.Get(), offset, chunkSize, static_cast<ULONG>(size - offset));
+
+        // After that there is nothing left.
+        AssertReadMatches(stream.Get(), size, chunkSize, 0);
+    }
+
+    TEST_METHOD_EX(MappedFileStream_LargeFile_RandomAccessReadsMatchContents)
+    {
+        uint64_t const size = 40 * 1024 * 1024 + 3;
+
+        TemporaryFile file(size);
+
+        auto stream = MappedFileStream::Create(file.GetPath());
+
+        Assert::AreEqual<uint64_t>(size - 100, Seek(stream.Get(), -100, STREAM_SEEK_END));
+        AssertReadMatches(stream.Get(), size - 100, 100, 100);
+
+        Assert::AreEqual<uint64_t>(12345, Seek(stream.Get(), 12345, STREAM_SEEK_SET));
+        AssertReadMatches(stream.Get(), 12345, 1000, 1000);
+
+        Assert::AreEqual<uint64_t>(12345 + 1000 + 20 * 1024 * 1024, Seek(stream.Get(), 20 * 1024 * 1024, STREAM_SEEK_CUR));
+        AssertReadMatches(stream.Get(), 12345 + 1000 + 20 * 1024 * 1024, 4096, 4096);
+
+        Assert::AreEqual<uint64_t>(12345 + 1000 + 20 * 1024 * 1024, Seek(stream.Get(), -4096, STREAM_SEEK_CUR));
+        AssertReadMatches(stream.Get(), 12345 + 1000 + 20 * 1024 * 1024, 4096, 4096);
+    }
+
+    TEST_METHOD_EX(MappedFileStream_Seek_Validation)
+    {
+        TemporaryFile file(100);
+
+        auto stream = MappedFileStream::Create(file.GetPath());
+
+        LARGE_INTEGER distance;
+        distance.QuadPart = -1;
+
+        Assert::AreEqual(STG_E_INVALIDFUNCTION, stream->Seek(distance, STREAM_SEEK_SET, nullptr));
+        Assert::AreEqual(STG_E_INVALIDFUNCTION, stream->Seek(distance, 3, nullptr));
+
+        // Seeking past the end is allowed, but there's nothing to read there.
+        Assert::AreEqual<uint64_t>(200, Seek(stream.Get(), 200, STREAM_SEEK_SET));
+        AssertReadMatches(stream.Get(), 200, 10, 0);
+    }
+
+    TEST_METHOD_EX(MappedFileStream_IsReadOnly)
+    {
+        TemporaryFile file(100);
+
+        auto stream = MappedFileStream::Create(file.GetPath());
+
+        BYTE data[4]{};
+        ULONG bytesWritten = 1;
+
+        Assert::AreEqual(STG_E_ACCESSDENIED, stream->Write(data, sizeof(data), &bytesWritten));
+        Assert::AreEqual(0ul, bytesWritten);
+
+        Assert::AreEqual(STG_E_ACCESSDENIED, stream->SetSize(ULARGE_INTEGER{}));
+    }
+
+    TEST_METHOD_EX(MappedFileStream_Clone_HasIndependentPositionAndOutlivesOriginal)
+    {
+        TemporaryFile file(100000);
+
+        auto stream = MappedFileStream::Create(file.GetPath());
+
+        Seek(stream.Get(), 1000, STREAM_SEEK_SET);
+
+        ComPtr<IStream> clone;
+        Assert::AreEqual(S_OK, stream->Clone(&clone));
+
+        // The clone starts at the same position, but moves independently.
+        AssertReadMatches(stream.Get(), 1000, 500, 500);
+        AssertReadMatches(clone.Get(), 1000, 500, 500);
+
+        stream.Reset();
+
+        AssertReadMatches(clone.Get(), 1500, 50000, 50000);
+    }
+
+    TEST_METHOD_EX(MappedFileStream_CopyTo_CopiesFromCurrentPosition)
+    {
+        TemporaryFile file(100000);
+
+        auto stream = MappedFileStream::Create(file.GetPath());
+
+        Seek(stream.Get(), 99000, STREAM_SEEK_SET);
+
+        ComPtr<IStream> target;
+        ThrowIfFailed(CreateStreamOnHGlobal(nullptr, TRUE, &target));
+
+        ULARGE_INTEGER size;
+        size.QuadPart = 5000;
+
+        ULARGE_INTEGER bytesRead, bytesWritten;
+        Assert::AreEqual(S_OK, stream->CopyTo(target.Get(), size, &bytesRead, &bytesWritten));
+
+        // Only 1000 bytes were left to copy.
+        Assert::AreEqual<uint64_t>(1000, bytesRead.QuadPart);
+        Assert::AreEqual<uint64_t>(1000, bytesWritten.QuadPart);
+
+        HGLOBAL global;
+        ThrowIfFailed(GetHGlobalFromStream(target.Get(), &global));
+
+        auto copied = static_cast<BYTE const*>(GlobalLock(global));
+
+        for (uint64_t i = 0; i < 1000; i++)
+        {
+            Assert::AreEqual(GetExpectedByte(99000 + i), copied[i]);
+        }
+
+        GlobalUnlock(global);
+    }
+
+    TEST_METHOD_EX(MappedFileStream_CopyTo_WritesFromBoundedBuffer)
+    {
+        const uint64_t size = MappedFileStream::CopyToBufferSize * 3 + 100;
+
+        TemporaryFile file(size);
+
+        auto stream = MappedFileStream::Create(file.GetPath());
+        auto target = Make<MockStream>();
+
+        uint64_t totalWritten = 0;
+        int writeCount = 0;
+
+        target->WriteMethod.AllowAnyCall(
+            [&](void const* buffer, ULONG bufferSize, ULONG* bytesWritten)
+            {
+                auto bytes = static_cast<BYTE const*>(buffer);
+
+                // The destination never sees the mapped view itself.
+                Assert::IsTrue(bytes < stream->GetData() || bytes >= stream->GetData() + size);
+                Assert::IsTrue(bufferSize <= MappedFileStream::CopyToBufferSize);
+
+                for (ULONG i = 0; i < bufferSize; i++)
+                {
+                    Assert::AreEqual(GetExpectedByte(totalWritten + i), bytes[i]);
+                }
+
+                totalWritten += bufferSize;
+                writeCount++;
+
+                *bytesWritten = bufferSize;
+                return S_OK;
+            });
+
+        ULARGE_INTEGER copySize;
+        copySize.QuadPart = UINT64_MAX;
+
+        ULARGE_INTEGER bytesRead, bytesWritten;
+        Assert::AreEqual(S_OK, stream->CopyTo(target.Get(), copySize, &bytesRead, &bytesWritten));
+
+        Assert::AreEqual<uint64_t>(size, bytesRead.QuadPart);
+        Assert::AreEqual<uint64_t>(size, bytesWritten.QuadPart);
+        Assert::AreEqual<uint64_t>(size, totalWritten);
+        Assert::AreEqual(4, writeCount);
+    }
+};
@@ -0,0 +1,614 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+static bool IsHalfNaN(uint16_t value)
+{
+    return (value & 0x7C00) == 0x7C00 && (value & 0x3FF) != 0;
+}
+
+// Every combination of color and alpha, with the color in the first three bytes.
+static std::vector<uint8_t> MakeEveryColorAndAlpha()
+{
+    std::vector<uint8_t> pixels(256 * 256 * 4);
+
+    for (int color = 0; color < 256; color++)
+    {
+        for (int alpha = 0; alpha < 256; alpha++)
+        {
+            auto pixel = &pixels[(color * 256 + alpha) * 4];
+
+            pixel[0] = static_cast<uint8_t>(color);
+            pixel[1] = static_cast<uint8_t>(255 - color);
+            pixel[2] = static_cast<uint8_t>(color ^ alpha);
+            pixel[3] = static_cast<uint8_t>(alpha);
+        }
+    }
+
+    return pixels;
+}
+
+static PixelLayout Layout(DXGI_FORMAT format, D2D1_ALPHA_MODE alphaMode, uint32_t stride)
+{
+    return PixelLayout{ format, alphaMode, stride };
+}
+
+static PixelConversionOptions ScalarSingleThreaded()
+{
+    PixelConversionOptions options;
+    options.UseVectorKernels = false;
+    options.MaximumThreadCount = 1;
+    return options;
+}
+
+TEST_CLASS(PixelFormatConversionTests)
+{
+    TEST_METHOD_EX(PixelFormatConversion_Half_EveryValueRoundTrips)
+    {
+        for (uint32_t i = 0; i <= 0xFFFF; i++)
+        {
+            auto half = static_cast<uint16_t>(i);
+
+            if (IsHalfNaN(half))
+            {
+                Assert::IsTrue(IsHalfNaN(FloatToHalf(HalfToFloat(half))));
+            }
+            else
+            {
+                Assert::AreEqual(half, FloatToHalf(HalfToFloat(half)));
+            }
+        }
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_Half_Rounding)
+    {
+        Assert::AreEqual<uint16_t>(0x3C00, FloatToHalf(1.0f));
+        Assert::AreEqual<uint16_t>(0xC000, FloatToHalf(-2.0f));
+        Assert::AreEqual<uint16_t>(0x7BFF, FloatToHalf(65504.0f));
+        Assert::AreEqual<uint16_t>(0x7BFF, FloatToHalf(65519.0f));
+        Assert::AreEqual<uint16_t>(0x7C00, FloatToHalf(65520.0f));
+        Assert::AreEqual<uint16_t>(0xFC00, FloatToHalf(-std::numeric_limits<float>::infinity()));
+
+        // Ties round to even.
+        Assert::AreEqual<uint16_t>(0x3C00, FloatToHalf(1.0f + 1.0f / 2048));
+        Assert::AreEqual<uint16_t>(0x3C02, FloatToHalf(1.0f + 3.0f / 2048));
+
+        // Denormals, including the tie between zero and the smallest denormal.
+        Assert::AreEqual<uint16_t>(0x0001, FloatToHalf(ldexpf(1.0f, -24)));
+        Assert::AreEqual<uint16_t>(0x0000, FloatToHalf(ldexpf(1.0f, -25)));
+        Assert::AreEqual<uint16_t>(0x0001, FloatToHalf(ldexpf(1.5f, -25)));
+        Assert::AreEqual<uint16_t>(0x0400, FloatToHalf(ldexpf(1.0f, -14)));
+
+        Assert::IsTrue(IsHalfNaN(FloatToHalf(std::numeric_limits<float>::quiet_NaN())));
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_Half_VectorKernelsMatchScalar)
+    {
+        std::vector<uint16_t> halves(0x10000);
+
+        for (uint32_t i = 0; i < halves.size(); i++)
+        {
+            halves[i] = static_cast<uint16_t>(i);
+        }
+
+        std::vector<float> vectorFloats(halves.size());
+        std::vector<float> scalarFloats(halves.size());
+
+        HalfToFloat(halves.data(), vectorFloats.data(), static_cast<uint32_t>(halves.size()), true);
+        HalfToFloat(halves.data(), scalarFloats.data(), static_cast<uint32_t>(halves.size()), false);
+
+        Assert::IsTrue(memcmp(vectorFloats.data(), scalarFloats.data(), vectorFloats.size() * sizeof(float)) == 0);
+
+        // A spread of float bit patterns, covering every exponent.
+        std::vector<float> floats;
+
+        for (uint64_t bits = 0; bits <= 0xFFFFFFFF; bits += 4099)
+        {
+            auto bits32 = static_cast<uint32_t>(bits);
+
+            float value;
+            memcpy(&value, &bits32, sizeof(value));
+
+            if (!std::isnan(value))
+                floats.push_back(value);
+        }
+
+        std::vector<uint16_t> vectorHalves(floats.size());
+        std::vector<uint16_t> scalarHalves(floats.size());
+
+        FloatToHalf(floats.data(), vectorHalves.data(), static_cast<uint32_t>(floats.size()), true);
+        FloatToHalf(floats.data(), scalarHalves.data(), static_cast<uint32_t>(floats.size()), false);
+
+        Assert::IsTrue(vectorHalves == scalarHalves);
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_Premultiply_EveryColorAndAlpha)
+    {
+        auto original = MakeEveryColorAndAlpha();
+
+        for (auto useVectorKernels : { false, true })
+        {
+            auto pixels = original;
+
+            PremultiplyPixels(pixels.data(), 256 * 256, useVectorKernels);
+
+            for (size_t i = 0; i < pixels.size(); i++)
+            {
+                uint32_t alpha = original[i | 3];
+
+                if ((i & 3) == 3)
+                    Assert::AreEqual(original[i], pixels[i]);
+                else
+                    Assert::AreEqual(static_cast<uint8_t>((original[i] * alpha * 2 + 255) / 510), pixels[i]);
+            }
+        }
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_Unpremultiply_EveryColorAndAlpha)
+    {
+        auto original = MakeEveryColorAndAlpha();
+        auto pixels = original;
+
+        UnpremultiplyPixels(pixels.data(), 256 * 256);
+
+        for (size_t i = 0; i < pixels.size(); i++)
+        {
+            uint32_t alpha = original[i | 3];
+
+            if ((i & 3) == 3)
+                Assert::AreEqual(original[i], pixels[i]);
+            else if (alpha == 0)
+                Assert::AreEqual<uint8_t>(0, pixels[i]);
+            else
+                Assert::AreEqual(static_cast<uint8_t>(std::min<uint32_t>((original[i] * 255 + alpha / 2) / alpha, 255)), pixels[i]);
+        }
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_PremultiplyThenUnpremultiply_PreservesOpaqueColors)
+    {
+        auto original = MakeEveryColorAndAlpha();
+        auto pixels = original;
+
+        PremultiplyPixels(pixels.data(), 256 * 256, true);
+        UnpremultiplyPixels(pixels.data(), 256 * 256);
+
+        for (size_t i = 0; i < pixels.size(); i += 4)
+        {
+            if (original[i + 3] == 255)
+            {
+                Assert::IsTrue(memcmp(&original[i], &pixels[i], 4) == 0);
+            }
+        }
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_Srgb_EveryByteRoundTripsThroughHalf)
+    {
+        std::vector<uint8_t> srgb(256 * 4);
+
+        for (int i = 0; i < 256; i++)
+        {
+            srgb[i * 4 + 0] = static_cast<uint8_t>(i);
+            srgb[i * 4 + 1] = static_cast<uint8_t>(255 - i);
+            srgb[i * 4 + 2] = static_cast<uint8_t>(i * 3);
+            srgb[i * 4 + 3] = 255;
+        }
+
+        std::vector<uint16_t> linear(256 * 4);
+        std::vector<uint8_t> result(256 * 4);
+
+        ConvertPixels(
+            256, 1,
+            srgb.data(), Layout(DXGI_FORMAT_B8G8R8A8_UNORM_SRGB, D2D1_ALPHA_MODE_STRAIGHT, 256 * 4),
+            reinterpret_cast<uint8_t*>(linear.data()), Layout(DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_STRAIGHT, 256 * 8));
+
+        for (int i = 0; i < 256; i++)
+        {
+            // B8G8R8A8 blue is R16G16B16A16 blue.
+            auto expected = SrgbToLinear(i / 255.0f);
+            auto actual = HalfToFloat(linear[i * 4 + 2]);
+
+            Assert::AreEqual(expected, actual, expected / 1000 + 1e-6f);
+            Assert::AreEqual(1.0f, HalfToFloat(linear[i * 4 + 3]));
+        }
+
+        ConvertPixels(
+            256, 1,
+            reinterpret_cast<uint8_t*>(linear.data()), Layout(DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_STRAIGHT, 256 * 8),
+            result.data(), Layout(DXGI_FORMAT_B8G8R8A8_UNORM_SRGB, D2D1_ALPHA_MODE_STRAIGHT, 256 * 4));
+
+        Assert::IsTrue(srgb == result);
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_Srgb_MatchesFormula)
+    {
+        for (int i = 0; i <= 1000; i++)
+        {
+            auto linear = i / 1000.0f;
+
+            Assert::AreEqual(linear, SrgbToLinear(LinearToSrgb(linear)), 1e-5f);
+        }
+
+        Assert::AreEqual(0.0f, LinearToSrgb(0.0f));
+        Assert::AreEqual(1.0f, LinearToSrgb(1.0f), 1e-6f);
+        Assert::AreEqual(0.5f, SrgbToLinear(0.735357f), 1e-5f);
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_ChannelOrderAndPremultiply_MatchesKernels)
+    {
+        auto bgra = MakeEveryColorAndAlpha();
+
+        auto premultiplied = bgra;
+        PremultiplyPixels(premultiplied.data(), 256 * 256, false);
+
+        for (auto options : { PixelConversionOptions(), ScalarSingleThreaded() })
+        {
+            std::vector<uint8_t> rgba(bgra.size());
+
+            ConvertPixels(
+                256, 256,
+                bgra.data(), Layout(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_STRAIGHT, 256 * 4),
+                rgba.data(), Layout(DXGI_FORMAT_R8G8B8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED, 256 * 4),
+                options);
+
+            for (size_t i = 0; i < rgba.size(); i += 4)
+            {
+                Assert::AreEqual(premultiplied[i + 2], rgba[i + 0]);
+                Assert::AreEqual(premultiplied[i + 1], rgba[i + 1]);
+                Assert::AreEqual(premultiplied[i + 0], rgba[i + 2]);
+                Assert::AreEqual(premultiplied[i + 3], rgba[i + 3]);
+            }
+        }
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_AlphaModes)
+    {
+        uint8_t const straight[] = { 200, 100, 50, 128 };
+
+        auto convert = [&](D2D1_ALPHA_MODE from, D2D1_ALPHA_MODE to)
+        {
+            std::vector<uint8_t> result(4);
+
+            ConvertPixels(
+                1, 1,
+                straight, Layout(DXGI_FORMAT_B8G8R8A8_UNORM, from, 4),
+                result.data(), Layout(DXGI_FORMAT_B8G8R8A8_UNORM, to, 4));
+
+            return result;
+        };
+
+        // Straight to ignore composites over black.
+        Assert::IsTrue(std::vector<uint8_t>{ 100, 50, 25, 255 } == convert(D2D1_ALPHA_MODE_STRAIGHT, D2D1_ALPHA_MODE_IGNORE));
+
+        // Premultiplied to ignore keeps the colors.
+        Assert::IsTrue(std::vector<uint8_t>{ 200, 100, 50, 255 } == convert(D2D1_ALPHA_MODE_PREMULTIPLIED, D2D1_ALPHA_MODE_IGNORE));
+
+        // Ignored alpha is opaque.
+        Assert::IsTrue(std::vector<uint8_t>{ 200, 100, 50, 255 } == convert(D2D1_ALPHA_MODE_IGNORE, D2D1_ALPHA_MODE_STRAIGHT));
+        Assert::IsTrue(std::vector<uint8_t>{ 200, 100, 50, 255 } == convert(D2D1_ALPHA_MODE_IGNORE, D2D1_ALPHA_MODE_PREMULTIPLIED));
+
+        Assert::IsTrue(std::vector<uint8_t>{ 100, 50, 25, 128 } == convert(D2D1_ALPHA_MODE_STRAIGHT, D2D1_ALPHA_MODE_PREMULTIPLIED));
+        Assert::IsTrue(std::vector<uint8_t>{ 255, 199, 100, 128 } == convert(D2D1_ALPHA_MODE_PREMULTIPLIED, D2D1_ALPHA_MODE_STRAIGHT));
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_HalfAndUnorm_AgreeWithinRounding)
+    {
+        auto bgra = MakeEveryColorAndAlpha();
+
+        auto premultiplied = bgra;
+        PremultiplyPixels(premultiplied.data(), 256 * 256, false);
+
+        std::vector<uint8_t> halves(bgra.size() * 2);
+        std::vector<uint8_t> result(bgra.size());
+
+        ConvertPixels(
+            256, 256,
+            bgra.data(), Layout(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_STRAIGHT, 256 * 4),
+            halves.data(), Layout(DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_PREMULTIPLIED, 256 * 8));
+
+        ConvertPixels(
+            256, 256,
+            halves.data(), Layout(DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_PREMULTIPLIED, 256 * 8),
+            result.data(), Layout(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED, 256 * 4));
+
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            Assert::IsTrue(abs(result[i] - premultiplied[i]) <= 1);
+        }
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_HonorsStrides)
+    {
+        uint32_t const width = 3;
+        uint32_t const height = 4;
+        uint32_t const sourceStride = 20;
+        uint32_t const destinationStride = 32;
+
+        std::vector<uint8_t> source(sourceStride * height);
+
+        for (size_t i = 0; i < source.size(); i++)
+        {
+            source[i] = static_cast<uint8_t>(i);
+        }
+
+        std::vector<uint8_t> destination(destinationStride * height, 0xCD);
+
+        ConvertPixels(
+            width, height,
+            source.data(), Layout(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED, sourceStride),
+            destination.data(), Layout(DXGI_FORMAT_R8G8B8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED, destinationStride));
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < destinationStride; x++)
+            {
+                auto actual = destination[y * destinationStride + x];
+
+                if (x < width * 4)
+                {
+                    uint32_t sourceByte = (x & ~3u) + ((x & 3) == 0 ? 2 : (x & 3) == 2 ? 0 : (x & 3));
+                    Assert::AreEqual(source[y * sourceStride + sourceByte], actual);
+                }
+                else
+                {
+                    Assert::AreEqual<uint8_t>(0xCD, actual);
+                }
+            }
+        }
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_MultipleThreads_MatchSingleThread)
+    {
+        uint32_t const width = 1500;
+        uint32_t const height = 1001;
+
+        std::vector<uint8_t> source(width * height * 4);
+
+        for (size_t i = 0; i < source.size(); i++)
+        {
+            source[i] = static_cast<uint8_t>(i * 7 + 3);
+        }
+
+        std::vector<uint8_t> threaded(width * height * 8);
+        std::vector<uint8_t> singleThreaded(width * height * 8);
+
+        PixelConversionOptions allThreads;
+        allThreads.MaximumThreadCount = 8;
+
+        ConvertPixels(
+            width, height,
+            source.data(), Layout(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, D2D1_ALPHA_MODE_PREMULTIPLIED, width * 4),
+            threaded.data(), Layout(DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_STRAIGHT, width * 8),
+            allThreads);
+
+        ConvertPixels(
+            width, height,
+            source.data(), Layout(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, D2D1_ALPHA_MODE_PREMULTIPLIED, width * 4),
+            singleThreaded.data(), Layout(DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_STRAIGHT, width * 8),
+            ScalarSingleThreaded());
+
+        Assert::IsTrue(threaded == singleThreaded);
+    }
+
+
+    TEST_METHOD_EX(PixelFormatConversion_UnsupportedFormats_Throw)
+    {
+        uint8_t pixels[16] = {};
+
+        Assert::IsTrue(IsConvertiblePixelFormat(DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_IGNORE));
+        Assert::IsFalse(IsConvertiblePixelFormat(DXGI_FORMAT_A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+        Assert::IsFalse(IsConvertiblePixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_UNKNOWN));
+
+        ExpectHResultException(E_INVALIDARG, [&]
+        {
+            ConvertPixels(
+                1, 1,
+                pixels, Layout(DXGI_FORMAT_A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED, 4),
+                pixels, Layout(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED, 4));
+        });
+
+        ExpectHResultException(E_INVALIDARG, [&]
+        {
+            ConvertPixels(
+                2, 1,
+                pixels, Layout(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED, 8),
+                pixels + 8, Layout(DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_PREMULTIPLIED, 8));
+        });
+    }
+};
+
+
+//
+// Staging bitmap that can be mapped, exposing fixed B8G8R8A8 pixels.
+//
+class MappableD2DBitmap : public MockD2DBitmap
+{
+public:
+    static const uint32_t Pitch = 32;
+
+    std::vector<uint8_t> Pixels;
+
+    MappableD2DBitmap(uint32_t height)
+        : Pixels(Pitch * height)
+    {
+        for (size_t i = 0; i < Pixels.size(); i++)
+        {
+            Pixels[i] = static_cast<uint8_t>(i);
+        }
+
+        CopyFromBitmapMethod.AllowAnyCall();
+    }
+
+    STDMETHOD(Map)(D2D1_MAP_OPTIONS, D2D1_MAPPED_RECT* mappedRect) override
+    {
+        mappedRect->pitch = Pitch;
+        mappedRect->bits = Pixels.data();
+        return S_OK;
+    }
+
+    STDMETHOD(Unmap)() override
+    {
+        return S_OK;
+    }
+};
+
+
+//
+// Bitmap that records what is copied into it.
+//
+class WritableD2DBitmap : public StubD2DBitmap
+{
+public:
+    std::vector<uint8_t> CopiedBytes;
+    UINT32 CopiedPitch;
+
+    WritableD2DBitmap()
+        : CopiedPitch(0)
+    {
+    }
+
+    STDMETHOD(CopyFromMemory)(D2D1_RECT_U const* destinationRect, void const* sourceData, UINT32 pitch) override
+    {
+        auto height = destinationRect->bottom - destinationRect->top;
+        auto bytes = static_cast<uint8_t const*>(sourceData);
+
+        CopiedBytes.assign(bytes, bytes + pitch * height);
+        CopiedPitch = pitch;
+        return S_OK;
+    }
+};
+
+
+TEST_CLASS(CanvasBitmapPixelFormatConversionTests)
+{
+    struct Fixture
+    {
+        ComPtr<StubCanvasDevice> Device;
+        ComPtr<WritableD2DBitmap> D2DBitmap;
+
+        Fixture(DXGI_FORMAT format = DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE alphaMode = D2D1_ALPHA_MODE_PREMULTIPLIED)
+            : Device(Make<StubCanvasDevice>())
+            , D2DBitmap(Make<WritableD2DBitmap>())
+        {
+            D2DBitmap->GetPixelFormatMethod.AllowAnyCall([=] { return D2D1::PixelFormat(format, alphaMode); });
+            D2DBitmap->GetPixelSizeMethod.AllowAnyCall([] { return D2D_SIZE_U{ 8, 8 }; });
+
+            Device->LeaseStagingBitmapMethod.AllowAnyCall(
+                [](D2D1_SIZE_U size, D2D1_PIXEL_FORMAT)
+                {
+                    return StagingBitmapLease(Make<MappableD2DBitmap>(size.height));
+                });
+        }
+    };
+
+    TEST_METHOD_EX(CanvasBitmap_GetPixelBytes_ConvertsToTargetFormat)
+    {
+        Fixture f;
+
+        ComPtr<ICanvasDevice> device(f.Device);
+        ComPtr<ID2D1Bitmap1> d2dBitmap(f.D2DBitmap);
+
+        uint32_t valueCount;
+        ComArray<uint8_t> values;
+
+        GetPixelBytesImpl(device, d2dBitmap, D2D1::RectU(1, 2, 4, 4), DXGI_FORMAT_R8G8B8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED, &valueCount, values.GetAddressOfData());
+
+        Assert::AreEqual<uint32_t>(3 * 2 * 4, valueCount);
+
+        // Red and blue swap places.
+        for (uint32_t y = 0; y < 2; y++)
+        {
+            for (uint32_t x = 0; x < 3; x++)
+            {
+                auto pixel = &values.GetData()[(y * 3 + x) * 4];
+                auto sourceByte = static_cast<uint8_t>(y * MappableD2DBitmap::Pitch + x * 4);
+
+                Assert::AreEqual<uint8_t>(sourceByte + 2, pixel[0]);
+                Assert::AreEqual<uint8_t>(sourceByte + 1, pixel[1]);
+                Assert::AreEqual<uint8_t>(sourceByte + 0, pixel[2]);
+                Assert::AreEqual<uint8_t>(sourceByte + 3, pixel[3]);
+            }
+        }
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_GetPixelBytes_ToHalfFloat)
+    {
+        Fixture f;
+
+        ComPtr<ICanvasDevice> device(f.Device);
+        ComPtr<ID2D1Bitmap1> d2dBitmap(f.D2DBitmap);
+
+        uint32_t valueCount;
+        ComArray<uint8_t> values;
+
+        GetPixelBytesImpl(device, d2dBitmap, D2D1::RectU(0, 0, 8, 8), DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_PREMULTIPLIED, &valueCount, values.GetAddressOfData());
+
+        Assert::AreEqual<uint32_t>(8 * 8 * 8, valueCount);
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_SetPixelBytes_ConvertsToBitmapFormat)
+    {
+        Fixture f(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED);
+
+        ComPtr<ID2D1Bitmap1> d2dBitmap(f.D2DBitmap);
+
+        // Two straight R8G8B8A8 pixels.
+        uint8_t pixels[] = { 200, 100, 50, 128, 10, 20, 30, 255 };
+
+        SetPixelBytesImpl(d2dBitmap, D2D1::RectU(0, 0, 2, 1), DXGI_FORMAT_R8G8B8A8_UNORM, D2D1_ALPHA_MODE_STRAIGHT, _countof(pixels), pixels);
+
+        Assert::AreEqual<uint32_t>(8, f.D2DBitmap->CopiedPitch);
+        Assert::IsTrue(std::vector<uint8_t>{ 25, 50, 100, 128, 30, 20, 10, 255 } == f.D2DBitmap->CopiedBytes);
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_SetPixelBytes_ArrayTooSmall)
+    {
+        Fixture f;
+
+        ComPtr<ID2D1Bitmap1> d2dBitmap(f.D2DBitmap);
+
+        uint8_t pixels[2 * 2 * 8 - 1] = {};
+
+        ExpectHResultException(E_INVALIDARG, [&]
+        {
+            SetPixelBytesImpl(d2dBitmap, D2D1::RectU(0, 0, 2, 2), DXGI_FORMAT_R16G16B16A16_FLOAT, D2D1_ALPHA_MODE_PREMULTIPLIED, _countof(pixels), pixels);
+        });
+    }
+
+    TEST_METHOD_EX(CanvasBitmap_PixelBytesConversion_UnsupportedFormats)
+    {
+        Fixture f(DXGI_FORMAT_A8_UNORM);
+
+        ComPtr<ICanvasDevice> device(f.Device);
+        ComPtr<ID2D1Bitmap1> d2dBitmap(f.D2DBitmap);
+
+        uint8_t pixels[8 * 8 * 8] = {};
+        uint32_t valueCount;
+        ComArray<uint8_t> values;
+
+        f.Device->LeaseStagingBitmapMethod.SetExpectedCalls(0);
+
+        ExpectHResultException(E_INVALIDARG, [&]
+        {
+            GetPixelBytesImpl(device, d2dBitmap, D2D1::RectU(0, 0, 1, 1), DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED, &valueCount, values.GetAddressOfData());
+        });
+
+        ExpectHResultException(E_INVALIDARG, [&]
+        {
+            SetPixelBytesImpl(d2dBitmap, D2D1::RectU(0, 0, 1, 1), DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED, _countof(pixels), pixels);
+        });
+    }
+};
@@ -0,0 +1,154 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Licensed under the MIT License. See LICENSE.txt in the project root for license information.
+
+#include "pch.h"
+
+static PixelSwizzleKernel const allKernels[] =
+{
+    PixelSwizzleKernel::Scalar,
+    PixelSwizzleKernel::Ssse3,
+    PixelSwizzleKernel::Avx2,
+    PixelSwizzleKernel::Neon,
+};
+
+static std::vector<uint8_t> MakeTestBytes(size_t size)
+{
+    std::vector<uint8_t> bytes(size);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        bytes[i] = static_cast<uint8_t>(i * 7 + 3);
+    }
+
+    return bytes;
+}
+
+TEST_CLASS(PixelSwizzleTests)
+{
+    TEST_METHOD_EX(PixelSwizzle_ScalarKernel_IsAlwaysSupported)
+    {
+        Assert::IsTrue(IsPixelSwizzleKernelSupported(PixelSwizzleKernel::Scalar));
+        Assert::IsTrue(IsPixelSwizzleKernelSupported(GetDefaultPixelSwizzleKernel()));
+    }
+
+
+    TEST_METHOD_EX(PixelSwizzle_ColorToBgra_MatchesColorChannels)
+    {
+        Color colors[] =
+        {
+            { 0x11, 0x22, 0x33, 0x44 },
+            { 0xFF, 0x00, 0x80, 0x7F },
+        };
+
+        auto bytes = ConvertColorsToBgra(_countof(colors), colors);
+
+        uint8_t expected[] =
+        {
+            0x44, 0x33, 0x22, 0x11,
+            0x7F, 0x80, 0x00, 0xFF,
+        };
+
+        Assert::AreEqual<size_t>(_countof(expected), bytes.size());
+
+        for (size_t i = 0; i < _countof(expected); i++)
+        {
+            Assert::AreEqual(expected[i], bytes[i]);
+        }
+    }
+
+
+    TEST_METHOD_EX(PixelSwizzle_EveryKernel_ReversesBytesOfEachPixel)
+    {
+        // Covers empty input, lengths shorter than a vector, and every length of tail.
+        for (auto kernel : allKernels)
+        {
+            if (!IsPixelSwizzleKernelSupported(kernel))
+                continue;
+
+            for (uint32_t pixelCount = 0; pixelCount <= 35; pixelCount++)
+            {
+                auto source = MakeTestBytes(pixelCount * 4 + 1);
+                std::vector<uint8_t> destination(pixelCount * 4 + 1, 0xCD);
+
+                SwizzleColorAndBgra(source.data(), destination.data(), pixelCount, kernel);
+
+                for (uint32_t i = 0; i < pixelCount * 4; i++)
+                {
+                    Assert::AreEqual(source[(i & ~3u) + 3 - (i & 3)], destination[i]);
+                }
+
+                // Nothing is written past the end.
+                Assert::AreEqual<uint8_t>(0xCD, destination.back());
+            }
+        }
+    }
+
+
+    TEST_METHOD_EX(PixelSwizzle_EveryKernel_WorksInPlace)
+    {
+        for (auto kernel : allKernels)
+        {
+            if (!IsPixelSwizzleKernelSupported(kernel))
+                continue;
+
+            uint32_t const pixelCount = 29;
+
+            auto original = MakeTestBytes(pixelCount * 4);
+            auto bytes = original;
+
+            SwizzleColorAndBgra(bytes.data(), bytes.data(), pixelCount, kernel);
+            SwizzleColorAndBgra(bytes.data(), bytes.data(), pixelCount, kernel);
+
+            Assert::IsTrue(original == bytes);
+        }
+    }
+
+
+    TEST_METHOD_EX(PixelSwizzle_Rows_HonorsStrides)
+    {
+        uint32_t const width = 5;
+        uint32_t const height = 3;
+        uint32_t const sourceStride = 32;
+        uint32_t const destinationStride = 24;
+
+        auto source = MakeTestBytes(sourceStride * height);
+        std::vector<uint8_t> destination(destinationStride * height, 0xCD);
+
+        SwizzleColorAndBgra(source.data(), sourceStride, destination.data(), destinationStride, width, height);
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < destinationStride; x++)
+            {
+                auto actual = destination[y * destinationStride + x];
+
+                if (x < width * 4)
+                {
+                    Assert::AreEqual(source[y * sourceStride + (x & ~3u) + 3 - (x & 3)], actual);
+                }
+                else
+                {
+                    // Row padding is left alone.
+                    Assert::AreEqual<uint8_t>(0xCD, actual);
+                }
+            }
+        }
+    }
+
+
+    TEST_METHOD_EX(PixelSwizzle_Rows_TightlyPackedMatchesSinglePass)
+    {
+        uint32_t const width = 7;
+        uint32_t const height = 9;
+
+        auto source = MakeTestBytes(width * height * 4);
+        std::vector<uint8_t> byRows(source.size());
+        std::vector<uint8_t> singlePass(source.size());
+
+        SwizzleColorAndBgra(source.data(), width * 4, byRows.data(), width * 4, width, height);
+        SwizzleColorAndBgra(source.data(), singlePass.data(), width * height);
+
+        Assert::IsTrue(byRows == singlePass);
+    }
+};
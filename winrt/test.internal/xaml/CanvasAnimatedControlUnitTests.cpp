@@ -6,6 +6,8 @@
 
 #include "stubs/StubDxgiSwapChain.h"
 
+#include <lib/effects/generated/GaussianBlurEffect.h>
+
 #include "MockXamlSolidColorBrush.h"
 
 static Color const AnyColor                 {   1,   2,   3,   4 };
@@ -1710,6 +1712,52 @@ TEST_CLASS(CanvasAnimatedControlTests)
         f.Adapter->Tick();
     }
 
+    TEST_METHOD_EX(CanvasAnimatedControl_EffectAnimator_IsUpdatedBeforeEachUpdateEvent)
+    {
+        UpdateRenderFixture f;
+
+        ComPtr<ICanvasEffectAnimator> animator;
+        ThrowIfFailed(f.Control->get_EffectAnimator(&animator));
+        Assert::IsNotNull(animator.Get());
+
+        ComPtr<ICanvasEffectAnimator> sameAnimator;
+        ThrowIfFailed(f.Control->get_EffectAnimator(&sameAnimator));
+        Assert::IsTrue(IsSameInstance(animator.Get(), sameAnimator.Get()));
+
+        auto effect = Make<GaussianBlurEffect>();
+
+        CanvasEffectKeyframe keyframes[] =
+        {
+            { 0, 0,   CanvasEffectEasing::Linear },
+            { 1, 120, CanvasEffectEasing::Linear },
+        };
+
+        uint32_t animationId;
+        ThrowIfFailed(animator->AddAnimation(effect.Get(), WinString(L"BlurAmount"), 0, _countof(keyframes), keyframes, false, &animationId));
+
+        f.GetIntoSteadyState();
+
+        f.Adapter->ProgressTime(TicksPerFrame);
+
+        f.OnUpdate.SetExpectedCalls(1,
+            [&] (ICanvasAnimatedControl*, ICanvasAnimatedUpdateEventArgs* args)
+            {
+                CanvasTimingInformation timingInformation;
+                ThrowIfFailed(args->get_Timing(&timingInformation));
+                Assert::IsTrue(timingInformation.TotalTime.Duration > 0);
+
+                float blurAmount;
+                ThrowIfFailed(effect->get_BlurAmount(&blurAmount));
+
+                auto expected = 120.0f * timingInformation.TotalTime.Duration / StepTimer::TicksPerSecond;
+                Assert::AreEqual(expected, blurAmount, 0.001f);
+                return S_OK;
+            });
+        f.OnDraw.SetExpectedCalls(1);
+
+        f.RenderSingleFrame();
+    }
+
     class TimingFixture : public CanvasAnimatedControlFixture
     {
         MockEventHandler<Animated_DrawEventHandler> m_onDraw;
@@ -359,6 +359,7 @@ namespace test.managed
                    where property.Name != "Sources"
                    where property.Name != "BufferPrecision"
                    where property.Name != "CacheOutput"
+                   where property.Name != "RenderOnCpu"
                    where property.Name != "IsSupported"
                    where property.PropertyType != typeof(IGraphicsEffectSource)
                    select property;